@@ -222,10 +222,20 @@ void FHDF5Saver::operator ()( const T3DImage<T>& image)
               }
        }
 
+       H5StorageOptions options = H5StorageOptions::get_default();
+
+       if (image.has_attribute("hdf5-storage")) {
+              auto storage = image.get_attribute("hdf5-storage");
+
+              if (storage->type_id() == EAttributeType::attr_string)
+                     options = H5StorageOptions::parse(storage->as_string());
+       }
+
        cvdebug() << "Add image to '" << path << "'\n";
-       auto dataset = H5Dataset::create(m_file, path.c_str(), file_type, space);
+       auto dataset = H5Dataset::create(m_file, path.c_str(), file_type, space, options);
        dataset.write_data(image, T());
-       translate_to_hdf5_attributes(dataset, image);
+       // the storage options only control the writing and are not stored in the file
+       translate_to_hdf5_attributes(dataset, image, {"hdf5-storage"});
 }
 
 
@@ -247,7 +257,11 @@ bool CHDF53DImageIOPlugin::do_save(const string& fname, const Data& data) const
 
 const std::string CHDF53DImageIOPlugin::do_get_descr() const
 {
-       return "HDF5 3D image IO";
+       return "HDF5 3D image IO. The images are stored in chunks of about 1 MiB that are "
+              "compressed with the shuffle and deflate filters. The storage layout can be set by "
+              "the environment variable MIA_HDF5_STORAGE or per image by the string attribute "
+              "'hdf5-storage' as comma separated list of key=value pairs: "
+              "chunk=slab|brick|whole|ZxYxX, compression=none|deflate|lzf, level=0-9, shuffle=0|1.";
 }
 
 extern "C" EXPORT CPluginBase *get_plugin_interface()
@@ -21,6 +21,7 @@
 #ifndef addon_hdf5_hdf5mia_hh
 #define addon_hdf5_hdf5mia_hh
 
+#include <set>
 #include <addons/hdf5/hdf5mia.hh>
 
 NS_MIA_BEGIN
@@ -71,7 +72,14 @@ private:
        TranslatorMap m_map;
 };
 
-void HDF54MIA_EXPORT translate_to_hdf5_attributes(const H5Base& target, const CAttributedData& data);
+/**
+   Write the attributes of the data to an HDF5 object
+   \param target the HDF5 object
+   \param data the data whose attributes are written
+   \param skip the names of the attributes that are not written
+*/
+void HDF54MIA_EXPORT translate_to_hdf5_attributes(const H5Base& target, const CAttributedData& data,
+              const std::set<std::string>& skip = std::set<std::string>());
 
 NS_MIA_END
 
@@ -23,6 +23,8 @@
 
 #include <addons/hdf5/hdf5a_mia.hh>
 #include <stack>
+#include <cstdlib>
+#include <algorithm>
 NS_MIA_BEGIN
 
 using std::vector;
@@ -178,6 +180,13 @@ H5Property H5Property::create(hid_t cls)
        return H5Property(id);
 }
 
+H5Property H5Property::get_dataset_create(hid_t dataset)
+{
+       auto id = H5Dget_create_plist(dataset);
+       check_id(id, "H5Property", "get dataset creation properties", dataset);
+       return H5Property(id);
+}
+
 
 H5File::H5File(hid_t id):
        H5Base(H5FileHandle(id))
@@ -416,31 +425,210 @@ static bool can_gzip()
                (filter_info & H5Z_FILTER_CONFIG_DECODE_ENABLED));
 }
 
-H5Dataset H5Dataset::create(const H5Base& parent, const char *name, hid_t type_id, const H5Space& space)
+// the registered id of the LZF filter, http://www.h5py.org/lzf/
+static const H5Z_filter_t h5z_filter_lzf = 32000;
+
+// the size of the slab chunks in bytes, this corresponds to the default chunk cache size
+static const hsize_t h5_slab_chunk_bytes = 1024 * 1024;
+
+// the edge length of the brick chunks
+static const hsize_t h5_brick_edge = 64;
+
+const TDictMap<H5StorageOptions::EChunkShape>::Table h5_chunk_shape_table[] = {
+       {"slab", H5StorageOptions::cs_slab, "slices along the slowest varying dimension"},
+       {"brick", H5StorageOptions::cs_brick, "blocks of 64 elements in each dimension"},
+       {"whole", H5StorageOptions::cs_whole, "the whole data set in one chunk"},
+       {NULL, H5StorageOptions::cs_unknown, ""}
+};
+
+const TDictMap<H5StorageOptions::EChunkShape> g_h5_chunk_shape_dict(h5_chunk_shape_table);
+
+const TDictMap<H5StorageOptions::ECompression>::Table h5_compression_table[] = {
+       {"none", H5StorageOptions::c_none, "no compression"},
+       {"deflate", H5StorageOptions::c_deflate, "gzip compression"},
+       {"lzf", H5StorageOptions::c_lzf, "fast LZF compression"},
+       {NULL, H5StorageOptions::c_unknown, ""}
+};
+
+const TDictMap<H5StorageOptions::ECompression> g_h5_compression_dict(h5_compression_table);
+
+H5StorageOptions::H5StorageOptions():
+       chunk_shape(cs_slab),
+       compression(c_deflate),
+       level(4),
+       shuffle(true)
 {
-       string relative_name(name);
-       H5Base p = H5Group::create_or_open_hierarchy(parent, relative_name, true);
-       hid_t id;
+}
+
+static vector<hsize_t> parse_chunk_size(const string& value)
+{
+       vector<hsize_t> result;
+       size_t start = 0;
+
+       while (start <= value.size()) {
+              size_t end = value.find('x', start);
 
-       if (can_gzip()) {
-              auto dcpl = H5Property::create (H5P_DATASET_CREATE);
-              auto status =  H5Pset_deflate (dcpl, 9);
+              if (end == string::npos)
+                     end = value.size();
 
-              if (status < 0) {
-                     cvwarn() << "HDF5 gzip should be supported, but failed, store uncompressed\n";
-                     id =  H5Dcreate(p, relative_name.c_str(), type_id, space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+              const string item = value.substr(start, end - start);
+              char *item_end = nullptr;
+              const unsigned long long n = strtoull(item.c_str(), &item_end, 10);
+
+              if (item.empty() || *item_end != 0 || n == 0)
+                     throw create_exception<invalid_argument>("H5StorageOptions: invalid chunk size '", value, "'");
+
+              result.push_back(n);
+              start = end + 1;
+       }
+
+       return result;
+}
+
+H5StorageOptions H5StorageOptions::parse(const string& descr)
+{
+       H5StorageOptions result;
+       size_t start = 0;
+
+       while (start < descr.size()) {
+              size_t end = descr.find(',', start);
+
+              if (end == string::npos)
+                     end = descr.size();
+
+              const string item = descr.substr(start, end - start);
+              start = end + 1;
+              const size_t eq = item.find('=');
+
+              if (eq == string::npos)
+                     throw create_exception<invalid_argument>("H5StorageOptions: expect 'key=value', got '", item, "'");
+
+              const string key = item.substr(0, eq);
+              const string value = item.substr(eq + 1);
+
+              if (key == "chunk") {
+                     if (!value.empty() && isdigit(value[0])) {
+                            result.chunk = parse_chunk_size(value);
+                            result.chunk_shape = cs_given;
+                     } else {
+                            result.chunk_shape = g_h5_chunk_shape_dict.get_value(value.c_str());
+                     }
+              } else if (key == "compression") {
+                     result.compression = g_h5_compression_dict.get_value(value.c_str());
+              } else if (key == "level") {
+                     if (value.size() != 1 || !isdigit(value[0]))
+                            throw create_exception<invalid_argument>("H5StorageOptions: compression level must be in [0,9], got '",
+                                            value, "'");
+
+                     result.level = value[0] - '0';
+              } else if (key == "shuffle") {
+                     if (value != "0" && value != "1")
+                            throw create_exception<invalid_argument>("H5StorageOptions: shuffle must be 0 or 1, got '", value, "'");
+
+                     result.shuffle = value == "1";
               } else {
-                     // we compress the whole data in one chunk
-                     auto chunk_size = space.get_size();
-                     status = H5Pset_chunk (dcpl, chunk_size.size(), &chunk_size[0]);
-                     id = H5Dcreate (p, relative_name.c_str(), type_id, space, H5P_DEFAULT, dcpl,
-                                     H5P_DEFAULT);
-                     cvdebug() << "HDF5: Dataset '" << name << "' created with gzip compression enabled\n";
+                     throw create_exception<invalid_argument>("H5StorageOptions: unknown key '", key, "'");
               }
-       } else {
-              id =  H5Dcreate(p, relative_name.c_str(), type_id, space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
        }
 
+       return result;
+}
+
+const H5StorageOptions& H5StorageOptions::get_default()
+{
+       static const H5StorageOptions options = []() {
+              const char *descr = getenv("MIA_HDF5_STORAGE");
+              return descr ? parse(descr) : H5StorageOptions();
+       }();
+       return options;
+}
+
+vector<hsize_t> H5StorageOptions::get_chunk_dims(const vector<hsize_t>& dims, size_t element_size) const
+{
+       vector<hsize_t> result(dims);
+
+       switch (chunk_shape) {
+       case cs_slab: {
+              hsize_t slice_bytes = element_size;
+
+              for (size_t i = 1; i < dims.size(); ++i)
+                     slice_bytes *= dims[i];
+
+              result[0] = std::max(hsize_t(1), std::min(dims[0], h5_slab_chunk_bytes / slice_bytes));
+       }
+       break;
+
+       case cs_brick:
+              for (auto& r : result)
+                     r = std::min(r, h5_brick_edge);
+
+              break;
+
+       case cs_given:
+              if (chunk.size() != dims.size())
+                     throw create_exception<invalid_argument>("H5StorageOptions: chunk size of rank ", chunk.size(),
+                                     " given for a data set of rank ", dims.size());
+
+              for (size_t i = 0; i < dims.size(); ++i)
+                     result[i] = std::min(chunk[i], dims[i]);
+
+              break;
+
+       default:
+              break;
+       }
+
+       return result;
+}
+
+static void add_compression(const H5Property& dcpl, const H5StorageOptions& options)
+{
+       auto compression = options.compression;
+
+       if (compression == H5StorageOptions::c_lzf && H5Zfilter_avail(h5z_filter_lzf) <= 0) {
+              cvwarn() << "HDF5: the LZF filter is not available, use deflate instead\n";
+              compression = H5StorageOptions::c_deflate;
+       }
+
+       if (compression == H5StorageOptions::c_deflate && !can_gzip()) {
+              cvwarn() << "HDF5: gzip is not available, store uncompressed\n";
+              compression = H5StorageOptions::c_none;
+       }
+
+       if (compression == H5StorageOptions::c_none)
+              return;
+
+       // the filters are applied in the order they are added
+       if (options.shuffle && H5Pset_shuffle(dcpl) < 0)
+              cvwarn() << "HDF5: unable to add the shuffle filter\n";
+
+       herr_t status = compression == H5StorageOptions::c_lzf ?
+                       H5Pset_filter(dcpl, h5z_filter_lzf, H5Z_FLAG_OPTIONAL, 0, NULL) :
+                       H5Pset_deflate(dcpl, options.level);
+
+       if (status < 0)
+              cvwarn() << "HDF5: compression should be supported, but failed, store uncompressed\n";
+}
+
+H5Dataset H5Dataset::create(const H5Base& parent, const char *name, hid_t type_id, const H5Space& space,
+                            const H5StorageOptions& options)
+{
+       string relative_name(name);
+       H5Base p = H5Group::create_or_open_hierarchy(parent, relative_name, true);
+       auto dcpl = H5Property::create (H5P_DATASET_CREATE);
+       auto dims = space.get_size();
+
+       // only non-empty simple data sets can be chunked, and only chunked data sets can be compressed
+       if (!dims.empty() && std::find(dims.begin(), dims.end(), 0) == dims.end()) {
+              auto chunk_size = options.get_chunk_dims(dims, H5Tget_size(type_id));
+
+              if (H5Pset_chunk (dcpl, chunk_size.size(), &chunk_size[0]) < 0)
+                     throw create_exception<runtime_error>("H5Dataset: unable to set the chunk size for '", name, "'");
+
+              add_compression(dcpl, options);
+       }
+
+       auto id = H5Dcreate (p, relative_name.c_str(), type_id, space, H5P_DEFAULT, dcpl, H5P_DEFAULT);
        check_id(id, "H5Dataset", "create", relative_name);
        H5Dataset set(id, space, name);
        set.set_parent(p);
@@ -483,9 +671,54 @@ void  H5Dataset::read( hid_t type_id, void *data) const
        }
 }
 
+void  H5Dataset::read( hid_t type_id, void *data, const vector<hsize_t>& start,
+                       const vector<hsize_t>& count) const
+{
+       auto size = get_size();
+
+       if (size.empty() || start.size() != size.size() || count.size() != size.size())
+              throw create_exception<invalid_argument>("H5Dataset::read: block of rank ", count.size(),
+                              " requested from data set '", m_name, "' of rank ", size.size());
+
+       for (size_t i = 0; i < size.size(); ++i) {
+              if (start[i] + count[i] > size[i])
+                     throw create_exception<invalid_argument>("H5Dataset::read: requested block exceeds data set '",
+                                     m_name, "' in dimension ", i);
+       }
+
+       H5Space file_space(H5Dget_space(*this));
+       check_id(file_space, "H5Dataset", "get space", m_name);
+
+       if (H5Sselect_hyperslab(file_space, H5S_SELECT_SET, &start[0], NULL, &count[0], NULL) < 0)
+              throw create_exception<runtime_error>("H5Dataset::read: unable to select block in '", m_name, "'");
+
+       auto mem_space = H5Space::create(count);
+       auto err =  H5Dread(*this, type_id, mem_space, file_space, H5P_DEFAULT, data);
+
+       if (err < 0) {
+              throw create_exception<runtime_error>("H5Dataset::read: error reading block of data set  '", m_name, "'");
+       }
+}
+
 vector <hsize_t> H5Dataset::get_size() const
 {
        return m_space.get_size();
 }
 
+vector <hsize_t> H5Dataset::get_chunk_size() const
+{
+       H5Property dcpl = H5Property::get_dataset_create(*this);
+       vector <hsize_t> result;
+
+       if (H5Pget_layout(dcpl) == H5D_CHUNKED) {
+              result.resize(get_size().size());
+
+              if (H5Pget_chunk(dcpl, result.size(), &result[0]) < 0)
+                     throw create_exception<runtime_error>("H5Dataset::get_chunk_size: error reading the chunk size of '",
+                                                           m_name, "'");
+       }
+
+       return result;
+}
+
 NS_MIA_END
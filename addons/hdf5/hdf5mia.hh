@@ -34,6 +34,7 @@
 #define addons_hdf5_hdf5mia_hh
 
 #include <mia/core/attributes.hh>
+#include <mia/core/dictmap.hh>
 #include <mia/core/singular_refobj.hh>
 #include <miaconfig.h>
 #include <hdf5.h>
@@ -131,6 +132,7 @@ class HDF54MIA_EXPORT H5Property: public H5Base
 public:
        H5Property() = default;
        static H5Property create(hid_t cls);
+       static H5Property get_dataset_create(hid_t dataset);
 };
 
 
@@ -181,12 +183,90 @@ private:
        int do_get_mia_type_id() const;
 };
 
+/**
+   Describes how a data set is laid out in the file, i.e. the shape of the chunks and
+   the filters that compress them. HDF5 reads and decompresses whole chunks, hence a
+   partial read only needs to process the chunks that intersect the requested block.
+   All sizes are given in file order, i.e. the slowest varying dimension first.
+*/
+struct HDF54MIA_EXPORT H5StorageOptions {
+       /// the shape of the chunks
+       enum EChunkShape {
+              cs_slab,  /**< whole slices along the slowest varying dimension, stacked to about 1 MiB */
+              cs_brick, /**< blocks of 64 elements in each dimension */
+              cs_whole, /**< the whole data set is stored in one chunk */
+              cs_given, /**< the chunk size is given explicitly */
+              cs_unknown
+       };
+
+       /// the compression filter
+       enum ECompression {
+              c_none,    /**< store uncompressed */
+              c_deflate, /**< gzip compression, always available */
+              c_lzf,     /**< the fast LZF compression, requires the HDF5 LZF filter plug-in */
+              c_unknown
+       };
+
+       /// The defaults: slab chunks, shuffle filter and deflate with level 4
+       H5StorageOptions();
+
+       /**
+          Parse the options from a comma separated list of key=value pairs, e.g.
+          "chunk=brick,compression=lzf,shuffle=0". Supported keys are
+          - chunk: slab, brick, whole, or the chunk size like 8x256x256
+          - compression: none, deflate, or lzf (falls back to deflate if not available)
+          - level: the deflate compression level (0-9)
+          - shuffle: 1 to apply the byte shuffle filter before compression, 0 otherwise
+          Keys that are not given keep their default value.
+          \param descr the option string
+          \returns the options
+          \remark throws std::invalid_argument if the string can not be parsed
+       */
+       static H5StorageOptions parse(const std::string& descr);
+
+       /**
+          \returns the options given in the environment variable MIA_HDF5_STORAGE, or the
+          defaults if it is not set
+       */
+       static const H5StorageOptions& get_default();
+
+       /**
+          Evaluate the chunk size for a data set
+          \param dims size of the data set
+          \param element_size size of one element in bytes
+          \returns the chunk size
+       */
+       std::vector<hsize_t> get_chunk_dims(const std::vector<hsize_t>& dims, size_t element_size) const;
+
+       /// shape of the chunks
+       EChunkShape chunk_shape;
+
+       /// the chunk size if chunk_shape == cs_given
+       std::vector<hsize_t> chunk;
+
+       /// compression filter
+       ECompression compression;
+
+       /// deflate compression level
+       unsigned level;
+
+       /// apply the shuffle filter
+       bool shuffle;
+};
+
+/// dictionary for the chunk shapes
+extern HDF54MIA_EXPORT const TDictMap<H5StorageOptions::EChunkShape> g_h5_chunk_shape_dict;
+
+/// dictionary for the compression filters
+extern HDF54MIA_EXPORT const TDictMap<H5StorageOptions::ECompression> g_h5_compression_dict;
+
 class HDF54MIA_EXPORT H5Dataset: public H5Base
 {
        H5Dataset (hid_t id, const H5Space& space, const char *name);
 public:
        H5Dataset() = default;
-       static H5Dataset create(const H5Base& parent, const char *name, hid_t type_id, const H5Space& space);
+       static H5Dataset create(const H5Base& parent, const char *name, hid_t type_id, const H5Space& space,
+                               const H5StorageOptions& options = H5StorageOptions::get_default());
 
        static H5Dataset open(const H5Base& parent, const char *name);
 
@@ -197,8 +277,22 @@ public:
        template <typename Image, typename T>
        void  read_data(Image& image, T MIA_PARAM_UNUSED(dummy))const;
 
+       /**
+          Read a block of the data set. Only the chunks that intersect the block are
+          read from the file and decompressed.
+          \param[out] image storage for the block, its size must be the product of  count
+          \param start first index of the block in file order
+          \param count size of the block in file order
+       */
+       template <typename Image, typename T>
+       void  read_data(Image& image, const std::vector<hsize_t>& start,
+                       const std::vector<hsize_t>& count, T MIA_PARAM_UNUSED(dummy))const;
+
        std::vector <hsize_t> get_size() const;
 
+       /// \returns the chunk size of the data set, or an empty vector if it is not chunked
+       std::vector <hsize_t> get_chunk_size() const;
+
 private:
 
        template <typename Iterator, typename T>
@@ -206,6 +300,8 @@ private:
 
        void  write( hid_t type_id, const void *data);
        void  read( hid_t type_id, void *data) const;
+       void  read( hid_t type_id, void *data, const std::vector<hsize_t>& start,
+                   const std::vector<hsize_t>& count) const;
 
        H5Space m_space;
        std::string m_name;
@@ -273,6 +369,25 @@ typename Image::Pointer read_image(typename Image::dimsize_type& size, const H5D
        return presult;
 }
 
+/**
+   Read a block of a data set into a new image
+   \param size size of the image, it must correspond to \a count
+   \param dataset the data set
+   \param start first index of the block in file order
+   \param count size of the block in file order
+   \returns the image
+*/
+template <typename Image, typename T = typename Image::value_type>
+typename Image::Pointer read_image(typename Image::dimsize_type& size, const H5Dataset& dataset,
+                                   const std::vector<hsize_t>& start, const std::vector<hsize_t>& count)
+{
+       Image *result = new Image(size);
+       typename Image::Pointer presult(result);
+       dataset.read_and_append_attributes(*result);
+       dataset.read_data(*result, start, count, T());
+       return presult;
+}
+
 template <typename Iterator, typename T>
 struct __dispatch_h5dataset_rw {
        static void apply_write(H5Dataset& id, Iterator begin, Iterator MIA_PARAM_UNUSED(end))
@@ -285,6 +400,12 @@ struct __dispatch_h5dataset_rw {
               TRACE_FUNCTION;
               id.read(Mia_to_h5_types<T>::mem_datatype(), &begin[0]);
        }
+       static void apply_read(const H5Dataset& id, Iterator begin, Iterator MIA_PARAM_UNUSED(end),
+                              const std::vector<hsize_t>& start, const std::vector<hsize_t>& count)
+       {
+              TRACE_FUNCTION;
+              id.read(Mia_to_h5_types<T>::mem_datatype(), &begin[0], start, count);
+       }
 };
 
 template <typename Iterator>
@@ -303,6 +424,14 @@ struct __dispatch_h5dataset_rw<Iterator, bool> {
               id.read(Mia_to_h5_types<bool>::mem_datatype(), &help[0]);
               copy(help.begin(), help.end(), begin);
        }
+       static void apply_read(const H5Dataset& id, Iterator begin, Iterator end,
+                              const std::vector<hsize_t>& start, const std::vector<hsize_t>& count)
+       {
+              TRACE_FUNCTION;
+              std::vector<char> help(std::distance(begin, end));
+              id.read(Mia_to_h5_types<bool>::mem_datatype(), &help[0], start, count);
+              copy(help.begin(), help.end(), begin);
+       }
 };
 
 
@@ -320,6 +449,22 @@ void  H5Dataset::read_data(Image& image, T MIA_PARAM_UNUSED(dummy))const
        h5dataset_rw::apply_read(*this, image.begin(), image.end());
 }
 
+template <typename Image, typename T>
+void  H5Dataset::read_data(Image& image, const std::vector<hsize_t>& start,
+                           const std::vector<hsize_t>& count, T MIA_PARAM_UNUSED(dummy))const
+{
+       hsize_t n = 1;
+
+       for (auto c : count)
+              n *= c;
+
+       if (n != image.size())
+              throw std::invalid_argument("H5Dataset::read_data: the block size doesn't correspond to the image size");
+
+       typedef __dispatch_h5dataset_rw<typename Image::iterator, T> h5dataset_rw;
+       h5dataset_rw::apply_read(*this, image.begin(), image.end(), start, count);
+}
+
 
 
 NS_MIA_END
@@ -26,6 +26,7 @@
 #include <boost/test/unit_test.hpp>
 
 #include <addons/hdf5/hdf5_3dimage.hh>
+#include <addons/hdf5/hdf5mia.hh>
 
 using namespace std;
 using namespace mia;
@@ -106,3 +107,33 @@ BOOST_AUTO_TEST_CASE_TEMPLATE( test_simple_write_read, T, test_types )
 
 
 
+BOOST_AUTO_TEST_CASE( test_write_with_storage_attribute )
+{
+       C3DBounds size (16, 12, 10);
+       C3DFImage *image = new C3DFImage(size);
+       __fill_image<float>::apply(*image);
+       image->set_attribute("hdf5-path", "/chunked");
+       image->set_attribute("hdf5-storage", "chunk=4x6x8,compression=deflate,level=1");
+       CHDF53DImageIOPlugin io;
+       CHDF53DImageIOPlugin::Data images;
+       images.push_back(P3DImage(image));
+       const string filename("testimage-storage.h5");
+       BOOST_REQUIRE(io.save(filename, images));
+       {
+              auto file = H5File::open(filename.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+              auto dataset = H5Dataset::open(file, "/chunked");
+              auto chunk = dataset.get_chunk_size();
+              BOOST_REQUIRE_EQUAL(chunk.size(), 3u);
+              BOOST_CHECK_EQUAL(chunk[0], 4u);
+              BOOST_CHECK_EQUAL(chunk[1], 6u);
+              BOOST_CHECK_EQUAL(chunk[2], 8u);
+       }
+       auto loaded = io.load(filename);
+       BOOST_REQUIRE(loaded);
+       BOOST_REQUIRE(loaded->size() == 1u);
+       const auto& ploaded = dynamic_cast<const C3DFImage&>(*(*loaded)[0]);
+       BOOST_CHECK(equal(image->begin(), image->end(), ploaded.begin()));
+       // the storage options are not written as attribute
+       BOOST_CHECK(!ploaded.has_attribute("hdf5-storage"));
+       unlink(filename.c_str());
+}
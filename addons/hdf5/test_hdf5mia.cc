@@ -346,3 +346,127 @@ BOOST_FIXTURE_TEST_CASE (test_attribute_list, HDF5CoreFileFixture)
        CAttributedData loaded_data = get_file().read_attributes();
        BOOST_CHECK_EQUAL(loaded_data, original_data);
 }
+
+BOOST_AUTO_TEST_CASE (test_storage_options_parse)
+{
+       auto defaults = H5StorageOptions::parse("");
+       BOOST_CHECK_EQUAL(defaults.chunk_shape, H5StorageOptions::cs_slab);
+       BOOST_CHECK_EQUAL(defaults.compression, H5StorageOptions::c_deflate);
+       BOOST_CHECK_EQUAL(defaults.level, 4u);
+       BOOST_CHECK(defaults.shuffle);
+       auto options = H5StorageOptions::parse("chunk=brick,compression=lzf,level=1,shuffle=0");
+       BOOST_CHECK_EQUAL(options.chunk_shape, H5StorageOptions::cs_brick);
+       BOOST_CHECK_EQUAL(options.compression, H5StorageOptions::c_lzf);
+       BOOST_CHECK_EQUAL(options.level, 1u);
+       BOOST_CHECK(!options.shuffle);
+       auto given = H5StorageOptions::parse("chunk=2x16x32");
+       BOOST_CHECK_EQUAL(given.chunk_shape, H5StorageOptions::cs_given);
+       BOOST_REQUIRE_EQUAL(given.chunk.size(), 3u);
+       BOOST_CHECK_EQUAL(given.chunk[0], 2u);
+       BOOST_CHECK_EQUAL(given.chunk[1], 16u);
+       BOOST_CHECK_EQUAL(given.chunk[2], 32u);
+       BOOST_CHECK_THROW(H5StorageOptions::parse("chunk=2x0x3"), invalid_argument);
+       BOOST_CHECK_THROW(H5StorageOptions::parse("chunk=2xx3"), invalid_argument);
+       BOOST_CHECK_THROW(H5StorageOptions::parse("chunk=cube"), invalid_argument);
+       BOOST_CHECK_THROW(H5StorageOptions::parse("level=10"), invalid_argument);
+       BOOST_CHECK_THROW(H5StorageOptions::parse("shuffle=yes"), invalid_argument);
+       BOOST_CHECK_THROW(H5StorageOptions::parse("speed=fast"), invalid_argument);
+       BOOST_CHECK_THROW(H5StorageOptions::parse("chunk"), invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE (test_storage_options_chunk_dims)
+{
+       const vector<hsize_t> dims = {100, 512, 256};
+       H5StorageOptions options;
+       // 1 MiB slabs of float slices of 512 KiB
+       auto slab = options.get_chunk_dims(dims, 4);
+       BOOST_CHECK_EQUAL(slab[0], 2u);
+       BOOST_CHECK_EQUAL(slab[1], 512u);
+       BOOST_CHECK_EQUAL(slab[2], 256u);
+       // slices larger than 1 MiB are stored one per chunk
+       auto large_slab = options.get_chunk_dims(dims, 16);
+       BOOST_CHECK_EQUAL(large_slab[0], 1u);
+       // small data sets are stored in one chunk
+       auto small_slab = options.get_chunk_dims({3, 4, 5}, 4);
+       BOOST_CHECK_EQUAL(small_slab[0], 3u);
+       options.chunk_shape = H5StorageOptions::cs_brick;
+       auto brick = options.get_chunk_dims({100, 32, 256}, 4);
+       BOOST_CHECK_EQUAL(brick[0], 64u);
+       BOOST_CHECK_EQUAL(brick[1], 32u);
+       BOOST_CHECK_EQUAL(brick[2], 64u);
+       options.chunk_shape = H5StorageOptions::cs_whole;
+       BOOST_CHECK(options.get_chunk_dims(dims, 4) == dims);
+       options.chunk_shape = H5StorageOptions::cs_given;
+       options.chunk = {8, 1024, 16};
+       auto given = options.get_chunk_dims(dims, 4);
+       BOOST_CHECK_EQUAL(given[0], 8u);
+       BOOST_CHECK_EQUAL(given[1], 512u);
+       BOOST_CHECK_EQUAL(given[2], 16u);
+       BOOST_CHECK_THROW(options.get_chunk_dims({10, 10}, 4), invalid_argument);
+}
+
+BOOST_FIXTURE_TEST_CASE (test_dataset_chunked_block_read, HDF5CoreFileFixture)
+{
+       const vector<hsize_t> dims = {4, 6, 5};
+       vector<int32_t> data(4 * 6 * 5);
+
+       for (size_t i = 0; i < data.size(); ++i)
+              data[i] = i;
+
+       auto options = H5StorageOptions::parse("chunk=2x3x5,compression=deflate,level=1");
+       auto space = H5Space::create(dims);
+       auto dataset = H5Dataset::create(get_file(), "/chunked", Mia_to_h5_types<int32_t>::file_datatype(),
+                                        space, options);
+       dataset.write_data(data, int32_t());
+       auto rdataset = H5Dataset::open(get_file(), "/chunked");
+       auto chunk = rdataset.get_chunk_size();
+       BOOST_REQUIRE_EQUAL(chunk.size(), 3u);
+       BOOST_CHECK_EQUAL(chunk[0], 2u);
+       BOOST_CHECK_EQUAL(chunk[1], 3u);
+       BOOST_CHECK_EQUAL(chunk[2], 5u);
+       // a block that crosses chunk borders
+       const vector<hsize_t> start = {1, 2, 1};
+       const vector<hsize_t> count = {2, 3, 3};
+       vector<int32_t> block(2 * 3 * 3);
+       rdataset.read_data(block, start, count, int32_t());
+       auto b = block.begin();
+
+       for (hsize_t z = 0; z < count[0]; ++z)
+              for (hsize_t y = 0; y < count[1]; ++y)
+                     for (hsize_t x = 0; x < count[2]; ++x, ++b)
+                            BOOST_CHECK_EQUAL(*b, data[((start[0] + z) * 6 + start[1] + y) * 5 + start[2] + x]);
+
+       // the block must fit into the data set and the storage
+       BOOST_CHECK_THROW(rdataset.read_data(block, {3, 2, 1}, count, int32_t()), invalid_argument);
+       BOOST_CHECK_THROW(rdataset.read_data(block, {1, 2}, {2, 9}, int32_t()), invalid_argument);
+       BOOST_CHECK_THROW(rdataset.read_data(block, start, {2, 3, 2}, int32_t()), invalid_argument);
+}
+
+BOOST_FIXTURE_TEST_CASE (test_dataset_contiguous, HDF5CoreFileFixture)
+{
+       auto options = H5StorageOptions::parse("compression=none,chunk=whole");
+       auto space = H5Space::create(vector<hsize_t> {2, 3});
+       auto dataset = H5Dataset::create(get_file(), "/whole", Mia_to_h5_types<int32_t>::file_datatype(),
+                                        space, options);
+       auto chunk = dataset.get_chunk_size();
+       BOOST_CHECK_EQUAL(chunk.size(), 2u);
+       auto empty_space = H5Space::create(vector<hsize_t> {0, 3});
+       auto empty_dataset = H5Dataset::create(get_file(), "/empty", Mia_to_h5_types<int32_t>::file_datatype(),
+                                              empty_space);
+       BOOST_CHECK(empty_dataset.get_chunk_size().empty());
+}
+
+BOOST_FIXTURE_TEST_CASE (test_bool_dataset_block_read, HDF5CoreFileFixture)
+{
+       vector<bool> data {false, true, true, false, false, true};
+       auto space = H5Space::create(vector<hsize_t> {2, 3});
+       auto dataset = H5Dataset::create(get_file(), "/bool", Mia_to_h5_types<bool>::file_datatype(), space);
+       dataset.write_data(data, true);
+       vector<bool> block(2);
+       dataset.read_data(block, {1, 0}, {1, 2}, false);
+       BOOST_CHECK_EQUAL(block[0], false);
+       BOOST_CHECK_EQUAL(block[1], false);
+       dataset.read_data(block, {0, 1}, {2, 1}, false);
+       BOOST_CHECK_EQUAL(block[0], true);
+       BOOST_CHECK_EQUAL(block[1], false);
+}
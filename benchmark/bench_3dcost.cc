@@ -0,0 +1,96 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+  Value and force of all available 3D image cost function plug-ins, created with
+  their default parameters. The SSD force is also measured on a larger volume,
+  run it with different values of --threads to see how the evaluation scales.
+*/
+
+#include <sstream>
+#include <mia/3d/cost.hh>
+#include <benchmark/benchmark.hh>
+#include <benchmark/synthetic.hh>
+
+NS_MIA_USE;
+using std::string;
+
+struct SCostBenchmarkData {
+       SCostBenchmarkData(const string& descr, const C3DBounds& size);
+
+       P3DImageCost cost;
+       // the cost function only holds a reference to the reference image
+       C3DFImage ref;
+       C3DFImage src;
+};
+
+SCostBenchmarkData::SCostBenchmarkData(const string& descr, const C3DBounds& size):
+       cost(C3DImageCostPluginHandler::instance().produce(descr)),
+       ref(create_synthetic_3dimage(size, 1)),
+       src(create_synthetic_3dimage(size, 1, C3DFVector(1.5f, -1.0f, 0.5f)))
+{
+       cost->set_reference(ref);
+}
+
+static void cost_value(CBenchmarkState& state, const string& descr)
+{
+       SCostBenchmarkData data(descr, g_benchmark_3dsize);
+       double sum = 0.0;
+
+       while (state.keep_running())
+              sum += data.cost->value(data.src);
+
+       state.set_items_processed(data.src.size());
+       // the cost value helps to spot changes in the results
+       std::ostringstream label;
+       label << "value=" << sum / state.iterations();
+       state.set_label(label.str());
+}
+
+static void cost_force(CBenchmarkState& state, const string& descr, const C3DBounds& size)
+{
+       SCostBenchmarkData data(descr, size);
+       C3DFVectorfield force(size);
+
+       while (state.keep_running()) {
+              std::fill(force.begin(), force.end(), C3DFVector::_0);
+              data.cost->evaluate_force(data.src, force);
+       }
+
+       state.set_items_processed(data.src.size());
+}
+
+static CBenchmarkRegistration cost_benchmarks([](CBenchmarkRegistry & registry)
+{
+       for (auto& p : C3DImageCostPluginHandler::instance()) {
+              const string name(p.first);
+              registry.add("cost/" + name + "/value", [name](CBenchmarkState & state) {
+                     cost_value(state, name);
+              });
+              registry.add("cost/" + name + "/force", [name](CBenchmarkState & state) {
+                     cost_force(state, name, g_benchmark_3dsize);
+              });
+       }
+});
+
+MIA_BENCHMARK(cost, ssd_force_96)
+{
+       cost_force(state, "ssd", C3DBounds(96, 96, 96));
+}
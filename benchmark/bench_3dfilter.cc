@@ -0,0 +1,163 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+  The commonly used 3D image filters with fixed parameters, the labelling of a
+  large sparse segmentation with many small components, and the seeded watershed
+  with the different flooding queues.
+*/
+
+#include <mia/3d/filter.hh>
+#include <mia/3d/imageio.hh>
+#include <benchmark/benchmark.hh>
+#include <benchmark/synthetic.hh>
+
+NS_MIA_USE;
+using std::string;
+
+struct SFilterBenchmark {
+       const char *descr;
+       EPixelType input_type;
+};
+
+static const SFilterBenchmark filter_benchmarks[] = {
+       {"bandpass:min=64,max=192", it_ubyte},
+       {"binarize:min=128,max=255", it_ubyte},
+       {"close", it_bit},
+       {"convert:repn=float,map=linear", it_ubyte},
+       {"dilate", it_ubyte},
+       {"distance", it_bit},
+       {"downscale:b=[<2,2,2>]", it_float},
+       {"erode", it_ubyte},
+       {"gauss:w=2", it_ubyte},
+       {"gradnorm", it_float},
+       {"label", it_bit},
+       {"mean:w=2", it_ubyte},
+       {"median:w=1", it_ubyte},
+       {"median:w=2", it_ushort},
+       {"open", it_bit},
+       {"scale:s=[<96,96,96>]", it_float},
+       {"sepconv:kx=[gauss:w=3],ky=[gauss:w=3],kz=[gauss:w=3]", it_float},
+       {"variance:w=2", it_float},
+       {"ws", it_ubyte}
+};
+
+static void filter_image(CBenchmarkState& state, const SFilterBenchmark& b)
+{
+       auto filter = C3DFilterPluginHandler::instance().produce(b.descr);
+       auto image = create_synthetic_3dimage(g_benchmark_3dsize, b.input_type, 1);
+
+       while (state.keep_running())
+              filter->filter(*image);
+
+       state.set_items_processed(image->get_size().product());
+       state.set_label(CPixelTypeDict.get_name(b.input_type));
+}
+
+static CBenchmarkRegistration filter_benchmark_registration([](CBenchmarkRegistry & registry)
+{
+       for (auto& b : filter_benchmarks) {
+              registry.add(string("filter/") + b.descr, [&b](CBenchmarkState & state) {
+                     filter_image(state, b);
+              });
+       }
+});
+
+MIA_BENCHMARK(filter, label_sparse)
+{
+       const C3DBounds size(160, 150, 140);
+       C3DBitImage image(size);
+       unsigned int seed = 17;
+       auto i = image.begin_range(C3DBounds::_0, size);
+
+       for (; i != image.end_range(C3DBounds::_0, size); ++i) {
+              seed = seed * 1103515245 + 12345;
+              auto p = i.pos();
+              // sparse random voxels plus some long tubes that span many slabs
+              *i = ((seed >> 16) % 100) < 12 || ((p.x % 40) == 3 && (p.y % 30) == 7);
+       }
+
+       auto filter = C3DFilterPluginHandler::instance().produce("label:n=26n");
+
+       while (state.keep_running())
+              filter->filter(image);
+
+       state.set_items_processed(size.product());
+}
+
+/*
+  The seeded watershed floods an integer input with the exact bucket queue, the
+  float input with the priority queue, or with a bucket queue of one level per
+  value, and the integer input with the FIFO buckets.
+*/
+struct SSeededWSBenchmark {
+       const char *name;
+       const char *descr;
+       bool float_input;
+};
+
+static const SSeededWSBenchmark seeded_ws_benchmarks[] = {
+       {"bucket", "sws:seed=bench_sws_seed.@,n=6n,grad=1", false},
+       {"priority", "sws:seed=bench_sws_seed.@,n=6n,grad=1", true},
+       {"quantized", "sws:seed=bench_sws_seed.@,n=6n,grad=1,q=401", true},
+       {"fifo", "sws:seed=bench_sws_seed.@,n=6n,grad=1,fifo=1", false}
+};
+
+static void seeded_ws_image(CBenchmarkState& state, const SSeededWSBenchmark& b)
+{
+       const C3DBounds size(96, 96, 96);
+       C3DUBImage *seeds = new C3DUBImage(size);
+       (*seeds)(C3DBounds(5, 5, 5)) = 1;
+       (*seeds)(C3DBounds(90, 10, 50)) = 2;
+       (*seeds)(C3DBounds(40, 80, 20)) = 3;
+       (*seeds)(C3DBounds(60, 60, 90)) = 4;
+       save_image("bench_sws_seed.@", P3DImage(seeds));
+       C3DUSImage *usimage = new C3DUSImage(size);
+       C3DFImage *fimage = new C3DFImage(size);
+       auto i = usimage->begin_range(C3DBounds::_0, size);
+       auto f = fimage->begin();
+
+       // values in [0, 400]
+       for (; i != usimage->end_range(C3DBounds::_0, size); ++i, ++f) {
+              auto p = i.pos();
+              *i = static_cast<unsigned short>(100 * (2.0 + sin(0.2 * p.x) * cos(0.15 * p.y) + sin(0.1 * p.z)));
+              *f = *i;
+       }
+
+       P3DImage usinput(usimage);
+       P3DImage finput(fimage);
+       const C3DImage& image = b.float_input ? *finput : *usinput;
+       auto filter = C3DFilterPluginHandler::instance().produce(b.descr);
+
+       while (state.keep_running())
+              filter->filter(image);
+
+       state.set_items_processed(size.product());
+       state.set_label(CPixelTypeDict.get_name(image.get_pixel_type()));
+}
+
+static CBenchmarkRegistration seeded_ws_benchmark_registration([](CBenchmarkRegistry & registry)
+{
+       for (auto& b : seeded_ws_benchmarks) {
+              registry.add(string("filter/sws/") + b.name, [&b](CBenchmarkState & state) {
+                     seeded_ws_image(state, b);
+              });
+       }
+});
@@ -0,0 +1,140 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+  Saving and loading a 3D image with each available image IO plug-in. The files are
+  written to the temporary directory of the system. The throughput is given in voxels.
+*/
+
+#include <boost/filesystem.hpp>
+#include <mia/core/errormacro.hh>
+#include <mia/3d/imageio.hh>
+#include <benchmark/benchmark.hh>
+#include <benchmark/synthetic.hh>
+
+NS_MIA_USE;
+using std::string;
+namespace bfs = boost::filesystem;
+
+// a directory for the test files that is removed when the benchmark is finished,
+// some formats write more than one file
+class CTemporaryDirectory
+{
+public:
+       CTemporaryDirectory():
+              m_path(bfs::temp_directory_path() / bfs::unique_path("mia-benchmark-%%%%-%%%%"))
+       {
+              bfs::create_directory(m_path);
+       }
+
+       ~CTemporaryDirectory()
+       {
+              boost::system::error_code ec;
+              bfs::remove_all(m_path, ec);
+       }
+
+       string get_file_name(const string& suffix) const
+       {
+              return (m_path / ("benchmark." + suffix)).string();
+       }
+private:
+       bfs::path m_path;
+};
+
+static EPixelType get_benchmark_pixel_type(const C3DImageIOPlugin& plugin)
+{
+       auto& types = plugin.supported_pixel_types();
+
+       for (auto t : {
+                     it_ubyte, it_ushort, it_sshort, it_float
+              })
+              if (types.find(t) != types.end())
+                     return t;
+
+       if (types.empty())
+              throw create_exception<std::invalid_argument>("IO plug-in '", plugin.get_name(),
+                            "' doesn't support any pixel type");
+
+       return *types.begin();
+}
+
+static C3DImageVector create_io_data(const C3DImageIOPlugin& plugin)
+{
+       C3DImageVector data;
+       data.push_back(create_synthetic_3dimage(g_benchmark_3dsize, get_benchmark_pixel_type(plugin), 1));
+       return data;
+}
+
+static void image_save(CBenchmarkState& state, const C3DImageIOPlugin& plugin)
+{
+       const auto data = create_io_data(plugin);
+       CTemporaryDirectory dir;
+       const string filename = dir.get_file_name(plugin.get_preferred_suffix());
+
+       while (state.keep_running()) {
+              if (!plugin.save(filename, data)) {
+                     state.skip_with_error("saving failed");
+                     break;
+              }
+       }
+
+       state.set_items_processed(data[0]->get_size().product());
+       state.set_label(CPixelTypeDict.get_name(data[0]->get_pixel_type()));
+}
+
+static void image_load(CBenchmarkState& state, const C3DImageIOPlugin& plugin)
+{
+       const auto data = create_io_data(plugin);
+       CTemporaryDirectory dir;
+       const string filename = dir.get_file_name(plugin.get_preferred_suffix());
+
+       if (!plugin.save(filename, data)) {
+              state.skip_with_error("saving failed");
+              return;
+       }
+
+       while (state.keep_running()) {
+              if (!plugin.load(filename)) {
+                     state.skip_with_error("loading failed");
+                     break;
+              }
+       }
+
+       state.set_items_processed(data[0]->get_size().product());
+       state.set_label(CPixelTypeDict.get_name(data[0]->get_pixel_type()));
+}
+
+static CBenchmarkRegistration imageio_benchmarks([](CBenchmarkRegistry & registry)
+{
+       for (auto& p : C3DImageIOPluginHandler::instance()) {
+              auto plugin = p.second;
+
+              // the data pool is not a file format
+              if (p.first == "datapool")
+                     continue;
+
+              registry.add("imageio/" + p.first + "/save", [plugin](CBenchmarkState & state) {
+                     image_save(state, *plugin);
+              });
+              registry.add("imageio/" + p.first + "/load", [plugin](CBenchmarkState & state) {
+                     image_load(state, *plugin);
+              });
+       }
+});
@@ -0,0 +1,122 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+  T3DConvoluteInterpolator: creation of the coefficients, and evaluation at random
+  locations and along image rows for the commonly used kernels.
+*/
+
+#include <memory>
+#include <random>
+#include <mia/3d/interpolator.hh>
+#include <benchmark/benchmark.hh>
+#include <benchmark/synthetic.hh>
+
+NS_MIA_USE;
+using std::vector;
+using std::string;
+using std::unique_ptr;
+
+static const char *interpolator_kernels[] = {
+       "bspline:d=1", "bspline:d=3", "bspline:d=5", "omoms:d=3"
+};
+
+static void interpolator_prefilter(CBenchmarkState& state, const string& kernel)
+{
+       const C3DFImage image = create_synthetic_3dimage(g_benchmark_3dsize, 1);
+       const C3DInterpolatorFactory ipf(kernel, "mirror");
+
+       while (state.keep_running()) {
+              unique_ptr<T3DConvoluteInterpolator<float>> interp(ipf.create(image.data()));
+       }
+
+       state.set_items_processed(image.size());
+}
+
+static void interpolator_random(CBenchmarkState& state, const string& kernel)
+{
+       const C3DFImage image = create_synthetic_3dimage(g_benchmark_3dsize, 1);
+       const C3DInterpolatorFactory ipf(kernel, "mirror");
+       unique_ptr<T3DConvoluteInterpolator<float>> interp(ipf.create(image.data()));
+       auto cache = interp->create_cache();
+       std::mt19937 rng(2);
+       std::uniform_real_distribution<float> pos(0.0f, g_benchmark_3dsize.x - 1.0f);
+       vector<C3DFVector> points(1 << 16);
+
+       for (auto& p : points)
+              p = C3DFVector(pos(rng), pos(rng), pos(rng));
+
+       float sum = 0.0f;
+
+       while (state.keep_running()) {
+              for (auto& p : points)
+                     sum += (*interp)(p, cache);
+       }
+
+       state.set_items_processed(points.size());
+
+       if (sum == 0.0f)
+              state.set_label("zero sum");
+}
+
+static void interpolator_rows(CBenchmarkState& state, const string& kernel)
+{
+       const C3DFImage image = create_synthetic_3dimage(g_benchmark_3dsize, 1);
+       const C3DInterpolatorFactory ipf(kernel, "mirror");
+       unique_ptr<T3DConvoluteInterpolator<float>> interp(ipf.create(image.data()));
+       auto cache = interp->create_cache();
+       const C3DBounds& size = g_benchmark_3dsize;
+       const C3DFVector shift(0.3f, 0.4f, 0.5f);
+       vector<C3DFVector> row(size.x);
+       vector<float> values(size.x);
+       float sum = 0.0f;
+
+       while (state.keep_running()) {
+              for (unsigned z = 0; z < size.z; ++z)
+                     for (unsigned y = 0; y < size.y; ++y) {
+                            for (unsigned x = 0; x < size.x; ++x)
+                                   row[x] = C3DFVector(x, y, z) + shift;
+
+                            (*interp)(row, values, cache);
+                            sum += values[0];
+                     }
+       }
+
+       state.set_items_processed(size.product());
+
+       if (sum == 0.0f)
+              state.set_label("zero sum");
+}
+
+static CBenchmarkRegistration interpolator_benchmarks([](CBenchmarkRegistry & registry)
+{
+       for (auto k : interpolator_kernels) {
+              const string kernel(k);
+              registry.add("interpolator/" + kernel + "/prefilter", [kernel](CBenchmarkState & state) {
+                     interpolator_prefilter(state, kernel);
+              });
+              registry.add("interpolator/" + kernel + "/random", [kernel](CBenchmarkState & state) {
+                     interpolator_random(state, kernel);
+              });
+              registry.add("interpolator/" + kernel + "/rows", [kernel](CBenchmarkState & state) {
+                     interpolator_rows(state, kernel);
+              });
+       }
+});
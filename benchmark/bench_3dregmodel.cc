@@ -0,0 +1,107 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+  Convergence and run-time of the Navier-Lame registration models. The SOR based models
+  navier, naviera, and navierpsse and the multigrid model naviermg solve the same problem
+  with the same stopping parameter. The label reports the relative error of the result
+  with respect to a solution obtained by the multigrid solver with a very small
+  stopping parameter that uses the same discretization as the benchmarked model.
+*/
+
+#include <cmath>
+#include <sstream>
+#include <mia/3d/model.hh>
+#include <benchmark/benchmark.hh>
+
+NS_MIA_USE;
+using std::string;
+
+struct SModelBenchmark {
+       const char *descr;
+       const char *reference;
+};
+
+// the SOR models only run stable for small lambda/mu ratios
+static const SModelBenchmark model_benchmarks[] = {
+       {"navier:mu=1,lambda=1,epsilon=1e-4,iter=2000", "naviermg:mu=1,lambda=1,sor-stencil=1,epsilon=1e-8,iter=50"},
+       {"naviera:mu=1,lambda=1,epsilon=1e-4,iter=2000", "naviermg:mu=1,lambda=1,sor-stencil=1,epsilon=1e-8,iter=50"},
+       {"navierpsse:mu=1,lambda=1,epsilon=1e-4,iter=2000", "naviermg:mu=1,lambda=1,sor-stencil=1,epsilon=1e-8,iter=50"},
+       {"naviermg:mu=1,lambda=1,sor-stencil=1,epsilon=1e-4", "naviermg:mu=1,lambda=1,sor-stencil=1,epsilon=1e-8,iter=50"},
+       {"naviermg:mu=1,lambda=1,epsilon=1e-4", "naviermg:mu=1,lambda=1,epsilon=1e-8,iter=50"}
+};
+
+// the SOR models take too long for the size of the other 3D benchmarks
+static const C3DBounds model_size(33, 33, 33);
+
+static C3DFVectorfield create_force(const C3DBounds& size)
+{
+       C3DFVectorfield b(size);
+       const C3DFVector center(size.x / 2.0f, size.y / 2.0f, size.z / 2.0f);
+       auto ib = b.begin_range(C3DBounds::_1, size - C3DBounds::_1);
+       auto eb = b.end_range(C3DBounds::_1, size - C3DBounds::_1);
+
+       for (; ib != eb; ++ib) {
+              const C3DFVector d = C3DFVector(ib.pos()) - center;
+              const float w = 10.0f * exp(-d.norm2() / 64.0f);
+              *ib = C3DFVector(w * d.y, -w * d.x, 0.5f * w * d.z);
+       }
+
+       return b;
+}
+
+static void solve_model(CBenchmarkState& state, const SModelBenchmark& m)
+{
+       auto model = C3DRegModelPluginHandler::instance().produce(m.descr);
+       const C3DFVectorfield b = create_force(model_size);
+       C3DFVectorfield v(model_size);
+
+       while (state.keep_running()) {
+              std::fill(v.begin(), v.end(), C3DFVector::_0);
+              model->solve(b, v);
+       }
+
+       C3DFVectorfield reference(model_size);
+       C3DRegModelPluginHandler::instance().produce(m.reference)->solve(b, reference);
+       double delta = 0.0;
+       double norm = 0.0;
+
+       for (size_t i = 0; i < v.size(); ++i) {
+              delta += (v[i] - reference[i]).norm2();
+              norm += reference[i].norm2();
+       }
+
+       state.set_items_processed(v.size());
+       std::ostringstream label;
+       label << "rel-error=" << sqrt(delta / norm);
+       state.set_label(label.str());
+}
+
+static CBenchmarkRegistration model_benchmark_registration([](CBenchmarkRegistry & registry)
+{
+       for (auto& m : model_benchmarks) {
+              const string descr(m.descr);
+              const string name = descr.substr(0, descr.find(':'));
+              const string tag = descr.find("sor-stencil") != string::npos ? "/sor-stencil" : "";
+              registry.add("model/" + name + tag, [&m](CBenchmarkState & state) {
+                     solve_model(state, m);
+              });
+       }
+});
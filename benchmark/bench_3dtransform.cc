@@ -0,0 +1,114 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+  3D transformations: transforming an image, evaluating the transformation at all
+  grid points, and translating a gradient vector field to the gradient with respect
+  to the transformation parameters like it is done in each step of the registration.
+*/
+
+#include <random>
+#include <mia/3d/transformfactory.hh>
+#include <benchmark/benchmark.hh>
+#include <benchmark/synthetic.hh>
+
+NS_MIA_USE;
+using std::string;
+
+static const char *benchmark_transforms[] = {
+       "spline:rate=4", "spline:rate=8", "affine", "rigid"
+};
+
+static P3DTransformation create_benchmark_transform(const string& descr)
+{
+       auto creator = C3DTransformCreatorHandler::instance().produce(descr);
+       auto t = creator->create(g_benchmark_3dsize);
+       // a small, reproducible deformation
+       auto params = t->get_parameters();
+       std::mt19937 rng(3);
+       std::uniform_real_distribution<double> delta(-0.01, 0.01);
+
+       for (auto& p : params)
+              p += delta(rng);
+
+       t->set_parameters(params);
+       return t;
+}
+
+static void transform_image(CBenchmarkState& state, const string& descr)
+{
+       auto t = create_benchmark_transform(descr);
+       const C3DFImage image = create_synthetic_3dimage(g_benchmark_3dsize, 1);
+
+       while (state.keep_running())
+              (*t)(image);
+
+       state.set_items_processed(image.size());
+}
+
+static void transform_grid(CBenchmarkState& state, const string& descr)
+{
+       auto t = create_benchmark_transform(descr);
+       C3DFVector sum;
+
+       while (state.keep_running()) {
+              for (auto i = t->begin(), e = t->end(); i != e; ++i)
+                     sum += *i;
+       }
+
+       state.set_items_processed(g_benchmark_3dsize.product());
+
+       if (sum == C3DFVector::_0)
+              state.set_label("zero sum");
+}
+
+static void transform_translate_gradient(CBenchmarkState& state, const string& descr)
+{
+       auto t = create_benchmark_transform(descr);
+       C3DFVectorfield gradient(g_benchmark_3dsize);
+       std::mt19937 rng(4);
+       std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+
+       for (auto& g : gradient)
+              g = C3DFVector(value(rng), value(rng), value(rng));
+
+       CDoubleVector params(t->degrees_of_freedom());
+
+       while (state.keep_running())
+              t->translate(gradient, params);
+
+       state.set_items_processed(gradient.size());
+}
+
+static CBenchmarkRegistration transform_benchmarks([](CBenchmarkRegistry & registry)
+{
+       for (auto d : benchmark_transforms) {
+              const string descr(d);
+              registry.add("transform/" + descr + "/image", [descr](CBenchmarkState & state) {
+                     transform_image(state, descr);
+              });
+              registry.add("transform/" + descr + "/grid", [descr](CBenchmarkState & state) {
+                     transform_grid(state, descr);
+              });
+              registry.add("transform/" + descr + "/translate", [descr](CBenchmarkState & state) {
+                     transform_translate_gradient(state, descr);
+              });
+       }
+});
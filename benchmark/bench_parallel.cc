@@ -0,0 +1,154 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+  Overhead of the parallel loops: an empty loop measures the dispatch cost, the
+  element-wise loops with different block sizes show the cost of the work distribution.
+*/
+
+#include <vector>
+#include <mia/core/parallel.hh>
+#include <benchmark/benchmark.hh>
+
+NS_MIA_USE;
+using std::vector;
+
+static const int n_elements = 1 << 20;
+
+static void pfor_scale(CBenchmarkState& state, int block)
+{
+       vector<float> data(n_elements, 1.0f);
+
+       while (state.keep_running()) {
+              pfor(C1DParallelRange(0, n_elements, block), [&data](const C1DParallelRange & range) {
+                     for (auto i = range.begin(); i != range.end(); ++i)
+                            data[i] *= 1.000001f;
+              });
+       }
+
+       state.set_items_processed(n_elements);
+       state.set_bytes_processed(2.0 * sizeof(float) * n_elements);
+}
+
+/*
+  The default partitioning, i.e. the block size is not given. Running this benchmark
+  with a build that uses TBB and one that uses the C++11 thread pool compares the two
+  back-ends:
+
+  mia-benchmarks -f ^parallel/ -o tbb.json        (build with WITH_TBB=ON)
+  mia-benchmarks -f ^parallel/ -b tbb.json        (build with WITH_TBB=OFF)
+*/
+MIA_BENCHMARK(parallel, pfor_scale_1M_default_block)
+{
+       vector<float> data(n_elements, 1.0f);
+
+       while (state.keep_running()) {
+              pfor(C1DParallelRange(0, n_elements), [&data](const C1DParallelRange & range) {
+                     for (auto i = range.begin(); i != range.end(); ++i)
+                            data[i] *= 1.000001f;
+              });
+       }
+
+       state.set_items_processed(n_elements);
+       state.set_bytes_processed(2.0 * sizeof(float) * n_elements);
+}
+
+static CBenchmarkRegistration pfor_blocks([](CBenchmarkRegistry & registry)
+{
+       for (int block : {
+                     256, 4096, 65536
+              })
+              registry.add("parallel/pfor_scale_1M/block:" + std::to_string(block),
+              [block](CBenchmarkState & state) {
+                     pfor_scale(state, block);
+              });
+});
+
+MIA_BENCHMARK(parallel, pfor_dispatch)
+{
+       vector<int> data(64, 0);
+
+       while (state.keep_running()) {
+              pfor(C1DParallelRange(0, data.size(), 1), [&data](const C1DParallelRange & range) {
+                     for (auto i = range.begin(); i != range.end(); ++i)
+                            ++data[i];
+              });
+       }
+
+       state.set_items_processed(1);
+}
+
+MIA_BENCHMARK(parallel, preduce_sum_1M)
+{
+       vector<float> data(n_elements);
+
+       for (int i = 0; i < n_elements; ++i)
+              data[i] = (i % 1000) * 0.001f;
+
+       double sum = 0.0;
+
+       while (state.keep_running()) {
+              sum += preduce(C1DParallelRange(0, n_elements, 4096), 0.0,
+              [&data](const C1DParallelRange & range, double s) {
+                     for (auto i = range.begin(); i != range.end(); ++i)
+                            s += data[i];
+
+                     return s;
+              },
+              [](double a, double b) {
+                     return a + b;
+              });
+       }
+
+       state.set_items_processed(n_elements);
+       state.set_bytes_processed(sizeof(float) * n_elements);
+
+       if (sum == 0.0)
+              state.set_label("zero sum");
+}
+
+MIA_BENCHMARK(parallel, preduce_ordered_sum_1M)
+{
+       vector<float> data(n_elements);
+
+       for (int i = 0; i < n_elements; ++i)
+              data[i] = (i % 1000) * 0.001f;
+
+       double sum = 0.0;
+
+       while (state.keep_running()) {
+              sum += preduce_ordered(0, n_elements, 4096, 0.0,
+              [&data](const C1DParallelRange & range, double s) {
+                     for (auto i = range.begin(); i != range.end(); ++i)
+                            s += data[i];
+
+                     return s;
+              },
+              [](double a, double b) {
+                     return a + b;
+              });
+       }
+
+       state.set_items_processed(n_elements);
+       state.set_bytes_processed(sizeof(float) * n_elements);
+
+       if (sum == 0.0)
+              state.set_label("zero sum");
+}
@@ -0,0 +1,108 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+  Start-up of a plug-in handler: the 3D filter handler is initialized and one plug-in is
+  requested, once by loading all modules, and once by reading the on-disk plug-in index
+  (see CPluginCache) and loading only the module of the requested plug-in.
+*/
+
+#include <cstdlib>
+#include <boost/filesystem.hpp>
+#include <mia/3d/filter.hh>
+#include <benchmark/benchmark.hh>
+
+NS_MIA_USE;
+using std::string;
+namespace bfs = ::boost::filesystem;
+
+class C3DFilterHandlerStartup: public TPluginHandler<C3DFilterPlugin>
+{
+public:
+       C3DFilterHandlerStartup(const CPluginSearchpath& searchpath)
+       {
+              initialise(searchpath);
+       }
+
+       bool has_plugin(const char *name) const
+       {
+              return plugin(name) != nullptr;
+       }
+};
+
+/*
+  Set MIA_PLUGIN_CACHE for the life time of the object, an empty value disables the cache
+*/
+class CPluginCacheEnvironment
+{
+public:
+       CPluginCacheEnvironment(const string& value):
+              m_had_value(getenv("MIA_PLUGIN_CACHE") != nullptr)
+       {
+              if (m_had_value)
+                     m_old_value = getenv("MIA_PLUGIN_CACHE");
+
+              setenv("MIA_PLUGIN_CACHE", value.c_str(), 1);
+       }
+
+       ~CPluginCacheEnvironment()
+       {
+              if (m_had_value)
+                     setenv("MIA_PLUGIN_CACHE", m_old_value.c_str(), 1);
+              else
+                     unsetenv("MIA_PLUGIN_CACHE");
+       }
+private:
+       bool m_had_value;
+       string m_old_value;
+};
+
+static void handler_startup(CBenchmarkState& state)
+{
+       CPluginSearchpath searchpath;
+
+       while (state.keep_running()) {
+              C3DFilterHandlerStartup handler(searchpath);
+
+              if (!handler.has_plugin("mean")) {
+                     state.skip_with_error("plug-in 'mean' not found");
+                     return;
+              }
+       }
+}
+
+MIA_BENCHMARK(plugins, 3dfilter_handler_scan)
+{
+       CPluginCacheEnvironment environment("none");
+       handler_startup(state);
+}
+
+MIA_BENCHMARK(plugins, 3dfilter_handler_cached)
+{
+       const bfs::path dir = bfs::temp_directory_path() / bfs::unique_path("mia-bench-plugincache-%%%%-%%%%");
+       bfs::create_directories(dir);
+       {
+              CPluginCacheEnvironment environment(dir.string());
+              // the first initialization writes the index
+              C3DFilterHandlerStartup handler((CPluginSearchpath()));
+              handler_startup(state);
+       }
+       bfs::remove_all(dir);
+}
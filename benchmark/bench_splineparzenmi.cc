@@ -0,0 +1,111 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+/*
+  Throughput of the spline Parzen window mutual information: filling the joined
+  histogram and evaluating the gradients for all intensity pairs, without and with
+  a mask, for the bin counts commonly used in registration.
+*/
+
+#include <vector>
+#include <mia/core/splineparzenmi.hh>
+#include <benchmark/benchmark.hh>
+#include <benchmark/synthetic.hh>
+
+NS_MIA_USE;
+using std::string;
+using std::vector;
+
+struct SMIBenchmarkData {
+       SMIBenchmarkData(size_t bins);
+
+       CSplineParzenMI mi;
+       vector<float> ref;
+       vector<float> mov;
+       vector<bool> mask;
+};
+
+SMIBenchmarkData::SMIBenchmarkData(size_t bins):
+       mi(bins, CSplineKernelPluginHandler::instance().produce("bspline:d=3"),
+          bins, CSplineKernelPluginHandler::instance().produce("bspline:d=3"), 0)
+{
+       auto r = create_synthetic_3dimage(g_benchmark_3dsize, 1);
+       auto m = create_synthetic_3dimage(g_benchmark_3dsize, 1, C3DFVector(1.5f, -1.0f, 0.5f));
+       ref.assign(r.begin(), r.end());
+       mov.assign(m.begin(), m.end());
+       mask.resize(ref.size());
+
+       for (size_t i = 0; i < mask.size(); ++i)
+              mask[i] = ref[i] > 64;
+}
+
+static void mi_fill(CBenchmarkState& state, size_t bins, bool masked)
+{
+       SMIBenchmarkData data(bins);
+
+       while (state.keep_running()) {
+              data.mi.reset();
+
+              if (masked)
+                     data.mi.fill(data.mov.begin(), data.mov.end(), data.ref.begin(), data.ref.end(),
+                                  data.mask.begin(), data.mask.end());
+              else
+                     data.mi.fill(data.mov.begin(), data.mov.end(), data.ref.begin(), data.ref.end());
+       }
+
+       state.set_items_processed(data.ref.size());
+       state.set_label("MI=" + std::to_string(data.mi.value()));
+}
+
+static void mi_gradients(CBenchmarkState& state, size_t bins, bool masked)
+{
+       SMIBenchmarkData data(bins);
+       data.mi.fill(data.mov.begin(), data.mov.end(), data.ref.begin(), data.ref.end());
+       vector<double> gradients(data.ref.size());
+
+       while (state.keep_running()) {
+              if (masked)
+                     data.mi.get_gradients(data.mov.begin(), data.mov.end(), data.ref.begin(),
+                                           data.mask.begin(), gradients.begin());
+              else
+                     data.mi.get_gradients(data.mov.begin(), data.mov.end(), data.ref.begin(),
+                                           gradients.begin());
+       }
+
+       state.set_items_processed(data.ref.size());
+}
+
+static CBenchmarkRegistration mi_benchmarks([](CBenchmarkRegistry & registry)
+{
+       for (size_t bins : {
+                     32, 64, 256
+              }) {
+              for (bool masked : {
+                            false, true
+                     }) {
+                     const string suffix = string(masked ? "_masked" : "") + "/bins:" + std::to_string(bins);
+                     registry.add("mi/fill" + suffix, [bins, masked](CBenchmarkState & state) {
+                            mi_fill(state, bins, masked);
+                     });
+                     registry.add("mi/gradients" + suffix, [bins, masked](CBenchmarkState & state) {
+                            mi_gradients(state, bins, masked);
+                     });
+              }
+       }
+});
@@ -0,0 +1,893 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+#include <mia/core/errormacro.hh>
+#include <benchmark/benchmark.hh>
+
+NS_MIA_BEGIN
+
+using std::string;
+using std::vector;
+using std::pair;
+using std::ostream;
+using std::istream;
+using std::map;
+
+CBenchmarkState::CBenchmarkState(size_t max_iterations):
+       m_max_iterations(max_iterations),
+       m_iterations(0),
+       m_started(false),
+       m_running(false),
+       m_cpu_start(0),
+       m_real_time(0.0),
+       m_cpu_time(0.0),
+       m_items(0.0),
+       m_bytes(0.0)
+{
+}
+
+bool CBenchmarkState::keep_running()
+{
+       if (!m_started) {
+              m_started = true;
+              start_timer();
+       }
+
+       if (m_iterations < m_max_iterations && m_error.empty()) {
+              ++m_iterations;
+              return true;
+       }
+
+       if (m_running)
+              stop_timer();
+
+       return false;
+}
+
+void CBenchmarkState::start_timer()
+{
+       m_running = true;
+       m_cpu_start = std::clock();
+       m_real_start = std::chrono::steady_clock::now();
+}
+
+void CBenchmarkState::stop_timer()
+{
+       const auto real_end = std::chrono::steady_clock::now();
+       const auto cpu_end = std::clock();
+       m_real_time += std::chrono::duration<double>(real_end - m_real_start).count();
+       m_cpu_time += static_cast<double>(cpu_end - m_cpu_start) / CLOCKS_PER_SEC;
+       m_running = false;
+}
+
+void CBenchmarkState::pause_timing()
+{
+       if (m_running)
+              stop_timer();
+}
+
+void CBenchmarkState::resume_timing()
+{
+       if (!m_running)
+              start_timer();
+}
+
+void CBenchmarkState::set_items_processed(double items)
+{
+       m_items = items;
+}
+
+void CBenchmarkState::set_bytes_processed(double bytes)
+{
+       m_bytes = bytes;
+}
+
+void CBenchmarkState::set_label(const string& label)
+{
+       m_label = label;
+}
+
+void CBenchmarkState::skip_with_error(const string& message)
+{
+       m_error = message;
+}
+
+size_t CBenchmarkState::iterations() const
+{
+       return m_iterations;
+}
+
+double CBenchmarkState::get_real_time() const
+{
+       return m_real_time;
+}
+
+double CBenchmarkState::get_cpu_time() const
+{
+       return m_cpu_time;
+}
+
+double CBenchmarkState::get_items_processed() const
+{
+       return m_items;
+}
+
+double CBenchmarkState::get_bytes_processed() const
+{
+       return m_bytes;
+}
+
+const string& CBenchmarkState::get_label() const
+{
+       return m_label;
+}
+
+bool CBenchmarkState::has_error() const
+{
+       return !m_error.empty();
+}
+
+const string& CBenchmarkState::get_error() const
+{
+       return m_error;
+}
+
+CBenchmarkRegistry& CBenchmarkRegistry::instance()
+{
+       static CBenchmarkRegistry registry;
+       return registry;
+}
+
+void CBenchmarkRegistry::add(const string& name, FBenchmark run)
+{
+       m_benchmarks.push_back(SBenchmark{name, run});
+}
+
+void CBenchmarkRegistry::add_generator(FGenerator generator)
+{
+       m_generators.push_back(generator);
+}
+
+const vector<SBenchmark>& CBenchmarkRegistry::get_benchmarks()
+{
+       // generators may register further generators
+       while (!m_generators.empty()) {
+              auto generators = std::move(m_generators);
+              m_generators.clear();
+
+              for (auto& g : generators)
+                     g(*this);
+       }
+
+       std::stable_sort(m_benchmarks.begin(), m_benchmarks.end(),
+       [](const SBenchmark & a, const SBenchmark & b) {
+              return a.name < b.name;
+       });
+       return m_benchmarks;
+}
+
+CBenchmarkRegistration::CBenchmarkRegistration(const char *name, FBenchmark run)
+{
+       CBenchmarkRegistry::instance().add(name, run);
+}
+
+CBenchmarkRegistration::CBenchmarkRegistration(CBenchmarkRegistry::FGenerator generator)
+{
+       CBenchmarkRegistry::instance().add_generator(generator);
+}
+
+SBenchmarkResult::SBenchmarkResult():
+       iterations(0),
+       repetitions(0),
+       real_time(0.0),
+       cpu_time(0.0),
+       real_time_min(0.0),
+       real_time_stddev(0.0),
+       items_per_second(0.0),
+       bytes_per_second(0.0),
+       error_occurred(false)
+{
+}
+
+SBenchmarkOptions::SBenchmarkOptions():
+       min_time(0.5),
+       repetitions(3)
+{
+}
+
+static double median(vector<double> v)
+{
+       std::sort(v.begin(), v.end());
+       const size_t n = v.size();
+       return n & 1 ? v[n / 2] : 0.5 * (v[n / 2 - 1] + v[n / 2]);
+}
+
+// upper limit for the iterations, to guard against loops that the compiler removed
+static const size_t max_benchmark_iterations = 1000000000;
+
+SBenchmarkResult run_benchmark(const SBenchmark& benchmark, const SBenchmarkOptions& options)
+{
+       SBenchmarkResult result;
+       result.name = benchmark.name;
+       vector<double> real_times;
+       vector<double> cpu_times;
+       size_t iterations = 1;
+
+       try {
+              // find the number of iterations that makes up for the minimal run time
+              while (true) {
+                     CBenchmarkState state(iterations);
+                     benchmark.run(state);
+
+                     if (state.has_error()) {
+                            result.error_occurred = true;
+                            result.error_message = state.get_error();
+                            return result;
+                     }
+
+                     if (state.iterations() != iterations)
+                            throw create_exception<std::logic_error>("benchmark '", benchmark.name,
+                                          "' didn't run the timed loop");
+
+                     const double t = state.get_real_time();
+
+                     if (t >= options.min_time || iterations >= max_benchmark_iterations) {
+                            real_times.push_back(t / iterations);
+                            cpu_times.push_back(state.get_cpu_time() / iterations);
+                            result.items_per_second = state.get_items_processed();
+                            result.bytes_per_second = state.get_bytes_processed();
+                            result.label = state.get_label();
+                            break;
+                     }
+
+                     // aim at 40% more than required to avoid another round
+                     double multiplier = t > 0.1 * options.min_time ? 1.4 * options.min_time / t : 10.0;
+                     iterations = std::min(max_benchmark_iterations,
+                                           std::max(iterations + 1,
+                                                    static_cast<size_t>(iterations * multiplier)));
+              }
+
+              while (real_times.size() < options.repetitions) {
+                     CBenchmarkState state(iterations);
+                     benchmark.run(state);
+
+                     if (state.has_error()) {
+                            result.error_occurred = true;
+                            result.error_message = state.get_error();
+                            return result;
+                     }
+
+                     real_times.push_back(state.get_real_time() / iterations);
+                     cpu_times.push_back(state.get_cpu_time() / iterations);
+              }
+       } catch (std::exception& x) {
+              result.error_occurred = true;
+              result.error_message = x.what();
+              return result;
+       }
+
+       result.iterations = iterations;
+       result.repetitions = real_times.size();
+       const double real_time = median(real_times);
+       result.real_time = 1e9 * real_time;
+       result.cpu_time = 1e9 * median(cpu_times);
+       result.real_time_min = 1e9 * *std::min_element(real_times.begin(), real_times.end());
+       double sum2 = 0.0;
+
+       for (auto t : real_times)
+              sum2 += (t - real_time) * (t - real_time);
+
+       result.real_time_stddev = real_times.size() > 1 ? 1e9 * std::sqrt(sum2 / (real_times.size() - 1)) : 0.0;
+       // the processed items were given per iteration
+       result.items_per_second = real_time > 0 ? result.items_per_second / real_time : 0.0;
+       result.bytes_per_second = real_time > 0 ? result.bytes_per_second / real_time : 0.0;
+       return result;
+}
+
+const TDictMap<EBenchmarkFormat>::Table benchmark_format_table[] = {
+       {"json", bf_json, "JSON as written by the Google benchmark library"},
+       {"csv", bf_csv, "comma separated values"},
+       {NULL, bf_unknown, ""}
+};
+
+const TDictMap<EBenchmarkFormat> g_benchmark_format_dict(benchmark_format_table);
+
+static string format_time(double ns)
+{
+       static const char *units[] = {"ns", "us", "ms", "s"};
+       int u = 0;
+
+       while (ns >= 10000.0 && u < 3) {
+              ns /= 1000.0;
+              ++u;
+       }
+
+       std::ostringstream s;
+       s << std::fixed << std::setprecision(ns < 100.0 ? 2 : 0) << ns << " " << units[u];
+       return s.str();
+}
+
+static string format_rate(double rate)
+{
+       static const char *units[] = {"", "k", "M", "G", "T"};
+       int u = 0;
+
+       while (rate >= 1000.0 && u < 4) {
+              rate /= 1000.0;
+              ++u;
+       }
+
+       std::ostringstream s;
+       s << std::fixed << std::setprecision(2) << rate << units[u];
+       return s.str();
+}
+
+void print_benchmark_header(ostream& os)
+{
+       os << std::left << std::setw(48) << "Benchmark" << std::right
+          << std::setw(14) << "Time" << std::setw(14) << "CPU"
+          << std::setw(12) << "Iterations" << "  Throughput\n"
+          << string(110, '-') << "\n";
+}
+
+void print_benchmark_result(ostream& os, const SBenchmarkResult& result)
+{
+       os << std::left << std::setw(48) << result.name << std::right;
+
+       if (result.error_occurred) {
+              os << "  SKIPPED: " << result.error_message << "\n";
+              return;
+       }
+
+       os << std::setw(14) << format_time(result.real_time)
+          << std::setw(14) << format_time(result.cpu_time)
+          << std::setw(12) << result.iterations << "  ";
+
+       if (result.bytes_per_second > 0)
+              os << format_rate(result.bytes_per_second) << "B/s ";
+
+       if (result.items_per_second > 0)
+              os << format_rate(result.items_per_second) << " items/s ";
+
+       os << result.label << "\n";
+}
+
+static void write_json_string(ostream& os, const string& s)
+{
+       os << '"';
+
+       for (auto c : s) {
+              switch (c) {
+              case '"':
+                     os << "\\\"";
+                     break;
+
+              case '\\':
+                     os << "\\\\";
+                     break;
+
+              case '\n':
+                     os << "\\n";
+                     break;
+
+              case '\t':
+                     os << "\\t";
+                     break;
+
+              default:
+                     if (static_cast<unsigned char>(c) < 0x20)
+                            os << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+                               << static_cast<int>(c) << std::dec << std::setfill(' ');
+                     else
+                            os << c;
+              }
+       }
+
+       os << '"';
+}
+
+void write_benchmark_json(ostream& os, const vector<SBenchmarkResult>& results,
+                          const vector<pair<string, string>>& context)
+{
+       const auto flags = os.flags();
+       const auto precision = os.precision();
+       os << std::setprecision(12);
+       os << "{\n  \"context\": {";
+       bool first = true;
+
+       for (auto& c : context) {
+              os << (first ? "\n    " : ",\n    ");
+              write_json_string(os, c.first);
+              os << ": ";
+              write_json_string(os, c.second);
+              first = false;
+       }
+
+       os << "\n  },\n  \"benchmarks\": [";
+       first = true;
+
+       for (auto& r : results) {
+              os << (first ? "\n" : ",\n") << "    {\n      \"name\": ";
+              write_json_string(os, r.name);
+              os << ",\n      \"run_name\": ";
+              write_json_string(os, r.name);
+              os << ",\n      \"run_type\": \"iteration\"";
+
+              if (r.error_occurred) {
+                     os << ",\n      \"error_occurred\": true,\n      \"error_message\": ";
+                     write_json_string(os, r.error_message);
+              } else {
+                     os << ",\n      \"repetitions\": " << r.repetitions
+                        << ",\n      \"iterations\": " << r.iterations
+                        << ",\n      \"real_time\": " << r.real_time
+                        << ",\n      \"cpu_time\": " << r.cpu_time
+                        << ",\n      \"real_time_min\": " << r.real_time_min
+                        << ",\n      \"real_time_stddev\": " << r.real_time_stddev
+                        << ",\n      \"time_unit\": \"ns\"";
+
+                     if (r.items_per_second > 0)
+                            os << ",\n      \"items_per_second\": " << r.items_per_second;
+
+                     if (r.bytes_per_second > 0)
+                            os << ",\n      \"bytes_per_second\": " << r.bytes_per_second;
+
+                     if (!r.label.empty()) {
+                            os << ",\n      \"label\": ";
+                            write_json_string(os, r.label);
+                     }
+              }
+
+              os << "\n    }";
+              first = false;
+       }
+
+       os << "\n  ]\n}\n";
+       os.flags(flags);
+       os.precision(precision);
+}
+
+static string csv_string(const string& s)
+{
+       string result("\"");
+
+       for (auto c : s) {
+              if (c == '"')
+                     result.push_back('"');
+
+              result.push_back(c);
+       }
+
+       result.push_back('"');
+       return result;
+}
+
+void write_benchmark_csv(ostream& os, const vector<SBenchmarkResult>& results)
+{
+       const auto precision = os.precision();
+       os << std::setprecision(12);
+       os << "name,iterations,real_time,cpu_time,time_unit,bytes_per_second,items_per_second,"
+          "label,error_occurred,error_message\n";
+
+       for (auto& r : results) {
+              os << csv_string(r.name) << ",";
+
+              if (r.error_occurred)
+                     os << ",,,,,,," << "true," << csv_string(r.error_message) << "\n";
+              else
+                     os << r.iterations << "," << r.real_time << "," << r.cpu_time << ",ns,"
+                        << r.bytes_per_second << "," << r.items_per_second << ","
+                        << csv_string(r.label) << ",,\n";
+       }
+
+       os.precision(precision);
+}
+
+namespace {
+
+/*
+  A minimal JSON reader that is just good enough to read back benchmark results.
+*/
+struct SJsonValue {
+       enum EType {jt_null, jt_bool, jt_number, jt_string, jt_array, jt_object};
+
+       SJsonValue(): type(jt_null), number(0.0) {}
+
+       const SJsonValue *get(const string& key) const;
+
+       EType type;
+       double number;
+       string str;
+       vector<SJsonValue> array;
+       vector<pair<string, SJsonValue>> object;
+};
+
+const SJsonValue *SJsonValue::get(const string& key) const
+{
+       for (auto& kv : object)
+              if (kv.first == key)
+                     return &kv.second;
+
+       return nullptr;
+}
+
+class CJsonReader
+{
+public:
+       CJsonReader(const string& text): m_text(text), m_pos(0) {}
+       SJsonValue read_document();
+private:
+       SJsonValue read_value();
+       string read_string();
+       double read_number();
+       void skip_space();
+       void expect(char c);
+       void expect_word(const char *word);
+       char peek();
+
+       const string& m_text;
+       size_t m_pos;
+};
+
+SJsonValue CJsonReader::read_document()
+{
+       SJsonValue result = read_value();
+       skip_space();
+
+       if (m_pos != m_text.size())
+              throw create_exception<std::invalid_argument>("JSON: unexpected content at position ", m_pos);
+
+       return result;
+}
+
+char CJsonReader::peek()
+{
+       skip_space();
+
+       if (m_pos >= m_text.size())
+              throw create_exception<std::invalid_argument>("JSON: unexpected end of input");
+
+       return m_text[m_pos];
+}
+
+void CJsonReader::skip_space()
+{
+       while (m_pos < m_text.size() && isspace(static_cast<unsigned char>(m_text[m_pos])))
+              ++m_pos;
+}
+
+void CJsonReader::expect(char c)
+{
+       if (peek() != c)
+              throw create_exception<std::invalid_argument>("JSON: expected '", c, "' at position ", m_pos);
+
+       ++m_pos;
+}
+
+void CJsonReader::expect_word(const char *word)
+{
+       const string w(word);
+
+       if (m_text.compare(m_pos, w.size(), w) != 0)
+              throw create_exception<std::invalid_argument>("JSON: expected '", w, "' at position ", m_pos);
+
+       m_pos += w.size();
+}
+
+SJsonValue CJsonReader::read_value()
+{
+       SJsonValue result;
+
+       switch (peek()) {
+       case '{':
+              result.type = SJsonValue::jt_object;
+              ++m_pos;
+
+              if (peek() == '}') {
+                     ++m_pos;
+                     break;
+              }
+
+              while (true) {
+                     if (peek() != '"')
+                            throw create_exception<std::invalid_argument>("JSON: expected key at position ", m_pos);
+
+                     string key = read_string();
+                     expect(':');
+                     result.object.push_back(make_pair(key, read_value()));
+
+                     if (peek() == ',') {
+                            ++m_pos;
+                            continue;
+                     }
+
+                     expect('}');
+                     break;
+              }
+
+              break;
+
+       case '[':
+              result.type = SJsonValue::jt_array;
+              ++m_pos;
+
+              if (peek() == ']') {
+                     ++m_pos;
+                     break;
+              }
+
+              while (true) {
+                     result.array.push_back(read_value());
+
+                     if (peek() == ',') {
+                            ++m_pos;
+                            continue;
+                     }
+
+                     expect(']');
+                     break;
+              }
+
+              break;
+
+       case '"':
+              result.type = SJsonValue::jt_string;
+              result.str = read_string();
+              break;
+
+       case 't':
+              expect_word("true");
+              result.type = SJsonValue::jt_bool;
+              result.number = 1.0;
+              break;
+
+       case 'f':
+              expect_word("false");
+              result.type = SJsonValue::jt_bool;
+              break;
+
+       case 'n':
+              expect_word("null");
+              break;
+
+       default:
+              result.type = SJsonValue::jt_number;
+              result.number = read_number();
+       }
+
+       return result;
+}
+
+string CJsonReader::read_string()
+{
+       expect('"');
+       string result;
+
+       while (m_pos < m_text.size() && m_text[m_pos] != '"') {
+              char c = m_text[m_pos++];
+
+              if (c == '\\') {
+                     if (m_pos >= m_text.size())
+                            break;
+
+                     c = m_text[m_pos++];
+
+                     switch (c) {
+                     case 'n':
+                            result.push_back('\n');
+                            break;
+
+                     case 't':
+                            result.push_back('\t');
+                            break;
+
+                     case 'r':
+                            result.push_back('\r');
+                            break;
+
+                     case 'b':
+                            result.push_back('\b');
+                            break;
+
+                     case 'f':
+                            result.push_back('\f');
+                            break;
+
+                     case 'u': {
+                            // only code points < 0x80 are written by the benchmark tools
+                            unsigned code = std::stoul(m_text.substr(m_pos, 4), nullptr, 16);
+                            m_pos += 4;
+                            result.push_back(code < 0x80 ? static_cast<char>(code) : '?');
+                            break;
+                     }
+
+                     default:
+                            result.push_back(c);
+                     }
+              } else
+                     result.push_back(c);
+       }
+
+       if (m_pos >= m_text.size())
+              throw create_exception<std::invalid_argument>("JSON: unterminated string");
+
+       ++m_pos;
+       return result;
+}
+
+double CJsonReader::read_number()
+{
+       const char *start = m_text.c_str() + m_pos;
+       char *end = nullptr;
+       const double result = strtod(start, &end);
+
+       if (end == start)
+              throw create_exception<std::invalid_argument>("JSON: unexpected character '", *start,
+                            "' at position ", m_pos);
+
+       m_pos += end - start;
+       return result;
+}
+
+double time_unit_to_ns(const string& unit)
+{
+       if (unit == "ns")
+              return 1.0;
+
+       if (unit == "us")
+              return 1e3;
+
+       if (unit == "ms")
+              return 1e6;
+
+       if (unit == "s")
+              return 1e9;
+
+       throw create_exception<std::invalid_argument>("JSON: unknown time unit '", unit, "'");
+}
+
+double get_number(const SJsonValue& v, const char *key)
+{
+       auto p = v.get(key);
+       return p && p->type == SJsonValue::jt_number ? p->number : 0.0;
+}
+
+string get_string(const SJsonValue& v, const char *key)
+{
+       auto p = v.get(key);
+       return p && p->type == SJsonValue::jt_string ? p->str : string();
+}
+
+} // namespace
+
+vector<SBenchmarkResult> read_benchmark_json(istream& is)
+{
+       const string text((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+       const SJsonValue doc = CJsonReader(text).read_document();
+       auto benchmarks = doc.get("benchmarks");
+
+       if (!benchmarks || benchmarks->type != SJsonValue::jt_array)
+              throw create_exception<std::invalid_argument>("JSON: no 'benchmarks' list found");
+
+       vector<SBenchmarkResult> results;
+
+       for (auto& b : benchmarks->array) {
+              SBenchmarkResult r;
+              r.name = get_string(b, "name");
+
+              // repeated runs of the Google benchmark library report each run and aggregates
+              if (get_string(b, "run_type") == "aggregate") {
+                     if (get_string(b, "aggregate_name") != "median")
+                            continue;
+
+                     r.name = get_string(b, "run_name");
+              } else if (b.get("repetition_index") && get_number(b, "repetitions") > 1)
+                     continue;
+
+              auto error = b.get("error_occurred");
+
+              if (error && error->type == SJsonValue::jt_bool && error->number != 0.0) {
+                     r.error_occurred = true;
+                     r.error_message = get_string(b, "error_message");
+              } else {
+                     const double scale = time_unit_to_ns(get_string(b, "time_unit"));
+                     r.iterations = static_cast<size_t>(get_number(b, "iterations"));
+                     r.repetitions = std::max(1.0, get_number(b, "repetitions"));
+                     r.real_time = scale * get_number(b, "real_time");
+                     r.cpu_time = scale * get_number(b, "cpu_time");
+                     r.real_time_min = scale * get_number(b, "real_time_min");
+                     r.real_time_stddev = scale * get_number(b, "real_time_stddev");
+                     r.items_per_second = get_number(b, "items_per_second");
+                     r.bytes_per_second = get_number(b, "bytes_per_second");
+                     r.label = get_string(b, "label");
+              }
+
+              results.push_back(r);
+       }
+
+       return results;
+}
+
+size_t compare_benchmark_results(ostream& os, const vector<SBenchmarkResult>& baseline,
+                                 const vector<SBenchmarkResult>& current, double threshold)
+{
+       map<string, const SBenchmarkResult *> base_map;
+
+       for (auto& b : baseline)
+              base_map[b.name] = &b;
+
+       size_t regressions = 0;
+       const auto flags = os.flags();
+       const auto precision = os.precision();
+       os << std::left << std::setw(48) << "Benchmark" << std::right
+          << std::setw(14) << "Baseline" << std::setw(14) << "Current"
+          << std::setw(10) << "Change" << "\n" << string(96, '-') << "\n";
+
+       for (auto& c : current) {
+              os << std::left << std::setw(48) << c.name << std::right;
+              auto ib = base_map.find(c.name);
+
+              if (ib == base_map.end()) {
+                     os << std::setw(14) << "-" << std::setw(14) << format_time(c.real_time) << "  new\n";
+                     continue;
+              }
+
+              const SBenchmarkResult& b = *ib->second;
+              base_map.erase(ib);
+
+              if (b.error_occurred || c.error_occurred) {
+                     os << std::setw(14) << (b.error_occurred ? string("skipped") : format_time(b.real_time))
+                        << std::setw(14) << (c.error_occurred ? string("skipped") : format_time(c.real_time))
+                        << "\n";
+                     continue;
+              }
+
+              const double change = b.real_time > 0 ? (c.real_time - b.real_time) / b.real_time : 0.0;
+              os << std::setw(14) << format_time(b.real_time) << std::setw(14) << format_time(c.real_time)
+                 << std::setw(9) << std::showpos << std::fixed << std::setprecision(1) << 100.0 * change
+                 << std::noshowpos << "%";
+
+              if (change > threshold) {
+                     os << "  REGRESSION";
+                     ++regressions;
+              } else if (change < -threshold)
+                     os << "  improved";
+
+              os << "\n";
+       }
+
+       for (auto& b : base_map)
+              os << std::left << std::setw(48) << b.first << std::right << std::setw(14)
+                 << (b.second->error_occurred ? string("skipped") : format_time(b.second->real_time))
+                 << std::setw(14) << "-" << "  removed\n";
+
+       os.flags(flags);
+       os.precision(precision);
+       return regressions;
+}
+
+NS_MIA_END
@@ -0,0 +1,294 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef mia_benchmark_benchmark_hh
+#define mia_benchmark_benchmark_hh
+
+#include <chrono>
+#include <ctime>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <mia/core/defines.hh>
+#include <mia/core/dictmap.hh>
+
+NS_MIA_BEGIN
+
+/**
+   \brief Controls the timed loop of a benchmark
+
+   A benchmark function does its set-up, then runs the code to be measured in a loop
+
+   \code
+   while (state.keep_running())
+          do_something();
+   \endcode
+
+   The time is only taken from the first call to keep_running() until the loop ends,
+   and the number of iterations is decided by the benchmark runner.
+ */
+class CBenchmarkState
+{
+public:
+       /**
+          \param max_iterations number of iterations the loop will run
+        */
+       CBenchmarkState(size_t max_iterations);
+
+       /// \returns true as long as more iterations should be run
+       bool keep_running();
+
+       /// Stop the timer, e.g. to exclude the re-initialization of data from the measurement
+       void pause_timing();
+
+       /// Restart the timer after pause_timing()
+       void resume_timing();
+
+       /// Set the number of items that are processed in one iteration
+       void set_items_processed(double items);
+
+       /// Set the number of bytes that are processed in one iteration
+       void set_bytes_processed(double bytes);
+
+       /// Set a label that is reported together with the results
+       void set_label(const std::string& label);
+
+       /**
+          Mark the benchmark as failed, e.g. because a required plug-in is not available.
+          The timed loop will not be entered or will be left at the next iteration.
+        */
+       void skip_with_error(const std::string& message);
+
+       /// \returns the number of iterations run so far
+       size_t iterations() const;
+
+       /// \returns the measured wall clock time in seconds
+       double get_real_time() const;
+
+       /// \returns the measured process CPU time in seconds
+       double get_cpu_time() const;
+
+       /// \returns the items processed per iteration
+       double get_items_processed() const;
+
+       /// \returns the bytes processed per iteration
+       double get_bytes_processed() const;
+
+       /// \returns the label
+       const std::string& get_label() const;
+
+       /// \returns true if the benchmark was skipped
+       bool has_error() const;
+
+       /// \returns the reason why the benchmark was skipped
+       const std::string& get_error() const;
+private:
+       void start_timer();
+       void stop_timer();
+
+       size_t m_max_iterations;
+       size_t m_iterations;
+       bool m_started;
+       bool m_running;
+       std::chrono::steady_clock::time_point m_real_start;
+       std::clock_t m_cpu_start;
+       double m_real_time;
+       double m_cpu_time;
+       double m_items;
+       double m_bytes;
+       std::string m_label;
+       std::string m_error;
+};
+
+/// type of a benchmark function
+typedef std::function<void(CBenchmarkState& state)> FBenchmark;
+
+/// a named benchmark
+struct SBenchmark {
+       /// name used for reporting and filtering
+       std::string name;
+       /// the benchmark function
+       FBenchmark run;
+};
+
+/**
+   \brief The list of all available benchmarks
+
+   Benchmarks are registered at program start-up through CBenchmarkRegistration.
+   Benchmarks that depend on the available plug-ins are added by generators
+   that are run when the list is requested for the first time, i.e. after
+   the plug-in search path has been set up.
+ */
+class CBenchmarkRegistry
+{
+public:
+       /// a function that adds a set of benchmarks
+       typedef std::function<void(CBenchmarkRegistry& registry)> FGenerator;
+
+       /// \returns the registry
+       static CBenchmarkRegistry& instance();
+
+       /**
+          Add a benchmark
+          \param name unique name of the benchmark
+          \param run the benchmark function
+        */
+       void add(const std::string& name, FBenchmark run);
+
+       /// Add a generator for a set of benchmarks
+       void add_generator(FGenerator generator);
+
+       /// \returns all registered benchmarks sorted by name
+       const std::vector<SBenchmark>& get_benchmarks();
+private:
+       CBenchmarkRegistry() = default;
+       std::vector<SBenchmark> m_benchmarks;
+       std::vector<FGenerator> m_generators;
+};
+
+/**
+   \brief Helper to register benchmarks from static initializers
+ */
+struct CBenchmarkRegistration {
+       /// register one benchmark
+       CBenchmarkRegistration(const char *name, FBenchmark run);
+
+       /// register a benchmark generator
+       CBenchmarkRegistration(CBenchmarkRegistry::FGenerator generator);
+};
+
+/**
+   Define and register a benchmark function that is reported as "group/name"
+   \param group the group of the benchmark
+   \param name the name of the benchmark within the group
+ */
+#define MIA_BENCHMARK(group, name)                                      \
+       static void group ## _ ## name(::mia::CBenchmarkState& state);   \
+       static ::mia::CBenchmarkRegistration group ## _ ## name ## _registration(#group "/" #name, \
+                     group ## _ ## name);                               \
+       static void group ## _ ## name(::mia::CBenchmarkState& state)
+
+/// The measurement of one benchmark
+struct SBenchmarkResult {
+       SBenchmarkResult();
+
+       /// name of the benchmark
+       std::string name;
+       /// number of iterations per repetition
+       size_t iterations;
+       /// number of repetitions
+       size_t repetitions;
+       /// median of the wall clock time per iteration in nano seconds
+       double real_time;
+       /// median of the CPU time per iteration in nano seconds
+       double cpu_time;
+       /// minimum of the wall clock time per iteration in nano seconds
+       double real_time_min;
+       /// standard deviation of the wall clock time per iteration in nano seconds
+       double real_time_stddev;
+       /// processed items per second of wall clock time (0 if not given)
+       double items_per_second;
+       /// processed bytes per second of wall clock time (0 if not given)
+       double bytes_per_second;
+       /// label set by the benchmark
+       std::string label;
+       /// true if the benchmark could not be run
+       bool error_occurred;
+       /// the reason why the benchmark could not be run
+       std::string error_message;
+};
+
+/// options of the benchmark runner
+struct SBenchmarkOptions {
+       SBenchmarkOptions();
+
+       /// minimal wall clock time in seconds for one repetition
+       double min_time;
+       /// number of repetitions that are used to obtain the statistics
+       size_t repetitions;
+};
+
+/**
+   Run a benchmark: the number of iterations is increased until one repetition runs at
+   least options.min_time seconds, and then the measurement is repeated to obtain
+   median, minimum and the standard deviation of the time per iteration.
+   Exceptions thrown by the benchmark are reported as errors in the result.
+   \param benchmark
+   \param options
+   \returns the measurement
+ */
+SBenchmarkResult run_benchmark(const SBenchmark& benchmark, const SBenchmarkOptions& options);
+
+/// the machine readable output formats
+enum EBenchmarkFormat {
+       bf_json, /**< JSON as written by the Google benchmark library */
+       bf_csv,  /**< comma separated values */
+       bf_unknown
+};
+
+/// dictionary for the output formats
+extern const TDictMap<EBenchmarkFormat> g_benchmark_format_dict;
+
+/// Print the header line of the human readable result table
+void print_benchmark_header(std::ostream& os);
+
+/// Print a measurement as a line of the human readable result table
+void print_benchmark_result(std::ostream& os, const SBenchmarkResult& result);
+
+/**
+   Write the measurements in JSON format. The layout follows the output of the
+   Google benchmark library, so that its tools can be used to evaluate the results.
+   \param os output stream
+   \param results the measurements
+   \param context additional key-value pairs that describe the environment
+ */
+void write_benchmark_json(std::ostream& os, const std::vector<SBenchmarkResult>& results,
+                          const std::vector<std::pair<std::string, std::string>>& context);
+
+/// Write the measurements as comma separated values
+void write_benchmark_csv(std::ostream& os, const std::vector<SBenchmarkResult>& results);
+
+/**
+   Read measurements that were written by write_benchmark_json or by the Google benchmark
+   library. For repeated runs of the latter, the median aggregates are used.
+   \param is input stream
+   \returns the measurements
+ */
+std::vector<SBenchmarkResult> read_benchmark_json(std::istream& is);
+
+/**
+   Compare measurements against a baseline and print a table of the relative changes
+   of the wall clock time per iteration.
+   \param os output stream for the table
+   \param baseline the reference measurements
+   \param current the new measurements
+   \param threshold relative slow-down (e.g. 0.1 for 10%) above that a benchmark is
+   reported as regression
+   \returns the number of regressions
+ */
+size_t compare_benchmark_results(std::ostream& os, const std::vector<SBenchmarkResult>& baseline,
+                                 const std::vector<SBenchmarkResult>& current, double threshold);
+
+NS_MIA_END
+
+#endif
@@ -0,0 +1,207 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+#ifdef MIA_USE_BOOST_REGEX
+#include <boost/regex.hpp>
+using boost::regex;
+using boost::regex_search;
+#else
+#include <regex>
+using std::regex;
+using std::regex_search;
+#endif
+
+#include <mia/core/cmdlineparser.hh>
+#include <mia/core/msgstream.hh>
+#include <mia/core/parallel.hh>
+#include <mia/core/plugin_base.hh>
+#include <benchmark/benchmark.hh>
+
+NS_MIA_USE;
+using namespace std;
+
+const SProgramDescription g_description = {
+       {pdi_group, "Miscellaneous programs"},
+       {pdi_short, "Run the performance benchmarks of the MIA core kernels"},
+       {
+              pdi_description, "This program runs micro benchmarks of the core kernels of MIA, i.e. "
+              "interpolation, spline transformations, the 3D cost function and filter plug-ins, "
+              "the parallel loops, and the 3D image IO plug-ins. All benchmarks work on synthetic data "
+              "that is created with fixed seeds, so that the results are reproducible. "
+              "The number of iterations of each benchmark is adjusted so that one run takes at least "
+              "the given minimal time, and the reported time per iteration is the median over the "
+              "repetitions. The results can be written in a machine readable format and be compared "
+              "against the results of an earlier run to track the performance across releases. "
+              "If the environment variable MIA_PLUGIN_TESTPATH is not set, the plug-ins of the build "
+              "tree are used."
+       },
+       {pdi_example_descr, "Run all cost function benchmarks, store the results in cost.json, and compare "
+        "them to the results stored in baseline.json, reporting slow-downs of more than 5%."},
+       {pdi_example_code, "-f ^cost/ -o cost.json -b baseline.json --threshold 0.05"}
+};
+
+static vector<pair<string, string>> get_context(const SBenchmarkOptions& options)
+{
+       vector<pair<string, string>> context;
+       char date[64];
+       const time_t now = time(nullptr);
+       strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+       context.push_back(make_pair("date", string(date)));
+       context.push_back(make_pair("executable", string("mia-benchmarks")));
+       context.push_back(make_pair("mia_version", string(PACKAGE_VERSION)));
+       context.push_back(make_pair("num_cpus", to_string(std::thread::hardware_concurrency())));
+#ifdef HAVE_TBB
+       context.push_back(make_pair("parallel_backend", string("tbb")));
+#else
+       context.push_back(make_pair("parallel_backend", string("c++11")));
+       context.push_back(make_pair("num_threads", to_string(CMaxTasks::get_max_tasks())));
+#endif
+#ifdef NDEBUG
+       context.push_back(make_pair("library_build_type", string("release")));
+#else
+       context.push_back(make_pair("library_build_type", string("debug")));
+#endif
+       context.push_back(make_pair("min_time", to_string(options.min_time)));
+       context.push_back(make_pair("repetitions", to_string(options.repetitions)));
+       return context;
+}
+
+static vector<SBenchmarkResult> load_results(const string& filename)
+{
+       ifstream is(filename);
+
+       if (!is.good())
+              throw create_exception<runtime_error>("Unable to open '", filename, "' for reading");
+
+       return read_benchmark_json(is);
+}
+
+int do_main(int argc, char *argv[])
+{
+       string filter;
+       bool list_only = false;
+       SBenchmarkOptions bench_options;
+       int repetitions = bench_options.repetitions;
+       string out_filename;
+       EBenchmarkFormat out_format = bf_json;
+       string baseline_filename;
+       string results_filename;
+       float threshold = 0.1;
+       CCmdOptionList options(g_description);
+       options.set_group("Selection");
+       options.add(make_opt(filter, "filter", 'f', "Only run the benchmarks whose name matches this "
+                            "regular expression (default: run all)"));
+       options.add(make_opt(list_only, "list", 'l', "List the available benchmarks and exit"));
+       options.set_group("Measurement");
+       options.add(make_opt(bench_options.min_time, EParameterBounds::bf_min_open, {0.0}, "min-time", 't',
+                            "Minimal run time in seconds of one repetition of a benchmark"));
+       options.add(make_opt(repetitions, EParameterBounds::bf_min_closed, {1}, "repetitions", 'r',
+                            "Number of repetitions of each benchmark"));
+       options.set_group("Output");
+       options.add(make_opt(out_filename, "out-file", 'o', "Write the results in a machine readable "
+                            "format to this file", CCmdOptionFlags::output));
+       options.add(make_opt(out_format, g_benchmark_format_dict, "format", 0,
+                            "Format of the result file"));
+       options.set_group("Comparison");
+       options.add(make_opt(baseline_filename, "baseline", 'b', "Compare the results to the results "
+                            "stored in this file (JSON format)", CCmdOptionFlags::input));
+       options.add(make_opt(results_filename, "results", 0, "Don't run the benchmarks, but read the "
+                            "results from this file (JSON format), e.g. to compare two stored runs",
+                            CCmdOptionFlags::input));
+       options.add(make_opt(threshold, EParameterBounds::bf_min_closed, {0.0}, "threshold", 0,
+                            "Relative slow-down above that a benchmark is reported as regression. "
+                            "The program fails if a regression is found."));
+
+       if (options.parse(argc, argv) != CCmdOptionList::hr_no)
+              return EXIT_SUCCESS;
+
+       bench_options.repetitions = repetitions;
+
+       // benchmark the plug-ins of the build tree unless requested otherwise
+       unique_ptr<PrepareTestPluginPath> plugin_path;
+
+       if (!getenv("MIA_PLUGIN_TESTPATH"))
+              plugin_path.reset(new PrepareTestPluginPath);
+
+       vector<SBenchmarkResult> results;
+
+       if (!results_filename.empty()) {
+              results = load_results(results_filename);
+       } else {
+              const regex select(filter);
+              auto& benchmarks = CBenchmarkRegistry::instance().get_benchmarks();
+
+              if (list_only) {
+                     for (auto& b : benchmarks)
+                            if (regex_search(b.name, select))
+                                   cout << b.name << "\n";
+
+                     return EXIT_SUCCESS;
+              }
+
+              print_benchmark_header(cout);
+
+              for (auto& b : benchmarks) {
+                     if (!regex_search(b.name, select))
+                            continue;
+
+                     results.push_back(run_benchmark(b, bench_options));
+                     print_benchmark_result(cout, results.back());
+              }
+       }
+
+       if (!out_filename.empty()) {
+              ofstream os(out_filename);
+
+              if (out_format == bf_csv)
+                     write_benchmark_csv(os, results);
+              else
+                     write_benchmark_json(os, results, get_context(bench_options));
+
+              if (!os.good())
+                     throw create_exception<runtime_error>("Unable to write results to '", out_filename, "'");
+       }
+
+       if (!baseline_filename.empty()) {
+              cout << "\nComparison to " << baseline_filename << ":\n";
+              const size_t regressions = compare_benchmark_results(cout, load_results(baseline_filename),
+                                         results, threshold);
+
+              if (regressions > 0) {
+                     cerr << regressions << " benchmark(s) are more than " << 100 * threshold
+                          << "% slower than the baseline\n";
+                     return EXIT_FAILURE;
+              }
+       }
+
+       return EXIT_SUCCESS;
+}
+
+#include <mia/internal/main.hh>
+MIA_MAIN(do_main);
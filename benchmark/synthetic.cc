@@ -0,0 +1,134 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cmath>
+#include <random>
+
+#include <mia/core/errormacro.hh>
+#include <benchmark/synthetic.hh>
+
+NS_MIA_BEGIN
+
+using std::vector;
+
+const C3DBounds g_benchmark_3dsize(64, 64, 64);
+
+struct SBlob {
+       C3DFVector center;
+       float inv_width2;
+       float amplitude;
+};
+
+C3DFImage create_synthetic_3dimage(const C3DBounds& size, unsigned seed, const C3DFVector& shift)
+{
+       // the std::mt19937 output is defined by the standard, other than the distributions
+       std::mt19937 rng(seed);
+       auto uniform = [&rng](float low, float high) {
+              return low + (high - low) * static_cast<float>(rng() - rng.min()) /
+                     static_cast<float>(rng.max() - rng.min());
+       };
+       vector<SBlob> blobs(12);
+
+       for (auto& b : blobs) {
+              b.center = C3DFVector(uniform(0.2, 0.8) * size.x, uniform(0.2, 0.8) * size.y,
+                                    uniform(0.2, 0.8) * size.z) + shift;
+              const float width = uniform(0.05, 0.15) * size.x;
+              b.inv_width2 = 1.0f / (2.0f * width * width);
+              b.amplitude = uniform(60, 180);
+       }
+
+       C3DFImage result(size);
+       auto r = result.begin();
+
+       for (unsigned z = 0; z < size.z; ++z)
+              for (unsigned y = 0; y < size.y; ++y)
+                     for (unsigned x = 0; x < size.x; ++x, ++r) {
+                            const C3DFVector p(x, y, z);
+                            float v = 20.0f + uniform(-10, 10);
+
+                            for (auto& b : blobs)
+                                   v += b.amplitude * std::exp(-(p - b.center).norm2() * b.inv_width2);
+
+                            *r = std::min(255.0f, v);
+                     }
+
+       return result;
+}
+
+template <typename T>
+static P3DImage convert_synthetic(const C3DFImage& image)
+{
+       T3DImage<T> *result = new T3DImage<T>(image.get_size());
+       std::transform(image.begin(), image.end(), result->begin(), [](float x) {
+              return static_cast<T>(x);
+       });
+       return P3DImage(result);
+}
+
+P3DImage create_synthetic_3dimage(const C3DBounds& size, EPixelType type, unsigned seed)
+{
+       const C3DFImage image = create_synthetic_3dimage(size, seed);
+
+       switch (type) {
+       case it_bit: {
+              C3DBitImage *result = new C3DBitImage(size);
+              std::transform(image.begin(), image.end(), result->begin(), [](float x) {
+                     return x >= 128.0f;
+              });
+              return P3DImage(result);
+       }
+
+       case it_sbyte:
+              return convert_synthetic<int8_t>(image);
+
+       case it_ubyte:
+              return convert_synthetic<uint8_t>(image);
+
+       case it_sshort:
+              return convert_synthetic<int16_t>(image);
+
+       case it_ushort:
+              return convert_synthetic<uint16_t>(image);
+
+       case it_sint:
+              return convert_synthetic<int32_t>(image);
+
+       case it_uint:
+              return convert_synthetic<uint32_t>(image);
+
+       case it_slong:
+              return convert_synthetic<int64_t>(image);
+
+       case it_ulong:
+              return convert_synthetic<uint64_t>(image);
+
+       case it_float:
+              return P3DImage(new C3DFImage(image));
+
+       case it_double:
+              return convert_synthetic<double>(image);
+
+       default:
+              throw create_exception<std::invalid_argument>("create_synthetic_3dimage: unsupported pixel type ",
+                            static_cast<int>(type));
+       }
+}
+
+NS_MIA_END
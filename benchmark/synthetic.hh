@@ -0,0 +1,55 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef mia_benchmark_synthetic_hh
+#define mia_benchmark_synthetic_hh
+
+#include <mia/3d/image.hh>
+
+NS_MIA_BEGIN
+
+/// the size of the images the 3D benchmarks work on
+extern const C3DBounds g_benchmark_3dsize;
+
+/**
+   Create a reproducible test image: a number of Gaussian blobs with random centers
+   and widths on top of uniform noise, with intensities in the range [0, 255].
+   \param size image size
+   \param seed seed of the random number generator
+   \param shift translation applied to the blobs, e.g. to create a moving image for
+   a cost function
+   \returns the image
+ */
+C3DFImage create_synthetic_3dimage(const C3DBounds& size, unsigned seed,
+                                   const C3DFVector& shift = C3DFVector::_0);
+
+/**
+   Create a reproducible test image of the given pixel type. For bit images the intensities
+   of create_synthetic_3dimage are thresholded at 128.
+   \param size image size
+   \param type pixel type
+   \param seed seed of the random number generator
+   \returns the image
+ */
+P3DImage create_synthetic_3dimage(const C3DBounds& size, EPixelType type, unsigned seed);
+
+NS_MIA_END
+
+#endif
@@ -0,0 +1,199 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <sstream>
+#include <stdexcept>
+#include <mia/internal/autotest.hh>
+#include <benchmark/benchmark.hh>
+
+using namespace mia;
+using std::string;
+using std::vector;
+using std::pair;
+
+BOOST_AUTO_TEST_CASE( test_state_iterations )
+{
+       CBenchmarkState state(5);
+       int n = 0;
+
+       while (state.keep_running())
+              ++n;
+
+       BOOST_CHECK_EQUAL(n, 5);
+       BOOST_CHECK_EQUAL(state.iterations(), 5u);
+       BOOST_CHECK(!state.keep_running());
+       BOOST_CHECK(state.get_real_time() >= 0.0);
+       BOOST_CHECK(!state.has_error());
+}
+
+BOOST_AUTO_TEST_CASE( test_state_skip )
+{
+       CBenchmarkState state(5);
+       state.skip_with_error("no plug-in");
+       BOOST_CHECK(!state.keep_running());
+       BOOST_CHECK(state.has_error());
+       BOOST_CHECK_EQUAL(state.get_error(), "no plug-in");
+}
+
+BOOST_AUTO_TEST_CASE( test_run_benchmark )
+{
+       SBenchmarkOptions options;
+       options.min_time = 0.002;
+       options.repetitions = 3;
+       volatile double x = 1.0;
+       SBenchmark b{"test/loop", [&x](CBenchmarkState & state)
+       {
+              while (state.keep_running())
+                     for (int i = 0; i < 100; ++i)
+                            x = x * 1.000001;
+
+              state.set_items_processed(100);
+       }
+                   };
+       auto r = run_benchmark(b, options);
+       BOOST_CHECK_EQUAL(r.name, "test/loop");
+       BOOST_CHECK(!r.error_occurred);
+       BOOST_CHECK_EQUAL(r.repetitions, 3u);
+       BOOST_CHECK(r.iterations > 1);
+       BOOST_CHECK(r.real_time > 0.0);
+       BOOST_CHECK(r.real_time_min <= r.real_time);
+       // one repetition must take at least the minimal time
+       BOOST_CHECK(r.iterations * r.real_time_min >= 0.5e9 * options.min_time);
+       BOOST_CHECK(r.items_per_second > 0.0);
+}
+
+BOOST_AUTO_TEST_CASE( test_run_benchmark_errors )
+{
+       SBenchmarkOptions options;
+       options.min_time = 0.001;
+       SBenchmark throwing{"test/throw", [](CBenchmarkState & state)
+       {
+              throw std::invalid_argument("unknown plug-in");
+       }
+                          };
+       auto r = run_benchmark(throwing, options);
+       BOOST_CHECK(r.error_occurred);
+       BOOST_CHECK_EQUAL(r.error_message, "unknown plug-in");
+       SBenchmark skipping{"test/skip", [](CBenchmarkState & state)
+       {
+              state.skip_with_error("skipped");
+
+              while (state.keep_running())
+                     ;
+       }
+                          };
+       r = run_benchmark(skipping, options);
+       BOOST_CHECK(r.error_occurred);
+       BOOST_CHECK_EQUAL(r.error_message, "skipped");
+}
+
+static vector<SBenchmarkResult> create_results()
+{
+       vector<SBenchmarkResult> results(3);
+       results[0].name = "filter/gauss:w=2";
+       results[0].iterations = 10;
+       results[0].repetitions = 3;
+       results[0].real_time = 1500.0;
+       results[0].cpu_time = 1400.0;
+       results[0].items_per_second = 2e6;
+       results[0].label = "ubyte \"x\"";
+       results[1].name = "cost/ssd/value";
+       results[1].iterations = 100;
+       results[1].repetitions = 3;
+       results[1].real_time = 200.0;
+       results[1].cpu_time = 200.0;
+       results[2].name = "imageio/vista/load";
+       results[2].error_occurred = true;
+       results[2].error_message = "unknown plug-in";
+       return results;
+}
+
+BOOST_AUTO_TEST_CASE( test_json_round_trip )
+{
+       auto results = create_results();
+       std::stringstream s;
+       write_benchmark_json(s, results, vector<pair<string, string>> {{"mia_version", "2.4"}});
+       auto read = read_benchmark_json(s);
+       BOOST_REQUIRE_EQUAL(read.size(), results.size());
+
+       for (size_t i = 0; i < results.size(); ++i) {
+              BOOST_CHECK_EQUAL(read[i].name, results[i].name);
+              BOOST_CHECK_EQUAL(read[i].iterations, results[i].iterations);
+              BOOST_CHECK_CLOSE(read[i].real_time, results[i].real_time, 1e-8);
+              BOOST_CHECK_CLOSE(read[i].cpu_time, results[i].cpu_time, 1e-8);
+              BOOST_CHECK_CLOSE(read[i].items_per_second, results[i].items_per_second, 1e-8);
+              BOOST_CHECK_EQUAL(read[i].label, results[i].label);
+              BOOST_CHECK_EQUAL(read[i].error_occurred, results[i].error_occurred);
+              BOOST_CHECK_EQUAL(read[i].error_message, results[i].error_message);
+       }
+}
+
+BOOST_AUTO_TEST_CASE( test_read_google_benchmark_json )
+{
+       std::istringstream s("{\"context\": {\"num_cpus\": 8, \"caches\": []},\n"
+                            " \"benchmarks\": [\n"
+                            "  {\"name\": \"a/1\", \"run_name\": \"a/1\", \"run_type\": \"iteration\", "
+                            "\"repetitions\": 2, \"repetition_index\": 0, \"iterations\": 10, "
+                            "\"real_time\": 1.0, \"cpu_time\": 1.0, \"time_unit\": \"us\"},\n"
+                            "  {\"name\": \"a/1_mean\", \"run_name\": \"a/1\", \"run_type\": \"aggregate\", "
+                            "\"aggregate_name\": \"mean\", \"iterations\": 2, "
+                            "\"real_time\": 1.5, \"cpu_time\": 1.5, \"time_unit\": \"us\"},\n"
+                            "  {\"name\": \"a/1_median\", \"run_name\": \"a/1\", \"run_type\": \"aggregate\", "
+                            "\"aggregate_name\": \"median\", \"iterations\": 2, "
+                            "\"real_time\": 1.25e0, \"cpu_time\": 1.0, \"time_unit\": \"us\"},\n"
+                            "  {\"name\": \"b\", \"iterations\": 5, \"real_time\": 2, \"cpu_time\": 3, "
+                            "\"time_unit\": \"ms\", \"error_occurred\": false}\n"
+                            " ]}");
+       auto read = read_benchmark_json(s);
+       BOOST_REQUIRE_EQUAL(read.size(), 2u);
+       BOOST_CHECK_EQUAL(read[0].name, "a/1");
+       BOOST_CHECK_CLOSE(read[0].real_time, 1250.0, 1e-8);
+       BOOST_CHECK_EQUAL(read[1].name, "b");
+       BOOST_CHECK_CLOSE(read[1].real_time, 2e6, 1e-8);
+       BOOST_CHECK_CLOSE(read[1].cpu_time, 3e6, 1e-8);
+}
+
+BOOST_AUTO_TEST_CASE( test_read_broken_json )
+{
+       std::istringstream s("{\"benchmarks\": [ {\"name\": \"a\", ]}");
+       BOOST_CHECK_THROW(read_benchmark_json(s), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE( test_compare_results )
+{
+       auto baseline = create_results();
+       auto current = create_results();
+       // 20% slower
+       current[0].real_time = 1800.0;
+       // 5% faster
+       current[1].real_time = 190.0;
+       SBenchmarkResult added;
+       added.name = "filter/new";
+       added.real_time = 10.0;
+       current.push_back(added);
+       std::ostringstream os;
+       BOOST_CHECK_EQUAL(compare_benchmark_results(os, baseline, current, 0.1), 1u);
+       BOOST_CHECK_EQUAL(compare_benchmark_results(os, baseline, current, 0.25), 0u);
+       const string table = os.str();
+       BOOST_CHECK(table.find("REGRESSION") != string::npos);
+       BOOST_CHECK(table.find("+20.0%") != string::npos);
+       BOOST_CHECK(table.find("-5.0%") != string::npos);
+       BOOST_CHECK(table.find("new") != string::npos);
+}
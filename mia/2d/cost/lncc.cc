@@ -31,70 +31,42 @@ using std::vector;
 using std::pair;
 using std::make_pair;
 
-CLNCC2DImageCost::CLNCC2DImageCost(int hw):
-       m_hwidth(hw)
+CLNCC2DImageCost::CLNCC2DImageCost(int hw, bool brute_force):
+       m_hwidth(hw),
+       m_brute_force(brute_force)
 {
        m_copy_to_double = produce_2dimage_filter("convert:repn=double,map=copy");
 }
 
-inline pair<C2DBounds, C2DBounds> prepare_range(const C2DBounds& size, int cx, int cy, int hw)
-{
-       int yb = cy - hw;
-
-       if (yb < 0) yb = 0;
-
-       unsigned ye = cy + hw + 1;
-
-       if (ye > size.y) ye = size.y;
-
-       int xb = cx - hw;
-
-       if (xb < 0) xb = 0;
-
-       unsigned xe = cx + hw + 1;
-
-       if (xe > size.x) xe = size.x;
-
-       return make_pair(C2DBounds(xb, yb), C2DBounds(xe, ye));
-}
-
-
-
+/*
+  CNCCSlidingWindow evaluates the sums of all windows of the image at once, hence the
+  cost doesn't depend on the window size.
+*/
 class FEvalCost : public TFilter<float>
 {
        int m_hw;
+       bool m_brute_force;
 public:
-       FEvalCost(int hw):
-              m_hw(hw)
+       FEvalCost(int hw, bool brute_force):
+              m_hw(hw),
+              m_brute_force(brute_force)
        {}
 
        float operator () ( const C2DDImage& mov, const C2DDImage& ref) const
        {
-              auto evaluate_local_cost = [this, &mov, &ref](const C1DParallelRange & range, const pair<float, int>& result) -> pair<float, int> {
+              const C2DBounds& size = mov.get_size();
+              CNCCSlidingWindow window(&mov[0], &ref[0], nullptr, size.x, size.y, 1, m_hw, m_brute_force);
+              window.set_slice(0);
+              auto evaluate_local_cost = [&window, &size](const C1DParallelRange & range, const pair<float, int>& result) -> pair<float, int> {
                      CThreadMsgStream msks;
                      float lresult = 0.0;
                      int count = 0;
 
                      for (auto y = range.begin(); y != range.end(); ++y)
                      {
-                            for (size_t x = 0; x < mov.get_size().x; ++x) {
-                                   auto c_block = prepare_range(mov.get_size(), x, y, m_hw);
-                                   auto ia = mov.begin_range(c_block.first, c_block.second);
-                                   auto ea = mov.end_range(c_block.first, c_block.second);
-                                   auto ib = ref.begin_range(c_block.first, c_block.second);
-                                   auto delta_size = c_block.second - c_block.first;
-                                   auto n = delta_size.product();
-
-                                   if (n > 1) {
-                                          NCCSums sum;
-
-                                          while (ia != ea) {
-                                                 sum.add(*ia, *ib);
-                                                 ++ia;
-                                                 ++ib;
-                                          }
-
-                                          lresult += sum.value();
+                            for (size_t i = y * size.x; i < (y + 1) * size.x; ++i) {
+                                   if (window.get_count(i) > 1) {
+                                          lresult += window[i].value();
                                           ++count;
                                    }
                             }
@@ -103,7 +75,7 @@ public:
                      return make_pair(result.first + lresult, result.second + count);
               };
               pair<float, int> init{0, 0};
-              auto r = preduce(C1DParallelRange(0, mov.get_size().y, 1), init, evaluate_local_cost,
+              auto r = preduce(C1DParallelRange(0, size.y, 1), init, evaluate_local_cost,
               [](const pair<float, int>& x, const pair<float, int>& y) {
                      return make_pair(x.first + y.first, x.second + y.second);
               });
@@ -114,7 +86,7 @@ public:
 
 double CLNCC2DImageCost::do_value(const Data& a, const Data& b) const
 {
-       FEvalCost ecost(m_hwidth);
+       FEvalCost ecost(m_hwidth, m_brute_force);
        auto a_double_ptr = m_copy_to_double->filter(a);
        auto b_double_ptr = m_copy_to_double->filter(b);
        const C2DDImage& mov = static_cast<const C2DDImage&>(*a_double_ptr);
@@ -126,22 +98,29 @@ double CLNCC2DImageCost::do_value(const Data& a, const Data& b) const
 class FEvalCostForce : public TFilter<float>
 {
        int m_hw;
+       bool m_brute_force;
        C2DFVectorfield& m_force;
 public:
-       FEvalCostForce(int hw, C2DFVectorfield& force):
+       FEvalCostForce(int hw, bool brute_force, C2DFVectorfield& force):
               m_hw(hw),
+              m_brute_force(brute_force),
               m_force(force)
        {}
 
        float operator () (const C2DDImage& mov, const C2DDImage& ref) const
        {
               auto ag = get_gradient(mov);
-              auto evaluate_local_cost_force = [this, &mov, &ref, &ag](const C1DParallelRange & range,
+              const C2DBounds& size = mov.get_size();
+              CNCCSlidingWindow window(&mov[0], &ref[0], nullptr, size.x, size.y, 1, m_hw, m_brute_force);
+              window.set_slice(0);
+              auto evaluate_local_cost_force = [this, &mov, &ref, &ag, &window, &size](const C1DParallelRange & range,
               const pair<float, int>& result) -> pair<float, int> {
 
                      CThreadMsgStream msks;
                      float lresult = 0.0;
                      int count = 0;
+                     const double offset_a = window.get_offset_a();
+                     const double offset_b = window.get_offset_b();
 
                      for (auto y = range.begin(); y != range.end(); ++y)
                      {
@@ -150,26 +129,11 @@ public:
                             auto imov = mov.begin_at(0, y);
                             auto iref = ref.begin_at(0, y);
 
-                            for (size_t x = 0; x < mov.get_size().x; ++x, ++iforce, ++ig, ++iref, ++imov) {
-                                   auto c_block = prepare_range(mov.get_size(), x, y, m_hw);
-                                   auto ia = mov.begin_range(c_block.first, c_block.second);
-                                   auto ea = mov.end_range(c_block.first, c_block.second);
-                                   auto ib = ref.begin_range(c_block.first, c_block.second);
-                                   auto delta_size = c_block.second - c_block.first;
-                                   auto n = delta_size.product();
-
-                                   if (n > 1) {
-                                          NCCSums sum;
-
-                                          while (ia != ea) {
-                                                 sum.add(*ia, *ib);
-                                                 ++ia;
-                                                 ++ib;
-                                          }
-
-                                          auto res = sum.get_grad_helper();
+                            for (size_t i = y * size.x; i < (y + 1) * size.x; ++i, ++iforce, ++ig, ++iref, ++imov) {
+                                   if (window.get_count(i) > 1) {
+                                          auto res = window[i].get_grad_helper();
                                           lresult += res.first;
-                                          *iforce = res.second.get_gradient_scale(*imov, *iref) * *ig;
+                                          *iforce = res.second.get_gradient_scale(*imov - offset_a, *iref - offset_b) * *ig;
                                           ++count;
                                    }
                             }
@@ -178,7 +142,7 @@ public:
                      return make_pair(result.first + lresult, result.second + count);
               };
               pair<float, int> init{0, 0};
-              auto r = preduce(C1DParallelRange(0, mov.get_size().y, 1), init, evaluate_local_cost_force,
+              auto r = preduce(C1DParallelRange(0, size.y, 1), init, evaluate_local_cost_force,
               [](const pair<float, int>& x, const pair<float, int>& y) {
                      return make_pair(x.first + y.first, x.second + y.second);
               });
@@ -189,7 +153,7 @@ public:
 
 double CLNCC2DImageCost::do_evaluate_force(const Data& a, const Data& b, Force& force) const
 {
-       FEvalCostForce ecostforce(m_hwidth, force);
+       FEvalCostForce ecostforce(m_hwidth, m_brute_force, force);
        auto a_double_ptr = m_copy_to_double->filter(a);
        auto b_double_ptr = m_copy_to_double->filter(b);
        const C2DDImage& mov = static_cast<const C2DDImage&>(*a_double_ptr);
@@ -200,15 +164,19 @@ double CLNCC2DImageCost::do_evaluate_force(const Data& a, const Data& b, Force&
 
 CLNCC2DImageCostPlugin::CLNCC2DImageCostPlugin():
        C2DImageCostPlugin("lncc"),
-       m_hw(5)
+       m_hw(5),
+       m_brute_force(false)
 {
        this->add_parameter("w", new CUIBoundedParameter(m_hw, EParameterBounds::bf_closed_interval, {1, 256}, false,
                            "half width of the window used for evaluating the localized cross correlation"));
+       this->add_parameter("brute-force", new CBoolParameter(m_brute_force, false,
+                           "evaluate the window sums by visiting all pixels of each window, "
+                           "this is slow and only meant for testing"));
 }
 
 C2DImageCost *CLNCC2DImageCostPlugin::do_create() const
 {
-       return new CLNCC2DImageCost(m_hw);
+       return new CLNCC2DImageCost(m_hw, m_brute_force);
 }
 
 const std::string CLNCC2DImageCostPlugin::do_get_descr() const
@@ -33,11 +33,12 @@ class CLNCC2DImageCost: public mia::C2DImageCost
 public:
        typedef mia::C2DImageCost::Data Data;
 
-       CLNCC2DImageCost(int hw);
+       CLNCC2DImageCost(int hw, bool brute_force);
 private:
        virtual double do_value(const Data& a, const Data& b) const;
        virtual double do_evaluate_force(const Data& a, const Data& b, Force& force) const;
        int m_hwidth;
+       bool m_brute_force;
        mia::P2DFilter m_copy_to_double;
 };
 
@@ -49,6 +50,7 @@ public:
 private:
        const std::string do_get_descr() const;
        unsigned int m_hw;
+       bool m_brute_force;
 };
 
 NS_END
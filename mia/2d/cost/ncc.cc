@@ -32,6 +32,7 @@ using namespace mia;
 CNCC2DImageCost::CNCC2DImageCost()
 {
        m_copy_to_double = produce_2dimage_filter("convert:repn=double,map=copy");
+       add(property_sampling);
 }
 
 struct FEvaluateNCCSum {
@@ -118,10 +119,28 @@ double CNCC2DImageCost::do_evaluate_force(const Data& a, const Data& b, Force& f
        return geval.first;
 }
 
+double CNCC2DImageCost::do_evaluate_samples(const std::vector<float>& src, const std::vector<float>& ref,
+              size_t /*n_voxels*/, std::vector<float>& dsrc) const
+{
+       // the correlation is normalized, hence the sample estimate doesn't need to be scaled
+       NCCSums sum;
+
+       for (size_t i = 0; i < src.size(); ++i)
+              sum.add(src[i], ref[i]);
+
+       auto geval = sum.get_grad_helper();
+       dsrc.resize(src.size());
+
+       for (size_t i = 0; i < src.size(); ++i)
+              dsrc[i] = geval.second.get_gradient_scale(src[i], ref[i]);
+
+       return geval.first;
+}
 
 CNCC2DImageCostPlugin::CNCC2DImageCostPlugin():
        C2DImageCostPlugin("ncc")
 {
+       add_property(property_sampling);
 }
 
 C2DImageCost *CNCC2DImageCostPlugin::do_create() const
@@ -38,6 +38,8 @@ public:
 private:
        virtual double do_value(const Data& a, const Data& b) const;
        virtual double do_evaluate_force(const Data& a, const Data& b, Force& force) const;
+       virtual double do_evaluate_samples(const std::vector<float>& src, const std::vector<float>& ref,
+                                          size_t n_voxels, std::vector<float>& dsrc) const;
        mia::P2DFilter m_copy_to_double;
 };
 
@@ -22,6 +22,7 @@
 
 #include <mia/2d/cost/ngf.hh>
 #include <mia/core/property_flags.hh>
+#include <mia/core/parallel.hh>
 
 using namespace std;
 using namespace boost;
@@ -165,19 +166,23 @@ void C2DNFGImageCost::post_set_reference(const mia::C2DImage& ref)
 double C2DNFGImageCost::do_value(const mia::C2DImage& a, const mia::C2DImage& /*b*/) const
 {
        TRACE("CNFG2DImageCost::do_value");
-       CCostEvaluator::param_pass pp;
-       double sum = 0.0;
        C2DFVectorfield ng_a = get_nfg(a);
+       // one block per row, the partial sums are added up in row order
+       auto eval_rows = [this, &ng_a](const C1DParallelRange & range, double sum) {
+              CCostEvaluator::param_pass pp;
 
-       for (size_t y = 1; y < ng_a.get_size().y - 1; ++y) {
-              pp.ref = m_ng_ref.begin_at(0, y);
-              pp.src = ng_a.begin_at(0, y);
+              for (auto y = range.begin(); y != range.end(); ++y) {
+                     pp.ref = m_ng_ref.begin_at(0, y);
+                     pp.src = ng_a.begin_at(0, y);
 
-              for (size_t x = 1; x < ng_a.get_size().x - 1; ++x) {
-                     sum +=  m_evaluator->get_cost(x, pp);
+                     for (size_t x = 1; x < ng_a.get_size().x - 1; ++x) {
+                            sum +=  m_evaluator->get_cost(x, pp);
+                     }
               }
-       }
 
+              return sum;
+       };
+       const double sum = preduce_ordered(1, ng_a.get_size().y - 1, 1, 0.0, eval_rows, std::plus<double>());
        return 0.5 * sum / ng_a.size();
 }
 
@@ -186,27 +191,31 @@ double C2DNFGImageCost::do_evaluate_force(const mia::C2DImage& a,
               mia::C2DFVectorfield& force) const
 {
        TRACE("CNFG2DImageCost::do_evaluate_force");
-       double sum = 0.0;
        C2DFVectorfield ng_a = get_nfg(a);
        const size_t nx = m_ng_ref.get_size().x;
        const size_t ny = m_ng_ref.get_size().y;
        assert(m_ng_ref.get_size() == ng_a.get_size());
        assert(m_ng_ref.get_size() == a.get_size());
-       CCostEvaluator::param_pass pp;
-       pp.src = ng_a.begin() + nx;
-       pp.srcp = ng_a.begin() + 2 * nx;
-       pp.srcm = ng_a.begin();
-       pp.ref = m_ng_ref.begin() + nx;
-       C2DFVectorfield::iterator iforce = force.begin() + nx;
-
-       for (size_t y = 1; y < ny - 1;
-            ++y, pp.src += nx, pp.srcm += nx, pp.srcp += nx,
-            iforce += nx, pp.ref += nx) {
-              for (size_t x = 1; x < nx - 1; ++x) {
-                     sum +=  m_evaluator->get_cost_grad(x, pp, iforce);
+       auto force_begin = force.begin();
+       auto eval_rows = [this, &ng_a, nx, force_begin](const C1DParallelRange & range, double sum) {
+              CCostEvaluator::param_pass pp;
+              pp.src = ng_a.begin() + range.begin() * nx;
+              pp.srcp = pp.src + nx;
+              pp.srcm = pp.src - nx;
+              pp.ref = m_ng_ref.begin() + range.begin() * nx;
+              C2DFVectorfield::iterator iforce = force_begin + range.begin() * nx;
+
+              for (auto y = range.begin(); y != range.end();
+                   ++y, pp.src += nx, pp.srcm += nx, pp.srcp += nx,
+                   iforce += nx, pp.ref += nx) {
+                     for (size_t x = 1; x < nx - 1; ++x) {
+                            sum +=  m_evaluator->get_cost_grad(x, pp, iforce);
+                     }
               }
-       }
 
+              return sum;
+       };
+       const double sum = preduce_ordered(1, ny - 1, 1, 0.0, eval_rows, std::plus<double>());
        return 0.5 * sum / ng_a.size();
 }
 
@@ -26,6 +26,7 @@
 
 #include <mia/2d/datafield.hh>
 #include <mia/core/msgstream.hh>
+#include <mia/core/bufferpool.hh>
 
 NS_MIA_BEGIN
 
@@ -37,7 +38,7 @@ template <class T>  T2DDatafield<T>::T2DDatafield():
 template <class T> 
 T2DDatafield<T>::T2DDatafield(const T2DDatafield<T>& org):
 	m_size(org.m_size), 
-	m_data(org.m_data)
+	m_data(TBufferPool<typename data_array::value_type>::get_copy(org.m_data))
 {
 }
 
@@ -58,15 +59,18 @@ T2DDatafield<T>::T2DDatafield(T2DDatafield<T>&& org):
 	m_size(org.m_size), 
 	m_data(std::move(org.m_data))
 {
+	// leave the moved-from field empty and consistent
+	org.m_data.clear();
+	org.m_size = C2DBounds(0,0);
 }
 
 template <class T> 
 T2DDatafield<T>& T2DDatafield<T>::operator = (T2DDatafield<T>&& org)
 {
 	if (this != &org) {
-		m_size = org.m_size;
-		m_data = std::move(org.m_data);
-		
+		// the moved-from field takes over and releases the old data
+		std::swap(m_size, org.m_size);
+		m_data.swap(org.m_data);
 	}
 	return *this; 
 }
@@ -74,14 +78,14 @@ T2DDatafield<T>& T2DDatafield<T>::operator = (T2DDatafield<T>&& org)
 template <class T> 
 T2DDatafield<T>::T2DDatafield(const C2DBounds& _Size):
 	m_size(_Size), 
-	m_data(m_size.x * m_size.y)
+	m_data(TBufferPool<typename data_array::value_type>::get(m_size.x * m_size.y))
 {
 }
 
 template <class T> 
 T2DDatafield<T>::T2DDatafield(const C2DBounds& size,const T *_data):
 	m_size(size), 
-	m_data(m_size.x * m_size.y)
+	m_data(TBufferPool<typename data_array::value_type>::get(m_size.x * m_size.y))
 {
 	if (_data)
 		::std::copy(_data, _data + m_data.size(), m_data.begin()); 
@@ -100,6 +104,7 @@ T2DDatafield<T>::T2DDatafield(const C2DBounds& size, const std::vector<T>& data)
 template <class T> 
 T2DDatafield<T>::~T2DDatafield()
 {
+	TBufferPool<typename data_array::value_type>::put(m_data); 
 }
 	
 template <class T> 
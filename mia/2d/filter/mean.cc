@@ -23,6 +23,7 @@
 #include <boost/type_traits/is_floating_point.hpp>
 
 #include <mia/core/parallel.hh>
+#include <mia/core/linebundle.hh>
 
 NS_BEGIN(mean_2dimage_filter)
 NS_MIA_USE;
@@ -34,51 +35,39 @@ C2DMean::C2DMean(int hw):
 }
 
 
+/*
+  Evaluate for each pixel the sum of the intensities in the window of half width hw
+  that is clipped at the image boundaries. The sums are obtained by running sums along
+  each axis, so the cost doesn't depend on the window size.
+*/
+template <typename T>
+static vector<double> window_sums(const T2DImage<T>& data, int hw)
+{
+       const C2DBounds& size = data.get_size();
+       vector<double> sums(data.begin(), data.end());
+       auto box_sum = [hw](const double * in, double * out, size_t length, size_t width) {
+              box_sum_line_bundle(in, out, length, width, hw);
+       };
+       const SLineBundleLayout along_x = {size.x, 1, size.y, size.x, 1, 0};
+       const SLineBundleLayout along_y = {size.y, size.x, size.x, 1, 1, 0};
+       process_line_bundles<double>(sums.begin(), along_x, box_sum);
+       process_line_bundles<double>(sums.begin(), along_y, box_sum);
+       return sums;
+}
+
 template <typename T, bool value>
 struct __dispatch_filter {
-       static T apply(const T2DImage<T>& data, int cx, int cy, int hw)
+       static T apply(double sum, int n, T MIA_PARAM_UNUSED(center))
        {
-              double result = 0.0;
-              int n = 0;
-
-              for (int y = cy - hw; y <= cy + hw; ++y) {
-                     if ( y >= 0 && y < (int)data.get_size().y)
-                            for (int x = cx - hw; x <= cx + hw; ++x) {
-                                   if ( x >= 0 && x < (int)data.get_size().x) {
-                                          result += data(x, y);
-                                          ++n;
-                                   }
-                            }
-              }
-
-              // hw >= 0, cy >= 0 && cy < data.get_size().y
-              // therefore n >=1, hence the override
-              // coverity[divide_by_zero]
-              return static_cast<T>(rint(result / n));
+              return static_cast<T>(rint(sum / n));
        }
 };
 
 template <typename T>
 struct __dispatch_filter<T, true> {
-       static T apply(const T2DImage<T>& data, int cx, int cy, int  hw)
+       static T apply(double sum, int n, T MIA_PARAM_UNUSED(center))
        {
-              double result = 0.0;
-              int n = 0;
-
-              for (int y = cy - hw; y <= cy + hw; ++y) {
-                     if ( y >= 0 && y < (int)data.get_size().y)
-                            for (int x = cx - hw; x <= cx + hw; ++x) {
-                                   if ( x >= 0 && x < (int)data.get_size().x) {
-                                          result += data(x, y);
-                                          ++n;
-                                   }
-                            }
-              }
-
-              // hw >= 0, cy >= 0 && cy < data.get_size().y
-              // therefore n >=1, hence the override
-              // coverity[divide_by_zero]
-              return static_cast<T>(result / n);
+              return static_cast<T>(sum / n);
        }
 };
 
@@ -86,24 +75,11 @@ struct __dispatch_filter<T, true> {
 // the number of trues and falses equal return the original value
 template <>
 struct __dispatch_filter<bool, false> {
-       static bool apply(const T2DImage<bool>& data, int cx, int cy, int hw)
+       static bool apply(double sum, int n, bool center)
        {
-              int balance = 0;
-
-              for (int y = cy - hw; y <= cy + hw; ++y) {
-                     if ( y >= 0 && y < (int)data.get_size().y)
-                            for (int x = cx - hw; x <= cx + hw; ++x) {
-                                   if ( x >= 0 && x < (int)data.get_size().x) {
-                                          if (data(x, y))
-                                                 ++balance;
-                                          else
-                                                 --balance;
-                                   }
-                            }
-              }
-
+              const double balance = 2 * sum - n;
               return (balance > 0) ? true :
-                     ((balance < 0) ? false : data(cx, cy));
+                     ((balance < 0) ? false : center);
        }
 };
 
@@ -113,18 +89,23 @@ C2DMean::result_type C2DMean::operator () (const T2DImage<T>& data) const
        TRACE_FUNCTION;
        assert(m_hw >= 0);
        const bool is_floating_point = boost::is_floating_point<T>::value;
-       T2DImage<T> *tresult = new T2DImage<T>(data.get_size(), data);
+       T2DImage<T> *tresult = new T2DImage<T>(data);
        P2DImage result(tresult);
-       int hw = m_hw;
-       auto run_line  = [hw, data, tresult](const C1DParallelRange & range) {
+       const int hw = m_hw;
+       const auto sums = window_sums(data, hw);
+       const C2DBounds& size = data.get_size();
+       auto run_line  = [hw, &sums, &size, tresult](const C1DParallelRange & range) {
               for (auto y = range.begin(); y !=  range.end(); ++y) {
                      typename T2DImage<T>::iterator i = tresult->begin_at(0, y);
+                     auto is = sums.begin() + y * size.x;
+                     const int ny = box_count(y, size.y, hw);
 
-                     for (size_t x = 0; x < data.get_size().x; ++x, ++i)
-                            *i = __dispatch_filter<T, is_floating_point>::apply(data, x, y, hw);
+                     for (size_t x = 0; x < size.x; ++x, ++i, ++is)
+                            *i = __dispatch_filter<T, is_floating_point>::apply(*is, ny * box_count(x, size.x, hw), *i);
               }
        };
-       pfor(C1DParallelRange(0, data.get_size().y, 1), run_line);
+       pfor(C1DParallelRange(0, size.y, 1), run_line);
+
        return result;
 }
 
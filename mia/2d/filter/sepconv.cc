@@ -19,6 +19,7 @@
  */
 
 #include <mia/2d/filter/sepconv.hh>
+#include <mia/core/linebundle.hh>
 
 NS_BEGIN(SeparableConvolute_2dimage_filter)
 
@@ -34,51 +35,43 @@ CSeparableConvolute::CSeparableConvolute(P1DSpacialKernel kx,
 {
 }
 
-// this should be repaced by some more sophisticated code if ranges get smaller
-template <typename A, typename B>
-struct SConvert {
-       B operator ()( A x) const
-       {
-              return B(x);
-       }
+// float images are filtered in single precision, all others in double precision
+template <typename T>
+struct sepconv_accumulator {
+       typedef double type;
 };
 
-template <typename T>
-void CSeparableConvolute::fold(vector<T>& data, const C1DFilterKernel& kernel) const
+template <>
+struct sepconv_accumulator<float> {
+       typedef float type;
+};
+
+template <typename A, typename Iterator>
+static void fold(Iterator data, const SLineBundleLayout& layout, const C1DFilterKernel& kernel)
 {
-       vector<double> tmp(data.size());
-       copy(data.begin(), data.end(), tmp.begin());
-       kernel.apply_inplace(tmp);
-       transform(tmp.begin(), tmp.end(), data.begin(), SConvert<double, T>());
+       C1DFoldingLineBundle bundle(kernel);
+       process_line_bundles<A>(data, layout, [&bundle](const A * in, A * out, size_t length, size_t width) {
+              bundle.apply(in, out, length, width);
+       });
 }
 
 template <class T>
 CSeparableConvolute::result_type CSeparableConvolute::operator () (const T2DImage<T>& image) const
 {
-       typedef std::vector<T> invec_t;
+       typedef typename sepconv_accumulator<T>::type A;
        T2DImage<T> *data = new T2DImage<T>(image);
        CSeparableConvolute::result_type result(data);
-       int cachXSize = data->get_size().x;
-       int cachYSize = data->get_size().y;
+       const C2DBounds& size = data->get_size();
 
+       // the lines along x are transposed in tiles, the y pass works on contiguous rows
        if (m_kx.get()) {
-              invec_t buffer(cachXSize);
-
-              for (int y = 0; y < cachYSize; y++) {
-                     data->get_data_line_x(y, buffer);
-                     fold(buffer, *m_kx);
-                     data->put_data_line_x(y, buffer);
-              }
+              const SLineBundleLayout along_x = {size.x, 1, size.y, size.x, 1, 0};
+              fold<A>(data->begin(), along_x, *m_kx);
        }
 
        if (m_ky.get()) {
-              invec_t buffer(cachYSize);
-
-              for (int x = 0; x < cachXSize; x++) {
-                     data->get_data_line_y(x, buffer);
-                     fold(buffer, *m_ky);
-                     data->put_data_line_y(x, buffer);
-              }
+              const SLineBundleLayout along_y = {size.y, size.x, size.x, 1, 1, 0};
+              fold<A>(data->begin(), along_y, *m_ky);
        }
 
        return result;
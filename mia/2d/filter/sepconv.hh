@@ -38,9 +38,6 @@ public:
        template <typename  T>
        CSeparableConvolute::result_type operator () (const mia::T2DImage<T>& data) const;
 
-       template <typename T>
-       void fold(std::vector<T>& v, const mia::C1DFilterKernel& kernel)const;
-
 private:
        CSeparableConvolute::result_type do_filter(const mia::C2DImage& image) const;
 
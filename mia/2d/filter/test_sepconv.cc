@@ -190,3 +190,49 @@ BOOST_AUTO_TEST_CASE( test_scharr_y )
 
 
 
+
+BOOST_AUTO_TEST_CASE( test_sepconv_large_against_linewise )
+{
+       // large enough to use the bundled folding in both directions
+       C2DBounds size(37, 29);
+       C2DFImage src(size);
+       int k = 0;
+
+       for (auto i = src.begin(); i != src.end(); ++i, ++k)
+              *i = (k * 37) % 101;
+
+       const auto&  skp = C1DSpacialKernelPluginHandler::instance();
+       auto kx = skp.produce("gauss:w=4");
+       auto ky = skp.produce("scharr");
+       CSeparableConvolute sp(kx, ky);
+       P2DImage presult = sp.filter(src);
+       const C2DFImage& result = dynamic_cast<const C2DFImage&>(*presult);
+       C2DFImage test(src);
+       vector<double> line_x(size.x);
+       vector<double> line_y(size.y);
+
+       for (size_t y = 0; y < size.y; ++y) {
+              for (size_t x = 0; x < size.x; ++x)
+                     line_x[x] = test(x, y);
+
+              kx->apply_inplace(line_x);
+
+              for (size_t x = 0; x < size.x; ++x)
+                     test(x, y) = line_x[x];
+       }
+
+       for (size_t x = 0; x < size.x; ++x) {
+              for (size_t y = 0; y < size.y; ++y)
+                     line_y[y] = test(x, y);
+
+              ky->apply_inplace(line_y);
+
+              for (size_t y = 0; y < size.y; ++y)
+                     test(x, y) = line_y[y];
+       }
+
+       auto t = test.begin();
+
+       for (auto i = result.begin(); i != result.end(); ++i, ++t)
+              BOOST_CHECK_CLOSE(*i, *t, 0.01);
+}
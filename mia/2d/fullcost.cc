@@ -31,6 +31,7 @@ namespace bfs =::boost::filesystem;
 
 template class TFullCostPlugin<C2DTransformation>;
 template class TFullCost<C2DTransformation>;
+template class TDeformedDataStore<C2DTransformation>;
 
 template <> const char   *const
 TPluginHandler<C2DFullCostPlugin>::m_help =
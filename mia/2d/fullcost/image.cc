@@ -20,6 +20,8 @@
 
 #include <mia/2d/fullcost/image.hh>
 #include <mia/2d/filter.hh>
+#include <mia/core/errormacro.hh>
+#include <mia/core/parallel.hh>
 
 NS_MIA_BEGIN
 using namespace std;
@@ -28,7 +30,10 @@ C2DImageFullCost::C2DImageFullCost(const std::string& src,
                                    const std::string& ref,
                                    C2DImageCostPluginHandler::ProductPtr cost,
                                    double weight,
-                                   bool debug):
+                                   bool debug,
+                                   CVoxelSampler::EStrategy sampling,
+                                   double fraction,
+                                   unsigned seed):
        C2DFullCost(weight),
        m_src_key(C2DImageIOPluginHandler::instance().load_to_pool(src)),
        m_ref_key(C2DImageIOPluginHandler::instance().load_to_pool(ref)),
@@ -36,6 +41,15 @@ C2DImageFullCost::C2DImageFullCost(const std::string& src,
        m_debug(debug)
 {
        assert(m_cost_kernel);
+
+       if (sampling != CVoxelSampler::vs_none) {
+              if (!m_cost_kernel->has(property_sampling))
+                     throw create_exception<invalid_argument>("C2DImageFullCost: cost function '",
+                                   m_cost_kernel->get_init_string(),
+                                   "' can not be evaluated on a sub-set of the pixels");
+
+              m_sampler.reset(new CVoxelSampler(sampling, fraction, seed));
+       }
 }
 
 bool C2DImageFullCost::do_has(const char *property) const
@@ -60,7 +74,16 @@ double C2DImageFullCost::do_value(const C2DTransformation& t) const
 {
        TRACE_FUNCTION;
        assert(m_src_scaled);
-       P2DImage temp  = t(*m_src_scaled);
+
+       // evaluate on the samples drawn for the last gradient evaluation to obtain comparable values
+       if (m_sampler) {
+              if (m_samples.empty())
+                     draw_samples();
+
+              return evaluate_samples(t, nullptr);
+       }
+
+       P2DImage temp  = transform_data(m_src_key.get_key(), t, *m_src_scaled);
        const double result = m_cost_kernel->value(*temp);
        cvdebug() << "C2DImageFullCost::value = " << result << "\n";
        return result;
@@ -82,10 +105,16 @@ double C2DImageFullCost::do_evaluate(const C2DTransformation& t, CDoubleVector&
 {
        TRACE_FUNCTION;
        assert(m_src_scaled);
+
+       if (m_sampler) {
+              draw_samples();
+              return evaluate_samples(t, &gradient);
+       }
+
        static int idx = 0;
        static auto  toubyte_converter =
               C2DFilterPluginHandler::instance().produce("convert:repn=ubyte");
-       P2DImage temp  = t(*m_src_scaled);
+       P2DImage temp  = transform_data(m_src_key.get_key(), t, *m_src_scaled);
 
        if (m_debug) {
               stringstream fname;
@@ -104,6 +133,74 @@ double C2DImageFullCost::do_evaluate(const C2DTransformation& t, CDoubleVector&
        return result;
 }
 
+void C2DImageFullCost::draw_samples() const
+{
+       const C2DBounds& size = get_current_size();
+       m_sampler->draw(vector<size_t> {size.x, size.y}, m_samples);
+       if (!m_ref_float)
+              m_ref_float = produce_2dimage_filter("convert:repn=float,map=copy")->filter(*m_ref_scaled);
+
+       const C2DFImage& ref = static_cast<const C2DFImage&>(*m_ref_float);
+       m_ref_samples.resize(m_samples.size());
+       transform(m_samples.begin(), m_samples.end(), m_ref_samples.begin(),
+       [&ref](size_t i) {
+              return ref[i];
+       });
+       cvdebug() << "C2DImageFullCost: drew " << m_samples.size() << " samples\n";
+}
+
+/*
+  Only the sampled pixels are transformed. The force is evaluated from the gradient of the
+  study image at the transformed positions, i.e. in the space the transformation's
+  translate expects it, so that the neighbours of the samples don't need to be transformed
+  and the parameter gradient is obtained from the samples alone.
+ */
+double C2DImageFullCost::evaluate_samples(const C2DTransformation& t, CDoubleVector *gradient) const
+{
+       TRACE_FUNCTION;
+       const C2DBounds& size = get_current_size();
+
+       if (!m_src_interpolator) {
+              auto src_float = produce_2dimage_filter("convert:repn=float,map=copy")->filter(*m_src_scaled);
+              const auto& ipf = t.get_interpolator_factory();
+              m_src_interpolator.reset(ipf.create(static_cast<const C2DFImage&>(*src_float).data()));
+              m_src_gradient_interpolator.reset(ipf.create(get_gradient(*src_float)));
+       }
+
+       const size_t n = m_samples.size();
+       vector<float> src_samples(n);
+       vector<C2DFVector> src_gradient(gradient ? n : 0);
+       const auto& interp = *m_src_interpolator;
+       const auto& ginterp = *m_src_gradient_interpolator;
+       auto transform_samples = [&](const C1DParallelRange & range) {
+              auto cache = interp.create_cache();
+              auto gcache = ginterp.create_cache();
+
+              for (auto i = range.begin(); i != range.end(); ++i) {
+                     const size_t idx = m_samples[i];
+                     const C2DFVector x(idx % size.x, idx / size.x);
+                     const C2DFVector y = t(x);
+                     src_samples[i] = interp(y, cache);
+
+                     if (gradient)
+                            src_gradient[i] = ginterp(y, gcache);
+              }
+       };
+       pfor(C1DParallelRange(0, n, 1024), transform_samples);
+       vector<float> dsrc;
+       const double result = m_cost_kernel->evaluate_samples(src_samples, m_ref_samples, size.product(), dsrc);
+
+       if (gradient) {
+              for (size_t i = 0; i < n; ++i)
+                     src_gradient[i] *= dsrc[i];
+
+              t.translate_sparse(m_samples, src_gradient, *gradient);
+       }
+
+       cvdebug() << "C2DImageFullCost: sampled cost = " << result << "\n";
+       return result;
+}
+
 void C2DImageFullCost::do_set_size()
 {
        TRACE_FUNCTION;
@@ -112,21 +209,14 @@ void C2DImageFullCost::do_set_size()
 
        if (!m_src_scaled || m_src_scaled->get_size() != get_current_size() ||
            !m_ref_scaled || m_ref_scaled->get_size() != get_current_size() ) {
-              if (get_current_size() == m_src->get_size()) {
-                     m_src_scaled = m_src;
-                     m_ref_scaled = m_ref;
-              } else {
-                     stringstream filter_descr;
-                     filter_descr << "scale:s=[" << get_current_size() << "]";
-                     auto scaler = C2DFilterPluginHandler::instance().produce(filter_descr.str());
-                     assert(scaler);
-                     cvdebug() << "C2DImageFullCost:scale images to " << get_current_size() <<
-                               " using '" << filter_descr.str() << "'\n";
-                     m_src_scaled = scaler->filter(*m_src);
-                     m_ref_scaled = scaler->filter(*m_ref);
-              }
-
+              cvdebug() << "C2DImageFullCost:scale images to " << get_current_size() << "\n";
+              m_src_scaled = m_src_pyramid->get_image(get_current_size());
+              m_ref_scaled = m_ref_pyramid->get_image(get_current_size());
               m_cost_kernel->set_reference(*m_ref_scaled);
+              m_samples.clear();
+              m_src_interpolator.reset();
+              m_src_gradient_interpolator.reset();
+              m_ref_float.reset();
        }
 }
 
@@ -135,6 +225,8 @@ void C2DImageFullCost::do_reinit()
        TRACE_FUNCTION;
        m_src = get_from_pool(m_src_key);
        m_ref = get_from_pool(m_ref_key);
+       m_src_pyramid = C2DImagePyramid::get_shared(m_src);
+       m_ref_pyramid = C2DImagePyramid::get_shared(m_ref);
        m_src_scaled.reset();
        m_ref_scaled.reset();
 
@@ -173,13 +265,19 @@ private:
        std::string m_ref_name;
        C2DImageCostPluginHandler::ProductPtr m_cost_kernel;
        bool m_debug;
+       CVoxelSampler::EStrategy m_sampling;
+       float m_fraction;
+       unsigned int m_seed;
 };
 
 C2DImageFullCostPlugin::C2DImageFullCostPlugin():
        C2DFullCostPlugin("image"),
        m_src_name("src.@"),
        m_ref_name("ref.@"),
-       m_debug(false)
+       m_debug(false),
+       m_sampling(CVoxelSampler::vs_none),
+       m_fraction(0.1),
+       m_seed(0)
 {
        add_parameter("src", new CStringParameter(m_src_name, CCmdOptionFlags::input, "Study image",
                      &C2DImageIOPluginHandler::instance()));
@@ -187,6 +285,13 @@ C2DImageFullCostPlugin::C2DImageFullCostPlugin():
                      &C2DImageIOPluginHandler::instance()));
        add_parameter("cost", make_param(m_cost_kernel, "ssd", false, "Cost function kernel"));
        add_parameter("debug", new CBoolParameter(m_debug, false, "Save intermediate resuts for debugging"));
+       add_parameter("sampling", new CDictParameter<CVoxelSampler::EStrategy>(m_sampling, g_voxel_sampling_dict,
+                     "Estimate the cost function and its gradient from a sub-set of the pixels that is drawn "
+                     "a new for each gradient evaluation. Only the sampled pixels of the study image are "
+                     "transformed. This requires a cost function kernel that supports sampling."));
+       add_parameter("fraction", make_oci_param(m_fraction, 0.0, 1.0, false,
+                     "Fraction of the pixels that are used when sampling is enabled"));
+       add_parameter("seed", make_param(m_seed, false, "Seed of the random number generator used for sampling"));
 }
 
 C2DFullCost *C2DImageFullCostPlugin::do_create(float weight) const
@@ -195,7 +300,8 @@ C2DFullCost *C2DImageFullCostPlugin::do_create(float weight) const
                  << " src=" << m_src_name << " ref=" << m_ref_name
                  << " cost=" << m_cost_kernel << "\n";
        return 	new C2DImageFullCost(m_src_name, m_ref_name,
-                                          m_cost_kernel, weight, m_debug);
+                                          m_cost_kernel, weight, m_debug,
+                                          m_sampling, m_fraction, m_seed);
 }
 
 const std::string C2DImageFullCostPlugin::do_get_descr() const
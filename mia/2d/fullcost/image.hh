@@ -25,23 +25,44 @@
 #include <mia/2d/fullcost.hh>
 #include <mia/2d/imageio.hh>
 #include <mia/2d/cost.hh>
+#include <mia/2d/imagepyramid.hh>
+#include <mia/2d/interpolator.hh>
+#include <mia/core/voxelsampler.hh>
 
 NS_MIA_BEGIN
 
 class EXPORT C2DImageFullCost : public C2DFullCost
 {
 public:
+       /**
+          \param src study image
+          \param ref reference image
+          \param cost the image similarity measure
+          \param weight weight of the cost function
+          \param debug save intermediate results
+          \param sampling if not vs_none, the cost function and its gradient are estimated from
+          a sub-set of the pixels that is drawn a new for each evaluation of the gradient, and
+          only the sampled pixels of the study image are transformed
+          \param fraction fraction of the pixels that is used when sampling is enabled
+          \param seed seed for the random number generator used for sampling
+        */
        C2DImageFullCost(const std::string& src,
                         const std::string& ref,
                         C2DImageCostPluginHandler::ProductPtr cost,
                         double weight,
-                        bool debug);
+                        bool debug,
+                        CVoxelSampler::EStrategy sampling = CVoxelSampler::vs_none,
+                        double fraction = 0.1,
+                        unsigned seed = 0);
 private:
        double do_evaluate(const C2DTransformation& t, CDoubleVector& gradient) const;
        void do_set_size();
 
        static P2DImage get_from_pool(const C2DImageDataKey& key);
 
+       void draw_samples() const;
+       double evaluate_samples(const C2DTransformation& t, CDoubleVector *gradient) const;
+
        bool do_has(const char *property) const;
        double do_value(const C2DTransformation& t) const;
        bool do_get_full_size(C2DBounds& size) const;
@@ -55,11 +76,21 @@ private:
        P2DImage m_src;
        P2DImage m_ref;
 
+       P2DImagePyramid m_src_pyramid;
+       P2DImagePyramid m_ref_pyramid;
+
        P2DImage m_src_scaled;
        P2DImage m_ref_scaled;
 
        P2DImageCost m_cost_kernel;
        bool m_debug;
+
+       std::unique_ptr<CVoxelSampler> m_sampler;
+       mutable std::vector<size_t> m_samples;
+       mutable std::vector<float> m_ref_samples;
+       mutable P2DImage m_ref_float;
+       mutable std::unique_ptr<T2DInterpolator<float>> m_src_interpolator;
+       mutable std::unique_ptr<T2DInterpolator<C2DFVector>> m_src_gradient_interpolator;
 };
 
 NS_MIA_END
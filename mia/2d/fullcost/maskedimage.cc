@@ -112,7 +112,7 @@ double C2DMaskedImageFullCost::do_value(const C2DTransformation& t) const
 {
        TRACE_FUNCTION;
        assert(m_src_scaled  && "Bug: you must call 'reinit()' before calling value(transform)");
-       P2DImage temp  = t(*m_src_scaled);
+       P2DImage temp  = transform_data(m_src_key.get_key(), t, *m_src_scaled);
        C2DBitImage *temp_mask_bit = nullptr;
        P2DImage temp_mask  = get_combined_mask(&t, &temp_mask_bit);
        assert(temp_mask_bit);
@@ -138,7 +138,7 @@ double C2DMaskedImageFullCost::do_evaluate(const C2DTransformation& t, CDoubleVe
 {
        TRACE_FUNCTION;
        assert(m_src_scaled  && "Bug: you must call 'reinit()' before calling evauate(...)");
-       P2DImage temp  = t(*m_src_scaled);
+       P2DImage temp  = transform_data(m_src_key.get_key(), t, *m_src_scaled);
        C2DBitImage *temp_mask_bit = nullptr;
        P2DImage temp_mask  = get_combined_mask(&t, &temp_mask_bit);
        assert(temp_mask_bit);
@@ -162,8 +162,8 @@ void C2DMaskedImageFullCost::do_set_size()
               assert(scaler);
               cvdebug() << "C2DMaskedImageFullCost:scale images to " << get_current_size() <<
                         " using '" << filter_descr.str() << "'\n";
-              m_src_scaled = scaler->filter(*m_src);
-              m_ref_scaled = scaler->filter(*m_ref);
+              m_src_scaled = m_src_pyramid->get_image(get_current_size());
+              m_ref_scaled = m_ref_pyramid->get_image(get_current_size());
               m_cost_kernel->set_reference(*m_ref_scaled);
 
               if (m_src_mask)  {
@@ -198,6 +198,8 @@ void C2DMaskedImageFullCost::do_reinit()
        //cvmsg() << "C2DMaskedImageFullCost: read " << m_src_key << " and " << m_ref_key << "\n";
        m_src_scaled = m_src = get_from_pool(m_src_key);
        m_ref_scaled = m_ref = get_from_pool(m_ref_key);
+       m_src_pyramid = C2DImagePyramid::get_shared(m_src);
+       m_ref_pyramid = C2DImagePyramid::get_shared(m_ref);
 
        if (m_src_mask_key.key_is_valid()) {
               m_src_mask = get_from_pool(m_src_mask_key);
@@ -25,6 +25,7 @@
 #include <mia/2d/fullcost.hh>
 #include <mia/2d/imageio.hh>
 #include <mia/2d/maskedcost.hh>
+#include <mia/2d/imagepyramid.hh>
 
 NS_MIA_BEGIN
 
@@ -62,6 +63,8 @@ private:
        P2DImage m_ref;
        P2DImage m_src_mask;
        P2DImage m_ref_mask;
+       P2DImagePyramid m_src_pyramid;
+       P2DImagePyramid m_ref_pyramid;
        C2DBitImage *m_ref_mask_bit;
 
 
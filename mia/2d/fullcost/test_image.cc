@@ -100,6 +100,60 @@ BOOST_FIXTURE_TEST_CASE( test_imagefullcost_no_translate,  ImagefullcostFixture
        BOOST_CHECK_CLOSE(value, 0.5 * 55.0, 0.1);
 }
 
+BOOST_AUTO_TEST_CASE( test_imagefullcost_sampled_all_pixels )
+{
+       // sampling all pixels must give the same result like the full evaluation
+       C2DBounds size(17, 15);
+       C2DFImage *src = new C2DFImage(size);
+       C2DFImage *ref = new C2DFImage(size);
+
+       for (unsigned y = 0; y < size.y; ++y)
+              for (unsigned x = 0; x < size.x; ++x) {
+                     (*src)(x, y) = 100.0f * exp(-(C2DFVector(x, y) - C2DFVector(7.5, 7)).norm2() / 16.0f);
+                     (*ref)(x, y) = 100.0f * exp(-(C2DFVector(x, y) - C2DFVector(8, 6.5)).norm2() / 16.0f);
+              }
+
+       BOOST_REQUIRE(save_image("src.@", P2DImage(src)));
+       BOOST_REQUIRE(save_image("ref.@", P2DImage(ref)));
+       // for the gradient this only holds for a pure translation
+       auto t = C2DTransformCreatorHandler::instance().produce("translate")->create(size);
+       auto params = t->get_parameters();
+       params[0] = 0.4;
+       params[1] = -0.3;
+       t->set_parameters(params);
+
+       for (auto kernel : {"ssd", "ncc"}) {
+              C2DImageFullCost cost("src.@", "ref.@", C2DImageCostPluginHandler::instance().produce(kernel),
+                                    1.0, false);
+              C2DImageFullCost sampled_cost("src.@", "ref.@", C2DImageCostPluginHandler::instance().produce(kernel),
+                                            1.0, false, CVoxelSampler::vs_stratified, 1.0, 1);
+              cost.reinit();
+              cost.set_size(size);
+              sampled_cost.reinit();
+              sampled_cost.set_size(size);
+              CDoubleVector gradient(t->degrees_of_freedom());
+              CDoubleVector sampled_gradient(t->degrees_of_freedom());
+              const double value = cost.evaluate(*t, gradient);
+              BOOST_CHECK_CLOSE(sampled_cost.evaluate(*t, sampled_gradient), value, 0.01);
+              BOOST_CHECK_CLOSE(sampled_cost.cost_value(*t), value, 0.01);
+
+              // the gradients only differ at the boundary, where the full evaluation sets it to zero
+              double norm = 0.0;
+
+              for (size_t i = 0; i < gradient.size(); ++i)
+                     norm += gradient[i] * gradient[i];
+
+              for (size_t i = 0; i < gradient.size(); ++i)
+                     BOOST_CHECK_SMALL(sampled_gradient[i] - gradient[i], 0.05 * sqrt(norm));
+       }
+}
+
+BOOST_AUTO_TEST_CASE( test_imagefullcost_sampling_unsupported )
+{
+       BOOST_CHECK_THROW(C2DImageFullCost("src.@", "ref.@", C2DImageCostPluginHandler::instance().produce("ngf"),
+                                          1.0, false, CVoxelSampler::vs_random, 0.1, 1), std::invalid_argument);
+}
+
 
 BOOST_FIXTURE_TEST_CASE( test_imagefullcost_2,  ImagefullcostFixture)
 {
@@ -0,0 +1,38 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <mia/2d/imagepyramid.hh>
+#include <mia/template/imagepyramid.cxx>
+
+NS_MIA_BEGIN
+
+template <>
+void pyramid_pixel_size<2>::apply(C2DImage& level, const C2DImage& parent)
+{
+       const C2DBounds& in_size = parent.get_size();
+       const C2DBounds& out_size = level.get_size();
+       C2DFVector factor(float(in_size.x) / out_size.x,
+                         float(in_size.y) / out_size.y);
+       level.set_pixel_size(parent.get_pixel_size() * factor);
+}
+
+template class TImagePyramid<2>;
+
+NS_MIA_END
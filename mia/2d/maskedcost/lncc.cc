@@ -31,81 +31,46 @@ using std::vector;
 using std::pair;
 using std::make_pair;
 
-CLNCC2DImageCost::CLNCC2DImageCost(int hw):
-       m_hwidth(hw)
+CLNCC2DImageCost::CLNCC2DImageCost(int hw, bool brute_force):
+       m_hwidth(hw),
+       m_brute_force(brute_force)
 {
        m_copy_to_double = produce_2dimage_filter("convert:repn=double,map=copy");
 }
 
-inline pair<C2DBounds, C2DBounds> prepare_range(const C2DBounds& size, int cx, int cy, int hw)
-{
-       int yb = cy - hw;
-
-       if (yb < 0) yb = 0;
-
-       unsigned ye = cy + hw + 1;
-
-       if (ye > size.y) ye = size.y;
-
-       int xb = cx - hw;
-
-       if (xb < 0) xb = 0;
-
-       unsigned xe = cx + hw + 1;
-
-       if (xe > size.x) xe = size.x;
-
-       return make_pair(C2DBounds(xb, yb), C2DBounds(xe, ye));
-}
-
-
-
+/*
+  CNCCSlidingWindow evaluates the sums of all windows of the image at once, hence the
+  cost doesn't depend on the window size.
+*/
 class FEvalCost : public TFilter<float>
 {
        int m_hw;
+       bool m_brute_force;
        const C2DBitImage& m_mask;
 public:
-       FEvalCost(int hw, const C2DBitImage& mask):
+       FEvalCost(int hw, bool brute_force, const C2DBitImage& mask):
               m_hw(hw),
+              m_brute_force(brute_force),
               m_mask(mask)
        {}
 
        float operator () ( const C2DDImage& mov, const C2DDImage& ref) const
        {
-              auto evaluate_local_cost = [this, &mov, &ref](const C1DParallelRange & range, const pair<float, int>& result) -> pair<float, int> {
+              const C2DBounds& size = mov.get_size();
+              CNCCSlidingWindow window(&mov[0], &ref[0], &m_mask[0], size.x, size.y, 1, m_hw, m_brute_force);
+              window.set_slice(0);
+              auto evaluate_local_cost = [this, &window, &size](const C1DParallelRange & range, const pair<float, int>& result) -> pair<float, int> {
                      CThreadMsgStream msks;
                      float lresult = 0.0;
                      int count = 0;
-                     const int max_length = 2 * m_hw + 1;
-                     vector<float> a_buffer( max_length *max_length * max_length);
-                     vector<float> b_buffer( max_length *max_length * max_length);
 
                      for (auto y = range.begin(); y != range.end(); ++y)
                      {
                             auto imask  = m_mask.begin_at(0, y);
 
-                            for (size_t x = 0; x < mov.get_size().x; ++x, ++imask) {
-                                   if (!*imask)
-                                          continue;
-
-                                   auto c_block = prepare_range(mov.get_size(), x, y, m_hw);
-                                   NCCSums sum;
-
-                                   for (unsigned iy = c_block.first.y; iy < c_block.second.y; ++iy) {
-                                          auto ia = mov.begin_at(0, iy);
-                                          auto ib = ref.begin_at(0, iy);
-                                          auto im = m_mask.begin_at(0, iy);
-
-                                          for (unsigned ix = c_block.first.x; ix < c_block.second.x; ++ix) {
-                                                 // make a local copy
-                                                 if (im[ix]) {
-                                                        sum.add(ia[ix], ib[ix]);
-                                                 }
-                                          }
-                                   }
-
-                                   if (sum.has_samples()) {
-                                          lresult += sum.value();
+                            for (size_t i = y * size.x; i < (y + 1) * size.x; ++i, ++imask) {
+                                   if (*imask && window.get_count(i) > 0) {
+                                          lresult += window[i].value();
                                           ++count;
                                    }
                             }
@@ -114,7 +79,7 @@ public:
                      return make_pair(result.first + lresult, result.second + count);
               };
               pair<float, int> init{0, 0};
-              auto r = preduce(C1DParallelRange(0, mov.get_size().y, 1), init, evaluate_local_cost,
+              auto r = preduce(C1DParallelRange(0, size.y, 1), init, evaluate_local_cost,
               [](const pair<float, int>& x, const pair<float, int>& y) {
                      return make_pair(x.first + y.first, x.second + y.second);
               });
@@ -130,7 +95,7 @@ double CLNCC2DImageCost::do_value(const Data& a, const Data& b, const Mask& m) c
        auto b_double_ptr = m_copy_to_double->filter(b);
        const auto& mov = static_cast<const C2DDImage&>(*a_double_ptr);
        const auto& ref = static_cast<const C2DDImage&>(*b_double_ptr);
-       FEvalCost ecost(m_hwidth, m);
+       FEvalCost ecost(m_hwidth, m_brute_force, m);
        return ecost(mov, ref);
 }
 
@@ -138,11 +103,13 @@ double CLNCC2DImageCost::do_value(const Data& a, const Data& b, const Mask& m) c
 class FEvalCostForce : public TFilter<float>
 {
        int m_hw;
+       bool m_brute_force;
        const C2DBitImage& m_mask;
        C2DFVectorfield& m_force;
 public:
-       FEvalCostForce(int hw, const C2DBitImage& mask, C2DFVectorfield& force):
+       FEvalCostForce(int hw, bool brute_force, const C2DBitImage& mask, C2DFVectorfield& force):
               m_hw(hw),
+              m_brute_force(brute_force),
               m_mask(mask),
               m_force(force)
        {}
@@ -150,15 +117,17 @@ public:
        float operator () ( const C2DDImage& mov, const C2DDImage& ref) const
        {
               auto ag = get_gradient(mov);
-              auto evaluate_local_cost_force = [this, &mov, &ref, &ag](const C1DParallelRange & range,
+              const C2DBounds& size = mov.get_size();
+              CNCCSlidingWindow window(&mov[0], &ref[0], &m_mask[0], size.x, size.y, 1, m_hw, m_brute_force);
+              window.set_slice(0);
+              auto evaluate_local_cost_force = [this, &mov, &ref, &ag, &window, &size](const C1DParallelRange & range,
               const pair<float, int>& result) -> pair<float, int> {
 
                      CThreadMsgStream msks;
                      float lresult = 0.0;
                      int count = 0;
-                     const int max_length = 2 * m_hw + 1;
-                     vector<float> a_buffer( max_length *max_length * max_length);
-                     vector<float> b_buffer( max_length *max_length * max_length);
+                     const double offset_a = window.get_offset_a();
+                     const double offset_b = window.get_offset_b();
 
                      for (auto y = range.begin(); y != range.end(); ++y)
                      {
@@ -168,30 +137,11 @@ public:
                             auto imov = mov.begin_at(0, y);
                             auto iref = ref.begin_at(0, y);
 
-                            for (size_t x = 0; x < mov.get_size().x; ++x, ++iforce, ++imask, ++ig, ++iref, ++imov) {
-                                   if (!*imask)
-                                          continue;
-
-                                   auto c_block = prepare_range(mov.get_size(), x, y, m_hw);
-                                   NCCSums sum;
-
-                                   for (unsigned iy = c_block.first.y; iy < c_block.second.y; ++iy) {
-                                          auto ia = mov.begin_at(0, iy);
-                                          auto ib = ref.begin_at(0, iy);
-                                          auto im = m_mask.begin_at(0, iy);
-
-                                          for (unsigned ix = c_block.first.x; ix < c_block.second.x; ++ix) {
-                                                 // make a local copy
-                                                 if (im[ix]) {
-                                                        sum.add(ia[ix], ib[ix]);
-                                                 }
-                                          }
-                                   }
-
-                                   if (sum.has_samples()) {
-                                          auto res = sum.get_grad_helper();
+                            for (size_t i = y * size.x; i < (y + 1) * size.x; ++i, ++iforce, ++imask, ++ig, ++iref, ++imov) {
+                                   if (*imask && window.get_count(i) > 0) {
+                                          auto res = window[i].get_grad_helper();
                                           lresult += res.first;
-                                          *iforce = res.second.get_gradient_scale(*imov, *iref) * *ig;
+                                          *iforce = res.second.get_gradient_scale(*imov - offset_a, *iref - offset_b) * *ig;
                                           ++count;
                                    }
                             }
@@ -200,7 +150,7 @@ public:
                      return make_pair(result.first + lresult, result.second + count);
               };
               pair<float, int> init{0, 0};
-              auto r = preduce(C1DParallelRange(0, mov.get_size().y, 1), init, evaluate_local_cost_force,
+              auto r = preduce(C1DParallelRange(0, size.y, 1), init, evaluate_local_cost_force,
               [](const pair<float, int>& x, const pair<float, int>& y) {
                      return make_pair(x.first + y.first, x.second + y.second);
               });
@@ -215,22 +165,26 @@ double CLNCC2DImageCost::do_evaluate_force(const Data& a, const Data& b, const M
        auto b_double_ptr = m_copy_to_double->filter(b);
        const auto& mov = static_cast<const C2DDImage&>(*a_double_ptr);
        const auto& ref = static_cast<const C2DDImage&>(*b_double_ptr);
-       FEvalCostForce ecostforce(m_hwidth, m, force);
+       FEvalCostForce ecostforce(m_hwidth, m_brute_force, m, force);
        return ecostforce(mov, ref);
 }
 
 
 CLNCC2DImageCostPlugin::CLNCC2DImageCostPlugin():
        C2DMaskedImageCostPlugin("lncc"),
-       m_hw(5)
+       m_hw(5),
+       m_brute_force(false)
 {
        this->add_parameter("w", make_ci_param(m_hw, 1, 256, false,
                                               "half width of the window used for evaluating the localized cross correlation"));
+       this->add_parameter("brute-force", make_param(m_brute_force, false,
+                           "evaluate the window sums by visiting all pixels of each window, "
+                           "this is slow and only meant for testing"));
 }
 
 C2DMaskedImageCost *CLNCC2DImageCostPlugin::do_create() const
 {
-       return new CLNCC2DImageCost(m_hw);
+       return new CLNCC2DImageCost(m_hw, m_brute_force);
 }
 
 const std::string CLNCC2DImageCostPlugin::do_get_descr() const
@@ -35,12 +35,13 @@ public:
        typedef mia::C2DMaskedImageCost::Force Force;
        typedef mia::C2DMaskedImageCost::Mask Mask;
 
-       CLNCC2DImageCost(int hw);
+       CLNCC2DImageCost(int hw, bool brute_force);
 private:
        virtual double do_value(const Data& a, const Data& b, const Mask& m) const;
        virtual double do_evaluate_force(const Data& a, const Data& b, const Mask& m, Force& force) const;
        mia::P2DFilter m_copy_to_double;
        int m_hwidth;
+       bool m_brute_force;
 };
 
 class CLNCC2DImageCostPlugin: public mia::C2DMaskedImageCostPlugin
@@ -51,6 +52,7 @@ public:
 private:
        const std::string do_get_descr() const;
        unsigned int m_hw;
+       bool m_brute_force;
 };
 
 NS_END
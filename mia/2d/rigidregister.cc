@@ -23,7 +23,10 @@
 #include <mia/2d/rigidregister.hh>
 #include <mia/2d/filter.hh>
 #include <mia/2d/transformfactory.hh>
+#include <mia/2d/imagepyramid.hh>
 #include <mia/core/filter.hh>
+#include <mia/core/bufferpool.hh>
+#include <mia/core/parallel.hh>
 
 
 NS_MIA_BEGIN
@@ -47,31 +50,32 @@ private:
 class C2DRegGradientProblem: public CMinimizer::Problem
 {
 public:
-       C2DRegGradientProblem(const C2DImage& model, C2DTransformation& transf, const C2DImageCost& m_cost);
+       C2DRegGradientProblem(const C2DImage& model, const C2DImage& reference,
+                             C2DTransformation& transf, const C2DImageCost& m_cost);
 private:
        void    do_df(const CDoubleVector& x, CDoubleVector&  g);
        double  do_fdf(const CDoubleVector& x, CDoubleVector&  g);
-protected:
        P2DImage apply(const CDoubleVector& x);
        double  do_f(const CDoubleVector& x);
        size_t do_size() const;
+       double evaluate_gradient(const C2DImage& deformed, const CDoubleVector& x, CDoubleVector&  g);
+       void finite_difference_gradient(const CDoubleVector& x, CDoubleVector&  g);
+
+       struct SEvaluator {
+              P2DTransformation transf;
+              P2DImageCost cost;
+       };
+       SEvaluator *acquire_evaluator();
+       void release_evaluator(SEvaluator *evaluator);
 
        const C2DImage& m_model;
+       const C2DImage& m_reference;
        C2DTransformation& m_transf;
        const C2DImageCost& m_cost;
-};
-typedef shared_ptr<C2DRegGradientProblem> P2DGradientProblem;
-
-
-class C2DRegFakeGradientProblem: public C2DRegGradientProblem
-{
-public:
-       C2DRegFakeGradientProblem(const C2DImage& model, C2DTransformation& transf,
-                                 const C2DImageCost& m_cost);
-private:
-       void    do_df(const CDoubleVector& x, CDoubleVector&  g);
-       double  do_fdf(const CDoubleVector& x, CDoubleVector&  g);
 
+       CMutex m_evaluator_mutex;
+       vector<unique_ptr<SEvaluator>> m_evaluators;
+       vector<SEvaluator *> m_idle_evaluators;
 };
 
 class C2DRegProblem: public CMinimizer::Problem
@@ -106,6 +110,8 @@ C2DRigidRegister::~C2DRigidRegister()
 
 P2DTransformation C2DRigidRegister::run(P2DImage src, P2DImage ref) const
 {
+       // the temporary images of the cost evaluations are re-used
+       CBufferPoolScope pool_scope;
        return impl->run(src, ref);
 }
 
@@ -125,23 +131,13 @@ P2DTransformation C2DRigidRegisterImpl::run(P2DImage src, P2DImage ref) const
        assert(ref);
        assert(src->get_size() == ref->get_size());
        P2DTransformation transform;
-       int x_shift = m_mg_levels + 1;
-       int y_shift = m_mg_levels + 1;
-
-       while (x_shift && y_shift) {
-              if (x_shift)
-                     x_shift--;
-
-              if (y_shift)
-                     y_shift--;
-
-              C2DBounds BlockSize(1 << x_shift, 1 << y_shift);
-              cvinfo() << "Blocksize = " << BlockSize.x << "x" << BlockSize.y << "\n";
-              stringstream downscale_descr;
-              downscale_descr << "downscale:bx=" << BlockSize.x << ",by=" << BlockSize.y;
-              auto downscaler = C2DFilterPluginHandler::instance().produce(downscale_descr.str().c_str());
-              P2DImage src_scaled = x_shift && y_shift ? downscaler->filter(*src) : src;
-              P2DImage ref_scaled = x_shift && y_shift ? downscaler->filter(*ref) : ref;
+       auto src_pyramid = C2DImagePyramid::get_shared(src, m_mg_levels + 1);
+       auto ref_pyramid = C2DImagePyramid::get_shared(ref, m_mg_levels + 1);
+
+       for (int level = m_mg_levels; level >= 0; --level) {
+              cvinfo() << "Pyramid level = " << level << "\n";
+              P2DImage src_scaled = src_pyramid->get_level(level);
+              P2DImage ref_scaled = ref_pyramid->get_level(level);
               m_cost->set_reference(*ref_scaled);
 
               if (transform)
@@ -151,7 +147,7 @@ P2DTransformation C2DRigidRegisterImpl::run(P2DImage src, P2DImage ref) const
 
               cvmsg() << "register at " << src_scaled->get_size() << "\n";
               CMinimizer::PProblem gp = m_minimizer->has(property_gradient) ?
-                                        CMinimizer::PProblem(new C2DRegFakeGradientProblem(*src_scaled, *transform, *m_cost)) :
+                                        CMinimizer::PProblem(new C2DRegGradientProblem(*src_scaled, *ref_scaled, *transform, *m_cost)) :
                                         CMinimizer::PProblem(new C2DRegProblem(*src_scaled, *transform, *m_cost));
               m_minimizer->set_problem(gp);
               auto x = transform->get_parameters();
@@ -169,9 +165,45 @@ P2DTransformation C2DRigidRegisterImpl::run(P2DImage src, P2DImage ref) const
        return transform;
 }
 
-C2DRegGradientProblem::C2DRegGradientProblem(const C2DImage& model, C2DTransformation& transf,
-              const C2DImageCost& cost):
+/*
+  The cost function evaluates the force with respect to the deformed image, i.e. in the
+  coordinates of the reference image, but C2DTransformation::translate expects the
+  gradient with respect to the transformed coordinates. For a linear transformation with
+  the Jacobian J the latter is J^{-T} times the force, and this matrix is evaluated here.
+  Returns false if the transformation is not linear or J is singular.
+*/
+static bool get_force_mapping(const C2DTransformation& t, C2DFMatrix& mapping)
+{
+       const C2DBounds& size = t.get_size();
+       const C2DFVector step(size.x > 1 ? size.x - 1 : 1,
+                             size.y > 1 ? size.y - 1 : 1);
+       const C2DFVector origin = t(C2DFVector::_0);
+       // the columns of the Jacobian
+       const C2DFVector dx = (t(C2DFVector(step.x, 0)) - origin) / step.x;
+       const C2DFVector dy = (t(C2DFVector(0, step.y)) - origin) / step.y;
+       const C2DFVector test_points[2] = {step, 0.5f * step};
+
+       for (auto& p : test_points) {
+              const C2DFVector linear = origin + p.x * dx + p.y * dy;
+
+              if ((t(p) - linear).norm() > 0.01)
+                     return false;
+       }
+
+       const float det = dx.x * dy.y - dy.x * dx.y;
+
+       if (std::fabs(det) < 1e-6)
+              return false;
+
+       // the rows of J^{-T}
+       mapping = C2DFMatrix(C2DFVector(dy.y, -dx.y) / det, C2DFVector(-dy.x, dx.x) / det);
+       return true;
+}
+
+C2DRegGradientProblem::C2DRegGradientProblem(const C2DImage& model, const C2DImage& reference,
+              C2DTransformation& transf, const C2DImageCost& cost):
        m_model(model),
+       m_reference(reference),
        m_transf(transf),
        m_cost(cost)
 {
@@ -206,58 +238,95 @@ double  C2DRegGradientProblem::do_f(const CDoubleVector& x)
 void    C2DRegGradientProblem::do_df(const CDoubleVector& x, CDoubleVector&  g)
 {
        P2DImage temp = apply(x);
-       C2DFVectorfield gradient(m_model.get_size());
-       m_cost.evaluate_force(*temp, gradient);
-       transform(gradient.begin(), gradient.end(), gradient.begin(),
-       [](const C2DFVector & x) {
-              return -1.0f * x;
-       });
-       m_transf.translate(gradient, g);
+       evaluate_gradient(*temp, x, g);
 }
 
 double  C2DRegGradientProblem::do_fdf(const CDoubleVector& x, CDoubleVector&  g)
 {
        P2DImage temp = apply(x);
-       C2DFVectorfield gradient(m_model.get_size());
-       double result = m_cost.evaluate_force(*temp, gradient);
-       transform(gradient.begin(), gradient.end(), gradient.begin(),
-       [](const C2DFVector & x) {
-              return -1.0f * x;
-       });
+       const double value = evaluate_gradient(*temp, x, g);
+       cvmsg() << "\rCost = " << value;
+       return value;
+}
+
+double C2DRegGradientProblem::evaluate_gradient(const C2DImage& deformed, const CDoubleVector& x,
+              CDoubleVector&  g)
+{
+       C2DFMatrix mapping;
+
+       if (!get_force_mapping(m_transf, mapping)) {
+              cvinfo() << "Transformation is not linear, use finite differences\n";
+              finite_difference_gradient(x, g);
+              return m_cost.value(deformed);
+       }
+
+       C2DFVectorfield gradient(m_transf.get_size());
+       const double value = m_cost.evaluate_force(deformed, gradient);
+       auto map_rows = [&gradient, &mapping](const C1DParallelRange & range) {
+              for (auto y = range.begin(); y != range.end(); ++y)
+                     transform(gradient.begin_at(0, y), gradient.begin_at(0, y + 1),
+                               gradient.begin_at(0, y),
+              [&mapping](const C2DFVector & f) {
+                     return C2DFVector(dot(mapping.x, f), dot(mapping.y, f));
+              });
+       };
+       pfor(C1DParallelRange(0, gradient.get_size().y, 1), map_rows);
        m_transf.translate(gradient, g);
+       return value;
+}
+
+C2DRegGradientProblem::SEvaluator *C2DRegGradientProblem::acquire_evaluator()
+{
+       CScopedLock lock(m_evaluator_mutex);
+
+       if (m_idle_evaluators.empty()) {
+              // the cost functions are not thread safe, hence each evaluator gets its own copy
+              unique_ptr<SEvaluator> evaluator(new SEvaluator);
+              evaluator->transf.reset(m_transf.clone());
+              evaluator->cost = C2DImageCostPluginHandler::instance().produce(m_cost.get_init_string());
+              evaluator->cost->set_reference(m_reference);
+              m_idle_evaluators.push_back(evaluator.get());
+              m_evaluators.push_back(move(evaluator));
+       }
+
+       auto result = m_idle_evaluators.back();
+       m_idle_evaluators.pop_back();
        return result;
 }
 
-C2DRegFakeGradientProblem::C2DRegFakeGradientProblem(const C2DImage& model,
-              C2DTransformation& transf, const C2DImageCost& m_cost):
-       C2DRegGradientProblem(model, transf,  m_cost)
+void C2DRegGradientProblem::release_evaluator(SEvaluator *evaluator)
 {
-       add(property_gradient);
+       CScopedLock lock(m_evaluator_mutex);
+       m_idle_evaluators.push_back(evaluator);
 }
 
-void C2DRegFakeGradientProblem::do_df(const CDoubleVector& x, CDoubleVector&  g)
+void C2DRegGradientProblem::finite_difference_gradient(const CDoubleVector& x, CDoubleVector&  g)
 {
-       CDoubleVector x_tmp(x.size());
-       copy(x.begin(), x.end(), x_tmp.begin());
+       // central differences, the cost values at x + delta e_i and x - delta e_i are
+       // stored in cost_values[2i] and cost_values[2i+1] respectively
+       vector<double> cost_values(2 * g.size());
+       auto evaluate = [this, &x, &cost_values](const C1DParallelRange & range) {
+              auto evaluator = acquire_evaluator();
+              CDoubleVector x_tmp(x.size());
+
+              for (auto k = range.begin(); k != range.end(); ++k) {
+                     copy(x.begin(), x.end(), x_tmp.begin());
+                     x_tmp[k / 2] += (k & 1) ? -0.01 : 0.01;
+                     evaluator->transf->set_parameters(x_tmp);
+                     P2DImage temp = (*evaluator->transf)(m_model);
+                     cost_values[k] = evaluator->cost->value(*temp);
+              }
+
+              release_evaluator(evaluator);
+       };
+       pfor(C1DParallelRange(0, cost_values.size(), 1), evaluate);
 
        for (size_t i = 0; i < g.size(); ++i) {
-              x_tmp[i] += 0.01;
-              double cost_p = do_f(x_tmp);
-              x_tmp[i] -= 0.02;
-              double cost_m = do_f(x_tmp);
-              x_tmp[i] += 0.01;
-              g[i] = (cost_p - cost_m) * 50.0;
+              g[i] = (cost_values[2 * i] - cost_values[2 * i + 1]) * 50.0;
               cvdebug() << "g[" << i << "] = " << g[i] << "\n";
        }
 }
 
-double  C2DRegFakeGradientProblem::do_fdf(const CDoubleVector& x, CDoubleVector&  g)
-{
-       double cost_value = do_f(x);
-       do_df(x, g);
-       return cost_value;
-}
-
 C2DRegProblem::C2DRegProblem(const C2DImage& model, C2DTransformation& transf,
                              const C2DImageCost& cost):
        m_model(model),
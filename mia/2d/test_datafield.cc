@@ -74,3 +74,18 @@ BOOST_AUTO_TEST_CASE( test_2ddatafield )
        BOOST_CHECK(data3(2, 2) == 6);
 }
 
+BOOST_AUTO_TEST_CASE( test_2ddatafield_move_leaves_consistent_source )
+{
+       C2DFDatafield a(C2DBounds(5, 4));
+       C2DFDatafield b(C2DBounds(3, 2));
+       b = std::move(a);
+       BOOST_CHECK_EQUAL(b.get_size(), C2DBounds(5, 4));
+       BOOST_CHECK_EQUAL(b.size(), 20u);
+       // the moved-from field holds the former data of the target
+       BOOST_CHECK_EQUAL(a.get_size(), C2DBounds(3, 2));
+       BOOST_CHECK_EQUAL(a.size(), 6u);
+       C2DFDatafield c(std::move(b));
+       BOOST_CHECK_EQUAL(c.size(), 20u);
+       BOOST_CHECK_EQUAL(b.get_size(), C2DBounds(0, 0));
+       BOOST_CHECK_EQUAL(b.size(), 0u);
+}
@@ -0,0 +1,65 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <mia/internal/autotest.hh>
+#include <mia/2d/imagepyramid.hh>
+
+NS_MIA_USE
+using namespace std;
+
+BOOST_AUTO_TEST_CASE( test_pyramid_level_sizes )
+{
+       P2DImage image(new C2DFImage(C2DBounds(33, 9)));
+       image->set_pixel_size(C2DFVector(1.0, 3.0));
+       C2DImagePyramid pyramid(image, 3);
+       BOOST_CHECK_EQUAL(pyramid.get_levels(), 3u);
+       BOOST_CHECK(pyramid.get_level(0) == image);
+       BOOST_CHECK_EQUAL(pyramid.get_level(1)->get_size(), C2DBounds(16, 4));
+       BOOST_CHECK_EQUAL(pyramid.get_level(2)->get_size(), C2DBounds(8, 2));
+       BOOST_CHECK_EQUAL(pyramid.get_level(1)->get_pixel_size(), C2DFVector(33.0f / 16.0f, 27.0f / 4.0f));
+       BOOST_CHECK(pyramid.get_image(C2DBounds(8, 2)) == pyramid.get_level(2));
+}
+
+BOOST_AUTO_TEST_CASE( test_pyramid_reduce_values )
+{
+       C2DFImage image(C2DBounds(8, 3));
+       auto i = image.begin();
+
+       for (size_t y = 0; y < 3; ++y)
+              for (size_t x = 0; x < 8; ++x, ++i)
+                     *i = x + 8 * y;
+
+       auto reduced = C2DImagePyramid::reduce(image);
+       BOOST_REQUIRE_EQUAL(reduced->get_size(), C2DBounds(4, 1));
+       const C2DFImage& r = dynamic_cast<const C2DFImage&>(*reduced);
+       // the rows 0, 0, 1, 2 are combined with the weights [1 3 3 1]/8
+       const float expect[4] = {0.625f + 5, 2.5f + 5, 4.5f + 5, 6.375f + 5};
+
+       for (size_t x = 0; x < 4; ++x)
+              BOOST_CHECK_CLOSE(r(x, 0), expect[x], 0.0001);
+}
+
+BOOST_AUTO_TEST_CASE( test_pyramid_shared )
+{
+       P2DImage image(new C2DFImage(C2DBounds(16, 16)));
+       auto pyramid = C2DImagePyramid::get_shared(image, 2);
+       BOOST_CHECK(C2DImagePyramid::get_shared(image) == pyramid);
+       BOOST_CHECK(C2DImagePyramid::get_shared(P2DImage(new C2DFImage(C2DBounds(16, 16)))) != pyramid);
+}
@@ -120,6 +120,17 @@ BOOST_FIXTURE_TEST_CASE( test_rigidreg_affine_simplex, RigidRegisterFixture )
        run(*transformation, "gsl:opt=simplex,step=1.0,eps=0.0001", 1.0);
 }
 
+BOOST_FIXTURE_TEST_CASE( test_rigidreg_translate_gdsq, RigidRegisterFixture )
+{
+       auto tr_creator = C2DTransformCreatorHandler::instance().produce("translate");
+       auto transformation = tr_creator->create(size);
+       auto params = transformation->get_parameters();
+       params[0] = 1.0;
+       params[1] = 1.0;
+       transformation->set_parameters(params);
+       run(*transformation, "gdsq:maxiter=1000", 1.0);
+}
+
 #ifdef HAVE_NLOPT
 
 BOOST_FIXTURE_TEST_CASE( test_rigidreg_translate_gd, RigidRegisterFixture )
@@ -20,6 +20,7 @@
 
 #include <mia/2d/transform.hh>
 #include <mia/2d/deformer.hh>
+#include <mia/core/profiling.hh>
 
 NS_MIA_BEGIN
 using namespace std;
@@ -30,6 +31,18 @@ C2DTransformation::C2DTransformation(const C2DInterpolatorFactory& ipf):
 {
 }
 
+void C2DTransformation::translate_sparse(const std::vector<size_t>& indices,
+                const std::vector<C2DFVector>& gradient, CDoubleVector& params) const
+{
+       assert(indices.size() == gradient.size());
+       C2DFVectorfield field(get_size());
+
+       for (size_t i = 0; i < indices.size(); ++i)
+              field[indices[i]] += gradient[i];
+
+       translate(field, params);
+}
+
 void C2DTransformation::set_creator_string(const std::string& s)
 {
        m_creator_string = s;
@@ -290,6 +303,7 @@ private:
 
 P2DImage C2DTransformation::do_transform(const C2DImage& image, const C2DInterpolatorFactory& ipf) const
 {
+       MIA_PROFILE_SCOPE("transform", get_creator_string().c_str());
        return mia::filter(F2DTransform(ipf, *this), image);
 }
 
@@ -308,6 +308,18 @@ public:
         */
        virtual void translate(const C2DFVectorfield& gradient, CDoubleVector& params) const = 0;
 
+       /**
+          Translate a gradient that is only given at a sparse set of grid positions, i.e.
+          the result is the same like calling translate with a vector field that is zero
+          everywhere but at these positions. The default implementation creates this field,
+          transformations with a cheaper evaluation should override this method.
+          \param indices linear indices of the grid positions, an index may be given more than once
+          \param gradient the gradient at these positions
+          \param[out] params the gradient with respect to the transformation parameters
+        */
+       virtual void translate_sparse(const std::vector<size_t>& indices, const std::vector<C2DFVector>& gradient,
+                                     CDoubleVector& params) const;
+
        /**
           \returns the transformation parameters as a flat value array
         */
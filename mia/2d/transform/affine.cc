@@ -20,6 +20,7 @@
 
 #include <fstream>
 #include <mia/core/msgstream.hh>
+#include <mia/core/parallel.hh>
 #include <mia/2d/transformfactory.hh>
 
 #include <mia/2d/transform/affine.hh>
@@ -222,22 +223,38 @@ float C2DAffineTransformation::get_jacobian(const C2DFVectorfield& /*v*/, float
 
 void C2DAffineTransformation::translate(const C2DFVectorfield& gradient, CDoubleVector& params) const
 {
+       typedef vector<double> dvect;
        assert(gradient.get_size() == m_size);
        assert(params.size() == degrees_of_freedom());
-       vector<double> r(params.size(), 0.0);
-       auto g = gradient.begin();
-
-       for (size_t y = 0; y < m_size.y; ++y) {
-              for (size_t x = 0; x < m_size.x; ++x, ++g) {
-                     r[0] += x * g->x;
-                     r[1] += y * g->x;
-                     r[2] += g->x;
-                     r[3] += x * g->y;
-                     r[4] += y * g->y;
-                     r[5] += g->y;
+       auto sumrows = [&gradient, this]
+       (const C1DParallelRange & range, dvect r)->dvect{
+              for (auto y = range.begin(); y != range.end(); ++y)
+              {
+                     auto g = gradient.begin_at(0, y);
+
+                     for (size_t x = 0; x < m_size.x; ++x, ++g) {
+                            r[0] += x * g->x;
+                            r[1] += y * g->x;
+                            r[2] += g->x;
+                            r[3] += x * g->y;
+                            r[4] += y * g->y;
+                            r[5] += g->y;
+                     }
               }
-       }
 
+              return r;
+       };
+       auto sum_parts = [] (const dvect & a, const dvect & b) -> dvect {
+              dvect result(a.size());
+              std::transform(a.begin(), a.end(), b.begin(), result.begin(),
+                             [](double x, double y)
+              {
+                     return x + y;
+              });
+              return result;
+       };
+       dvect init(params.size(), 0.0);
+       auto r = preduce( C1DParallelRange(0, m_size.y, 1), init, sumrows, sum_parts);
        std::copy(r.begin(), r.end(), params.begin());
 }
 
@@ -20,6 +20,7 @@
 
 #include <fstream>
 #include <mia/core/msgstream.hh>
+#include <mia/core/parallel.hh>
 #include <mia/2d/transform/rigid.hh>
 
 
@@ -242,24 +243,49 @@ float C2DRigidTransformation::get_jacobian(const C2DFVectorfield& /*v*/, float /
 
 void C2DRigidTransformation::translate(const C2DFVectorfield& gradient, CDoubleVector& params) const
 {
-       //
+       typedef vector<double> dvect;
        assert(gradient.get_size() == m_size);
        assert(params.size() == degrees_of_freedom());
-       vector<double> r(params.size(), 0.0);
-       auto g = gradient.begin();
-       double fy = - m_rot_center.y;
-
-       for (size_t y = 0; y < m_size.y; ++y, fy += 1.0) {
-              double fx = - m_rot_center.x;
-
-              for (size_t x = 0; x < m_size.x; ++x, fx += 1.0, ++g) {
-                     r[0] += g->x;
-                     r[1] += g->y;
-                     r[2] += - fy * g->x + fx * g->y;
+       // accumulate sum_x g(x) and the moments sum_x g_i(x) * (x - c)_j, since the
+       // derivative of the rotation is linear in x - c
+       auto sumrows = [&gradient, this]
+       (const C1DParallelRange & range, dvect r)->dvect{
+              double fy = range.begin() - m_rot_center.y;
+
+              for (auto y = range.begin(); y != range.end(); ++y, fy += 1.0)
+              {
+                     auto g = gradient.begin_at(0, y);
+                     double fx = - m_rot_center.x;
+
+                     for (size_t x = 0; x < m_size.x; ++x, fx += 1.0, ++g) {
+                            r[0] += g->x;
+                            r[1] += g->y;
+                            r[2] += g->x * fx;
+                            r[3] += g->x * fy;
+                            r[4] += g->y * fx;
+                            r[5] += g->y * fy;
+                     }
               }
-       }
 
-       copy(r.begin(), r.end(), params.begin());
+              return r;
+       };
+       auto sum_parts = [] (const dvect & a, const dvect & b) -> dvect {
+              dvect result(a.size());
+              std::transform(a.begin(), a.end(), b.begin(), result.begin(),
+                             [](double x, double y)
+              {
+                     return x + y;
+              });
+              return result;
+       };
+       dvect init(6, 0.0);
+       auto m = preduce( C1DParallelRange(0, m_size.y, 1), init, sumrows, sum_parts);
+       // derivative of the rotation matrix (see evaluate_matrix) at the current angle
+       const double cosa = cos(m_rotation);
+       const double sina = sin(m_rotation);
+       params[0] = m[0];
+       params[1] = m[1];
+       params[2] = - sina * m[2] - cosa * m[3] + cosa * m[4] - sina * m[5];
 }
 
 
@@ -26,6 +26,7 @@
 #include <mia/2d/transform/spline.hh>
 #include <mia/2d/transform/vectorfield.hh>
 #include <mia/2d/transformfactory.hh>
+#include <mia/core/parallel.hh>
 
 
 NS_MIA_BEGIN
@@ -542,37 +543,48 @@ void C2DSplineTransformation::translate(const C2DFVectorfield& gradient, CDouble
        TRACE_FUNCTION;
        assert(params.size() == m_coefficients.size() * 2);
        assert(gradient.get_size() == m_range);
-       C2DFVectorfield tmp(C2DBounds(gradient.get_size().x, m_coefficients.get_size().y));
-       vector<C2DFVector> in_buffer(gradient.get_size().y);
-       vector<C2DFVector> out_buffer(m_coefficients.get_size().y);
-
-       for (size_t ix = 0; ix < gradient.get_size().x; ++ix) {
-              gradient.get_data_line_y(ix, in_buffer);
-
-              for (size_t i = 0; i < m_coefficients.get_size().y; ++i) {
-                     const CSplineDerivativeRow::value_type& myrow = m_my[i];
-                     out_buffer[i] = inner_product(myrow.second.begin(), myrow.second.end(),
-                                                   in_buffer.begin() + myrow.first, C2DFVector());
+       const C2DBounds csize = m_coefficients.get_size();
+       const size_t nx = gradient.get_size().x;
+       // the intermediate field is shared between calls and only re-allocated if its size changes
+       CScopedLock lock(m_translate_mutex);
+       C2DFVectorfield& tmp = m_translate_ypass;
+
+       if (tmp.get_size() != C2DBounds(nx, csize.y))
+              tmp = C2DFVectorfield(C2DBounds(nx, csize.y));
+
+       // y convolution, complete rows are accumulated to avoid gathering the strided y-lines
+       auto filter_y = [this, &gradient, &tmp, nx](const C1DParallelRange & range) {
+              for (auto iy = range.begin(); iy != range.end(); ++iy) {
+                     const CSplineDerivativeRow::value_type& myrow = m_my[iy];
+                     int i = myrow.first;
+                     auto out = tmp.begin_at(0, iy);
+                     fill(out, out + nx, C2DFVector::_0);
+
+                     for (auto w  = myrow.second.begin(); w != myrow.second.end(); ++w, ++i) {
+                            auto in = gradient.begin_at(0, i);
+
+                            for (size_t x = 0; x < nx; ++x)
+                                   out[x] += *w * in[x];
+                     }
               }
-
-              tmp.put_data_line_y(ix, out_buffer);
-       }
-
-       in_buffer.resize(gradient.get_size().x);
+       };
+       pfor(C1DParallelRange(0, csize.y, 1), filter_y);
        // x convolution and copy to output
-       auto r = params.begin();
-
-       for (size_t iy = 0; iy < m_coefficients.get_size().y; ++iy) {
-              tmp.get_data_line_x(iy, in_buffer);
-
-              for (size_t x = 0; x < m_coefficients.get_size().x; ++x, r += 2) {
-                     const CSplineDerivativeRow::value_type& mxrow = m_mx[x];
-                     const C2DFVector v = inner_product(mxrow.second.begin(), mxrow.second.end(),
-                                                        in_buffer.begin() + mxrow.first, C2DFVector());
-                     r[0] = -v.x;
-                     r[1] = -v.y;
+       auto filter_x = [this, &tmp, &csize, &params](const C1DParallelRange & range) {
+              for (auto iy = range.begin(); iy != range.end(); ++iy) {
+                     auto in = tmp.begin_at(0, iy);
+                     auto r = params.begin() + 2 * csize.x * iy;
+
+                     for (size_t x = 0; x < csize.x; ++x, r += 2) {
+                            const CSplineDerivativeRow::value_type& mxrow = m_mx[x];
+                            const C2DFVector v = inner_product(mxrow.second.begin(), mxrow.second.end(),
+                                                               in + mxrow.first, C2DFVector());
+                            r[0] = -v.x;
+                            r[1] = -v.y;
+                     }
               }
-       }
+       };
+       pfor(C1DParallelRange(0, csize.y, 1), filter_x);
 }
 
 float  C2DSplineTransformation::pertuberate(C2DFVectorfield& v) const
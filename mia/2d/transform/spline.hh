@@ -25,6 +25,7 @@
 #include <mia/2d/transformfactory.hh>
 #include <mia/2d/splinetransformpenalty.hh>
 #include <mia/2d/ppmatrix.hh>
+#include <mia/core/parallel.hh>
 
 
 NS_MIA_BEGIN
@@ -128,6 +129,9 @@ private:
        std::vector<int> m_y_indices;
        CSplineDerivativeRow  m_mx;
        CSplineDerivativeRow  m_my;
+       // intermediate field of translate, kept to avoid re-allocating it
+       mutable C2DFVectorfield m_translate_ypass;
+       mutable CMutex m_translate_mutex;
 
        PSplineBoundaryCondition m_xbc;
        PSplineBoundaryCondition m_ybc;
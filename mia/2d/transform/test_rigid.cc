@@ -253,6 +253,45 @@ BOOST_FIXTURE_TEST_CASE (test_inverse_rigid, ipfFixture)
        BOOST_CHECK_EQUAL(b[2], -1.0);
 }
 
+BOOST_FIXTURE_TEST_CASE (test_rotated_translate_field_rigid, ipfFixture)
+{
+       C2DBounds size(9, 10);
+       C2DRigidTransformation t(size, C2DFVector(1.0, -2.0), 0.7, C2DFVector(0.4, 0.6), ipf);
+       C2DFVectorfield field(size);
+       auto ifield = field.begin();
+
+       for (size_t y = 0; y < size.y; ++y)
+              for (size_t x = 0; x < size.x; ++x, ++ifield)
+                     *ifield = C2DFVector(1.0 + 0.1 * x, 0.03 * x * y - 0.5);
+
+       CDoubleVector grad(t.degrees_of_freedom());
+       t.translate(field, grad);
+       // compare to the numerical derivative of sum_x field(x) * t(x)
+       auto projection = [&field, &size](const C2DTransformation & t) {
+              double result = 0.0;
+              auto ifield = field.begin();
+
+              for (size_t y = 0; y < size.y; ++y)
+                     for (size_t x = 0; x < size.x; ++x, ++ifield)
+                            result += dot(*ifield, t(C2DFVector(x, y)));
+
+              return result;
+       };
+       auto params = t.get_parameters();
+
+       for (size_t i = 0; i < params.size(); ++i) {
+              CDoubleVector p(params.size());
+              copy(params.begin(), params.end(), p.begin());
+              p[i] += 0.01;
+              t.set_parameters(p);
+              const double plus = projection(t);
+              p[i] -= 0.02;
+              t.set_parameters(p);
+              const double minus = projection(t);
+              BOOST_CHECK_CLOSE(grad[i], (plus - minus) / 0.02, 0.1);
+       }
+}
+
 struct RigidCenteredFixture : public ipfFixture {
        RigidCenteredFixture();
        C2DBounds size;
@@ -31,88 +31,61 @@ using std::vector;
 using std::pair;
 using std::make_pair;
 
-CLNCC3DImageCost::CLNCC3DImageCost(int hw):
-       m_hwidth(hw)
+CLNCC3DImageCost::CLNCC3DImageCost(int hw, bool brute_force):
+       m_hwidth(hw),
+       m_brute_force(brute_force)
 {
        m_copy_to_double = produce_3dimage_filter("convert:repn=double,map=copy");
 }
 
-inline pair<C3DBounds, C3DBounds> prepare_range(const C3DBounds& size, int cx, int cy, int cz, int hw)
+/*
+  The window sums are obtained by CNCCSlidingWindow, hence the cost doesn't depend on the
+  window size. Each work package moves the window through a contiguous range of slices,
+  and initializing the window at the start of a package costs as much as moving it
+  through 2hw+1 slices. Therefore, the volume is split into one slab per task.
+*/
+inline int get_block_size(int nz)
 {
-       int zb = cz - hw;
-
-       if (zb < 0) zb = 0;
-
-       unsigned ze = cz + hw + 1;
-
-       if (ze > size.z) ze = size.z;
-
-       int yb = cy - hw;
-
-       if (yb < 0) yb = 0;
-
-       unsigned ye = cy + hw + 1;
-
-       if (ye > size.y) ye = size.y;
-
-       int xb = cx - hw;
-
-       if (xb < 0) xb = 0;
-
-       unsigned xe = cx + hw + 1;
-
-       if (xe > size.x) xe = size.x;
-
-       return make_pair(C3DBounds(xb, yb, zb), C3DBounds(xe, ye, ze));
+       const int n_tasks = get_max_parallel_tasks();
+       return std::max(1, (nz + n_tasks - 1) / n_tasks);
 }
 
-
-
 class FEvalCost : public TFilter<float>
 {
        int m_hw;
+       bool m_brute_force;
 public:
-       FEvalCost(int hw):
-              m_hw(hw)
+       FEvalCost(int hw, bool brute_force):
+              m_hw(hw),
+              m_brute_force(brute_force)
        {}
 
        float operator () ( const C3DDImage& mov, const C3DDImage& ref) const
        {
-              auto evaluate_local_cost = [this, &mov, &ref](const C1DParallelRange & range, const pair<float, int>& result) -> pair<float, int> {
+              const C3DBounds& size = mov.get_size();
+              auto evaluate_local_cost = [this, &mov, &ref, &size](const C1DParallelRange & range, const pair<float, int>& result) -> pair<float, int> {
                      CThreadMsgStream msks;
                      float lresult = 0.0;
                      int count = 0;
+                     const size_t slice_size = size.x * size.y;
+                     CNCCSlidingWindow window(&mov[0], &ref[0], nullptr, size.x, size.y, size.z, m_hw, m_brute_force);
 
                      for (auto z = range.begin(); z != range.end(); ++z)
                      {
-                            for (size_t y = 0; y < mov.get_size().y; ++y)
-                                   for (size_t x = 0; x < mov.get_size().x; ++x) {
-                                          auto c_block = prepare_range(mov.get_size(), x, y, z, m_hw);
-                                          auto ia = mov.begin_range(c_block.first, c_block.second);
-                                          auto ea = mov.end_range(c_block.first, c_block.second);
-                                          auto ib = ref.begin_range(c_block.first, c_block.second);
-                                          auto delta_size = c_block.second - c_block.first;
-                                          auto n = delta_size.product();
-
-                                          if (n > 1) {
-                                                 NCCSums sum;
-
-                                                 while (ia != ea) {
-                                                        sum.add(*ia, *ib);
-                                                        ++ia;
-                                                        ++ib;
-                                                 }
-
-                                                 lresult += sum.value();
-                                                 ++count;
-                                          }
+                            window.set_slice(z);
+
+                            for (size_t i = 0; i < slice_size; ++i) {
+                                   if (window.get_count(i) > 1) {
+                                          lresult += window[i].value();
+                                          ++count;
                                    }
+                            }
                      }
 
                      return make_pair(result.first + lresult, result.second + count);
               };
               pair<float, int> init{0, 0};
-              auto r = preduce(C1DParallelRange(0, mov.get_size().z, 1), init, evaluate_local_cost,
+              auto r = preduce(C1DParallelRange(0, size.z, get_block_size(size.z)), init, evaluate_local_cost,
               [](const pair<float, int>& x, const pair<float, int>& y) {
                      return make_pair(x.first + y.first, x.second + y.second);
               });
@@ -123,7 +96,7 @@ public:
 
 double CLNCC3DImageCost::do_value(const Data& a, const Data& b) const
 {
-       FEvalCost ecost(m_hwidth);
+       FEvalCost ecost(m_hwidth, m_brute_force);
        auto a_double_ptr = m_copy_to_double->filter(a);
        auto b_double_ptr = m_copy_to_double->filter(b);
        const C3DDImage& mov = static_cast<const C3DDImage&>(*a_double_ptr);
@@ -135,60 +108,52 @@ double CLNCC3DImageCost::do_value(const Data& a, const Data& b) const
 class FEvalCostForce : public TFilter<float>
 {
        int m_hw;
+       bool m_brute_force;
        C3DFVectorfield& m_force;
 public:
-       FEvalCostForce(int hw, C3DFVectorfield& force):
+       FEvalCostForce(int hw, bool brute_force, C3DFVectorfield& force):
               m_hw(hw),
+              m_brute_force(brute_force),
               m_force(force)
        {}
 
        float operator () ( const C3DDImage& mov, const C3DDImage& ref) const
        {
               auto ag = get_gradient(mov);
-              auto evaluate_local_cost_force = [this, &mov, &ref, &ag](const C1DParallelRange & range,
+              const C3DBounds& size = mov.get_size();
+              auto evaluate_local_cost_force = [this, &mov, &ref, &ag, &size](const C1DParallelRange & range,
               const pair<float, int>& result) -> pair<float, int> {
 
                      CThreadMsgStream msks;
                      float lresult = 0.0;
                      int count = 0;
+                     const size_t slice_size = size.x * size.y;
+                     CNCCSlidingWindow window(&mov[0], &ref[0], nullptr, size.x, size.y, size.z, m_hw, m_brute_force);
+                     const double offset_a = window.get_offset_a();
+                     const double offset_b = window.get_offset_b();
 
                      for (auto z = range.begin(); z != range.end(); ++z)
                      {
+                            window.set_slice(z);
                             auto iforce = m_force.begin_at(0, 0, z);
                             auto ig = ag.begin_at(0, 0, z);
                             auto imov = mov.begin_at(0, 0, z);
                             auto iref = ref.begin_at(0, 0, z);
 
-                            for (size_t y = 0; y < mov.get_size().y; ++y)
-                                   for (size_t x = 0; x < mov.get_size().x; ++x, ++iforce, ++ig, ++iref, ++imov) {
-                                          auto c_block = prepare_range(mov.get_size(), x, y, z, m_hw);
-                                          auto ia = mov.begin_range(c_block.first, c_block.second);
-                                          auto ea = mov.end_range(c_block.first, c_block.second);
-                                          auto ib = ref.begin_range(c_block.first, c_block.second);
-                                          auto delta_size = c_block.second - c_block.first;
-                                          auto n = delta_size.product();
-
-                                          if (n > 1) {
-                                                 NCCSums sum;
-
-                                                 while (ia != ea) {
-                                                        sum.add(*ia, *ib);
-                                                        ++ia;
-                                                        ++ib;
-                                                 }
-
-                                                 auto res = sum.get_grad_helper();
-                                                 lresult += res.first;
-                                                 *iforce = res.second.get_gradient_scale(*imov, *iref) * *ig;
-                                                 ++count;
-                                          }
+                            for (size_t i = 0; i < slice_size; ++i, ++iforce, ++ig, ++iref, ++imov) {
+                                   if (window.get_count(i) > 1) {
+                                          auto res = window[i].get_grad_helper();
+                                          lresult += res.first;
+                                          *iforce = res.second.get_gradient_scale(*imov - offset_a, *iref - offset_b) * *ig;
+                                          ++count;
                                    }
+                            }
                      }
 
                      return make_pair(result.first + lresult, result.second + count);
               };
               pair<float, int> init{0, 0};
-              auto r = preduce(C1DParallelRange(0, mov.get_size().z, 1), init, evaluate_local_cost_force,
+              auto r = preduce(C1DParallelRange(0, size.z, get_block_size(size.z)), init, evaluate_local_cost_force,
               [](const pair<float, int>& x, const pair<float, int>& y) {
                      return make_pair(x.first + y.first, x.second + y.second);
               });
@@ -199,7 +164,7 @@ public:
 
 double CLNCC3DImageCost::do_evaluate_force(const Data& a, const Data& b, Force& force) const
 {
-       FEvalCostForce ecostforce(m_hwidth, force);
+       FEvalCostForce ecostforce(m_hwidth, m_brute_force, force);
        auto a_double_ptr = m_copy_to_double->filter(a);
        auto b_double_ptr = m_copy_to_double->filter(b);
        const C3DDImage& mov = static_cast<const C3DDImage&>(*a_double_ptr);
@@ -210,15 +175,19 @@ double CLNCC3DImageCost::do_evaluate_force(const Data& a, const Data& b, Force&
 
 CLNCC3DImageCostPlugin::CLNCC3DImageCostPlugin():
        C3DImageCostPlugin("lncc"),
-       m_hw(5)
+       m_hw(5),
+       m_brute_force(false)
 {
        this->add_parameter("w", make_ci_param(m_hw, 1, 256, false,
                                               "half width of the window used for evaluating the localized cross correlation"));
+       this->add_parameter("brute-force", make_param(m_brute_force, false,
+                           "evaluate the window sums by visiting all pixels of each window, "
+                           "this is slow and only meant for testing"));
 }
 
 C3DImageCost *CLNCC3DImageCostPlugin::do_create() const
 {
-       return new CLNCC3DImageCost(m_hw);
+       return new CLNCC3DImageCost(m_hw, m_brute_force);
 }
 
 const std::string CLNCC3DImageCostPlugin::do_get_descr() const
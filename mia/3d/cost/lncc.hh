@@ -33,12 +33,13 @@ class CLNCC3DImageCost: public mia::C3DImageCost
 public:
        typedef mia::C3DImageCost::Data Data;
 
-       CLNCC3DImageCost(int hw);
+       CLNCC3DImageCost(int hw, bool brute_force);
 private:
        virtual double do_value(const Data& a, const Data& b) const;
        virtual double do_evaluate_force(const Data& a, const Data& b, Force& force) const;
 
        int m_hwidth;
+       bool m_brute_force;
        mia::P3DFilter m_copy_to_double;
 };
 
@@ -50,6 +51,7 @@ public:
 private:
        const std::string do_get_descr() const;
        unsigned int m_hw;
+       bool m_brute_force;
 };
 
 NS_END
@@ -33,6 +33,7 @@ using namespace mia;
 CNCC3DImageCost::CNCC3DImageCost()
 {
        m_copy_to_double = produce_3dimage_filter("convert:repn=double,map=copy");
+       add(property_sampling);
 }
 
 struct FEvaluateNCCSum {
@@ -137,10 +138,28 @@ double CNCC3DImageCost::do_evaluate_force(const Data& a, const Data& b, Force& f
        return ecostforce(mov, ref);
 }
 
+double CNCC3DImageCost::do_evaluate_samples(const std::vector<float>& src, const std::vector<float>& ref,
+              size_t /*n_voxels*/, std::vector<float>& dsrc) const
+{
+       // the correlation is normalized, hence the sample estimate doesn't need to be scaled
+       NCCSums sum;
+
+       for (size_t i = 0; i < src.size(); ++i)
+              sum.add(src[i], ref[i]);
+
+       auto geval = sum.get_grad_helper();
+       dsrc.resize(src.size());
+
+       for (size_t i = 0; i < src.size(); ++i)
+              dsrc[i] = geval.second.get_gradient_scale(src[i], ref[i]);
+
+       return geval.first;
+}
 
 CNCC3DImageCostPlugin::CNCC3DImageCostPlugin():
        C3DImageCostPlugin("ncc")
 {
+       add_property(property_sampling);
 }
 
 C3DImageCost *CNCC3DImageCostPlugin::do_create() const
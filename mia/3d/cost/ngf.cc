@@ -22,6 +22,7 @@
 #include <mia/3d/nfg.hh>
 
 #include <numeric>
+#include <mia/core/parallel.hh>
 
 NS_BEGIN(ngf_3dimage_cost)
 
@@ -144,13 +145,16 @@ double C3DNFGImageCost::do_value(const mia::C3DImage& a, const mia::C3DImage& /*
 {
        TRACE("CNFG3DImageCost::do_value");
        const C3DFVectorfield ng_a = get_nfg(a);
-       const double sum = inner_product(ng_a.begin(), ng_a.end(), m_ng_ref.begin(), 0.0,
-       [](double x, double y) {
-              return x + y;
-       },
-       [this](const C3DFVector ix, const C3DFVector iy) {
-              return m_evaluator->cost(ix, iy);
-       });
+       auto eval_block = [this, &ng_a](const C1DParallelRange & range, double sum) {
+              auto ia = ng_a.begin() + range.begin();
+              auto ib = m_ng_ref.begin() + range.begin();
+
+              for (auto i = range.begin(); i != range.end(); ++i, ++ia, ++ib)
+                     sum += m_evaluator->cost(*ia, *ib);
+
+              return sum;
+       };
+       const double sum = preduce_ordered(0, ng_a.size(), 16384, 0.0, eval_block, std::plus<double>());
        return 0.5 * sum;
 }
 
@@ -159,22 +163,28 @@ double C3DNFGImageCost::do_evaluate_force(const mia::C3DImage& a,
               mia::C3DFVectorfield& force) const
 {
        const C3DFVectorfield ng_a = get_nfg(a);
-       double sum = 0.0;
-       const int nx = ng_a.get_size().x;
-       const int nxy = nx * ng_a.get_size().y;
-       auto  ia = ng_a.begin_range(C3DBounds::_0, ng_a.get_size()).with_boundary_flag();
-       auto  ie = ng_a.end_range(C3DBounds::_0, ng_a.get_size()).with_boundary_flag();
-       auto ib = m_ng_ref.begin_range(C3DBounds::_0, m_ng_ref.get_size());
-       auto iforce = force.begin_range(C3DBounds::_0, force.get_size());
-
-       while (ia != ie) {
-              C3DFVector help = m_evaluator->grad (nx, nxy, ia, *ib, sum);
-              *iforce = help;
-              ++ia;
-              ++ib;
-              ++iforce;
+       const C3DBounds& size = ng_a.get_size();
+       const int nx = size.x;
+       const int nxy = nx * size.y;
+       // one block per slice, the partial sums are added up in slice order
+       auto eval_slice = [this, &ng_a, &force, &size, nx, nxy](const C1DParallelRange & range, double sum) {
+              const C3DBounds start(0, 0, range.begin());
+              const C3DBounds end(size.x, size.y, range.end());
+              auto  ia = ng_a.begin_range(start, end).with_boundary_flag();
+              auto  ie = ng_a.end_range(start, end).with_boundary_flag();
+              auto ib = m_ng_ref.begin_range(start, end);
+              auto iforce = force.begin_range(start, end);
+
+              while (ia != ie) {
+                     *iforce = m_evaluator->grad (nx, nxy, ia, *ib, sum);
+                     ++ia;
+                     ++ib;
+                     ++iforce;
+              };
+
+              return sum;
        };
-
+       const double sum = preduce_ordered(0, size.z, 1, 0.0, eval_slice, std::plus<double>());
        return 0.5 * sum;
 }
 
@@ -21,6 +21,7 @@
 
 #include <mia/internal/plugintester.hh>
 #include <mia/3d/cost/lncc.hh>
+#include <mia/core/nccsum.hh>
 
 using namespace NS;
 using namespace mia;
@@ -171,3 +172,55 @@ BOOST_AUTO_TEST_CASE( test_lncc_1 )
                      BOOST_CHECK_CLOSE(iv->z, *igz, 0.1);
        }
 }
+
+/*
+  Compare the cost with the result obtained by summing over all pixels of each window,
+  the volume is thick enough to be split into several work packages.
+*/
+BOOST_AUTO_TEST_CASE( test_lncc_matches_brute_force )
+{
+       const C3DBounds size(13, 11, 37);
+       const int hw = 3;
+       auto lncc = BOOST_TEST_create_from_plugin<CLNCC3DImageCostPlugin>("lncc:w=3");
+       C3DFImage src(size);
+       C3DFImage ref(size);
+       int i = 0;
+
+       for (auto is = src.begin(), ir = ref.begin(); is != src.end(); ++is, ++ir, ++i) {
+              *is = 200.0f + (i * 37) % 23;
+              *ir = 100.0f + (i * 13) % 19 + 0.5f * *is;
+       }
+
+       double expect = 0.0;
+       int count = 0;
+
+       for (int z = 0; z < (int)size.z; ++z)
+              for (int y = 0; y < (int)size.y; ++y)
+                     for (int x = 0; x < (int)size.x; ++x) {
+                            NCCSums sums;
+
+                            for (int iz = std::max(0, z - hw); iz < std::min((int)size.z, z + hw + 1); ++iz)
+                                   for (int iy = std::max(0, y - hw); iy < std::min((int)size.y, y + hw + 1); ++iy)
+                                          for (int ix = std::max(0, x - hw); ix < std::min((int)size.x, x + hw + 1); ++ix)
+                                                 sums.add(src(ix, iy, iz), ref(ix, iy, iz));
+
+                            expect += sums.value();
+                            ++count;
+                     }
+
+       expect /= count;
+       lncc->set_reference(ref);
+       BOOST_CHECK_CLOSE(lncc->value(src), expect, 0.01);
+       C3DFVectorfield force(size);
+       BOOST_CHECK_CLOSE(lncc->evaluate_force(src, force), expect, 0.01);
+       // the brute force option of the plug-in must give the same value and force
+       auto brute = BOOST_TEST_create_from_plugin<CLNCC3DImageCostPlugin>("lncc:w=3,brute-force=1");
+       brute->set_reference(ref);
+       BOOST_CHECK_CLOSE(brute->value(src), expect, 0.01);
+       C3DFVectorfield brute_force(size);
+       BOOST_CHECK_CLOSE(brute->evaluate_force(src, brute_force), expect, 0.01);
+
+       for (auto f = force.begin(), b = brute_force.begin(); f != force.end(); ++f, ++b) {
+              BOOST_CHECK_SMALL((*f - *b).norm(), 1e-5f * (1.0f + b->norm()));
+       }
+}
@@ -20,6 +20,7 @@
 
 #include <mia/internal/autotest.hh>
 #include <mia/3d/cost/ssd.hh>
+#include <mia/core/parallel.hh>
 
 
 using namespace std;
@@ -73,3 +74,49 @@ BOOST_AUTO_TEST_CASE( test_SSD_3D )
 }
 
 
+
+#ifndef HAVE_TBB
+/*
+  The partial sums are combined in a fixed order, hence the cost value and the
+  force must not depend on the number of threads. The image is split into five
+  blocks. The run times are measured by the cost benchmarks of mia-benchmarks.
+*/
+BOOST_AUTO_TEST_CASE( test_SSD_3D_thread_count_independent )
+{
+       const C3DBounds size(40, 40, 48);
+       C3DFImage *fsrc = new C3DFImage(size);
+       C3DFImage *fref = new C3DFImage(size);
+       auto isrc = fsrc->begin_range(C3DBounds::_0, size);
+       auto iref = fref->begin();
+
+       for (; isrc != fsrc->end_range(C3DBounds::_0, size); ++isrc, ++iref) {
+              auto p = isrc.pos();
+              *isrc = sin(0.1 * p.x) * cos(0.07 * p.y) + 0.01 * p.z;
+              *iref = cos(0.09 * p.x) * sin(0.05 * p.z) + 0.02 * p.y;
+       }
+
+       P3DImage src(fsrc);
+       P3DImage ref(fref);
+       C3DSSDCost cost(true, 0.0f);
+       cost.set_reference(*ref);
+       const int old_max_tasks = CMaxTasks::get_max_tasks();
+       double value_1 = 0.0;
+       C3DFVectorfield force_1(size);
+
+       for (int n_tasks : {1, 2, 4}) {
+              CMaxTasks::set_max_tasks(n_tasks);
+              C3DFVectorfield force(size);
+              const double value = cost.evaluate_force(*src, force);
+
+              if (n_tasks == 1) {
+                     value_1 = value;
+                     force_1 = force;
+              } else {
+                     BOOST_CHECK_EQUAL(value, value_1);
+                     BOOST_CHECK(equal(force.begin(), force.end(), force_1.begin()));
+              }
+       }
+
+       CMaxTasks::set_max_tasks(old_max_tasks);
+}
+#endif
@@ -22,6 +22,7 @@
 #define __3ddatafield_cxx
 
 #include <mia/core/msgstream.hh>
+#include <mia/core/bufferpool.hh>
 #include <mia/2d/datafield.hh>
 #include <mia/3d/datafield.hh>
 
@@ -55,7 +56,7 @@ template <typename T>
 T3DDatafield<T>::T3DDatafield(const C3DBounds& size ):
 	m_size(size),
 	m_xy(static_cast<size_t>(size.x) * static_cast<size_t>(size.y)), 
-	m_data(m_xy * static_cast<size_t>(size.z))
+	m_data(TBufferPool<typename data_array::value_type>::get(m_xy * static_cast<size_t>(size.z)))
 {
 }
 
@@ -63,7 +64,7 @@ template <typename T>
 T3DDatafield<T>::T3DDatafield(const C3DBounds& size, const T *data):
 	m_size(size), 
 	m_xy(static_cast<size_t>(size.x) * static_cast<size_t>(size.y)), 
-	m_data(m_xy * static_cast<size_t>(size.z))
+	m_data(TBufferPool<typename data_array::value_type>::get(m_xy * static_cast<size_t>(size.z)))
 {
 	std::copy(data, data + m_data.size(), m_data.begin()); 
 }
@@ -80,6 +81,7 @@ T3DDatafield<T>::T3DDatafield(const C3DBounds& size, const data_array& data):
 template <typename T>
 T3DDatafield<T>::~T3DDatafield()
 {
+	TBufferPool<typename data_array::value_type>::put(m_data); 
 }
 
 template <typename T>
@@ -286,8 +288,9 @@ template <typename T>
 T3DDatafield<T>& T3DDatafield<T>::operator = (T3DDatafield<T>&& org)
 {
         if (&org != this) {
-	        m_size = org.m_size;
-		m_xy = org.m_xy;
+		// the moved-from field takes over and releases the old data
+		std::swap(m_size, org.m_size);
+		std::swap(m_xy, org.m_xy);
 		m_data.swap(org.m_data);
 	}
 
@@ -299,7 +302,7 @@ template <typename T>
 T3DDatafield<T>::T3DDatafield(const T3DDatafield<T>& org):
 	m_size(org.m_size),
 	m_xy(org.m_xy),
-	m_data(org.m_data)
+	m_data(TBufferPool<typename data_array::value_type>::get_copy(org.m_data))
 {
 }
 
@@ -309,6 +312,8 @@ T3DDatafield<T>::T3DDatafield(T3DDatafield<T>&& org):
 	m_xy(org.m_xy)
 {
 	m_data.swap(org.m_data); 
+	org.m_size = C3DBounds(0,0,0);
+	org.m_xy = 0;
 }
 
 
@@ -63,14 +63,20 @@ struct FDeformer3D: public TFilter<P3DImage> {
               auto callback = [this, &rinterp, &result](const C1DParallelRange & range) {
                      CThreadMsgStream thread_stream;
                      auto cache = rinterp.create_cache();
+                     std::vector<C3DFVector> locations(result.get_size().x);
+                     std::vector<T> values(result.get_size().x);
 
                      for (auto z = range.begin(); z != range.end(); ++z) {
                             auto r = result.begin_at(0, 0, z);
                             auto v = m_vf.begin_at(0, 0, z);
 
-                            for (size_t y = 0; y < result.get_size().y; ++y)
-                                   for (size_t x = 0; x < result.get_size().x; ++x, ++r, ++v)
-                                          *r = rinterp(C3DFVector(x - v->x, y - v->y, z - v->z), cache);
+                            for (size_t y = 0; y < result.get_size().y; ++y) {
+                                   for (size_t x = 0; x < result.get_size().x; ++x, ++v)
+                                          locations[x] = C3DFVector(x - v->x, y - v->y, z - v->z);
+
+                                   rinterp(locations, values, cache);
+                                   r = std::copy(values.begin(), values.end(), r);
+                            }
                      }
               };
               pfor(C1DParallelRange(0, result.get_size().z, 1), callback);
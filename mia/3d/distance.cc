@@ -17,16 +17,69 @@
  * along with MIA; if not, see <http://www.gnu.org/licenses/>.
  *
  */
+#include <algorithm>
 #include <mia/core/filter.hh>
 #include <mia/3d/distance.hh>
 #include <mia/2d/distance.hh>
 #include <mia/core/distance.hh>
+#include <mia/core/parallel.hh>
+#include <mia/core/errormacro.hh>
 
 NS_MIA_BEGIN
 using std::vector;
 using std::copy;
+using std::transform;
 using std::numeric_limits;
 
+/*
+  Run the 1D transform along all lines of the given direction, the lines are
+  distributed over the threads.  The callbacks read and write one line given by the
+  line index.
+*/
+template <typename Get, typename Put>
+void distance_transform_lines(size_t n_lines, size_t length, float spacing, Get get_line, Put put_line)
+{
+       auto transform_lines = [&](const C1DParallelRange & range) {
+              C1DDistanceTransform dt(spacing);
+              vector<float> buffer(length);
+
+              for (auto l = range.begin(); l != range.end(); ++l) {
+                     get_line(l, buffer);
+                     dt(buffer);
+                     put_line(l, buffer);
+              }
+       };
+       pfor(C1DParallelRange(0, n_lines, std::max<size_t>(1, 4096 / length)), transform_lines);
+}
+
+void EXPORT_3D distance_transform_inplace(C3DFImage& f, const C3DFVector& spacing)
+{
+       TRACE_FUNCTION;
+       const C3DBounds& size = f.get_size();
+       distance_transform_lines(size.y * size.z, size.x, spacing.x,
+       [&f, &size](size_t l, vector<float>& buffer) {
+              auto row = f.begin() + l * size.x;
+              copy(row, row + size.x, buffer.begin());
+       },
+       [&f, &size](size_t l, const vector<float>& buffer) {
+              copy(buffer.begin(), buffer.end(), f.begin() + l * size.x);
+       });
+       distance_transform_lines(size.x * size.z, size.y, spacing.y,
+       [&f, &size](size_t l, vector<float>& buffer) {
+              f.get_data_line_y(l % size.x, l / size.x, buffer);
+       },
+       [&f, &size](size_t l, const vector<float>& buffer) {
+              f.put_data_line_y(l % size.x, l / size.x, buffer);
+       });
+       distance_transform_lines(size.x * size.y, size.z, spacing.z,
+       [&f, &size](size_t l, vector<float>& buffer) {
+              f.get_data_line_z(l % size.x, l / size.x, buffer);
+       },
+       [&f, &size](size_t l, const vector<float>& buffer) {
+              f.put_data_line_z(l % size.x, l / size.x, buffer);
+       });
+}
+
 struct F3DDistanceTransform : public TFilter <C3DFImage> {
        template <typename T>
        C3DFImage operator () ( const T3DImage<T>& f) const;
@@ -36,38 +89,8 @@ template <typename T>
 C3DFImage F3DDistanceTransform::operator () ( const T3DImage<T>& image) const
 {
        C3DFImage result(image.get_size(), image);
-       vector<float> buffer(image.get_size().x);
-       vector<T> in_buffer(image.get_size().x);
-
-       for (size_t z = 0; z < image.get_size().z; ++z) {
-              for (size_t y = 0; y < image.get_size().y; ++y) {
-                     image.get_data_line_x(y, z, in_buffer);
-                     copy(in_buffer.begin(), in_buffer.end(), buffer.begin());
-                     distance_transform_inplace(buffer);
-                     result.put_data_line_x(y, z, buffer);
-              }
-       }
-
-       buffer.resize(image.get_size().y);
-
-       for (size_t z = 0; z < image.get_size().z; ++z) {
-              for (size_t x = 0; x < image.get_size().x; ++x) {
-                     result.get_data_line_y(x, z, buffer);
-                     distance_transform_inplace(buffer);
-                     result.put_data_line_y(x, z, buffer);
-              }
-       }
-
-       buffer.resize(image.get_size().z);
-
-       for (size_t y = 0; y < image.get_size().y; ++y) {
-              for (size_t x = 0; x < image.get_size().x; ++x) {
-                     result.get_data_line_z(x, y, buffer);
-                     distance_transform_inplace(buffer);
-                     result.put_data_line_z(x, y, buffer);
-              }
-       }
-
+       copy(image.begin(), image.end(), result.begin());
+       distance_transform_inplace(result, C3DFVector::_1);
        return result;
 }
 
@@ -77,10 +100,30 @@ C3DFImage EXPORT_3D distance_transform(const C3DImage& f)
        return mia::filter(dtf, f);
 }
 
-
+C3DFImage EXPORT_3D signed_distance_transform(const C3DBitImage& mask, const C3DFVector& spacing)
+{
+       TRACE_FUNCTION;
+       C3DFImage outside(mask.get_size(), mask);
+       C3DFImage inside(mask.get_size(), mask);
+       const float inf = numeric_limits<float>::max();
+       transform(mask.begin(), mask.end(), outside.begin(), [inf](bool x) {
+              return x ? 0.0f : inf;
+       });
+       transform(mask.begin(), mask.end(), inside.begin(), [inf](bool x) {
+              return x ? inf : 0.0f;
+       });
+       distance_transform_inplace(outside, spacing);
+       distance_transform_inplace(inside, spacing);
+       auto combine = [&outside, &inside](const C1DParallelRange & range) {
+              for (auto i = range.begin(); i != range.end(); ++i)
+                     outside[i] = sqrtf(outside[i]) - sqrtf(inside[i]);
+       };
+       pfor(C1DParallelRange(0, outside.size(), 4096), combine);
+       return outside;
+}
 
 struct C3DDistanceImpl {
-       C3DDistanceImpl(const C2DImage& slice);
+       C3DDistanceImpl(const C2DImage& slice, bool streaming);
 
        void push_slice(int z, const C2DImage& slice);
 
@@ -88,47 +131,40 @@ struct C3DDistanceImpl {
 
        C2DFImage get_distance_slice(int z) const;
 
+       size_t get_parabola_count() const;
+
        struct SParabola {
               int v;
               float z;
               float fv;
        };
 
-       C2DBounds m_size;
-       vector<int> m_k;
-       vector< vector<SParabola>> m_zdt;
-
-       struct FSlicePusher: public TFilter<void> {
-              FSlicePusher(vector<int>& k, vector< vector<SParabola>>& zdt):
-                     m_k(k), m_zdt(zdt), m_q(-1)
+       struct FSliceValues: public TFilter<vector<float>> {
+              template <typename T>
+              vector<float> operator ()(const T2DImage<T>& f) const
               {
+                     return vector<float>(f.begin(), f.end());
               }
+       };
+private:
+       void push_column(size_t column, int q, float fq);
 
-              template <typename T>
-              void operator ()(const T2DImage<T>& f);
+       void drop_passed(size_t column) const;
 
-              void set_slice(int z);
+       const SParabola& get_parabola(size_t column, float z) const;
 
-       private:
-              vector<int>& m_k;
-              vector< vector<SParabola>>& m_zdt;
-              int m_q;
-       };
+       float get_local_distance(unsigned int x, unsigned  int y, const C3DFVector& p)const;
 
-       struct FPushFirstSlice: public TFilter<void> {
-              FPushFirstSlice(vector< vector<SParabola>>& zdt):
-                     m_zdt(zdt)
-              {
-              }
+       C2DBounds m_size;
+       bool m_streaming;
 
-              template <typename T>
-              void operator ()(const T2DImage<T>& f);
-              vector< vector<SParabola>>& m_zdt;
-       };
-private:
-       float get_local_distance(unsigned int x, unsigned  int y, const C3DFVector& p)const;
+       /* the lower envelope of the parabolas along z for each column, in streaming mode
+          the parabolas that lie completely below the last requested slice are released */
+       mutable vector< vector<SParabola>> m_zdt;
 
-       FSlicePusher m_pusher;
+       /* only used in streaming mode: index of the parabola that was found last in each
+          column, the parabolas below this index are no longer needed */
+       mutable vector<unsigned> m_cursor;
 };
 
 inline float d(float fp, float p, float fq, float q)
@@ -136,94 +172,15 @@ inline float d(float fp, float p, float fq, float q)
        return  ( fp  - fq + p * p - q * q) / (p - q) * 0.5;
 }
 
-void C3DDistanceImpl::FSlicePusher::set_slice(int z)
-{
-       m_q = z;
-}
-
-template <typename T>
-void C3DDistanceImpl::FSlicePusher::operator ()(const T2DImage<T>& func)
-{
-       assert(m_q > 0);
-       auto si = func.begin();
-       auto ei = func.end();
-       auto k = m_k.begin();
-       auto p = m_zdt.begin();
-       cvdebug() << "Start slice " << m_q << "\n";
-
-       while (si != ei) {
-              const float fq = *si;
-
-              // if the function is at inf, there is no contribution
-              if (fq < numeric_limits<float>::max()) {
-                     SParabola& parabola = (*p)[*k];
-                     cvdebug() << "f= " << fq
-                               << ", k=" << *k
-                               << ", mq=" << m_q
-                               << ", fv=" << parabola.fv
-                               << ", pv=" << parabola.v
-                               << ", z=" << parabola.z
-                               << ", p.size()=" << p->size()
-                               << "\n";
-                     float s  = d (fq, m_q, parabola.fv, parabola.v);
-
-                     while (s <= parabola.z) {
-                            --(*k);
-                            parabola = (*p)[*k];
-                            s  = d (fq, m_q, parabola.fv, parabola.v);
-                     }
-
-                     ++(*k);
-
-                     if (*k > (int)p->size()) {
-                            cverr() << "k = " << *k << " but column p->size() = " << p->size() << "\n";
-                            assert(0 && "can't do");
-                     }
-
-                     SParabola new_p = {m_q, s, fq};
-
-                     if ( *k == (int)p->size() ) {
-                            cvdebug() << "add parbola at " << *k << " {q=" << m_q << ", z=" << s << ", fq=" << fq << "}\n";
-                            p->push_back(new_p);
-                     } else {
-                            cvdebug() << "set parbola at " << *k << " {q=" << m_q << ", z=" << s << ", fq=" << fq << "}\n";
-                            (*p)[*k] = new_p;
-
-                            if (*k < (int)p->size() - 1) {
-                                   cvinfo() << "C3DDistance::FSlicePusher: reducing from " << p->size() << " to " << *k << "\n";
-                                   cvinfo() << "C3DDistance::FSlicePusher::operator: reducing column size should not happen\n";
-                                   p->resize(*k + 1);
-                            }
-                     }
-              }
-
-              ++si;
-              ++k;
-              ++p;
-       }
-
-       m_q = -1;
-}
-
-template <typename T>
-void C3DDistanceImpl::FPushFirstSlice::operator ()(const T2DImage<T>& func)
+C3DDistance::C3DDistance():
+       impl(NULL),
+       m_streaming(false)
 {
-       auto si = func.begin();
-       auto ei = func.end();
-       auto p = m_zdt.begin();
-
-       while (si != ei) {
-              SParabola parabola{0, -numeric_limits<float>::max(), static_cast<float>(*si)};
-              p->push_back(parabola);
-              ++si;
-              ++p;
-       }
 }
 
-
-
-C3DDistance::C3DDistance():
-       impl(NULL)
+C3DDistance::C3DDistance(bool streaming):
+       impl(NULL),
+       m_streaming(streaming)
 {
 }
 
@@ -236,7 +193,7 @@ C3DDistance::~C3DDistance()
 void C3DDistance::push_slice(int z, const C2DImage& slice)
 {
        if (z == 0)
-              impl = new C3DDistanceImpl(slice);
+              impl = new C3DDistanceImpl(slice, m_streaming);
        else {
               assert(impl);
               impl->push_slice(z, slice);
@@ -250,21 +207,105 @@ float C3DDistance::get_distance_at(const C3DFVector& p) const
 }
 
 
-C3DDistanceImpl::C3DDistanceImpl(const C2DImage& slice):
+C3DDistanceImpl::C3DDistanceImpl(const C2DImage& slice, bool streaming):
        m_size(slice.get_size()),
-       m_k(m_size.product(), 0),
+       m_streaming(streaming),
        m_zdt(m_size.product()),
-       m_pusher(m_k, m_zdt)
+       m_cursor(streaming ? m_size.product() : 0, 0)
+{
+       auto f = mia::filter(FSliceValues(), slice);
+       auto push_first = [this, &f](const C1DParallelRange & range) {
+              for (auto i = range.begin(); i != range.end(); ++i) {
+                     SParabola parabola{0, -numeric_limits<float>::max(), f[i]};
+                     m_zdt[i].push_back(parabola);
+              }
+       };
+       pfor(C1DParallelRange(0, f.size(), 1024), push_first);
+}
+
+void C3DDistanceImpl::push_column(size_t column, int q, float fq)
 {
-       FPushFirstSlice pfs(m_zdt);
-       mia::accumulate(pfs, slice);
+       // if the function is at inf, there is no contribution
+       if (fq >= numeric_limits<float>::max())
+              return;
+
+       auto& p = m_zdt[column];
+       int k = p.size() - 1;
+       float s  = d (fq, q, p[k].fv, p[k].v);
+
+       /* In streaming mode the parabola found last must be kept: it dominates the released
+          ones above the last requested z, and because the difference of two parabolas is
+          linear in z this holds for all the following requests. */
+       const int first = m_streaming ? m_cursor[column] : 0;
+
+       while (k > first && s <= p[k].z) {
+              --k;
+              s  = d (fq, q, p[k].fv, p[k].v);
+       }
+
+       p.resize(k + 1);
+       p.push_back(SParabola{q, s, fq});
+
+       if (m_streaming)
+              drop_passed(column);
 }
 
+/*
+  The parabolas below the cursor are skipped by an offset, and they are only removed
+  when they make up the larger part of the column. The storage is kept, so that each
+  parabola is moved at most once on average and the column is never re-allocated.
+*/
+void C3DDistanceImpl::drop_passed(size_t column) const
+{
+       auto& zdt = m_zdt[column];
+       const unsigned k = m_cursor[column];
+
+       if (k > 16 && 2 * k > zdt.size()) {
+              zdt.erase(zdt.begin(), zdt.begin() + k);
+              m_cursor[column] = 0;
+       }
+}
 
 void C3DDistanceImpl::push_slice(int z, const C2DImage& slice)
 {
-       m_pusher.set_slice(z);
-       mia::accumulate(m_pusher, slice);
+       assert(z > 0);
+
+       if (slice.get_size() != m_size)
+              throw create_exception<std::invalid_argument>("C3DDistance: got slice of size ", slice.get_size(),
+                            ", expected ", m_size);
+
+       auto f = mia::filter(FSliceValues(), slice);
+       auto push = [this, &f, z](const C1DParallelRange & range) {
+              for (auto i = range.begin(); i != range.end(); ++i)
+                     push_column(i, z, f[i]);
+       };
+       pfor(C1DParallelRange(0, f.size(), 1024), push);
+}
+
+const C3DDistanceImpl::SParabola& C3DDistanceImpl::get_parabola(size_t column, float z) const
+{
+       auto& zdt = m_zdt[column];
+
+       if (!m_streaming) {
+              // the parabolas are sorted by the start of their envelope section, this
+              // lookup only reads the data, so queries can run concurrently
+              auto k = std::partition_point(zdt.begin() + 1, zdt.end(), [z](const SParabola & p) {
+                     return p.z < z;
+              });
+              return *(k - 1);
+       }
+
+       // in streaming mode the queries are ordered by z and the parabolas below the
+       // last found one are gone, so continue the search from there
+       unsigned k = m_cursor[column];
+       assert(k < zdt.size());
+
+       while ( k < zdt.size() - 1 && zdt[ k + 1 ].z  < z)
+              ++k;
+
+       m_cursor[column] = k;
+       drop_passed(column);
+       return zdt[m_cursor[column]];
 }
 
 float C3DDistanceImpl::get_local_distance(unsigned int x, unsigned  int y, const C3DFVector& p)const
@@ -272,21 +313,17 @@ float C3DDistanceImpl::get_local_distance(unsigned int x, unsigned  int y, const
        if (x >= m_size.x || y >= m_size.y)
               return numeric_limits<float>::max();
 
-       auto&  zdt = m_zdt[y * m_size.x + x];
+       const size_t column = y * m_size.x + x;
+       auto&  zdt = m_zdt[column];
 
        if (zdt.size() == 1 && zdt[0].fv == numeric_limits<float>::max())
               return numeric_limits<float>::max();
 
-       unsigned int k = 0;
-
-       while ( k < zdt.size() - 1 && zdt[ k + 1 ].z  < p.z) {
-              ++k;
-       }
-
-       const float delta = p.z - zdt[k].v;
+       const SParabola& parabola = get_parabola(column, p.z);
+       const float delta = p.z - parabola.v;
        const float dx = p.x - x;
        const float dy = p.y - y;
-       return dx * dx + dy * dy + delta * delta + zdt[k].fv;
+       return dx * dx + dy * dy + delta * delta + parabola.fv;
 }
 
 float C3DDistanceImpl::get_distance_at(const C3DFVector& p) const
@@ -402,26 +439,37 @@ float C3DDistanceImpl::get_distance_at(const C3DFVector& p) const
 C2DFImage C3DDistanceImpl::get_distance_slice(int z) const
 {
        C2DFImage result(m_size);
-       auto i = result.begin();
-       auto e = result.end();
-       auto p = m_zdt.begin();
-
-       while (i != e) {
-              size_t k = 0;
-
-              while ( k < p->size() - 1 && (*p)[ k + 1 ].z  < z) {
-                     ++k;
+       auto evaluate_z = [this, &result, z](const C1DParallelRange & range) {
+              for (auto i = range.begin(); i != range.end(); ++i) {
+                     const SParabola& parabola = get_parabola(i, z);
+                     float delta = float(z) - parabola.v;
+                     result[i] = delta * delta + parabola.fv;
               }
-
-              float delta = float(z) - (*p)[k].v;
-              *i = delta * delta + (*p)[k].fv;
-              cvdebug() << "get parbola at " << k << " {z=" << (*p)[k].z << ", fq=" << (*p)[k].fv << "}\n";
-              cvdebug() << "z=" << z << ", k= " << k << ", dist=" << *i << "\n";
-              ++i;
-              ++p;
-       }
-
-       return distance_transform(result);
+       };
+       pfor(C1DParallelRange(0, result.size(), 1024), evaluate_z);
+       auto transform_x = [&result](const C1DParallelRange & range) {
+              C1DDistanceTransform dt;
+              vector<float> buffer(result.get_size().x);
+
+              for (auto y = range.begin(); y != range.end(); ++y) {
+                     result.get_data_line_x(y, buffer);
+                     dt(buffer);
+                     result.put_data_line_x(y, buffer);
+              }
+       };
+       auto transform_y = [&result](const C1DParallelRange & range) {
+              C1DDistanceTransform dt;
+              vector<float> buffer(result.get_size().y);
+
+              for (auto x = range.begin(); x != range.end(); ++x) {
+                     result.get_data_line_y(x, buffer);
+                     dt(buffer);
+                     result.put_data_line_y(x, buffer);
+              }
+       };
+       pfor(C1DParallelRange(0, m_size.y, 16), transform_x);
+       pfor(C1DParallelRange(0, m_size.x, 16), transform_y);
+       return result;
 }
 
 C2DFImage C3DDistance::get_distance_slice(int z) const
@@ -429,4 +477,19 @@ C2DFImage C3DDistance::get_distance_slice(int z) const
        assert(impl);
        return impl->get_distance_slice(z);
 }
+
+size_t C3DDistanceImpl::get_parabola_count() const
+{
+       size_t result = 0;
+
+       for (auto& zdt : m_zdt)
+              result += zdt.size();
+
+       return result;
+}
+
+size_t C3DDistance::get_parabola_count() const
+{
+       return impl ? impl->get_parabola_count() : 0;
+}
 NS_MIA_END
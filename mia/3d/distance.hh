@@ -39,6 +39,25 @@ NS_MIA_BEGIN
 
 C3DFImage EXPORT_3D distance_transform(const C3DImage& f);
 
+/**
+   Evaluate the 3D distance transform of prepared input data in-place. Each of the
+   separable passes is distributed over the image lines.
+   \param[in,out] f at input the squared values of the function to evaluate the distance to
+   (see distance_transform_prepare), at output the squared distances.
+   \param spacing the voxel spacing to evaluate anisotropic distances
+*/
+void EXPORT_3D distance_transform_inplace(C3DFImage& f, const C3DFVector& spacing);
+
+/**
+   Evaluate the signed Euclidian distance to the boundary of a mask. Outside the mask
+   the result is the distance to the closest mask voxel, inside the mask it is the
+   negated distance to the closest voxel outside the mask.
+   \param mask the binary mask
+   \param spacing the voxel spacing to evaluate anisotropic distances
+   \returns the signed distances (not squared)
+*/
+C3DFImage EXPORT_3D signed_distance_transform(const C3DBitImage& mask, const C3DFVector& spacing);
+
 /**
    \brief 3D distance transform for high resolution data
 
@@ -47,6 +66,14 @@ C3DFImage EXPORT_3D distance_transform(const C3DImage& f);
    whole grid. Instead the distances can ether be obtained slice-wise, or by evaluating
    the distance at certain points.
 
+   In streaming mode the distances must be requested in the order of non-decreasing z,
+   and the parts of the distance representation that are below the last requested
+   position are released, which keeps the memory footprint bounded when large
+   stacks are processed.  Slices can be added between the requests, but a request only
+   takes the slices into account that were added before it. Hence, to obtain the exact
+   distances up to a maximum distance w at slice z, all slices up to z + w must have been
+   added. In streaming mode requesting distances changes the internal state, hence
+   concurrent requests are only allowed if streaming is disabled.
 */
 class EXPORT_3D C3DDistance : public CIOData
 {
@@ -57,6 +84,12 @@ public:
        */
        C3DDistance();
 
+       /**
+          Initializes the distance transform
+          \param streaming enable the streaming mode
+       */
+       explicit C3DDistance(bool streaming);
+
        ~C3DDistance();
 
        C3DDistance(const C3DDistance& other) = delete;
@@ -85,8 +118,15 @@ public:
           \returns a 2D data field of the squared distances
        */
        C2DFImage get_distance_slice(int z) const;
+
+       /**
+          \returns the number of parabolas that are currently stored to represent the
+          distance function, this gives an estimate of the memory footprint
+        */
+       size_t get_parabola_count() const;
 private:
        struct C3DDistanceImpl *impl;
+       bool m_streaming;
 };
 
 NS_MIA_END
@@ -21,6 +21,7 @@
 #include <mia/core/export_handler.hh>
 
 #include <mia/3d/filter.hh>
+#include <mia/3d/imageio.hh>
 #include <mia/core/plugin_base.cxx>
 #include <mia/core/handler.cxx>
 #include <mia/template/combiner.cxx>
@@ -67,6 +68,194 @@ P3DImage  EXPORT_3D run_filter_chain(P3DImage image, const std::vector<const cha
        return image;
 }
 
+struct FExtractSlab: public TFilter<P3DImage> {
+       FExtractSlab(unsigned z0, unsigned z1): m_z0(z0), m_z1(z1) {}
+
+       template <typename T>
+       P3DImage operator () (const T3DImage<T>& image) const
+       {
+              const C3DBounds& size = image.get_size();
+              T3DImage<T> *result = new T3DImage<T>(C3DBounds(size.x, size.y, m_z1 - m_z0), image);
+              std::copy(image.begin_at(0, 0, m_z0), image.begin_at(0, 0, m_z1), result->begin());
+              return P3DImage(result);
+       }
+private:
+       unsigned m_z0;
+       unsigned m_z1;
+};
+
+struct FCreateLike: public TFilter<P3DImage> {
+       FCreateLike(const C3DBounds& size): m_size(size) {}
+
+       template <typename T>
+       P3DImage operator () (const T3DImage<T>& image) const
+       {
+              return P3DImage(new T3DImage<T>(m_size, image));
+       }
+private:
+       C3DBounds m_size;
+};
+
+struct FInsertSlab {
+       FInsertSlab(unsigned skip, unsigned z0, unsigned nslices):
+              m_skip(skip), m_z0(z0), m_nslices(nslices) {}
+
+       template <typename T>
+       void operator () (const T3DImage<T>& slab, T3DImage<T>& result) const
+       {
+              std::copy(slab.begin_at(0, 0, m_skip), slab.begin_at(0, 0, m_skip + m_nslices),
+                   result.begin_at(0, 0, m_z0));
+       }
+private:
+       unsigned m_skip;
+       unsigned m_z0;
+       unsigned m_nslices;
+};
+
+struct FAppendSlices: public TFilter<P3DImage> {
+       FAppendSlices(unsigned skip): m_skip(skip) {}
+
+       template <typename T>
+       P3DImage operator () (const T3DImage<T>& head, const T3DImage<T>& tail) const
+       {
+              const C3DBounds& size = head.get_size();
+              T3DImage<T> *result = new T3DImage<T>(C3DBounds(size.x, size.y,
+                                                    size.z - m_skip + tail.get_size().z), tail);
+              auto r = std::copy(head.begin_at(0, 0, m_skip), head.end(), result->begin());
+              std::copy(tail.begin(), tail.end(), r);
+              return P3DImage(result);
+       }
+private:
+       unsigned m_skip;
+};
+
+/*
+  Run the filter on the padded slabs that are provided by get_input(zb, ze) and hand the
+  valid center slices to put_output(slab, skip, z0, n).
+*/
+template <typename Input, typename Output>
+static void run_filter_slabs(const C3DBounds& size, const C3DFilter& filter, unsigned slab_depth,
+                             const char *caller, Input get_input, Output put_output)
+{
+       const unsigned radius = filter.get_support_radius();
+
+       for (unsigned z0 = 0; z0 < size.z; z0 += slab_depth) {
+              const unsigned z1 = std::min(z0 + slab_depth, size.z);
+              const unsigned zb = z0 > radius ? z0 - radius : 0;
+              const unsigned ze = std::min(z1 + radius, size.z);
+              cvdebug() << caller << ": slices [" << z0 << ", " << z1
+                        << ") from input [" << zb << ", " << ze << ")\n";
+              auto slab = filter.filter(*get_input(zb, ze));
+
+              if (slab->get_size() != C3DBounds(size.x, size.y, ze - zb))
+                     throw create_exception<std::invalid_argument>(caller, ": filter '",
+                                   filter.get_init_string(), "' changed the slab size from ",
+                                   C3DBounds(size.x, size.y, ze - zb), " to ", slab->get_size());
+
+              put_output(*slab, z0 - zb, z0, z1 - z0);
+       }
+}
+
+P3DImage  EXPORT_3D run_filter_in_memory_slabs(const C3DImage& image, const C3DFilter& filter,
+                                        unsigned slab_depth)
+{
+       const C3DBounds& size = image.get_size();
+       const int radius = filter.get_support_radius();
+
+       if (radius < 0 || slab_depth == 0 || slab_depth >= size.z) {
+              if (radius < 0)
+                     cvinfo() << "run_filter_in_memory_slabs: filter '" << filter.get_init_string()
+                              << "' is not local, run it on the whole image\n";
+
+              return filter.filter(image);
+       }
+
+       P3DImage result;
+       run_filter_slabs(size, filter, slab_depth, "run_filter_in_memory_slabs",
+       [&image](unsigned zb, unsigned ze) {
+              return mia::filter(FExtractSlab(zb, ze), image);
+       },
+       [&](const C3DImage & slab, unsigned skip, unsigned z0, unsigned n) {
+              if (!result)
+                     result = mia::filter(FCreateLike(size), slab);
+
+              if (slab.get_pixel_type() != result->get_pixel_type())
+                     throw create_exception<std::invalid_argument>("run_filter_in_memory_slabs: filter '",
+                                   filter.get_init_string(), "' returned different pixel types for different slabs");
+
+              mia::filter_equal_inplace(FInsertSlab(skip, z0, n), slab, *result);
+       });
+       return result;
+}
+
+void EXPORT_3D run_filter_streaming(C3DImageSliceReader& input, const C3DFilter& filter,
+                                    unsigned slab_depth, const FSlicesOutput& output)
+{
+       if (filter.get_support_radius() < 0)
+              throw create_exception<std::invalid_argument>("run_filter_streaming: filter '",
+                            filter.get_init_string(), "' is not local");
+
+       if (slab_depth == 0)
+              throw std::invalid_argument("run_filter_streaming: the slab depth must be positive");
+
+       // the input slices [wz0, wz1) that were read last
+       P3DImage window;
+       unsigned wz0 = 0;
+       unsigned wz1 = 0;
+       EPixelType out_type = it_none;
+       run_filter_slabs(input.get_size(), filter, slab_depth, "run_filter_streaming",
+       [&](unsigned zb, unsigned ze) {
+              if (!window)
+                     window = input.read_slices(ze);
+              else if (ze > wz1)
+                     window = mia::filter_equal(FAppendSlices(zb - wz0), *window, *input.read_slices(ze - wz1));
+              else
+                     window = mia::filter(FExtractSlab(zb - wz0, ze - wz0), *window);
+
+              wz0 = zb;
+              wz1 = ze;
+              return window;
+       },
+       [&](const C3DImage & slab, unsigned skip, unsigned MIA_PARAM_UNUSED(z0), unsigned n) {
+              if (out_type == it_none)
+                     out_type = slab.get_pixel_type();
+              else if (slab.get_pixel_type() != out_type)
+                     throw create_exception<std::invalid_argument>("run_filter_streaming: filter '",
+                                   filter.get_init_string(), "' returned different pixel types for different slabs");
+
+              output(*mia::filter(FExtractSlab(skip, skip + n), slab));
+       });
+}
+
+bool EXPORT_3D run_filter_streaming(const std::string& in_filename, const std::string& out_filename,
+                                    const C3DFilter& filter, unsigned slab_depth)
+{
+       if (filter.get_support_radius() < 0 || slab_depth == 0)
+              return false;
+
+       auto in_io = get_image3d_slice_io(in_filename);
+       auto out_io = get_image3d_slice_io(out_filename);
+
+       if (!in_io || !out_io)
+              return false;
+
+       auto reader = in_io->open_slice_reader(in_filename);
+
+       if (!reader)
+              return false;
+
+       const C3DBounds size = reader->get_size();
+       std::unique_ptr<C3DImageSliceWriter> writer;
+       run_filter_streaming(*reader, filter, slab_depth, [&](const C3DImage & slices) {
+              if (!writer)
+                     writer = out_io->open_slice_writer(out_filename, size, slices);
+
+              writer->write_slices(slices);
+       });
+       writer->close();
+       return true;
+}
+
 template class TFilterChain<C3DFilterPluginHandler>;
 template class TDataFilter<C3DImage>;
 template class TDataFilterPlugin<C3DImage>;
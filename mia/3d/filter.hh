@@ -21,6 +21,7 @@
 #ifndef mia_3d_filter_hh
 #define mia_3d_filter_hh
 
+#include <functional>
 #include <boost/any.hpp>
 
 #include <mia/3d/image.hh>
@@ -33,6 +34,7 @@
 
 NS_MIA_BEGIN
 
+class C3DImageSliceReader;
 
 /**
    \ingroup filtering
@@ -148,6 +150,59 @@ P3DImage  EXPORT_3D run_filter(const C3DImage& image, const char *filter);
 */
 P3DImage  EXPORT_3D run_filter_chain(P3DImage image, const std::vector<const char *>& filters);
 
+/**
+   \ingroup filtering
+   Run a filter on an image in slabs along the z-axis.  Each slab is padded by the
+   support radius of the filter (see TDataFilter::get_support_radius), filtered, and the
+   valid center slices are written to the output. This way the intermediate images created
+   by a chain of local filters only need memory proportional to the slab size.
+   Note that the input and the output image are held in memory completely, see
+   run_filter_streaming for a version that reads and writes the image slice-wise.
+   If the filter doesn't report a finite support radius, or if the slab
+   depth is zero, it is run on the whole image.
+   @param image input image
+   @param filter the filter (or filter chain) to be applied
+   @param slab_depth the number of output slices that are evaluated in one run of the filter
+   @returns the filtered image, identical to filter.filter(image)
+*/
+P3DImage  EXPORT_3D run_filter_in_memory_slabs(const C3DImage& image, const C3DFilter& filter,
+                                        unsigned slab_depth);
+
+/// callback type that receives the consecutive output slices of run_filter_streaming
+typedef std::function<void(const C3DImage& slices)> FSlicesOutput;
+
+/**
+   \ingroup filtering
+   Run a local filter on an image that is read slice-wise and hand on the filtered slices
+   as soon as they are available. Like in run_filter_in_memory_slabs each slab is padded by
+   the support radius of the filter, but here only the padded input slab, the intermediate
+   images of the filter, and the output slab are held in memory, i.e. the memory use is
+   bounded by the slab size and not by the image size.
+   @param input reader that provides the input slices
+   @param filter the local filter (or filter chain) to be applied
+   @param slab_depth the number of output slices that are evaluated in one run of the filter
+   @param output called with the slabs of the filtered image in increasing z-order, the
+   concatenation of the slabs is identical to filter.filter(image)
+   @throws std::invalid_argument if the filter is not local or the slab depth is zero
+*/
+void EXPORT_3D run_filter_streaming(C3DImageSliceReader& input, const C3DFilter& filter,
+                                    unsigned slab_depth, const FSlicesOutput& output);
+
+/**
+   \ingroup filtering
+   Convenience function: run a local filter on the image stored in a file with
+   run_filter_streaming and write the result slice-wise to another file.
+   @param in_filename input file name
+   @param out_filename output file name
+   @param filter the filter (or filter chain) to be applied
+   @param slab_depth the number of output slices that are evaluated in one run of the filter
+   @returns true if the image was filtered, false if the filter is not local, the slab depth is
+   zero, or if the file formats don't support slice-wise IO (see C3DImageSliceIO). In the latter
+   cases no output is written.
+*/
+bool EXPORT_3D run_filter_streaming(const std::string& in_filename, const std::string& out_filename,
+                                    const C3DFilter& filter, unsigned slab_depth);
+
 
 NS_MIA_END
 
@@ -21,6 +21,8 @@
 
 #include <mia/3d/filter/distance.hh>
 #include <mia/core/distance.hh>
+#include <mia/core/errormacro.hh>
+#include <mia/3d/distance.hh>
 
 #include <mia/core/threadedmsg.hh>
 #include <mia/core/parallel.hh>
@@ -33,53 +35,48 @@ using namespace mia;
 using std::vector;
 using std::string;
 
+template <typename T>
+static P3DImage signed_distance(const T3DImage<T>& image, const C3DFVector& MIA_PARAM_UNUSED(spacing))
+{
+       throw create_exception<std::invalid_argument>("distance: the signed distance transform "
+                     "requires a binary mask as input, but got pixel type ",
+                     CPixelTypeDict.get_name(image.get_pixel_type()));
+}
+
+static P3DImage signed_distance(const C3DBitImage& mask, const C3DFVector& spacing)
+{
+       return P3DImage(new C3DFImage(signed_distance_transform(mask, spacing)));
+}
+
+C3DDistanceFilter::C3DDistanceFilter(bool use_voxel_size, bool is_signed):
+       m_use_voxel_size(use_voxel_size),
+       m_signed(is_signed)
+{
+}
+
 template <typename T>
 P3DImage C3DDistanceFilter::operator () ( const T3DImage<T>& image) const
 {
+       const C3DFVector spacing = m_use_voxel_size ? image.get_voxel_size() : C3DFVector::_1;
+
+       if (m_signed) {
+              return signed_distance(image, spacing);
+       }
+
        C3DFImage *result = new C3DFImage(image.get_size(), image);
-       auto transform_x = [result, &image](const C1DParallelRange & range) {
-              vector<float> buffer(image.get_size().x);
-              vector<T> in_buffer(image.get_size().x);
-
-              for (auto z = range.begin(); z != range.end(); ++z) {
-                     for (size_t y = 0; y < image.get_size().y; ++y) {
-                            image.get_data_line_x(y, z, in_buffer);
-                            distance_transform_prepare(in_buffer.begin(), in_buffer.end(), buffer.begin(),
-                                                       __is_mask_pixel<T>::value);
-                            distance_transform_inplace(buffer);
-                            result->put_data_line_x(y, z, buffer);
-                     }
-              }
-       };
-       auto transform_y = [result](const C1DParallelRange & range) {
-              vector<float> buffer(result->get_size().y);
-
-              for (auto z = range.begin(); z != range.end(); ++z) {
-                     for (size_t x = 0; x < result->get_size().x; ++x) {
-                            result->get_data_line_y(x, z, buffer);
-                            distance_transform_inplace(buffer);
-                            result->put_data_line_y(x, z, buffer);
-                     }
-              }
+       auto prepare = [result, &image](const C1DParallelRange & range) {
+              distance_transform_prepare(image.begin() + range.begin(), image.begin() + range.end(),
+                                         result->begin() + range.begin(), __is_mask_pixel<T>::value);
        };
-       auto transform_z = [result](const C1DParallelRange & range) {
-              vector<float> buffer(result->get_size().z);
-
-              for (auto y = range.begin(); y != range.end(); ++y) {
-                     for (size_t x = 0; x < result->get_size().x; ++x) {
-                            result->get_data_line_z(x, y, buffer);
-                            distance_transform_inplace(buffer);
-                            transform(buffer.begin(), buffer.end(), buffer.begin(),
-                            [](float x) {
-                                   return sqrtf(x);
-                            });
-                            result->put_data_line_z(x, y, buffer);
-                     }
-              }
+       pfor(C1DParallelRange(0, image.size(), 4096), prepare);
+       distance_transform_inplace(*result, spacing);
+       auto take_root = [result](const C1DParallelRange & range) {
+              transform(result->begin() + range.begin(), result->begin() + range.end(),
+              result->begin() + range.begin(), [](float x) {
+                     return sqrtf(x);
+              });
        };
-       pfor(C1DParallelRange(0, image.get_size().z, 1), transform_x);
-       pfor(C1DParallelRange(0, image.get_size().z, 1), transform_y);
-       pfor(C1DParallelRange(0, image.get_size().y, 1), transform_z);
+       pfor(C1DParallelRange(0, result->size(), 4096), take_root);
        return P3DImage(result);
 }
 
@@ -89,13 +86,20 @@ P3DImage C3DDistanceFilter::do_filter(const mia::C3DImage& image) const
 }
 
 C3DDistanceImageFilterFactory::C3DDistanceImageFilterFactory():
-       C3DFilterPlugin("distance")
+       C3DFilterPlugin("distance"),
+       m_use_voxel_size(false),
+       m_signed(false)
 {
+       add_parameter("vs", new CBoolParameter(m_use_voxel_size, false,
+                                              "Evaluate the distance by taking the voxel size of the input image into account"));
+       add_parameter("signed", new CBoolParameter(m_signed, false,
+                     "Evaluate the signed distance to the boundary of a binary mask, "
+                     "i.e. inside the mask the distances are negative"));
 }
 
 C3DFilter *C3DDistanceImageFilterFactory::do_create()const
 {
-       return new C3DDistanceFilter();
+       return new C3DDistanceFilter(m_use_voxel_size, m_signed);
 }
 const string C3DDistanceImageFilterFactory::do_get_descr()const
 {
@@ -104,7 +108,9 @@ const string C3DDistanceImageFilterFactory::do_get_descr()const
               "transform in each point corresponds to the Euclidian distance to the "
               "mask. If the input image is of a scalar pixel value, then the this "
               "scalar is interpreted as heighfield and the per pixel value adds "
-              "to the distance.";
+              "to the distance. Optionally, the voxel size of the input image is used to "
+              "evaluate the distances, and for binary masks the signed distance to the mask "
+              "boundary can be evaluated.";
 }
 
 extern "C" EXPORT CPluginBase *get_plugin_interface()
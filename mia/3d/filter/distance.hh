@@ -26,10 +26,15 @@ namespace distance_3d_filter
 class C3DDistanceFilter: public mia::C3DFilter
 {
 public:
+       C3DDistanceFilter(bool use_voxel_size = false, bool is_signed = false);
+
        template <typename T>
        C3DDistanceFilter::result_type operator () (const mia::T3DImage<T>& data) const;
 private:
        virtual mia::P3DImage do_filter(const mia::C3DImage& image) const;
+
+       bool m_use_voxel_size;
+       bool m_signed;
 };
 
 /* The factory class - this is what the application gets first. This factory class is used to
@@ -42,6 +47,8 @@ public:
        virtual mia::C3DFilter *do_create()const;
        virtual const std::string do_get_descr()const;
 private:
+       bool m_use_voxel_size;
+       bool m_signed;
 };
 
 }
@@ -30,7 +30,8 @@ NS_MIA_USE;
 using namespace std;
 using namespace boost;
 
-CGradnorm::CGradnorm()
+CGradnorm::CGradnorm(bool normalize):
+       m_normalize(normalize)
 {
 }
 
@@ -61,7 +62,12 @@ CGradnorm::result_type CGradnorm::operator () (const T3DImage<T>& data) const
 
        T3DImage<float> *result = new T3DImage<float>(data.get_size(), data);
 
-       if (maxnorm > 0.0) {
+       if (!m_normalize) {
+              transform(vf.begin(), vf.end(), result->begin(),
+              [](const C3DFVector & v) {
+                     return v.norm();
+              });
+       } else if (maxnorm > 0.0) {
               maxnorm = sqrt(maxnorm);
               transform(vf.begin(), vf.end(), result->begin(),
               [&maxnorm](const C3DFVector & v) {
@@ -77,15 +83,24 @@ CGradnorm::result_type CGradnorm::do_filter(const C3DImage& image) const
        return mia::filter(*this, image);
 }
 
+int CGradnorm::do_get_support_radius() const
+{
+       // the normalization depends on the whole image
+       return m_normalize ? -1 : 1;
+}
+
 
 C3DGradnormFilterPlugin::C3DGradnormFilterPlugin():
-       C3DFilterPlugin("gradnorm")
+       C3DFilterPlugin("gradnorm"),
+       m_normalize(true)
 {
+       add_parameter("normalize", new CBoolParameter(m_normalize, false, "Normalize the gradient norms to range [0,1]. "
+                                                     "Without normalization the filter is local and can be run in slabs."));
 }
 
 C3DFilter *C3DGradnormFilterPlugin::do_create()const
 {
-       return new CGradnorm();
+       return new CGradnorm(m_normalize);
 }
 
 const string C3DGradnormFilterPlugin::do_get_descr()const
@@ -24,13 +24,16 @@ NS_BEGIN(gradnorm_3dimage_filter)
 class CGradnorm: public mia::C3DFilter
 {
 public:
-       CGradnorm();
+       CGradnorm(bool normalize);
 
        template <typename  T>
        CGradnorm::result_type operator () (const mia::T3DImage<T>& data) const;
 
 private:
        CGradnorm::result_type do_filter(const mia::C3DImage& image) const;
+       int do_get_support_radius() const;
+
+       bool m_normalize;
 };
 
 
@@ -40,6 +43,8 @@ public:
        C3DGradnormFilterPlugin();
        virtual mia::C3DFilter *do_create()const;
        virtual const std::string do_get_descr()const;
+private:
+       bool m_normalize;
 };
 
 NS_END
@@ -19,10 +19,13 @@
  */
 
 #include <stdexcept>
-#include <queue>
 #include <limits>
+#include <set>
+#include <tuple>
+#include <type_traits>
 #include <mia/core/filter.hh>
 #include <mia/core/msgstream.hh>
+#include <mia/core/parallel.hh>
 #include <mia/3d/filter/label.hh>
 
 NS_MIA_USE;
@@ -36,63 +39,308 @@ CLabel::CLabel(P3DShape mask):
 {
 }
 
-void CLabel::grow_region(const C3DBounds& loc, const C3DBitImage& input, C3DUSImage& result, unsigned short label)const
+/*
+  Union-find forest over the voxel indices. Two sets are always linked to the smaller
+  root, hence the root of a component is its first voxel in raster order.
+*/
+class CLabelForest
 {
-       queue<C3DBounds> neighbors;
-       neighbors.push(loc);
-       result(loc) = label;
-       C3DBounds size = result.get_size();
+public:
+       CLabelForest(size_t n);
+       uint32_t find(uint32_t i);
+       uint32_t get_root(uint32_t i) const;
+       bool is_root(uint32_t i) const;
+       void join(uint32_t a, uint32_t b);
+private:
+       vector<uint32_t> m_parent;
+};
 
-       while (!neighbors.empty()) {
-              C3DBounds  l = neighbors.front();
-              neighbors.pop();
+CLabelForest::CLabelForest(size_t n):
+       m_parent(n)
+{
+       // the parallel range is int based, so iterate over blocks to cover all uint32 indices
+       const size_t block_size = 65536;
+       const int n_blocks = (n + block_size - 1) / block_size;
+       auto init = [this, n, block_size](const C1DParallelRange & range) {
+              for (auto b = range.begin(); b != range.end(); ++b) {
+                     const size_t end = min(n, (b + 1) * block_size);
+
+                     for (size_t i = b * block_size; i < end; ++i)
+                            m_parent[i] = i;
+              }
+       };
+       pfor(C1DParallelRange(0, n_blocks, 1), init);
+}
+
+uint32_t CLabelForest::find(uint32_t i)
+{
+       // path halving keeps the trees flat
+       while (m_parent[i] != i) {
+              m_parent[i] = m_parent[m_parent[i]];
+              i = m_parent[i];
+       }
+
+       return i;
+}
+
+uint32_t CLabelForest::get_root(uint32_t i) const
+{
+       while (m_parent[i] != i)
+              i = m_parent[i];
+
+       return i;
+}
+
+bool CLabelForest::is_root(uint32_t i) const
+{
+       return m_parent[i] == i;
+}
+
+void CLabelForest::join(uint32_t a, uint32_t b)
+{
+       a = find(a);
+       b = find(b);
 
-              for (C3DShape::const_iterator s = m_mask->begin(); s != m_mask->end(); ++s) {
-                     C3DBounds  pos(l.x + s->x, l.y + s->y, l.z + s->z);
+       if (a < b)
+              m_parent[b] = a;
+       else if (b < a)
+              m_parent[a] = b;
+}
+
+/*
+  The image is split into slabs of slices that are labelled independently, then
+  the slabs are joined pairwise in a binary tree so that each merge step only touches
+  the sets of its own group of slabs, and the groups can be merged in parallel.
+*/
+template <typename T>
+class TLabeller
+{
+public:
+       TLabeller(const T3DImage<T>& data, const C3DShape& shape);
+
+       size_t run();
+
+       template <typename O>
+       void write(T3DImage<O>& result) const;
+private:
+       struct SOffset {
+              int dx, dy, dz;
+              long delta;
+       };
+
+       void link(size_t zbegin, size_t zend, size_t zmin);
+
+       typename T3DImage<T>::const_iterator m_in;
+       C3DBounds m_size;
+       vector<SOffset> m_offsets;
+       size_t m_max_dz;
+       size_t m_thickness;
+       size_t m_n_slabs;
+       size_t m_slice_size;
+       CLabelForest m_forest;
+       vector<size_t> m_label_start;
+};
+
+template <typename T>
+TLabeller<T>::TLabeller(const T3DImage<T>& data, const C3DShape& shape):
+       m_in(data.begin()),
+       m_size(data.get_size()),
+       m_max_dz(1),
+       m_slice_size(m_size.x * m_size.y),
+       m_forest(data.size())
+{
+       // only the neighbors that precede a voxel in raster order are needed, the
+       // connectivity is symmetric
+       set<tuple<int, int, int>> backward;
 
-                     if (pos.x < size.x && pos.y < size.y && pos.z < size.z && input(pos) && result(pos) == 0) {
-                            result(pos) = label;
-                            neighbors.push(pos);
+       for (auto s = shape.begin(); s != shape.end(); ++s) {
+              const long delta = (static_cast<long>(s->z) * m_size.y + s->y) * m_size.x + s->x;
+
+              if (delta < 0)
+                     backward.insert(make_tuple(s->z, s->y, s->x));
+              else if (delta > 0)
+                     backward.insert(make_tuple(-s->z, -s->y, -s->x));
+       }
+
+       for (auto b : backward) {
+              SOffset o;
+              o.dz = get<0>(b);
+              o.dy = get<1>(b);
+              o.dx = get<2>(b);
+              o.delta = (static_cast<long>(o.dz) * m_size.y + o.dy) * m_size.x + o.dx;
+              m_offsets.push_back(o);
+
+              if (static_cast<size_t>(-o.dz) > m_max_dz)
+                     m_max_dz = -o.dz;
+       }
+
+       // a slab must be at least as thick as the neighborhood reaches, so that
+       // only neighboring slabs need to be joined
+       m_thickness = max<size_t>(m_max_dz, (m_size.z + 63) / 64);
+       m_n_slabs = (m_size.z + m_thickness - 1) / m_thickness;
+}
+
+template <typename T>
+void TLabeller<T>::link(size_t zbegin, size_t zend, size_t zmin)
+{
+       for (size_t z = zbegin; z < zend; ++z) {
+              for (size_t y = 0; y < m_size.y; ++y) {
+                     uint32_t i = (z * m_size.y + y) * m_size.x;
+                     auto v = m_in + i;
+
+                     for (size_t x = 0; x < m_size.x; ++x, ++i, ++v) {
+                            if (!*v)
+                                   continue;
+
+                            for (auto o = m_offsets.begin(); o != m_offsets.end(); ++o) {
+                                   const long zz = static_cast<long>(z) + o->dz;
+                                   const long yy = static_cast<long>(y) + o->dy;
+                                   const long xx = static_cast<long>(x) + o->dx;
+
+                                   if (zz < static_cast<long>(zmin) ||
+                                       yy < 0 || yy >= static_cast<long>(m_size.y) ||
+                                       xx < 0 || xx >= static_cast<long>(m_size.x))
+                                          continue;
+
+                                   if (v[o->delta] == *v)
+                                          m_forest.join(i, i + o->delta);
+                            }
                      }
               }
        }
 }
 
-CLabel::result_type CLabel::do_filter(const C3DImage& image) const
+template <typename T>
+size_t TLabeller<T>::run()
 {
-       if (image.get_pixel_type() != it_bit) {
-              throw invalid_argument("Label: Only bit input images are allowed");
+       auto label_slabs = [this](const C1DParallelRange & range) {
+              for (auto s = range.begin(); s != range.end(); ++s) {
+                     const size_t zbegin = s * m_thickness;
+                     link(zbegin, min<size_t>(zbegin + m_thickness, m_size.z), zbegin);
+              }
+       };
+       pfor(C1DParallelRange(0, m_n_slabs, 1), label_slabs);
+
+       for (size_t step = 1; step < m_n_slabs; step *= 2) {
+              auto join_slabs = [this, step](const C1DParallelRange & range) {
+                     for (auto g = range.begin(); g != range.end(); ++g) {
+                            const size_t first = g * 2 * step;
+                            const size_t middle = first + step;
+
+                            if (middle >= m_n_slabs)
+                                   continue;
+
+                            const size_t zend = min<size_t>(min<size_t>(first + 2 * step, m_n_slabs) * m_thickness, m_size.z);
+                            const size_t boundary = middle * m_thickness;
+                            link(boundary, min<size_t>(boundary + m_max_dz, zend), first * m_thickness);
+                     }
+              };
+              const size_t n_groups = (m_n_slabs + 2 * step - 1) / (2 * step);
+              pfor(C1DParallelRange(0, n_groups, 1), join_slabs);
        }
 
-       const C3DBitImage& input = dynamic_cast<const C3DBitImage&>(image);
-       unsigned short current_label = 1;
-       C3DUSImage *result = new C3DUSImage(image.get_size(), image);
-       P3DImage presult(result);
-       fill(result->begin(), result->end(), 0);
-       C3DBitImage::const_iterator  i = input.begin();
-       C3DUSImage::const_iterator   r = result->begin();
-       C3DBounds size(image.get_size());
-       C3DBounds loc;
-
-       for (loc.z = 0; loc.z < size.z; ++loc.z)
-              for (loc.y = 0; loc.y < size.y; ++loc.y)
-                     for (loc.x = 0; loc.x < size.x; ++loc.x, ++i, ++r) {
-                            if (*i && !*r) {
-                                   cvdebug() << "label:" << current_label << " seed at " << loc << "\n";
-                                   grow_region(loc, input, *result, current_label);
-                                   ++current_label;
-                            }
+       // count the roots per slab to number the labels in raster order
+       vector<size_t> n_roots(m_n_slabs, 0);
+       auto count_roots = [this, &n_roots](const C1DParallelRange & range) {
+              for (auto s = range.begin(); s != range.end(); ++s) {
+                     const size_t begin = s * m_thickness * m_slice_size;
+                     const size_t end = min<size_t>((s + 1) * m_thickness, m_size.z) * m_slice_size;
+
+                     for (size_t i = begin; i < end; ++i)
+                            if (m_in[i] && m_forest.is_root(i))
+                                   ++n_roots[s];
+              }
+       };
+       pfor(C1DParallelRange(0, m_n_slabs, 1), count_roots);
+       m_label_start.resize(m_n_slabs);
+       size_t n_labels = 0;
+
+       for (size_t s = 0; s < m_n_slabs; ++s) {
+              m_label_start[s] = n_labels + 1;
+              n_labels += n_roots[s];
+       }
+
+       return n_labels;
+}
+
+template <typename T>
+template <typename O>
+void TLabeller<T>::write(T3DImage<O>& result) const
+{
+       auto out = result.begin();
+       auto label_roots = [this, out](const C1DParallelRange & range) {
+              for (auto s = range.begin(); s != range.end(); ++s) {
+                     const size_t begin = s * m_thickness * m_slice_size;
+                     const size_t end = min<size_t>((s + 1) * m_thickness, m_size.z) * m_slice_size;
+                     size_t label = m_label_start[s];
+
+                     for (size_t i = begin; i < end; ++i) {
+                            if (!m_in[i])
+                                   out[i] = 0;
+                            else if (m_forest.is_root(i))
+                                   out[i] = label++;
                      }
+              }
+       };
+       pfor(C1DParallelRange(0, m_n_slabs, 1), label_roots);
+       auto label_voxels = [this, out](const C1DParallelRange & range) {
+              for (auto s = range.begin(); s != range.end(); ++s) {
+                     const size_t begin = s * m_thickness * m_slice_size;
+                     const size_t end = min<size_t>((s + 1) * m_thickness, m_size.z) * m_slice_size;
 
-       cvmsg() << "\n";
+                     for (size_t i = begin; i < end; ++i) {
+                            if (m_in[i] && !m_forest.is_root(i))
+                                   out[i] = out[m_forest.get_root(i)];
+                     }
+              }
+       };
+       pfor(C1DParallelRange(0, m_n_slabs, 1), label_voxels);
+}
 
-       if (current_label < 256) {
-              C3DUBImage *real_result = new C3DUBImage(image.get_size(), image);
-              copy(result->begin(), result->end(), real_result->begin());
-              presult.reset(real_result);
+template <typename T, bool is_integral>
+struct __dispatch_label {
+       static P3DImage apply(const T3DImage<T>& /*data*/, const C3DShape& /*shape*/)
+       {
+              throw invalid_argument("Label: Only bit and integer valued input images are allowed");
        }
+};
+
+template <typename T>
+struct __dispatch_label<T, true> {
+       static P3DImage apply(const T3DImage<T>& data, const C3DShape& shape)
+       {
+              if (data.size() > numeric_limits<uint32_t>::max())
+                     throw invalid_argument("Label: the input image has too many voxels");
+
+              TLabeller<T> labeller(data, shape);
+              const size_t n_labels = labeller.run();
+              cvdebug() << "Label: found " << n_labels << " connected components\n";
 
-       return presult;
+              if (n_labels < 256) {
+                     C3DUBImage *result = new C3DUBImage(data.get_size(), data);
+                     labeller.write(*result);
+                     return P3DImage(result);
+              } else if (n_labels < 65536) {
+                     C3DUSImage *result = new C3DUSImage(data.get_size(), data);
+                     labeller.write(*result);
+                     return P3DImage(result);
+              } else {
+                     C3DUIImage *result = new C3DUIImage(data.get_size(), data);
+                     labeller.write(*result);
+                     return P3DImage(result);
+              }
+       }
+};
+
+template <typename T>
+CLabel::result_type CLabel::operator () (const T3DImage<T>& data) const
+{
+       return __dispatch_label<T, std::is_integral<T>::value>::apply(data, *m_mask);
+}
+
+CLabel::result_type CLabel::do_filter(const C3DImage& image) const
+{
+       return mia::filter(*this, image);
 }
 
 C3DLabelFilterPlugin::C3DLabelFilterPlugin():
@@ -108,7 +356,8 @@ C3DFilter *C3DLabelFilterPlugin::do_create()const
 
 const string C3DLabelFilterPlugin::do_get_descr()const
 {
-       return "A filter to label the  connected components of a binary image.";
+       return "A filter to label the connected components of a binary image, for integer valued "
+              "images connected voxels of the same non-zero value form a component.";
 }
 
 extern "C" EXPORT CPluginBase *get_plugin_interface()
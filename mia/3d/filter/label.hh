@@ -27,14 +27,21 @@
 
 NS_BEGIN(label_3dimage_filter)
 
+/**
+   Connected component labelling of bit and integer valued images. For integer valued
+   images neighboring voxels are connected if they have the same non-zero value.
+   The labelling is done by a two-pass union-find that runs in parallel over slabs of
+   slices. The labels are numbered in the raster order of the first voxel of each
+   component, i.e. the result doesn't depend on the number of threads used.
+*/
 class CLabel: public mia::C3DFilter
 {
 public:
        CLabel(mia::P3DShape m_mask);
 
+       template <typename T>
+       CLabel::result_type operator () (const mia::T3DImage<T>& data) const;
 private:
-       void grow_region(const mia::C3DBounds& loc, const mia::C3DBitImage& input,
-                        mia::C3DUSImage& result, unsigned short label)const;
        CLabel::result_type do_filter(const mia::C3DImage& image) const;
        mia::P3DShape m_mask;
 };
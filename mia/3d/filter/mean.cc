@@ -19,101 +19,96 @@
  */
 
 #include <limits>
+#include <functional>
 #include <mia/3d/filter/mean.hh>
 #include <mia/core/utils.hh>
 #include <mia/core/threadedmsg.hh>
 
 
 #include <mia/core/parallel.hh>
+#include <mia/core/linebundle.hh>
 
 
 NS_BEGIN(mean_3dimage_filter)
 using namespace mia;
 using std::unique_ptr;
-using std::pair;
-using std::make_pair;
+using std::vector;
 
 C3DMeanFilter::C3DMeanFilter(int hwidth):
        m_hwidth(hwidth)
 {
 }
 
-inline pair<C3DBounds, C3DBounds> prepare_range(const C3DBounds& size, int cx, int cy, int cz, int hw)
+/*
+  Evaluate for each voxel the sum of the intensities in the window of half width hw
+  that is clipped at the image boundaries, and hand the sums of each slice z to
+  consume(z, sums). The sums are obtained by running sums along each axis, so the cost
+  doesn't depend on the window size. The slices are processed in slabs along z, and
+  each slab keeps only the in-plane sums of the slices within its current window in a
+  ring buffer, so no buffer of the size of the volume is needed.
+*/
+template <typename T, typename Consume>
+static void window_sums(const T3DImage<T>& data, size_t hw, Consume consume)
 {
-       int zb = cz - hw;
-
-       if (zb < 0) zb = 0;
-
-       unsigned ze = cz + hw + 1;
-
-       if (ze > size.z) ze = size.z;
-
-       int yb = cy - hw;
-
-       if (yb < 0) yb = 0;
-
-       unsigned ye = cy + hw + 1;
-
-       if (ye > size.y) ye = size.y;
-
-       int xb = cx - hw;
-
-       if (xb < 0) xb = 0;
-
-       unsigned xe = cx + hw + 1;
-
-       if (xe > size.x) xe = size.x;
-
-       return make_pair(C3DBounds(xb, yb, zb), C3DBounds(xe, ye, ze));
+       const C3DBounds& size = data.get_size();
+       const size_t slice_size = size.x * size.y;
+       // a slab needs the planes [z - hw - 1, z + hw] at the same time
+       const size_t ring_size = std::min<size_t>(2 * hw + 2, size.z);
+       auto box_sum = [hw](const double * in, double * out, size_t length, size_t width) {
+              box_sum_line_bundle(in, out, length, width, hw);
+       };
+       const SLineBundleLayout along_x = {size.x, 1, size.y, size.x, 1, 0};
+       const SLineBundleLayout along_y = {size.y, size.x, size.x, 1, 1, 0};
+       auto run_slab = [&](const C1DParallelRange & range) {
+              vector<double> planes(ring_size * slice_size);
+              vector<double> sums(slice_size, 0.0);
+              auto plane = [&planes, ring_size, slice_size](size_t z) {
+                     return planes.begin() + (z % ring_size) * slice_size;
+              };
+              auto add_plane = [&](size_t z) {
+                     auto p = plane(z);
+                     auto src = data.begin_at(0, 0, z);
+                     std::copy(src, src + slice_size, p);
+                     process_line_bundles<double>(p, along_x, box_sum);
+                     process_line_bundles<double>(p, along_y, box_sum);
+                     std::transform(sums.begin(), sums.end(), p, sums.begin(), std::plus<double>());
+              };
+              const size_t zb = range.begin();
+
+              for (size_t z = zb > hw ? zb - hw : 0; z <= zb + hw && z < size.z; ++z)
+                     add_plane(z);
+
+              consume(zb, sums);
+
+              for (size_t z = zb + 1; z < static_cast<size_t>(range.end()); ++z) {
+                     if (z + hw < size.z)
+                            add_plane(z + hw);
+
+                     if (z > hw) {
+                            auto p = plane(z - hw - 1);
+                            std::transform(sums.begin(), sums.end(), p, sums.begin(), std::minus<double>());
+                     }
+
+                     consume(z, sums);
+              }
+       };
+       const size_t n_tasks = get_max_parallel_tasks();
+       pfor(C1DParallelRange(0, size.z, std::max<size_t>(1, (size.z + n_tasks - 1) / n_tasks)), run_slab);
 }
 
-
 template <typename T, bool value>
 struct __dispatch_filter {
-       static T apply(const T3DImage<T>& data, int cx, int cy, int cz, int hw, int freedom)
+       static T apply(double sum, int n, T MIA_PARAM_UNUSED(center))
        {
-              double result = 0.0;
-              int n = freedom;
-              auto range = prepare_range(data.get_size(), cx, cy, cz, hw);
-              auto rb = data.begin_range(range.first, range.second);
-              auto re = data.end_range(range.first, range.second);
-
-              while (rb != re) {
-                     result += *rb;
-                     ++rb;
-                     ++n;
-              }
-
-              // hw >= 0, cy >= 0 && cy < data.get_size().y
-              // therefore n >=1, hence the override
-              // coverity[divide_by_zero]
-              return mia_round_clamped<T>(rint(result / n));
+              return mia_round_clamped<T>(rint(sum / n));
        }
 };
 
 template <typename T>
 struct __dispatch_filter<T, true> {
-       static T apply(const T3DImage<T>& data, int cx, int cy, int cz, int  hw, int freedom)
+       static T apply(double sum, int n, T MIA_PARAM_UNUSED(center))
        {
-              double result = 0.0;
-              int n = freedom;
-              //
-              // see above. Coverty  1128688, 1128687
-              //
-              auto range = prepare_range(data.get_size(), cx, cy, cz, hw);
-              auto rb = data.begin_range(range.first, range.second);
-              auto re = data.end_range(range.first, range.second);
-
-              while (rb != re) {
-                     result += *rb;
-                     ++rb;
-                     ++n;
-              }
-
-              // hw >= 0, cy >= 0 && cy < data.get_size().y
-              // therefore n >=1, hence the override
-              // coverity[divide_by_zero]
-              return static_cast<T>(result / n);
+              return static_cast<T>(sum / n);
        }
 };
 
@@ -121,40 +116,47 @@ struct __dispatch_filter<T, true> {
 // the number of trues and falses equal return the original value
 template <>
 struct __dispatch_filter<bool, false> {
-       static bool apply(const T3DImage<bool>& data, int cx, int cy, int cz, int hw, int MIA_PARAM_UNUSED(freedom))
+       static bool apply(double sum, int n, bool center)
        {
-              int balance = 0;
-              auto range = prepare_range(data.get_size(), cx, cy, cz, hw);
-              auto rb = data.begin_range(range.first, range.second);
-              auto re = data.end_range(range.first, range.second);
-
-              while (rb != re) {
-                     balance += *rb  ? 1 : -1;
-                     ++rb;
-              }
-
+              const double balance = 2 * sum - n;
               return (balance > 0) ? true :
-                     ((balance < 0) ? false : data(cx, cy, cz));
+                     ((balance < 0) ? false : center);
        }
 };
 
-template <class T>
-mia::T3DImage<T> *C3DMeanFilter::apply(const mia::T3DImage<T>& data) const
+/*
+  Store the window averages of slice z, the number of voxels in the clipped window is
+  reduced by 'freedom' to obtain unbiased estimates.
+*/
+template <typename T, typename F>
+static void finalize_window_sums(size_t z, const vector<double>& sums, T3DImage<T>& result, size_t hw,
+                                 int freedom, F finalize)
 {
        const bool is_floating_point = std::is_floating_point<T>::value;
-       T3DImage<T> *result = new T3DImage<T>(data.get_size(), data);
-       const int hw = m_hwidth;
-       auto run_slice  = [hw, data, result](const C1DParallelRange & range) {
-              for (auto z = range.begin(); z != range.end(); ++z) {
-                     auto ir = result->begin_at(0, 0, z);
-
-                     for (size_t y = 0; y < data.get_size().y; ++y)
-                            for (size_t x = 0; x < data.get_size().x; ++x, ++ir) {
-                                   *ir = __dispatch_filter<T, is_floating_point>::apply(data, x, y, z, hw, 0);
-                            }
+       const C3DBounds& size = result.get_size();
+       auto ir = result.begin_at(0, 0, z);
+       auto is = sums.begin();
+       const int nz = box_count(z, size.z, hw);
+
+       for (size_t y = 0; y < size.y; ++y) {
+              const int nyz = nz * box_count(y, size.y, hw);
+
+              for (size_t x = 0; x < size.x; ++x, ++ir, ++is) {
+                     const int n = nyz * box_count(x, size.x, hw) + freedom;
+                     *ir = finalize(__dispatch_filter<T, is_floating_point>::apply(*is, n, *ir));
               }
-       };
-       pfor(C1DParallelRange(0, data.get_size().z, 1), run_slice);
+       }
+}
+
+template <class T>
+mia::T3DImage<T> *C3DMeanFilter::apply(const mia::T3DImage<T>& data) const
+{
+       T3DImage<T> *result = new T3DImage<T>(data);
+       window_sums(data, m_hwidth, [this, result](size_t z, const vector<double>& sums) {
+              finalize_window_sums(z, sums, *result, m_hwidth, 0, [](T x) {
+                     return x;
+              });
+       });
        return result;
 }
 
@@ -170,6 +172,11 @@ mia::P3DImage C3DMeanFilter::do_filter(const mia::C3DImage& image) const
        return mia::filter(*this, image);
 }
 
+int C3DMeanFilter::do_get_support_radius() const
+{
+       return m_hwidth;
+}
+
 
 
 C3DMeanFilterPlugin::C3DMeanFilterPlugin():
@@ -203,20 +210,12 @@ P3DImage C3DVarianceFilter::operator () (const mia::T3DImage<T>& data) const
        unique_ptr<mia::T3DImage<T>> mean(m_mean.apply(data));
        transform(data.begin(), data.end(), mean->begin(), mean->begin(),
                  [](T x, T y) -> T { T xy = x - y; return xy *xy; });
-       const bool is_floating_point = std::is_floating_point<T>::value;
        T3DImage<T> *result = new T3DImage<T>(data.get_size(), data);
-       const int hw = m_hwidth;
-       auto run_slice  = [hw, &mean, result](const C1DParallelRange & range) {
-              for (auto z = range.begin(); z != range.end(); ++z) {
-                     auto ir = result->begin_at(0, 0, z);
-
-                     for (size_t y = 0; y < mean->get_size().y; ++y)
-                            for (size_t x = 0; x < mean->get_size().x; ++x, ++ir) {
-                                   *ir = sqrt(__dispatch_filter<T, is_floating_point>::apply(*mean, x, y, z, hw, -1));
-                            }
-              }
-       };
-       pfor(C1DParallelRange(0, data.get_size().z, 1), run_slice);
+       window_sums(*mean, m_hwidth, [this, result](size_t z, const vector<double>& sums) {
+              finalize_window_sums(z, sums, *result, m_hwidth, -1, [](T x) -> T {
+                     return sqrt(x);
+              });
+       });
        return P3DImage(result);
 }
 
@@ -233,6 +232,12 @@ P3DImage C3DVarianceFilter::do_filter(const mia::C3DImage& image) const
        return mia::filter(*this, image);
 }
 
+int C3DVarianceFilter::do_get_support_radius() const
+{
+       // the deviations are taken from the local mean
+       return 2 * m_hwidth;
+}
+
 
 C3DVarianceFilterPlugin::C3DVarianceFilterPlugin():
        C3DFilterPlugin("variance"),
@@ -38,6 +38,7 @@ public:
        mia::P3DImage operator () (const mia::T3DImage<T>& data) const ;
 private:
        virtual mia::P3DImage do_filter(const mia::C3DImage& image) const;
+       virtual int do_get_support_radius() const;
        int m_hwidth;
 };
 
@@ -66,6 +67,7 @@ public:
 
 private:
        virtual mia::P3DImage do_filter(const mia::C3DImage& image) const;
+       virtual int do_get_support_radius() const;
        int m_hwidth;
        C3DMeanFilter m_mean;
 };
@@ -20,82 +20,460 @@
 
 #include <mia/core/filter.hh>
 #include <mia/core/msgstream.hh>
+#include <mia/core/parallel.hh>
 #include <mia/3d/filter/median.hh>
 
 #include <limits>
+#include <algorithm>
 
 NS_BEGIN(median_3dimage_filter)
 NS_MIA_USE;
 using namespace std;
 using namespace boost;
 
-template < typename T>
-struct __dispatch_median_3dfilter {
-       static T  apply(const T3DImage<T>& data, int x, int y, int z, int width, vector<T>& target_vector)
-       {
-              int idx = 0;
-              auto tend = target_vector.begin();
-
-              for (int iz = max(0, z - width);
-                   iz < min(z + width + 1, (int)data.get_size().z);  ++iz)
-                     for (int iy = max(0, y - width);
-                          iy < min(y + width + 1, (int)data.get_size().y);  ++iy)
-                            for (int ix = max(0, x - width);
-                                 ix < min(x + width + 1, (int)data.get_size().x);  ++ix) {
-                                   ++tend;
-                                   target_vector[idx++] = data(ix, iy, iz);
-                            }
+/*
+  The median filter uses running histograms for binary, 8 and 16 bit images:
+  For each output row the window histogram is slid along x by adding
+  the incoming y-z plane and removing the outgoing one.
+  For histograms with only few bins and large windows the planes are kept as
+  column histograms that are updated when advancing in y, so that sliding
+  along x costs a fixed number of operations (Perreault & Hébert, "Median
+  Filtering in Constant Time", IEEE TIP 16(9), 2007).
+  Other pixel types are mapped to the rank of their intensity if the image
+  contains at most 65536 distinct intensities, otherwise a sorted window is
+  slid along x.
+  Windows are clipped at the image boundary, and for an even number of
+  pixels in the window the mean of the two central values is returned.
+*/
+
+class CFlatHistogram
+{
+public:
+       CFlatHistogram(int bins): m_counts(bins, 0) {}
+
+       void clear()
+       {
+              fill(m_counts.begin(), m_counts.end(), 0);
+       }
+
+       void add(int bin)
+       {
+              ++m_counts[bin];
+       }
+
+       void remove(int bin)
+       {
+              --m_counts[bin];
+       }
+
+       void add(const CFlatHistogram& other)
+       {
+              for (size_t i = 0; i < m_counts.size(); ++i)
+                     m_counts[i] += other.m_counts[i];
+       }
+
+       void remove(const CFlatHistogram& other)
+       {
+              for (size_t i = 0; i < m_counts.size(); ++i)
+                     m_counts[i] -= other.m_counts[i];
+       }
+
+       // returns the bin of the k-th smallest value
+       int select(int k) const
+       {
+              int sum = 0;
+
+              for (size_t i = 0; i < m_counts.size(); ++i) {
+                     sum += m_counts[i];
+
+                     if (sum > k)
+                            return i;
+              }
+
+              return m_counts.size() - 1;
+       }
+private:
+       vector<int> m_counts;
+};
+
+// 16 bit histogram, the coarse level limits the search for the k-th value
+class CTwoLevelHistogram
+{
+public:
+       CTwoLevelHistogram(int MIA_PARAM_UNUSED(bins)):
+              m_coarse(256, 0),
+              m_fine(65536, 0)
+       {
+              assert(bins == 65536);
+       }
+
+       void clear()
+       {
+              fill(m_coarse.begin(), m_coarse.end(), 0);
+              fill(m_fine.begin(), m_fine.end(), 0);
+       }
+
+       void add(int bin)
+       {
+              ++m_coarse[bin >> 8];
+              ++m_fine[bin];
+       }
 
-              if (idx & 1) {
-                     auto mid = target_vector.begin() + idx / 2;
-                     nth_element(target_vector.begin(), mid, tend);
-                     return *mid;
-              } else {
-                     cvdebug() << "idx even\n";
-                     sort(target_vector.begin(), tend);
-                     return (target_vector[idx / 2 - 1] + target_vector[idx / 2]) / 2;
+       void remove(int bin)
+       {
+              --m_coarse[bin >> 8];
+              --m_fine[bin];
+       }
+
+       int select(int k) const
+       {
+              int sum = 0;
+              int c = 0;
+
+              while (c < 255 && sum + m_coarse[c] <= k)
+                     sum += m_coarse[c++];
+
+              int i = c << 8;
+              const int iend = i + 255;
+
+              for (; i < iend; ++i) {
+                     sum += m_fine[i];
+
+                     if (sum > k)
+                            break;
               }
+
+              return i;
+       }
+private:
+       vector<int> m_coarse;
+       vector<int> m_fine;
+};
+
+template <typename T>
+struct __median_bins {
+       static const bool has_bins = false;
+};
+
+template <typename T, int offset, int bins, typename H>
+struct __median_bins_base {
+       static const bool has_bins = true;
+       static const int size = bins;
+       typedef H Histogram;
+
+       static int index(T v)
+       {
+              return v + offset;
+       }
+
+       static T value(int bin)
+       {
+              return bin - offset;
        }
 };
 
 template <>
-struct __dispatch_median_3dfilter<C3DBitImage> {
-       static C3DBitImage::value_type apply(C3DBitImage& data, int x, int y, int z, int width,
-                                            vector<C3DBitImage::value_type>& /*target_vector*/)
-       {
-              int trues = 0;
-              int falses = 0;
-
-              for (int iz = max(0, z - width);
-                   iz < min(z + width + 1, (int)data.get_size().z);  ++iz)
-                     for (int iy = max(0, y - width);
-                          iy < min(y + width + 1, (int)data.get_size().y);  ++iy)
-                            for (int ix = max(0, x - width);
-                                 ix < min(x + width + 1, (int)data.get_size().x);  ++ix) {
-                                   if (data(ix, iy, iz))
-                                          ++trues;
+struct __median_bins<bool>: public __median_bins_base<bool, 0, 2, CFlatHistogram> {};
+
+template <>
+struct __median_bins<int8_t>: public __median_bins_base<int8_t, 128, 256, CFlatHistogram> {};
+
+template <>
+struct __median_bins<uint8_t>: public __median_bins_base<uint8_t, 0, 256, CFlatHistogram> {};
+
+template <>
+struct __median_bins<int16_t>: public __median_bins_base<int16_t, 32768, 65536, CTwoLevelHistogram> {};
+
+template <>
+struct __median_bins<uint16_t>: public __median_bins_base<uint16_t, 0, 65536, CTwoLevelHistogram> {};
+
+template <typename T, typename Histogram, typename BinValue>
+T histogram_median(const Histogram& h, int n, const BinValue& value)
+{
+       if (n & 1)
+              return value(h.select(n / 2));
+       else
+              return (value(h.select(n / 2 - 1)) + value(h.select(n / 2))) / 2;
+}
+
+/*
+  Running histogram median for slice z, bin(i) returns the histogram
+  bin of the pixel with linear index i, and store(i, h, n) must store the
+  median of the n values in histogram h for pixel i.
+*/
+template <typename Histogram, typename Bin, typename Store>
+void running_median_slice(const C3DBounds& size, int z, int w, int bins,
+                          const Bin& bin, const Store& store)
+{
+       const int nx = size.x;
+       const int ny = size.y;
+       const int nxy = nx * ny;
+       const int z0 = max(0, z - w);
+       const int z1 = min<int>(size.z, z + w + 1);
+       // the histogram is cleared only once, at the end of each row the remaining
+       // columns are removed, which is much cheaper than clearing a 16 bit histogram
+       Histogram h(bins);
+
+       for (int y = 0; y < ny; ++y) {
+              const int y0 = max(0, y - w);
+              const int y1 = min(ny, y + w + 1);
+              auto update_plane = [&](int x, bool add) {
+                     for (int iz = z0; iz < z1; ++iz) {
+                            int i = x + nx * y0 + nxy * iz;
+
+                            for (int iy = y0; iy < y1; ++iy, i += nx) {
+                                   if (add)
+                                          h.add(bin(i));
                                    else
-                                          ++falses;
+                                          h.remove(bin(i));
                             }
+                     }
+              };
+
+              for (int x = 0; x < min(w, nx); ++x)
+                     update_plane(x, true);
+
+              int i = nx * y + nxy * z;
 
-              return trues > falses;
+              for (int x = 0; x < nx; ++x, ++i) {
+                     if (x + w < nx)
+                            update_plane(x + w, true);
+
+                     if (x - w - 1 >= 0)
+                            update_plane(x - w - 1, false);
+
+                     const int n = (min(nx, x + w + 1) - max(0, x - w)) * (y1 - y0) * (z1 - z0);
+                     store(i, h, n);
+              }
+
+              for (int x = max(0, nx - w - 1); x < nx; ++x)
+                     update_plane(x, false);
+       }
+}
+
+/*
+  Perreault-Hébert variant for small flat histograms: the window histogram
+  is composed of column histograms that cover the y-z extend of the window
+*/
+template <typename Bin, typename Store>
+void column_median_slice(const C3DBounds& size, int z, int w, int bins,
+                         const Bin& bin, const Store& store)
+{
+       const int nx = size.x;
+       const int ny = size.y;
+       const int nxy = nx * ny;
+       const int z0 = max(0, z - w);
+       const int z1 = min<int>(size.z, z + w + 1);
+       vector<CFlatHistogram> columns(nx, CFlatHistogram(bins));
+       CFlatHistogram h(bins);
+       auto update_row = [&](int y, bool add) {
+              for (int iz = z0; iz < z1; ++iz) {
+                     int i = nx * y + nxy * iz;
+
+                     for (int x = 0; x < nx; ++x, ++i) {
+                            if (add)
+                                   columns[x].add(bin(i));
+                            else
+                                   columns[x].remove(bin(i));
+                     }
+              }
+       };
+
+       for (int y = 0; y < min(w, ny); ++y)
+              update_row(y, true);
+
+       for (int y = 0; y < ny; ++y) {
+              if (y + w < ny)
+                     update_row(y + w, true);
+
+              if (y - w - 1 >= 0)
+                     update_row(y - w - 1, false);
+
+              const int ny_window = min(ny, y + w + 1) - max(0, y - w);
+              h.clear();
+
+              for (int x = 0; x < min(w, nx); ++x)
+                     h.add(columns[x]);
+
+              int i = nx * y + nxy * z;
+
+              for (int x = 0; x < nx; ++x, ++i) {
+                     if (x + w < nx)
+                            h.add(columns[x + w]);
+
+                     if (x - w - 1 >= 0)
+                            h.remove(columns[x - w - 1]);
+
+                     const int n = (min(nx, x + w + 1) - max(0, x - w)) * ny_window * (z1 - z0);
+                     store(i, h, n);
+              }
+       }
+}
+
+template <typename Histogram>
+struct __median_slice {
+       template <typename Bin, typename Store>
+       static void apply(const C3DBounds& size, int z, int w, int bins, const Bin& bin, const Store& store)
+       {
+              running_median_slice<Histogram>(size, z, w, bins, bin, store);
        }
 };
 
+template <>
+struct __median_slice<CFlatHistogram> {
+       template <typename Bin, typename Store>
+       static void apply(const C3DBounds& size, int z, int w, int bins, const Bin& bin, const Store& store)
+       {
+              // the column variant pays off when a y-z plane is larger than the histogram
+              if ((2 * w + 1) * (2 * w + 1) > bins)
+                     column_median_slice(size, z, w, bins, bin, store);
+              else
+                     running_median_slice<CFlatHistogram>(size, z, w, bins, bin, store);
+       }
+};
 
 template <typename T>
-P3DImage C3DMedianFilter::operator () (const T3DImage<T>& data) const
+void sorted_window_median_slice(const T3DImage<T>& data, T3DImage<T>& result, int z, int w)
 {
-       T3DImage<T> *result = new T3DImage<T>(data.get_size(), data);
-       auto i = result->begin();
-       vector<T> target_vector((2 * m_width + 1) * (2 * m_width + 1) * (2 * m_width + 1));
+       const C3DBounds& size = data.get_size();
+       const int nx = size.x;
+       const int ny = size.y;
+       const int nxy = nx * ny;
+       const int z0 = max(0, z - w);
+       const int z1 = min<int>(size.z, z + w + 1);
+       vector<T> window;
+       vector<T> reduced;
+       vector<T> plane;
+
+       for (int y = 0; y < ny; ++y) {
+              const int y0 = max(0, y - w);
+              const int y1 = min(ny, y + w + 1);
+              auto get_plane = [&](int x) {
+                     plane.clear();
+
+                     for (int iz = z0; iz < z1; ++iz) {
+                            int i = x + nx * y0 + nxy * iz;
+
+                            for (int iy = y0; iy < y1; ++iy, i += nx)
+                                   plane.push_back(data[i]);
+                     }
 
-       for (size_t z = 0; z < data.get_size().z; ++z)
-              for (size_t y = 0; y < data.get_size().y; ++y)
-                     for (size_t x = 0; x < data.get_size().x; ++x, ++i)
-                            *i = __dispatch_median_3dfilter<T>::apply(data, x, y, z, m_width, target_vector);
+                     sort(plane.begin(), plane.end());
+              };
+              window.clear();
 
-       return P3DImage(result);
+              for (int x = 0; x < min(w, nx); ++x) {
+                     get_plane(x);
+                     reduced.clear();
+                     merge(window.begin(), window.end(), plane.begin(), plane.end(), back_inserter(reduced));
+                     swap(window, reduced);
+              }
+
+              auto r = result.begin_at(0, y, z);
+
+              for (int x = 0; x < nx; ++x, ++r) {
+                     if (x - w - 1 >= 0) {
+                            get_plane(x - w - 1);
+                            reduced.clear();
+                            set_difference(window.begin(), window.end(), plane.begin(), plane.end(),
+                                           back_inserter(reduced));
+                            swap(window, reduced);
+                     }
+
+                     if (x + w < nx) {
+                            get_plane(x + w);
+                            reduced.clear();
+                            merge(window.begin(), window.end(), plane.begin(), plane.end(), back_inserter(reduced));
+                            swap(window, reduced);
+                     }
+
+                     const size_t n = window.size();
+
+                     if (n & 1)
+                            *r = window[n / 2];
+                     else
+                            *r = (window[n / 2 - 1] + window[n / 2]) / 2;
+              }
+       }
+}
+
+template <typename T, bool has_bins>
+struct __dispatch_median_3dfilter {
+       static void apply(const T3DImage<T>& data, T3DImage<T>& result, int width)
+       {
+              typedef __median_bins<T> Bins;
+              typedef typename Bins::Histogram Histogram;
+              auto bin = [&data](int i) {
+                     return Bins::index(data[i]);
+              };
+              auto value = [](int bin) {
+                     return Bins::value(bin);
+              };
+              auto store = [&result, &value](int i, const Histogram & h, int n) {
+                     result[i] = histogram_median<T>(h, n, value);
+              };
+              auto run_slices = [&](const C1DParallelRange & range) {
+                     for (auto z = range.begin(); z != range.end(); ++z)
+                            __median_slice<Histogram>::apply(data.get_size(), z, width, Bins::size, bin, store);
+              };
+              pfor(C1DParallelRange(0, data.get_size().z, 1), run_slices);
+       }
+};
+
+template <typename T>
+struct __dispatch_median_3dfilter<T, false> {
+       static void apply(const T3DImage<T>& data, T3DImage<T>& result, int width)
+       {
+              vector<T> values(data.begin(), data.end());
+              sort(values.begin(), values.end());
+              values.erase(unique(values.begin(), values.end()), values.end());
+
+              if (values.size() > 65536) {
+                     cvdebug() << "median: " << values.size() << " distinct values, use sorted window\n";
+                     auto run_slices = [&](const C1DParallelRange & range) {
+                            for (auto z = range.begin(); z != range.end(); ++z)
+                                   sorted_window_median_slice(data, result, z, width);
+                     };
+                     pfor(C1DParallelRange(0, data.get_size().z, 1), run_slices);
+                     return;
+              }
+
+              // replace the intensities by their rank and run the 16 bit histogram median
+              vector<uint16_t> ranks(data.size());
+              auto evaluate_ranks = [&](const C1DParallelRange & range) {
+                     for (auto i = range.begin(); i != range.end(); ++i)
+                            ranks[i] = lower_bound(values.begin(), values.end(), data[i]) - values.begin();
+              };
+              pfor(C1DParallelRange(0, data.size(), 4096), evaluate_ranks);
+              auto bin = [&ranks](int i) {
+                     return ranks[i];
+              };
+              auto value = [&values](int bin) {
+                     return values[bin];
+              };
+              auto store = [&result, &value](int i, const CTwoLevelHistogram & h, int n) {
+                     result[i] = histogram_median<T>(h, n, value);
+              };
+              auto run_slices = [&](const C1DParallelRange & range) {
+                     for (auto z = range.begin(); z != range.end(); ++z)
+                            running_median_slice<CTwoLevelHistogram>(data.get_size(), z, width, 65536, bin, store);
+              };
+              pfor(C1DParallelRange(0, data.get_size().z, 1), run_slices);
+       }
+};
+
+template <typename T>
+T3DImage<T> median_3d(const T3DImage<T>& data, int width)
+{
+       T3DImage<T> result(data.get_size(), data);
+       __dispatch_median_3dfilter<T, __median_bins<T>::has_bins>::apply(data, result, width);
+       return result;
+}
+
+template <typename T>
+P3DImage C3DMedianFilter::operator () (const T3DImage<T>& data) const
+{
+       return P3DImage(new T3DImage<T>(median_3d(data, m_width)));
 }
 
 C3DMedianFilter::C3DMedianFilter(int hwidth):
@@ -108,6 +486,11 @@ P3DImage C3DMedianFilter::do_filter(const C3DImage& image) const
        return mia::filter(*this, image);
 }
 
+int C3DMedianFilter::do_get_support_radius() const
+{
+       return m_width;
+}
+
 C3DMedianFilterFactory::C3DMedianFilterFactory():
        C3DFilterPlugin("median"),
        m_hw(1)
@@ -136,21 +519,16 @@ C3DSaltAndPepperFilter::C3DSaltAndPepperFilter(int hwidth, float thresh):
 template <class T>
 P3DImage C3DSaltAndPepperFilter::operator () (const T3DImage<T>& data) const
 {
-       T3DImage<T> *result = new T3DImage<T>(data);
-       typename T3DImage<T>::const_iterator inp = data.begin();
-       typename T3DImage<T>::iterator i = result->begin();
-       vector<T> target_vector((2 * m_width + 1) * (2 * m_width + 1) * (2 * m_width + 1));
-
-       for (size_t z = 0; z < data.get_size().z; ++z)
-              for (size_t y = 0; y < data.get_size().y; ++y)
-                     for (size_t x = 0; x < data.get_size().x; ++x, ++i, ++inp) {
-                            T res = __dispatch_median_3dfilter<T>::apply(data, x, y, z, m_width, target_vector);
-                            float delta = ::fabs((double)(res - *inp));
-
-                            if (delta > m_thresh)
-                                   *i = res;
-                     }
+       T3DImage<T> *result = new T3DImage<T>(median_3d(data, m_width));
+       auto evaluate = [this, &data, result](const C1DParallelRange & range) {
+              for (auto i = range.begin(); i != range.end(); ++i) {
+                     float delta = ::fabs((double)((*result)[i] - data[i]));
 
+                     if (delta <= m_thresh)
+                            (*result)[i] = data[i];
+              }
+       };
+       pfor(C1DParallelRange(0, data.size(), 4096), evaluate);
        return P3DImage(result);
 }
 
@@ -160,6 +538,11 @@ P3DImage C3DSaltAndPepperFilter::do_filter(const C3DImage& image) const
        return mia::filter(*this, image);
 }
 
+int C3DSaltAndPepperFilter::do_get_support_radius() const
+{
+       return m_width;
+}
+
 
 C3DSaltAndPepperFilterFactory::C3DSaltAndPepperFilterFactory():
        C3DFilterPlugin("sandp"),
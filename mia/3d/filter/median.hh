@@ -35,6 +35,7 @@ public:
        mia::P3DImage operator () (const mia::T3DImage<T>& data) const ;
 private:
        virtual mia::P3DImage do_filter(const mia::C3DImage& image) const;
+       virtual int do_get_support_radius() const;
 };
 
 
@@ -51,6 +52,7 @@ public:
 private:
 
        virtual mia::P3DImage do_filter(const mia::C3DImage& image) const;
+       virtual int do_get_support_radius() const;
 };
 
 class C3DMedianFilterFactory: public mia::C3DFilterPlugin
@@ -33,6 +33,19 @@ using namespace std;
 using namespace boost;
 namespace bfs = boost::filesystem;
 
+static int get_shape_radius(const C3DShape& shape)
+{
+       int r = 0;
+
+       for (auto s = shape.begin(); s != shape.end(); ++s) {
+              r = max(r, abs(s->x));
+              r = max(r, abs(s->y));
+              r = max(r, abs(s->z));
+       }
+
+       return r;
+}
+
 
 C3DDilate::C3DDilate(P3DShape shape, bool hint):
        m_shape(shape),
@@ -189,6 +202,11 @@ const string C3DDilateFilterFactory::do_get_descr()const
        return "3d image stack dilate filter";
 }
 
+int C3DDilate::do_get_support_radius() const
+{
+       return get_shape_radius(*m_shape);
+}
+
 C3DErode::C3DErode(P3DShape shape, bool hint):
        m_shape(shape),
        m_more_dark(hint)
@@ -305,6 +323,11 @@ mia::P3DImage C3DErode::do_filter (const C3DImage& image)const
        return ::mia::filter(*this, image);
 }
 
+int C3DErode::do_get_support_radius() const
+{
+       return get_shape_radius(*m_shape);
+}
+
 C3DErodeFilterFactory::C3DErodeFilterFactory():
        C3DMorphFilterFactory("erode")
 {
@@ -338,6 +361,11 @@ P3DImage C3DOpenClose::do_filter(const C3DImage& src) const
        }
 }
 
+int C3DOpenClose::do_get_support_radius() const
+{
+       return m_erode.get_support_radius() + m_dilate.get_support_radius();
+}
+
 
 C3DOpenFilterFactory::C3DOpenFilterFactory():
        C3DMorphFilterFactory("open")
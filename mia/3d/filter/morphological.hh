@@ -38,6 +38,7 @@ public:
 private:
 
        virtual mia::P3DImage do_filter(const mia::C3DImage& src) const;
+       virtual int do_get_support_radius() const;
 
        mia::P3DShape m_shape;
        bool m_more_dark;
@@ -54,6 +55,7 @@ public:
 
 private:
        virtual mia::P3DImage do_filter(const mia::C3DImage& src) const;
+       virtual int do_get_support_radius() const;
 
        mia::P3DShape m_shape;
        bool m_more_dark;
@@ -65,6 +67,7 @@ public:
        C3DOpenClose(mia::P3DShape shape, bool hint, bool open);
 private:
        virtual mia::P3DImage do_filter(const mia::C3DImage& src) const;
+       virtual int do_get_support_radius() const;
 
        C3DErode m_erode;
        C3DDilate m_dilate;
@@ -23,6 +23,7 @@
 
 #include <mia/core/filter.hh>
 #include <mia/core/msgstream.hh>
+#include <mia/core/linebundle.hh>
 #include <mia/3d/filter/sepconv.hh>
 
 
@@ -45,79 +46,51 @@ CSeparableConvolute::CSeparableConvolute(P1DSpacialKernel kx,
 }
 
 
-template <typename A, typename B>
-struct SConvert {
-       B operator ()( A x) const
-       {
-              return B(x);
-       }
+// float images are filtered in single precision, all others in double precision
+template <typename T>
+struct sepconv_accumulator {
+       typedef double type;
 };
 
+template <>
+struct sepconv_accumulator<float> {
+       typedef float type;
+};
 
-template <typename T>
-void CSeparableConvolute::fold(vector<T>& data, const C1DFilterKernel& kernel) const
+template <typename A, typename Iterator>
+static void fold(Iterator data, const SLineBundleLayout& layout, const C1DFilterKernel& kernel)
 {
-       vector<double> tmp(data.size());
-       copy(data.begin(), data.end(), tmp.begin());
-       kernel.apply_inplace(tmp);
-       transform(tmp.begin(), tmp.end(), data.begin(), SConvert<double, T>());
+       C1DFoldingLineBundle bundle(kernel);
+       process_line_bundles<A>(data, layout, [&bundle](const A * in, A * out, size_t length, size_t width) {
+              bundle.apply(in, out, length, width);
+       });
 }
 
-
 template <class T>
 CSeparableConvolute::result_type CSeparableConvolute::operator () (const T3DImage<T>& image) const
 {
-       typedef std::vector<T> invec_t;
+       typedef typename sepconv_accumulator<T>::type A;
        T3DImage<T> *data = new T3DImage<T>(image.get_size(), image);
        copy(image.begin(), image.end(), data->begin());
        CSeparableConvolute::result_type result(data);
-       int cachXSize = data->get_size().x;
-       int cachYSize = data->get_size().y;
-       int cachZSize = data->get_size().z;
-       auto filter_x = [cachXSize, cachYSize, data, this](const C1DParallelRange & range) {
-              invec_t buffer(cachXSize);
-
-              for (auto z = range.begin(); z != range.end(); ++z) {
-                     for (int y = 0; y < cachYSize; y++) {
-                            data->get_data_line_x(y, z, buffer);
-                            fold(buffer, *m_kx);
-                            data->put_data_line_x(y, z, buffer);
-                     }
-              }
-       };
-       auto filter_y = [cachXSize, cachYSize, data, this](const C1DParallelRange & range) {
-              invec_t buffer(cachYSize);
-
-              for (auto z = range.begin(); z != range.end(); ++z) {
-                     for (int x = 0; x < cachXSize; x++) {
-                            data->get_data_line_y(x, z, buffer);
-                            fold(buffer, *m_ky);
-                            data->put_data_line_y(x, z, buffer);
-                     }
-              }
-       };
-       auto filter_z = [cachXSize, cachZSize, data, this](const C1DParallelRange & range) {
-              invec_t buffer(cachZSize);
-
-              for (auto y = range.begin(); y != range.end(); ++y) {
-                     for (int x = 0; x < cachXSize; x++) {
-                            data->get_data_line_z(x, y, buffer);
-                            fold(buffer, *m_kz);
-                            data->put_data_line_z(x, y, buffer);
-                     }
-              }
-       };
+       const C3DBounds& size = data->get_size();
+       const size_t slice_size = size.x * size.y;
 
+       // the lines along x are transposed in tiles, the y and z passes
+       // work on contiguous rows and the x-y plane respectively
        if (m_kx.get()) {
-              pfor(C1DParallelRange(0, cachZSize, 1), filter_x);
+              const SLineBundleLayout along_x = {size.x, 1, size.y * size.z, size.x, 1, 0};
+              fold<A>(data->begin(), along_x, *m_kx);
        }
 
        if (m_ky.get()) {
-              pfor(C1DParallelRange(0, cachZSize, 1), filter_y);
+              const SLineBundleLayout along_y = {size.y, size.x, size.x, 1, size.z, slice_size};
+              fold<A>(data->begin(), along_y, *m_ky);
        }
 
        if (m_kz.get()) {
-              pfor(C1DParallelRange(0, cachYSize, 1), filter_z);
+              const SLineBundleLayout along_z = {size.z, slice_size, slice_size, 1, 1, 0};
+              fold<A>(data->begin(), along_z, *m_kz);
        }
 
        return result;
@@ -128,6 +101,22 @@ CSeparableConvolute::result_type CSeparableConvolute::do_filter(const C3DImage&
        return mia::filter(*this, image);
 }
 
+int CSeparableConvolute::do_get_support_radius() const
+{
+       int r = 0;
+
+       if (m_kx.get())
+              r = max(r, static_cast<int>(m_kx->size() / 2));
+
+       if (m_ky.get())
+              r = max(r, static_cast<int>(m_ky->size() / 2));
+
+       if (m_kz.get())
+              r = max(r, static_cast<int>(m_kz->size() / 2));
+
+       return r;
+}
+
 
 C3DSeparableConvoluteFilterPlugin::C3DSeparableConvoluteFilterPlugin():
        C3DFilterPlugin("sepconv")
@@ -36,11 +36,9 @@ public:
        template <typename  T>
        CSeparableConvolute::result_type operator () (const mia::T3DImage<T>& data) const;
 
-       template <typename T>
-       void fold(std::vector<T>& v, const mia::C1DFilterKernel& kernel)const;
-
 private:
        mia::C3DFilter::result_type do_filter(const mia::C3DImage& image) const;
+       int do_get_support_radius() const;
 
        mia::P1DSpacialKernel m_kx;
        mia::P1DSpacialKernel m_ky;
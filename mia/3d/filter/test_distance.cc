@@ -70,6 +70,39 @@ BOOST_FIXTURE_TEST_CASE( test_distance_full3d_func,  Distance3DFuncFixture )
        }
 }
 
+BOOST_AUTO_TEST_CASE( test_distance_voxel_size )
+{
+       C3DBitImage src_img(C3DBounds(3, 3, 3));
+       src_img(1, 1, 1) = true;
+       src_img.set_voxel_size(C3DFVector(1, 2, 3));
+       auto distance = BOOST_TEST_create_from_plugin<C3DDistanceImageFilterFactory>("distance:vs=1");
+       P3DImage presult =  distance->filter(src_img);
+       const C3DFImage& result = dynamic_cast<const C3DFImage&>(*presult);
+       BOOST_CHECK_EQUAL(result.get_voxel_size(), C3DFVector(1, 2, 3));
+       BOOST_CHECK_CLOSE(result(0, 1, 1), 1.0f, 0.1);
+       BOOST_CHECK_CLOSE(result(1, 0, 1), 2.0f, 0.1);
+       BOOST_CHECK_CLOSE(result(1, 1, 2), 3.0f, 0.1);
+       BOOST_CHECK_CLOSE(result(0, 0, 0), sqrtf(14.0f), 0.1);
+}
+
+BOOST_AUTO_TEST_CASE( test_distance_signed )
+{
+       C3DBitImage src_img(C3DBounds(6, 1, 1));
+       src_img(1, 0, 0) = true;
+       src_img(2, 0, 0) = true;
+       src_img(3, 0, 0) = true;
+       const float test_val[6] = {1, -1, -2, -1, 1, 2};
+       C3DDistanceFilter distance(false, true);
+       P3DImage presult =  distance.filter(src_img);
+       const C3DFImage& result = dynamic_cast<const C3DFImage&>(*presult);
+
+       for (int x = 0; x < 6; ++x)
+              BOOST_CHECK_CLOSE(result(x, 0, 0), test_val[x], 0.1);
+
+       C3DFImage float_img(C3DBounds(6, 1, 1));
+       BOOST_CHECK_THROW(distance.filter(float_img), std::invalid_argument);
+}
+
 const bool Distance3DInfFixture::src_init[] = {
        1, 0, 0, 0,   0, 0, 0, 0,   0, 0, 0, 0,  0, 0, 0, 0,
        0, 0, 0, 0,   0, 0, 0, 0,   0, 0, 1, 0,  0, 0, 0, 0,
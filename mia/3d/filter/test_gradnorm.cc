@@ -77,3 +77,31 @@ BOOST_AUTO_TEST_CASE( test_gradnorm )
               BOOST_CHECK_CLOSE(1.0 + *f, 1.0 + ref_data[i] / 2.5f, 0.1);
        }
 }
+
+BOOST_AUTO_TEST_CASE( test_gradnorm_not_normalized_slabs )
+{
+       C3DFImage image(C3DBounds(5, 6, 11));
+       int v = 7;
+
+       for (auto i = image.begin(); i != image.end(); ++i) {
+              v = (v * 31 + 11) % 101;
+              *i = v;
+       }
+
+       auto normalized = BOOST_TEST_create_from_plugin<C3DGradnormFilterPlugin>("gradnorm");
+       BOOST_CHECK_EQUAL(normalized->get_support_radius(), -1);
+
+       auto filter = BOOST_TEST_create_from_plugin<C3DGradnormFilterPlugin>("gradnorm:normalize=0");
+       BOOST_CHECK_EQUAL(filter->get_support_radius(), 1);
+       auto expect = filter->filter(image);
+       const C3DFImage& e = dynamic_cast<const C3DFImage&>(*expect);
+       BOOST_CHECK_CLOSE(e(2, 3, 4), sqrt(pow(image(3, 3, 4) - image(1, 3, 4), 2) +
+                                          pow(image(2, 4, 4) - image(2, 2, 4), 2) +
+                                          pow(image(2, 3, 5) - image(2, 3, 3), 2)), 0.01);
+
+       for (unsigned slab_depth = 1; slab_depth < 12; slab_depth += 2) {
+              auto result = run_filter_in_memory_slabs(image, *filter, slab_depth);
+              const C3DFImage& r = dynamic_cast<const C3DFImage&>(*result);
+              BOOST_CHECK_EQUAL_COLLECTIONS(r.begin(), r.end(), e.begin(), e.end());
+       }
+}
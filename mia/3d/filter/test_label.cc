@@ -18,7 +18,10 @@
  *
  */
 
+#include <queue>
+
 #include <mia/internal/autotest.hh>
+#include <mia/core/parallel.hh>
 #include <mia/3d/filter/label.hh>
 
 NS_MIA_USE
@@ -95,3 +98,142 @@ BOOST_AUTO_TEST_CASE( test_label )
        check(inp, "18n", answer_18n);
        check(inp, "26n", answer_26n);
 }
+
+BOOST_AUTO_TEST_CASE( test_label_integer )
+{
+       unsigned char input[27] = { 1, 1, 0,
+                                   2, 2, 0,
+                                   0, 0, 0,
+
+                                   0, 0, 0,
+                                   0, 0, 0,
+                                   0, 0, 0,
+
+                                   0, 0, 0,
+                                   0, 0, 0,
+                                   3, 3, 1
+                                 };
+       unsigned char answer_6n[27] = { 1, 1, 0,
+                                       2, 2, 0,
+                                       0, 0, 0,
+
+                                       0, 0, 0,
+                                       0, 0, 0,
+                                       0, 0, 0,
+
+                                       0, 0, 0,
+                                       0, 0, 0,
+                                       3, 3, 4
+                                     };
+       C3DBounds size(3, 3, 3);
+       C3DUBImage inp(size);
+       copy (input, input + 27, inp.begin());
+       check(inp, "6n", answer_6n);
+}
+
+BOOST_AUTO_TEST_CASE( test_label_float_throws )
+{
+       C3DFImage inp(C3DBounds(3, 3, 3));
+       CLabel label(C3DShapePluginHandler::instance().produce("6n"));
+       BOOST_CHECK_THROW(label.filter(inp), invalid_argument);
+}
+
+/*
+  Reference implementation: grow each component from its first voxel in raster order
+  with a flood fill.
+*/
+static vector<unsigned int> flood_fill_label(const C3DBitImage& input, const C3DShape& shape)
+{
+       const C3DBounds size = input.get_size();
+       vector<unsigned int> result(input.size(), 0);
+       unsigned int label = 0;
+       auto idx = [&size](const C3DBounds & p) {
+              return p.x + size.x * (p.y + size.y * p.z);
+       };
+       C3DBounds loc;
+
+       for (loc.z = 0; loc.z < size.z; ++loc.z)
+              for (loc.y = 0; loc.y < size.y; ++loc.y)
+                     for (loc.x = 0; loc.x < size.x; ++loc.x) {
+                            if (!input(loc) || result[idx(loc)])
+                                   continue;
+
+                            ++label;
+                            queue<C3DBounds> neighbors;
+                            neighbors.push(loc);
+                            result[idx(loc)] = label;
+
+                            while (!neighbors.empty()) {
+                                   C3DBounds l = neighbors.front();
+                                   neighbors.pop();
+
+                                   for (auto s = shape.begin(); s != shape.end(); ++s) {
+                                          C3DBounds pos(l.x + s->x, l.y + s->y, l.z + s->z);
+
+                                          if (pos.x < size.x && pos.y < size.y && pos.z < size.z &&
+                                              input(pos) && !result[idx(pos)]) {
+                                                 result[idx(pos)] = label;
+                                                 neighbors.push(pos);
+                                          }
+                                   }
+                            }
+                     }
+
+       return result;
+}
+
+template <typename T>
+static bool same_labels(const C3DImage& image, const vector<unsigned int>& expect)
+{
+       const T3DImage<T>& labels = dynamic_cast<const T3DImage<T>&>(image);
+       return equal(labels.begin(), labels.end(), expect.begin());
+}
+
+/*
+  A sparse segmentation with many small components, the labelling must be
+  identical to the flood fill for all neighborhoods and independent of the number
+  of threads. The run time of the labelling is measured by mia-benchmarks.
+*/
+BOOST_AUTO_TEST_CASE( test_label_sparse_matches_flood_fill )
+{
+       const C3DBounds size(48, 40, 36);
+       C3DBitImage inp(size);
+       unsigned int seed = 17;
+       auto i = inp.begin_range(C3DBounds::_0, size);
+
+       for (; i != inp.end_range(C3DBounds::_0, size); ++i) {
+              seed = seed * 1103515245 + 12345;
+              auto p = i.pos();
+              // sparse random voxels plus some long tubes that span many slabs
+              *i = ((seed >> 16) % 100) < 12 || ((p.x % 20) == 3 && (p.y % 15) == 7);
+       }
+
+       for (auto n : {"6n", "18n", "26n"}) {
+              P3DShape shape = C3DShapePluginHandler::instance().produce(n);
+              const vector<unsigned int> expect = flood_fill_label(inp, *shape);
+              const unsigned int n_labels = *max_element(expect.begin(), expect.end());
+              CLabel label(shape);
+              auto check_labels = [&]() {
+                     P3DImage result = label.filter(inp);
+
+                     if (n_labels < 256)
+                            BOOST_CHECK(same_labels<unsigned char>(*result, expect));
+                     else if (n_labels < 65536)
+                            BOOST_CHECK(same_labels<unsigned short>(*result, expect));
+                     else
+                            BOOST_CHECK(same_labels<uint32_t>(*result, expect));
+              };
+#ifndef HAVE_TBB
+              const int old_max_tasks = CMaxTasks::get_max_tasks();
+
+              for (int n_tasks : {1, 2, 4}) {
+                     CMaxTasks::set_max_tasks(n_tasks);
+                     check_labels();
+              }
+
+              CMaxTasks::set_max_tasks(old_max_tasks);
+#else
+              check_labels();
+#endif
+       }
+}
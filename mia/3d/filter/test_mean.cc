@@ -28,6 +28,7 @@
 #include <mia/internal/plugintester.hh>
 #include <mia/3d/filter/mean.hh>
 #include <mia/3d/imagetest.hh>
+#include <mia/3d/imageio.hh>
 
 
 using namespace mia;
@@ -106,3 +107,196 @@ BOOST_AUTO_TEST_CASE( test_variance_from_plugin_real)
        BOOST_REQUIRE(result);
        test_image_equal(*result, expect);
 }
+
+BOOST_AUTO_TEST_CASE( test_mean_variance_chain_slabwise )
+{
+       C3DFImage image(C3DBounds(5, 6, 13));
+       int v = 7;
+
+       for (auto i = image.begin(); i != image.end(); ++i) {
+              v = (v * 31 + 11) % 101;
+              *i = v;
+       }
+
+       P3DFilter mean(BOOST_TEST_create_from_plugin<C3DMeanFilterPlugin>("mean:w=1"));
+       P3DFilter variance(BOOST_TEST_create_from_plugin<C3DVarianceFilterPlugin>("variance:w=2"));
+       TDataFilterChained<C3DImage> chain;
+       chain.push_back(mean);
+       chain.push_back(variance);
+       BOOST_CHECK_EQUAL(chain.get_support_radius(), 5);
+       auto expect = chain.filter(image);
+
+       for (unsigned slab_depth = 1; slab_depth < 14; slab_depth += 3) {
+              BOOST_TEST_MESSAGE("slab depth " << slab_depth);
+              auto result = run_filter_in_memory_slabs(image, chain, slab_depth);
+              BOOST_REQUIRE(result);
+              test_image_equal(*result, *expect);
+       }
+}
+
+/*
+  Reads the slices of an image in memory and keeps track of the read requests.
+*/
+class CSliceReaderMock: public C3DImageSliceReader
+{
+public:
+       CSliceReaderMock(const C3DFImage& image):
+              m_image(image), m_next(0), m_max_read(0) {}
+
+       C3DBounds get_size() const
+       {
+              return m_image.get_size();
+       }
+
+       P3DImage read_slices(unsigned n)
+       {
+              const C3DBounds& size = m_image.get_size();
+              BOOST_REQUIRE(m_next + n <= size.z);
+              C3DFImage *slices = new C3DFImage(C3DBounds(size.x, size.y, n), m_image);
+              copy(m_image.begin_at(0, 0, m_next), m_image.begin_at(0, 0, m_next + n), slices->begin());
+              m_next += n;
+              m_max_read = max(m_max_read, n);
+              return P3DImage(slices);
+       }
+
+       const C3DFImage& m_image;
+       unsigned m_next;
+       unsigned m_max_read;
+};
+
+BOOST_AUTO_TEST_CASE( test_mean_variance_chain_streaming )
+{
+       C3DFImage image(C3DBounds(5, 6, 23));
+       int v = 7;
+
+       for (auto i = image.begin(); i != image.end(); ++i) {
+              v = (v * 31 + 11) % 101;
+              *i = v;
+       }
+
+       P3DFilter mean(BOOST_TEST_create_from_plugin<C3DMeanFilterPlugin>("mean:w=1"));
+       P3DFilter variance(BOOST_TEST_create_from_plugin<C3DVarianceFilterPlugin>("variance:w=2"));
+       TDataFilterChained<C3DImage> chain;
+       chain.push_back(mean);
+       chain.push_back(variance);
+       auto expect = chain.filter(image);
+
+       for (unsigned slab_depth = 1; slab_depth < 24; slab_depth += 4) {
+              BOOST_TEST_MESSAGE("slab depth " << slab_depth);
+              CSliceReaderMock reader(image);
+              C3DFImage result(image.get_size());
+              unsigned z = 0;
+              run_filter_streaming(reader, chain, slab_depth, [&](const C3DImage & slices) {
+                     BOOST_REQUIRE(slices.get_pixel_type() == it_float);
+                     BOOST_REQUIRE(slices.get_size().z <= slab_depth);
+                     BOOST_REQUIRE(z + slices.get_size().z <= result.get_size().z);
+                     const C3DFImage& s = dynamic_cast<const C3DFImage&>(slices);
+                     copy(s.begin(), s.end(), result.begin_at(0, 0, z));
+                     z += slices.get_size().z;
+              });
+              BOOST_CHECK_EQUAL(z, image.get_size().z);
+              BOOST_CHECK_EQUAL(reader.m_next, image.get_size().z);
+              // the slices are read in one go only for the first slab with its halo
+              BOOST_CHECK(reader.m_max_read <= slab_depth + 5);
+              test_image_equal(result, *expect);
+       }
+}
+
+// a filter that doesn't report a support radius
+class CCopyFilter: public C3DFilter
+{
+       P3DImage do_filter(const C3DImage& image) const
+       {
+              return P3DImage(image.clone());
+       }
+};
+
+BOOST_AUTO_TEST_CASE( test_streaming_rejects_non_local_filter )
+{
+       C3DFImage image(C3DBounds(5, 6, 7));
+       CSliceReaderMock reader(image);
+       CCopyFilter copy_filter;
+       BOOST_CHECK_THROW(run_filter_streaming(reader, copy_filter, 2, [](const C3DImage&) {}),
+                         invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE( test_mean_large_window_ubyte )
+{
+       const C3DBounds size(17, 13, 11);
+       C3DUBImage image(size);
+       int v = 3;
+
+       for (auto i = image.begin(); i != image.end(); ++i) {
+              v = (v * 31 + 11) % 251;
+              *i = v;
+       }
+
+       const int hw = 4;
+       C3DUBImage expect(size);
+
+       for (int z = 0; z < (int)size.z; ++z)
+              for (int y = 0; y < (int)size.y; ++y)
+                     for (int x = 0; x < (int)size.x; ++x) {
+                            double sum = 0.0;
+                            int n = 0;
+
+                            for (int iz = max(0, z - hw); iz < min<int>(size.z, z + hw + 1); ++iz)
+                                   for (int iy = max(0, y - hw); iy < min<int>(size.y, y + hw + 1); ++iy)
+                                          for (int ix = max(0, x - hw); ix < min<int>(size.x, x + hw + 1); ++ix, ++n)
+                                                 sum += image(ix, iy, iz);
+
+                            expect(x, y, z) = rint(sum / n);
+                     }
+
+       auto c = BOOST_TEST_create_from_plugin<C3DMeanFilterPlugin>("mean:w=4");
+       // the slices are split into one slab per task
+#ifndef HAVE_TBB
+       const int old_max_tasks = CMaxTasks::get_max_tasks();
+
+       for (int n_tasks : {1, 2, 3, 5}) {
+              CMaxTasks::set_max_tasks(n_tasks);
+#endif
+              auto result = c->filter(image);
+              BOOST_REQUIRE(result);
+              const C3DUBImage& r = dynamic_cast<const C3DUBImage&>(*result);
+              BOOST_CHECK(equal(r.begin(), r.end(), expect.begin()));
+#ifndef HAVE_TBB
+       }
+
+       CMaxTasks::set_max_tasks(old_max_tasks);
+#endif
+}
+
+BOOST_AUTO_TEST_CASE( test_mean_bit_image )
+{
+       const C3DBounds size(9, 7, 12);
+       C3DBitImage image(size);
+       int v = 5;
+
+       for (auto i = image.begin(); i != image.end(); ++i) {
+              v = (v * 31 + 11) % 97;
+              *i = v > 40;
+       }
+
+       C3DBitImage expect(size);
+
+       for (int z = 0; z < (int)size.z; ++z)
+              for (int y = 0; y < (int)size.y; ++y)
+                     for (int x = 0; x < (int)size.x; ++x) {
+                            int sum = 0;
+                            int n = 0;
+
+                            for (int iz = max(0, z - 1); iz < min<int>(size.z, z + 2); ++iz)
+                                   for (int iy = max(0, y - 1); iy < min<int>(size.y, y + 2); ++iy)
+                                          for (int ix = max(0, x - 1); ix < min<int>(size.x, x + 2); ++ix, ++n)
+                                                 sum += image(ix, iy, iz);
+
+                            expect(x, y, z) = 2 * sum > n ? true : (2 * sum < n ? false : image(x, y, z));
+                     }
+
+       auto c = BOOST_TEST_create_from_plugin<C3DMeanFilterPlugin>("mean:w=1");
+       auto result = c->filter(image);
+       BOOST_REQUIRE(result);
+       const C3DBitImage& r = dynamic_cast<const C3DBitImage&>(*result);
+       BOOST_CHECK(equal(r.begin(), r.end(), expect.begin()));
+}
@@ -108,3 +108,87 @@ BOOST_AUTO_TEST_CASE( test_saltnpepper )
        for (C3DFImage::const_iterator i = presult.begin(); i != presult.end(); ++i, ++k)
               BOOST_CHECK_CLOSE(*i, test_data[k], 0.1);
 }
+
+template <typename T>
+T brute_force_median(const T3DImage<T>& data, int x, int y, int z, int w)
+{
+       vector<T> values;
+       const C3DBounds& size = data.get_size();
+
+       for (int iz = max(0, z - w); iz < min<int>(z + w + 1, size.z); ++iz)
+              for (int iy = max(0, y - w); iy < min<int>(y + w + 1, size.y); ++iy)
+                     for (int ix = max(0, x - w); ix < min<int>(x + w + 1, size.x); ++ix)
+                            values.push_back(data(ix, iy, iz));
+
+       sort(values.begin(), values.end());
+       const size_t n = values.size();
+       return (n & 1) ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+template <typename T>
+void run_median_compare_test(int w, int range)
+{
+       T3DImage<T> input(C3DBounds(11, 9, 7));
+       int k = 17;
+
+       for (auto i = input.begin(); i != input.end(); ++i) {
+              k = (k * 1103 + 12345) % 65521;
+              *i = static_cast<T>(k % range);
+       }
+
+       C3DMedianFilter filter(w);
+       P3DImage result = filter.filter(input);
+       const T3DImage<T>& presult = dynamic_cast<const T3DImage<T>&>(*result);
+       BOOST_REQUIRE_EQUAL(presult.get_size(), input.get_size());
+
+       for (size_t z = 0; z < input.get_size().z; ++z)
+              for (size_t y = 0; y < input.get_size().y; ++y)
+                     for (size_t x = 0; x < input.get_size().x; ++x)
+                            BOOST_CHECK_EQUAL(presult(x, y, z), brute_force_median(input, x, y, z, w));
+}
+
+BOOST_AUTO_TEST_CASE( test_median_ubyte_running_histogram )
+{
+       run_median_compare_test<uint8_t>(2, 256);
+}
+
+BOOST_AUTO_TEST_CASE( test_median_ubyte_column_histogram )
+{
+       run_median_compare_test<uint8_t>(8, 256);
+}
+
+BOOST_AUTO_TEST_CASE( test_median_sshort )
+{
+       run_median_compare_test<int16_t>(2, 30000);
+}
+
+BOOST_AUTO_TEST_CASE( test_median_sint_ranked )
+{
+       run_median_compare_test<int32_t>(3, 1000);
+}
+
+BOOST_AUTO_TEST_CASE( test_median_bit )
+{
+       run_median_compare_test<bool>(1, 2);
+}
+
+BOOST_AUTO_TEST_CASE( test_median_float_sorted_window )
+{
+       // more than 65536 distinct values force the sorted window code path
+       C3DFImage input(C3DBounds(45, 45, 35));
+       int k = 17;
+
+       for (auto i = input.begin(); i != input.end(); ++i) {
+              k = (k * 1103 + 12345) % 65521;
+              *i = k + 0.5f * (i - input.begin()) / input.size();
+       }
+
+       C3DMedianFilter filter(1);
+       P3DImage result = filter.filter(input);
+       const C3DFImage& presult = dynamic_cast<const C3DFImage&>(*result);
+
+       for (size_t z = 0; z < input.get_size().z; ++z)
+              for (size_t y = 0; y < input.get_size().y; ++y)
+                     for (size_t x = 0; x < input.get_size().x; ++x)
+                            BOOST_CHECK_EQUAL(presult(x, y, z), brute_force_median(input, x, y, z, 1));
+}
@@ -19,6 +19,7 @@
  */
 
 #include <iomanip>
+#include <sstream>
 #include <mia/internal/plugintester.hh>
 #include <mia/3d/filter/seededwatershed.hh>
 
@@ -309,3 +310,107 @@ BOOST_AUTO_TEST_CASE ( test_seeded_watershead_from_grad )
        }
 }
 
+
+/*
+  A float image with integer values that is quantized with one level per value
+  must be flooded exactly like the integer image itself. The FIFO buckets may
+  place the watersheds differently, but they must still reach all pixels.
+  The run times are measured by mia-benchmarks.
+*/
+BOOST_AUTO_TEST_CASE ( test_seeded_watershead_bucket_queue )
+{
+       const C3DBounds size(40, 36, 32);
+       C3DUSImage *usimage = new C3DUSImage(size);
+       C3DFImage *fimage = new C3DFImage(size);
+       C3DUBImage *seeds = new C3DUBImage(size);
+       auto i = usimage->begin_range(C3DBounds::_0, size);
+       auto f = fimage->begin();
+
+       for (; i != usimage->end_range(C3DBounds::_0, size); ++i, ++f) {
+              auto p = i.pos();
+              *i = static_cast<unsigned short>(100 * (2.0 + sin(0.2 * p.x) * cos(0.15 * p.y) + sin(0.1 * p.z)));
+              *f = *i;
+       }
+
+       (*seeds)(C3DBounds(2, 2, 2)) = 1;
+       (*seeds)(C3DBounds(36, 4, 16)) = 2;
+       (*seeds)(C3DBounds(16, 30, 6)) = 3;
+       (*seeds)(C3DBounds(24, 20, 29)) = 4;
+       save_image("bigseed.@", P3DImage(seeds));
+       P3DImage usinput(usimage);
+       P3DImage finput(fimage);
+       auto range = minmax_element(usimage->begin(), usimage->end());
+       stringstream qdescr;
+       qdescr << "sws:seed=bigseed.@,n=6n,grad=1,q=" << *range.second - *range.first + 1;
+       auto ws = BOOST_TEST_create_from_plugin<C3DSeededWSFilterPlugin>("sws:seed=bigseed.@,n=6n,grad=1");
+       auto wsq = BOOST_TEST_create_from_plugin<C3DSeededWSFilterPlugin>(qdescr.str().c_str());
+       auto wsf = BOOST_TEST_create_from_plugin<C3DSeededWSFilterPlugin>("sws:seed=bigseed.@,n=6n,grad=1,fifo=1");
+       auto bucket_result = ws->filter(*usinput);
+       auto quantized_result = wsq->filter(*finput);
+       auto priority_result = ws->filter(*finput);
+       auto fifo_result = wsf->filter(*usinput);
+       const C3DUBImage& rb = dynamic_cast<const C3DUBImage&>(*bucket_result);
+       const C3DUBImage& rq = dynamic_cast<const C3DUBImage&>(*quantized_result);
+       const C3DUBImage& rp = dynamic_cast<const C3DUBImage&>(*priority_result);
+       const C3DUBImage& rf = dynamic_cast<const C3DUBImage&>(*fifo_result);
+       BOOST_CHECK(equal(rb.begin(), rb.end(), rq.begin()));
+       BOOST_CHECK(equal(rb.begin(), rb.end(), rp.begin()));
+       // all pixels are labelled
+       BOOST_CHECK(find(rb.begin(), rb.end(), 0) == rb.end());
+       BOOST_CHECK(find(rp.begin(), rp.end(), 0) == rp.end());
+       BOOST_CHECK(find(rf.begin(), rf.end(), 0) == rf.end());
+
+       for (unsigned char l = 1; l < 5; ++l) {
+              BOOST_CHECK(find(rb.begin(), rb.end(), l) != rb.end());
+              BOOST_CHECK(find(rp.begin(), rp.end(), l) != rp.end());
+              BOOST_CHECK(find(rf.begin(), rf.end(), l) != rf.end());
+       }
+
+       // the seeds keep their labels
+       BOOST_CHECK_EQUAL(rf(C3DBounds(2, 2, 2)), 1);
+       BOOST_CHECK_EQUAL(rf(C3DBounds(36, 4, 16)), 2);
+       BOOST_CHECK_EQUAL(rf(C3DBounds(16, 30, 6)), 3);
+       BOOST_CHECK_EQUAL(rf(C3DBounds(24, 20, 29)), 4);
+}
+
+/*
+  The bucket queue must flood in the same order as the priority queue. An input
+  with few distinct values has many plateaus and lower valued pixels that are
+  reached late, and with the watersheds marked the labels depend on the order
+  of the flooding.
+*/
+BOOST_AUTO_TEST_CASE ( test_seeded_watershead_bucket_queue_order )
+{
+       const C3DBounds size(24, 20, 16);
+       C3DUSImage *usimage = new C3DUSImage(size);
+       C3DFImage *fimage = new C3DFImage(size);
+       C3DUBImage *seeds = new C3DUBImage(size);
+       auto i = usimage->begin_range(C3DBounds::_0, size);
+       auto f = fimage->begin();
+
+       for (; i != usimage->end_range(C3DBounds::_0, size); ++i, ++f) {
+              auto p = i.pos();
+              *i = static_cast<unsigned short>(2.0 * (2.0 + sin(0.7 * p.x) * cos(0.5 * p.y) + sin(0.4 * p.z)));
+              *f = *i;
+       }
+
+       (*seeds)(C3DBounds(2, 2, 2)) = 1;
+       (*seeds)(C3DBounds(20, 3, 8)) = 2;
+       (*seeds)(C3DBounds(10, 17, 4)) = 3;
+       (*seeds)(C3DBounds(15, 12, 14)) = 4;
+       (*seeds)(C3DBounds(5, 15, 10)) = 5;
+       save_image("orderseed.@", P3DImage(seeds));
+       P3DImage usinput(usimage);
+       P3DImage finput(fimage);
+
+       for (auto descr : {"sws:seed=orderseed.@,n=6n,grad=1", "sws:seed=orderseed.@,n=6n,grad=1,mark=1",
+                          "sws:seed=orderseed.@,n=18n,grad=1,mark=1"
+                         }) {
+              auto ws = BOOST_TEST_create_from_plugin<C3DSeededWSFilterPlugin>(descr);
+              auto bucket_result = ws->filter(*usinput);
+              auto priority_result = ws->filter(*finput);
+              const C3DUBImage& rb = dynamic_cast<const C3DUBImage&>(*bucket_result);
+              const C3DUBImage& rp = dynamic_cast<const C3DUBImage&>(*priority_result);
+              BOOST_CHECK_MESSAGE(equal(rb.begin(), rb.end(), rp.begin()), descr);
+       }
+}
@@ -181,3 +181,64 @@ BOOST_AUTO_TEST_CASE( test_sobel_z )
 }
 
 
+
+BOOST_AUTO_TEST_CASE( test_sepconv_large_against_linewise )
+{
+       // large enough to use the bundled folding in all directions
+       C3DBounds size(23, 21, 12);
+       C3DSSImage src(size);
+       int k = 0;
+
+       for (auto i = src.begin(); i != src.end(); ++i, ++k)
+              *i = (k * 37) % 101;
+
+       const auto&  skp = C1DSpacialKernelPluginHandler::instance();
+       auto kx = skp.produce("gauss:w=2");
+       auto ky = skp.produce("cdiff");
+       auto kz = skp.produce("gauss:w=3");
+       CSeparableConvolute sp(kx, ky, kz);
+       P3DImage presult = sp.filter(src);
+       const C3DSSImage& result = dynamic_cast<const C3DSSImage&>(*presult);
+       C3DSSImage test(src);
+       vector<double> line_x(size.x);
+       vector<double> line_y(size.y);
+       vector<double> line_z(size.z);
+
+       for (size_t z = 0; z < size.z; ++z)
+              for (size_t y = 0; y < size.y; ++y) {
+                     for (size_t x = 0; x < size.x; ++x)
+                            line_x[x] = test(x, y, z);
+
+                     kx->apply_inplace(line_x);
+
+                     for (size_t x = 0; x < size.x; ++x)
+                            test(x, y, z) = static_cast<int16_t>(line_x[x]);
+              }
+
+       for (size_t z = 0; z < size.z; ++z)
+              for (size_t x = 0; x < size.x; ++x) {
+                     for (size_t y = 0; y < size.y; ++y)
+                            line_y[y] = test(x, y, z);
+
+                     ky->apply_inplace(line_y);
+
+                     for (size_t y = 0; y < size.y; ++y)
+                            test(x, y, z) = static_cast<int16_t>(line_y[y]);
+              }
+
+       for (size_t y = 0; y < size.y; ++y)
+              for (size_t x = 0; x < size.x; ++x) {
+                     for (size_t z = 0; z < size.z; ++z)
+                            line_z[z] = test(x, y, z);
+
+                     kz->apply_inplace(line_z);
+
+                     for (size_t z = 0; z < size.z; ++z)
+                            test(x, y, z) = static_cast<int16_t>(line_z[z]);
+              }
+
+       auto t = test.begin();
+
+       for (auto i = result.begin(); i != result.end(); ++i, ++t)
+              BOOST_CHECK_EQUAL(*i, *t);
+}
@@ -40,6 +40,7 @@ EXPLICIT_INSTANCE_PLUGIN_HANDLER(C3DFullCostPlugin);
 
 template class TFullCostPlugin<C3DTransformation>;
 template class TFullCost<C3DTransformation>;
+template class TDeformedDataStore<C3DTransformation>;
 
 
 NS_MIA_END
@@ -20,6 +20,8 @@
 
 #include <mia/3d/fullcost/image.hh>
 #include <mia/3d/filter.hh>
+#include <mia/core/errormacro.hh>
+#include <mia/core/parallel.hh>
 
 NS_MIA_BEGIN
 
@@ -29,7 +31,10 @@ C3DImageFullCost::C3DImageFullCost(const std::string& src,
                                    const std::string& ref,
                                    P3DImageCost cost,
                                    double weight,
-                                   bool debug):
+                                   bool debug,
+                                   CVoxelSampler::EStrategy sampling,
+                                   double fraction,
+                                   unsigned seed):
        C3DFullCost(weight),
        m_src_key(C3DImageIOPluginHandler::instance().load_to_pool(src)),
        m_ref_key(C3DImageIOPluginHandler::instance().load_to_pool(ref)),
@@ -37,6 +42,15 @@ C3DImageFullCost::C3DImageFullCost(const std::string& src,
        m_debug(debug)
 {
        assert(m_cost_kernel);
+
+       if (sampling != CVoxelSampler::vs_none) {
+              if (!m_cost_kernel->has(property_sampling))
+                     throw create_exception<invalid_argument>("C3DImageFullCost: cost function '",
+                                   m_cost_kernel->get_init_string(),
+                                   "' can not be evaluated on a sub-set of the voxels");
+
+              m_sampler.reset(new CVoxelSampler(sampling, fraction, seed));
+       }
 }
 
 bool C3DImageFullCost::do_has(const char *property) const
@@ -48,7 +62,16 @@ double C3DImageFullCost::do_value(const C3DTransformation& t) const
 {
        TRACE_FUNCTION;
        assert(m_src_scaled  && "Hint: call 'reinit()' before calling value(transform)");
-       P3DImage temp  = t(*m_src_scaled);
+
+       // evaluate on the samples drawn for the last gradient evaluation to obtain comparable values
+       if (m_sampler) {
+              if (m_samples.empty())
+                     draw_samples();
+
+              return evaluate_samples(t, nullptr);
+       }
+
+       P3DImage temp  = transform_data(m_src_key.get_key(), t, *m_src_scaled);
        const double result = m_cost_kernel->value(*temp);
        cvdebug() << "C3DImageFullCost::value = " << result << "\n";
        return result;
@@ -68,7 +91,13 @@ double C3DImageFullCost::do_evaluate(const C3DTransformation& t, CDoubleVector&
 {
        TRACE_FUNCTION;
        assert(m_src_scaled  && "Hint: call 'reinit()' before calling evaluate()");
-       P3DImage temp  = t(*m_src_scaled);
+
+       if (m_sampler) {
+              draw_samples();
+              return evaluate_samples(t, &gradient);
+       }
+
+       P3DImage temp  = transform_data(m_src_key.get_key(), t, *m_src_scaled);
        C3DFVectorfield force(get_current_size());
        m_cost_kernel->evaluate_force(*temp, force);
        t.translate(force, gradient);
@@ -77,6 +106,76 @@ double C3DImageFullCost::do_evaluate(const C3DTransformation& t, CDoubleVector&
        return result;
 }
 
+void C3DImageFullCost::draw_samples() const
+{
+       const C3DBounds& size = get_current_size();
+       m_sampler->draw(vector<size_t> {size.x, size.y, size.z}, m_samples);
+       if (!m_ref_float)
+              m_ref_float = produce_3dimage_filter("convert:repn=float,map=copy")->filter(*m_ref_scaled);
+
+       const C3DFImage& ref = static_cast<const C3DFImage&>(*m_ref_float);
+       m_ref_samples.resize(m_samples.size());
+       transform(m_samples.begin(), m_samples.end(), m_ref_samples.begin(),
+       [&ref](size_t i) {
+              return ref[i];
+       });
+       cvdebug() << "C3DImageFullCost: drew " << m_samples.size() << " samples\n";
+}
+
+/*
+  Only the sampled voxels are transformed. The force is evaluated from the gradient of the
+  study image at the transformed positions, i.e. in the space the transformation's
+  translate expects it, so that the neighbours of the samples don't need to be transformed
+  and the parameter gradient is obtained from the samples alone.
+ */
+double C3DImageFullCost::evaluate_samples(const C3DTransformation& t, CDoubleVector *gradient) const
+{
+       TRACE_FUNCTION;
+       const C3DBounds& size = get_current_size();
+
+       if (!m_src_interpolator) {
+              auto src_float = produce_3dimage_filter("convert:repn=float,map=copy")->filter(*m_src_scaled);
+              const auto& ipf = t.get_interpolator_factory();
+              m_src_interpolator.reset(ipf.create(static_cast<const C3DFImage&>(*src_float).data()));
+              m_src_gradient_interpolator.reset(ipf.create(get_gradient(*src_float)));
+       }
+
+       t.reinit();
+       const size_t n = m_samples.size();
+       const size_t slice_size = size.x * size.y;
+       vector<float> src_samples(n);
+       vector<C3DFVector> src_gradient(gradient ? n : 0);
+       const auto& interp = *m_src_interpolator;
+       const auto& ginterp = *m_src_gradient_interpolator;
+       auto transform_samples = [&](const C1DParallelRange & range) {
+              auto cache = interp.create_cache();
+              auto gcache = ginterp.create_cache();
+
+              for (auto i = range.begin(); i != range.end(); ++i) {
+                     const size_t idx = m_samples[i];
+                     const C3DFVector x(idx % size.x, (idx / size.x) % size.y, idx / slice_size);
+                     const C3DFVector y = t(x);
+                     src_samples[i] = interp(y, cache);
+
+                     if (gradient)
+                            src_gradient[i] = ginterp(y, gcache);
+              }
+       };
+       pfor(C1DParallelRange(0, n, 1024), transform_samples);
+       vector<float> dsrc;
+       const double result = m_cost_kernel->evaluate_samples(src_samples, m_ref_samples, size.product(), dsrc);
+
+       if (gradient) {
+              for (size_t i = 0; i < n; ++i)
+                     src_gradient[i] *= dsrc[i];
+
+              t.translate_sparse(m_samples, src_gradient, *gradient);
+       }
+
+       cvdebug() << "C3DImageFullCost: sampled cost = " << result << "\n";
+       return result;
+}
+
 void C3DImageFullCost::do_set_size()
 {
        TRACE_FUNCTION;
@@ -85,15 +184,14 @@ void C3DImageFullCost::do_set_size()
 
        if (m_src_scaled->get_size() != get_current_size() ||
            m_ref_scaled->get_size() != get_current_size()) {
-              stringstream filter_descr;
-              filter_descr << "scale:s=[" << get_current_size() << "]";
-              auto scaler = C3DFilterPluginHandler::instance().produce(filter_descr.str());
-              assert(scaler);
-              cvdebug() << "C3DImageFullCost:scale images to " << get_current_size() <<
-                        " using '" << filter_descr.str() << "'\n";
-              m_src_scaled = scaler->filter(*m_src);
-              m_ref_scaled = scaler->filter(*m_ref);
+              cvdebug() << "C3DImageFullCost:scale images to " << get_current_size() << "\n";
+              m_src_scaled = m_src_pyramid->get_image(get_current_size());
+              m_ref_scaled = m_ref_pyramid->get_image(get_current_size());
               m_cost_kernel->set_reference(*m_ref_scaled);
+              m_samples.clear();
+              m_src_interpolator.reset();
+              m_src_gradient_interpolator.reset();
+              m_ref_float.reset();
        }
 }
 
@@ -115,6 +213,8 @@ void C3DImageFullCost::do_reinit()
        //cvmsg() << "C3DImageFullCost: read " << m_src_key << " and " << m_ref_key << "\n";
        m_src_scaled = m_src = get_from_pool(m_src_key);
        m_ref_scaled = m_ref = get_from_pool(m_ref_key);
+       m_src_pyramid = C3DImagePyramid::get_shared(m_src);
+       m_ref_pyramid = C3DImagePyramid::get_shared(m_ref);
 
        if (m_src->get_size() != m_ref->get_size())
               throw runtime_error("C3DImageFullCost only works with images of equal size");
@@ -125,6 +225,10 @@ void C3DImageFullCost::do_reinit()
        }
 
        m_cost_kernel->set_reference(*m_ref_scaled);
+       m_samples.clear();
+       m_src_interpolator.reset();
+       m_src_gradient_interpolator.reset();
+       m_ref_float.reset();
 }
 
 P3DImage C3DImageFullCost::get_from_pool(const C3DImageDataKey& key)
@@ -150,18 +254,31 @@ private:
        std::string m_ref_name;
        P3DImageCost m_cost_kernel;
        bool m_debug;
+       CVoxelSampler::EStrategy m_sampling;
+       float m_fraction;
+       unsigned int m_seed;
 };
 
 C3DImageFullCostPlugin::C3DImageFullCostPlugin():
        C3DFullCostPlugin("image"),
        m_src_name("src.@"),
        m_ref_name("ref.@"),
-       m_debug(false)
+       m_debug(false),
+       m_sampling(CVoxelSampler::vs_none),
+       m_fraction(0.1),
+       m_seed(0)
 {
        add_parameter("src", new CStringParameter(m_src_name, CCmdOptionFlags::input, "Study image", &C3DImageIOPluginHandler::instance()));
        add_parameter("ref", new CStringParameter(m_ref_name, CCmdOptionFlags::input, "Reference image", &C3DImageIOPluginHandler::instance()));
        add_parameter("cost", make_param(m_cost_kernel, "ssd", false, "Cost function kernel"));
        add_parameter("debug", new CBoolParameter(m_debug, false, "Save intermediate resuts for debugging"));
+       add_parameter("sampling", new CDictParameter<CVoxelSampler::EStrategy>(m_sampling, g_voxel_sampling_dict,
+                     "Estimate the cost function and its gradient from a sub-set of the voxels that is drawn "
+                     "a new for each gradient evaluation. Only the sampled voxels of the study image are "
+                     "transformed. This requires a cost function kernel that supports sampling."));
+       add_parameter("fraction", make_oci_param(m_fraction, 0.0, 1.0, false,
+                     "Fraction of the voxels that are used when sampling is enabled"));
+       add_parameter("seed", make_param(m_seed, false, "Seed of the random number generator used for sampling"));
 }
 
 C3DFullCost *C3DImageFullCostPlugin::do_create(float weight) const
@@ -169,7 +286,8 @@ C3DFullCost *C3DImageFullCostPlugin::do_create(float weight) const
        cvdebug() << "create C3DImageFullCostPlugin with weight= " << weight
                  << " src=" << m_src_name << " ref=" << m_ref_name
                  << " cost=" << m_cost_kernel << "\n";
-       return new C3DImageFullCost(m_src_name, m_ref_name, m_cost_kernel, weight, m_debug);
+       return new C3DImageFullCost(m_src_name, m_ref_name, m_cost_kernel, weight, m_debug,
+                                   m_sampling, m_fraction, m_seed);
 }
 
 const std::string C3DImageFullCostPlugin::do_get_descr() const
@@ -25,23 +25,44 @@
 #include <mia/3d/fullcost.hh>
 #include <mia/3d/imageio.hh>
 #include <mia/3d/cost.hh>
+#include <mia/3d/imagepyramid.hh>
+#include <mia/3d/interpolator.hh>
+#include <mia/core/voxelsampler.hh>
 
 NS_MIA_BEGIN
 
 class EXPORT C3DImageFullCost : public C3DFullCost
 {
 public:
+       /**
+          \param src study image
+          \param ref reference image
+          \param cost the image similarity measure
+          \param weight weight of the cost function
+          \param debug save intermediate results
+          \param sampling if not vs_none, the cost function and its gradient are estimated from
+          a sub-set of the voxels that is drawn a new for each evaluation of the gradient, and
+          only the sampled voxels of the study image are transformed
+          \param fraction fraction of the voxels that is used when sampling is enabled
+          \param seed seed for the random number generator used for sampling
+        */
        C3DImageFullCost(const std::string& src,
                         const std::string& ref,
                         P3DImageCost cost,
                         double weight,
-                        bool debug);
+                        bool debug,
+                        CVoxelSampler::EStrategy sampling = CVoxelSampler::vs_none,
+                        double fraction = 0.1,
+                        unsigned seed = 0);
 private:
        double do_evaluate(const C3DTransformation& t, CDoubleVector& gradient) const;
        void do_set_size();
 
        static P3DImage get_from_pool(const C3DImageDataKey& key);
 
+       void draw_samples() const;
+       double evaluate_samples(const C3DTransformation& t, CDoubleVector *gradient) const;
+
        bool do_has(const char *property) const;
        double do_value(const C3DTransformation& t) const;
 
@@ -55,12 +76,22 @@ private:
        P3DImage m_src;
        P3DImage m_ref;
 
+       P3DImagePyramid m_src_pyramid;
+       P3DImagePyramid m_ref_pyramid;
+
        P3DImage m_src_scaled;
        P3DImage m_ref_scaled;
 
 
        P3DImageCost m_cost_kernel;
        bool m_debug;
+
+       std::unique_ptr<CVoxelSampler> m_sampler;
+       mutable std::vector<size_t> m_samples;
+       mutable std::vector<float> m_ref_samples;
+       mutable P3DImage m_ref_float;
+       mutable std::unique_ptr<T3DConvoluteInterpolator<float>> m_src_interpolator;
+       mutable std::unique_ptr<T3DConvoluteInterpolator<C3DFVector>> m_src_gradient_interpolator;
 };
 
 NS_MIA_END
@@ -25,6 +25,7 @@
 #include <mia/3d/fullcost.hh>
 #include <mia/3d/imageio.hh>
 #include <mia/3d/maskedcost.hh>
+#include <mia/3d/imagepyramid.hh>
 #include <mia/3d/filter.hh>
 
 NS_MIA_BEGIN
@@ -65,6 +66,8 @@ private:
        P3DImage m_ref;
        P3DImage m_src_mask;
        P3DImage m_ref_mask;
+       P3DImagePyramid m_src_pyramid;
+       P3DImagePyramid m_ref_pyramid;
 
        P3DImage m_src_scaled;
        P3DImage m_ref_scaled;
@@ -22,6 +22,7 @@
 #include <mia/3d/transformmock.hh>
 #include <mia/3d/imageio.hh>
 #include <mia/3d/filter.hh>
+#include <mia/3d/transformfactory.hh>
 
 #include <mia/internal/autotest.hh>
 
@@ -85,6 +86,144 @@ BOOST_FIXTURE_TEST_CASE( test_imagefullcost_2,  ImagefullcostFixture)
        BOOST_CHECK_CLOSE(gradient[113], 255 * 255 * 0.5f, 0.1);
 }
 
+/*
+  The non-rigid registration builds the pyramids of the images it stored in the pool
+  before the cost functions are initialized, and the costs must pick up these pyramids
+  instead of creating their own.
+*/
+BOOST_AUTO_TEST_CASE( test_imagefullcost_shares_pyramid_with_registration )
+{
+       C3DBounds size(16, 16, 16);
+       P3DImage src(new C3DFImage(size));
+       P3DImage ref(new C3DFImage(size));
+       BOOST_REQUIRE(save_image("src.@", src));
+       BOOST_REQUIRE(save_image("ref.@", ref));
+       auto src_pyramid = C3DImagePyramid::get_shared(load_image<P3DImage>("src.@"), 3);
+       auto ref_pyramid = C3DImagePyramid::get_shared(load_image<P3DImage>("ref.@"), 3);
+       BOOST_CHECK_EQUAL(src_pyramid->get_levels(), 3u);
+       const long src_users = src_pyramid.use_count();
+       const long ref_users = ref_pyramid.use_count();
+       C3DImageFullCost cost("src.@", "ref.@", C3DImageCostPluginHandler::instance().produce("ssd"), 1.0, false);
+       cost.reinit();
+       BOOST_CHECK_EQUAL(src_pyramid.use_count(), src_users + 1);
+       BOOST_CHECK_EQUAL(ref_pyramid.use_count(), ref_users + 1);
+       // the coarse levels are taken from the shared pyramid
+       cost.set_size(C3DBounds(4, 4, 4));
+       BOOST_CHECK_EQUAL(src_pyramid->get_levels(), 3u);
+}
+
+static P3DImage create_blob(const C3DBounds& size, const C3DFVector& center)
+{
+       C3DFImage *image = new C3DFImage(size);
+       auto i = image->begin();
+
+       for (unsigned z = 0; z < size.z; ++z)
+              for (unsigned y = 0; y < size.y; ++y)
+                     for (unsigned x = 0; x < size.x; ++x, ++i) {
+                            const C3DFVector d = C3DFVector(x, y, z) - center;
+                            *i = 100.0f * exp(-d.norm2() / 32.0f);
+                     }
+
+       return P3DImage(image);
+}
+
+struct SampledImagefullcostFixture {
+       SampledImagefullcostFixture();
+
+       C3DBounds size;
+       P3DTransformation t;
+};
+
+SampledImagefullcostFixture::SampledImagefullcostFixture():
+       size(12, 13, 14)
+{
+       BOOST_REQUIRE(save_image("src.@", create_blob(size, C3DFVector(5.5, 6, 7.5))));
+       BOOST_REQUIRE(save_image("ref.@", create_blob(size, C3DFVector(6, 6.5, 6.5))));
+       t = C3DTransformCreatorHandler::instance().produce("affine")->create(size);
+       auto params = t->get_parameters();
+       const double delta[12] = {0.02, -0.01, 0.03, 0.4, 0.01, -0.02, 0.01, -0.3, -0.03, 0.02, 0.01, 0.2};
+
+       for (int i = 0; i < 12; ++i)
+              params[i] += delta[i];
+
+       t->set_parameters(params);
+}
+
+BOOST_FIXTURE_TEST_CASE( test_imagefullcost_sampled_all_voxels, SampledImagefullcostFixture )
+{
+       /* sampling all voxels must give the same result like the full evaluation. For the
+          gradient this only holds for a pure translation, because the sampled evaluation
+          uses the gradient of the study image at the transformed positions */
+       auto t = C3DTransformCreatorHandler::instance().produce("translate")->create(size);
+       auto params = t->get_parameters();
+       params[0] = 0.4;
+       params[1] = -0.3;
+       params[2] = 0.2;
+       t->set_parameters(params);
+       C3DImageFullCost cost("src.@", "ref.@", C3DImageCostPluginHandler::instance().produce("ssd"), 1.0, false);
+       C3DImageFullCost sampled_cost("src.@", "ref.@", C3DImageCostPluginHandler::instance().produce("ssd"),
+                                     1.0, false, CVoxelSampler::vs_random, 1.0, 1);
+       cost.reinit();
+       cost.set_size(size);
+       sampled_cost.reinit();
+       sampled_cost.set_size(size);
+       CDoubleVector gradient(t->degrees_of_freedom());
+       CDoubleVector sampled_gradient(t->degrees_of_freedom());
+       const double value = cost.evaluate(*t, gradient);
+       const double sampled_value = sampled_cost.evaluate(*t, sampled_gradient);
+       BOOST_CHECK_CLOSE(sampled_value, value, 0.01);
+       BOOST_CHECK_CLOSE(sampled_cost.cost_value(*t), value, 0.01);
+
+       // the gradients only differ at the boundary, where the full evaluation sets it to zero
+       double norm = 0.0;
+
+       for (size_t i = 0; i < gradient.size(); ++i)
+              norm += gradient[i] * gradient[i];
+
+       for (size_t i = 0; i < gradient.size(); ++i)
+              BOOST_CHECK_SMALL(sampled_gradient[i] - gradient[i], 0.05 * sqrt(norm));
+}
+
+BOOST_FIXTURE_TEST_CASE( test_imagefullcost_stratified, SampledImagefullcostFixture )
+{
+       C3DImageFullCost cost("src.@", "ref.@", C3DImageCostPluginHandler::instance().produce("ssd"), 1.0, false);
+       C3DImageFullCost sampled_cost("src.@", "ref.@", C3DImageCostPluginHandler::instance().produce("ssd"),
+                                     1.0, false, CVoxelSampler::vs_stratified, 0.125, 1);
+       cost.reinit();
+       cost.set_size(size);
+       sampled_cost.reinit();
+       sampled_cost.set_size(size);
+       CDoubleVector gradient(t->degrees_of_freedom());
+       CDoubleVector sampled_gradient(t->degrees_of_freedom());
+       const double value = cost.evaluate(*t, gradient);
+       const double sampled_value = sampled_cost.evaluate(*t, sampled_gradient);
+       // the estimate is scaled to the full image
+       BOOST_CHECK_CLOSE(sampled_value, value, 20);
+       // value() uses the samples of the last gradient evaluation
+       BOOST_CHECK_EQUAL(sampled_cost.cost_value(*t), sampled_value);
+       // the translation part of the gradient points into the same direction
+       double dot = 0.0;
+       double norm = 0.0;
+       double sampled_norm = 0.0;
+
+       for (size_t i = 3; i < 12; i += 4) {
+              dot += gradient[i] * sampled_gradient[i];
+              norm += gradient[i] * gradient[i];
+              sampled_norm += sampled_gradient[i] * sampled_gradient[i];
+       }
+
+       BOOST_CHECK(dot > 0.9 * sqrt(norm * sampled_norm));
+       // a new set of voxels is drawn for each gradient evaluation
+       sampled_cost.evaluate(*t, sampled_gradient);
+       BOOST_CHECK(sampled_cost.cost_value(*t) != sampled_value);
+}
+
+BOOST_AUTO_TEST_CASE( test_imagefullcost_sampling_unsupported )
+{
+       BOOST_CHECK_THROW(C3DImageFullCost("src.@", "ref.@", C3DImageCostPluginHandler::instance().produce("ngf"),
+                                          1.0, false, CVoxelSampler::vs_random, 0.1, 1), std::invalid_argument);
+}
+
 ImagefullcostFixture::ImagefullcostFixture()
 {
 }
@@ -74,6 +74,24 @@ bool  EXPORT_3D save_image(const std::string& filename, C3DImage& image)
        return save_image(filename, P3DImage(&image, void_destructor<C3DImage>()));
 }
 
+C3DImageSliceReader::~C3DImageSliceReader()
+{
+}
+
+C3DImageSliceWriter::~C3DImageSliceWriter()
+{
+}
+
+C3DImageSliceIO::~C3DImageSliceIO()
+{
+}
+
+EXPORT_3D const C3DImageSliceIO *get_image3d_slice_io(const std::string& filename)
+{
+       auto plugin = C3DImageIOPluginHandler::instance().preferred_plugin_ptr(filename);
+       return dynamic_cast<const C3DImageSliceIO *>(plugin);
+}
+
 template class TPlugin<io_3dimage_data, io_plugin_type>;
 template class TIOPlugin<io_3dimage_data>;
 template class THandlerSingleton<TIOPluginHandler<C3DImageIOPlugin>>;
@@ -21,6 +21,7 @@
 #ifndef mia_3d_3dimageui_hh
 #define mia_3d_3dimageui_hh
 
+#include <memory>
 #include <set>
 #include <vector>
 #include <mia/core/ioplugin.hh>
@@ -68,6 +69,91 @@ struct IOHandler_of<C3DImage> {
 };
 
 
+/**
+   @ingroup io
+   @brief Sequential read access to the slices of a 3D image file
+
+   The slices are read in increasing z-order, so that a volume can be processed
+   without holding it in memory completely.
+*/
+class EXPORT_3D C3DImageSliceReader
+{
+public:
+       virtual ~C3DImageSliceReader();
+
+       /// @returns the size of the image stored in the file
+       virtual C3DBounds get_size() const = 0;
+
+       /**
+          Read the next slices of the image
+          @param n number of slices to read
+          @returns an image of size (size.x, size.y, n) with the voxel size, orientation, and
+          attributes of the image in the file
+          @throws std::runtime_error if the slices can not be read
+        */
+       virtual P3DImage read_slices(unsigned n) = 0;
+};
+
+/**
+   @ingroup io
+   @brief Sequential write access to the slices of a 3D image file
+*/
+class EXPORT_3D C3DImageSliceWriter
+{
+public:
+       virtual ~C3DImageSliceWriter();
+
+       /**
+          Append slices to the image
+          @param slices image holding the next slices, it must have the pixel type and
+          the in-plane size the writer was created with
+        */
+       virtual void write_slices(const C3DImage& slices) = 0;
+
+       /// Finish writing the image, must be called after all slices were written
+       virtual void close() = 0;
+};
+
+/**
+   @ingroup io
+   @brief Interface of the 3D image IO plug-ins that can read and write single images slice-wise
+
+   An IO plug-in derives from this class in addition to C3DImageIOPlugin if its file format
+   stores the slices of an image one after another.
+*/
+class EXPORT_3D C3DImageSliceIO
+{
+public:
+       virtual ~C3DImageSliceIO();
+
+       /**
+          Open a file for reading its slices
+          @param filename
+          @returns the reader, or an empty pointer if the file doesn't contain exactly one image
+          in the format of the plug-in
+        */
+       virtual std::unique_ptr<C3DImageSliceReader> open_slice_reader(const std::string& filename) const = 0;
+
+       /**
+          Create a file for writing an image slice by slice
+          @param filename
+          @param size the size of the complete image
+          @param prototype an image that provides pixel type, voxel size, orientation and
+          attributes of the output
+          @returns the writer
+          @throws std::invalid_argument if the pixel type is not supported
+        */
+       virtual std::unique_ptr<C3DImageSliceWriter> open_slice_writer(const std::string& filename,
+                     const C3DBounds& size, const C3DImage& prototype) const = 0;
+};
+
+/**
+   @ingroup io
+   @returns the slice IO interface of the plug-in that handles the given file name, or
+   nullptr if there is no such plug-in or if it can not read and write slice-wise
+*/
+EXPORT_3D const C3DImageSliceIO *get_image3d_slice_io(const std::string& filename);
+
 /**
    @ingroup io
    @brief Data key type used to load and store to the CDatapool
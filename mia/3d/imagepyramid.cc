@@ -0,0 +1,39 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <mia/3d/imagepyramid.hh>
+#include <mia/template/imagepyramid.cxx>
+
+NS_MIA_BEGIN
+
+template <>
+void pyramid_pixel_size<3>::apply(C3DImage& level, const C3DImage& parent)
+{
+       const C3DBounds& in_size = parent.get_size();
+       const C3DBounds& out_size = level.get_size();
+       C3DFVector factor(float(in_size.x) / out_size.x,
+                         float(in_size.y) / out_size.y,
+                         float(in_size.z) / out_size.z);
+       level.set_voxel_size(parent.get_voxel_size() * factor);
+}
+
+template class TImagePyramid<3>;
+
+NS_MIA_END
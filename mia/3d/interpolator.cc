@@ -26,10 +26,14 @@
 #ifdef __SSE3__
 #include <pmmintrin.h>
 #endif
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 
 #include <mia/core/interpolator1d.hh>
 #include <mia/3d/interpolator.hh>
+#include <mia/core/hwcap.hh>
 
 #include <mia/core/interpolator1d.cxx>
 #include <mia/3d/interpolator.cxx>
@@ -434,6 +438,205 @@ float add_3d<T3DDatafield< float >, 4>::value(const T3DDatafield< float >&  coef
 
 #endif
 
+#ifdef __SSE2__
+bool add_3d_avx2<T3DDatafield< double >, 4>::is_supported()
+{
+       static const bool supported = cpu_has_avx2();
+       return supported;
+}
+
+/*
+  AVX2 version of add_3d<T3DDatafield< double >, 4>, one x-row of the support fits
+  into one register.
+*/
+__attribute__((target("avx2")))
+double add_3d_avx2<T3DDatafield< double >, 4>::value(const T3DDatafield< double >&  coeff,
+              const C3DWeightCache& wicache)
+{
+       const int dx = coeff.get_size().x;
+       const int dxy = coeff.get_size().x * coeff.get_size().y;
+       __m256d rows[16];
+
+       for (int z = 0, idx = 0; z < 4; ++z) {
+              const double *slice = &coeff[wicache.z.index[z] * dxy];
+
+              for (int y = 0; y < 4; ++y, ++idx) {
+                     const double *p = &slice[wicache.y.index[y] * dx];
+
+                     if (wicache.x.is_flat)
+                            rows[idx] = _mm256_loadu_pd(&p[wicache.x.start_idx]);
+                     else
+                            rows[idx] = _mm256_set_pd(p[wicache.x.index[3]], p[wicache.x.index[2]],
+                                                      p[wicache.x.index[1]], p[wicache.x.index[0]]);
+              }
+       }
+
+       __m256d target1[4];
+       __m256d wz = _mm256_set1_pd(wicache.z.weights[0]);
+
+       for (int y = 0; y < 4; ++y)
+              target1[y] = _mm256_mul_pd(rows[y], wz);
+
+       for (int z = 1; z < 4; ++z) {
+              wz = _mm256_set1_pd(wicache.z.weights[z]);
+
+              for (int y = 0; y < 4; ++y)
+                     target1[y] = _mm256_add_pd(target1[y], _mm256_mul_pd(rows[4 * z + y], wz));
+       }
+
+       __m256d target2 = _mm256_mul_pd(_mm256_set1_pd(wicache.y.weights[0]), target1[0]);
+
+       for (int y = 1; y < 4; ++y)
+              target2 = _mm256_add_pd(target2, _mm256_mul_pd(_mm256_set1_pd(wicache.y.weights[y]), target1[y]));
+
+       target2 = _mm256_mul_pd(target2, _mm256_loadu_pd(&wicache.x.weights[0]));
+       __m128d sum = _mm_add_pd(_mm256_castpd256_pd128(target2), _mm256_extractf128_pd(target2, 1));
+       const double result = _mm_cvtsd_f64(_mm_hadd_pd(sum, sum));
+       // avoid the AVX-SSE transition penalty in the calling code
+       _mm256_zeroupper();
+       return result;
+}
+
+bool add_3d_avx512<T3DDatafield< double >, 4>::is_supported()
+{
+       static const bool supported = cpu_has_avx512f();
+       return supported;
+}
+
+/*
+  AVX-512 version of add_3d<T3DDatafield< double >, 4>, two x-rows of the support,
+  i.e. y-index pairs (0,1) and (2,3), are processed in one register.
+*/
+__attribute__((target("avx512f")))
+double add_3d_avx512<T3DDatafield< double >, 4>::value(const T3DDatafield< double >&  coeff,
+              const C3DWeightCache& wicache)
+{
+       const int dx = coeff.get_size().x;
+       const int dxy = coeff.get_size().x * coeff.get_size().y;
+       __m512d rows[8];
+
+       for (int z = 0, idx = 0; z < 4; ++z) {
+              const double *slice = &coeff[wicache.z.index[z] * dxy];
+
+              for (int y = 0; y < 4; y += 2, ++idx) {
+                     const double *p0 = &slice[wicache.y.index[y] * dx];
+                     const double *p1 = &slice[wicache.y.index[y + 1] * dx];
+
+                     if (wicache.x.is_flat) {
+                            rows[idx] = _mm512_insertf64x4(_mm512_castpd256_pd512(_mm256_loadu_pd(&p0[wicache.x.start_idx])),
+                                                           _mm256_loadu_pd(&p1[wicache.x.start_idx]), 1);
+                     } else {
+                            const auto& xi = wicache.x.index;
+                            rows[idx] = _mm512_set_pd(p1[xi[3]], p1[xi[2]], p1[xi[1]], p1[xi[0]],
+                                                      p0[xi[3]], p0[xi[2]], p0[xi[1]], p0[xi[0]]);
+                     }
+              }
+       }
+
+       __m512d wz = _mm512_set1_pd(wicache.z.weights[0]);
+       __m512d target1_01 = _mm512_mul_pd(rows[0], wz);
+       __m512d target1_23 = _mm512_mul_pd(rows[1], wz);
+
+       for (int z = 1; z < 4; ++z) {
+              wz = _mm512_set1_pd(wicache.z.weights[z]);
+              target1_01 = _mm512_add_pd(target1_01, _mm512_mul_pd(rows[2 * z], wz));
+              target1_23 = _mm512_add_pd(target1_23, _mm512_mul_pd(rows[2 * z + 1], wz));
+       }
+
+       const __m512d wy01 = _mm512_insertf64x4(_mm512_castpd256_pd512(_mm256_set1_pd(wicache.y.weights[0])),
+                                               _mm256_set1_pd(wicache.y.weights[1]), 1);
+       const __m512d wy23 = _mm512_insertf64x4(_mm512_castpd256_pd512(_mm256_set1_pd(wicache.y.weights[2])),
+                                               _mm256_set1_pd(wicache.y.weights[3]), 1);
+       target1_01 = _mm512_mul_pd(target1_01, wy01);
+       target1_23 = _mm512_mul_pd(target1_23, wy23);
+       // sum up in the same order like the AVX2 and SSE2 versions
+       __m256d target2 = _mm256_add_pd(_mm512_castpd512_pd256(target1_01), _mm512_extractf64x4_pd(target1_01, 1));
+       target2 = _mm256_add_pd(target2, _mm512_castpd512_pd256(target1_23));
+       target2 = _mm256_add_pd(target2, _mm512_extractf64x4_pd(target1_23, 1));
+       target2 = _mm256_mul_pd(target2, _mm256_loadu_pd(&wicache.x.weights[0]));
+       __m128d sum = _mm_add_pd(_mm256_castpd256_pd128(target2), _mm256_extractf128_pd(target2, 1));
+       const double result = _mm_cvtsd_f64(_mm_hadd_pd(sum, sum));
+       // avoid the AVX-SSE transition penalty in the calling code
+       _mm256_zeroupper();
+       return result;
+}
+#endif
+
+#ifdef __SSE__
+bool add_3d_avx2<T3DDatafield< float >, 4>::is_supported()
+{
+       static const bool supported = cpu_has_avx2();
+       return supported;
+}
+
+/*
+  AVX2 version of add_3d<T3DDatafield< float >, 4>, two x-rows of the support,
+  i.e. y-index pairs (0,1) and (2,3), are processed in one register.
+*/
+__attribute__((target("avx2")))
+float add_3d_avx2<T3DDatafield< float >, 4>::value(const T3DDatafield< float >&  coeff,
+              const C3DWeightCache& wicache)
+{
+       const int dx = coeff.get_size().x;
+       const int dxy = coeff.get_size().x * coeff.get_size().y;
+       __m256 rows[8];
+
+       for (int z = 0, idx = 0; z < 4; ++z) {
+              const float *slice = &coeff[wicache.z.index[z] * dxy];
+
+              for (int y = 0; y < 4; y += 2, ++idx) {
+                     const float *p0 = &slice[wicache.y.index[y] * dx];
+                     const float *p1 = &slice[wicache.y.index[y + 1] * dx];
+
+                     if (wicache.x.is_flat) {
+                            rows[idx] = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&p0[wicache.x.start_idx])),
+                                                             _mm_loadu_ps(&p1[wicache.x.start_idx]), 1);
+                     } else {
+                            const auto& xi = wicache.x.index;
+                            rows[idx] = _mm256_set_ps(p1[xi[3]], p1[xi[2]], p1[xi[1]], p1[xi[0]],
+                                                      p0[xi[3]], p0[xi[2]], p0[xi[1]], p0[xi[0]]);
+                     }
+              }
+       }
+
+       __m256 wz = _mm256_set1_ps(wicache.z.weights[0]);
+       __m256 target1_01 = _mm256_mul_ps(rows[0], wz);
+       __m256 target1_23 = _mm256_mul_ps(rows[1], wz);
+
+       for (int z = 1; z < 4; ++z) {
+              wz = _mm256_set1_ps(wicache.z.weights[z]);
+              target1_01 = _mm256_add_ps(target1_01, _mm256_mul_ps(rows[2 * z], wz));
+              target1_23 = _mm256_add_ps(target1_23, _mm256_mul_ps(rows[2 * z + 1], wz));
+       }
+
+       const __m256 wy01 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(wicache.y.weights[0])),
+                                                _mm_set1_ps(wicache.y.weights[1]), 1);
+       const __m256 wy23 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(wicache.y.weights[2])),
+                                                _mm_set1_ps(wicache.y.weights[3]), 1);
+       target1_01 = _mm256_mul_ps(target1_01, wy01);
+       target1_23 = _mm256_mul_ps(target1_23, wy23);
+       __m128 target2 = _mm_add_ps(_mm256_castps256_ps128(target1_01), _mm256_extractf128_ps(target1_01, 1));
+       target2 = _mm_add_ps(target2, _mm256_castps256_ps128(target1_23));
+       target2 = _mm_add_ps(target2, _mm256_extractf128_ps(target1_23, 1));
+       const __m128 wx = _mm_set_ps(wicache.x.weights[3], wicache.x.weights[2],
+                                    wicache.x.weights[1], wicache.x.weights[0]);
+       target2 = _mm_mul_ps(target2, wx);
+       // sum up in the same order like the SSE version
+#ifdef __SSE3__
+       target2 = _mm_hadd_ps(target2, target2);
+       target2 = _mm_hadd_ps(target2, target2);
+       const float result = _mm_cvtss_f32(target2);
+#else
+       float __attribute__((aligned(16))) r[4];
+       _mm_store_ps(r, target2);
+       const float result = r[0] + r[1] + r[2] + r[3];
+#endif
+       // avoid the AVX-SSE transition penalty in the calling code
+       _mm256_zeroupper();
+       return result;
+}
+#endif
+
 #define INSTANCIATE_INTERPOLATORS(TYPE)			\
 	template class EXPORT_3D T3DInterpolator<TYPE>;		\
 	template class EXPORT_3D T3DConvoluteInterpolator<TYPE>
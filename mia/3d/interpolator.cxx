@@ -247,6 +247,82 @@ struct add_3d<T3DDatafield< float >, 2> {
 
 #endif
 
+/*
+  Variants of add_3d that are compiled for AVX2 and AVX-512 respectively and are selected
+  at run-time. They evaluate exactly the same operations in the same order like the 
+  SSE versions above and, hence, give the same results. 
+*/
+template <class C, int size>
+struct add_3d_avx2: public add_3d<C, size> {
+	static bool is_supported() {
+		return false; 
+	}
+};
+
+template <class C, int size>
+struct add_3d_avx512: public add_3d<C, size> {
+	static bool is_supported() {
+		return false; 
+	}
+};
+
+#ifdef __SSE2__
+template <>
+struct add_3d_avx2<T3DDatafield< double >, 4> {
+	static bool is_supported(); 
+	static double value(const T3DDatafield< double >&  coeff, const C3DWeightCache& cache); 
+};
+
+template <>
+struct add_3d_avx512<T3DDatafield< double >, 4> {
+	static bool is_supported(); 
+	static double value(const T3DDatafield< double >&  coeff, const C3DWeightCache& cache); 
+};
+#endif
+
+#ifdef __SSE__
+template <>
+struct add_3d_avx2<T3DDatafield< float >, 4> {
+	static bool is_supported(); 
+	static float value(const T3DDatafield< float >&  coeff, const C3DWeightCache& cache); 
+};
+#endif
+
+template <class Add, class C, typename T, typename V>
+void interpolate_batch(const CSplineKernel& kernel, const C& coeff, 
+		       const std::vector<C3DFVector>& x, std::vector<T>& result, 
+		       C3DWeightCache& cache, const V& min, const V& max)
+{
+	typedef typename C::value_type U; 
+	auto ir = result.begin(); 
+	for (auto ix = x.begin(); ix != x.end(); ++ix, ++ir) {
+		kernel.get_uncached(ix->x, cache.x);
+		
+		if (ix->y != cache.y.x) 
+			kernel.get_cached(ix->y, cache.y);
+		
+		if (ix->z != cache.z.x) 
+			kernel.get_cached(ix->z, cache.z);
+		
+		U r = Add::value(coeff, cache); 
+		bounded<U, T>::apply(r, min, max);
+		*ir = round_to<U, T>::value(r); 
+	}
+}
+
+template <class C, int size, typename T, typename V>
+void interpolate_batch_dispatch(const CSplineKernel& kernel, const C& coeff, 
+				const std::vector<C3DFVector>& x, std::vector<T>& result, 
+				C3DWeightCache& cache, const V& min, const V& max)
+{
+	if (add_3d_avx512<C, size>::is_supported()) 
+		interpolate_batch<add_3d_avx512<C, size>>(kernel, coeff, x, result, cache, min, max); 
+	else if (add_3d_avx2<C, size>::is_supported()) 
+		interpolate_batch<add_3d_avx2<C, size>>(kernel, coeff, x, result, cache, min, max); 
+	else 
+		interpolate_batch<add_3d<C, size>>(kernel, coeff, x, result, cache, min, max); 
+}
+
 template <typename T>
 T  T3DConvoluteInterpolator<T>::operator () (const C3DFVector& x, C3DWeightCache& cache) const
 {
@@ -326,6 +402,26 @@ T  T3DConvoluteInterpolator<T>::operator () (const C3DFVector& x) const
 	return round_to<U, T>::value(result); 
 }
 
+template <typename T>
+void T3DConvoluteInterpolator<T>::operator () (const std::vector<C3DFVector>& x, std::vector<T>& result, 
+					       C3DWeightCache& cache) const
+{
+	assert(x.size() == result.size()); 
+	const CSplineKernel& kernel = *m_kernel; 
+	
+	switch (kernel.size()) {
+	case 1: interpolate_batch_dispatch<TCoeff3D,1>(kernel, m_coeff, x, result, cache, m_min, m_max); break; 
+	case 2: interpolate_batch_dispatch<TCoeff3D,2>(kernel, m_coeff, x, result, cache, m_min, m_max); break; 
+	case 3: interpolate_batch_dispatch<TCoeff3D,3>(kernel, m_coeff, x, result, cache, m_min, m_max); break; 
+	case 4: interpolate_batch_dispatch<TCoeff3D,4>(kernel, m_coeff, x, result, cache, m_min, m_max); break; 
+	case 5: interpolate_batch_dispatch<TCoeff3D,5>(kernel, m_coeff, x, result, cache, m_min, m_max); break; 
+	case 6: interpolate_batch_dispatch<TCoeff3D,6>(kernel, m_coeff, x, result, cache, m_min, m_max); break; 
+	default: {
+		assert(0 && "kernel sizes above 5 are not implemented"); 
+	}
+	} // end switch 
+}
+
 NS_MIA_END
 
 
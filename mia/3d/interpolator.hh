@@ -134,6 +134,20 @@ public:
        */
        T  operator () (const C3DFVector& x) const;
 
+       /**
+          get the interpolated values at a series of locations, e.g. all locations that
+          correspond to an x-row of an output image. The kernel size is only dispatched
+          once for the whole series and, depending on the CPU, AVX2 or AVX-512 code paths
+          are used. The results are the same like when calling the point-wise operator
+          for each location in order.
+          \param x the locations
+          \param[out] result the interpolated values, must have the same size like \a x
+          \param cache the cache structure created by calling create_cache()
+          \remark This method is thread save if the cache structure is thread local
+       */
+       void operator () (const std::vector<C3DFVector>& x, std::vector<T>& result,
+                         C3DWeightCache& cache) const;
+
 
        /// \returns the coefficients
        const TCoeff3D& get_coefficients() const
@@ -158,8 +158,7 @@ extern "C" EXPORT CPluginBase *get_plugin_interface()
 
 CAnalyze3DImageIOPlugin::CAnalyze3DImageIOPlugin():
        C3DImageIOPlugin("analyze"),
-       m_type_table(analyze_type_table),
-       m_swap_endian(false)
+       m_type_table(analyze_type_table)
 {
 //	add_supported_type(it_bit);
        add_supported_type(it_ubyte);
@@ -306,27 +305,27 @@ struct do_read_image {
 };
 
 
-C3DImage *CAnalyze3DImageIOPlugin::read_image(const C3DBounds& size, short datatype, CInputFile& data_file) const
+static C3DImage *read_image(const C3DBounds& size, short datatype, CInputFile& data_file, bool swap_endian)
 {
        if (datatype & 128)
               cvwarn() << "Got an RGB indicator but I will ignore it\n";
 
        switch (datatype & 0xFF) {
-//	case DTA_BINARY       :return do_read_image<bool>::apply(size, data_file, m_swap_endian);
+//	case DTA_BINARY       :return do_read_image<bool>::apply(size, data_file, swap_endian);
        case DTA_UNSIGNED_CHAR:
-              return do_read_image<unsigned char>::apply(size, data_file, m_swap_endian);
+              return do_read_image<unsigned char>::apply(size, data_file, swap_endian);
 
        case DTA_SIGNED_SHORT :
-              return do_read_image<signed short>::apply(size, data_file, m_swap_endian);
+              return do_read_image<signed short>::apply(size, data_file, swap_endian);
 
        case DTA_SIGNED_INT   :
-              return do_read_image<signed int>::apply(size, data_file, m_swap_endian);
+              return do_read_image<signed int>::apply(size, data_file, swap_endian);
 
        case DTA_FLOAT        :
-              return do_read_image<float>::apply(size, data_file, m_swap_endian);
+              return do_read_image<float>::apply(size, data_file, swap_endian);
 
        case DTA_DOUBLE       :
-              return do_read_image<double>::apply(size, data_file, m_swap_endian);
+              return do_read_image<double>::apply(size, data_file, swap_endian);
 
        default:
               stringstream msg;
@@ -369,55 +368,112 @@ void set_typeinfo(analyze_image_dimension& dime, EPixelType pixel_type)
        }
 }
 
-CAnalyze3DImageIOPlugin::PData CAnalyze3DImageIOPlugin::do_load(const string&  filename) const
+bool CAnalyze3DImageIOPlugin::read_header(const string& filename, analyze_dsr& hdr, bool& swap_endian) const
 {
        CInputFile f(filename);
 
        if (!f) {
               cvdebug() << filename << ":" << strerror(errno) << "\n";
-              return PData();
+              return false;
        }
 
-       analyze_dsr hdr;
-
        if (fread(&hdr, 1, sizeof(analyze_dsr), f) != sizeof(analyze_dsr)) {
               cvdebug() << filename.c_str() << ":" << "unable to read analyze header\n";
-              return PData();
+              return false;
        }
 
        if (hdr.dime.dim[0] < 0 || hdr.dime.dim[0] > 15) {
               swap_hdr(hdr);
-              m_swap_endian = true;
+              swap_endian = true;
        } else
-              m_swap_endian = false;
+              swap_endian = false;
 
        if (hdr.dime.dim[0] < 0 || hdr.dime.dim[0] > 15) {
               cvdebug() << filename.c_str() << ":" << "not an analyze  header\n";
-              return PData();
+              return false;
        }
 
        if ((unsigned int)hdr.hk.sizeof_hdr < sizeof(hdr)) {
               cvdebug() << filename.c_str() << ":" << "not an analyze  header\n";
-              return PData();
+              return false;
        }
 
        if (hdr.dime.dim[0] < 3) {
               cvdebug() << filename.c_str() << ":" << "not a supported analyze  header\n";
-              return PData();
+              return false;
        }
 
+       return true;
+}
+
+static E3DImageOrientation get_orientation(char orient)
+{
+       switch (orient) {
+       case ao_transverse_unflipped:
+              return ior_axial;
+
+       case ao_transverse_flipped:
+              return ior_axial_flipped;
+
+       case ao_coronal_unflipped:
+              return ior_coronal;
+
+       case ao_coronal_flipped:
+              return ior_coronal_flipped;
+
+       case ao_saggital_unflipped:
+              return ior_saggital;
+
+       case ao_saggital_flipped:
+              return ior_saggital_flipped;
+
+       default:
+              return ior_unknown;
+       }
+}
+
+static size_t get_number_of_images(const analyze_dsr& hdr)
+{
+       size_t num_img = 1;
+
+       // dim[0] gives the number of dimensions, and some writers set unused ones to zero
+       for (short int i = 4; i <= hdr.dime.dim[0] && i < 8; ++i )
+              if (hdr.dime.dim[i] > 0)
+                     num_img *= hdr.dime.dim[i];
+
+       return num_img;
+}
+
+static string get_data_file_name(const string& filename)
+{
+       return filename.substr(0, filename.length() - 3) + string("img");
+}
+
+static void skip_data_offset(CInputFile& data_file, int voffset, const string& data_file_name)
+{
+       // Coverty will complain about an untrusted value.
+       // This is no problem, because if voffset is off the scale, the
+       // data reading will fail and the plug-in will throw.
+       if (voffset != 0 && fseek(data_file, voffset > 0 ? voffset : -voffset, SEEK_CUR))
+              throw create_exception<runtime_error>("Analyze: unable seek in data file '",
+                                                    data_file_name, "':", strerror(errno) );
+}
+
+CAnalyze3DImageIOPlugin::PData CAnalyze3DImageIOPlugin::do_load(const string&  filename) const
+{
+       analyze_dsr hdr;
+       bool swap_endian = false;
+
+       if (!read_header(filename, hdr, swap_endian))
+              return PData();
+
        // get the size
        C3DBounds size(hdr.dime.dim[1], hdr.dime.dim[2], hdr.dime.dim[3]);
        C3DFVector voxel(hdr.dime.pixdim[1], hdr.dime.pixdim[2], hdr.dime.pixdim[3]);
        cvdebug() << "Analyze: got voxel size " << voxel << "\n";
-       size_t num_img = 1;
-
-       for (short int i = 4; i < hdr.dime.dim[0] ; ++i ) {
-              num_img *= hdr.dime.dim[i];
-       }
-
+       size_t num_img = get_number_of_images(hdr);
        // open data fiele
-       const string data_file_name = filename.substr(0, filename.length() - 3) + string("img");
+       const string data_file_name = get_data_file_name(filename);
        CInputFile data_file(data_file_name);
 
        if (!data_file)
@@ -427,57 +483,19 @@ CAnalyze3DImageIOPlugin::PData CAnalyze3DImageIOPlugin::do_load(const string&  f
        PData result(new C3DImageVector());
        int voffset = static_cast<int>(hdr.dime.vox_offset);
 
-       // Coverty will complain about an untrusted value.
-       // This is no problem, because if voffset is off the scale, the
-       // data reading will fail and the plug-in will throw.
        if (voffset > 0)
-              if (!fseek(data_file, voffset, SEEK_CUR))
-                     throw create_exception<runtime_error>("Analyze: unable seek in data file '",
-                                                           data_file_name, "':", strerror(errno) );
+              skip_data_offset(data_file, voffset, data_file_name);
 
        // read data
        while (num_img > 0) {
               --num_img;
-              E3DImageOrientation orientation = ior_unknown;
-
-              switch ( hdr.hist.orient ) {
-              case ao_transverse_unflipped:
-                     orientation = ior_axial;
-                     break;
-
-              case ao_transverse_flipped:
-                     orientation = ior_axial_flipped;
-                     break;
-
-              case ao_coronal_unflipped:
-                     orientation = ior_coronal;
-                     break;
 
-              case ao_coronal_flipped:
-                     orientation = ior_coronal_flipped ;
-                     break;
+              if (voffset < 0)
+                     skip_data_offset(data_file, voffset, data_file_name);
 
-              case ao_saggital_unflipped:
-                     orientation = ior_saggital;
-                     break;
-
-              case ao_saggital_flipped:
-                     orientation = ior_saggital_flipped;
-                     break;
-
-              default:
-                     orientation = ior_unknown;
-              }
-
-              if (voffset < 0) {
-                     if (!fseek(data_file, -voffset, SEEK_CUR))
-                            throw create_exception<runtime_error>("Analyze: unable seek in data file '",
-                                                                  data_file_name, "':", strerror(errno) );
-              }
-
-              P3DImage image(read_image(size, hdr.dime.datatype, data_file));
+              P3DImage image(read_image(size, hdr.dime.datatype, data_file, swap_endian));
               image->set_voxel_size(voxel);
-              image->set_orientation(orientation);
+              image->set_orientation(get_orientation(hdr.hist.orient));
               result->push_back(image);
        }
 
@@ -537,7 +555,7 @@ private:
 
 bool CAnalyze3DImageIOPlugin::save_data(const string& fname, const Data& data, analyze_image_dimension& dime) const
 {
-       const string data_file_name = fname.substr(0, fname.length() - 3) + string("img");
+       const string data_file_name = get_data_file_name(fname);
        COutputFile data_file(data_file_name);
 
        if (!data_file)
@@ -552,63 +570,40 @@ bool CAnalyze3DImageIOPlugin::save_data(const string& fname, const Data& data, a
        return true;
 }
 
-bool CAnalyze3DImageIOPlugin::do_save(const string& fname, const Data& data) const
+static char get_analyze_orientation(E3DImageOrientation orient)
 {
-       analyze_dsr hdr;
-       memset(&hdr, 0, sizeof(hdr));
-       hdr.hk.sizeof_hdr =  sizeof(hdr);
-       hdr.dime.dim[0] = 4;
-       hdr.dime.dim[4] = data.size();
-
-       if (data.empty())
-              throw invalid_argument("Trying to save empty image list");
-
-       Data::const_iterator k = data.begin();
-       C3DBounds size = (*k)->get_size();
-       C3DFVector voxel = (*k)->get_voxel_size();
-       EPixelType pixel_type = (*k)->get_pixel_type();
-       auto orient = (*k)->get_orientation();
-
        switch (orient) {
        case ior_axial:
-              hdr.hist.orient = ao_transverse_unflipped;
-              break;
+              return ao_transverse_unflipped;
 
        case ior_axial_flipped:
-              hdr.hist.orient = ao_transverse_flipped;
-              break;
+              return ao_transverse_flipped;
 
        case ior_coronal:
-              hdr.hist.orient = ao_coronal_unflipped;
-              break;
+              return ao_coronal_unflipped;
 
        case ior_coronal_flipped:
-              hdr.hist.orient = ao_coronal_flipped;
-              break;
+              return ao_coronal_flipped;
 
        case ior_saggital:
-              hdr.hist.orient = ao_saggital_unflipped;
-              break;
+              return ao_saggital_unflipped;
 
        case ior_saggital_flipped:
-              hdr.hist.orient = ao_saggital_flipped;
-              break;
+              return ao_saggital_flipped;
 
        default:
-              hdr.hist.orient = ao_unknown;
-       }
-
-       while (k != data.end()) {
-              if (size != (*k)->get_size() ||
-                  pixel_type != (*k)->get_pixel_type() ||
-                  voxel != (*k)->get_voxel_size() ) {
-                     throw invalid_argument("analyze only support images series of same size and type");
-              }
-
-              ++k;
+              return ao_unknown;
        }
+}
 
-       k = data.begin();
+static void init_header(analyze_dsr& hdr, const C3DBounds& size, const C3DImage& prototype, size_t num_img)
+{
+       memset(&hdr, 0, sizeof(hdr));
+       hdr.hk.sizeof_hdr =  sizeof(hdr);
+       hdr.dime.dim[0] = 4;
+       hdr.dime.dim[4] = num_img;
+       hdr.hist.orient = get_analyze_orientation(prototype.get_orientation());
+       const C3DFVector voxel = prototype.get_voxel_size();
        hdr.dime.dim[1] = size.x;
        hdr.dime.dim[2] = size.y;
        hdr.dime.dim[3] = size.z;
@@ -618,9 +613,12 @@ bool CAnalyze3DImageIOPlugin::do_save(const string& fname, const Data& data) con
        cvdebug() << voxel << "\n";
        hdr.hk.extents = 16384;
        hdr.hk.regular = 'r';
-       set_typeinfo(hdr.dime, pixel_type);
+       set_typeinfo(hdr.dime, prototype.get_pixel_type());
        hdr.dime.glmin = numeric_limits<int>::max();
-       save_data(fname, data, hdr.dime);
+}
+
+static void write_header(const string& fname, const analyze_dsr& hdr)
+{
        COutputFile hdr_file(fname);
 
        if (!hdr_file)
@@ -628,10 +626,163 @@ bool CAnalyze3DImageIOPlugin::do_save(const string& fname, const Data& data) con
 
        if (fwrite(&hdr, 1, sizeof(hdr), hdr_file) != sizeof(hdr))
               throw runtime_error(string("Analyze: error writing header '") + fname);
+}
+
+bool CAnalyze3DImageIOPlugin::do_save(const string& fname, const Data& data) const
+{
+       if (data.empty())
+              throw invalid_argument("Trying to save empty image list");
+
+       Data::const_iterator k = data.begin();
+       C3DBounds size = (*k)->get_size();
+       C3DFVector voxel = (*k)->get_voxel_size();
+       EPixelType pixel_type = (*k)->get_pixel_type();
+
+       while (k != data.end()) {
+              if (size != (*k)->get_size() ||
+                  pixel_type != (*k)->get_pixel_type() ||
+                  voxel != (*k)->get_voxel_size() ) {
+                     throw invalid_argument("analyze only support images series of same size and type");
+              }
 
+              ++k;
+       }
+
+       analyze_dsr hdr;
+       init_header(hdr, size, *data[0], data.size());
+       save_data(fname, data, hdr.dime);
+       write_header(fname, hdr);
        return true;
 }
 
+class CAnalyzeSliceReader: public C3DImageSliceReader
+{
+public:
+       CAnalyzeSliceReader(const string& data_file_name, const analyze_dsr& hdr, bool swap_endian);
+
+       C3DBounds get_size() const;
+       P3DImage read_slices(unsigned n);
+private:
+       C3DBounds m_size;
+       C3DFVector m_voxel;
+       E3DImageOrientation m_orientation;
+       short m_datatype;
+       bool m_swap_endian;
+       unsigned m_next_slice;
+       CInputFile m_data_file;
+};
+
+CAnalyzeSliceReader::CAnalyzeSliceReader(const string& data_file_name, const analyze_dsr& hdr, bool swap_endian):
+       m_size(hdr.dime.dim[1], hdr.dime.dim[2], hdr.dime.dim[3]),
+       m_voxel(hdr.dime.pixdim[1], hdr.dime.pixdim[2], hdr.dime.pixdim[3]),
+       m_orientation(get_orientation(hdr.hist.orient)),
+       m_datatype(hdr.dime.datatype),
+       m_swap_endian(swap_endian),
+       m_next_slice(0),
+       m_data_file(data_file_name)
+{
+       if (!m_data_file)
+              throw runtime_error(string("Analyze: unable to find data file:") + data_file_name );
+
+       skip_data_offset(m_data_file, static_cast<int>(hdr.dime.vox_offset), data_file_name);
+}
+
+C3DBounds CAnalyzeSliceReader::get_size() const
+{
+       return m_size;
+}
+
+P3DImage CAnalyzeSliceReader::read_slices(unsigned n)
+{
+       if (m_next_slice + n > m_size.z)
+              throw create_exception<runtime_error>("Analyze: requested slices [", m_next_slice, ", ",
+                                                    m_next_slice + n, ") but the image has only ",
+                                                    m_size.z, " slices");
+
+       P3DImage slices(read_image(C3DBounds(m_size.x, m_size.y, n), m_datatype, m_data_file, m_swap_endian));
+       slices->set_voxel_size(m_voxel);
+       slices->set_orientation(m_orientation);
+       m_next_slice += n;
+       return slices;
+}
+
+class CAnalyzeSliceWriter: public C3DImageSliceWriter
+{
+public:
+       CAnalyzeSliceWriter(const string& fname, const C3DBounds& size, const C3DImage& prototype);
+
+       void write_slices(const C3DImage& slices);
+       void close();
+private:
+       string m_hdr_file_name;
+       analyze_dsr m_hdr;
+       C3DBounds m_size;
+       EPixelType m_pixel_type;
+       unsigned m_written;
+       unique_ptr<COutputFile> m_data_file;
+};
+
+CAnalyzeSliceWriter::CAnalyzeSliceWriter(const string& fname, const C3DBounds& size, const C3DImage& prototype):
+       m_hdr_file_name(fname),
+       m_size(size),
+       m_pixel_type(prototype.get_pixel_type()),
+       m_written(0),
+       m_data_file(new COutputFile(get_data_file_name(fname)))
+{
+       init_header(m_hdr, size, prototype, 1);
+
+       if (!*m_data_file)
+              throw runtime_error(string("Analyze: unable to open '") + get_data_file_name(fname) + "' for writing");
+}
+
+void CAnalyzeSliceWriter::write_slices(const C3DImage& slices)
+{
+       const C3DBounds& size = slices.get_size();
+
+       if (size.x != m_size.x || size.y != m_size.y || slices.get_pixel_type() != m_pixel_type)
+              throw invalid_argument("Analyze: slices must have the in-plane size and pixel type of the image");
+
+       if (m_written + size.z > m_size.z)
+              throw create_exception<invalid_argument>("Analyze: got ", m_written + size.z,
+                                                       " slices for an image of depth ", m_size.z);
+
+       if (!m_data_file)
+              throw runtime_error("Analyze: the slice writer was already closed");
+
+       CSavefilter saver(*m_data_file, m_hdr.dime);
+       mia::filter(saver, slices);
+       m_written += size.z;
+}
+
+void CAnalyzeSliceWriter::close()
+{
+       if (m_written != m_size.z)
+              throw create_exception<runtime_error>("Analyze: only ", m_written, " of ", m_size.z,
+                                                    " slices were written to '", m_hdr_file_name, "'");
+
+       // close the data file before the header makes the image visible
+       m_data_file.reset();
+       write_header(m_hdr_file_name, m_hdr);
+}
+
+unique_ptr<C3DImageSliceReader> CAnalyze3DImageIOPlugin::open_slice_reader(const string& filename) const
+{
+       analyze_dsr hdr;
+       bool swap_endian = false;
+
+       if (!read_header(filename, hdr, swap_endian) || get_number_of_images(hdr) != 1)
+              return unique_ptr<C3DImageSliceReader>();
+
+       return unique_ptr<C3DImageSliceReader>(new CAnalyzeSliceReader(get_data_file_name(filename),
+                                              hdr, swap_endian));
+}
+
+unique_ptr<C3DImageSliceWriter> CAnalyze3DImageIOPlugin::open_slice_writer(const string& filename,
+              const C3DBounds& size, const C3DImage& prototype) const
+{
+       return unique_ptr<C3DImageSliceWriter>(new CAnalyzeSliceWriter(filename, size, prototype));
+}
+
 const std::string CAnalyze3DImageIOPlugin::do_get_preferred_suffix() const
 {
        return "hdr";
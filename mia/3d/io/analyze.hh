@@ -28,10 +28,14 @@ NS_BEGIN(IMAGEIO_3D_ANALYZE)
 struct analyze_image_dimension;
 struct analyze_dsr;
 
-class CAnalyze3DImageIOPlugin : public mia::C3DImageIOPlugin
+class CAnalyze3DImageIOPlugin : public mia::C3DImageIOPlugin, public mia::C3DImageSliceIO
 {
 public:
        CAnalyze3DImageIOPlugin();
+
+       std::unique_ptr<mia::C3DImageSliceReader> open_slice_reader(const std::string& filename) const;
+       std::unique_ptr<mia::C3DImageSliceWriter> open_slice_writer(const std::string& filename,
+                     const mia::C3DBounds& size, const mia::C3DImage& prototype) const;
 private:
        typedef mia::C3DImageIOPlugin::PData PData;
        typedef mia::C3DImageIOPlugin::Data Data;
@@ -43,11 +47,10 @@ private:
 
        void swap_hdr(analyze_dsr& hdr) const;
 
-       mia::C3DImage *read_image(const mia::C3DBounds& size, short datatype, mia::CInputFile& data_file)const;
+       bool read_header(const std::string& filename, analyze_dsr& hdr, bool& swap_endian) const;
 
        bool save_data(const std::string& fname, const Data& data, analyze_image_dimension& dime) const;
        const mia::TDictMap<mia::EPixelType> m_type_table;
-       mutable bool m_swap_endian;
 };
 
 NS_END
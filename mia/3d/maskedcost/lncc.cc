@@ -31,104 +31,64 @@ using std::vector;
 using std::pair;
 using std::make_pair;
 
-CLNCC3DImageCost::CLNCC3DImageCost(int hw):
-       m_hwidth(hw)
+CLNCC3DImageCost::CLNCC3DImageCost(int hw, bool brute_force):
+       m_hwidth(hw),
+       m_brute_force(brute_force)
 {
        m_copy_to_double = produce_3dimage_filter("convert:repn=double,map=copy");
 }
 
-inline pair<C3DBounds, C3DBounds> prepare_range(const C3DBounds& size, int cx, int cy, int cz, int hw)
+/*
+  The window sums are obtained by CNCCSlidingWindow, hence the cost doesn't depend on the
+  window size. Each work package moves the window through a contiguous range of slices,
+  and initializing the window at the start of a package costs as much as moving it
+  through 2hw+1 slices. Therefore, the volume is split into one slab per task.
+*/
+inline int get_block_size(int nz)
 {
-       int zb = cz - hw;
-
-       if (zb < 0) zb = 0;
-
-       unsigned ze = cz + hw + 1;
-
-       if (ze > size.z) ze = size.z;
-
-       int yb = cy - hw;
-
-       if (yb < 0) yb = 0;
-
-       unsigned ye = cy + hw + 1;
-
-       if (ye > size.y) ye = size.y;
-
-       int xb = cx - hw;
-
-       if (xb < 0) xb = 0;
-
-       unsigned xe = cx + hw + 1;
-
-       if (xe > size.x) xe = size.x;
-
-       return make_pair(C3DBounds(xb, yb, zb), C3DBounds(xe, ye, ze));
+       const int n_tasks = get_max_parallel_tasks();
+       return std::max(1, (nz + n_tasks - 1) / n_tasks);
 }
 
-#ifdef __SSE2__
-typedef double v2df __attribute__ ((vector_size (16)));
-#endif
-
-
 class FEvalCost : public TFilter<float>
 {
        int m_hw;
+       bool m_brute_force;
        const C3DBitImage& m_mask;
 public:
-       FEvalCost(int hw, const C3DBitImage& mask):
+       FEvalCost(int hw, bool brute_force, const C3DBitImage& mask):
               m_hw(hw),
+              m_brute_force(brute_force),
               m_mask(mask)
        {}
 
        float operator () ( const C3DDImage& mov, const C3DDImage& ref) const
        {
-              auto evaluate_local_cost = [this, &mov, &ref](const C1DParallelRange & range, const pair<float, int>& result) -> pair<float, int> {
+              const C3DBounds& size = mov.get_size();
+              auto evaluate_local_cost = [this, &mov, &ref, &size](const C1DParallelRange & range, const pair<float, int>& result) -> pair<float, int> {
                      CThreadMsgStream msks;
                      float lresult = 0.0;
                      int count = 0;
-                     const int max_length = 2 * m_hw + 1;
-                     vector<float> a_buffer( max_length *max_length * max_length);
-                     vector<float> b_buffer( max_length *max_length * max_length);
+                     const size_t slice_size = size.x * size.y;
+                     CNCCSlidingWindow window(&mov[0], &ref[0], &m_mask[0], size.x, size.y, size.z, m_hw, m_brute_force);
 
                      for (auto z = range.begin(); z != range.end(); ++z)
                      {
+                            window.set_slice(z);
                             auto imask  = m_mask.begin_at(0, 0, z);
 
-                            for (size_t y = 0; y < mov.get_size().y; ++y)
-                                   for (size_t x = 0; x < mov.get_size().x; ++x, ++imask) {
-                                          if (!*imask)
-                                                 continue;
-
-                                          auto c_block = prepare_range(mov.get_size(), x, y, z, m_hw);
-                                          NCCSums sum;
-
-                                          for (unsigned iz = c_block.first.z; iz < c_block.second.z; ++iz) {
-                                                 for (unsigned iy = c_block.first.y; iy < c_block.second.y; ++iy) {
-                                                        auto ia = mov.begin_at(0, iy, iz);
-                                                        auto ib = ref.begin_at(0, iy, iz);
-                                                        auto im = m_mask.begin_at(0, iy, iz);
-
-                                                        for (unsigned ix = c_block.first.x; ix < c_block.second.x; ++ix) {
-                                                               // make a local copy
-                                                               if (im[ix]) {
-                                                                      sum.add(ia[ix], ib[ix]);
-                                                               }
-                                                        }
-                                                 }
-                                          }
-
-                                          if (sum.has_samples()) {
-                                                 lresult += sum.value();
-                                                 ++count;
-                                          }
+                            for (size_t i = 0; i < slice_size; ++i, ++imask) {
+                                   if (*imask && window.get_count(i) > 0) {
+                                          lresult += window[i].value();
+                                          ++count;
                                    }
+                            }
                      }
 
                      return make_pair(result.first + lresult, result.second + count);
               };
               pair<float, int> init{0, 0};
-              auto r = preduce(C1DParallelRange(0, mov.get_size().z, 1), init, evaluate_local_cost,
+              auto r = preduce(C1DParallelRange(0, size.z, get_block_size(size.z)), init, evaluate_local_cost,
               [](const pair<float, int>& x, const pair<float, int>& y) {
                      return make_pair(x.first + y.first, x.second + y.second);
               });
@@ -144,7 +104,7 @@ double CLNCC3DImageCost::do_value(const Data& a, const Data& b, const Mask& m) c
        auto b_double_ptr = m_copy_to_double->filter(b);
        const C3DDImage& mov = static_cast<const C3DDImage&>(*a_double_ptr);
        const C3DDImage& ref = static_cast<const C3DDImage&>(*b_double_ptr);
-       FEvalCost ecost(m_hwidth, m);
+       FEvalCost ecost(m_hwidth, m_brute_force, m);
        return ecost(mov, ref);
 }
 
@@ -152,11 +112,13 @@ double CLNCC3DImageCost::do_value(const Data& a, const Data& b, const Mask& m) c
 class FEvalCostForce : public TFilter<float>
 {
        int m_hw;
+       bool m_brute_force;
        const C3DBitImage& m_mask;
        C3DFVectorfield& m_force;
 public:
-       FEvalCostForce(int hw, const C3DBitImage& mask, C3DFVectorfield& force):
+       FEvalCostForce(int hw, bool brute_force, const C3DBitImage& mask, C3DFVectorfield& force):
               m_hw(hw),
+              m_brute_force(brute_force),
               m_mask(mask),
               m_force(force)
        {}
@@ -164,60 +126,41 @@ public:
        float operator () ( const C3DDImage& mov, const C3DDImage& ref) const
        {
               auto ag = get_gradient(mov);
-              auto evaluate_local_cost_force = [this, &mov, &ref, &ag](const C1DParallelRange & range,
+              const C3DBounds& size = mov.get_size();
+              auto evaluate_local_cost_force = [this, &mov, &ref, &ag, &size](const C1DParallelRange & range,
               const pair<float, int>& result) -> pair<float, int> {
 
                      CThreadMsgStream msks;
                      float lresult = 0.0;
                      int count = 0;
-                     const int max_length = 2 * m_hw + 1;
-                     vector<float> a_buffer( max_length *max_length * max_length);
-                     vector<float> b_buffer( max_length *max_length * max_length);
+                     const size_t slice_size = size.x * size.y;
+                     CNCCSlidingWindow window(&mov[0], &ref[0], &m_mask[0], size.x, size.y, size.z, m_hw, m_brute_force);
+                     const double offset_a = window.get_offset_a();
+                     const double offset_b = window.get_offset_b();
 
                      for (auto z = range.begin(); z != range.end(); ++z)
                      {
+                            window.set_slice(z);
                             auto iforce = m_force.begin_at(0, 0, z);
                             auto imask = m_mask.begin_at(0, 0, z);
                             auto ig = ag.begin_at(0, 0, z);
                             auto imov = mov.begin_at(0, 0, z);
                             auto iref = ref.begin_at(0, 0, z);
 
-                            for (size_t y = 0; y < mov.get_size().y; ++y)
-                                   for (size_t x = 0; x < mov.get_size().x; ++x, ++iforce, ++imask, ++ig, ++iref, ++imov) {
-                                          if (!*imask)
-                                                 continue;
-
-                                          auto c_block = prepare_range(mov.get_size(), x, y, z, m_hw);
-                                          NCCSums sum;
-
-                                          for (unsigned iz = c_block.first.z; iz < c_block.second.z; ++iz) {
-                                                 for (unsigned iy = c_block.first.y; iy < c_block.second.y; ++iy) {
-                                                        auto ia = mov.begin_at(0, iy, iz);
-                                                        auto ib = ref.begin_at(0, iy, iz);
-                                                        auto im = m_mask.begin_at(0, iy, iz);
-
-                                                        for (unsigned ix = c_block.first.x; ix < c_block.second.x; ++ix) {
-                                                               // make a local copy
-                                                               if (im[ix]) {
-                                                                      sum.add(ia[ix], ib[ix]);
-                                                               }
-                                                        }
-                                                 }
-                                          }
-
-                                          if (sum.has_samples()) {
-                                                 auto res = sum.get_grad_helper();
-                                                 lresult += res.first;
-                                                 *iforce = res.second.get_gradient_scale(*imov, *iref) * *ig;
-                                                 ++count;
-                                          }
+                            for (size_t i = 0; i < slice_size; ++i, ++iforce, ++imask, ++ig, ++iref, ++imov) {
+                                   if (*imask && window.get_count(i) > 0) {
+                                          auto res = window[i].get_grad_helper();
+                                          lresult += res.first;
+                                          *iforce = res.second.get_gradient_scale(*imov - offset_a, *iref - offset_b) * *ig;
+                                          ++count;
                                    }
+                            }
                      }
 
                      return make_pair(result.first + lresult, result.second + count);
               };
               pair<float, int> init{0, 0};
-              auto r = preduce(C1DParallelRange(0, mov.get_size().z, 1), init, evaluate_local_cost_force,
+              auto r = preduce(C1DParallelRange(0, size.z, get_block_size(size.z)), init, evaluate_local_cost_force,
               [](const pair<float, int>& x, const pair<float, int>& y) {
                      return make_pair(x.first + y.first, x.second + y.second);
               });
@@ -232,22 +175,26 @@ double CLNCC3DImageCost::do_evaluate_force(const Data& a, const Data& b, const M
        auto b_double_ptr = m_copy_to_double->filter(b);
        const C3DDImage& mov = static_cast<const C3DDImage&>(*a_double_ptr);
        const C3DDImage& ref = static_cast<const C3DDImage&>(*b_double_ptr);
-       FEvalCostForce ecostforce(m_hwidth, m, force);
+       FEvalCostForce ecostforce(m_hwidth, m_brute_force, m, force);
        return ecostforce(mov, ref);
 }
 
 
 CLNCC3DImageCostPlugin::CLNCC3DImageCostPlugin():
        C3DMaskedImageCostPlugin("lncc"),
-       m_hw(5)
+       m_hw(5),
+       m_brute_force(false)
 {
        this->add_parameter("w", make_ci_param(m_hw, 1, 256, false,
                                               "half width of the window used for evaluating the localized cross correlation"));
+       this->add_parameter("brute-force", make_param(m_brute_force, false,
+                           "evaluate the window sums by visiting all pixels of each window, "
+                           "this is slow and only meant for testing"));
 }
 
 C3DMaskedImageCost *CLNCC3DImageCostPlugin::do_create() const
 {
-       return new CLNCC3DImageCost(m_hw);
+       return new CLNCC3DImageCost(m_hw, m_brute_force);
 }
 
 const std::string CLNCC3DImageCostPlugin::do_get_descr() const
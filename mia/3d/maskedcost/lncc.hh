@@ -35,11 +35,12 @@ public:
        typedef mia::C3DMaskedImageCost::Force Force;
        typedef mia::C3DMaskedImageCost::Mask Mask;
 
-       CLNCC3DImageCost(int hw);
+       CLNCC3DImageCost(int hw, bool brute_force);
 private:
        virtual double do_value(const Data& a, const Data& b, const Mask& m) const;
        virtual double do_evaluate_force(const Data& a, const Data& b, const Mask& m, Force& force) const;
        int m_hwidth;
+       bool m_brute_force;
        mia::P3DFilter m_copy_to_double;
 };
 
@@ -51,6 +52,7 @@ public:
 private:
        const std::string do_get_descr() const;
        unsigned int m_hw;
+       bool m_brute_force;
 };
 
 NS_END
@@ -0,0 +1,367 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+  This plug-in implements the navier-stokes operator like registration model
+  that accounts for linear elastic and fluid dynamic registration.
+  Which model is used depends on the selected time step.
+
+  The PDE is discretized like in the fluid3d solver (the grad-div term only
+  contributes the second derivative along the direction of the respective
+  component), and it is solved by multigrid V-cycles. The smoother is a Gauss-Seidel relaxation that visits
+  the voxels in eight colors given by the parity of the coordinates. Because
+  no voxel depends on a voxel of the same color, all voxels of one color are
+  updated in parallel and the result doesn't depend on the number of threads.
+*/
+
+#include <cassert>
+#include <mia/core/parallel.hh>
+#include <mia/3d/reg3d/naviermg.hh>
+
+NS_MIA_USE
+using namespace std;
+
+NS_BEGIN(naviermg_regmodel)
+
+// stop coarsening if a grid dimension would become smaller than this
+static const unsigned c_min_grid_size = 5;
+
+// number of smoothing sweeps on the coarsest grid
+static const unsigned c_coarse_sweeps = 20;
+
+C3DNavierMultigridRegModel::C3DNavierMultigridRegModel(float mu, float lambda, size_t maxiter, float epsilon,
+              unsigned pre_smooth, unsigned post_smooth, unsigned max_levels, bool sor_stencil):
+       m_epsilon(epsilon),
+       m_max_iter(maxiter),
+       m_pre_smooth(pre_smooth),
+       m_post_smooth(post_smooth),
+       m_max_levels(max_levels),
+       m_levels(1)
+{
+       float a = mu;
+       float b = lambda + mu;
+       float c = 1 / (6 * a + 2 * b);
+       m_b_4 = 0.25 * b * c;
+       const float a_b = ( a + b ) * c;
+       const float ac = a * c;
+
+       if (sor_stencil) {
+              m_wxx = C3DFVector(a_b, a_b, a_b);
+              m_wyy = m_wzz = C3DFVector(ac, ac, ac);
+       } else {
+              m_wxx = C3DFVector(a_b, ac, ac);
+              m_wyy = C3DFVector(ac, a_b, ac);
+              m_wzz = C3DFVector(ac, ac, a_b);
+       }
+
+       cvdebug() << "initialise model with mu=" << mu << " lambda=" << lambda
+                 << " pre=" << pre_smooth << " post=" << post_smooth
+                 << " sor-stencil=" << sor_stencil << "\n";
+}
+
+inline C3DFVector C3DNavierMultigridRegModel::neighbor_sum(const C3DFVector *v, int dx, int dxy) const
+{
+       const C3DFVector vxx = v[-1] + v[+1];
+       const C3DFVector vyy = v[-dx] + v[+dx];
+       const C3DFVector vzz = v[-dxy] + v[+dxy];
+       const C3DFVector p = m_wxx * vxx + m_wyy * vyy + m_wzz * vzz;
+       C3DFVector q( v[ -1 - dx].y + v[ 1 + dx].y - v[ -1 + dx].y - v[ 1 - dx].y +
+                     v[ -1 - dxy].z + v[ 1 + dxy].z - v[ -1 + dxy].z - v[ 1 - dxy].z,
+                     v[ -1 - dx].x + v[ 1 + dx].x - v[ -1 + dx].x - v[ 1 - dx].x +
+                     v[ -dx - dxy].z + v[ dx + dxy].z - v[ -dx + dxy].z - v[ dx - dxy].z,
+                     v[ -1 - dxy].x + v[ 1 + dxy].x - v[ -1 + dxy].x - v[ 1 - dxy].x +
+                     v[ -dx - dxy].y + v[ dx + dxy].y - v[ -dx + dxy].y - v[ dx - dxy].y);
+       return p + m_b_4 * q;
+}
+
+void C3DNavierMultigridRegModel::smooth(const C3DFVectorfield& f, C3DFVectorfield& v, unsigned sweeps) const
+{
+       const C3DBounds& size = v.get_size();
+       const int dx = size.x;
+       const int dxy = v.get_plane_size_xy();
+       const C3DFVector *pf = &f[0];
+       C3DFVector *pv = &v[0];
+
+       for (unsigned s = 0; s < sweeps; ++s) {
+              for (unsigned color = 0; color < 8; ++color) {
+                     const unsigned cx = 1 + ((color & 1) ^ 1);
+                     const unsigned cy = 1 + (((color >> 1) & 1) ^ 1);
+                     const unsigned cz = 1 + (((color >> 2) & 1) ^ 1);
+
+                     if (cz >= size.z - 1)
+                            continue;
+
+                     // the slices of one color are independent
+                     auto sweep_slices = [&](const C1DParallelRange & range) {
+                            for (auto iz = range.begin(); iz != range.end(); ++iz) {
+                                   const unsigned z = cz + 2 * iz;
+
+                                   for (unsigned y = cy; y < size.y - 1; y += 2) {
+                                          const int row = z * dxy + y * dx;
+
+                                          for (unsigned x = cx; x < size.x - 1; x += 2) {
+                                                 const int i = row + x;
+                                                 pv[i] = pf[i] + neighbor_sum(&pv[i], dx, dxy);
+                                          }
+                                   }
+                            }
+                     };
+                     pfor(C1DParallelRange(0, (size.z - cz) / 2, 1), sweep_slices);
+              }
+       }
+}
+
+double C3DNavierMultigridRegModel::evaluate_residuum(const C3DFVectorfield& f, const C3DFVectorfield& v,
+              C3DFVectorfield *r) const
+{
+       const C3DBounds& size = v.get_size();
+       const int dx = size.x;
+       const int dxy = v.get_plane_size_xy();
+       const C3DFVector *pf = &f[0];
+       const C3DFVector *pv = &v[0];
+       C3DFVector *pr = r ? &(*r)[0] : nullptr;
+       auto residuum_slices = [&](const C1DParallelRange & range, double sum) -> double {
+              for (auto z = range.begin(); z != range.end(); ++z)
+              {
+                     for (unsigned y = 1; y < size.y - 1; ++y) {
+                            const int row = z * dxy + y * dx;
+
+                            for (unsigned x = 1; x < size.x - 1; ++x) {
+                                   const int i = row + x;
+                                   const C3DFVector delta = pf[i] + neighbor_sum(&pv[i], dx, dxy) - pv[i];
+                                   sum += delta.norm();
+
+                                   if (pr)
+                                          pr[i] = delta;
+                            }
+                     }
+              }
+              return sum;
+       };
+       return preduce(C1DParallelRange(1, size.z - 1, 1), 0.0, residuum_slices,
+       [](double x, double y) {
+              return x + y;
+       });
+}
+
+double C3DNavierMultigridRegModel::residuum(const C3DFVectorfield& b, const C3DFVectorfield& v) const
+{
+       assert(b.get_size() == v.get_size());
+       return evaluate_residuum(b, v, nullptr);
+}
+
+static C3DBounds coarse_size(const C3DBounds& size)
+{
+       return C3DBounds(size.x / 2 + 1, size.y / 2 + 1, size.z / 2 + 1);
+}
+
+/*
+   Full weighting restriction of the fine grid residuum. Coarse grid node i corresponds to
+   fine grid node 2i; for even fine grid sizes the last coarse node is mapped to the
+   fine grid boundary. The factor 4 accounts for the doubled grid spacing.
+*/
+static void restrict_residuum(const C3DFVectorfield& fine, C3DFVectorfield& coarse)
+{
+       const C3DBounds& fs = fine.get_size();
+       const C3DBounds& cs = coarse.get_size();
+       const float w[3] = {0.25f, 0.5f, 0.25f};
+       auto restrict_slices = [&](const C1DParallelRange & range) {
+              for (auto z = range.begin(); z != range.end(); ++z) {
+                     for (unsigned y = 1; y < cs.y - 1; ++y) {
+                            for (unsigned x = 1; x < cs.x - 1; ++x) {
+                                   C3DFVector sum;
+                                   const int fz = 2 * z;
+                                   const int fy = 2 * y;
+                                   const int fx = 2 * x;
+
+                                   for (int dz = -1; dz <= 1; ++dz) {
+                                          if (fz + dz >= static_cast<int>(fs.z))
+                                                 continue;
+
+                                          for (int dy = -1; dy <= 1; ++dy) {
+                                                 if (fy + dy >= static_cast<int>(fs.y))
+                                                        continue;
+
+                                                 const float wzy = w[dz + 1] * w[dy + 1];
+
+                                                 for (int dx = -1; dx <= 1; ++dx) {
+                                                        if (fx + dx >= static_cast<int>(fs.x))
+                                                               continue;
+
+                                                        sum += (wzy * w[dx + 1]) * fine(fx + dx, fy + dy, fz + dz);
+                                                 }
+                                          }
+                                   }
+
+                                   coarse(x, y, z) = 4.0f * sum;
+                            }
+                     }
+              }
+       };
+       pfor(C1DParallelRange(1, cs.z - 1, 1), restrict_slices);
+}
+
+/*
+   Add the trilinear interpolation of the coarse grid correction to the interior of the
+   fine grid solution.
+*/
+static void prolongate_correction(const C3DFVectorfield& coarse, C3DFVectorfield& fine)
+{
+       const C3DBounds& fs = fine.get_size();
+       const C3DBounds& cs = coarse.get_size();
+       auto prolongate_slices = [&](const C1DParallelRange & range) {
+              for (auto z = range.begin(); z != range.end(); ++z) {
+                     const unsigned z0 = z / 2;
+                     const unsigned z1 = min(static_cast<unsigned>(z + 1) / 2, cs.z - 1);
+
+                     for (unsigned y = 1; y < fs.y - 1; ++y) {
+                            const unsigned y0 = y / 2;
+                            const unsigned y1 = min((y + 1) / 2, cs.y - 1);
+
+                            for (unsigned x = 1; x < fs.x - 1; ++x) {
+                                   const unsigned x0 = x / 2;
+                                   const unsigned x1 = min((x + 1) / 2, cs.x - 1);
+                                   fine(x, y, z) += 0.125f * (coarse(x0, y0, z0) + coarse(x1, y0, z0) +
+                                                              coarse(x0, y1, z0) + coarse(x1, y1, z0) +
+                                                              coarse(x0, y0, z1) + coarse(x1, y0, z1) +
+                                                              coarse(x0, y1, z1) + coarse(x1, y1, z1));
+                            }
+                     }
+              }
+       };
+       pfor(C1DParallelRange(1, fs.z - 1, 1), prolongate_slices);
+}
+
+void C3DNavierMultigridRegModel::vcycle(unsigned level, const C3DFVectorfield& f, C3DFVectorfield& v) const
+{
+       if (level + 1 >= m_levels) {
+              smooth(f, v, level > 0 ? c_coarse_sweeps : m_pre_smooth + m_post_smooth);
+              return;
+       }
+
+       smooth(f, v, m_pre_smooth);
+       C3DFVectorfield r(v.get_size());
+       evaluate_residuum(f, v, &r);
+       const C3DBounds cs = coarse_size(v.get_size());
+       C3DFVectorfield coarse_f(cs);
+       restrict_residuum(r, coarse_f);
+       C3DFVectorfield coarse_v(cs);
+       vcycle(level + 1, coarse_f, coarse_v);
+       prolongate_correction(coarse_v, v);
+       smooth(f, v, m_post_smooth);
+}
+
+void C3DNavierMultigridRegModel::do_solve(const C3DFVectorfield& b, C3DFVectorfield& v) const
+{
+       assert(b.get_size() == v.get_size());
+       C3DBounds size = b.get_size();
+
+       if (size.x < 3 || size.y < 3 || size.z < 3)
+              return;
+
+       m_levels = 1;
+
+       while (m_levels < m_max_levels) {
+              size = coarse_size(size);
+
+              if (size.x < c_min_grid_size || size.y < c_min_grid_size || size.z < c_min_grid_size)
+                     break;
+
+              ++m_levels;
+       }
+
+       const double start_residuum = residuum(b, v);
+       cvdebug() << "NAVIERMG: levels=" << m_levels << ", start residuum " << start_residuum << "\n";
+
+       if (start_residuum <= 0.0)
+              return;
+
+       for (size_t i = 0; i < m_max_iter; ++i) {
+              vcycle(0, b, v);
+              const double r = residuum(b, v);
+              cvdebug() << "NAVIERMG: [" << i << "] residuum " << r << "\n";
+
+              if (r / start_residuum <= m_epsilon)
+                     break;
+       }
+}
+
+class C3DNavierMultigridRegModelPlugin: public C3DRegModelPlugin
+{
+public:
+       C3DNavierMultigridRegModelPlugin();
+       C3DRegModel *do_create()const;
+
+private:
+       const string do_get_descr()const;
+
+       float m_mu;
+       float m_lambda;
+       float m_epsilon;
+       int m_maxiter;
+       int m_pre_smooth;
+       int m_post_smooth;
+       int m_levels;
+       bool m_sor_stencil;
+};
+
+C3DNavierMultigridRegModelPlugin::C3DNavierMultigridRegModelPlugin():
+       C3DRegModelPlugin("naviermg"),
+       m_mu(1.0),
+       m_lambda(1.0),
+       m_epsilon(0.0001),
+       m_maxiter(20),
+       m_pre_smooth(2),
+       m_post_smooth(2),
+       m_levels(8),
+       m_sor_stencil(false)
+{
+       add_parameter("mu", make_nonnegative_param(m_mu, false, "isotropic compliance"));
+       add_parameter("lambda", make_nonnegative_param(m_lambda, false, "isotropic compression"));
+       add_parameter("epsilon", make_oci_param(m_epsilon, 0.0, 0.1, false, "stopping parameter"));
+       add_parameter("iter", make_lc_param(m_maxiter, 1, false, "maximum number of V-cycles"));
+       add_parameter("pre", make_ci_param(m_pre_smooth, 0, 10, false,
+                                          "number of smoothing sweeps before the coarse grid correction"));
+       add_parameter("post", make_ci_param(m_post_smooth, 0, 10, false,
+                                           "number of smoothing sweeps after the coarse grid correction"));
+       add_parameter("levels", make_ci_param(m_levels, 1, 16, false,
+                                             "maximum number of grid levels, 1 results in a plain Gauss-Seidel solver"));
+       add_parameter("sor-stencil", make_param(m_sor_stencil, false,
+                                               "use the discretization of the SOR based models navier, "
+                                               "naviera, and navierpsse, e.g. to compare the solvers"));
+}
+
+C3DRegModel *C3DNavierMultigridRegModelPlugin::do_create()const
+{
+       return new C3DNavierMultigridRegModel(m_mu, m_lambda, m_maxiter, m_epsilon,
+                                             m_pre_smooth, m_post_smooth, m_levels, m_sor_stencil);
+}
+
+const string C3DNavierMultigridRegModelPlugin::do_get_descr()const
+{
+       return "navier-stokes based registration model solved by a parallel multigrid solver";
+}
+
+extern "C" EXPORT CPluginBase *get_plugin_interface()
+{
+       return new C3DNavierMultigridRegModelPlugin();
+}
+
+NS_END
@@ -0,0 +1,93 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef mia_3d_reg3d_naviermg_hh
+#define mia_3d_reg3d_naviermg_hh
+
+#include <mia/3d/model.hh>
+
+NS_BEGIN(naviermg_regmodel)
+
+/**
+   \brief Navier-Lame registration model solved by a multigrid V-cycle
+
+   This model solves the Navier-Lame PDE like the "navier" model, but
+   instead of a lexicographic SOR it runs multigrid V-cycles that use a
+   multi-colored Gauss-Seidel smoother. Since the mixed derivatives couple
+   each voxel also to its in-plane diagonal neighbors, the classic red-black
+   ordering is extended to eight colors (the parity of x, y, and z) which makes
+   all voxels of one color independent and allows to update them in parallel.
+
+   The SOR based models "navier", "naviera", and "navierpsse" weight the second
+   derivatives along x with (2mu+lambda) and along y and z with mu for all
+   three components of the displacement, whereas the Navier-Lame operator
+   uses (2mu+lambda) only for the derivative of each component along its own
+   direction. By default this model uses the latter discretization, for
+   comparisons with the SOR models their stencil can be selected instead.
+*/
+class C3DNavierMultigridRegModel: public mia::C3DRegModel
+{
+public:
+       /**
+          \param mu isotropic compliance
+          \param lambda isotropic compression
+          \param maxiter maximum number of V-cycles
+          \param epsilon relative residuum reduction that stops the iteration
+          \param pre_smooth number of smoothing sweeps before coarse grid correction
+          \param post_smooth number of smoothing sweeps after coarse grid correction
+          \param max_levels maximum number of grid levels, 1 results in a plain
+          multi-color Gauss-Seidel solver
+          \param sor_stencil use the discretization of the SOR based navier models
+       */
+       C3DNavierMultigridRegModel(float mu, float lambda, size_t maxiter, float epsilon,
+                                  unsigned pre_smooth, unsigned post_smooth, unsigned max_levels,
+                                  bool sor_stencil = false);
+
+       /**
+          Evaluate the residuum of the discretized PDE
+          \param b the right hand side
+          \param v the current solution estimate
+          \returns the sum of the norms of the residuum vectors over the interior voxels
+       */
+       double residuum(const mia::C3DFVectorfield& b, const mia::C3DFVectorfield& v) const;
+private:
+       virtual void do_solve(const mia::C3DFVectorfield& b, mia::C3DFVectorfield& x) const;
+
+       void vcycle(unsigned level, const mia::C3DFVectorfield& f, mia::C3DFVectorfield& v) const;
+       void smooth(const mia::C3DFVectorfield& f, mia::C3DFVectorfield& v, unsigned sweeps) const;
+       double evaluate_residuum(const mia::C3DFVectorfield& f, const mia::C3DFVectorfield& v,
+                                mia::C3DFVectorfield *r) const;
+
+       mia::C3DFVector neighbor_sum(const mia::C3DFVector *v, int dx, int dxy) const;
+
+       // weights of the second derivatives along x, y, and z per component
+       mia::C3DFVector m_wxx, m_wyy, m_wzz;
+       float m_b_4;
+       float m_epsilon;
+       size_t m_max_iter;
+       unsigned m_pre_smooth;
+       unsigned m_post_smooth;
+       unsigned m_max_levels;
+       mutable unsigned m_levels;
+};
+
+NS_END
+
+#endif
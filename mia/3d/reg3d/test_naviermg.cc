@@ -0,0 +1,124 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <mia/internal/autotest.hh>
+#include <mia/3d/reg3d/naviermg.hh>
+#include <cmath>
+
+using namespace std;
+using namespace mia;
+using namespace naviermg_regmodel;
+
+static C3DFVectorfield create_force(const C3DBounds& size)
+{
+       C3DFVectorfield b(size);
+       const C3DFVector center(size.x / 2.0f, size.y / 2.0f, size.z / 2.0f);
+       auto ib = b.begin_range(C3DBounds::_1, size - C3DBounds::_1);
+       auto eb = b.end_range(C3DBounds::_1, size - C3DBounds::_1);
+
+       for (; ib != eb; ++ib) {
+              const C3DFVector d = C3DFVector(ib.pos()) - center;
+              const float w = exp(-d.norm2() / 16.0f);
+              *ib = C3DFVector(w * d.y, -w * d.x, 0.5f * w * d.z) * 0.1f;
+       }
+
+       return b;
+}
+
+BOOST_AUTO_TEST_CASE( test_naviermg_converges )
+{
+       const C3DBounds size(17, 20, 15);
+       const C3DFVectorfield b = create_force(size);
+       C3DNavierMultigridRegModel model(1.0, 1.0, 20, 1e-6, 2, 2, 8);
+       C3DFVectorfield v(size);
+       const double start = model.residuum(b, v);
+       BOOST_REQUIRE(start > 0.0);
+       model.solve(b, v);
+       BOOST_CHECK_LT(model.residuum(b, v) / start, 1e-6);
+       // the boundary is not touched
+       BOOST_CHECK_EQUAL(v(0, 5, 5), C3DFVector::_0);
+       BOOST_CHECK_EQUAL(v(5, 5, 14), C3DFVector::_0);
+}
+
+BOOST_AUTO_TEST_CASE( test_naviermg_beats_gauss_seidel )
+{
+       const C3DBounds size(33, 33, 33);
+       const C3DFVectorfield b = create_force(size);
+       C3DNavierMultigridRegModel multigrid(1.0, 2.0, 5, 0.0, 2, 2, 8);
+       C3DNavierMultigridRegModel gauss_seidel(1.0, 2.0, 5, 0.0, 2, 2, 1);
+       C3DFVectorfield vmg(size);
+       C3DFVectorfield vgs(size);
+       const double start = multigrid.residuum(b, vmg);
+       multigrid.solve(b, vmg);
+       gauss_seidel.solve(b, vgs);
+       const double rmg = multigrid.residuum(b, vmg) / start;
+       const double rgs = gauss_seidel.residuum(b, vgs) / start;
+       cvdebug() << "relative residuum after 5 iterations: multigrid=" << rmg
+                 << ", gauss-seidel=" << rgs << "\n";
+       BOOST_CHECK_LT(rmg, 1e-2);
+       BOOST_CHECK_LT(100 * rmg, rgs);
+}
+
+BOOST_AUTO_TEST_CASE( test_naviermg_zero_force )
+{
+       const C3DBounds size(9, 9, 9);
+       C3DNavierMultigridRegModel model(1.0, 1.0, 10, 1e-4, 2, 2, 8);
+       C3DFVectorfield b(size);
+       C3DFVectorfield v(size);
+       model.solve(b, v);
+
+       for (auto iv = v.begin(); iv != v.end(); ++iv)
+              BOOST_CHECK_EQUAL(*iv, C3DFVector::_0);
+}
+
+/*
+  Solve the same problem with the lexicographic SOR of the navier model and the
+  multigrid solver using the same discretization, the results must agree.
+*/
+BOOST_AUTO_TEST_CASE( test_naviermg_matches_sor )
+{
+       const C3DBounds size(17, 20, 15);
+       C3DFVectorfield b = create_force(size);
+
+       // the SOR stops when the sum of the updates is below one
+       for (auto ib = b.begin(); ib != b.end(); ++ib)
+              *ib *= 100.0f;
+
+       auto sor = C3DRegModelPluginHandler::instance().produce("navier:mu=1,lambda=1,epsilon=1e-7,iter=2000");
+       C3DNavierMultigridRegModel multigrid(1.0, 1.0, 20, 1e-7, 2, 2, 8, true);
+       C3DFVectorfield vsor(size);
+       C3DFVectorfield vmg(size);
+       const double start = multigrid.residuum(b, vmg);
+       sor->solve(b, vsor);
+       multigrid.solve(b, vmg);
+       cvdebug() << "relative residuum: multigrid=" << multigrid.residuum(b, vmg) / start
+                 << ", sor=" << multigrid.residuum(b, vsor) / start << "\n";
+       BOOST_CHECK_LT(multigrid.residuum(b, vsor) / start, 1e-4);
+       double delta = 0.0;
+       double norm = 0.0;
+
+       for (size_t i = 0; i < vmg.size(); ++i) {
+              delta += (vmg[i] - vsor[i]).norm2();
+              norm += vmg[i].norm2();
+       }
+
+       BOOST_REQUIRE(norm > 0.0);
+       BOOST_CHECK_LT(sqrt(delta / norm), 1e-4);
+}
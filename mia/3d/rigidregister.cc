@@ -23,7 +23,10 @@
 #include <mia/3d/rigidregister.hh>
 #include <mia/3d/filter.hh>
 #include <mia/3d/transformfactory.hh>
+#include <mia/3d/imagepyramid.hh>
 #include <mia/core/filter.hh>
+#include <mia/core/bufferpool.hh>
+#include <mia/core/parallel.hh>
 
 NS_MIA_BEGIN
 
@@ -48,34 +51,35 @@ private:
 class C3DRegGradientProblem: public CMinimizer::Problem
 {
 public:
-       C3DRegGradientProblem(const C3DImage& model, C3DTransformation& transf, const C3DImageCost& m_cost);
+       C3DRegGradientProblem(const C3DImage& model, const C3DImage& reference,
+                             C3DTransformation& transf, const C3DImageCost& m_cost);
 private:
        void    do_df(const CDoubleVector& x, CDoubleVector&  g);
        double  do_fdf(const CDoubleVector& x, CDoubleVector&  g);
-protected:
        double  do_f(const CDoubleVector& x);
        size_t do_size() const;
        P3DImage apply(const CDoubleVector& x);
+       double evaluate_gradient(const C3DImage& deformed, const CDoubleVector& x, CDoubleVector&  g);
+       void finite_difference_gradient(const CDoubleVector& x, CDoubleVector&  g);
+
+       struct SEvaluator {
+              P3DTransformation transf;
+              P3DImageCost cost;
+       };
+       SEvaluator *acquire_evaluator();
+       void release_evaluator(SEvaluator *evaluator);
+
        const C3DImage& m_model;
+       const C3DImage& m_reference;
        C3DTransformation& m_transf;
        const C3DImageCost& m_cost;
 
        size_t m_geval;
        size_t m_feval;
 
-};
-typedef shared_ptr<C3DRegGradientProblem> P3DGradientProblem;
-
-
-class C3DRegFakeGradientProblem: public C3DRegGradientProblem
-{
-public:
-       C3DRegFakeGradientProblem(const C3DImage& model, C3DTransformation& transf,
-                                 const C3DImageCost& m_cost);
-private:
-       void    do_df(const CDoubleVector& x, CDoubleVector&  g);
-       double  do_fdf(const CDoubleVector& x, CDoubleVector&  g);
-
+       CMutex m_evaluator_mutex;
+       vector<unique_ptr<SEvaluator>> m_evaluators;
+       vector<SEvaluator *> m_idle_evaluators;
 };
 
 class C3DRegProblem: public CMinimizer::Problem
@@ -109,6 +113,8 @@ C3DRigidRegister::~C3DRigidRegister()
 
 P3DTransformation C3DRigidRegister::run(P3DImage src, P3DImage ref) const
 {
+       // the temporary images of the cost evaluations are re-used
+       CBufferPoolScope pool_scope;
        return impl->run(src, ref);
 }
 
@@ -127,29 +133,13 @@ P3DTransformation C3DRigidRegisterImpl::run(P3DImage src, P3DImage ref) const
        assert(src);
        assert(ref);
        P3DTransformation transform;
-       int x_shift = m_mg_levels + 1;
-       int y_shift = m_mg_levels + 1;
-       int z_shift = m_mg_levels + 1;
-
-       while (x_shift && y_shift && z_shift) {
-              if (x_shift)
-                     x_shift--;
-
-              if (y_shift)
-                     y_shift--;
-
-              if (z_shift)
-                     z_shift--;
-
-              C3DBounds BlockSize(1 << x_shift, 1 << y_shift, 1 << z_shift);
-              cvinfo() << "Blocksize = " << BlockSize << "\n";
-              stringstream downscale_descr;
-              downscale_descr << "downscale:bx=" << BlockSize.x
-                              << ",by=" << BlockSize.y
-                              << ",bz=" << BlockSize.z;
-              auto downscaler = C3DFilterPluginHandler::instance().produce(downscale_descr.str().c_str());
-              auto src_scaled = x_shift && y_shift ? downscaler->filter(*src) : src;
-              auto ref_scaled = x_shift && y_shift ? downscaler->filter(*ref) : ref;
+       auto src_pyramid = C3DImagePyramid::get_shared(src, m_mg_levels + 1);
+       auto ref_pyramid = C3DImagePyramid::get_shared(ref, m_mg_levels + 1);
+
+       for (int level = m_mg_levels; level >= 0; --level) {
+              cvinfo() << "Pyramid level = " << level << "\n";
+              auto src_scaled = src_pyramid->get_level(level);
+              auto ref_scaled = ref_pyramid->get_level(level);
 
               if (transform)
                      transform = transform->upscale(ref_scaled->get_size());
@@ -161,7 +151,7 @@ P3DTransformation C3DRigidRegisterImpl::run(P3DImage src, P3DImage ref) const
               cvmsg() << "register at " << ref_scaled->get_size() << "\n";
               m_cost->set_reference(*ref_scaled);
               CMinimizer::PProblem gp = m_minimizer->has(property_gradient) ?
-                                        CMinimizer::PProblem(new C3DRegFakeGradientProblem(*src_scaled, *transform, *m_cost)) :
+                                        CMinimizer::PProblem(new C3DRegGradientProblem(*src_scaled, *ref_scaled, *transform, *m_cost)) :
                                         CMinimizer::PProblem(new C3DRegProblem(*src_scaled, *transform, *m_cost));
               m_minimizer->set_problem(gp);
               auto x = transform->get_parameters();
@@ -179,9 +169,50 @@ P3DTransformation C3DRigidRegisterImpl::run(P3DImage src, P3DImage ref) const
        return transform;
 }
 
-C3DRegGradientProblem::C3DRegGradientProblem(const C3DImage& model, C3DTransformation& transf,
-              const C3DImageCost& cost):
+/*
+  The cost function evaluates the force with respect to the deformed image, i.e. in the
+  coordinates of the reference image, but C3DTransformation::translate expects the
+  gradient with respect to the transformed coordinates. For a linear transformation with
+  the Jacobian J the latter is J^{-T} times the force, and this matrix is evaluated here.
+  Returns false if the transformation is not linear or J is singular.
+*/
+static bool get_force_mapping(const C3DTransformation& t, C3DFMatrix& mapping)
+{
+       const C3DBounds& size = t.get_size();
+       const C3DFVector step(size.x > 1 ? size.x - 1 : 1,
+                             size.y > 1 ? size.y - 1 : 1,
+                             size.z > 1 ? size.z - 1 : 1);
+       const C3DFVector origin = t(C3DFVector::_0);
+       // the columns of the Jacobian
+       const C3DFVector dx = (t(C3DFVector(step.x, 0, 0)) - origin) / step.x;
+       const C3DFVector dy = (t(C3DFVector(0, step.y, 0)) - origin) / step.y;
+       const C3DFVector dz = (t(C3DFVector(0, 0, step.z)) - origin) / step.z;
+       const C3DFVector test_points[2] = {step, 0.5f * step};
+
+       for (auto& p : test_points) {
+              const C3DFVector linear = origin + p.x * dx + p.y * dy + p.z * dz;
+
+              if ((t(p) - linear).norm() > 0.01)
+                     return false;
+       }
+
+       const C3DFVector r0(dx.x, dy.x, dz.x);
+       const C3DFVector r1(dx.y, dy.y, dz.y);
+       const C3DFVector r2(dx.z, dy.z, dz.z);
+       const C3DFVector c12 = cross(r1, r2);
+       const float det = dot(r0, c12);
+
+       if (std::fabs(det) < 1e-6)
+              return false;
+
+       mapping = C3DFMatrix(c12 / det, cross(r2, r0) / det, cross(r0, r1) / det);
+       return true;
+}
+
+C3DRegGradientProblem::C3DRegGradientProblem(const C3DImage& model, const C3DImage& reference,
+              C3DTransformation& transf, const C3DImageCost& cost):
        m_model(model),
+       m_reference(reference),
        m_transf(transf),
        m_cost(cost),
        m_geval(0),
@@ -221,9 +252,7 @@ void    C3DRegGradientProblem::do_df(const CDoubleVector& x, CDoubleVector&  g)
 {
        ++m_geval;
        P3DImage temp = apply(x);
-       C3DFVectorfield gradient(m_transf.get_size());
-       m_cost.evaluate_force(*temp, gradient);
-       m_transf.translate(gradient, g);
+       evaluate_gradient(*temp, x, g);
 }
 
 double  C3DRegGradientProblem::do_fdf(const CDoubleVector& x, CDoubleVector&  g)
@@ -231,42 +260,89 @@ double  C3DRegGradientProblem::do_fdf(const CDoubleVector& x, CDoubleVector&  g)
        ++m_geval;
        ++m_feval;
        P3DImage temp = apply(x);
+       const double value = evaluate_gradient(*temp, x, g);
+       cvmsg() << "Cost(f=" << m_feval << ",g=" << m_geval << ") = " << value << "\n";
+       return value;
+}
+
+double C3DRegGradientProblem::evaluate_gradient(const C3DImage& deformed, const CDoubleVector& x,
+              CDoubleVector&  g)
+{
+       C3DFMatrix mapping;
+
+       if (!get_force_mapping(m_transf, mapping)) {
+              cvinfo() << "Transformation is not linear, use finite differences\n";
+              finite_difference_gradient(x, g);
+              return m_cost.value(deformed);
+       }
+
        C3DFVectorfield gradient(m_transf.get_size());
-       const double value = m_cost.evaluate_force(*temp, gradient);
+       const double value = m_cost.evaluate_force(deformed, gradient);
+       auto map_slices = [&gradient, &mapping](const C1DParallelRange & range) {
+              for (auto z = range.begin(); z != range.end(); ++z)
+                     transform(gradient.begin_at(0, 0, z), gradient.begin_at(0, 0, z + 1),
+                               gradient.begin_at(0, 0, z),
+              [&mapping](const C3DFVector & f) {
+                     return mapping * f;
+              });
+       };
+       pfor(C1DParallelRange(0, gradient.get_size().z, 1), map_slices);
        m_transf.translate(gradient, g);
-       cvmsg() << "Cost(f=" << m_feval << ",g=" << m_geval << ") = " << value << "\n";
        return value;
 }
 
-C3DRegFakeGradientProblem::C3DRegFakeGradientProblem(const C3DImage& model,
-              C3DTransformation& transf, const C3DImageCost& m_cost):
-       C3DRegGradientProblem(model, transf,  m_cost)
+C3DRegGradientProblem::SEvaluator *C3DRegGradientProblem::acquire_evaluator()
 {
+       CScopedLock lock(m_evaluator_mutex);
+
+       if (m_idle_evaluators.empty()) {
+              // the cost functions are not thread safe, hence each evaluator gets its own copy
+              unique_ptr<SEvaluator> evaluator(new SEvaluator);
+              evaluator->transf.reset(m_transf.clone());
+              evaluator->cost = C3DImageCostPluginHandler::instance().produce(m_cost.get_init_string());
+              evaluator->cost->set_reference(m_reference);
+              m_idle_evaluators.push_back(evaluator.get());
+              m_evaluators.push_back(move(evaluator));
+       }
+
+       auto result = m_idle_evaluators.back();
+       m_idle_evaluators.pop_back();
+       return result;
+}
+
+void C3DRegGradientProblem::release_evaluator(SEvaluator *evaluator)
+{
+       CScopedLock lock(m_evaluator_mutex);
+       m_idle_evaluators.push_back(evaluator);
 }
 
-void    C3DRegFakeGradientProblem::do_df(const CDoubleVector& x, CDoubleVector&  g)
+void C3DRegGradientProblem::finite_difference_gradient(const CDoubleVector& x, CDoubleVector&  g)
 {
-       CDoubleVector x_tmp(x.size());
-       copy(x.begin(), x.end(), x_tmp.begin());
+       // central differences, the cost values at x + delta e_i and x - delta e_i are
+       // stored in cost_values[2i] and cost_values[2i+1] respectively
+       vector<double> cost_values(2 * g.size());
+       auto evaluate = [this, &x, &cost_values](const C1DParallelRange & range) {
+              auto evaluator = acquire_evaluator();
+              CDoubleVector x_tmp(x.size());
+
+              for (auto k = range.begin(); k != range.end(); ++k) {
+                     copy(x.begin(), x.end(), x_tmp.begin());
+                     x_tmp[k / 2] += (k & 1) ? -0.01 : 0.01;
+                     evaluator->transf->set_parameters(x_tmp);
+                     P3DImage temp = (*evaluator->transf)(m_model);
+                     cost_values[k] = evaluator->cost->value(*temp);
+              }
+
+              release_evaluator(evaluator);
+       };
+       pfor(C1DParallelRange(0, cost_values.size(), 1), evaluate);
 
        for (size_t i = 0; i < g.size(); ++i) {
-              x_tmp[i] += 0.01;
-              double cost_p = do_f(x_tmp);
-              x_tmp[i] -= 0.02;
-              double cost_m = do_f(x_tmp);
-              x_tmp[i] += 0.01;
-              g[i] = (cost_p - cost_m) * 50.0;
+              g[i] = (cost_values[2 * i] - cost_values[2 * i + 1]) * 50.0;
               cvinfo() << "g[" << i << "] = " << g[i] << "\n";
        }
 }
 
-double  C3DRegFakeGradientProblem::do_fdf(const CDoubleVector& x, CDoubleVector&  g)
-{
-       double cost_value = do_f(x);
-       do_df(x, g);
-       return cost_value;
-}
-
 C3DRegProblem::C3DRegProblem(const C3DImage& model, C3DTransformation& transf,
                              const C3DImageCost& cost):
        m_model(model),
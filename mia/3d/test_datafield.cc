@@ -24,6 +24,7 @@
 
 
 #include <mia/core.hh>
+#include <mia/core/bufferpool.hh>
 #include <mia/3d/datafield.hh>
 
 NS_MIA_USE
@@ -206,6 +207,50 @@ BOOST_AUTO_TEST_CASE( test_3ddatafield_get_put_yz )
                      BOOST_CHECK(plane_yz(y, z) == data(1, y, z));
 }
 
+BOOST_AUTO_TEST_CASE( test_3ddatafield_pooled_storage )
+{
+       C3DBounds size(64, 32, 16);
+       CBufferPoolScope::reset_statistics();
+       {
+              CBufferPoolScope scope;
+              const float *storage = nullptr;
+              {
+                     C3DFDatafield a(size);
+                     fill(a.begin(), a.end(), 1.0f);
+                     storage = &a[0];
+              }
+              // the storage of the released field is re-used and cleared
+              C3DFDatafield b(size);
+              BOOST_CHECK_EQUAL(&b[0], storage);
+              BOOST_CHECK(all_of(b.begin(), b.end(), [](float x) {
+                     return x == 0.0f;
+              }));
+              // a copy is drawn from the pool too
+              C3DFDatafield c(b);
+              BOOST_CHECK(equal(b.begin(), b.end(), c.begin()));
+              auto stats = CBufferPoolScope::get_statistics();
+              BOOST_CHECK_EQUAL(stats.requests, 3u);
+              BOOST_CHECK_EQUAL(stats.hits, 1u);
+              BOOST_CHECK_GE(stats.peak_bytes_in_use, 2 * size.product() * sizeof(float));
+       }
+       BOOST_CHECK_EQUAL(CBufferPoolScope::get_statistics().bytes_cached, 0u);
+}
+
+BOOST_AUTO_TEST_CASE( test_3ddatafield_move_leaves_consistent_source )
+{
+       C3DFDatafield a(C3DBounds(5, 4, 3));
+       C3DFDatafield b(C3DBounds(3, 2, 2));
+       b = std::move(a);
+       BOOST_CHECK_EQUAL(b.get_size(), C3DBounds(5, 4, 3));
+       BOOST_CHECK_EQUAL(b.size(), 60u);
+       // the moved-from field holds the former data of the target
+       BOOST_CHECK_EQUAL(a.get_size(), C3DBounds(3, 2, 2));
+       BOOST_CHECK_EQUAL(a.size(), 12u);
+       C3DFDatafield c(std::move(b));
+       BOOST_CHECK_EQUAL(c.size(), 60u);
+       BOOST_CHECK_EQUAL(b.get_size(), C3DBounds(0, 0, 0));
+       BOOST_CHECK_EQUAL(b.size(), 0u);
+}
 
 // this test should only be run on a machine with more than 4GB
 // of working memory, so for now it is disabled
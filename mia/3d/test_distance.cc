@@ -149,6 +149,157 @@ BOOST_FIXTURE_TEST_CASE( test_distance_per_slice3d_func, Distance3DFuncFixture )
        }
 }
 
+BOOST_FIXTURE_TEST_CASE( test_distance_per_slice3d_streaming, Distance3DInfFixture )
+{
+       C3DDistance slice_based_distance(true);
+       C2DFImage slice(C2DBounds(4, 4));
+
+       for (int i = 0; i < 4; ++i) {
+              distance_transform_prepare(&src_init[16 * i], &src_init[16 * (i + 1)], slice.begin(), true);
+              slice_based_distance.push_slice(i, slice);
+       }
+
+       int k = 0;
+
+       for (int z = 0; z < 4; ++z)
+              for (int y = 0; y < 4; ++y)
+                     for (int x = 0; x < 4; ++x, ++k) {
+                            C3DFVector p(x, y, z);
+                            BOOST_CHECK_CLOSE(slice_based_distance.get_distance_at(p), sqrt(test_val[k]), 0.1);
+                     }
+}
+
+/*
+  Add the slices and request the distances of the slice that lies 'window' slices
+  behind the last added one. All distances up to the window size must be exact,
+  and this must also hold after the passed parts of the columns were released.
+*/
+BOOST_AUTO_TEST_CASE( test_distance_streaming_interleaved )
+{
+       const C3DBounds size(8, 6, 160);
+       const int window = 4;
+       C3DBitImage mask(size);
+       auto im = mask.begin_range(C3DBounds::_0, size);
+
+       for (; im != mask.end_range(C3DBounds::_0, size); ++im) {
+              auto p = im.pos();
+              *im = (p.x * 7 + p.y * 13 + p.z * 5) % 4 == 0 && p.z % 11 != 3;
+       }
+
+       C3DFImage full(size);
+       distance_transform_prepare(mask.begin(), mask.end(), full.begin(), true);
+       distance_transform_inplace(full, C3DFVector::_1);
+       C3DDistance slice_stream(true);
+       C3DDistance point_stream(true);
+       C2DFImage slice(C2DBounds(size.x, size.y));
+       auto check_slice = [&](int z) {
+              auto out_slice = slice_stream.get_distance_slice(z);
+              auto e = full.begin_at(0, 0, z);
+
+              for (auto i = out_slice.begin(); i != out_slice.end(); ++i, ++e)
+                     if (*e <= window * window)
+                            BOOST_CHECK_CLOSE(*i + 1.0f, *e + 1.0f, 0.1);
+       };
+       auto check_points = [&](int z) {
+              for (unsigned y = 0; y < size.y; ++y)
+                     for (unsigned x = 0; x < size.x; ++x) {
+                            const float e = full(x, y, z);
+
+                            if (e <= window * window)
+                                   BOOST_CHECK_CLOSE(point_stream.get_distance_at(C3DFVector(x, y, z)) + 1.0f,
+                                                     sqrtf(e) + 1.0f, 0.1);
+                     }
+       };
+
+       for (unsigned z = 0; z < size.z; ++z) {
+              auto m = mask.begin_at(0, 0, z);
+              distance_transform_prepare(m, m + slice.size(), slice.begin(), true);
+              slice_stream.push_slice(z, slice);
+              point_stream.push_slice(z, slice);
+
+              if (z >= window) {
+                     check_slice(z - window);
+                     check_points(z - window);
+              }
+       }
+
+       for (unsigned z = size.z - window; z < size.z; ++z) {
+              check_slice(z);
+              check_points(z);
+       }
+}
+
+/*
+  Every slice adds a parabola to each column that stays in the lower envelope. In
+  streaming mode the parabolas that lie below the requested slices are released, so
+  that their number depends on the distance between pushing and requesting, and not
+  on the number of slices. Without streaming all parabolas are kept, and the
+  requests can come in any order.
+*/
+BOOST_AUTO_TEST_CASE( test_distance_streaming_bounded_parabolas )
+{
+       const C2DBounds size(8, 8);
+       const int n_slices = 200;
+       const int window = 4;
+       C2DFImage slice(size);
+       std::fill(slice.begin(), slice.end(), 0.0f);
+       C3DDistance stream(true);
+       C3DDistance full;
+       size_t max_count = 0;
+
+       for (int z = 0; z < n_slices; ++z) {
+              stream.push_slice(z, slice);
+              full.push_slice(z, slice);
+
+              if (z >= window)
+                     stream.get_distance_slice(z - window);
+
+              max_count = std::max(max_count, stream.get_parabola_count());
+       }
+
+       // the skipped parabolas are only erased once they make up the larger part of a column
+       BOOST_CHECK_LE(max_count, size.product() * (2 * window + 20));
+       BOOST_CHECK_EQUAL(full.get_parabola_count(), size.product() * n_slices);
+
+       for (int z = n_slices - 1; z >= 0; z -= 7)
+              BOOST_CHECK_EQUAL(full.get_distance_at(C3DFVector(3, 4, z + 0.25)), 0.25f);
+}
+
+BOOST_AUTO_TEST_CASE( test_distance_full3d_spacing )
+{
+       C3DFImage src_img(C3DBounds(3, 3, 3));
+       const bool mask[27] = {
+              0, 0, 0,  0, 0, 0,  0, 0, 0,
+              0, 0, 0,  0, 1, 0,  0, 0, 0,
+              0, 0, 0,  0, 0, 0,  0, 0, 0
+       };
+       distance_transform_prepare(&mask[0], &mask[27], src_img.begin(), true);
+       distance_transform_inplace(src_img, C3DFVector(1, 2, 3));
+
+       auto i = src_img.begin();
+
+       for (int z = 0; z < 3; ++z)
+              for (int y = 0; y < 3; ++y)
+                     for (int x = 0; x < 3; ++x, ++i) {
+                            const float dx = x - 1;
+                            const float dy = 2 * (y - 1);
+                            const float dz = 3 * (z - 1);
+                            BOOST_CHECK_CLOSE(*i + 1.0f, dx * dx + dy * dy + dz * dz + 1.0f, 0.1);
+                     }
+}
+
+BOOST_AUTO_TEST_CASE( test_signed_distance )
+{
+       C3DBitImage mask(C3DBounds(7, 1, 1));
+       const bool init[7] = {0, 0, 1, 1, 1, 0, 0};
+       copy(init, init + 7, mask.begin());
+       const float test_val[7] = {4, 2, -2, -4, -2, 2, 4};
+       auto result = signed_distance_transform(mask, C3DFVector(2, 1, 1));
+
+       for (int x = 0; x < 7; ++x)
+              BOOST_CHECK_CLOSE(result(x, 0, 0), test_val[x], 0.1);
+}
+
 const bool Distance3DInfFixture::src_init[] = {
        1, 0, 0, 0,   0, 0, 0, 0,   0, 0, 0, 0,  0, 0, 0, 0,
        0, 0, 0, 0,   0, 0, 0, 0,   0, 0, 1, 0,  0, 0, 0, 0,
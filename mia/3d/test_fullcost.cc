@@ -175,6 +175,54 @@ BOOST_AUTO_TEST_CASE( test_multicost_property )
        BOOST_CHECK(costs.has(test_prop));
 }
 
+class C3DDeformingFullCostMock: public C3DFullCostMock
+{
+public:
+       C3DDeformingFullCostMock(const std::string& key, P3DImage src);
+       mutable P3DImage last_deformed;
+private:
+       double do_evaluate(const C3DTransformation& t, CDoubleVector& gradient) const;
+       std::string m_key;
+       P3DImage m_src;
+};
+
+C3DDeformingFullCostMock::C3DDeformingFullCostMock(const std::string& key, P3DImage src):
+       C3DFullCostMock(1.0, 1.0, 0.0, 0.0, 0.0),
+       m_key(key),
+       m_src(src)
+{
+}
+
+double C3DDeformingFullCostMock::do_evaluate(const C3DTransformation& t, CDoubleVector& /*gradient*/) const
+{
+       last_deformed = transform_data(m_key, t, *m_src);
+       return 1.0;
+}
+
+BOOST_AUTO_TEST_CASE( test_multicost_fused_shares_deformed_input )
+{
+       const C3DBounds size(2, 1, 1);
+       P3DImage src(new C3DFImage(size));
+       P3DImage other(new C3DFImage(size));
+       auto c1 = new C3DDeformingFullCostMock("src", src);
+       auto c2 = new C3DDeformingFullCostMock("src", src);
+       auto c3 = new C3DDeformingFullCostMock("other", other);
+       C3DFullCostList costs;
+       costs.push(P3DFullCost(c1));
+       costs.push(P3DFullCost(c2));
+       costs.push(P3DFullCost(c3));
+       C3DTransformMock t(size, C3DInterpolatorFactory("bspline:d=3", "mirror"));
+       CDoubleVector gradient(t.degrees_of_freedom());
+       costs.set_size(t.get_size());
+       BOOST_CHECK_CLOSE(costs.evaluate(t, gradient), 3.0, 0.1);
+       BOOST_CHECK(c1->last_deformed);
+       BOOST_CHECK_EQUAL(c1->last_deformed, c2->last_deformed);
+       BOOST_CHECK(c1->last_deformed != c3->last_deformed);
+       costs.set_fused_evaluation(false);
+       BOOST_CHECK_CLOSE(costs.evaluate(t, gradient), 3.0, 0.1);
+       BOOST_CHECK(c1->last_deformed != c2->last_deformed);
+}
+
 class PrepareFullcostTests
 {
 public:
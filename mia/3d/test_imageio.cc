@@ -114,3 +114,95 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(test_volume_io_analyze, T, AnalyzePixelTypes::type
 {
        store_and_load<T>("hdr");
 }
+
+static void unlink_analyze(const string& filename)
+{
+       unlink(filename.c_str());
+       unlink((filename.substr(0, filename.length() - 3) + "img").c_str());
+}
+
+BOOST_AUTO_TEST_CASE( test_analyze_slice_io )
+{
+       const string filename("test3dio-slices.hdr");
+       const C3DBounds size(3, 4, 7);
+       C3DSSImage image(size);
+       short v = -100;
+
+       for (auto i = image.begin(); i != image.end(); ++i, v += 7)
+              *i = v;
+
+       image.set_voxel_size(C3DFVector(1, 2, 3));
+       image.set_orientation(ior_coronal);
+       auto io = get_image3d_slice_io(filename);
+       BOOST_REQUIRE(io);
+       // write the image in parts of different depth
+       auto writer = io->open_slice_writer(filename, size, image);
+
+       for (auto range : vector<pair<unsigned, unsigned>> {{0, 2}, {2, 5}, {5, 7}}) {
+              C3DSSImage slices(C3DBounds(size.x, size.y, range.second - range.first), image);
+              copy(image.begin_at(0, 0, range.first), image.begin_at(0, 0, range.second), slices.begin());
+              writer->write_slices(slices);
+       }
+
+       writer->close();
+       auto loaded = load_image3d(filename);
+       const C3DSSImage& ss_loaded = dynamic_cast<const C3DSSImage&>(*loaded);
+       BOOST_CHECK_EQUAL(ss_loaded.get_size(), size);
+       BOOST_CHECK_EQUAL(ss_loaded.get_voxel_size(), image.get_voxel_size());
+       BOOST_CHECK_EQUAL(ss_loaded.get_orientation(), ior_coronal);
+       BOOST_CHECK(equal(image.begin(), image.end(), ss_loaded.begin()));
+       // read it back in two parts
+       auto reader = io->open_slice_reader(filename);
+       BOOST_REQUIRE(reader);
+       BOOST_CHECK_EQUAL(reader->get_size(), size);
+       auto head = reader->read_slices(4);
+       auto tail = reader->read_slices(3);
+       const C3DSSImage& ss_head = dynamic_cast<const C3DSSImage&>(*head);
+       const C3DSSImage& ss_tail = dynamic_cast<const C3DSSImage&>(*tail);
+       BOOST_CHECK_EQUAL(ss_head.get_size(), C3DBounds(size.x, size.y, 4));
+       BOOST_CHECK_EQUAL(ss_tail.get_voxel_size(), image.get_voxel_size());
+       BOOST_CHECK_EQUAL(ss_tail.get_orientation(), ior_coronal);
+       BOOST_CHECK(equal(ss_head.begin(), ss_head.end(), image.begin()));
+       BOOST_CHECK(equal(ss_tail.begin(), ss_tail.end(), image.begin_at(0, 0, 4)));
+       BOOST_CHECK_THROW(reader->read_slices(1), runtime_error);
+       unlink_analyze(filename);
+}
+
+BOOST_AUTO_TEST_CASE( test_analyze_slice_writer_checks )
+{
+       const string filename("test3dio-slices-incomplete.hdr");
+       const C3DBounds size(3, 4, 5);
+       C3DFImage image(size);
+       auto io = get_image3d_slice_io(filename);
+       BOOST_REQUIRE(io);
+       auto writer = io->open_slice_writer(filename, size, image);
+       C3DFImage slices(C3DBounds(size.x, size.y, 3));
+       writer->write_slices(slices);
+       // wrong pixel type
+       BOOST_CHECK_THROW(writer->write_slices(C3DSSImage(C3DBounds(size.x, size.y, 1))), invalid_argument);
+       // too many slices
+       BOOST_CHECK_THROW(writer->write_slices(slices), invalid_argument);
+       // two slices are missing
+       BOOST_CHECK_THROW(writer->close(), runtime_error);
+       unlink_analyze(filename);
+}
+
+BOOST_AUTO_TEST_CASE( test_analyze_slice_reader_needs_single_image )
+{
+       const string filename("test3dio-two-images.hdr");
+       C3DImageVector images;
+       images.push_back(P3DImage(new C3DUBImage(C3DBounds(3, 4, 5))));
+       images.push_back(P3DImage(new C3DUBImage(C3DBounds(3, 4, 5))));
+       BOOST_REQUIRE(C3DImageIOPluginHandler::instance().save(filename, images));
+       BOOST_CHECK_EQUAL(C3DImageIOPluginHandler::instance().load(filename)->size(), 2u);
+       auto io = get_image3d_slice_io(filename);
+       BOOST_REQUIRE(io);
+       BOOST_CHECK(!io->open_slice_reader(filename));
+       unlink_analyze(filename);
+}
+
+BOOST_AUTO_TEST_CASE( test_slice_io_not_supported )
+{
+       BOOST_CHECK(!get_image3d_slice_io("test3dio.inr"));
+       BOOST_CHECK(!get_image3d_slice_io("test3dio.unknown-suffix"));
+}
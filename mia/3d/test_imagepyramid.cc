@@ -0,0 +1,92 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <mia/internal/autotest.hh>
+#include <mia/3d/imagepyramid.hh>
+
+NS_MIA_USE
+using namespace std;
+
+BOOST_AUTO_TEST_CASE( test_pyramid_level_sizes )
+{
+       P3DImage image(new C3DFImage(C3DBounds(33, 20, 9)));
+       image->set_voxel_size(C3DFVector(1.0, 2.0, 3.0));
+       C3DImagePyramid pyramid(image, 4);
+       BOOST_CHECK_EQUAL(pyramid.get_levels(), 4u);
+       BOOST_CHECK(pyramid.get_level(0) == image);
+       BOOST_CHECK_EQUAL(pyramid.get_level(1)->get_size(), C3DBounds(16, 10, 4));
+       BOOST_CHECK_EQUAL(pyramid.get_level(2)->get_size(), C3DBounds(8, 5, 2));
+       BOOST_CHECK_EQUAL(pyramid.get_level(3)->get_size(), C3DBounds(4, 2, 1));
+       // further levels are created on request, and a size of one is kept
+       BOOST_CHECK_EQUAL(pyramid.get_level(4)->get_size(), C3DBounds(2, 1, 1));
+       BOOST_CHECK_EQUAL(pyramid.get_levels(), 5u);
+       BOOST_CHECK_EQUAL(pyramid.get_level(1)->get_voxel_size(), C3DFVector(33.0f / 16.0f, 4.0, 27.0f / 4.0f));
+       BOOST_CHECK(pyramid.get_image(C3DBounds(8, 5, 2)) == pyramid.get_level(2));
+       BOOST_CHECK(pyramid.get_image(C3DBounds(33, 20, 9)) == image);
+}
+
+BOOST_AUTO_TEST_CASE( test_pyramid_reduce_values )
+{
+       C3DFImage image(C3DBounds(8, 2, 2));
+       auto i = image.begin();
+
+       for (size_t z = 0; z < 2; ++z)
+              for (size_t y = 0; y < 2; ++y)
+                     for (size_t x = 0; x < 8; ++x, ++i)
+                            *i = x + 8 * z;
+
+       auto reduced = C3DImagePyramid::reduce(image);
+       BOOST_REQUIRE_EQUAL(reduced->get_size(), C3DBounds(4, 1, 1));
+       const C3DFImage& r = dynamic_cast<const C3DFImage&>(*reduced);
+       // along x the kernel [1 3 3 1]/8 is applied with clamped boundaries,
+       // along y and z the two slices get the weights 1/2
+       const float expect[4] = {0.625f + 4, 2.5f + 4, 4.5f + 4, 6.375f + 4};
+
+       for (size_t x = 0; x < 4; ++x)
+              BOOST_CHECK_CLOSE(r(x, 0, 0), expect[x], 0.0001);
+}
+
+BOOST_AUTO_TEST_CASE( test_pyramid_reduce_integer_constant )
+{
+       C3DUBImage image(C3DBounds(9, 7, 5));
+       fill(image.begin(), image.end(), 17);
+       auto reduced = C3DImagePyramid::reduce(image);
+       BOOST_REQUIRE_EQUAL(reduced->get_size(), C3DBounds(4, 3, 2));
+       BOOST_REQUIRE_EQUAL(reduced->get_pixel_type(), it_ubyte);
+       const C3DUBImage& r = dynamic_cast<const C3DUBImage&>(*reduced);
+
+       for (auto v = r.begin(); v != r.end(); ++v)
+              BOOST_CHECK_EQUAL(*v, 17);
+}
+
+BOOST_AUTO_TEST_CASE( test_pyramid_shared )
+{
+       P3DImage image(new C3DFImage(C3DBounds(16, 16, 16)));
+       P3DImage other(new C3DFImage(C3DBounds(16, 16, 16)));
+       auto pyramid = C3DImagePyramid::get_shared(image, 2);
+       BOOST_CHECK_EQUAL(pyramid->get_levels(), 2u);
+       auto same = C3DImagePyramid::get_shared(image);
+       BOOST_CHECK(same == pyramid);
+       BOOST_CHECK(same->get_image(C3DBounds(8, 8, 8)) == pyramid->get_level(1));
+       // requesting more levels extends the shared pyramid
+       C3DImagePyramid::get_shared(image, 3);
+       BOOST_CHECK_EQUAL(pyramid->get_levels(), 3u);
+       BOOST_CHECK(C3DImagePyramid::get_shared(other) != pyramid);
+}
@@ -353,3 +353,46 @@ BOOST_AUTO_TEST_CASE_TEMPLATE( test_interpolator_kernels, T, test_types )
        test_type<T, bspline0>();
        test_type<T, omomsspl3>();
 }
+
+template <typename T>
+void test_batch_interpolation(const char *kernel_descr)
+{
+       const C3DBounds size(13, 11, 12);
+       T3DDatafield<T> data(size);
+       auto i = data.begin();
+
+       for (size_t z = 0; z < size.z; ++z)
+              for (size_t y = 0; y < size.y; ++y)
+                     for (size_t x = 0; x < size.x; ++x, ++i)
+                            *i = static_cast<T>((x * 7 + y * 13 + z * 5) % 23 + 0.25 * ((x * y) % 5));
+
+       auto kernel = produce_spline_kernel(kernel_descr);
+       T3DConvoluteInterpolator<T>  src(data, kernel);
+       auto point_cache = src.create_cache();
+       auto batch_cache = src.create_cache();
+       vector<C3DFVector> locations(2 * size.x + 3);
+       vector<T> batch_values(locations.size());
+
+       for (size_t z = 0; z < size.z; ++z)
+              for (size_t y = 0; y < size.y; ++y) {
+                     // also cover locations outside the domain and rows with changing y and z
+                     for (size_t x = 0; x < locations.size(); ++x)
+                            locations[x] = C3DFVector(0.5f * x - 1.3f,
+                                                      y + 0.3f * sin(0.7f * x),
+                                                      (x & 4) ? z + 0.21f : z - 0.37f);
+
+                     src(locations, batch_values, batch_cache);
+
+                     for (size_t x = 0; x < locations.size(); ++x)
+                            BOOST_CHECK_EQUAL(batch_values[x], src(locations[x], point_cache));
+              }
+}
+
+BOOST_AUTO_TEST_CASE( test_batch_interpolation_equals_pointwise )
+{
+       for (auto k : interpolator_kernels) {
+              test_batch_interpolation<float>(k);
+              test_batch_interpolation<double>(k);
+              test_batch_interpolation<uint8_t>(k);
+       }
+}
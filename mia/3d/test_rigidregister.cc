@@ -150,6 +150,18 @@ BOOST_FIXTURE_TEST_CASE( test_rigid_simplex, RigidRegisterFixture )
        run(*transformation, "gsl:opt=simplex,step=1.0", 16.0);
 }
 
+BOOST_FIXTURE_TEST_CASE( test_rigidreg_translate_gdsq, RigidRegisterFixture )
+{
+       auto tr_creator = C3DTransformCreatorHandler::instance().produce("translate");
+       auto transformation = tr_creator->create(size);
+       auto params = transformation->get_parameters();
+       params[0] = 1.0;
+       params[1] = 1.0;
+       params[2] = 2.0;
+       transformation->set_parameters(params);
+       run(*transformation, "gdsq:maxiter=400", 1.0);
+}
+
 #ifdef HAVE_NLOPT
 
 BOOST_FIXTURE_TEST_CASE( test_rigidreg_translate_gd, RigidRegisterFixture )
@@ -24,6 +24,7 @@
 #include <mia/3d/transform.hh>
 #include <mia/3d/deformer.hh>
 #include <mia/core/threadedmsg.hh>
+#include <mia/core/profiling.hh>
 
 
 NS_MIA_BEGIN
@@ -38,6 +39,18 @@ void C3DTransformation::reinit() const
 {
 }
 
+void C3DTransformation::translate_sparse(const std::vector<size_t>& indices,
+                const std::vector<C3DFVector>& gradient, CDoubleVector& params) const
+{
+       assert(indices.size() == gradient.size());
+       C3DFVectorfield field(get_size());
+
+       for (size_t i = 0; i < indices.size(); ++i)
+              field[indices[i]] += gradient[i];
+
+       translate(field, params);
+}
+
 void C3DTransformation::set_creator_string(const std::string& s)
 {
        m_creator_string = s;
@@ -319,6 +332,7 @@ private:
 
 P3DImage C3DTransformation::do_transform(const C3DImage& input, const C3DInterpolatorFactory& ipf) const
 {
+       MIA_PROFILE_SCOPE("transform", get_creator_string().c_str());
        return mia::filter(F3DTransform(ipf, *this), input);
 }
 
@@ -344,11 +358,16 @@ void F3DTransformer<T>::operator() ( const C1DParallelRange& range ) const
        cvdebug() << "range = " << begin << " - " << end << "\n";
        auto ti = trans.begin_range(begin, end);
        auto te = trans.end_range(begin, end);
+       // interpolate row-wise to make use of the batched interpolator evaluation
+       std::vector<C3DFVector> locations(result.get_size().x);
+       std::vector<T> values(result.get_size().x);
 
        while (ti != te) {
-              *r = interp(*ti, cache);
-              ++ti;
-              ++r;
+              for (auto il = locations.begin(); il != locations.end(); ++il, ++ti)
+                     *il = *ti;
+
+              interp(locations, values, cache);
+              r = std::copy(values.begin(), values.end(), r);
        }
 }
 
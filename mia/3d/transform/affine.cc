@@ -21,6 +21,7 @@
 #include <fstream>
 #include <cmath>
 #include <mia/core/msgstream.hh>
+#include <mia/core/parallel.hh>
 #include <mia/3d/transformfactory.hh>
 
 #include <mia/3d/transform/affine.hh>
@@ -205,28 +206,74 @@ float C3DAffineTransformation::get_jacobian(const C3DFVectorfield& /*v*/, float
 
 void C3DAffineTransformation::translate(const C3DFVectorfield& gradient, CDoubleVector& params) const
 {
+       typedef vector<double> dvect;
        assert(gradient.get_size() == m_size);
        assert(params.size() == degrees_of_freedom());
-       vector<double> r(params.size(), 0.0);
-       auto g = gradient.begin();
-
-       for (size_t z = 0; z < m_size.z; ++z) {
-              for (size_t y = 0; y < m_size.y; ++y) {
-                     for (size_t x = 0; x < m_size.x; ++x, ++g) {
-                            r[0] += x * g->x;
-                            r[1] += y * g->x;
-                            r[2] += z * g->x;
-                            r[3] += g->x;
-                            r[4] += x * g->y;
-                            r[5] += y * g->y;
-                            r[6] += z * g->y;
-                            r[7] += g->y;
-                            r[8]  += x * g->z;
-                            r[9]  += y * g->z;
-                            r[10] += z * g->z;
-                            r[11] += g->z;
+       auto sumslice = [&gradient, this]
+       (const C1DParallelRange & range, dvect r)->dvect{
+              for (auto z = range.begin(); z != range.end(); ++z)
+              {
+                     auto g = gradient.begin_at(0, 0, z);
+
+                     for (size_t y = 0; y < m_size.y; ++y) {
+                            for (size_t x = 0; x < m_size.x; ++x, ++g) {
+                                   r[0] += x * g->x;
+                                   r[1] += y * g->x;
+                                   r[2] += z * g->x;
+                                   r[3] += g->x;
+                                   r[4] += x * g->y;
+                                   r[5] += y * g->y;
+                                   r[6] += z * g->y;
+                                   r[7] += g->y;
+                                   r[8]  += x * g->z;
+                                   r[9]  += y * g->z;
+                                   r[10] += z * g->z;
+                                   r[11] += g->z;
+                            }
                      }
               }
+
+              return r;
+       };
+       auto sum_parts = [] (const dvect & a, const dvect & b) -> dvect {
+              dvect result(a.size());
+              std::transform(a.begin(), a.end(), b.begin(), result.begin(),
+                             [](double x, double y)
+              {
+                     return x + y;
+              });
+              return result;
+       };
+       dvect init(params.size(), 0.0);
+       auto r = preduce( C1DParallelRange(0, m_size.z, 1), init, sumslice, sum_parts);
+       std::copy(r.begin(), r.end(), params.begin());
+}
+
+void C3DAffineTransformation::translate_sparse(const vector<size_t>& indices, const vector<C3DFVector>& gradient,
+              CDoubleVector& params) const
+{
+       assert(indices.size() == gradient.size());
+       assert(params.size() == degrees_of_freedom());
+       const size_t slice_size = m_size.x * m_size.y;
+       vector<double> r(params.size(), 0.0);
+
+       for (size_t i = 0; i < indices.size(); ++i) {
+              const double x = indices[i] % m_size.x;
+              const double y = (indices[i] / m_size.x) % m_size.y;
+              const double z = indices[i] / slice_size;
+              const C3DFVector& g = gradient[i];
+              r[0] += x * g.x;
+              r[1] += y * g.x;
+              r[2] += z * g.x;
+              r[3] += g.x;
+              r[4] += x * g.y;
+              r[5] += y * g.y;
+              r[6] += z * g.y;
+              r[7] += g.y;
+              r[8]  += x * g.z;
+              r[9]  += y * g.z;
+              r[10] += z * g.z;
+              r[11] += g.z;
        }
 
        std::copy(r.begin(), r.end(), params.begin());
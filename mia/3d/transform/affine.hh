@@ -70,6 +70,8 @@ public:
        virtual C3DTransformation *invert() const;
        virtual P3DTransformation do_upscale(const C3DBounds& size) const;
        virtual void translate(const C3DFVectorfield& gradient, CDoubleVector& params) const;
+       virtual void translate_sparse(const std::vector<size_t>& indices, const std::vector<C3DFVector>& gradient,
+                                     CDoubleVector& params) const;
        virtual size_t degrees_of_freedom() const;
        virtual void update(float step, const C3DFVectorfield& a);
        virtual C3DFMatrix derivative_at(const C3DFVector& x) const;
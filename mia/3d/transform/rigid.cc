@@ -290,9 +290,11 @@ void C3DRigidTransformation::translate(const C3DFVectorfield& gradient, CDoubleV
        assert(gradient.get_size() == m_size);
        assert(params.size() == degrees_of_freedom());
        assert(params.size() == 6);
+       // accumulate sum_x g(x) and the moments sum_x g_i(x) * (x - c)_j, since the
+       // derivatives of the transformation are linear in x - c
        auto sumslice = [&gradient, this]
        (const C1DParallelRange & range, dvect ls)->dvect{
-              assert(ls.size() == 6);
+              assert(ls.size() == 12);
               double fz = range.begin() - m_rot_center.z;
 
               for (auto z = range.begin(); z != range.end(); ++z, fz += 1.0)
@@ -307,9 +309,15 @@ void C3DRigidTransformation::translate(const C3DFVectorfield& gradient, CDoubleV
                                    ls[0] += g->x;
                                    ls[1] += g->y;
                                    ls[2] += g->z;
-                                   ls[3] += -fz * g->y + fy * g->z;
-                                   ls[4] += -fz * g->x + fx * g->z;
-                                   ls[5] += -fy * g->x + fx * g->y;
+                                   ls[3] += g->x * fx;
+                                   ls[4] += g->x * fy;
+                                   ls[5] += g->x * fz;
+                                   ls[6] += g->y * fx;
+                                   ls[7] += g->y * fy;
+                                   ls[8] += g->y * fz;
+                                   ls[9] += g->z * fx;
+                                   ls[10] += g->z * fy;
+                                   ls[11] += g->z * fz;
                             }
                      }
               }
@@ -325,9 +333,77 @@ void C3DRigidTransformation::translate(const C3DFVectorfield& gradient, CDoubleV
               });
               return result;
        };
-       dvect init(params.size(), 0.0);
-       auto sparams = preduce( C1DParallelRange(0, m_size.z, 1), init, sumslice, sum_parts);
-       std::copy(sparams.begin(), sparams.end(), params.begin());
+       dvect init(12, 0.0);
+       auto m = preduce( C1DParallelRange(0, m_size.z, 1), init, sumslice, sum_parts);
+       moments_to_gradient(m, params);
+}
+
+void C3DRigidTransformation::translate_sparse(const vector<size_t>& indices, const vector<C3DFVector>& gradient,
+              CDoubleVector& params) const
+{
+       assert(indices.size() == gradient.size());
+       assert(params.size() == 6);
+       const size_t slice_size = m_size.x * m_size.y;
+       vector<double> m(12, 0.0);
+
+       for (size_t i = 0; i < indices.size(); ++i) {
+              const double fx = double(indices[i] % m_size.x) - m_rot_center.x;
+              const double fy = double((indices[i] / m_size.x) % m_size.y) - m_rot_center.y;
+              const double fz = double(indices[i] / slice_size) - m_rot_center.z;
+              const C3DFVector& g = gradient[i];
+              m[0] += g.x;
+              m[1] += g.y;
+              m[2] += g.z;
+              m[3] += g.x * fx;
+              m[4] += g.x * fy;
+              m[5] += g.x * fz;
+              m[6] += g.y * fx;
+              m[7] += g.y * fy;
+              m[8] += g.y * fz;
+              m[9] += g.z * fx;
+              m[10] += g.z * fy;
+              m[11] += g.z * fz;
+       }
+
+       moments_to_gradient(m, params);
+}
+
+/*
+  m holds sum_x g(x) and the moments sum_x g_i(x) * (x - c)_j
+*/
+void C3DRigidTransformation::moments_to_gradient(const vector<double>& m, CDoubleVector& params) const
+{
+       // derivatives of the rotation matrix (see evaluate_matrix) with respect to the
+       // three rotation angles at the current parameters
+       double sx, cx, sy, cy, sz, cz;
+       sincos(m_rotation.z, &sz, &cz);
+       sincos(m_rotation.y, &sy, &cy);
+       sincos(m_rotation.x, &sx, &cx);
+       const double drx[9] = {
+              0.0, sx * sz - cx * cz * sy, cx * sz + cz * sx * sy,
+              0.0, - sx * cz - cx * sy * sz, sx * sy * sz - cx * cz,
+              0.0, cx * cy, - sx * cy
+       };
+       const double dry[9] = {
+              - sy * cz, - cy * cz * sx, - cx * cy * cz,
+              - sy * sz, - cy * sx * sz, - cx * cy * sz,
+              cy, - sx * sy, - cx * sy
+       };
+       const double drz[9] = {
+              - cy * sz, sx * sy * sz - cx * cz, sx * cz + cx * sy * sz,
+              cy * cz, - cx * sz - cz * sx * sy, sx * sz - cx * cz * sy,
+              0.0, 0.0, 0.0
+       };
+       params[0] = m[0];
+       params[1] = m[1];
+       params[2] = m[2];
+       params[3] = params[4] = params[5] = 0.0;
+
+       for (int i = 0; i < 9; ++i) {
+              params[3] += drx[i] * m[i + 3];
+              params[4] += dry[i] * m[i + 3];
+              params[5] += drz[i] * m[i + 3];
+       }
 }
 
 C3DRigidTransformation::iterator_impl::iterator_impl(const C3DBounds& pos, const C3DBounds& size,
@@ -77,6 +77,8 @@ public:
        virtual C3DTransformation *invert() const;
        virtual P3DTransformation do_upscale(const C3DBounds& size) const;
        virtual void translate(const C3DFVectorfield& gradient, CDoubleVector& params) const;
+       virtual void translate_sparse(const std::vector<size_t>& indices, const std::vector<C3DFVector>& gradient,
+                                     CDoubleVector& params) const;
        virtual size_t degrees_of_freedom() const;
        virtual void update(float step, const C3DFVectorfield& a);
        virtual C3DFMatrix derivative_at(const C3DFVector& x) const;
@@ -91,6 +93,7 @@ public:
 private:
        virtual C3DTransformation *do_clone() const;
        void evaluate_matrix() const;
+       void moments_to_gradient(const std::vector<double>& m, CDoubleVector& params) const;
 
 
        mutable std::vector<double> m_t;
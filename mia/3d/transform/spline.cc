@@ -29,7 +29,7 @@
 #include <mia/3d/transform/vectorfield.hh>
 #include <mia/3d/transformfactory.hh>
 #include <mia/3d/imageio.hh>
-#include <mia/core/index.hh>
+#include <mia/core/parallel.hh>
 
 #include <gsl/gsl_cblas.h>
 
@@ -307,9 +307,23 @@ C3DTransformation *C3DSplineTransformation::invert() const
 }
 
 
+static bool is_grid_coordinate(float x, unsigned range)
+{
+       return x >= 0 && x < range && x == floorf(x);
+}
+
 C3DFVector C3DSplineTransformation::operator () (const C3DFVector& x) const
 {
        TRACE_FUNCTION;
+
+       // at the grid points the pre-evaluated spline weights can be used
+       if (m_scales_valid && is_grid_coordinate(x.x, m_range.x) &&
+           is_grid_coordinate(x.y, m_range.y) && is_grid_coordinate(x.z, m_range.z)) {
+              const C3DBounds p(x.x, x.y, x.z);
+              const C3DBounds start(m_x_indices[p.x], m_y_indices[p.y], m_z_indices[p.z]);
+              return x - sum(start, m_x_weights[p.x], m_y_weights[p.y], m_z_weights[p.z]);
+       }
+
        return x - get_displacement_at(x);
 }
 
@@ -535,9 +549,19 @@ float C3DSplineTransformation::get_max_transform() const
 /*
   This versions of the INIT-GRID function evaluate a 3D vector field comprising the deformations
   at each grid point. Other then interpolating at each grid point on  request, this version
-  implements a separable filtering of the slices using cblas for fast addition of large ranges.
-
+  implements a separable filtering. Each pass works on independent lines or slices that are
+  distributed over the available threads, and the filtering is done in-place in the
+  intermediate fields, i.e. no additional per-call slice buffers are required.
+  The intermediate fields are kept with the transformation and only re-allocated if
+  their size changes. Accumulating passes clear their target slice first, so that each
+  slice is touched by the same thread that later works on it.
 */
+static void reuse_field(C3DFVectorfield& field, const C3DBounds& size)
+{
+       if (field.get_size() != size)
+              C3DFVectorfield(size).swap(field);
+}
+
 void C3DSplineTransformation::init_grid()const
 {
        reinit();
@@ -553,102 +577,70 @@ void C3DSplineTransformation::init_grid()const
               m_current_grid.reset(new C3DFVectorfield(m_range));
        }
 
-       const int size_xy = m_range.x * m_range.y * 3;
-       const int size_xz = m_range.x * m_coefficients.get_size().z * 3;
-       const int size_yz = m_coefficients.get_size().z * m_coefficients.get_size().y * 3;
-       const int max_data_length = max( max(size_xy, size_xz), size_yz);
-       // create the buffers
-       unsigned int nelm = m_kernel->size();
-       vector< vector<float>> in_buffer;
-
-       for (unsigned int i = 0; i < nelm; ++i)
-              in_buffer.push_back(vector<float>(max_data_length));
-
-       vector<float> out_buffer(max_data_length);
-       C3DFVectorfield tmp(C3DBounds(m_range.x,
-                                     m_coefficients.get_size().y,
-                                     m_coefficients.get_size().z));
-       CCircularIndex idxx(nelm, m_y_indices[0]);
-
-       for (size_t x = 0; x < m_range.x; ++x) {
-              auto w = m_x_weights[x];
-              int start = m_x_indices[x];
-              idxx.new_start(start);
-              // fill with slices
-              auto fill = idxx.fill();
-
-              while (fill < nelm && start + fill < m_coefficients.get_size().x) {
-                     m_coefficients.read_xslice_flat(start + fill, in_buffer[idxx.next()]);
-                     idxx.insert_one();
-                     fill = idxx.fill();
-              }
-
-              memset(&out_buffer[0], 0, size_yz * sizeof(float));
-
-              for (unsigned int i = 0; i < w.size(); ++i) {
-                     cblas_saxpy(size_yz, w[i], &in_buffer[idxx.value(i)][0], 1,
-                                 &out_buffer[0], 1);
-              }
-
-              tmp.write_xslice_flat(x, out_buffer);
-       }
-
-       C3DFVectorfield tmp2(C3DBounds(m_range.x,
-                                      m_range.y,
-                                      m_coefficients.get_size().z));
-       CCircularIndex idxy(nelm, m_y_indices[0]);
-
-       for (size_t y = 0; y < m_range.y; ++y) {
-              auto w = m_y_weights[y];
-              int start = m_y_indices[y];
-              idxy.new_start(start);
-              // fill with slices
-              auto fill = idxy.fill();
-
-              while (fill < nelm  && start + fill < m_coefficients.get_size().y) {
-                     tmp.read_yslice_flat(start + fill, in_buffer[idxy.next()]);
-                     idxy.insert_one();
-                     fill = idxy.fill();
+       const C3DBounds csize = m_coefficients.get_size();
+       // x-pass: filter the coefficient lines along x
+       C3DFVectorfield& tmp = m_grid_xpass;
+       reuse_field(tmp, C3DBounds(m_range.x, csize.y, csize.z));
+       auto filter_x = [this, &tmp, &csize](const C1DParallelRange & range) {
+              for (auto z = range.begin(); z != range.end(); ++z) {
+                     for (size_t y = 0; y < csize.y; ++y) {
+                            const C3DFVector *in = &m_coefficients(0, y, z);
+                            auto out = tmp.begin_at(0, y, z);
+
+                            for (size_t x = 0; x < m_range.x; ++x, ++out) {
+                                   const auto& w = m_x_weights[x];
+                                   *out = inner_product(w.begin(), w.end(), in + m_x_indices[x], C3DFVector());
+                            }
+                     }
               }
-
-              memset(&out_buffer[0], 0, size_xz * sizeof(float));
-
-              for (unsigned int i = 0; i < w.size(); ++i) {
-                     cblas_saxpy(size_xz, w[i], &in_buffer[idxy.value(i)][0], 1,
-                                 &out_buffer[0], 1);
+       };
+       pfor(C1DParallelRange(0, csize.z, 1), filter_x);
+       // y-pass: accumulate the x-filtered rows within each z-slice
+       C3DFVectorfield& tmp2 = m_grid_ypass;
+       reuse_field(tmp2, C3DBounds(m_range.x, m_range.y, csize.z));
+       const int size_x = m_range.x * 3;
+       auto filter_y = [this, &tmp, &tmp2, size_x](const C1DParallelRange & range) {
+              for (auto z = range.begin(); z != range.end(); ++z) {
+                     fill(tmp2.begin_at(0, 0, z), tmp2.begin_at(0, 0, z + 1), C3DFVector::_0);
+
+                     for (size_t y = 0; y < m_range.y; ++y) {
+                            const auto& w = m_y_weights[y];
+                            int i = m_y_indices[y];
+                            float *out = &tmp2(0, y, z).x;
+
+                            // warning: this code assumes that the 3DVector is a POD-like structure, i.e. no VMT
+                            // and that x is the first stored element
+                            for (auto iw = w.begin(); iw != w.end(); ++iw, ++i)
+                                   cblas_saxpy(size_x, *iw, &tmp(0, i, z).x, 1, out, 1);
+                     }
               }
+       };
+       pfor(C1DParallelRange(0, csize.z, 1), filter_y);
+       // z-pass: set up the identity and subtract the deformation slice-wise
+       const int size_xy = m_range.x * m_range.y * 3;
+       auto filter_z = [this, &tmp2, size_xy](const C1DParallelRange & range) {
+              for (auto iz = range.begin(); iz != range.end(); ++iz) {
+                     auto i = m_current_grid->begin_at(0, 0, iz);
+                     C3DFVector X(0, 0, iz);
 
-              tmp2.write_yslice_flat(y, out_buffer);
-       }
-
-       // prepare the output field
-       auto i = m_current_grid->begin();
-       C3DFVector X;
-
-       for (size_t z = 0; z < m_range.z; ++z) {
-              X.z = z;
-
-              for (size_t y = 0; y < m_range.y; ++y) {
-                     X.y = y;
+                     for (size_t y = 0; y < m_range.y; ++y) {
+                            X.y = y;
 
-                     for (size_t x = 0; x < m_range.x; ++x, ++i) {
-                            X.x = x;
-                            *i = X;
+                            for (size_t x = 0; x < m_range.x; ++x, ++i) {
+                                   X.x = x;
+                                   *i = X;
+                            }
                      }
-              }
-       }
 
-       for (size_t iz = 0; iz < m_range.z; ++iz) {
-              auto zweight = m_z_weights[iz];
-              int i = m_z_indices[iz];
+                     const auto& zweight = m_z_weights[iz];
+                     int k = m_z_indices[iz];
 
-              // warning: this code assumes that the 3DVector is a POD-like structure, i.e. no VMT
-              // and that x is the first stored element
-              for (auto w  = zweight.begin(); w != zweight.end(); ++w, ++i) {
-                     cblas_saxpy(size_xy, -(*w), &tmp2(0, 0, i).x, 1, &(*m_current_grid)(0, 0, iz).x, 1);
+                     for (auto w  = zweight.begin(); w != zweight.end(); ++w, ++k) {
+                            cblas_saxpy(size_xy, -(*w), &tmp2(0, 0, k).x, 1, &(*m_current_grid)(0, 0, iz).x, 1);
+                     }
               }
-       }
-
+       };
+       pfor(C1DParallelRange(0, m_range.z, 1), filter_z);
        m_grid_valid = true;
 }
 
@@ -734,57 +726,104 @@ void C3DSplineTransformation::translate(const C3DFVectorfield& gradient, CDouble
        assert(params.size() == m_coefficients.size() * 3);
        assert(gradient.get_size() == m_range);
        reinit();
-       C3DFVectorfield tmp(C3DBounds(gradient.get_size().x,
-                                     gradient.get_size().y,
-                                     m_coefficients.get_size().z));
+       const C3DBounds csize = m_coefficients.get_size();
+       // the intermediate fields are shared between calls
+       CScopedLock lock(m_translate_mutex);
+       C3DFVectorfield& tmp = m_translate_zpass;
+       reuse_field(tmp, C3DBounds(gradient.get_size().x, gradient.get_size().y, csize.z));
        const int slice_size = 3 * gradient.get_size().y * gradient.get_size().x;
-
-       for (size_t iz = 0; iz < m_coefficients.get_size().z; ++iz) {
-              const CSplineDerivativeRow::value_type& myrow = m_mz[iz];
-              int i = myrow.first;
-
-              // warning: this code assumes that the 3DVector is a POD-like structure, i.e. no VMT
-              // and that x is the first stored element
-              for (auto w  = myrow.second.begin(); w != myrow.second.end(); ++w, ++i) {
-                     cblas_saxpy(slice_size, *w, &gradient(0, 0, i).x, 1, &tmp(0, 0, iz).x, 1);
+       auto filter_z = [this, &gradient, &tmp, slice_size](const C1DParallelRange & range) {
+              for (auto iz = range.begin(); iz != range.end(); ++iz) {
+                     const CSplineDerivativeRow::value_type& myrow = m_mz[iz];
+                     int i = myrow.first;
+                     fill(tmp.begin_at(0, 0, iz), tmp.begin_at(0, 0, iz + 1), C3DFVector::_0);
+
+                     // warning: this code assumes that the 3DVector is a POD-like structure, i.e. no VMT
+                     // and that x is the first stored element
+                     for (auto w  = myrow.second.begin(); w != myrow.second.end(); ++w, ++i) {
+                            cblas_saxpy(slice_size, *w, &gradient(0, 0, i).x, 1, &tmp(0, 0, iz).x, 1);
+                     }
               }
-       }
-
-       C3DFVectorfield tmp2(C3DBounds(gradient.get_size().x,
-                                      m_coefficients.get_size().y,
-                                      m_coefficients.get_size().z));
-       vector<C3DFVector> in_buffer(gradient.get_size().y);
-       vector<C3DFVector> out_buffer(m_coefficients.get_size().y);
-
-       for (size_t iz = 0; iz < m_coefficients.get_size().z; ++iz) {
-              for (size_t ix = 0; ix < gradient.get_size().x; ++ix) {
-                     tmp.get_data_line_y(ix, iz, in_buffer);
-
-                     for (size_t i = 0; i < m_coefficients.get_size().y; ++i) {
-                            const CSplineDerivativeRow::value_type& myrow = m_my[i];
-                            out_buffer[i] = inner_product(myrow.second.begin(), myrow.second.end(),
-                                                          in_buffer.begin() + myrow.first, C3DFVector());
+       };
+       pfor(C1DParallelRange(0, csize.z, 1), filter_z);
+       // the y-convolution accumulates complete x-rows, this avoids gathering the strided y-lines
+       C3DFVectorfield& tmp2 = m_translate_ypass;
+       reuse_field(tmp2, C3DBounds(gradient.get_size().x, csize.y, csize.z));
+       const int row_size = 3 * gradient.get_size().x;
+       auto filter_y = [this, &tmp, &tmp2, &csize, row_size](const C1DParallelRange & range) {
+              for (auto iz = range.begin(); iz != range.end(); ++iz) {
+                     fill(tmp2.begin_at(0, 0, iz), tmp2.begin_at(0, 0, iz + 1), C3DFVector::_0);
+
+                     for (size_t iy = 0; iy < csize.y; ++iy) {
+                            const CSplineDerivativeRow::value_type& myrow = m_my[iy];
+                            int i = myrow.first;
+                            float *out = &tmp2(0, iy, iz).x;
+
+                            for (auto w  = myrow.second.begin(); w != myrow.second.end(); ++w, ++i)
+                                   cblas_saxpy(row_size, *w, &tmp(0, i, iz).x, 1, out, 1);
                      }
-
-                     tmp2.put_data_line_y(ix, iz, out_buffer);
               }
-       }
-
-       in_buffer.resize(gradient.get_size().x);
+       };
+       pfor(C1DParallelRange(0, csize.z, 1), filter_y);
        // x convolution and copy to output
-       auto r = params.begin();
+       auto filter_x = [this, &tmp2, &csize, &params](const C1DParallelRange & range) {
+              for (auto iz = range.begin(); iz != range.end(); ++iz) {
+                     for (size_t iy = 0; iy < csize.y; ++iy) {
+                            const C3DFVector *in = &tmp2(0, iy, iz);
+                            auto r = params.begin() + 3 * csize.x * (iy + csize.y * iz);
+
+                            for (size_t x = 0; x < csize.x; ++x, r += 3) {
+                                   const CSplineDerivativeRow::value_type& mxrow = m_mx[x];
+                                   const C3DFVector v = inner_product(mxrow.second.begin(), mxrow.second.end(),
+                                                                      in + mxrow.first, C3DFVector());
+                                   r[0] = -v.x;
+                                   r[1] = -v.y;
+                                   r[2] = -v.z;
+                            }
+                     }
+              }
+       };
+       pfor(C1DParallelRange(0, csize.z, 1), filter_x);
+}
 
-       for (size_t iz = 0; iz < m_coefficients.get_size().z; ++iz) {
-              for (size_t iy = 0; iy < m_coefficients.get_size().y; ++iy) {
-                     tmp2.get_data_line_x(iy, iz, in_buffer);
-
-                     for (size_t x = 0; x < m_coefficients.get_size().x; ++x, r += 3) {
-                            const CSplineDerivativeRow::value_type& mxrow = m_mx[x];
-                            const C3DFVector v = inner_product(mxrow.second.begin(), mxrow.second.end(),
-                                                               in_buffer.begin() + mxrow.first, C3DFVector());
-                            r[0] = -v.x;
-                            r[1] = -v.y;
-                            r[2] = -v.z;
+/*
+  Scatter the gradient at each grid position to the coefficients of the spline
+  support, this is the transpose of the evaluation of the deformation on the grid
+*/
+void C3DSplineTransformation::translate_sparse(const vector<size_t>& indices, const vector<C3DFVector>& gradient,
+              CDoubleVector& params) const
+{
+       TRACE_FUNCTION;
+       assert(indices.size() == gradient.size());
+       assert(params.size() == m_coefficients.size() * 3);
+       reinit();
+       const C3DBounds csize = m_coefficients.get_size();
+       const size_t slice_size = m_range.x * m_range.y;
+       fill(params.begin(), params.end(), 0.0);
+
+       for (size_t i = 0; i < indices.size(); ++i) {
+              const size_t x = indices[i] % m_range.x;
+              const size_t y = (indices[i] / m_range.x) % m_range.y;
+              const size_t z = indices[i] / slice_size;
+              const C3DFVector& g = gradient[i];
+              const auto& wz = m_z_weights[z];
+              size_t cz = m_z_indices[z];
+
+              for (auto iwz = wz.begin(); iwz != wz.end() && cz < csize.z; ++iwz, ++cz) {
+                     const auto& wy = m_y_weights[y];
+                     size_t cy = m_y_indices[y];
+
+                     for (auto iwy = wy.begin(); iwy != wy.end() && cy < csize.y; ++iwy, ++cy) {
+                            const C3DFVector gyz = g * float(*iwz * *iwy);
+                            const auto& wx = m_x_weights[x];
+                            size_t cx = m_x_indices[x];
+                            auto r = params.begin() + 3 * (cx + csize.x * (cy + csize.y * cz));
+
+                            for (auto iwx = wx.begin(); iwx != wx.end() && cx < csize.x; ++iwx, ++cx, r += 3) {
+                                   r[0] -= *iwx * gyz.x;
+                                   r[1] -= *iwx * gyz.y;
+                                   r[2] -= *iwx * gyz.z;
+                            }
                      }
               }
        }
@@ -85,6 +85,8 @@ public:
        virtual size_t degrees_of_freedom() const;
        virtual void update(float step, const C3DFVectorfield& a);
        virtual void translate(const C3DFVectorfield& gradient, CDoubleVector& params) const;
+       virtual void translate_sparse(const std::vector<size_t>& indices, const std::vector<C3DFVector>& gradient,
+                                     CDoubleVector& params) const;
        virtual C3DFMatrix derivative_at(int x, int y, int z) const;
        virtual C3DFMatrix derivative_at(const C3DFVector& x) const;
        virtual float get_max_transform() const;
@@ -140,6 +142,12 @@ private:
        mutable CSplineDerivativeRow  m_mz;
        mutable bool m_grid_valid;
        mutable P3DFVectorfield m_current_grid;
+       // intermediate fields of the separable passes, kept to avoid re-allocating them
+       mutable C3DFVectorfield m_grid_xpass;
+       mutable C3DFVectorfield m_grid_ypass;
+       mutable C3DFVectorfield m_translate_zpass;
+       mutable C3DFVectorfield m_translate_ypass;
+       mutable CMutex m_translate_mutex;
        PSplineBoundaryCondition m_x_boundary;
        PSplineBoundaryCondition m_y_boundary;
        PSplineBoundaryCondition m_z_boundary;
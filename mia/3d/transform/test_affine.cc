@@ -92,6 +92,22 @@ BOOST_FIXTURE_TEST_CASE(max_TranslateTransFixture, TranslateTransFixture)
        BOOST_CHECK_CLOSE(rtrans.get_max_transform(), sqrtf(14.0), 0.1);
 }
 
+BOOST_FIXTURE_TEST_CASE(translate_sparse_TranslateTransFixture, TranslateTransFixture)
+{
+       vector<size_t> indices = {0, 17, 17, 1234, 4567, 80000, 95999};
+       vector<C3DFVector> gradient = {C3DFVector(1, 2, 3), C3DFVector(-1, 0.5, 2), C3DFVector(0.3, 0.2, -1),
+                                      C3DFVector(2, -2, 1), C3DFVector(0.1, 4, -3), C3DFVector(1, 1, 1),
+                                      C3DFVector(-2, 0, 0.5)
+                                     };
+       CDoubleVector grad(rtrans.degrees_of_freedom());
+       CDoubleVector dense_grad(rtrans.degrees_of_freedom());
+       rtrans.translate_sparse(indices, gradient, grad);
+       rtrans.C3DTransformation::translate_sparse(indices, gradient, dense_grad);
+
+       for (size_t i = 0; i < grad.size(); ++i)
+              BOOST_CHECK_CLOSE(grad[i], dense_grad[i], 0.01);
+}
+
 BOOST_FIXTURE_TEST_CASE(set_identity_TranslateTransFixture, TranslateTransFixture)
 {
        rtrans.set_identity();
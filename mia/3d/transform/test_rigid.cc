@@ -239,6 +239,69 @@ BOOST_FIXTURE_TEST_CASE( test_rigid3d_rotycentered_translate_field, ipfFixture)
        BOOST_CHECK_SMALL(grad[5], 1e-2);
 }
 
+BOOST_FIXTURE_TEST_CASE( test_rigid3d_rotated_translate_field, ipfFixture)
+{
+       C3DBounds size(9, 10, 11);
+       C3DRigidTransformation t(size, C3DFVector(1.0, 2.0, -1.0),
+                                C3DFVector(0.3, -0.2, 0.4),
+                                C3DFVector(0.4, 0.5, 0.6), ipf);
+       C3DFVectorfield field(size);
+       auto ifield = field.begin();
+
+       for (size_t z = 0; z < size.z; ++z)
+              for (size_t y = 0; y < size.y; ++y)
+                     for (size_t x = 0; x < size.x; ++x, ++ifield)
+                            *ifield = C3DFVector(1.0 + 0.1 * x, 0.5 - 0.05 * y + 0.02 * z, 0.03 * x * z - 0.2);
+
+       CDoubleVector grad(t.degrees_of_freedom());
+       t.translate(field, grad);
+       // compare to the numerical derivative of sum_x field(x) * t(x)
+       auto projection = [&field, &size](const C3DTransformation & t) {
+              double result = 0.0;
+              auto ifield = field.begin();
+
+              for (size_t z = 0; z < size.z; ++z)
+                     for (size_t y = 0; y < size.y; ++y)
+                            for (size_t x = 0; x < size.x; ++x, ++ifield)
+                                   result += dot(*ifield, t(C3DFVector(x, y, z)));
+
+              return result;
+       };
+       auto params = t.get_parameters();
+
+       for (size_t i = 0; i < params.size(); ++i) {
+              CDoubleVector p(params.size());
+              copy(params.begin(), params.end(), p.begin());
+              p[i] += 0.01;
+              t.set_parameters(p);
+              const double plus = projection(t);
+              p[i] -= 0.02;
+              t.set_parameters(p);
+              const double minus = projection(t);
+              BOOST_CHECK_CLOSE(grad[i], (plus - minus) / 0.02, 0.1);
+       }
+}
+
+BOOST_FIXTURE_TEST_CASE( test_rigid3d_translate_sparse, ipfFixture)
+{
+       C3DBounds size(9, 10, 11);
+       C3DRigidTransformation t(size, C3DFVector(1.0, 2.0, -1.0),
+                                C3DFVector(0.3, -0.2, 0.4),
+                                C3DFVector(0.4, 0.5, 0.6), ipf);
+       vector<size_t> indices = {0, 17, 17, 123, 456, 800, 989};
+       vector<C3DFVector> gradient = {C3DFVector(1, 2, 3), C3DFVector(-1, 0.5, 2), C3DFVector(0.3, 0.2, -1),
+                                      C3DFVector(2, -2, 1), C3DFVector(0.1, 4, -3), C3DFVector(1, 1, 1),
+                                      C3DFVector(-2, 0, 0.5)
+                                     };
+       CDoubleVector grad(t.degrees_of_freedom());
+       CDoubleVector dense_grad(t.degrees_of_freedom());
+       t.translate_sparse(indices, gradient, grad);
+       t.C3DTransformation::translate_sparse(indices, gradient, dense_grad);
+
+       for (size_t i = 0; i < grad.size(); ++i)
+              BOOST_CHECK_CLOSE(grad[i], dense_grad[i], 0.01);
+}
+
 struct RotYCenteredFixture : public ipfFixture {
        RotYCenteredFixture(): size(61, 81, 41),
               rcrot(size, C3DFVector::_0,
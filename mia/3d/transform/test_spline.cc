@@ -392,6 +392,29 @@ BOOST_FIXTURE_TEST_CASE( test_splines_translate, TransformSplineFixture )
        }
 }
 
+BOOST_FIXTURE_TEST_CASE( test_splines_translate_sparse, TransformSplineFixture )
+{
+       vector<size_t> indices;
+       vector<C3DFVector> gradient;
+
+       for (size_t i = 0; i < range.product(); i += 97) {
+              indices.push_back(i);
+              gradient.push_back(C3DFVector(sin(i), cos(i), 0.5 * sin(3.0 * i)));
+       }
+
+       // an index may be given twice
+       indices.push_back(97);
+       gradient.push_back(C3DFVector(1, 2, 3));
+       CDoubleVector force(stransf.degrees_of_freedom());
+       CDoubleVector dense_force(stransf.degrees_of_freedom());
+       stransf.translate_sparse(indices, gradient, force);
+       // the default implementation translates the dense field
+       stransf.C3DTransformation::translate_sparse(indices, gradient, dense_force);
+
+       for (size_t i = 0; i < force.size(); ++i)
+              BOOST_CHECK_SMALL(force[i] - dense_force[i], 1e-4);
+}
+
 BOOST_FIXTURE_TEST_CASE( test_splines_get_set_parameters, TransformSplineFixture )
 {
        auto params = stransf.get_parameters();
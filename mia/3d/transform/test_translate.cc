@@ -93,6 +93,19 @@ BOOST_FIXTURE_TEST_CASE(test_gradtranslate, TranslateTransformFixture)
        BOOST_CHECK_CLOSE(a[2], f.z, 0.1);
 }
 
+BOOST_FIXTURE_TEST_CASE(test_gradtranslate_sparse, TranslateTransformFixture)
+{
+       vector<size_t> indices = {0, 7, 7, 45, 89};
+       vector<C3DFVector> gradient = {C3DFVector(1, 2, 3), C3DFVector(-1, 0.5, 2), C3DFVector(0.3, 0.2, -1),
+                                      C3DFVector(2, -2, 1), C3DFVector(0.1, 4, -3)
+                                     };
+       CDoubleVector a(3);
+       transf.translate_sparse(indices, gradient, a);
+       BOOST_CHECK_CLOSE(a[0], -2.4, 0.1);
+       BOOST_CHECK_CLOSE(a[1], -4.7, 0.1);
+       BOOST_CHECK_CLOSE(a[2], -2.0, 0.1);
+}
+
 BOOST_FIXTURE_TEST_CASE(test_get_params, TranslateTransformFixture)
 {
        auto a = transf.get_parameters();
@@ -155,6 +155,16 @@ void C3DTranslateTransformation::translate(const C3DFVectorfield& gradient, CDou
        params[2] = -r.z;
 }
 
+void C3DTranslateTransformation::translate_sparse(const vector<size_t>& MIA_PARAM_UNUSED(indices),
+              const vector<C3DFVector>& gradient, CDoubleVector& params) const
+{
+       assert(params.size() == 3);
+       C3DFVector r = accumulate(gradient.begin(), gradient.end(), C3DFVector(0, 0, 0));
+       params[0] = -r.x;
+       params[1] = -r.y;
+       params[2] = -r.z;
+}
+
 
 size_t C3DTranslateTransformation::degrees_of_freedom() const
 {
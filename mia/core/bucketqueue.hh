@@ -0,0 +1,281 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef mia_core_bucketqueue_hh
+#define mia_core_bucketqueue_hh
+
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <functional>
+#include <cassert>
+#include <mia/core/defines.hh>
+
+NS_MIA_BEGIN
+
+/**
+   \ingroup misc
+
+   \brief A queue with integer priority levels
+
+   Elements are stored in one bucket per level and they are retrieved in the order
+   of increasing level, elements of the same level are retrieved in the order given
+   by \a Compare. Hence, the queue returns the elements in the same order as a
+   std::priority_queue that orders by (level, element) would, also if an element is
+   pushed with a level below the level of the last retrieved element.
+   Each bucket is kept as a binary heap and the non-empty levels are kept in a
+   heap of their own, so that pushing and popping N elements costs
+   O(N log(B) + K log(L)) with B the largest bucket size, K the number of times a
+   bucket becomes non-empty, and L the number of levels.
+
+   \tparam T type of the queued elements
+   \tparam Compare strict weak ordering of the elements within one level
+ */
+template <typename T, typename Compare = std::less<T>>
+class TBucketQueue
+{
+public:
+       /**
+          Construct an empty queue
+          \param n_levels number of priority levels, valid levels are [0, n_levels)
+          \param compare ordering of the elements within one level
+        */
+       TBucketQueue(unsigned int n_levels, const Compare& compare = Compare());
+
+       /**
+          Add an element to the queue
+          \param level priority level of the element, lower levels are retrieved first
+          \param value the element
+        */
+       void push(unsigned int level, const T& value);
+
+       /**
+          Remove the element with the lowest level from the queue, elements of the same
+          level are retrieved in the order given by the comparator.
+          The queue must not be empty.
+          \returns the element
+        */
+       T pop();
+
+       /// \returns true if the queue is empty
+       bool empty() const;
+
+       /// \returns the number of queued elements
+       size_t size() const;
+
+       /// \returns the level of the element that was retrieved last
+       unsigned int get_current_level() const;
+private:
+       // std heaps put the largest element on top, invert the order to get the smallest
+       struct SInverse {
+              SInverse(const Compare& compare): m_compare(compare) {}
+              bool operator () (const T& lhs, const T& rhs) const
+              {
+                     return m_compare(rhs, lhs);
+              }
+              Compare m_compare;
+       };
+
+       std::vector<std::vector<T>> m_buckets;
+       std::priority_queue<unsigned int, std::vector<unsigned int>, std::greater<unsigned int>> m_levels;
+       SInverse m_order;
+       unsigned int m_current;
+       size_t m_size;
+};
+
+template <typename T, typename Compare>
+TBucketQueue<T, Compare>::TBucketQueue(unsigned int n_levels, const Compare& compare):
+       m_buckets(n_levels),
+       m_order(compare),
+       m_current(0),
+       m_size(0)
+{
+}
+
+template <typename T, typename Compare>
+void TBucketQueue<T, Compare>::push(unsigned int level, const T& value)
+{
+       assert(level < m_buckets.size());
+       auto& bucket = m_buckets[level];
+
+       if (bucket.empty())
+              m_levels.push(level);
+
+       bucket.push_back(value);
+       std::push_heap(bucket.begin(), bucket.end(), m_order);
+       ++m_size;
+}
+
+template <typename T, typename Compare>
+T TBucketQueue<T, Compare>::pop()
+{
+       assert(m_size > 0);
+       m_current = m_levels.top();
+       auto& bucket = m_buckets[m_current];
+       std::pop_heap(bucket.begin(), bucket.end(), m_order);
+       T result = bucket.back();
+       bucket.pop_back();
+
+       if (bucket.empty()) {
+              // release the memory of the finished level
+              std::vector<T>().swap(bucket);
+              m_levels.pop();
+       }
+
+       --m_size;
+       return result;
+}
+
+template <typename T, typename Compare>
+bool TBucketQueue<T, Compare>::empty() const
+{
+       return m_size == 0;
+}
+
+template <typename T, typename Compare>
+size_t TBucketQueue<T, Compare>::size() const
+{
+       return m_size;
+}
+
+template <typename T, typename Compare>
+unsigned int TBucketQueue<T, Compare>::get_current_level() const
+{
+       return m_current;
+}
+
+/**
+   \ingroup misc
+
+   \brief A queue with integer priority levels that keeps the insertion order within a level
+
+   Elements are retrieved in the order of increasing level like in TBucketQueue, but
+   elements of the same level are retrieved in the order they were pushed. Hence,
+   pushing and popping N elements costs O(N + K log(L)) with K the number of times a
+   bucket becomes non-empty and L the number of levels.
+
+   \tparam T type of the queued elements
+ */
+template <typename T>
+class TFifoBucketQueue
+{
+public:
+       /**
+          Construct an empty queue
+          \param n_levels number of priority levels, valid levels are [0, n_levels)
+        */
+       TFifoBucketQueue(unsigned int n_levels);
+
+       /**
+          Add an element to the queue
+          \param level priority level of the element, lower levels are retrieved first
+          \param value the element
+        */
+       void push(unsigned int level, const T& value);
+
+       /**
+          Remove the element with the lowest level from the queue, elements of the same
+          level are retrieved in the order they were pushed.
+          The queue must not be empty.
+          \returns the element
+        */
+       T pop();
+
+       /// \returns true if the queue is empty
+       bool empty() const;
+
+       /// \returns the number of queued elements
+       size_t size() const;
+
+       /// \returns the level of the element that was retrieved last
+       unsigned int get_current_level() const;
+private:
+       // a bucket is only cleared when all its elements are retrieved, m_front holds
+       // the index of the next element to be retrieved from each bucket
+       std::vector<std::vector<T>> m_buckets;
+       std::vector<size_t> m_front;
+       std::priority_queue<unsigned int, std::vector<unsigned int>, std::greater<unsigned int>> m_levels;
+       unsigned int m_current;
+       size_t m_size;
+};
+
+template <typename T>
+TFifoBucketQueue<T>::TFifoBucketQueue(unsigned int n_levels):
+       m_buckets(n_levels),
+       m_front(n_levels, 0),
+       m_current(0),
+       m_size(0)
+{
+}
+
+template <typename T>
+void TFifoBucketQueue<T>::push(unsigned int level, const T& value)
+{
+       assert(level < m_buckets.size());
+       auto& bucket = m_buckets[level];
+
+       if (bucket.empty())
+              m_levels.push(level);
+
+       bucket.push_back(value);
+       ++m_size;
+}
+
+template <typename T>
+T TFifoBucketQueue<T>::pop()
+{
+       assert(m_size > 0);
+       m_current = m_levels.top();
+       auto& bucket = m_buckets[m_current];
+       size_t& front = m_front[m_current];
+       T result = bucket[front++];
+
+       if (front == bucket.size()) {
+              // release the memory of the finished level
+              std::vector<T>().swap(bucket);
+              front = 0;
+              m_levels.pop();
+       }
+
+       --m_size;
+       return result;
+}
+
+template <typename T>
+bool TFifoBucketQueue<T>::empty() const
+{
+       return m_size == 0;
+}
+
+template <typename T>
+size_t TFifoBucketQueue<T>::size() const
+{
+       return m_size;
+}
+
+template <typename T>
+unsigned int TFifoBucketQueue<T>::get_current_level() const
+{
+       return m_current;
+}
+
+NS_MIA_END
+
+#endif
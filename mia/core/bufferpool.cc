@@ -0,0 +1,182 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <atomic>
+#include <mia/core/bufferpool.hh>
+#include <mia/core/msgstream.hh>
+
+NS_MIA_BEGIN
+
+using std::vector;
+using std::function;
+
+namespace {
+
+struct SPoolState {
+       SPoolState(): active_scopes(0) {}
+
+       std::atomic<int> active_scopes;
+       CMutex mutex;
+       SBufferPoolStatistics stats;
+       vector<function<void()>> pools;
+};
+
+// never destroyed, because data fields may still be released on exit
+SPoolState& pool_state()
+{
+       static SPoolState *state = new SPoolState();
+       return *state;
+}
+
+}
+
+SBufferPoolStatistics::SBufferPoolStatistics():
+       requests(0),
+       hits(0),
+       bytes_in_use(0),
+       peak_bytes_in_use(0),
+       bytes_cached(0),
+       peak_bytes_cached(0)
+{
+}
+
+double SBufferPoolStatistics::get_hit_rate() const
+{
+       return requests > 0 ? static_cast<double>(hits) / requests : 0.0;
+}
+
+CBufferPoolScope::CBufferPoolScope()
+{
+       ++pool_state().active_scopes;
+}
+
+CBufferPoolScope::~CBufferPoolScope()
+{
+       SPoolState& state = pool_state();
+       CScopedLock lock(state.mutex);
+
+       if (--state.active_scopes > 0)
+              return;
+
+       cvdebug() << "Buffer pool: " << state.stats.requests << " requests, hit rate "
+                 << state.stats.get_hit_rate() << ", peak use " << state.stats.peak_bytes_in_use
+                 << " bytes, peak cache " << state.stats.peak_bytes_cached << " bytes\n";
+       auto pools = state.pools;
+       lock.release();
+
+       for (auto& flush : pools)
+              flush();
+}
+
+bool CBufferPoolScope::is_active()
+{
+       return pool_state().active_scopes > 0;
+}
+
+SBufferPoolStatistics CBufferPoolScope::get_statistics()
+{
+       SPoolState& state = pool_state();
+       CScopedLock lock(state.mutex);
+       return state.stats;
+}
+
+void CBufferPoolScope::reset_statistics()
+{
+       SPoolState& state = pool_state();
+       CScopedLock lock(state.mutex);
+       state.stats.requests = 0;
+       state.stats.hits = 0;
+       state.stats.peak_bytes_in_use = state.stats.bytes_in_use;
+       state.stats.peak_bytes_cached = state.stats.bytes_cached;
+}
+
+const size_t CBufferPoolControl::min_pooled_bytes = 64 * 1024;
+
+void CBufferPoolControl::register_pool(function<void()> flush)
+{
+       SPoolState& state = pool_state();
+       CScopedLock lock(state.mutex);
+       state.pools.push_back(flush);
+}
+
+void CBufferPoolControl::record_request(size_t bytes, bool hit)
+{
+       SPoolState& state = pool_state();
+       CScopedLock lock(state.mutex);
+       SBufferPoolStatistics& stats = state.stats;
+       ++stats.requests;
+       stats.bytes_in_use += bytes;
+
+       if (stats.bytes_in_use > stats.peak_bytes_in_use)
+              stats.peak_bytes_in_use = stats.bytes_in_use;
+
+       if (hit) {
+              ++stats.hits;
+              stats.bytes_cached -= std::min(bytes, stats.bytes_cached);
+       }
+}
+
+void CBufferPoolControl::record_release(size_t in_use_bytes, size_t cached_bytes)
+{
+       SPoolState& state = pool_state();
+       CScopedLock lock(state.mutex);
+       SBufferPoolStatistics& stats = state.stats;
+       // buffers that were not drawn from the pool may be released into it
+       stats.bytes_in_use -= std::min(in_use_bytes, stats.bytes_in_use);
+       stats.bytes_cached += cached_bytes;
+
+       if (stats.bytes_cached > stats.peak_bytes_cached)
+              stats.peak_bytes_cached = stats.bytes_cached;
+}
+
+void CBufferPoolControl::record_flush(size_t bytes)
+{
+       SPoolState& state = pool_state();
+       CScopedLock lock(state.mutex);
+       state.stats.bytes_cached -= std::min(bytes, state.stats.bytes_cached);
+}
+
+/*
+  The size classes are spaced by one eighth of an octave, i.e. at most 12.5% of
+  a buffer are wasted.
+*/
+static size_t get_class_shift(size_t n)
+{
+       int log2 = 0;
+
+       while ((n >> log2) > 15)
+              ++log2;
+
+       return log2;
+}
+
+size_t CBufferPoolControl::get_size_class(size_t n)
+{
+       const size_t shift = get_class_shift(n);
+       return ((n + (size_t(1) << shift) - 1) >> shift) << shift;
+}
+
+size_t CBufferPoolControl::get_capacity_class(size_t capacity)
+{
+       const size_t shift = get_class_shift(capacity);
+       return (capacity >> shift) << shift;
+}
+
+NS_MIA_END
@@ -0,0 +1,270 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef mia_core_bufferpool_hh
+#define mia_core_bufferpool_hh
+
+#include <vector>
+#include <map>
+#include <functional>
+#include <mia/core/defines.hh>
+#include <mia/core/parallel.hh>
+
+NS_MIA_BEGIN
+
+/**
+   \ingroup misc
+
+   \brief Statistics of the pooled buffer allocation
+
+   Only the buffers that are requested while a CBufferPoolScope is active are counted.
+ */
+struct EXPORT_CORE SBufferPoolStatistics {
+       SBufferPoolStatistics();
+
+       /// \returns the fraction of requests that were served by a cached buffer
+       double get_hit_rate() const;
+
+       /// number of requested buffers
+       size_t requests;
+
+       /// number of requests that were served by a cached buffer
+       size_t hits;
+
+       /// size of the pooled buffers currently in use
+       size_t bytes_in_use;
+
+       /// peak size of the pooled buffers in use
+       size_t peak_bytes_in_use;
+
+       /// size of the buffers currently held by the pools for re-use
+       size_t bytes_cached;
+
+       /// peak size of the buffers held by the pools for re-use
+       size_t peak_bytes_cached;
+};
+
+/**
+   \ingroup misc
+
+   \brief Enable the re-use of large data buffers within a scope
+
+   As long as an instance of this class exists, the large buffers of released data
+   fields are kept in size-bucketed pools and newly created data fields draw their
+   storage from these pools, avoiding the allocation and page-fault cost of
+   fresh memory. When the last scope is left all cached buffers are released.
+   Without an active scope buffers are allocated and released as usual.
+
+   The scope is process-wide, not per thread: while any thread holds a scope, the
+   buffers of all threads are pooled, including those of the worker threads that
+   run the parallel loops of the scope owner. The pools are only flushed when the
+   last scope of the process is left, hence buffers that other threads release
+   into the pool in the meantime stay cached until then.
+   Scopes may be nested and created by any thread.
+ */
+class EXPORT_CORE CBufferPoolScope
+{
+public:
+       CBufferPoolScope();
+       ~CBufferPoolScope();
+
+       CBufferPoolScope(const CBufferPoolScope& other) = delete;
+       CBufferPoolScope& operator = (const CBufferPoolScope& other) = delete;
+
+       /// \returns true if a buffer pool scope is active
+       static bool is_active();
+
+       /// \returns the statistics accumulated since the last reset
+       static SBufferPoolStatistics get_statistics();
+
+       /// reset the request counters and the peak values of the statistics
+       static void reset_statistics();
+};
+
+/// @cond INTERNAL
+/**
+   Bookkeeping that is shared by the typed buffer pools.
+ */
+class EXPORT_CORE CBufferPoolControl
+{
+public:
+       /// buffers smaller than this are not pooled
+       static const size_t min_pooled_bytes;
+
+       static void register_pool(std::function<void()> flush);
+       static void record_request(size_t bytes, bool hit);
+       static void record_release(size_t in_use_bytes, size_t cached_bytes);
+       static void record_flush(size_t bytes);
+
+       static size_t get_size_class(size_t n);
+       static size_t get_capacity_class(size_t capacity);
+};
+/// @endcond
+
+/**
+   \ingroup misc
+
+   \brief Size-bucketed pool of std::vector buffers
+
+   Buffers are bucketed by size classes that are spaced by one eighth of an octave,
+   and a bucket only holds buffers whose capacity is large enough for all sizes of
+   its class. Access to the buckets is serialized, so buffers can be requested and
+   released by any thread.
+   \tparam T element type of the buffers
+ */
+template <typename T>
+class TBufferPool
+{
+public:
+       /**
+          Get a value-initialized buffer, it is taken from the pool if a scope is active
+          and a suitable buffer is available.
+          \param n number of elements
+          \returns the buffer
+        */
+       static std::vector<T> get(size_t n);
+
+       /**
+          Get a copy of a buffer, the storage is taken from the pool like in get()
+          \param data the buffer to copy
+          \returns the copy
+        */
+       static std::vector<T> get_copy(const std::vector<T>& data);
+
+       /**
+          Release the storage of a buffer, if a scope is active it is kept for re-use.
+          \param buffer the buffer, it is left empty
+        */
+       static void put(std::vector<T>& buffer);
+private:
+       TBufferPool();
+       static TBufferPool& instance();
+       static bool take(size_t n, std::vector<T>& buffer);
+       void flush();
+
+       CMutex m_mutex;
+       std::map<size_t, std::vector<std::vector<T>>> m_buckets;
+};
+
+template <typename T>
+TBufferPool<T>::TBufferPool()
+{
+       CBufferPoolControl::register_pool([this]() {
+              flush();
+       });
+}
+
+template <typename T>
+TBufferPool<T>& TBufferPool<T>::instance()
+{
+       // the pool is never destroyed, data fields may still be released on exit
+       static TBufferPool<T> *me = new TBufferPool<T>();
+       return *me;
+}
+
+template <typename T>
+bool TBufferPool<T>::take(size_t n, std::vector<T>& buffer)
+{
+       TBufferPool<T>& pool = instance();
+       bool hit = false;
+       {
+              CScopedLock lock(pool.m_mutex);
+              auto b = pool.m_buckets.find(CBufferPoolControl::get_size_class(n));
+
+              if (b != pool.m_buckets.end() && !b->second.empty()) {
+                     buffer.swap(b->second.back());
+                     b->second.pop_back();
+                     hit = true;
+              }
+       }
+
+       if (!hit)
+              buffer.reserve(CBufferPoolControl::get_size_class(n));
+
+       CBufferPoolControl::record_request(buffer.capacity() * sizeof(T), hit);
+       return hit;
+}
+
+template <typename T>
+std::vector<T> TBufferPool<T>::get(size_t n)
+{
+       if (!CBufferPoolScope::is_active() || n * sizeof(T) < CBufferPoolControl::min_pooled_bytes)
+              return std::vector<T>(n);
+
+       std::vector<T> result;
+
+       if (take(n, result))
+              result.assign(n, T());
+       else
+              result.resize(n);
+
+       return result;
+}
+
+template <typename T>
+std::vector<T> TBufferPool<T>::get_copy(const std::vector<T>& data)
+{
+       if (!CBufferPoolScope::is_active() || data.size() * sizeof(T) < CBufferPoolControl::min_pooled_bytes)
+              return data;
+
+       std::vector<T> result;
+       take(data.size(), result);
+       result.assign(data.begin(), data.end());
+       return result;
+}
+
+template <typename T>
+void TBufferPool<T>::put(std::vector<T>& buffer)
+{
+       const size_t bytes = buffer.capacity() * sizeof(T);
+
+       if (!CBufferPoolScope::is_active() || bytes < CBufferPoolControl::min_pooled_bytes) {
+              std::vector<T>().swap(buffer);
+              return;
+       }
+
+       const size_t capacity_class = CBufferPoolControl::get_capacity_class(buffer.capacity());
+       TBufferPool<T>& pool = instance();
+       {
+              CScopedLock lock(pool.m_mutex);
+              auto& bucket = pool.m_buckets[capacity_class];
+              bucket.push_back(std::vector<T>());
+              bucket.back().swap(buffer);
+       }
+       CBufferPoolControl::record_release(bytes, bytes);
+}
+
+template <typename T>
+void TBufferPool<T>::flush()
+{
+       size_t bytes = 0;
+       CScopedLock lock(m_mutex);
+
+       for (auto& b : m_buckets)
+              for (auto& buffer : b.second)
+                     bytes += buffer.capacity() * sizeof(T);
+
+       m_buckets.clear();
+       CBufferPoolControl::record_flush(bytes);
+}
+
+NS_MIA_END
+
+#endif
@@ -64,6 +64,7 @@ using std::regex_replace;
 #include <mia/core/cmdbooloption.hh>
 #include <mia/core/cmdlineparser.hh>
 #include <mia/core/fixedwidthoutput.hh>
+#include <mia/core/profiling.hh>
 
 extern void print_full_copyright(const char *name, const char *author);
 
@@ -107,6 +108,8 @@ struct CCmdOptionListData {
        bool copyright;
        vstream::Level verbose;
        int max_threads;
+       string profile_file;
+       CProfiler::EFormat profile_format;
        bool m_selftest_run;
        bool m_stdout_is_result;
 
@@ -235,6 +238,7 @@ CCmdOptionListData::CCmdOptionListData(const SProgramDescription& description):
 #else
        max_threads(-1),
 #endif
+       profile_format(CProfiler::pf_summary),
        m_selftest_run(false),
        m_stdout_is_result(false),
        m_log(&std::cout)
@@ -259,6 +263,12 @@ CCmdOptionListData::CCmdOptionListData(const SProgramDescription& description):
        add(make_opt(max_threads, "threads", 0, "Maxiumum number of threads to use for processing,"
                     "This number should be lower or equal to the number of logical processor cores in the machine. "
                     "(-1: automatic estimation)."));
+#ifdef ENABLE_PROFILING
+       add(make_opt(profile_file, "profile", 0, "Measure the run-time of the processing steps and "
+                    "write the results to the given file when the program exits", CCmdOptionFlags::output));
+       add(make_opt(profile_format, g_profile_format_dict, "profile-format", 0,
+                    "Output format of the run-time measurements"));
+#endif
        set_current_group("");
 }
 
@@ -881,6 +891,10 @@ CCmdOptionList::do_parse(size_t argc, const char *args[], bool has_additional,
 #else
        CMaxTasks::set_max_tasks(m_impl->max_threads);
 #endif
+
+       if (!m_impl->profile_file.empty())
+              CProfiler::instance().enable(m_impl->profile_file, m_impl->profile_format);
+
        return hr_no;
 }
 
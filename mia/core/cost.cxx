@@ -18,7 +18,9 @@
  *
  */
 
+#include <stdexcept>
 #include <mia/core/cost.hh>
+#include <mia/core/errormacro.hh>
 
 NS_MIA_BEGIN
 
@@ -31,15 +33,34 @@ TCost<T,V>::~TCost()
 template <typename T, typename V>
 double TCost<T,V>::value(const T& a) const
 {
+	MIA_PROFILE_SCOPE("cost", *this); 
 	return do_value(a, *m_reference); 
 }
 
 template <typename T, typename V>
 double TCost<T,V>::evaluate_force(const T& a, V& force) const
 {
+	MIA_PROFILE_SCOPE("cost", *this); 
 	return do_evaluate_force(a, *m_reference, force); 
 }
 
+template <typename T, typename V>
+double TCost<T,V>::evaluate_samples(const std::vector<float>& src, const std::vector<float>& ref,
+				    size_t n_voxels, std::vector<float>& dsrc) const
+{
+	assert(src.size() == ref.size()); 
+	MIA_PROFILE_SCOPE("cost", *this); 
+	return do_evaluate_samples(src, ref, n_voxels, dsrc); 
+}
+
+template <typename T, typename V>
+double TCost<T,V>::do_evaluate_samples(const std::vector<float>& /*src*/, const std::vector<float>& /*ref*/,
+				       size_t /*n_voxels*/, std::vector<float>& /*dsrc*/) const
+{
+	throw create_exception<std::invalid_argument>("Cost function '", get_init_string(), 
+						      "' doesn't support the evaluation on a sub-set of the voxels"); 
+}
+
 template <typename T, typename V>
 void TCost<T,V>::set_reference(const T& ref)
 {
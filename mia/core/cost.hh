@@ -21,8 +21,10 @@
 #ifndef mia_core_cost_hh
 #define mia_core_cost_hh
 
+#include <vector>
 #include <mia/core/factory.hh>
 #include <mia/core/refholder.hh>
+#include <mia/core/profiling.hh>
 
 
 #ifndef EXPORT_HANDLER
@@ -56,6 +58,10 @@ struct EXPORT_CORE cost_type {
     The virtual function
     - void post_set_reference(const T& ref)
     may be overwritten in order to prepare the reference data for the implemented cost function.
+    Cost functions that can be estimated from a sub-set of the voxels provide the property
+    property_sampling and implement
+    - double do_evaluate_samples(const std::vector<float>& src, const std::vector<float>& ref,
+      size_t n_voxels, std::vector<float>& dsrc) const
     \tparam T the data type of the objects that the cost evaluation is based on
     \tparam V the type of the gradient force field created by this cost function
 */
@@ -110,9 +116,27 @@ public:
           on the reference image.
         */
        void set_reference(const T& ref);
+
+       /**
+          Estimate the cost function value and its derivative with respect to the moving
+          intensities from a sub-set of the voxels. The positions of the sampled voxels
+          are not needed, only the intensities of the moving image and the reference
+          at these positions. This is only available if the cost function has the property
+          property_sampling.
+          \param src intensities of the moving image at the sampled voxels
+          \param ref intensities of the reference at the sampled voxels
+          \param n_voxels number of voxels of the image the samples were drawn from
+          \param[out] dsrc derivative of the estimated cost function value with respect to
+          the moving intensities at the sampled voxels
+          \returns the estimated cost function value of the whole image
+        */
+       double evaluate_samples(const std::vector<float>& src, const std::vector<float>& ref,
+                               size_t n_voxels, std::vector<float>& dsrc) const;
 private:
        virtual double do_value(const T& a, const T& b) const = 0;
        virtual double do_evaluate_force(const T& a, const T& b, V& force) const = 0;
+       virtual double do_evaluate_samples(const std::vector<float>& src, const std::vector<float>& ref,
+                                          size_t n_voxels, std::vector<float>& dsrc) const;
        virtual void post_set_reference(const T& ref);
 
        PData m_reference;
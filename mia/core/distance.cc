@@ -33,40 +33,56 @@ inline float d(float fp, float p, float fq, float q)
        return  ( fp  - fq + p * p - q * q) / (p - q) * 0.5;
 }
 
-void EXPORT_CORE distance_transform_inplace(vector<float>& r)
+C1DDistanceTransform::C1DDistanceTransform(float spacing):
+       m_spacing(spacing)
+{
+}
+
+void C1DDistanceTransform::operator () (vector<float>& r)
 {
        TRACE_FUNCTION;
-       vector<float> f(r);
-       vector<int> v(f.size());
-       vector<float> z(f.size() + 1);
+
+       if (r.empty())
+              return;
+
+       m_f = r;
+       m_v.resize(r.size());
+       m_z.resize(r.size() + 1);
+       const float h = m_spacing;
        int k = 0;
-       v[0] = 0;
-       z[0] = -numeric_limits<float>::max();
-       z[1] = +numeric_limits<float>::max();
+       m_v[0] = 0;
+       m_z[0] = -numeric_limits<float>::max();
+       m_z[1] = +numeric_limits<float>::max();
 
-       for (size_t q = 1; q < f.size(); q++) {
-              float s  = d(f[q], q, f[v[k]], v[k]);
+       for (size_t q = 1; q < m_f.size(); q++) {
+              float s  = d(m_f[q], q * h, m_f[m_v[k]], m_v[k] * h);
 
-              while (s <= z[k]) {
+              while (s <= m_z[k]) {
                      --k;
-                     s  = d(f[q], q, f[v[k]], v[k]);
+                     s  = d(m_f[q], q * h, m_f[m_v[k]], m_v[k] * h);
               }
 
               ++k;
-              v[k] = q;
-              z[k] = s;
-              z[k + 1] = numeric_limits<float>::max();
+              m_v[k] = q;
+              m_z[k] = s;
+              m_z[k + 1] = numeric_limits<float>::max();
        }
 
        k = 0;
 
-       for (size_t q = 0; q < f.size(); ++q) {
-              while (z[k + 1] < q)
+       for (size_t q = 0; q < m_f.size(); ++q) {
+              while (m_z[k + 1] < q * h)
                      ++k;
 
-              float delta = float(q) - v[k];
-              r[q] = delta * delta +  f[v[k]];
+              float delta = (float(q) - m_v[k]) * h;
+              r[q] = delta * delta +  m_f[m_v[k]];
        }
 }
 
+void EXPORT_CORE distance_transform_inplace(vector<float>& r)
+{
+       C1DDistanceTransform dt;
+       dt(r);
+}
+
 NS_MIA_END
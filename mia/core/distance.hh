@@ -41,6 +41,35 @@ NS_MIA_BEGIN
 
 void EXPORT_CORE distance_transform_inplace(std::vector<float>& r);
 
+/**
+   \brief 1D distance transform that keeps its work buffers
+
+   This class evaluates the same transform as distance_transform_inplace, but the
+   work buffers are kept between calls, so that running the transform over the lines
+   of an image doesn't allocate memory for each line.  In addition, the spacing
+   between the samples can be given to support anisotropic pixels.
+*/
+class EXPORT_CORE C1DDistanceTransform
+{
+public:
+       /**
+          \param spacing distance between two neighboring samples
+        */
+       C1DDistanceTransform(float spacing = 1.0f);
+
+       /**
+          Run the transform in-place
+          \param[in,out] r at input the squared values of the function to evaluate the distance to
+          at output it contains the squared distances.
+        */
+       void operator () (std::vector<float>& r);
+private:
+       float m_spacing;
+       std::vector<float> m_f;
+       std::vector<int> m_v;
+       std::vector<float> m_z;
+};
+
 /**
    This function evaluates prepares data for the use in a distance transform.
    The input values are interpreted differently depending on the input data type:
@@ -21,6 +21,8 @@
 #include <vector>
 #include <memory>
 #include <cstdlib>
+#include <cassert>
+#include <stdexcept>
 #include <boost/call_traits.hpp>
 #include <mia/core/msgstream.hh>
 
@@ -37,15 +39,150 @@ TFifoFilter<T>::TFifoFilter(size_t filter_width, size_t min_fill, size_t read_st
 	m_fill(0), 
 	m_start_slice(0), 
 	m_end_slice(0), 
-	m_initialized(false)
+	m_initialized(false), 
+	m_pipeline_length(0), 
+	m_queue_length(0), 
+	m_failed(false), 
+	m_pipeline_state(ps_running)
 {
 }
 
+/*
+  The worker thread of this filter, if any, was already joined by the filter in front 
+  of it. The threads of the attached filters must be joined now, because they are 
+  still fully constructed. 
+*/
+template <typename T> 
+TFifoFilter<T>::~TFifoFilter()
+{
+	if (m_chain) 
+		m_chain->shutdown(); 
+	assert(!m_worker.joinable() && "Hint: a pipelined filter must not be destroyed before the filter in front of it"); 
+}
+
+template <typename T> 
+void TFifoFilter<T>::set_pipelined(size_t queue_length)
+{
+	m_pipeline_length = queue_length; 
+	if (m_chain) 
+		m_chain->set_input_queue(queue_length); 
+}
+
+template <typename T> 
+void TFifoFilter<T>::set_input_queue(size_t queue_length)
+{
+	assert(!m_worker.joinable() && "Hint: don't change the execution mode while data is processed"); 
+	m_queue_length = queue_length; 
+	set_pipelined(queue_length); 
+}
+
 template <typename T> 
 void TFifoFilter<T>::push(typename ::boost::call_traits<T>::param_type x)
 {
 	TRACE_FUNCTION; 
 
+	if (m_failed) 
+		throw std::logic_error("TFifoFilter: the processing failed, call finalize() before pushing new data"); 
+
+	if (!m_queue_length) {
+		try {
+			process(x); 
+		}
+		catch (...) {
+			m_failed = true; 
+			throw; 
+		}
+		return; 
+	}
+
+	std::unique_lock<std::mutex> lock(m_queue_mutex); 
+	if (!m_worker.joinable()) {
+		m_pipeline_state = ps_running; 
+		m_worker = std::thread(&TFifoFilter<T>::run_pipeline, this); 
+	}
+
+	m_queue_changed.wait(lock, [this]{
+			return m_queue.size() < m_queue_length || m_pipeline_error; 
+		}); 
+
+	if (m_pipeline_error) {
+		// the worker has already quit 
+		lock.unlock(); 
+		m_worker.join(); 
+		m_failed = true; 
+		auto error = m_pipeline_error; 
+		m_pipeline_error = nullptr; 
+		std::rethrow_exception(error); 
+	}
+
+	m_queue.push_back(x); 
+	m_queue_changed.notify_all(); 
+}
+
+template <typename T> 
+void TFifoFilter<T>::run_pipeline()
+{
+	try {
+		while (true) {
+			std::unique_lock<std::mutex> lock(m_queue_mutex); 
+			m_queue_changed.wait(lock, [this]{
+					return !m_queue.empty() || m_pipeline_state != ps_running; 
+				}); 
+
+			if (m_pipeline_state == ps_stopping) 
+				return; 
+
+			if (m_queue.empty()) 
+				break; 
+
+			T x = m_queue.front(); 
+			m_queue.pop_front(); 
+			m_queue_changed.notify_all(); 
+			lock.unlock(); 
+			
+			process(x); 
+		}
+		process_final(); 
+	}
+	catch (...) {
+		{
+			std::unique_lock<std::mutex> lock(m_queue_mutex); 
+			m_pipeline_error = std::current_exception(); 
+			m_queue.clear(); 
+			m_queue_changed.notify_all(); 
+		}
+		// the data that is still in the chain will not be finalized 
+		if (m_chain) 
+			m_chain->shutdown(); 
+	}
+}
+
+template <typename T> 
+void TFifoFilter<T>::shutdown()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_queue_mutex); 
+		m_pipeline_state = ps_stopping; 
+		m_queue_changed.notify_all(); 
+	}
+	if (m_worker.joinable()) 
+		m_worker.join(); 
+
+	m_queue.clear(); 
+	m_pipeline_error = nullptr; 
+	m_failed = false; 
+	m_fill = 0; 
+	m_initialized = false; 
+
+	if (m_chain) 
+		m_chain->shutdown(); 
+}
+
+template <typename T> 
+void TFifoFilter<T>::process(typename ::boost::call_traits<T>::param_type x)
+{
+	TRACE_FUNCTION; 
+
 	if (!m_initialized) {
 		do_initialize(x); 
 		m_initialized = true; 
@@ -117,6 +254,46 @@ size_t TFifoFilter<T>::get_pos() const
 
 template <typename T> 
 void TFifoFilter<T>::finalize()
+{
+	TRACE_FUNCTION; 
+
+	if (m_failed) {
+		// the data in the chain is incomplete, only tear it down 
+		shutdown(); 
+		return; 
+	}
+	{
+		std::unique_lock<std::mutex> lock(m_queue_mutex); 
+		if (m_worker.joinable()) {
+			m_pipeline_state = ps_finishing; 
+			m_queue_changed.notify_all(); 
+		}
+	}
+
+	if (!m_worker.joinable()) {
+		// sequential processing, or no data was pushed 
+		try {
+			process_final(); 
+		}
+		catch (...) {
+			m_failed = true; 
+			throw; 
+		}
+		return; 
+	}
+
+	m_worker.join(); 
+
+	if (m_pipeline_error) {
+		m_failed = true; 
+		auto error = m_pipeline_error; 
+		m_pipeline_error = nullptr; 
+		std::rethrow_exception(error); 
+	}
+}
+
+template <typename T> 
+void TFifoFilter<T>::process_final()
 {
 	TRACE_FUNCTION; 
 	size_t overfill = m_read_start; 
@@ -194,6 +371,9 @@ void TFifoFilter<T>::append_filter(typename TFifoFilter<T>::Pointer last)
 {
 	TRACE("TFifoFilter<T>::append_filter"); 
 
+	if (m_pipeline_length) 
+		last->set_input_queue(m_pipeline_length); 
+
 	if (!m_chain) 
 		m_chain = last; 
 	else {
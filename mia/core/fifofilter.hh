@@ -24,6 +24,11 @@
 #include <vector>
 #include <memory>
 #include <cstdlib>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
 #include <boost/call_traits.hpp>
 #include <mia/core/msgstream.hh>
 
@@ -46,6 +51,17 @@ NS_MIA_BEGIN
 
   Base class for a First-in-first out filter that does not need
   the whole data to be loaded.
+
+  By default a data element that is pushed into the filter runs through all filters
+  of the chain before push() returns. With set_pipelined() each filter that is attached
+  to this filter processes its input in its own thread instead, and the filters are
+  connected by bounded queues. Then the filters of the chain work concurrently, and the
+  filter that the data is pushed into can already process the next data element while
+  the previous ones are still processed further down the chain.
+
+  The threads of the attached filters are started, stopped, and joined by the filter in
+  front of them, i.e. when a filter is destroyed all threads of the filters attached to
+  it are joined before any of these filters is destroyed.
 */
 
 template <typename T>
@@ -67,20 +83,52 @@ public:
        TFifoFilter(size_t width, size_t min_fill, size_t read_start);
 
        /**
-         Push a data element down the filter pipeline
+          Destructor. If the filter was run pipelined and finalize() was not called,
+          then the processing of the remaining data is abandoned by calling shutdown()
+          for the attached filters.
+        */
+       virtual ~TFifoFilter();
+
+       /**
+         Push a data element down the filter pipeline. If the processing failed, then
+         push() must not be called again before the chain was reset by finalize().
          \param x data element
        */
        void push(typename ::boost::call_traits<T>::param_type x);
 
        /**
-         Initiate the processing of the final slices in the pipeline
+         Initiate the processing of the final slices in the pipeline. If pushing a data
+         element failed before, then the final slices are not processed, and the chain is
+         only reset by calling shutdown().
        */
        void finalize();
 
        /**
-         Attach a filter at the end of the filter chain
+          Stop the processing in this filter and all filters attached to it, wait for their
+          threads to finish, and discard the data that was not yet processed. Afterwards
+          the filters can be used again.
+       */
+       void shutdown();
+
+       /**
+         Attach a filter at the end of the filter chain. If this filter is run pipelined
+         then the attached filter will also be run pipelined.
        */
        void append_filter(Pointer last);
+
+       /**
+          Run the filters attached to this filter in a pipeline, i.e. this filter processes
+          its input in the thread that calls push(), and each attached filter processes its
+          input in its own thread. push() returns after this filter processed the data
+          element and queued its output, unless the queue is full, and finalize() returns
+          after all data was processed by the whole chain. An exception thrown while
+          processing the data is re-thrown by the next call to push() or by finalize().
+          Since the filters of the chain are run in different threads, the results of the
+          last filter must only be accessed after finalize() returned.
+          \param queue_length maximum number of data elements that wait in front of
+          each attached filter, 0 switches back to the sequential processing
+       */
+       void set_pipelined(size_t queue_length);
 protected:
        /// \returns the current buffer fill
        size_t get_pos() const;
@@ -135,6 +183,20 @@ private:
        */
        virtual void evaluate(size_t slice);
 
+       /// push a data element through this filter in the calling thread
+       void process(typename ::boost::call_traits<T>::param_type x);
+
+       /// process the final slices in the calling thread
+       void process_final();
+
+       /// the worker thread of the pipelined processing
+       void run_pipeline();
+
+       /// run this filter and the filters attached to it each in its own thread
+       void set_input_queue(size_t queue_length);
+
+       /// state of the pipelined processing
+       enum EPipelineState {ps_running, ps_finishing, ps_stopping};
 
        size_t m_buf_size;
        size_t m_min_fill;
@@ -144,6 +206,16 @@ private:
        size_t m_end_slice;
        Pointer m_chain;
        bool m_initialized;
+
+       size_t m_pipeline_length;
+       size_t m_queue_length;
+       bool m_failed;
+       std::deque<T> m_queue;
+       EPipelineState m_pipeline_state;
+       std::exception_ptr m_pipeline_error;
+       std::mutex m_queue_mutex;
+       std::condition_variable m_queue_changed;
+       std::thread m_worker;
 };
 
 /**
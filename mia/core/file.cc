@@ -18,6 +18,8 @@
  *
  */
 
+#include <config.h>
+
 #include <cerrno>
 #include <cstring>
 
@@ -26,7 +28,22 @@
 #include <stdexcept>
 #include <stdexcept>
 #include <map>
+#include <algorithm>
 #include <set>
+#include <memory>
+
+// fopencookie is needed to provide the in-process codecs as stdio streams
+#if !defined(WIN32) && defined(__GLIBC__) && (defined(HAVE_ZLIB) || defined(HAVE_LZMA))
+#define USE_INPROCESS_CODECS 1
+#endif
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef HAVE_LZMA
+#include <lzma.h>
+#endif
 
 #include <boost/filesystem.hpp>
 #include <boost/tokenizer.hpp>
@@ -34,6 +51,7 @@
 #include <mia/core/file.hh>
 #include <mia/core/errormacro.hh>
 #include <mia/core/msgstream.hh>
+#include <mia/core/parallel.hh>
 
 NS_MIA_BEGIN
 using namespace std;
@@ -165,6 +183,903 @@ set<string> recognized_sompression_suffixes{".gz", ".xz", ".bz2", ".Z"};
 
 #endif
 
+#ifdef USE_INPROCESS_CODECS
+
+/*
+  In-process (de)compression streams. They are exposed as stdio FILE pointers by means of
+  fopencookie, so that the IO plug-ins can use them like any other file.
+*/
+class CCodecStream
+{
+public:
+       CCodecStream(const string& filename, FILE *file);
+       virtual ~CCodecStream();
+
+       virtual ssize_t read(char *buffer, size_t size);
+       virtual ssize_t write(const char *buffer, size_t size);
+       virtual void seek(off64_t& offset, int whence);
+
+       // finish the stream and close the underlying file
+       virtual void close();
+
+       /*
+          Create a FILE pointer that routes the IO through the stream, the stream is
+          owned by the FILE and deleted by fclose.
+       */
+       static FILE *open(CCodecStream *stream, bool write);
+
+protected:
+       const string& get_filename() const;
+       FILE *get_file() const;
+
+       void read_compressed(void *buffer, size_t size);
+       void write_compressed(const void *buffer, size_t size);
+       void seek_compressed(off64_t pos);
+
+       [[noreturn]] void fail(const string& what) const;
+private:
+       static ssize_t cookie_read(void *cookie, char *buffer, size_t size);
+       static ssize_t cookie_write(void *cookie, const char *buffer, size_t size);
+       static int cookie_seek(void *cookie, off64_t *offset, int whence);
+       static int cookie_close(void *cookie);
+
+       string m_filename;
+       FILE *m_file;
+};
+
+CCodecStream::CCodecStream(const string& filename, FILE *file):
+       m_filename(filename),
+       m_file(file)
+{
+}
+
+CCodecStream::~CCodecStream()
+{
+       if (m_file)
+              fclose(m_file);
+}
+
+ssize_t CCodecStream::read(char *MIA_PARAM_UNUSED(buffer), size_t MIA_PARAM_UNUSED(size))
+{
+       fail("stream is not open for reading");
+}
+
+ssize_t CCodecStream::write(const char *MIA_PARAM_UNUSED(buffer), size_t MIA_PARAM_UNUSED(size))
+{
+       fail("stream is not open for writing");
+}
+
+void CCodecStream::seek(off64_t& MIA_PARAM_UNUSED(offset), int MIA_PARAM_UNUSED(whence))
+{
+       fail("stream doesn't support seeking");
+}
+
+void CCodecStream::close()
+{
+       FILE *file = m_file;
+       m_file = nullptr;
+
+       if (fclose(file) != 0)
+              fail(strerror(errno));
+}
+
+const string& CCodecStream::get_filename() const
+{
+       return m_filename;
+}
+
+FILE *CCodecStream::get_file() const
+{
+       return m_file;
+}
+
+void CCodecStream::read_compressed(void *buffer, size_t size)
+{
+       if (fread(buffer, 1, size, m_file) != size)
+              fail(ferror(m_file) ? strerror(errno) : "unexpected end of file");
+}
+
+void CCodecStream::write_compressed(const void *buffer, size_t size)
+{
+       if (fwrite(buffer, 1, size, m_file) != size)
+              fail(strerror(errno));
+}
+
+void CCodecStream::seek_compressed(off64_t pos)
+{
+       if (fseeko(m_file, pos, SEEK_SET) != 0)
+              fail(strerror(errno));
+}
+
+void CCodecStream::fail(const string& what) const
+{
+       throw create_exception<runtime_error>(m_filename, ": ", what);
+}
+
+FILE *CCodecStream::open(CCodecStream *stream, bool write)
+{
+       cookie_io_functions_t io = {cookie_read, cookie_write, cookie_seek, cookie_close};
+       FILE *result = fopencookie(stream, write ? "w" : "r", io);
+
+       if (!result)
+              delete stream;
+
+       return result;
+}
+
+/*
+  The stdio callbacks must not throw, errors are reported to the message stream
+  and passed on as EIO.
+*/
+ssize_t CCodecStream::cookie_read(void *cookie, char *buffer, size_t size)
+{
+       try {
+              return static_cast<CCodecStream *>(cookie)->read(buffer, size);
+       } catch (std::exception& x) {
+              cverr() << x.what() << "\n";
+              errno = EIO;
+              return -1;
+       }
+}
+
+ssize_t CCodecStream::cookie_write(void *cookie, const char *buffer, size_t size)
+{
+       try {
+              return static_cast<CCodecStream *>(cookie)->write(buffer, size);
+       } catch (std::exception& x) {
+              cverr() << x.what() << "\n";
+              errno = EIO;
+              // glibc expects 0 to signal a write error
+              return 0;
+       }
+}
+
+int CCodecStream::cookie_seek(void *cookie, off64_t *offset, int whence)
+{
+       try {
+              static_cast<CCodecStream *>(cookie)->seek(*offset, whence);
+              return 0;
+       } catch (std::invalid_argument& x) {
+              cvdebug() << x.what() << "\n";
+              errno = EINVAL;
+              return -1;
+       } catch (std::exception& x) {
+              cverr() << x.what() << "\n";
+              errno = EIO;
+              return -1;
+       }
+}
+
+int CCodecStream::cookie_close(void *cookie)
+{
+       unique_ptr<CCodecStream> stream(static_cast<CCodecStream *>(cookie));
+
+       try {
+              stream->close();
+              return 0;
+       } catch (std::exception& x) {
+              cverr() << x.what() << "\n";
+              errno = EIO;
+              return -1;
+       }
+}
+
+
+/*
+  Base class for the decoders that can only read the data in sequence. Seeking forward
+  decodes and drops the data, seeking backwards restarts decoding from the beginning.
+*/
+class CSequentialDecoder: public CCodecStream
+{
+public:
+       CSequentialDecoder(const string& filename, FILE *file);
+       ssize_t read(char *buffer, size_t size) override;
+       void seek(off64_t& offset, int whence) override;
+private:
+       // decode up to size bytes, returns 0 at the end of the data
+       virtual size_t decode(char *buffer, size_t size) = 0;
+
+       // restart decoding at the beginning of the file
+       virtual void rewind() = 0;
+
+       off64_t m_pos;
+};
+
+CSequentialDecoder::CSequentialDecoder(const string& filename, FILE *file):
+       CCodecStream(filename, file),
+       m_pos(0)
+{
+}
+
+ssize_t CSequentialDecoder::read(char *buffer, size_t size)
+{
+       size_t n = decode(buffer, size);
+       m_pos += n;
+       return n;
+}
+
+void CSequentialDecoder::seek(off64_t& offset, int whence)
+{
+       const bool to_end = whence == SEEK_END;
+       off64_t target = whence == SEEK_CUR ? m_pos + offset : offset;
+
+       if (!to_end && target < 0)
+              throw create_exception<invalid_argument>(get_filename(), ": seek before the beginning of the data");
+
+       if (!to_end && target < m_pos) {
+              rewind();
+              m_pos = 0;
+       }
+
+       vector<char> skip(64 * 1024);
+
+       while (to_end || m_pos < target) {
+              const size_t n = decode(&skip[0], to_end ? skip.size() : min<off64_t>(skip.size(), target - m_pos));
+
+              if (n == 0)
+                     break;
+
+              m_pos += n;
+       }
+
+       if (to_end)
+              target = m_pos + offset;
+
+       if (target < 0 || target > m_pos)
+              throw create_exception<invalid_argument>(get_filename(), ": seek outside the decompressed data");
+
+       if (target < m_pos) {
+              rewind();
+              m_pos = 0;
+              off64_t start = target;
+              seek(start, SEEK_SET);
+       }
+
+       offset = m_pos;
+}
+
+#ifdef HAVE_ZLIB
+
+/*
+  The gzip files are written as a series of independent gzip members that each hold
+  gzip_block_size bytes of data. This lets the members be compressed and decompressed in
+  parallel. Each member header carries an extra field with the compressed size of the member,
+  so that the members can be located without decompressing the data, and since the gzip
+  trailer gives the uncompressed size, any position in the data can be reached directly.
+  Any gzip decompressor can read these files, because concatenated members are part of
+  the gzip standard (RFC 1952).
+*/
+static const size_t gzip_block_size = 1024 * 1024;
+
+// header with the FEXTRA flag and one extra subfield ('M', 'A', 4 bytes compressed member size)
+static const size_t gzip_member_header_size = 20;
+static const size_t gzip_member_trailer_size = 8;
+
+static void store_le32(unsigned char *p, uint32_t value)
+{
+       for (int i = 0; i < 4; ++i, value >>= 8)
+              p[i] = value & 0xff;
+}
+
+static uint32_t load_le32(const unsigned char *p)
+{
+       return p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24);
+}
+
+// returns the compressed size of the member or 0 if the header was not written by gzip_compress_block
+static uint32_t gzip_member_size(const unsigned char *header)
+{
+       const unsigned char expect[] = {0x1f, 0x8b, 8, 4};
+
+       if (memcmp(header, expect, sizeof(expect)) != 0 ||
+           header[10] != 8 || header[11] != 0 || header[12] != 'M' || header[13] != 'A' ||
+           header[14] != 4 || header[15] != 0)
+              return 0;
+
+       return load_le32(header + 16);
+}
+
+static vector<unsigned char> gzip_compress_block(const char *data, size_t size, int level)
+{
+       z_stream zs;
+       memset(&zs, 0, sizeof(zs));
+
+       if (deflateInit2(&zs, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+              throw create_exception<runtime_error>("gzip: ", zs.msg ? zs.msg : "unable to initialize compression");
+
+       vector<unsigned char> result(gzip_member_header_size + deflateBound(&zs, size) + gzip_member_trailer_size);
+       zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+       zs.avail_in = size;
+       zs.next_out = &result[gzip_member_header_size];
+       zs.avail_out = result.size() - gzip_member_header_size - gzip_member_trailer_size;
+       const int status = deflate(&zs, Z_FINISH);
+       const size_t compressed_size = zs.total_out;
+       deflateEnd(&zs);
+
+       if (status != Z_STREAM_END)
+              throw create_exception<runtime_error>("gzip: compression failed with error ", status);
+
+       const size_t member_size = gzip_member_header_size + compressed_size + gzip_member_trailer_size;
+       result.resize(member_size);
+       // ID1, ID2, CM = deflate, FLG = FEXTRA, MTIME = 0, XFL = 0, OS = unix, XLEN = 8
+       const unsigned char header[] = {0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 3, 8, 0, 'M', 'A', 4, 0};
+       copy(header, header + sizeof(header), result.begin());
+       store_le32(&result[16], member_size);
+       unsigned char *trailer = &result[member_size - gzip_member_trailer_size];
+       store_le32(trailer, crc32(crc32(0, Z_NULL, 0), reinterpret_cast<const Bytef *>(data), size));
+       store_le32(trailer + 4, size);
+       return result;
+}
+
+class CGzipWriter: public CCodecStream
+{
+public:
+       CGzipWriter(const string& filename, FILE *file);
+       ssize_t write(const char *buffer, size_t size) override;
+       void seek(off64_t& offset, int whence) override;
+       void close() override;
+private:
+       void flush_blocks();
+
+       vector<char> m_data;
+       size_t m_batch_size;
+       off64_t m_pos;
+       bool m_written;
+};
+
+CGzipWriter::CGzipWriter(const string& filename, FILE *file):
+       CCodecStream(filename, file),
+       m_batch_size(get_max_parallel_tasks()),
+       m_pos(0),
+       m_written(false)
+{
+       m_data.reserve(m_batch_size * gzip_block_size);
+}
+
+ssize_t CGzipWriter::write(const char *buffer, size_t size)
+{
+       size_t rest = size;
+
+       while (rest > 0) {
+              const size_t n = min(rest, m_batch_size * gzip_block_size - m_data.size());
+              m_data.insert(m_data.end(), buffer, buffer + n);
+              buffer += n;
+              rest -= n;
+
+              if (m_data.size() == m_batch_size * gzip_block_size)
+                     flush_blocks();
+       }
+
+       m_pos += size;
+       return size;
+}
+
+void CGzipWriter::seek(off64_t& offset, int whence)
+{
+       // only support telling the position
+       if (whence == SEEK_SET ? offset != m_pos : offset != 0)
+              CCodecStream::seek(offset, whence);
+
+       offset = m_pos;
+}
+
+void CGzipWriter::flush_blocks()
+{
+       const int n_blocks = (m_data.size() + gzip_block_size - 1) / gzip_block_size;
+       vector<vector<unsigned char>> members(n_blocks);
+       auto compress = [this, &members](const C1DParallelRange & range) {
+              for (auto i = range.begin(); i != range.end(); ++i) {
+                     const size_t start = i * gzip_block_size;
+                     members[i] = gzip_compress_block(&m_data[start], min(gzip_block_size, m_data.size() - start),
+                                                      Z_DEFAULT_COMPRESSION);
+              }
+       };
+       pfor(C1DParallelRange(0, n_blocks, 1), compress);
+
+       for (auto& m : members)
+              write_compressed(&m[0], m.size());
+
+       m_written |= n_blocks > 0;
+       m_data.clear();
+}
+
+void CGzipWriter::close()
+{
+       flush_blocks();
+
+       // an empty file must still be a valid gzip file
+       if (!m_written) {
+              auto m = gzip_compress_block(nullptr, 0, Z_DEFAULT_COMPRESSION);
+              write_compressed(&m[0], m.size());
+       }
+
+       CCodecStream::close();
+}
+
+/*
+  Reader for the gzip files written by CGzipWriter. The members are located by their
+  headers, and the members are decompressed in parallel in batches.
+*/
+class CGzipBlockReader: public CCodecStream
+{
+public:
+       /*
+          Create the reader if the file was written by CGzipWriter, otherwise return NULL.
+          The file position is reset to the beginning.
+       */
+       static CGzipBlockReader *create(const string& filename, FILE *file);
+
+       ssize_t read(char *buffer, size_t size) override;
+       void seek(off64_t& offset, int whence) override;
+private:
+       struct SMember {
+              off64_t compressed_start;
+              uint32_t compressed_size;
+              off64_t start;
+              uint32_t size;
+       };
+
+       CGzipBlockReader(const string& filename, FILE *file, vector<SMember>&& members);
+
+       void decode_batch(size_t first);
+       void decode_member(const vector<unsigned char>& compressed, vector<char>& data) const;
+
+       vector<SMember> m_members;
+       off64_t m_size;
+       off64_t m_pos;
+       size_t m_first_decoded;
+       vector<vector<char>> m_decoded;
+};
+
+CGzipBlockReader *CGzipBlockReader::create(const string& filename, FILE *file)
+{
+       vector<SMember> members;
+       off64_t compressed_start = 0;
+       off64_t start = 0;
+       unsigned char header[gzip_member_header_size];
+       CGzipBlockReader *result = nullptr;
+
+       while (fread(header, 1, gzip_member_header_size, file) == gzip_member_header_size) {
+              SMember m = {compressed_start, gzip_member_size(header), start, 0};
+              unsigned char isize[4];
+
+              if (m.compressed_size < gzip_member_header_size + gzip_member_trailer_size ||
+                  fseeko(file, compressed_start + m.compressed_size - 4, SEEK_SET) != 0 ||
+                  fread(isize, 1, 4, file) != 4)
+                     break;
+
+              m.size = load_le32(isize);
+              members.push_back(m);
+              compressed_start += m.compressed_size;
+              start += m.size;
+       }
+
+       // the whole file must consist of members written by CGzipWriter
+       if (!members.empty() && feof(file) && ftello(file) == compressed_start)
+              result = new CGzipBlockReader(filename, file, move(members));
+
+       clearerr(file);
+       fseeko(file, 0, SEEK_SET);
+       return result;
+}
+
+CGzipBlockReader::CGzipBlockReader(const string& filename, FILE *file, vector<SMember>&& members):
+       CCodecStream(filename, file),
+       m_members(move(members)),
+       m_size(m_members.back().start + m_members.back().size),
+       m_pos(0),
+       m_first_decoded(0)
+{
+}
+
+ssize_t CGzipBlockReader::read(char *buffer, size_t size)
+{
+       size_t result = 0;
+
+       while (result < size && m_pos < m_size) {
+              auto m = upper_bound(m_members.begin(), m_members.end(), m_pos,
+              [](off64_t pos, const SMember & member) {
+                     return pos < member.start;
+              }) - 1;
+              const size_t idx = m - m_members.begin();
+
+              if (idx < m_first_decoded || idx >= m_first_decoded + m_decoded.size())
+                     decode_batch(idx);
+
+              const auto& data = m_decoded[idx - m_first_decoded];
+              const size_t offset = m_pos - m->start;
+              const size_t n = min(size - result, data.size() - offset);
+              memcpy(buffer + result, &data[offset], n);
+              result += n;
+              m_pos += n;
+       }
+
+       return result;
+}
+
+void CGzipBlockReader::seek(off64_t& offset, int whence)
+{
+       const off64_t target = offset + (whence == SEEK_SET ? 0 : (whence == SEEK_CUR ? m_pos : m_size));
+
+       if (target < 0 || target > m_size)
+              throw create_exception<invalid_argument>(get_filename(), ": seek outside the decompressed data");
+
+       m_pos = offset = target;
+}
+
+void CGzipBlockReader::decode_batch(size_t first)
+{
+       const size_t n = min<size_t>(get_max_parallel_tasks(), m_members.size() - first);
+       vector<vector<unsigned char>> compressed(n);
+       seek_compressed(m_members[first].compressed_start);
+
+       for (size_t i = 0; i < n; ++i) {
+              compressed[i].resize(m_members[first + i].compressed_size);
+              read_compressed(&compressed[i][0], compressed[i].size());
+       }
+
+       m_decoded.resize(n);
+       m_first_decoded = first;
+       auto decode = [this, &compressed](const C1DParallelRange & range) {
+              for (auto i = range.begin(); i != range.end(); ++i)
+                     decode_member(compressed[i], m_decoded[i]);
+       };
+       pfor(C1DParallelRange(0, n, 1), decode);
+}
+
+void CGzipBlockReader::decode_member(const vector<unsigned char>& compressed, vector<char>& data) const
+{
+       const unsigned char *trailer = &compressed[compressed.size() - gzip_member_trailer_size];
+       data.resize(load_le32(trailer + 4));
+       z_stream zs;
+       memset(&zs, 0, sizeof(zs));
+
+       if (inflateInit2(&zs, -MAX_WBITS) != Z_OK)
+              fail(string("gzip: ") + (zs.msg ? zs.msg : "unable to initialize decompression"));
+
+       zs.next_in = const_cast<Bytef *>(&compressed[gzip_member_header_size]);
+       zs.avail_in = compressed.size() - gzip_member_header_size - gzip_member_trailer_size;
+       zs.next_out = reinterpret_cast<Bytef *>(data.data());
+       zs.avail_out = data.size();
+       const int status = inflate(&zs, Z_FINISH);
+       const string msg = zs.msg ? zs.msg : "corrupt data";
+       const bool complete = zs.avail_out == 0 && zs.avail_in == 0;
+       inflateEnd(&zs);
+
+       if (status != Z_STREAM_END || !complete)
+              fail(string("gzip: ") + msg);
+
+       if (crc32(crc32(0, Z_NULL, 0), reinterpret_cast<const Bytef *>(data.data()), data.size()) != load_le32(trailer))
+              fail("gzip: CRC error");
+}
+
+/*
+  Reader for all other gzip files, the data is decompressed in one stream.
+*/
+class CGzipStreamReader: public CSequentialDecoder
+{
+public:
+       CGzipStreamReader(const string& filename, FILE *file);
+       ~CGzipStreamReader();
+private:
+       size_t decode(char *buffer, size_t size) override;
+       void rewind() override;
+
+       z_stream m_zs;
+       vector<unsigned char> m_in;
+       bool m_finished;
+};
+
+CGzipStreamReader::CGzipStreamReader(const string& filename, FILE *file):
+       CSequentialDecoder(filename, file),
+       m_in(256 * 1024),
+       m_finished(false)
+{
+       memset(&m_zs, 0, sizeof(m_zs));
+
+       // accept gzip and zlib headers
+       if (inflateInit2(&m_zs, MAX_WBITS + 32) != Z_OK)
+              fail("gzip: unable to initialize decompression");
+}
+
+CGzipStreamReader::~CGzipStreamReader()
+{
+       inflateEnd(&m_zs);
+}
+
+size_t CGzipStreamReader::decode(char *buffer, size_t size)
+{
+       m_zs.next_out = reinterpret_cast<Bytef *>(buffer);
+       m_zs.avail_out = size;
+
+       while (m_zs.avail_out > 0 && !m_finished) {
+              if (m_zs.avail_in == 0) {
+                     m_zs.avail_in = fread(&m_in[0], 1, m_in.size(), get_file());
+                     m_zs.next_in = &m_in[0];
+
+                     if (m_zs.avail_in == 0) {
+                            if (ferror(get_file()))
+                                   fail(strerror(errno));
+
+                            fail("gzip: unexpected end of file");
+                     }
+              }
+
+              const int status = inflate(&m_zs, Z_NO_FLUSH);
+
+              if (status == Z_STREAM_END) {
+                     // continue with the next member, if there is one
+                     if (m_zs.avail_in == 0) {
+                            m_zs.avail_in = fread(&m_in[0], 1, m_in.size(), get_file());
+                            m_zs.next_in = &m_in[0];
+                     }
+
+                     if (m_zs.avail_in > 0 && m_zs.next_in[0] == 0x1f)
+                            inflateReset(&m_zs);
+                     else
+                            m_finished = true;
+              } else if (status != Z_OK) {
+                     fail(string("gzip: ") + (m_zs.msg ? m_zs.msg : "corrupt data"));
+              }
+       }
+
+       return size - m_zs.avail_out;
+}
+
+void CGzipStreamReader::rewind()
+{
+       seek_compressed(0);
+       inflateReset(&m_zs);
+       m_zs.avail_in = 0;
+       m_finished = false;
+}
+
+static FILE *open_gzip(const string& filename, FILE *file, bool write)
+{
+       if (write)
+              return CCodecStream::open(new CGzipWriter(filename, file), true);
+
+       CCodecStream *reader = CGzipBlockReader::create(filename, file);
+
+       if (!reader)
+              reader = new CGzipStreamReader(filename, file);
+
+       return CCodecStream::open(reader, false);
+}
+
+#endif // HAVE_ZLIB
+
+#ifdef HAVE_LZMA
+
+// size of the independently compressed blocks that are handed to the threads
+static const uint64_t xz_block_size = 8 * 1024 * 1024;
+
+static string lzma_error(lzma_ret status)
+{
+       switch (status) {
+       case LZMA_MEM_ERROR:
+              return "xz: out of memory";
+
+       case LZMA_FORMAT_ERROR:
+              return "xz: file format not recognized";
+
+       case LZMA_DATA_ERROR:
+              return "xz: compressed data is corrupt";
+
+       case LZMA_BUF_ERROR:
+              return "xz: unexpected end of file";
+
+       case LZMA_UNSUPPORTED_CHECK:
+              return "xz: unsupported integrity check";
+
+       default:
+              return "xz: internal error " + to_string(status);
+       }
+}
+
+class CXzWriter: public CCodecStream
+{
+public:
+       CXzWriter(const string& filename, FILE *file);
+       ~CXzWriter();
+       ssize_t write(const char *buffer, size_t size) override;
+       void close() override;
+private:
+       void code(lzma_action action);
+
+       lzma_stream m_strm;
+       vector<uint8_t> m_out;
+};
+
+CXzWriter::CXzWriter(const string& filename, FILE *file):
+       CCodecStream(filename, file),
+       m_strm(LZMA_STREAM_INIT),
+       m_out(256 * 1024)
+{
+#if LZMA_VERSION >= 50020002
+       lzma_mt mt;
+       memset(&mt, 0, sizeof(mt));
+       mt.threads = get_max_parallel_tasks();
+       mt.block_size = xz_block_size;
+       mt.preset = LZMA_PRESET_DEFAULT;
+       mt.check = LZMA_CHECK_CRC64;
+       const lzma_ret status = mt.threads > 1 ? lzma_stream_encoder_mt(&m_strm, &mt) :
+                               lzma_easy_encoder(&m_strm, LZMA_PRESET_DEFAULT, LZMA_CHECK_CRC64);
+#else
+       const lzma_ret status = lzma_easy_encoder(&m_strm, LZMA_PRESET_DEFAULT, LZMA_CHECK_CRC64);
+#endif
+
+       if (status != LZMA_OK)
+              fail(lzma_error(status));
+}
+
+CXzWriter::~CXzWriter()
+{
+       lzma_end(&m_strm);
+}
+
+void CXzWriter::code(lzma_action action)
+{
+       lzma_ret status = LZMA_OK;
+
+       while (m_strm.avail_in > 0 || (action == LZMA_FINISH && status != LZMA_STREAM_END)) {
+              m_strm.next_out = &m_out[0];
+              m_strm.avail_out = m_out.size();
+              status = lzma_code(&m_strm, action);
+
+              if (status != LZMA_OK && status != LZMA_STREAM_END)
+                     fail(lzma_error(status));
+
+              write_compressed(&m_out[0], m_out.size() - m_strm.avail_out);
+       }
+}
+
+ssize_t CXzWriter::write(const char *buffer, size_t size)
+{
+       m_strm.next_in = reinterpret_cast<const uint8_t *>(buffer);
+       m_strm.avail_in = size;
+       code(LZMA_RUN);
+       return size;
+}
+
+void CXzWriter::close()
+{
+       code(LZMA_FINISH);
+       CCodecStream::close();
+}
+
+class CXzReader: public CSequentialDecoder
+{
+public:
+       CXzReader(const string& filename, FILE *file);
+       ~CXzReader();
+private:
+       void init();
+       size_t decode(char *buffer, size_t size) override;
+       void rewind() override;
+
+       lzma_stream m_strm;
+       vector<uint8_t> m_in;
+       bool m_finished;
+};
+
+CXzReader::CXzReader(const string& filename, FILE *file):
+       CSequentialDecoder(filename, file),
+       m_strm(LZMA_STREAM_INIT),
+       m_in(256 * 1024),
+       m_finished(false)
+{
+       init();
+}
+
+CXzReader::~CXzReader()
+{
+       lzma_end(&m_strm);
+}
+
+void CXzReader::init()
+{
+#if LZMA_VERSION >= 50040000
+       // the blocks of files written by multi-threaded encoders are decoded in parallel
+       lzma_mt mt;
+       memset(&mt, 0, sizeof(mt));
+       mt.flags = LZMA_CONCATENATED;
+       mt.threads = get_max_parallel_tasks();
+       mt.memlimit_threading = lzma_physmem() / 4;
+       mt.memlimit_stop = UINT64_MAX;
+       const lzma_ret status = lzma_stream_decoder_mt(&m_strm, &mt);
+#else
+       const lzma_ret status = lzma_stream_decoder(&m_strm, UINT64_MAX, LZMA_CONCATENATED);
+#endif
+
+       if (status != LZMA_OK)
+              fail(lzma_error(status));
+}
+
+size_t CXzReader::decode(char *buffer, size_t size)
+{
+       m_strm.next_out = reinterpret_cast<uint8_t *>(buffer);
+       m_strm.avail_out = size;
+
+       while (m_strm.avail_out > 0 && !m_finished) {
+              if (m_strm.avail_in == 0) {
+                     m_strm.next_in = &m_in[0];
+                     m_strm.avail_in = fread(&m_in[0], 1, m_in.size(), get_file());
+
+                     if (ferror(get_file()))
+                            fail(strerror(errno));
+              }
+
+              // once all input is read the decoder must be told to finish
+              const lzma_ret status = lzma_code(&m_strm, feof(get_file()) ? LZMA_FINISH : LZMA_RUN);
+
+              if (status == LZMA_STREAM_END)
+                     m_finished = true;
+              else if (status != LZMA_OK)
+                     fail(lzma_error(status));
+       }
+
+       return size - m_strm.avail_out;
+}
+
+void CXzReader::rewind()
+{
+       seek_compressed(0);
+       lzma_end(&m_strm);
+       m_strm = LZMA_STREAM_INIT;
+       m_finished = false;
+       init();
+}
+
+static FILE *open_xz(const string& filename, FILE *file, bool write)
+{
+       if (write)
+              return CCodecStream::open(new CXzWriter(filename, file), true);
+
+       return CCodecStream::open(new CXzReader(filename, file), false);
+}
+
+#endif // HAVE_LZMA
+
+/*
+  Open a compressed file with an in-process codec, returns NULL if no codec is
+  available for the suffix.
+*/
+static FILE *open_compressed(const string& filename, const string& suffix, bool write)
+{
+       typedef FILE *(*FOpen)(const string& filename, FILE * file, bool write);
+       FOpen open_codec = nullptr;
+#ifdef HAVE_ZLIB
+
+       if (suffix == ".gz")
+              open_codec = open_gzip;
+
+#endif
+#ifdef HAVE_LZMA
+
+       if (suffix == ".xz")
+              open_codec = open_xz;
+
+#endif
+
+       if (!open_codec)
+              return nullptr;
+
+       FILE *file = fopen(filename.c_str(), write ? "wb" : "rb");
+
+       if (!file)
+              throw create_exception<runtime_error>(filename, ":", strerror(errno));
+
+       FILE *result = open_codec(filename, file, write);
+
+       if (!result)
+              throw create_exception<runtime_error>(filename, ": unable to create the (de)compression stream");
+
+       return result;
+}
+
+#endif // USE_INPROCESS_CODECS
+
 CFile::CFile(const string& filename, bool from_stdio, bool write):
        m_must_close(!from_stdio),
        m_is_pipe(false),
@@ -183,8 +1098,13 @@ CFile::CFile(const string& filename, bool from_stdio, bool write):
               m_file = fopen (filename.c_str(), write ? "wb" : "rb");
        } else {
               cvdebug() << "Try using a (de)compressor for type " << suffix << "\n";
+#ifdef USE_INPROCESS_CODECS
+              m_file = open_compressed(filename, suffix, write);
+#endif
 
-              if (!write) {
+              if (m_file) {
+                     cvdebug() << "Use in-process (de)compression for '" << filename << "'\n";
+              } else if (!write) {
                      string pipe;
                      auto dcprogname = ExternalCompressors::instance().has_decompressor(suffix);
                      m_is_pipe = true;
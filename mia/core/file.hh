@@ -42,6 +42,12 @@ typedef FILE *PFILE;
    possible that the file is closed autmatically when the scope of the file variable is left.
    A variable of this type can be used with all the C-stdio functions that take a file
    pointer as argument.
+
+   Files with the suffixes .gz and .xz are compressed and decompressed on the fly. If
+   zlib and liblzma are available this is done in-process: the data is compressed in
+   blocks in parallel, and reading supports seeking. Files written as .gz can be read
+   by any gzip decompressor. For the other compressed formats (.bz2, .Z), or if the
+   libraries are not available, the data is piped through external programs.
 */
 class EXPORT_CORE CFile
 {
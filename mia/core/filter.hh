@@ -25,6 +25,7 @@
 #include <stdexcept>
 #include <mia/core/pixeltype.hh>
 #include <mia/core/product_base.hh>
+#include <mia/core/profiling.hh>
 #include <mia/core/factory.hh>
 #include <mia/core/import_handler.hh>
 
@@ -120,12 +121,23 @@ public:
           \returns the possible pixel types after running the pipeline
         */
        std::set<EPixelType> test_pixeltype_conversion(const std::set<EPixelType>& in_types) const;
+
+       /**
+          Get the radius of the neighborhood that is needed to evaluate one output value.
+          Filters with a finite radius can be run on sub-blocks of the input data
+          that are padded by this halo width.
+          \returns the support radius in pixels along each axis, or -1 if the
+          result may depend on the whole input (the default)
+        */
+       int get_support_radius() const;
 private:
        virtual result_type do_filter(const Image& image) const = 0;
        virtual result_type do_filter(std::shared_ptr<D> image) const;
 
        virtual std::set<EPixelType> do_test_pixeltype_conversion(const std::set<EPixelType>& in_type) const;
 
+       virtual int do_get_support_radius() const;
+
 };
 
 template <class D>
@@ -166,6 +178,22 @@ private:
               return result;
        }
 
+       int do_get_support_radius() const
+       {
+              int result = 0;
+
+              for (auto f : m_chain) {
+                     int r = f->get_support_radius();
+
+                     if (r < 0)
+                            return -1;
+
+                     result += r;
+              }
+
+              return result;
+       }
+
        std::vector<Pointer> m_chain;
 };
 
@@ -924,6 +952,7 @@ template <class D>
 typename TDataFilter<D>::result_type
 TDataFilter<D>::filter(const D& image) const
 {
+       MIA_PROFILE_SCOPE("filter", *this);
        return do_filter(image);
 }
 
@@ -931,6 +960,7 @@ template <class D>
 typename TDataFilter<D>::result_type
 TDataFilter<D>::filter(std::shared_ptr<D> pimage) const
 {
+       MIA_PROFILE_SCOPE("filter", *this);
        return do_filter(pimage);
 }
 
@@ -956,6 +986,18 @@ TDataFilter<D>::do_test_pixeltype_conversion(const std::set<EPixelType>& in_type
        return in_types;
 }
 
+template <class D>
+int TDataFilter<D>::get_support_radius() const
+{
+       return do_get_support_radius();
+}
+
+template <class D>
+int TDataFilter<D>::do_get_support_radius() const
+{
+       return -1;
+}
+
 
 NS_MIA_END
 
@@ -32,6 +32,7 @@
 
 #include <mia/core/module.hh>
 #include <mia/core/plugin_base.hh>
+#include <mia/core/plugincache.hh>
 #include <mia/core/msgstream.hh>
 #include <mia/core/xmlinterface.hh>
 
@@ -59,82 +60,149 @@ void TPluginHandler<I>::initialise(const CPluginSearchpath& searchpath)
 {
 	TRACE_FUNCTION; 
 
-	m_modules = searchpath.find_modules(I::get_data_path_part(), I::get_type_path_part()); 
-	
+	auto module_files = searchpath.find_module_files(I::get_data_path_part(), I::get_type_path_part()); 
+	CPluginCache cache(I::get_data_path_part(), I::get_type_path_part(), module_files); 
+
+	if (cache.read(m_unloaded)) {
+		// the modules are only loaded when one of their plug-ins is requested 
+		cvdebug() << "Use plug-in cache '" << cache.get_filename() << "'\n"; 
+	} else {
+		for (auto f = module_files.begin(); f != module_files.end(); ++f) {
+			try {
+				cvdebug() << " Load '" << *f << "'\n";
+				m_modules.push_back(PPluginModule(new CPluginModule(f->c_str()))); 
+				add_plugins_from_module(m_modules.back()); 
+			} catch (std::exception& ex) {
+				cverr() << ex.what() << "\n";
+			} catch (...) {
+				cverr() << "Loading module " << *f << " failed for unknown reasons\n";
+			}
+		}
+		
+		CPluginCache::CModuleMap index; 
+		for (auto p = m_plugins.begin(); p != m_plugins.end(); ++p) {
+			if (p->second->get_module())
+				index[p->first] = p->second->get_module()->get_name(); 
+		}
+		cache.write(index); 
+	}
+	do_initialise(); 
+}
 
+template <typename I>
+void TPluginHandler<I>::add_plugins_from_module(PPluginModule& module)
+{
 	// now try to load the interfaces and put them in the map
-	for (auto i = m_modules.begin(); i != m_modules.end(); ++i) {
-		try {
-			CPluginBase *pp = (*i)->get_interface();
-			if (!pp) 
-				cverr() << "Module '" << (*i)->get_name() << "' doesn't provide an interface\n"; 
+	try {
+		CPluginBase *pp = module->get_interface();
+		if (!pp) 
+			cverr() << "Module '" << module->get_name() << "' doesn't provide an interface\n"; 
+		
+		while (pp) {
+			cvdebug() << "Got type '" << typeid(*pp).name() 
+				  << "', expect '"<< typeid(Interface).name() << "'\n"; 
+			Interface *p = dynamic_cast<Interface*>(pp); 
+			CPluginBase *pold = pp; 
 			
-			while (pp) {
-				cvdebug() << "Got type '" << typeid(*pp).name() 
-					  << "', expect '"<< typeid(Interface).name() << "'\n"; 
-				Interface *p = dynamic_cast<Interface*>(pp); 
-				CPluginBase *pold = pp; 
-				
-				pp = pp->next_interface(); 
-				
-				if (p) {
-					cvdebug() << "add plugin '" << p->get_name() << "'\n"; 
-
-					auto loaded_plugin_i = m_plugins.find(p->get_name()); 
-					if ( loaded_plugin_i ==  m_plugins.end()) {
-						p->set_module(*i);
-						add_plugin_internal(PInterface(p)); 
-
+			pp = pp->next_interface(); 
+			
+			if (p) {
+				cvdebug() << "add plugin '" << p->get_name() << "'\n"; 
+
+				auto loaded_plugin_i = m_plugins.find(p->get_name()); 
+				if ( loaded_plugin_i ==  m_plugins.end()) {
+					p->set_module(module);
+					add_plugin_internal(PInterface(p)); 
+
+					// since this module will be used 
+					// keep its module till the final cleanup 
+					module->set_keep_library(); 
+				} else {
+					auto loaded_plugin = loaded_plugin_i->second; 
+					if (loaded_plugin->get_priority() < p->get_priority()) {
+						cvwarn() << "Plugin with name '" << p->get_name() 
+							 << "' and priority '" <<  p->get_priority() 
+							 << "' overrides already loaded plugin\n"; 
+						p->set_module(module);
+						
 						// since this module will be used 
 						// keep its module till the final cleanup 
-						(*i)->set_keep_library(); 
-					} else {
-						auto loaded_plugin = loaded_plugin_i->second; 
-						if (loaded_plugin->get_priority() < p->get_priority()) {
-							cvwarn() << "Plugin with name '" << p->get_name() 
-								 << "' and priority '" <<  p->get_priority() 
-								 << "' overrides already loaded plugin\n"; 
-							p->set_module(*i);
+						module->set_keep_library(); 
 							
-							// since this module will be used 
-							// keep its module till the final cleanup 
-							(*i)->set_keep_library(); 
-								
-							*i = loaded_plugin->get_module(); 
-							add_plugin_internal(PInterface(p)); 
-						}else{
-							cvwarn() << "Plugin with name '" << p->get_name() 
-								 << "' already loaded, and new one has no higher priority.\n"; 
-							delete p;
-						}
-						
-						// since this module will not be used at all 
-						// unload the according library 
-						(*i)->set_unload_library(); 
+						module = loaded_plugin->get_module(); 
+						add_plugin_internal(PInterface(p)); 
+					}else{
+						cvwarn() << "Plugin with name '" << p->get_name() 
+							 << "' already loaded, and new one has no higher priority.\n"; 
+						delete p;
 					}
-
-
 					
-
-					
-				}else {
-					cvdebug() << "discard '" << pold->get_name() << "'\n"; 
-					delete pold; 
+					// since this module will not be used at all 
+					// unload the according library 
+					if (module)
+						module->set_unload_library(); 
 				}
+			}else {
+				cvdebug() << "discard '" << pold->get_name() << "'\n"; 
+				delete pold; 
 			}
 		}
-		catch(std::invalid_argument& x) {
-			cvdebug() << "Module '" << (*i)->get_name() 
-				  << "' was not loaded because '" 
-				  << x.what() << "'\n"; 
-		}
 	}
-	do_initialise(); 
+	catch(std::invalid_argument& x) {
+		cvdebug() << "Module '" << module->get_name() 
+			  << "' was not loaded because '" 
+			  << x.what() << "'\n"; 
+	}
+}
+
+/* The lazy loading functions change the internal state of the handler, 
+   but the set of available plug-ins as seen from the outside stays the same. 
+   The caller must hold m_load_mutex. 
+*/
+template <typename I>
+bool TPluginHandler<I>::load_module_of(const std::string& plugin) const
+{
+	auto m = m_unloaded.find(plugin); 
+	if (m == m_unloaded.end())
+		return false; 
+
+	auto self = const_cast<TPluginHandler<I> *>(this); 
+	std::string module_file = m->second; 
+
+	// a module may provide more than one plug-in 
+	for (auto i = self->m_unloaded.begin(); i != self->m_unloaded.end();) {
+		if (i->second == module_file) 
+			i = self->m_unloaded.erase(i); 
+		else 
+			++i; 
+	}
+	
+	try {
+		cvdebug() << " Load '" << module_file << "' for plug-in '" << plugin << "'\n";
+		self->m_modules.push_back(PPluginModule(new CPluginModule(module_file.c_str()))); 
+		self->add_plugins_from_module(self->m_modules.back()); 
+	} catch (std::exception& ex) {
+		cverr() << ex.what() << "\n";
+		return false; 
+	}
+	return true; 
+}
+
+template <typename I>
+void TPluginHandler<I>::load_all_modules() const
+{
+	CRecursiveScopedLock lock(m_load_mutex); 
+	while (!m_unloaded.empty()) 
+		load_module_of(m_unloaded.begin()->first); 
 }
 
 template <typename I>
 bool TPluginHandler<I>::add_plugin(PInterface p)
 {
+	CRecursiveScopedLock lock(m_load_mutex); 
+	// resolve priorities against the cached plug-in of the same name 
+	load_module_of(p->get_name()); 
+	
 	bool result = true; 
 	auto loaded_plugin_i = m_plugins.find(p->get_name()); 
 	if ( loaded_plugin_i ==  m_plugins.end()) {
@@ -175,6 +243,7 @@ void TPluginHandler<I>::add_plugin_internal(PInterface p)
 template <typename I>
 void TPluginHandler<I>::do_add_dependend_handlers(HandlerHelpMap& handler_map)const 
 {
+	load_all_modules(); 
 	for (auto p = begin(); p != end(); ++p)
 		p->second->add_dependend_handlers(handler_map); 
 }
@@ -182,12 +251,14 @@ void TPluginHandler<I>::do_add_dependend_handlers(HandlerHelpMap& handler_map)co
 template <typename I>
 typename TPluginHandler<I>::const_iterator TPluginHandler<I>::begin() const
 {
+	load_all_modules(); 
 	return m_plugins.begin(); 
 }
 
 template <typename I>
 typename TPluginHandler<I>::const_iterator TPluginHandler<I>::end() const
 {
+	load_all_modules(); 
 	return m_plugins.end(); 
 }
 
@@ -204,6 +275,7 @@ TPluginHandler<I>::~TPluginHandler()
 template <typename I>
 size_t TPluginHandler<I>::size() const
 {
+	load_all_modules(); 
 	return m_plugins.size(); 
 }
 
@@ -212,8 +284,12 @@ const std::string TPluginHandler<I>::get_plugin_names() const
 {
 	std::vector<std::string> names;  
 
+	CRecursiveScopedLock lock(m_load_mutex); 
 	for (auto i = m_plugins.begin(); i != m_plugins.end(); ++i)
 		names.push_back(i->first);
+	for (auto i = m_unloaded.begin(); i != m_unloaded.end(); ++i)
+		names.push_back(i->first);
+	lock.release(); 
 
 	sort(names.begin(), names.end()); 
 	std::stringstream outstr; 
@@ -227,15 +303,22 @@ template <typename I>
 const std::set<std::string> TPluginHandler<I>::get_set() const
 {
 	std::set<std::string> r; 
+	CRecursiveScopedLock lock(m_load_mutex); 
 	for (auto i = m_plugins.begin(); i != m_plugins.end(); ++i)
 		r.insert(i->first);
+	for (auto i = m_unloaded.begin(); i != m_unloaded.end(); ++i)
+		r.insert(i->first);
 	return r; 
 }
 
 template <typename I>
 typename TPluginHandler<I>::Interface *TPluginHandler<I>::plugin(const char *plugin) const 
 {
+	CRecursiveScopedLock lock(m_load_mutex); 
 	auto p = m_plugins.find(plugin); 
+	if (p == m_plugins.end() && load_module_of(plugin)) 
+		p = m_plugins.find(plugin); 
+	
 	if (p == m_plugins.end()) {
 		std::stringstream msg; 
 		cvdebug() << "Plugin '" << plugin << "' not found in '" 
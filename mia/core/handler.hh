@@ -134,9 +134,20 @@ private:
 
        void do_add_dependend_handlers(HandlerHelpMap& handler_map) const;
 
+       void add_plugins_from_module(PPluginModule& module);
+
+       bool load_module_of(const std::string& plugin) const;
+
+       void load_all_modules() const;
+
        std::vector<PPluginModule> m_modules;
        CPluginMap m_plugins;
 
+       /* plug-ins that are known from the plug-in cache but whose modules
+          are not loaded yet, maps the plug-in name to the module file */
+       std::map<std::string, std::string> m_unloaded;
+       mutable CRecursiveMutex m_load_mutex;
+
        virtual void do_print_short_help(std::ostream& os) const;
        virtual void do_print_help(std::ostream& os) const;
        virtual void do_get_xml_help(CXMLElement& root) const;
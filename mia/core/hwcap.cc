@@ -20,40 +20,122 @@
 
 #include <mia/core/hwcap.hh>
 
-#ifndef __linux__
-#error this code is only valid on linux
-#endif
-
+#if defined(__arm__) && defined(__linux__)
 #include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
 
 NS_MIA_BEGIN
-#ifdef __x86_64__
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
 
 bool cpu_has_sse()
 {
-       return true;
+       return __builtin_cpu_supports("sse");
 }
 
 bool cpu_has_sse2()
 {
-       return true;
+       return __builtin_cpu_supports("sse2");
 }
 
 bool cpu_has_sse3()
+{
+       return __builtin_cpu_supports("sse3");
+}
 
 bool cpu_has_ssse3()
+{
+       return __builtin_cpu_supports("ssse3");
+}
 
 bool cpu_has_fma()
+{
+       return __builtin_cpu_supports("fma");
+}
 
 bool cpu_has_fma4()
+{
+       return __builtin_cpu_supports("fma4");
+}
+
+bool cpu_has_avx()
+{
+       return __builtin_cpu_supports("avx");
+}
+
+bool cpu_has_avx2()
+{
+       return __builtin_cpu_supports("avx2");
+}
+
+bool cpu_has_avx512f()
+{
+       return __builtin_cpu_supports("avx512f");
+}
 
 bool cpu_has_neon()
+{
+       return false;
+}
 
 #else
 
+bool cpu_has_sse()
+{
+       return false;
+}
 
-NS_MIA_END
+bool cpu_has_sse2()
+{
+       return false;
+}
 
+bool cpu_has_sse3()
+{
+       return false;
+}
+
+bool cpu_has_ssse3()
+{
+       return false;
+}
+
+bool cpu_has_fma()
+{
+       return false;
+}
+
+bool cpu_has_fma4()
+{
+       return false;
+}
 
+bool cpu_has_avx()
+{
+       return false;
+}
+
+bool cpu_has_avx2()
+{
+       return false;
+}
+
+bool cpu_has_avx512f()
+{
+       return false;
+}
+
+bool cpu_has_neon()
+{
+#if defined(__aarch64__)
+       return true;
+#elif defined(__arm__) && defined(__linux__)
+       return (getauxval(AT_HWCAP) & HWCAP_NEON) != 0;
+#else
+       return false;
 #endif
+}
 
+#endif
+
+NS_MIA_END
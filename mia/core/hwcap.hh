@@ -18,8 +18,6 @@
 //
 //
 
-
-
 #ifndef mia_core_hwcap_hh
 #define mia_core_hwcap_hh
 
@@ -27,19 +25,45 @@
 
 NS_MIA_BEGIN
 
-bool cpu_has_sse();
+/**
+   \ingroup misc
+   \brief Run-time queries for CPU features
+
+   These functions report whether the CPU the program runs on supports a certain
+   instruction set extension. They are used to select hand-optimized code paths
+   at run time, independent of the compiler flags used to build the library.
+   On unsupported architectures all x86 queries return false.
+*/
+
+/// \returns true if the CPU supports SSE
+EXPORT_CORE bool cpu_has_sse();
+
+/// \returns true if the CPU supports SSE2
+EXPORT_CORE bool cpu_has_sse2();
+
+/// \returns true if the CPU supports SSE3
+EXPORT_CORE bool cpu_has_sse3();
+
+/// \returns true if the CPU supports SSSE3
+EXPORT_CORE bool cpu_has_ssse3();
 
-bool cpu_has_sse2();
+/// \returns true if the CPU supports the FMA3 instructions
+EXPORT_CORE bool cpu_has_fma();
 
-bool cpu_has_sse3();
+/// \returns true if the CPU supports the AMD FMA4 instructions
+EXPORT_CORE bool cpu_has_fma4();
 
-bool cpu_has_ssse3();
+/// \returns true if the CPU supports AVX
+EXPORT_CORE bool cpu_has_avx();
 
-bool cpu_has_fma();
+/// \returns true if the CPU supports AVX2
+EXPORT_CORE bool cpu_has_avx2();
 
-bool cpu_has_fma4();
+/// \returns true if the CPU supports the AVX-512 foundation instructions
+EXPORT_CORE bool cpu_has_avx512f();
 
-bool cpu_has_neon();
+/// \returns true if the CPU supports ARM NEON
+EXPORT_CORE bool cpu_has_neon();
 
 
 NS_MIA_END
@@ -25,6 +25,7 @@
 #include <iostream>
 #include <mia/core/plugin_base.cxx>
 #include <mia/core/xmlinterface.hh>
+#include <mia/core/profiling.hh>
 
 NS_MIA_BEGIN
 
@@ -47,6 +48,7 @@ void TIOPlugin<D>::add_suffixes(std::multimap<std::string, std::string>& map)con
 template <typename D> 
 typename TIOPlugin<D>::PData TIOPlugin<D>::load(const std::string& fname) const
 {
+	MIA_PROFILE_SCOPE("load", this->get_name()); 
 	typename TIOPlugin<D>::PData retval = do_load(fname);
 	if (retval)
 		retval->set_source_format(this->get_name()); 
@@ -56,6 +58,7 @@ typename TIOPlugin<D>::PData TIOPlugin<D>::load(const std::string& fname) const
 template <typename D> 
 bool TIOPlugin<D>::save(const std::string& fname, const Data& data) const
 {
+	MIA_PROFILE_SCOPE("save", this->get_name()); 
 	return do_save(fname, data);
 }
 
@@ -0,0 +1,66 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <mia/core/linebundle.hh>
+
+NS_MIA_BEGIN
+using std::vector;
+
+C1DFoldingLineBundle::C1DFoldingLineBundle(const C1DFilterKernel& kernel):
+       m_kernel(kernel),
+       m_radius(kernel.size() / 2)
+{
+       const size_t n = 2 * m_radius + 1;
+       const size_t probe_length = 2 * n;
+       m_weights.resize(n);
+       m_left.resize(m_radius * n);
+       m_right.resize(m_radius * n);
+
+       // the response to a unit impulse at position j gives the weights of
+       // input element j for all output elements
+       vector<double> probe(probe_length);
+
+       for (size_t j = 0; j < probe_length; ++j) {
+              fill(probe.begin(), probe.end(), 0.0);
+              probe[j] = 1.0;
+              const vector<double> response = kernel.apply(probe);
+
+              // inner weights, taken from the element at position 2 * radius
+              if (j >= m_radius && j <= 3 * m_radius)
+                     m_weights[j - m_radius] = response[2 * m_radius];
+
+              if (j < n) {
+                     for (size_t i = 0; i < m_radius; ++i)
+                            m_left[i * n + j] = response[i];
+              }
+
+              if (j >= probe_length - n) {
+                     for (size_t i = 0; i < m_radius; ++i)
+                            m_right[i * n + j - (probe_length - n)] = response[probe_length - m_radius + i];
+              }
+       }
+}
+
+size_t C1DFoldingLineBundle::get_radius() const
+{
+       return m_radius;
+}
+
+NS_MIA_END
@@ -0,0 +1,305 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef mia_core_linebundle_hh
+#define mia_core_linebundle_hh
+
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <mia/core/defines.hh>
+#include <mia/core/parallel.hh>
+#include <mia/core/spacial_kernel.hh>
+
+NS_MIA_BEGIN
+
+/**
+   \ingroup filters
+
+   \brief Layout of the lines of an image along one axis
+
+   The lines are addressed as (outer, line, element) with the offset
+   outer * outer_step + line * line_step + element * step into the image data.
+   For example, for a 3D image of size (nx, ny, nz) the lines along y are given by
+   length = ny, step = nx, lines = nx, line_step = 1, outer = nz, outer_step = nx * ny.
+ */
+struct SLineBundleLayout {
+       /// number of elements per line
+       size_t length;
+       /// distance of two neighboring elements of a line
+       size_t step;
+       /// number of lines per outer block
+       size_t lines;
+       /// distance of the first elements of two neighboring lines
+       size_t line_step;
+       /// number of outer blocks
+       size_t outer;
+       /// distance of two outer blocks
+       size_t outer_step;
+};
+
+/**
+   \ingroup filters
+
+   Run a 1D operation on all lines of an image. The lines are processed in bundles:
+   A bundle of \a width lines is copied into an interleaved buffer, i.e. element i of
+   line j is located at position i * width + j, so that the operation can work on
+   contiguous memory for all lines of the bundle at once. If the lines are not
+   contiguous in memory (line_step != 1) copying the bundle transposes a tile of the
+   image, otherwise whole rows are copied.  The bundles are processed in parallel.
+
+   \tparam A the type of the values in the interleaved buffers
+   \tparam Iterator random access iterator to the image data
+   \tparam Process the operation with the signature
+      void (const A *in, A *out, size_t length, size_t width)
+   \param data iterator to the begin of the image data
+   \param layout the layout of the lines
+   \param process the operation to run
+ */
+template <typename A, typename Iterator, typename Process>
+void process_line_bundles(Iterator data, const SLineBundleLayout& layout, Process process)
+{
+       typedef typename std::iterator_traits<Iterator>::value_type T;
+
+       if (!layout.length || !layout.lines || !layout.outer)
+              return;
+
+       const size_t width = std::min(layout.lines,
+                                     std::max<size_t>(16, std::min<size_t>(256, 16384 / layout.length)));
+       const size_t bundles_per_block = (layout.lines + width - 1) / width;
+       auto run_bundles = [data, &layout, &process, width, bundles_per_block](const C1DParallelRange & range) {
+              std::vector<A> in(layout.length * width);
+              std::vector<A> out(layout.length * width);
+
+              for (auto b = range.begin(); b != range.end(); ++b) {
+                     const size_t l0 = (b % bundles_per_block) * width;
+                     const size_t w = std::min(width, layout.lines - l0);
+                     Iterator base = data + (b / bundles_per_block) * layout.outer_step + l0 * layout.line_step;
+
+                     if (layout.line_step == 1) {
+                            for (size_t i = 0; i < layout.length; ++i) {
+                                   Iterator row = base + i * layout.step;
+                                   std::copy(row, row + w, in.begin() + i * w);
+                            }
+                     } else {
+                            for (size_t j = 0; j < w; ++j) {
+                                   Iterator line = base + j * layout.line_step;
+
+                                   for (size_t i = 0; i < layout.length; ++i)
+                                          in[i * w + j] = line[i * layout.step];
+                            }
+                     }
+
+                     process(&in[0], &out[0], layout.length, w);
+
+                     if (layout.line_step == 1) {
+                            for (size_t i = 0; i < layout.length; ++i)
+                                   std::transform(out.begin() + i * w, out.begin() + (i + 1) * w,
+                                                  base + i * layout.step,
+                                   [](A x) {
+                                          return static_cast<T>(x);
+                                   });
+                     } else {
+                            for (size_t j = 0; j < w; ++j) {
+                                   Iterator line = base + j * layout.line_step;
+
+                                   for (size_t i = 0; i < layout.length; ++i)
+                                          line[i * layout.step] = static_cast<T>(out[i * w + j]);
+                            }
+                     }
+              }
+       };
+       pfor(C1DParallelRange(0, bundles_per_block * layout.outer, 1), run_bundles);
+}
+
+/**
+   \ingroup filters
+
+   Evaluate the sum over a window [i - radius, i + radius] for each element of
+   interleaved lines (see process_line_bundles) by using running sums, i.e.
+   the cost does not depend on the radius. The window is clipped at the line boundaries.
+   \param in the input lines
+   \param[out] out the window sums
+   \param length the length of the lines
+   \param width the number of interleaved lines
+   \param radius the half window width
+ */
+template <typename A>
+void box_sum_line_bundle(const A *in, A *out, size_t length, size_t width, size_t radius)
+{
+       std::fill(out, out + width, A());
+
+       for (size_t i = 0; i <= radius && i < length; ++i) {
+              const A *row = in + i * width;
+
+              for (size_t j = 0; j < width; ++j)
+                     out[j] += row[j];
+       }
+
+       for (size_t i = 1; i < length; ++i) {
+              const A *prev = out + (i - 1) * width;
+              A *row = out + i * width;
+
+              if (i + radius < length && i > radius) {
+                     const A *add = in + (i + radius) * width;
+                     const A *sub = in + (i - radius - 1) * width;
+
+                     for (size_t j = 0; j < width; ++j)
+                            row[j] = prev[j] + add[j] - sub[j];
+              } else if (i + radius < length) {
+                     const A *add = in + (i + radius) * width;
+
+                     for (size_t j = 0; j < width; ++j)
+                            row[j] = prev[j] + add[j];
+              } else if (i > radius) {
+                     const A *sub = in + (i - radius - 1) * width;
+
+                     for (size_t j = 0; j < width; ++j)
+                            row[j] = prev[j] - sub[j];
+              } else {
+                     std::copy(prev, prev + width, row);
+              }
+       }
+}
+
+/**
+   \ingroup filters
+
+   \returns the number of elements of a line of the given length that lie
+   within the window [i - radius, i + radius]
+ */
+inline size_t box_count(size_t i, size_t length, size_t radius)
+{
+       const size_t b = i > radius ? i - radius : 0;
+       const size_t e = std::min(i + radius + 1, length);
+       return e - b;
+}
+
+/**
+   \ingroup filters
+
+   \brief Apply a 1D filter kernel to interleaved lines
+
+   The kernel is only used through its line-wise interface
+   C1DFilterKernel::apply, which takes care of the boundary conditions.
+   Since a folding kernel is linear and of finite support, the
+   weights for the inside of the line and for the elements near
+   the boundaries are obtained once by applying the kernel to unit impulses,
+   and afterwards the convolution can be run on many interleaved lines at once
+   with contiguous memory access. Lines that are too short to separate the boundary
+   weights from the inner weights are passed to the kernel directly.
+ */
+class EXPORT_CORE C1DFoldingLineBundle
+{
+public:
+       /**
+          Evaluate the weights of the kernel
+          \param kernel the kernel, it must exist as long as this object is used
+        */
+       C1DFoldingLineBundle(const C1DFilterKernel& kernel);
+
+       /**
+          Fold the interleaved lines
+          \param in the input lines
+          \param[out] out the filtered lines
+          \param length the length of the lines
+          \param width the number of interleaved lines
+        */
+       template <typename A>
+       void apply(const A *in, A *out, size_t length, size_t width) const;
+
+       /// \returns the support radius of the kernel
+       size_t get_radius() const;
+private:
+       template <typename A>
+       void fold_row(const A *in, A *out, const double *weights, size_t width) const;
+
+       template <typename A>
+       void apply_kernel(const A *in, A *out, size_t length, size_t width) const;
+
+       const C1DFilterKernel& m_kernel;
+       size_t m_radius;
+       std::vector<double> m_weights;
+       std::vector<double> m_left;
+       std::vector<double> m_right;
+};
+
+template <typename A>
+void C1DFoldingLineBundle::fold_row(const A *in, A *out, const double *weights, size_t width) const
+{
+       const size_t n = 2 * m_radius + 1;
+       const A w0 = static_cast<A>(weights[0]);
+
+       for (size_t j = 0; j < width; ++j)
+              out[j] = w0 * in[j];
+
+       for (size_t k = 1; k < n; ++k) {
+              const A wk = static_cast<A>(weights[k]);
+              const A *row = in + k * width;
+
+              if (wk == A())
+                     continue;
+
+              for (size_t j = 0; j < width; ++j)
+                     out[j] += wk * row[j];
+       }
+}
+
+template <typename A>
+void C1DFoldingLineBundle::apply_kernel(const A *in, A *out, size_t length, size_t width) const
+{
+       std::vector<double> line(length);
+
+       for (size_t j = 0; j < width; ++j) {
+              for (size_t i = 0; i < length; ++i)
+                     line[i] = in[i * width + j];
+
+              m_kernel.apply_inplace(line);
+
+              for (size_t i = 0; i < length; ++i)
+                     out[i * width + j] = static_cast<A>(line[i]);
+       }
+}
+
+template <typename A>
+void C1DFoldingLineBundle::apply(const A *in, A *out, size_t length, size_t width) const
+{
+       const size_t n = 2 * m_radius + 1;
+
+       if (length < 2 * n) {
+              apply_kernel(in, out, length, width);
+              return;
+       }
+
+       for (size_t i = 0; i < m_radius; ++i)
+              fold_row(in, out + i * width, &m_left[i * n], width);
+
+       for (size_t i = m_radius; i < length - m_radius; ++i)
+              fold_row(in + (i - m_radius) * width, out + i * width, &m_weights[0], width);
+
+       const A *right_in = in + (length - n) * width;
+
+       for (size_t i = 0; i < m_radius; ++i)
+              fold_row(right_in, out + (length - m_radius + i) * width, &m_right[i * n], width);
+}
+
+NS_MIA_END
+
+#endif
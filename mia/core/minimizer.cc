@@ -23,6 +23,7 @@
 #include <algorithm>
 #include <mia/core/minimizer.hh>
 #include <mia/core/errormacro.hh>
+#include <mia/core/profiling.hh>
 
 #include <mia/core/handler.cxx>
 #include <mia/core/plugin_base.cxx>
@@ -145,6 +146,7 @@ CMinimizer::Problem *CMinimizer::get_problem_pointer()
 int CMinimizer::run(CDoubleVector& x)
 {
        DEBUG_ASSERT_RELEASE_THROW(m_problem, "CMinimizer::run: no minimization problem given");
+       MIA_PROFILE_SCOPE("minimizer", *this);
 
        if (!m_problem->has_all_in(*this)) {
               stringstream msg;
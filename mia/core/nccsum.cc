@@ -21,6 +21,9 @@
 #include <mia/core/msgstream.hh>
 #include <mia/core/nccsum.hh>
 
+#include <algorithm>
+#include <cassert>
+
 
 NS_MIA_BEGIN
 
@@ -176,4 +179,180 @@ std::pair<double, NCCGradHelper> NCCSums::get_grad_helper() const
 
 #endif // __SSE2__
 
+/*
+   The sums are stored in six planes of the slice size: a, b, a^2, b^2, ab, and the
+   number of pixels.
+*/
+static const size_t ncc_planes = 6;
+
+CNCCSlidingWindow::CNCCSlidingWindow(const double *a, const double *b, const unsigned char *mask,
+                                     size_t nx, size_t ny, size_t nz, int hw, bool brute_force):
+       m_a(a),
+       m_b(b),
+       m_mask(mask),
+       m_nx(nx),
+       m_ny(ny),
+       m_nz(nz),
+       m_slice_size(nx * ny),
+       m_hw(hw),
+       m_brute_force(brute_force),
+       m_z(-1),
+       m_offset_a(0.0),
+       m_offset_b(0.0),
+       m_sums(ncc_planes * m_slice_size, 0.0)
+{
+       if (m_brute_force)
+              return;
+
+       m_slice.resize(ncc_planes * m_slice_size);
+       m_prefix.resize((std::max(nx, ny) + 1) * nx);
+
+       // the mean of the first slice is a good enough estimate of the intensity level
+       for (size_t i = 0; i < m_slice_size; ++i) {
+              m_offset_a += m_a[i];
+              m_offset_b += m_b[i];
+       }
+
+       if (m_slice_size > 0) {
+              m_offset_a /= m_slice_size;
+              m_offset_b /= m_slice_size;
+       }
+}
+
+void CNCCSlidingWindow::set_slice(size_t z)
+{
+       assert(z < m_nz);
+
+       if (m_brute_force) {
+              sum_windows(z);
+       } else if (m_z >= 0 && z == static_cast<size_t>(m_z) + 1) {
+              if (z + m_hw < m_nz)
+                     add_slice(z + m_hw, 1.0);
+
+              if (z > m_hw)
+                     add_slice(z - m_hw - 1, -1.0);
+       } else {
+              std::fill(m_sums.begin(), m_sums.end(), 0.0);
+              const size_t zb = z > m_hw ? z - m_hw : 0;
+              const size_t ze = std::min(m_nz, z + m_hw + 1);
+
+              for (size_t iz = zb; iz < ze; ++iz)
+                     add_slice(iz, 1.0);
+       }
+
+       m_z = z;
+}
+
+void CNCCSlidingWindow::sum_windows(size_t z)
+{
+       const size_t n = m_slice_size;
+       const size_t zb = z > m_hw ? z - m_hw : 0;
+       const size_t ze = std::min(m_nz, z + m_hw + 1);
+
+       for (size_t y = 0; y < m_ny; ++y) {
+              const size_t yb = y > m_hw ? y - m_hw : 0;
+              const size_t ye = std::min(m_ny, y + m_hw + 1);
+
+              for (size_t x = 0; x < m_nx; ++x) {
+                     const size_t xb = x > m_hw ? x - m_hw : 0;
+                     const size_t xe = std::min(m_nx, x + m_hw + 1);
+                     double sum[ncc_planes] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+
+                     for (size_t iz = zb; iz < ze; ++iz)
+                            for (size_t iy = yb; iy < ye; ++iy) {
+                                   const size_t row = iz * n + iy * m_nx;
+
+                                   for (size_t ix = xb; ix < xe; ++ix) {
+                                          if (m_mask && !m_mask[row + ix])
+                                                 continue;
+
+                                          const double a = m_a[row + ix];
+                                          const double b = m_b[row + ix];
+                                          sum[0] += a;
+                                          sum[1] += b;
+                                          sum[2] += a * a;
+                                          sum[3] += b * b;
+                                          sum[4] += a * b;
+                                          sum[5] += 1.0;
+                                   }
+                            }
+
+                     for (size_t p = 0; p < ncc_planes; ++p)
+                            m_sums[p * n + y * m_nx + x] = sum[p];
+              }
+       }
+}
+
+void CNCCSlidingWindow::add_slice(size_t z, double sign)
+{
+       const size_t n = m_slice_size;
+       const double *a = m_a + z * n;
+       const double *b = m_b + z * n;
+       const unsigned char *mask = m_mask ? m_mask + z * n : nullptr;
+       double *va = &m_slice[0];
+
+       for (size_t i = 0; i < n; ++i) {
+              const double w = (!mask || mask[i]) ? 1.0 : 0.0;
+              const double ai = w * (a[i] - m_offset_a);
+              const double bi = w * (b[i] - m_offset_b);
+              va[i] = ai;
+              va[n + i] = bi;
+              va[2 * n + i] = ai * ai;
+              va[3 * n + i] = bi * bi;
+              va[4 * n + i] = ai * bi;
+              va[5 * n + i] = w;
+       }
+
+       for (size_t p = 0; p < ncc_planes; ++p) {
+              box_sum_x(va + p * n);
+              box_sum_y(va + p * n);
+       }
+
+       for (size_t i = 0; i < ncc_planes * n; ++i)
+              m_sums[i] += sign * va[i];
+}
+
+void CNCCSlidingWindow::box_sum_x(double *v)
+{
+       double *prefix = &m_prefix[0];
+
+       for (size_t y = 0; y < m_ny; ++y, v += m_nx) {
+              prefix[0] = 0.0;
+
+              for (size_t x = 0; x < m_nx; ++x)
+                     prefix[x + 1] = prefix[x] + v[x];
+
+              for (size_t x = 0; x < m_nx; ++x) {
+                     const size_t xb = x > m_hw ? x - m_hw : 0;
+                     const size_t xe = std::min(m_nx, x + m_hw + 1);
+                     v[x] = prefix[xe] - prefix[xb];
+              }
+       }
+}
+
+void CNCCSlidingWindow::box_sum_y(double *v)
+{
+       // the prefix sums are kept row-wise to access the memory linearly
+       double *prefix = &m_prefix[0];
+       std::fill(prefix, prefix + m_nx, 0.0);
+
+       for (size_t y = 0; y < m_ny; ++y) {
+              const double *row = v + y * m_nx;
+              const double *p = prefix + y * m_nx;
+              double *np = prefix + (y + 1) * m_nx;
+
+              for (size_t x = 0; x < m_nx; ++x)
+                     np[x] = p[x] + row[x];
+       }
+
+       for (size_t y = 0; y < m_ny; ++y) {
+              const double *pb = prefix + (y > m_hw ? y - m_hw : 0) * m_nx;
+              const double *pe = prefix + std::min(m_ny, y + m_hw + 1) * m_nx;
+              double *row = v + y * m_nx;
+
+              for (size_t x = 0; x < m_nx; ++x)
+                     row[x] = pe[x] - pb[x];
+       }
+}
+
 NS_MIA_END
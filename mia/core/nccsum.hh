@@ -22,6 +22,7 @@
 #define mia_core_nccsum_hh
 
 #include <utility>
+#include <vector>
 #include <mia/core/defines.hh>
 
 #if defined(__SSE2__)
@@ -72,6 +73,15 @@ public:
               m_sum2 = m_sum;
        }
 
+       NCCSums(double suma, double sumb, double suma2, double sumb2, double sumab, double n):
+              m_sumab(sumab), m_n(n)
+       {
+              double sum[2] = {suma, sumb};
+              double sum2[2] = {suma2, sumb2};
+              m_sum = _mm_loadu_pd(sum);
+              m_sum2 = _mm_loadu_pd(sum2);
+       }
+
        void add(double a, double b)
        {
               v2df val = {static_cast<double>(a), static_cast<double>(b)};
@@ -119,6 +129,13 @@ public:
        {
        }
 
+       NCCSums(double suma, double sumb, double suma2, double sumb2, double sumab, double n):
+              m_suma(suma), m_sumb(sumb),
+              m_suma2(suma2), m_sumb2(sumb2),
+              m_sumab(sumab), m_n(n)
+       {
+       }
+
        void add(double a, double b)
        {
               m_suma += a;
@@ -169,6 +186,94 @@ inline NCCSums operator + (const NCCSums& lhs, const NCCSums& rhs)
        return result;
 }
 
+/**
+   \ingroup misc
+   \brief Evaluate the local NCC sums of all windows of a slice with a cost independent of the window size
+
+   This class provides the NCCSums of the (2hw+1)^3 windows around all pixels of one slice
+   of a volume, the windows are clipped at the volume boundaries. The 2D window sums of a
+   slice are obtained by separable running sums, and moving to the next slice only adds
+   the leading and removes the trailing slice of the window. 2D images are handled
+   like volumes with only one slice.
+
+   To reduce the cancellation when the local variances are evaluated, the input values are
+   shifted by an offset before they are summed. Hence, the values passed to
+   NCCGradHelper::get_gradient_scale must be shifted by get_offset_a() and get_offset_b().
+
+   For testing, the sums can also be obtained by visiting all pixels of each window,
+   in this case the values are not shifted.
+*/
+class EXPORT_CORE CNCCSlidingWindow
+{
+public:
+       /**
+          \param a first input volume stored in x-y-z order
+          \param b second input volume
+          \param mask if not null, only the pixels with a non-zero mask value are summed
+          \param nx
+          \param ny
+          \param nz size of the volumes
+          \param hw half window width
+          \param brute_force sum each window by visiting all its pixels, this is
+          the slow reference implementation
+       */
+       CNCCSlidingWindow(const double *a, const double *b, const unsigned char *mask,
+                         size_t nx, size_t ny, size_t nz, int hw, bool brute_force = false);
+
+       /**
+          Evaluate the window sums of slice z, moving to the next slice is cheaper
+          than jumping to an arbitrary one.
+       */
+       void set_slice(size_t z);
+
+       /// \returns the sums of the window around pixel i = x + nx * y in the current slice
+       NCCSums operator [](size_t i) const
+       {
+              return NCCSums(m_sums[i], m_sums[m_slice_size + i],
+                             m_sums[2 * m_slice_size + i], m_sums[3 * m_slice_size + i],
+                             m_sums[4 * m_slice_size + i], m_sums[5 * m_slice_size + i]);
+       }
+
+       /// \returns the number of summed pixels in the window around pixel i
+       double get_count(size_t i) const
+       {
+              return m_sums[5 * m_slice_size + i];
+       }
+
+       /// \returns the offset subtracted from the values of the first input
+       double get_offset_a() const
+       {
+              return m_offset_a;
+       }
+
+       /// \returns the offset subtracted from the values of the second input
+       double get_offset_b() const
+       {
+              return m_offset_b;
+       }
+private:
+       void add_slice(size_t z, double sign);
+       void sum_windows(size_t z);
+       void box_sum_x(double *v);
+       void box_sum_y(double *v);
+
+       const double *m_a;
+       const double *m_b;
+       const unsigned char *m_mask;
+       size_t m_nx;
+       size_t m_ny;
+       size_t m_nz;
+       size_t m_slice_size;
+       size_t m_hw;
+       bool m_brute_force;
+       long m_z;
+       double m_offset_a;
+       double m_offset_b;
+       std::vector<double> m_sums;
+       std::vector<double> m_slice;
+       std::vector<double> m_prefix;
+};
+
 NS_MIA_END
 
 #endif
@@ -70,5 +70,65 @@ NS_MIA_END
 
 #endif
 
+#include <algorithm>
+#include <vector>
+
+NS_MIA_BEGIN
+
+/**
+   \ingroup misc
+   \returns the number of tasks that pfor and preduce run concurrently at most, e.g. to
+   split a range into one work package per task
+*/
+inline int get_max_parallel_tasks()
+{
+#ifdef HAVE_TBB
+       return tbb::task_scheduler_init::default_num_threads();
+#else
+       return CMaxTasks::get_max_tasks();
+#endif
+}
+
+/**
+   \ingroup misc
+   Run a reduction over the index range [begin, end) that is split into blocks of
+   fixed size. Each block is evaluated by calling \a f(block_range, identity), and the
+   partial results are combined in block order by \a r. Unlike with preduce, the result
+   doesn't depend on the number of threads or the order in which the blocks are processed,
+   i.e. floating point sums are reproducible.
+   \param begin start of the index range
+   \param end end of the index range
+   \param block_size number of indices that make up one block
+   \param identity the neutral element of the reduction
+   \param f the function to evaluate one block
+   \param r the function to combine two partial results
+   \returns the reduced value
+*/
+template <typename Value, typename Func, typename Reduce>
+Value preduce_ordered(int begin, int end, int block_size, const Value& identity,
+                      const Func& f, const Reduce& r)
+{
+       if (end <= begin)
+              return identity;
+
+       const int n_blocks = (end - begin + block_size - 1) / block_size;
+       std::vector<Value> partial(n_blocks, identity);
+       auto eval_blocks = [begin, end, block_size, &identity, &partial, &f](const C1DParallelRange & range) {
+              for (auto b = range.begin(); b != range.end(); ++b) {
+                     const int bb = begin + b * block_size;
+                     partial[b] = f(C1DParallelRange(bb, std::min(bb + block_size, end), 1), identity);
+              }
+       };
+       pfor(C1DParallelRange(0, n_blocks, 1), eval_blocks);
+       Value result = identity;
+
+       for (auto p = partial.begin(); p != partial.end(); ++p)
+              result = r(result, *p);
+
+       return result;
+}
+
+NS_MIA_END
+
 
 #endif
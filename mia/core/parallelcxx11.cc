@@ -19,6 +19,7 @@
  */
 
 #include <mia/core/parallelcxx11.hh>
+#include <algorithm>
 
 NS_MIA_BEGIN
 
@@ -28,7 +29,8 @@ int CMaxTasks::get_max_tasks()
               max_tasks = std::thread::hardware_concurrency();
        }
 
-       return max_tasks;
+       // hardware_concurrency may return 0 if the value is not computable
+       return max_tasks > 0 ? max_tasks : 1;
 }
 
 void CMaxTasks::set_max_tasks(int mt)
@@ -38,5 +40,211 @@ void CMaxTasks::set_max_tasks(int mt)
 
 int CMaxTasks::max_tasks = -1;
 
+CParallelTask::CParallelTask(int max_helpers):
+       m_max_helpers(max_helpers),
+       m_helpers(0),
+       m_active(0),
+       m_failed(false)
+{
+}
+
+CParallelTask::~CParallelTask()
+{
+}
+
+bool CParallelTask::acquire()
+{
+       std::unique_lock<std::mutex> lock(m_mutex);
+
+       if (m_failed || m_helpers >= m_max_helpers || !has_work())
+              return false;
+
+       ++m_helpers;
+       ++m_active;
+       return true;
+}
+
+void CParallelTask::release()
+{
+       std::unique_lock<std::mutex> lock(m_mutex);
+       --m_active;
+
+       if (!m_active)
+              m_all_released.notify_all();
+}
+
+void CParallelTask::execute()
+{
+       try {
+              run();
+       } catch (...) {
+              std::unique_lock<std::mutex> lock(m_mutex);
+
+              if (!m_failed) {
+                     m_failed = true;
+                     m_error = std::current_exception();
+              }
+       }
+}
+
+void CParallelTask::wait_for_helpers()
+{
+       std::unique_lock<std::mutex> lock(m_mutex);
+       m_all_released.wait(lock, [this] {return m_active == 0;});
+}
+
+void CParallelTask::rethrow_if_failed()
+{
+       if (m_error)
+              std::rethrow_exception(m_error);
+}
+
+/* Index of the task queue owned by the current thread. All threads that
+   are not part of the pool share queue 0.
+*/
+static thread_local int current_queue_idx = 0;
+
+/* The number of queues is fixed at construction time, so that the
+   workers can scan the queues without locking the queue list.
+*/
+static int max_pool_queues()
+{
+       int n = std::max(std::thread::hardware_concurrency(), 64u);
+       return std::max(n, CMaxTasks::get_max_tasks()) + 1;
+}
+
+CThreadPool::CThreadPool():
+       m_num_queues(1),
+       m_generation(0),
+       m_shutdown(false)
+{
+       int n = max_pool_queues();
+       m_queues.reserve(n);
+
+       for (int i = 0; i < n; ++i)
+              m_queues.push_back(std::unique_ptr<Queue>(new Queue));
+}
+
+CThreadPool::~CThreadPool()
+{
+       {
+              std::unique_lock<std::mutex> lock(m_wakeup_mutex);
+              m_shutdown = true;
+       }
+       m_wakeup.notify_all();
+
+       for (auto& w : m_workers)
+              w.join();
+}
+
+CThreadPool& CThreadPool::instance()
+{
+       static CThreadPool pool;
+       return pool;
+}
+
+int CThreadPool::get_num_workers() const
+{
+       return m_num_queues.load() - 1;
+}
+
+void CThreadPool::ensure_workers(int n)
+{
+       if (get_num_workers() >= n)
+              return;
+
+       std::unique_lock<std::mutex> lock(m_workers_mutex);
+       int max_workers = static_cast<int>(m_queues.size()) - 1;
+
+       if (n > max_workers)
+              n = max_workers;
+
+       while (static_cast<int>(m_workers.size()) < n) {
+              int idx = m_workers.size() + 1;
+              m_workers.push_back(std::thread(&CThreadPool::worker_loop, this, idx));
+              m_num_queues = idx + 1;
+       }
+}
+
+void CThreadPool::run(CParallelTask& task, int max_helpers)
+{
+       ensure_workers(max_helpers);
+       Queue& q = *m_queues[current_queue_idx];
+       {
+              std::unique_lock<std::mutex> lock(q.mutex);
+              q.tasks.push_back(&task);
+       }
+       {
+              std::unique_lock<std::mutex> lock(m_wakeup_mutex);
+              ++m_generation;
+       }
+       m_wakeup.notify_all();
+       task.execute();
+       // After the task is removed from the queue no new helpers can acquire it
+       {
+              std::unique_lock<std::mutex> lock(q.mutex);
+              q.tasks.erase(std::find(q.tasks.begin(), q.tasks.end(), &task));
+       }
+       task.wait_for_helpers();
+       task.rethrow_if_failed();
+}
+
+bool CThreadPool::run_available_task(int queue_idx)
+{
+       int n_queues = m_num_queues.load();
+
+       for (int k = 0; k < n_queues; ++k) {
+              Queue& q = *m_queues[(queue_idx + k) % n_queues];
+              CParallelTask *task = nullptr;
+              {
+                     std::unique_lock<std::mutex> lock(q.mutex);
+
+                     // own tasks are taken newest first to stay in the nested
+                     // call, tasks of other threads are stolen oldest first
+                     if (k == 0) {
+                            for (auto t = q.tasks.rbegin(); t != q.tasks.rend() && !task; ++t)
+                                   if ((*t)->acquire())
+                                          task = *t;
+                     } else {
+                            for (auto t = q.tasks.begin(); t != q.tasks.end() && !task; ++t)
+                                   if ((*t)->acquire())
+                                          task = *t;
+                     }
+              }
+
+              if (task) {
+                     task->execute();
+                     task->release();
+                     return true;
+              }
+       }
+
+       return false;
+}
+
+void CThreadPool::worker_loop(int queue_idx)
+{
+       current_queue_idx = queue_idx;
+
+       while (true) {
+              unsigned generation;
+              {
+                     std::unique_lock<std::mutex> lock(m_wakeup_mutex);
+
+                     if (m_shutdown)
+                            return;
+
+                     generation = m_generation;
+              }
+
+              if (run_available_task(queue_idx))
+                     continue;
+
+              std::unique_lock<std::mutex> lock(m_wakeup_mutex);
+              m_wakeup.wait(lock, [this, generation] {
+                     return m_shutdown || generation != m_generation;
+              });
+       }
+}
 
 NS_MIA_END
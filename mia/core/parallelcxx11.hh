@@ -26,8 +26,13 @@
 #include <thread>
 #include <atomic>
 #include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <memory>
 #include <cassert>
 #include <vector>
+#include <deque>
+#include <algorithm>
 
 NS_MIA_BEGIN
 
@@ -80,6 +85,16 @@ private:
 typedef TScopedLock<CMutex> CScopedLock;
 typedef TScopedLock<CRecursiveMutex> CRecursiveScopedLock;
 
+/**
+   \ingroup misc
+   \brief A one-dimensional range that is handed out in blocks to the worker threads
+
+   The range is split into work packages of \a block indices. As with the grain size
+   of the TBB blocked_range the default block size is one, so that both back-ends
+   partition a range alike. If \a block is explicitly set to a value smaller than one,
+   the block size is selected automatically based on the range size and the number of
+   threads that work on the range; TBB has no equivalent for this.
+*/
 class EXPORT_CORE C1DParallelRange
 {
 public:
@@ -107,7 +122,7 @@ public:
               int end = begin + m_block;
 
               if (begin > m_end) {
-                     return C1DParallelRange(m_end, m_end, 0);
+                     return C1DParallelRange(m_end, m_end, 1);
               }
 
               if (end > m_end) {
@@ -117,6 +132,30 @@ public:
               return C1DParallelRange(begin, end, 1);
        }
 
+       /**
+          Set the block size if it was not given explicitly.
+          \param n_tasks number of threads that will work on this range
+          \returns the number of work packages
+        */
+       int prepare_workpackages(int n_tasks)
+       {
+              if (m_block < 1) {
+                     // about four packages per thread gives a reasonable load balance
+                     m_block = (m_end - m_begin) / (4 * n_tasks);
+
+                     if (m_block < 1)
+                            m_block = 1;
+              }
+
+              return (m_end - m_begin + m_block - 1) / m_block;
+       }
+
+       /// \returns true if not all work packages were handed out yet
+       bool has_workpackages() const
+       {
+              return m_begin + m_current_wp.load() * m_block < m_end;
+       }
+
        bool empty() const
        {
               return m_begin >= m_end;
@@ -139,6 +178,113 @@ private:
        std::atomic<int> m_current_wp;
 };
 
+/**
+   \ingroup misc
+   \brief Base class for the jobs that are run by the CThreadPool
+
+   A task is executed concurrently by the thread that submitted it and by
+   up to a maximum number of helper threads of the pool. Each participating thread
+   calls run() which must fetch work until no more work is available.
+   An exception thrown in run() stops the hand-out of further work and
+   is re-thrown in the submitting thread.
+*/
+class EXPORT_CORE CParallelTask
+{
+public:
+       /**
+          \param max_helpers maximum number of pool threads that may join the
+          submitting thread to work on this task
+        */
+       CParallelTask(int max_helpers);
+
+       virtual ~CParallelTask();
+
+       CParallelTask(const CParallelTask& other) = delete;
+       CParallelTask& operator = (const CParallelTask& other) = delete;
+
+       /**
+          Try to register a helper thread with this task.
+          \returns true if the calling thread may execute the task
+        */
+       bool acquire();
+
+       /// Unregister a helper thread that finished executing the task
+       void release();
+
+       /// Execute the work of this task in the calling thread
+       void execute();
+
+       /// wait until all helpers have released this task
+       void wait_for_helpers();
+
+       /// re-throw an exception that was caught when running the task
+       void rethrow_if_failed();
+private:
+       virtual bool has_work() const = 0;
+       virtual void run() = 0;
+
+       int m_max_helpers;
+       int m_helpers;
+       int m_active;
+       bool m_failed;
+       std::exception_ptr m_error;
+       std::mutex m_mutex;
+       std::condition_variable m_all_released;
+};
+
+/**
+   \ingroup misc
+   \brief A persistent pool of worker threads used by pfor and preduce
+
+   The worker threads are created on demand, up to CMaxTasks::get_max_tasks() - 1,
+   and kept alive until the program terminates. Each thread owns a queue
+   of submitted tasks. An idle worker first looks for work in its own queue and then
+   steals work from the queues of the other threads. Since the submitting thread always
+   works on its own task, nested calls to pfor and preduce from within a task can not
+   dead-lock.
+*/
+class EXPORT_CORE CThreadPool
+{
+public:
+       static CThreadPool& instance();
+
+       /**
+          Run a task in the calling thread and the pool threads and return
+          when the task is finished.
+          \param task the task to run
+          \param max_helpers the number of pool threads that should be made available
+        */
+       void run(CParallelTask& task, int max_helpers);
+
+       /// \returns the number of currently running worker threads
+       int get_num_workers() const;
+private:
+       CThreadPool();
+       ~CThreadPool();
+
+       CThreadPool(const CThreadPool& other) = delete;
+       CThreadPool& operator = (const CThreadPool& other) = delete;
+
+       struct Queue {
+              std::mutex mutex;
+              std::deque<CParallelTask *> tasks;
+       };
+
+       void ensure_workers(int n);
+       void worker_loop(int queue_idx);
+       bool run_available_task(int queue_idx);
+
+       std::vector<std::unique_ptr<Queue>> m_queues;
+       std::atomic<int> m_num_queues;
+       std::vector<std::thread> m_workers;
+       std::mutex m_workers_mutex;
+
+       std::mutex m_wakeup_mutex;
+       std::condition_variable m_wakeup;
+       unsigned m_generation;
+       bool m_shutdown;
+};
+
 // The functor f must actually be passed by value because a copy must
 // be used.
 //coverity[PASS_BY_VALUE]
@@ -156,19 +302,44 @@ void pfor_callback(Range& range, Func f)
 }
 
 template <typename Range, typename Func>
-void pfor(Range range, const Func& f)
+class TParallelForTask: public CParallelTask
 {
-       int max_treads = CMaxTasks::get_max_tasks();
-       std::thread::hardware_concurrency();
-       std::vector<std::thread> threads;
+public:
+       TParallelForTask(Range& range, const Func& f, int max_helpers):
+              CParallelTask(max_helpers),
+              m_range(range),
+              m_f(f)
+       {
+       }
+private:
+       bool has_work() const override
+       {
+              return m_range.has_workpackages();
+       }
 
-       for (int i = 0; i < max_treads; ++i) {
-              threads.push_back(std::thread(pfor_callback<Range, Func>, std::ref(range), f));
+       void run() override
+       {
+              pfor_callback<Range, Func>(m_range, m_f);
        }
 
-       for (int i = 0; i < max_treads; ++i) {
-              threads[i].join();
+       Range& m_range;
+       const Func& m_f;
+};
+
+template <typename Range, typename Func>
+void pfor(Range range, const Func& f)
+{
+       int max_tasks = CMaxTasks::get_max_tasks();
+       int n_packages = range.prepare_workpackages(max_tasks);
+       int max_helpers = std::min(max_tasks, n_packages) - 1;
+
+       if (max_helpers < 1) {
+              pfor_callback<Range, Func>(range, f);
+              return;
        }
+
+       TParallelForTask<Range, Func> task(range, f, max_helpers);
+       CThreadPool::instance().run(task, max_helpers);
 };
 
 template <typename V>
@@ -207,33 +378,65 @@ template <typename Range, typename Value, typename Func, typename Reduce>
 void preduce_callback(Range& range, ReduceValue<Value>& v, Func f, Reduce r)
 {
        Value value = v.get_identity();
+       bool has_value = false;
 
        while (true)  {
               Range wp = range.get_next_workpackage();
 
-              if (!wp.empty())
+              if (!wp.empty()) {
                      value = f(wp, value);
-              else
+                     has_value = true;
+              } else
                      break;
        }
 
-       v.reduce(value, r);
+       if (has_value)
+              v.reduce(value, r);
 }
 
 template <typename Range, typename Value, typename Func, typename Reduce>
-Value preduce(Range range, Value identity, const Func&  f, Reduce r)
+class TParallelReduceTask: public CParallelTask
 {
-       int max_treads = CMaxTasks::get_max_tasks();
-       ReduceValue<Value> value(identity);
-       std::vector<std::thread> threads;
+public:
+       TParallelReduceTask(Range& range, ReduceValue<Value>& value, const Func& f,
+                           const Reduce& r, int max_helpers):
+              CParallelTask(max_helpers),
+              m_range(range),
+              m_value(value),
+              m_f(f),
+              m_r(r)
+       {
+       }
+private:
+       bool has_work() const override
+       {
+              return m_range.has_workpackages();
+       }
 
-       for (int i = 0; i < max_treads; ++i) {
-              threads.push_back(std::thread(preduce_callback<Range, Value, Func, Reduce>,
-                                            std::ref(range), std::ref(value), f, r));
+       void run() override
+       {
+              preduce_callback<Range, Value, Func, Reduce>(m_range, m_value, m_f, m_r);
        }
 
-       for (int i = 0; i < max_treads; ++i) {
-              threads[i].join();
+       Range& m_range;
+       ReduceValue<Value>& m_value;
+       const Func& m_f;
+       const Reduce& m_r;
+};
+
+template <typename Range, typename Value, typename Func, typename Reduce>
+Value preduce(Range range, Value identity, const Func&  f, Reduce r)
+{
+       int max_tasks = CMaxTasks::get_max_tasks();
+       int n_packages = range.prepare_workpackages(max_tasks);
+       int max_helpers = std::min(max_tasks, n_packages) - 1;
+       ReduceValue<Value> value(identity);
+
+       if (max_helpers < 1) {
+              preduce_callback<Range, Value, Func, Reduce>(range, value, f, r);
+       } else {
+              TParallelReduceTask<Range, Value, Func, Reduce> task(range, value, f, r, max_helpers);
+              CThreadPool::instance().run(task, max_helpers);
        }
 
        return value.get_reduced();
@@ -0,0 +1,251 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cstdlib>
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <set>
+#include <sstream>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+#include <boost/filesystem.hpp>
+
+#include <mia/core/plugincache.hh>
+#include <mia/core/msgstream.hh>
+
+NS_MIA_BEGIN
+
+using std::string;
+using std::vector;
+namespace bfs = ::boost::filesystem;
+
+static const char *const cache_magic = "mia-plugin-cache";
+static const int cache_version = 1;
+
+static string get_cache_dir()
+{
+       const char *c_cache = getenv("MIA_PLUGIN_CACHE");
+
+       // the cache is opt-in, programs must not write to the users home by default
+       if (!c_cache)
+              return string();
+
+       const string dir(c_cache);
+
+       if (dir != "default")
+              return dir == "none" ? string() : dir;
+
+       const char *c_xdg = getenv("XDG_CACHE_HOME");
+
+       if (c_xdg && *c_xdg)
+              return (bfs::path(c_xdg) / "mia").string();
+
+       const char *c_home = getenv("HOME");
+
+       if (c_home && *c_home)
+              return (bfs::path(c_home) / ".cache" / "mia").string();
+
+       return string();
+}
+
+static string get_cache_filename(const string& data, const string& type,
+                                 const vector<string>& modules)
+{
+       if (modules.empty())
+              return string();
+
+       string dir = get_cache_dir();
+
+       if (dir.empty())
+              return string();
+
+       // handlers with different search paths must not share the index
+       std::set<string> module_dirs;
+
+       for (auto m : modules)
+              module_dirs.insert(bfs::path(m).parent_path().string());
+
+       std::stringstream key;
+
+       for (auto d : module_dirs)
+              key << d << ';';
+
+       std::stringstream name;
+       name << data << '-' << type << '-' << std::hex << std::hash<string>()(key.str()) << ".cache";
+       return (bfs::path(dir) / name.str()).string();
+}
+
+bool CPluginCache::SModuleStamp::operator == (const SModuleStamp& other) const
+{
+       return name == other.name && mtime == other.mtime && size == other.size;
+}
+
+CPluginCache::CPluginCache(const string& data, const string& type,
+                           const vector<string>& modules):
+       m_filename(get_cache_filename(data, type, modules))
+{
+       stamp_modules(modules);
+}
+
+CPluginCache::CPluginCache(const string& filename, const vector<string>& modules):
+       m_filename(filename)
+{
+       stamp_modules(modules);
+}
+
+void CPluginCache::stamp_modules(const vector<string>& modules)
+{
+       for (auto m : modules) {
+              struct stat st;
+
+              if (stat(m.c_str(), &st) != 0) {
+                     cvdebug() << "CPluginCache: can't stat '" << m << "', disable cache\n";
+                     m_filename.clear();
+                     return;
+              }
+
+              SModuleStamp stamp;
+              stamp.name = m;
+#ifdef __linux__
+              stamp.mtime = static_cast<long long>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+#else
+              stamp.mtime = st.st_mtime;
+#endif
+              stamp.size = st.st_size;
+              m_modules.push_back(stamp);
+       }
+
+       sort(m_modules.begin(), m_modules.end(),
+       [](const SModuleStamp & a, const SModuleStamp & b) {
+              return a.name < b.name;
+       });
+}
+
+const string& CPluginCache::get_filename() const
+{
+       return m_filename;
+}
+
+bool CPluginCache::read(CModuleMap& plugins) const
+{
+       if (m_filename.empty())
+              return false;
+
+       std::ifstream is(m_filename.c_str());
+
+       if (!is.good())
+              return false;
+
+       string magic;
+       int version = 0;
+       size_t n_modules = 0;
+       is >> magic >> version >> n_modules;
+
+       if (!is.good() || magic != cache_magic || version != cache_version ||
+           n_modules != m_modules.size()) {
+              cvdebug() << "CPluginCache: '" << m_filename << "' is outdated\n";
+              return false;
+       }
+
+       for (auto m = m_modules.begin(); m != m_modules.end(); ++m) {
+              SModuleStamp stamp;
+              is >> stamp.mtime >> stamp.size;
+              is.ignore(1);
+              getline(is, stamp.name);
+
+              if (!is.good() || !(stamp == *m)) {
+                     cvdebug() << "CPluginCache: module '" << m->name << "' changed\n";
+                     return false;
+              }
+       }
+
+       size_t n_plugins = 0;
+       is >> n_plugins;
+       CModuleMap result;
+
+       for (size_t i = 0; i < n_plugins; ++i) {
+              string name;
+              string module;
+              is >> name;
+              is.ignore(1);
+              getline(is, module);
+
+              if (is.fail()) {
+                     cvdebug() << "CPluginCache: '" << m_filename << "' is corrupt\n";
+                     return false;
+              }
+
+              result[name] = module;
+       }
+
+       plugins.swap(result);
+       cvdebug() << "CPluginCache: read " << plugins.size() << " plug-ins from '" << m_filename << "'\n";
+       return true;
+}
+
+bool CPluginCache::write(const CModuleMap& plugins) const
+{
+       if (m_filename.empty())
+              return false;
+
+       try {
+              bfs::path filename(m_filename);
+              bfs::create_directories(filename.parent_path());
+              // write to a temporary file and rename it, so that concurrently running
+              // programs never see a partially written index
+              std::stringstream tmpname;
+              tmpname << m_filename << '.' << getpid();
+              {
+                     std::ofstream os(tmpname.str().c_str());
+                     os << cache_magic << ' ' << cache_version << ' ' << m_modules.size() << '\n';
+
+                     for (auto m = m_modules.begin(); m != m_modules.end(); ++m)
+                            os << m->mtime << ' ' << m->size << ' ' << m->name << '\n';
+
+                     os << plugins.size() << '\n';
+
+                     for (auto p = plugins.begin(); p != plugins.end(); ++p)
+                            os << p->first << ' ' << p->second << '\n';
+
+                     if (!os.good()) {
+                            cvdebug() << "CPluginCache: unable to write '" << tmpname.str() << "'\n";
+                            bfs::remove(bfs::path(tmpname.str()));
+                            return false;
+                     }
+              }
+              bfs::rename(bfs::path(tmpname.str()), filename);
+       } catch (bfs::filesystem_error& x) {
+              cvdebug() << "CPluginCache: unable to write '" << m_filename << "':" << x.what() << "\n";
+              return false;
+       }
+
+       return true;
+}
+
+NS_MIA_END
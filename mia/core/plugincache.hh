@@ -0,0 +1,107 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef mia_core_plugincache_hh
+#define mia_core_plugincache_hh
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <mia/core/defines.hh>
+
+NS_MIA_BEGIN
+
+/**
+   \ingroup plugin
+   \brief On-disk index of the plug-ins provided by the modules of one plug-in handler
+
+   Loading all modules of a plug-in handler to query their interfaces is expensive,
+   especially if a program only uses one or two of the plug-ins. This class stores
+   which module provides which plug-in. The index is only considered valid if the
+   list of module files, their modification times, and their sizes did not change
+   since the index was written, so that a plug-in handler can load only
+   the modules that are actually requested.
+
+   The cache is only used if the environment variable MIA_PLUGIN_CACHE is set. Its value
+   is the directory the index files are stored in, the value "default" selects
+   $XDG_CACHE_HOME/mia or $HOME/.cache/mia. An empty string or "none" disables the cache.
+
+   The index only holds the plug-in names and the modules that provide them, the
+   parameter descriptions are not cached. Hence, a plug-in handler still needs to
+   load all its modules when the help of all plug-ins is requested.
+*/
+class EXPORT_CORE CPluginCache
+{
+public:
+       /// maps the plug-in names to the file names of the modules that provide them
+       typedef std::map<std::string, std::string> CModuleMap;
+
+       /**
+          Create the cache for the given modules of a plug-in handler, the
+          file name is derived from the handler type and the module directories.
+          \param data the data path part of the plug-in handler
+          \param type the type path part of the plug-in handler
+          \param modules the file names of the modules currently found in the search path
+       */
+       CPluginCache(const std::string& data, const std::string& type,
+                    const std::vector<std::string>& modules);
+
+       /**
+          Create the cache for the given modules using an explicit cache file
+          \param filename the file to store the index in
+          \param modules the file names of the modules currently found in the search path
+       */
+       CPluginCache(const std::string& filename, const std::vector<std::string>& modules);
+
+       /**
+          Read the index
+          \param[out] plugins the plug-in to module map
+          \returns true if the index exists and is valid for the current modules
+       */
+       bool read(CModuleMap& plugins) const;
+
+       /**
+          Write the index, failures are not fatal, they only mean that the next
+          run of a program will not use the cache.
+          \param plugins the plug-in to module map
+          \returns true if the index was written
+       */
+       bool write(const CModuleMap& plugins) const;
+
+       /// \returns the file name of the index, empty if caching is disabled
+       const std::string& get_filename() const;
+private:
+       struct SModuleStamp {
+              std::string name;
+              long long mtime;
+              long long size;
+              bool operator == (const SModuleStamp& other) const;
+       };
+
+       void stamp_modules(const std::vector<std::string>& modules);
+
+       std::string m_filename;
+       std::vector<SModuleStamp> m_modules;
+};
+
+NS_MIA_END
+
+#endif
@@ -0,0 +1,354 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <map>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+
+#include <mia/core/profiling.hh>
+#include <mia/core/parallel.hh>
+#include <mia/core/errormacro.hh>
+
+NS_MIA_BEGIN
+
+using std::string;
+using std::vector;
+using std::map;
+using std::pair;
+using std::make_pair;
+using std::ostream;
+
+const TDictMap<CProfiler::EFormat>::Table profile_format_table[] = {
+       {"summary", CProfiler::pf_summary, "JSON summary of the number of calls and run-times per processing step"},
+       {"trace", CProfiler::pf_trace, "Chrome trace event format (JSON) that lists each call"},
+       {NULL, CProfiler::pf_unknown, ""}
+};
+
+const TDictMap<CProfiler::EFormat> g_profile_format_dict(profile_format_table);
+
+std::atomic<bool> CProfiler::s_enabled(false);
+
+// the trace is truncated after this number of events to limit the memory use
+static const size_t max_trace_events = 1 << 20;
+
+struct SSectionStats {
+       SSectionStats();
+       size_t calls;
+       double total;
+       double min;
+       double max;
+};
+
+SSectionStats::SSectionStats():
+       calls(0),
+       total(0.0),
+       min(0.0),
+       max(0.0)
+{
+}
+
+struct STraceEvent {
+       const char *category;
+       string name;
+       double start;
+       double duration;
+       int thread;
+};
+
+struct CProfilerImpl {
+       CProfilerImpl();
+       int get_thread_index();
+
+       typedef pair<string, string> SectionKey;
+
+       std::chrono::steady_clock::time_point m_start_time;
+       string m_filename;
+       CProfiler::EFormat m_format;
+       mutable CMutex m_mutex;
+       map<SectionKey, SSectionStats> m_sections;
+       map<string, long> m_counters;
+       vector<STraceEvent> m_events;
+       size_t m_dropped_events;
+       map<std::thread::id, int> m_threads;
+};
+
+CProfilerImpl::CProfilerImpl():
+       m_start_time(std::chrono::steady_clock::now()),
+       m_format(CProfiler::pf_summary),
+       m_dropped_events(0)
+{
+}
+
+int CProfilerImpl::get_thread_index()
+{
+       auto id = std::this_thread::get_id();
+       auto i = m_threads.find(id);
+
+       if (i != m_threads.end())
+              return i->second;
+
+       const int index = m_threads.size();
+       m_threads[id] = index;
+       return index;
+}
+
+static void write_json_string(ostream& os, const string& s)
+{
+       os << '"';
+
+       for (auto c : s) {
+              switch (c) {
+              case '"':
+                     os << "\\\"";
+                     break;
+
+              case '\\':
+                     os << "\\\\";
+                     break;
+
+              case '\n':
+                     os << "\\n";
+                     break;
+
+              case '\t':
+                     os << "\\t";
+                     break;
+
+              default:
+                     if (static_cast<unsigned char>(c) < 0x20)
+                            os << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+                               << static_cast<int>(c) << std::dec << std::setfill(' ');
+                     else
+                            os << c;
+              }
+       }
+
+       os << '"';
+}
+
+CProfiler::CProfiler():
+       impl(new CProfilerImpl)
+{
+}
+
+CProfiler::~CProfiler()
+{
+       if (!impl->m_filename.empty()) {
+              try {
+                     write();
+              } catch (std::exception& x) {
+                     std::cerr << "Profiler: " << x.what() << "\n";
+              }
+       }
+
+       delete impl;
+}
+
+CProfiler& CProfiler::instance()
+{
+       static CProfiler profiler;
+       return profiler;
+}
+
+void CProfiler::enable(const string& filename, EFormat format)
+{
+       CScopedLock lock(impl->m_mutex);
+       impl->m_filename = filename;
+       impl->m_format = format;
+       s_enabled = true;
+}
+
+void CProfiler::disable()
+{
+       s_enabled = false;
+}
+
+void CProfiler::clear()
+{
+       CScopedLock lock(impl->m_mutex);
+       impl->m_sections.clear();
+       impl->m_counters.clear();
+       impl->m_events.clear();
+       impl->m_dropped_events = 0;
+}
+
+double CProfiler::now() const
+{
+       return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() -
+                     impl->m_start_time).count();
+}
+
+void CProfiler::add_section(const char *category, const string& name, double start, double duration)
+{
+       CScopedLock lock(impl->m_mutex);
+       auto& stats = impl->m_sections[make_pair(string(category), name)];
+
+       if (!stats.calls || duration < stats.min)
+              stats.min = duration;
+
+       if (!stats.calls || duration > stats.max)
+              stats.max = duration;
+
+       ++stats.calls;
+       stats.total += duration;
+
+       if (impl->m_format == pf_trace) {
+              if (impl->m_events.size() < max_trace_events) {
+                     STraceEvent event = {category, name, start, duration, impl->get_thread_index()};
+                     impl->m_events.push_back(event);
+              } else
+                     ++impl->m_dropped_events;
+       }
+}
+
+void CProfiler::add_count(const string& name, long value)
+{
+       CScopedLock lock(impl->m_mutex);
+       impl->m_counters[name] += value;
+}
+
+size_t CProfiler::get_calls(const char *category, const string& name) const
+{
+       CScopedLock lock(impl->m_mutex);
+       auto i = impl->m_sections.find(make_pair(string(category), name));
+       return i != impl->m_sections.end() ? i->second.calls : 0;
+}
+
+long CProfiler::get_count(const string& name) const
+{
+       CScopedLock lock(impl->m_mutex);
+       auto i = impl->m_counters.find(name);
+       return i != impl->m_counters.end() ? i->second : 0;
+}
+
+void CProfiler::write() const
+{
+       std::ofstream os(impl->m_filename.c_str());
+
+       if (!os.good())
+              throw create_exception<std::runtime_error>("CProfiler: unable to open '",
+                            impl->m_filename, "' for writing");
+
+       write(os, impl->m_format);
+
+       if (!os.good())
+              throw create_exception<std::runtime_error>("CProfiler: error writing to '",
+                            impl->m_filename, "'");
+}
+
+void CProfiler::write(ostream& os, EFormat format) const
+{
+       CScopedLock lock(impl->m_mutex);
+
+       if (format == pf_trace)
+              write_trace(os);
+       else
+              write_summary(os);
+}
+
+void CProfiler::write_summary(ostream& os) const
+{
+       os << "{\n  \"sections\": [";
+       bool first = true;
+
+       for (auto& s : impl->m_sections) {
+              os << (first ? "\n" : ",\n") << "    {\"category\": ";
+              write_json_string(os, s.first.first);
+              os << ", \"name\": ";
+              write_json_string(os, s.first.second);
+              os << ", \"calls\": " << s.second.calls
+                 << ", \"total_ms\": " << s.second.total / 1000.0
+                 << ", \"mean_ms\": " << s.second.total / (1000.0 * s.second.calls)
+                 << ", \"min_ms\": " << s.second.min / 1000.0
+                 << ", \"max_ms\": " << s.second.max / 1000.0 << "}";
+              first = false;
+       }
+
+       os << "\n  ],\n  \"counters\": {";
+       first = true;
+
+       for (auto& c : impl->m_counters) {
+              os << (first ? "\n    " : ",\n    ");
+              write_json_string(os, c.first);
+              os << ": " << c.second;
+              first = false;
+       }
+
+       os << "\n  }\n}\n";
+}
+
+void CProfiler::write_trace(ostream& os) const
+{
+       const auto flags = os.flags();
+       const auto precision = os.precision();
+       os << std::fixed << std::setprecision(3);
+       os << "{\"traceEvents\": [";
+       bool first = true;
+
+       for (auto& e : impl->m_events) {
+              os << (first ? "\n" : ",\n") << "{\"name\": ";
+              write_json_string(os, e.name);
+              os << ", \"cat\": ";
+              write_json_string(os, e.category);
+              os << ", \"ph\": \"X\", \"ts\": " << e.start << ", \"dur\": " << e.duration
+                 << ", \"pid\": 1, \"tid\": " << e.thread << "}";
+              first = false;
+       }
+
+       for (auto& c : impl->m_counters) {
+              os << (first ? "\n" : ",\n") << "{\"name\": ";
+              write_json_string(os, c.first);
+              os << ", \"ph\": \"C\", \"ts\": 0, \"pid\": 1, \"args\": {\"value\": " << c.second << "}}";
+              first = false;
+       }
+
+       os << "\n], \"displayTimeUnit\": \"ms\", \"otherData\": {\"dropped_events\": "
+          << impl->m_dropped_events << "}}\n";
+       os.flags(flags);
+       os.precision(precision);
+}
+
+void CProfileScope::start()
+{
+       m_start = CProfiler::instance().now();
+}
+
+void CProfileScope::stop()
+{
+       auto& profiler = CProfiler::instance();
+       const double duration = profiler.now() - m_start;
+       string name;
+
+       if (m_product)
+              name = m_product->get_init_string();
+       else
+              name = m_name;
+
+       if (name.empty())
+              name = "(unnamed)";
+
+       profiler.add_section(m_category, name, m_start, duration);
+}
+
+NS_MIA_END
@@ -0,0 +1,221 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef mia_core_profiling_hh
+#define mia_core_profiling_hh
+
+#include <miaconfig.h>
+#include <atomic>
+#include <string>
+#include <ostream>
+#include <mia/core/defines.hh>
+#include <mia/core/dictmap.hh>
+#include <mia/core/product_base.hh>
+
+NS_MIA_BEGIN
+
+/**
+   \ingroup misc
+
+   \brief Collects run-time measurements of the processing steps
+
+   The profiler gathers the time spent in instrumented code sections
+   (see CProfileScope) and named counters. The measurements are grouped
+   by a category (like "filter" or "cost") and a name, which is normally the
+   init string of the plug-in product that does the work. As long as the profiler
+   is not enabled, the instrumentation only costs the test of a flag.
+
+   The results can be written as a JSON summary that gives for each section the
+   number of calls and the accumulated, minimal, and maximal run-time, or as
+   a trace in the Chrome trace event format that can be inspected with
+   chrome://tracing or similar tools.  Command line tools enable the profiler
+   with the options --profile and --profile-format.
+ */
+class EXPORT_CORE CProfiler
+{
+public:
+       /// the supported output formats
+       enum EFormat {
+              pf_summary, /**< JSON summary of the accumulated times and counters */
+              pf_trace,   /**< Chrome trace event format */
+              pf_unknown
+       };
+
+       /// \returns the profiler instance
+       static CProfiler& instance();
+
+       /// \returns true if measurements should be recorded
+       static bool is_enabled()
+       {
+              return s_enabled.load(std::memory_order_relaxed);
+       }
+
+       /**
+          Enable the recording of measurements
+          \param filename if not empty the results will be written to this file at program exit
+          \param format the output format
+        */
+       void enable(const std::string& filename = std::string(), EFormat format = pf_summary);
+
+       /// Stop recording measurements
+       void disable();
+
+       /// Remove all recorded measurements
+       void clear();
+
+       /**
+          Record the run-time of a section
+          \param category the category of the section, it must be a string with static
+          storage duration, like a string literal
+          \param name the name of the section
+          \param start start time in micro seconds since the profiler was created
+          \param duration run-time in micro seconds
+        */
+       void add_section(const char *category, const std::string& name, double start, double duration);
+
+       /**
+          Add a value to a named counter
+          \param name
+          \param value
+        */
+       void add_count(const std::string& name, long value);
+
+       /// \returns the time in micro seconds since the profiler was created
+       double now() const;
+
+       /// \returns the number of calls of the given section
+       size_t get_calls(const char *category, const std::string& name) const;
+
+       /// \returns the value of the given counter
+       long get_count(const std::string& name) const;
+
+       /**
+          Write the results in the given format. Note, that the trace only lists the
+          sections that were recorded while the trace format was enabled.
+        */
+       void write(std::ostream& os, EFormat format) const;
+
+       /// Write the results to the file given when the profiler was enabled
+       void write() const;
+
+       ~CProfiler();
+private:
+       CProfiler();
+       CProfiler(const CProfiler& other) = delete;
+       CProfiler& operator = (const CProfiler& other) = delete;
+
+       void write_summary(std::ostream& os) const;
+       void write_trace(std::ostream& os) const;
+
+       static std::atomic<bool> s_enabled;
+       struct CProfilerImpl *impl;
+};
+
+/// dictionary for the profiler output formats
+extern EXPORT_CORE const TDictMap<CProfiler::EFormat> g_profile_format_dict;
+
+/**
+   \ingroup misc
+
+   \brief Measures the run-time of a scope
+
+   When the profiler is enabled the time between the creation and the destruction
+   of an instance of this class is recorded in the CProfiler instance. Use the macro
+   MIA_PROFILE_SCOPE to instrument a code section, since this macro is empty
+   if MIA was configured without profiling support.
+ */
+class EXPORT_CORE CProfileScope
+{
+public:
+       /**
+          Start measuring
+          \param category category of the section, a string literal
+          \param name name of the section, it must be valid as long as this object exists
+        */
+       CProfileScope(const char *category, const char *name):
+              m_category(category),
+              m_name(name),
+              m_product(nullptr),
+              m_start(-1.0)
+       {
+              if (CProfiler::is_enabled())
+                     start();
+       }
+
+       /**
+          Start measuring, the name of the section is taken from the init string of a product
+          \param category category of the section, a string literal
+          \param product the plug-in product that runs in this section
+        */
+       CProfileScope(const char *category, const CProductBase& product):
+              m_category(category),
+              m_name(nullptr),
+              m_product(&product),
+              m_start(-1.0)
+       {
+              if (CProfiler::is_enabled())
+                     start();
+       }
+
+       ~CProfileScope()
+       {
+              if (m_start >= 0.0)
+                     stop();
+       }
+private:
+       void start();
+       void stop();
+
+       const char *m_category;
+       const char *m_name;
+       const CProductBase *m_product;
+       double m_start;
+};
+
+#ifdef ENABLE_PROFILING
+#define MIA_PROFILE_CONCAT2(a, b) a ## b
+#define MIA_PROFILE_CONCAT(a, b) MIA_PROFILE_CONCAT2(a, b)
+
+/**
+   Measure the run-time of the current scope
+   \param category the category of the section
+   \param name the name of the section, either a string or a plug-in product
+ */
+#define MIA_PROFILE_SCOPE(category, name)                                 \
+       ::mia::CProfileScope MIA_PROFILE_CONCAT(mia_profile_scope_, __LINE__)(category, name)
+
+/**
+   Add a value to a named counter
+   \param name
+   \param value
+ */
+#define MIA_PROFILE_COUNT(name, value)                                    \
+       do {                                                              \
+              if (::mia::CProfiler::is_enabled())                        \
+                     ::mia::CProfiler::instance().add_count(name, value); \
+       } while (0)
+#else
+#define MIA_PROFILE_SCOPE(category, name)
+#define MIA_PROFILE_COUNT(name, value)
+#endif
+
+NS_MIA_END
+
+#endif
@@ -23,6 +23,7 @@
 NS_MIA_BEGIN
 
 EXPORT_CORE const char *property_gradient = "gradient";
+EXPORT_CORE const char *property_sampling = "sampling";
 
 CPropertyFlagHolder::~CPropertyFlagHolder()
 {
@@ -29,6 +29,9 @@ NS_MIA_BEGIN
 /// constant defining the gradient property
 extern EXPORT_CORE const char *property_gradient;
 
+/// constant defining the property of cost functions that can be evaluated on a sub-set of the voxels
+extern EXPORT_CORE const char *property_sampling;
+
 
 /**
    \ingroup cmdline
@@ -121,7 +121,7 @@ void CPluginSearchpath::add(const boost::filesystem::path& path)
        impl->m_paths.push_back(path);
 }
 
-std::vector<PPluginModule> CPluginSearchpath::find_modules(const std::string& data, const std::string& type) const
+std::vector<std::string> CPluginSearchpath::find_module_files(const std::string& data, const std::string& type) const
 {
        if (impl->m_paths.empty())
               impl->set_standard_paths();
@@ -129,9 +129,8 @@ std::vector<PPluginModule> CPluginSearchpath::find_modules(const std::string& da
        std::stringstream pattern;
        pattern << ".*\\." << MIA_MODULE_SUFFIX << "$";
        regex pat_expr(pattern.str());
-       std::vector<PPluginModule> result;
+       std::vector<std::string> result;
        path type_path = path(data) / path(type);
-       std::vector<path> candidates;
 
        for (auto p : impl->m_paths) {
               auto dir = impl->m_no_subpath ? p  : p / type_path;
@@ -147,7 +146,7 @@ std::vector<PPluginModule> CPluginSearchpath::find_modules(const std::string& da
                             cvdebug() << "    candidate:'" << di->path().string() << "'";
 
                             if (regex_match(di->path().string(), pat_expr)) {
-                                   candidates.push_back(*di);
+                                   result.push_back(di->path().string());
                                    cverb << " add\n";
                             } else
                                    cverb << " discard\n";
@@ -157,16 +156,23 @@ std::vector<PPluginModule> CPluginSearchpath::find_modules(const std::string& da
               }
        }
 
-       for (auto i : candidates) {
+       return result;
+}
+
+std::vector<PPluginModule> CPluginSearchpath::find_modules(const std::string& data, const std::string& type) const
+{
+       std::vector<PPluginModule> result;
+
+       for (auto i : find_module_files(data, type)) {
               try {
-                     cvdebug() << " Load '" << i.string() << "'\n";
-                     result.push_back(PPluginModule(new CPluginModule(i.string().c_str())));
+                     cvdebug() << " Load '" << i << "'\n";
+                     result.push_back(PPluginModule(new CPluginModule(i.c_str())));
               } catch (std::invalid_argument& ex) {
                      cverr() << ex.what() << "\n";
               } catch (std::exception& ex) {
                      cverr() << ex.what() << "\n";
               } catch (...) {
-                     cverr() << "Loading module " << i.string() << "failed for unknown reasons\n";
+                     cverr() << "Loading module " << i << "failed for unknown reasons\n";
               }
        }
 
@@ -47,6 +47,9 @@ public:
 
        std::vector<PPluginModule> find_modules(const std::string& data, const std::string& type) const;
 
+       /// \returns the file names of the modules in the search path without loading them
+       std::vector<std::string> find_module_files(const std::string& data, const std::string& type) const;
+
 private:
        struct CPluginSearchpathData *impl;
 
@@ -200,11 +200,20 @@ double CSplineParzenMI::get_gradient(double moving, double reference) const
 double CSplineParzenMI::get_gradient_slow(double moving, double reference) const
 {
        TRACE_FUNCTION;
-       double mov = scale_moving(moving);
-       double ref = scale_reference(reference);
        vector<double> moving_parzen_derivatives(m_mov_kernel->size());
        vector<double> moving_parzen_weights(m_mov_kernel->size());
        vector<double> reference_parzen_values(m_ref_kernel->size());
+       return get_gradient_slow(moving, reference, moving_parzen_derivatives,
+                                moving_parzen_weights, reference_parzen_values);
+}
+
+double CSplineParzenMI::get_gradient_slow(double moving, double reference,
+              CSplineKernel::VWeight& moving_parzen_derivatives,
+              CSplineKernel::VWeight& moving_parzen_weights,
+              CSplineKernel::VWeight& reference_parzen_values) const
+{
+       double mov = scale_moving(moving);
+       double ref = scale_reference(reference);
        // inverse bin size needed in [1] eqn 24
        const double inv_et = 1.0 / m_mov_scale;
        const int start_mov_idx = m_mov_kernel->get_start_idx_and_derivative_weights(mov, moving_parzen_derivatives)
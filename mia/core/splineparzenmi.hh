@@ -25,9 +25,28 @@
 #include <boost/concept_check.hpp>
 #include <mia/core/splinekernel.hh>
 #include <mia/core/histogram.hh>
+#include <mia/core/parallel.hh>
+
+#include <iterator>
+#include <type_traits>
 
 NS_MIA_BEGIN
 
+/// @cond INTERNAL
+template <typename... I>
+struct __are_random_access_iterators: public std::true_type
+{
+};
+
+template <typename I, typename... Rest>
+struct __are_random_access_iterators<I, Rest...>: public std::integral_constant < bool,
+       std::is_base_of<std::random_access_iterator_tag,
+       typename std::iterator_traits<I>::iterator_category>::value &&
+       __are_random_access_iterators<Rest...>::value >
+{
+};
+/// @endcond
+
 /**
    \ingroup registration
    \brief Implementation of mutual information based on B-splines
@@ -58,7 +77,8 @@ public:
 
 
        /**
-          Fill the histogram structures and caches
+          Fill the histogram structures and caches. If both iterators are random access
+          iterators, the joined histogram is accumulated in parallel.
           @tparam MovIterator forward iterator type for moving image
           @tparam RefIterator forward iterator type for reference image
           @param mov_begin begin of moving image range
@@ -118,6 +138,40 @@ public:
         */
 
        double get_gradient_slow(double moving, double reference) const;
+
+       /**
+          Evaluate the gradient of the MI with respect to all intensity pairs of the
+          given ranges like get_gradient_slow does, but in parallel and without
+          allocating temporary memory for each pair.
+          @tparam MovIterator random access iterator type for moving image
+          @tparam RefIterator random access iterator type for reference image
+          @tparam OutIterator random access iterator type for the output
+          @param mov_begin begin of moving image range
+          @param mov_end end of moving image range
+          @param ref_begin begin of reference image range
+          @param out begin of the output range, must provide space for all gradient values
+        */
+       template <typename MovIterator, typename RefIterator, typename OutIterator>
+       void get_gradients(MovIterator mov_begin, MovIterator mov_end,
+                          RefIterator ref_begin, OutIterator out) const;
+
+       /**
+          Evaluate the gradient of the MI with respect to all intensity pairs of the
+          given ranges where the mask is set, output values outside the mask are not touched.
+          @tparam MovIterator random access iterator type for moving image
+          @tparam RefIterator random access iterator type for reference image
+          @tparam MaskIterator random access iterator type for the mask
+          @tparam OutIterator random access iterator type for the output
+          @param mov_begin begin of moving image range
+          @param mov_end end of moving image range
+          @param ref_begin begin of reference image range
+          @param mask_begin begin of mask range
+          @param out begin of the output range, must provide space for all gradient values
+        */
+       template <typename MovIterator, typename RefIterator, typename MaskIterator, typename OutIterator>
+       void get_gradients(MovIterator mov_begin, MovIterator mov_end,
+                          RefIterator ref_begin, MaskIterator mask_begin, OutIterator out) const;
+
        /**
           reset the ranges to force a new evaluation
        */
@@ -132,6 +186,35 @@ private:
        double scale_moving(double x) const;
        double scale_reference(double x) const;
 
+       double get_gradient_slow(double moving, double reference,
+                                CSplineKernel::VWeight& moving_parzen_derivatives,
+                                CSplineKernel::VWeight& moving_parzen_weights,
+                                CSplineKernel::VWeight& reference_parzen_values) const;
+
+       void add_to_histogram(double mov, double ref, std::vector<double>& histogram,
+                             CSplineKernel::VWeight& mweights,
+                             CSplineKernel::VWeight& rweights) const;
+
+       template <typename MovIterator, typename RefIterator>
+       size_t fill_joined_histogram(MovIterator mov_begin, MovIterator mov_end,
+                                    RefIterator ref_begin, RefIterator ref_end,
+                                    std::false_type is_random_access);
+
+       template <typename MovIterator, typename RefIterator>
+       size_t fill_joined_histogram(MovIterator mov_begin, MovIterator mov_end,
+                                    RefIterator ref_begin, RefIterator ref_end,
+                                    std::true_type is_random_access);
+
+       template <typename MovIterator, typename RefIterator, typename MaskIterator>
+       size_t fill_joined_histogram(MovIterator mov_begin, MovIterator mov_end,
+                                    RefIterator ref_begin, RefIterator ref_end,
+                                    MaskIterator mask_begin, std::false_type is_random_access);
+
+       template <typename MovIterator, typename RefIterator, typename MaskIterator>
+       size_t fill_joined_histogram(MovIterator mov_begin, MovIterator mov_end,
+                                    RefIterator ref_begin, RefIterator ref_end,
+                                    MaskIterator mask_begin, std::true_type is_random_access);
+
        void evaluate_histograms();
        void evaluate_log_cache();
 
@@ -208,30 +291,8 @@ CSplineParzenMI::fill(MovIterator mov_begin, MovIterator mov_end,
               cvdebug() << "Ref Range = [" << m_ref_min << ", " << m_ref_max << "]\n";
        }
 
-       std::vector<double> mweights(m_mov_kernel->size());
-       std::vector<double> rweights(m_ref_kernel->size());
-       size_t N = 0;
-
-       while (ref_begin != ref_end && mov_begin != mov_end) {
-              const double mov = scale_moving(*mov_begin);
-              const double ref = scale_reference(*ref_begin);
-              const int mov_start = m_mov_kernel->get_start_idx_and_value_weights(mov, mweights) + m_mov_border;
-              const int ref_start = m_ref_kernel->get_start_idx_and_value_weights(ref, rweights) + m_ref_border;
-
-              for (size_t r = 0; r < m_ref_kernel->size(); ++r) {
-                     auto inbeg = m_joined_histogram.begin() +
-                                  m_mov_real_bins * (ref_start + r) + mov_start;
-                     double rw = rweights[r];
-                     std::transform(mweights.begin(), mweights.end(), inbeg, inbeg,
-                     [rw](double mw, double jhvalue) {
-                            return mw * rw + jhvalue;
-                     });
-              }
-
-              ++N;
-              ++mov_begin;
-              ++ref_begin;
-       }
+       const size_t N = fill_joined_histogram(mov_begin, mov_end, ref_begin, ref_end,
+                                              __are_random_access_iterators<MovIterator, RefIterator>());
 
        cvdebug() << "CSplineParzenMI::fill: counted " << N << " pixels\n";
        // normalize joined histogram
@@ -283,27 +344,100 @@ void CSplineParzenMI::fill(MovIterator mov_begin, MovIterator mov_end,
               cvdebug() << "Ref Range = [" << m_ref_min << ", " << m_ref_max << "]\n";
        }
 
+       const size_t N = fill_joined_histogram(mov_begin, mov_end, ref_begin, ref_end, mask_begin,
+                                              __are_random_access_iterators<MovIterator, RefIterator, MaskIterator>());
+
+       cvdebug() << "CSplineParzenMI::fill: counted " << N << " pixels\n";
+       // normalize joined histogram
+       const double nscale = 1.0 / N;
+       transform(m_joined_histogram.begin(), m_joined_histogram.end(), m_joined_histogram.begin(),
+       [&nscale](double jhvalue) {
+              return jhvalue * nscale;
+       });
+       evaluate_histograms();
+       evaluate_log_cache();
+}
+
+inline void CSplineParzenMI::add_to_histogram(double mov, double ref, std::vector<double>& histogram,
+              CSplineKernel::VWeight& mweights,
+              CSplineKernel::VWeight& rweights) const
+{
+       const int mov_start = m_mov_kernel->get_start_idx_and_value_weights(mov, mweights) + m_mov_border;
+       const int ref_start = m_ref_kernel->get_start_idx_and_value_weights(ref, rweights) + m_ref_border;
+
+       for (size_t r = 0; r < rweights.size(); ++r) {
+              auto inbeg = histogram.begin() + m_mov_real_bins * (ref_start + r) + mov_start;
+              const double rw = rweights[r];
+
+              for (size_t m = 0; m < mweights.size(); ++m)
+                     inbeg[m] += mweights[m] * rw;
+       }
+}
+
+template <typename MovIterator, typename RefIterator>
+size_t CSplineParzenMI::fill_joined_histogram(MovIterator mov_begin, MovIterator mov_end,
+              RefIterator ref_begin, RefIterator ref_end,
+              std::false_type MIA_PARAM_UNUSED(is_random_access))
+{
        std::vector<double> mweights(m_mov_kernel->size());
        std::vector<double> rweights(m_ref_kernel->size());
        size_t N = 0;
 
        while (ref_begin != ref_end && mov_begin != mov_end) {
-              if (*mask_begin) {
-                     const double mov = scale_moving(*mov_begin);
-                     const double ref = scale_reference(*ref_begin);
-                     const int mov_start = m_mov_kernel->get_start_idx_and_value_weights(mov, mweights) + m_mov_border;
-                     const int ref_start = m_ref_kernel->get_start_idx_and_value_weights(ref, rweights) + m_ref_border;
-
-                     for (size_t r = 0; r < m_ref_kernel->size(); ++r) {
-                            auto inbeg = m_joined_histogram.begin() +
-                                         m_mov_real_bins * (ref_start + r) + mov_start;
-                            double rw = rweights[r];
-                            std::transform(mweights.begin(), mweights.end(), inbeg, inbeg,
-                            [rw](double mw, double jhvalue) {
-                                   return mw * rw + jhvalue;
-                            });
-                     }
+              add_to_histogram(scale_moving(*mov_begin), scale_reference(*ref_begin),
+                               m_joined_histogram, mweights, rweights);
+              ++N;
+              ++mov_begin;
+              ++ref_begin;
+       }
+
+       return N;
+}
 
+template <typename MovIterator, typename RefIterator>
+size_t CSplineParzenMI::fill_joined_histogram(MovIterator mov_begin, MovIterator mov_end,
+              RefIterator ref_begin, RefIterator ref_end,
+              std::true_type MIA_PARAM_UNUSED(is_random_access))
+{
+       const int N = std::min(std::distance(mov_begin, mov_end), std::distance(ref_begin, ref_end));
+       // every thread accumulates its own partial joined histogram
+       auto accumulate = [this, mov_begin, ref_begin](const C1DParallelRange & range,
+       std::vector<double> histogram) -> std::vector<double> {
+              std::vector<double> mweights(m_mov_kernel->size());
+              std::vector<double> rweights(m_ref_kernel->size());
+
+              for (auto i = range.begin(); i != range.end(); ++i)
+              {
+                     add_to_histogram(scale_moving(mov_begin[i]), scale_reference(ref_begin[i]),
+                                      histogram, mweights, rweights);
+              }
+              return histogram;
+       };
+       auto sum = [](const std::vector<double>& a, const std::vector<double>& b) -> std::vector<double> {
+              std::vector<double> result(a);
+
+              for (size_t i = 0; i < result.size(); ++i)
+                     result[i] += b[i];
+
+              return result;
+       };
+       m_joined_histogram = preduce(C1DParallelRange(0, N, 4096), m_joined_histogram, accumulate, sum);
+       return N;
+}
+
+template <typename MovIterator, typename RefIterator, typename MaskIterator>
+size_t CSplineParzenMI::fill_joined_histogram(MovIterator mov_begin, MovIterator mov_end,
+              RefIterator ref_begin, RefIterator ref_end,
+              MaskIterator mask_begin, std::false_type MIA_PARAM_UNUSED(is_random_access))
+{
+       std::vector<double> mweights(m_mov_kernel->size());
+       std::vector<double> rweights(m_ref_kernel->size());
+       size_t N = 0;
+
+       while (ref_begin != ref_end && mov_begin != mov_end) {
+              if (*mask_begin) {
+                     add_to_histogram(scale_moving(*mov_begin), scale_reference(*ref_begin),
+                                      m_joined_histogram, mweights, rweights);
                      ++N;
               }
 
@@ -312,15 +446,76 @@ void CSplineParzenMI::fill(MovIterator mov_begin, MovIterator mov_end,
               ++ref_begin;
        }
 
-       cvdebug() << "CSplineParzenMI::fill: counted " << N << " pixels\n";
-       // normalize joined histogram
-       const double nscale = 1.0 / N;
-       transform(m_joined_histogram.begin(), m_joined_histogram.end(), m_joined_histogram.begin(),
-       [&nscale](double jhvalue) {
-              return jhvalue * nscale;
+       return N;
+}
+
+template <typename MovIterator, typename RefIterator, typename MaskIterator>
+size_t CSplineParzenMI::fill_joined_histogram(MovIterator mov_begin, MovIterator mov_end,
+              RefIterator ref_begin, RefIterator ref_end,
+              MaskIterator mask_begin, std::true_type MIA_PARAM_UNUSED(is_random_access))
+{
+       const int N = std::min(std::distance(mov_begin, mov_end), std::distance(ref_begin, ref_end));
+       auto accumulate = [this, mov_begin, ref_begin, mask_begin](const C1DParallelRange & range,
+       std::vector<double> histogram) -> std::vector<double> {
+              std::vector<double> mweights(m_mov_kernel->size());
+              std::vector<double> rweights(m_ref_kernel->size());
+
+              for (auto i = range.begin(); i != range.end(); ++i)
+              {
+                     if (mask_begin[i])
+                            add_to_histogram(scale_moving(mov_begin[i]), scale_reference(ref_begin[i]),
+                                             histogram, mweights, rweights);
+              }
+              return histogram;
+       };
+       auto sum = [](const std::vector<double>& a, const std::vector<double>& b) -> std::vector<double> {
+              std::vector<double> result(a);
+
+              for (size_t i = 0; i < result.size(); ++i)
+                     result[i] += b[i];
+
+              return result;
+       };
+       m_joined_histogram = preduce(C1DParallelRange(0, N, 4096), m_joined_histogram, accumulate, sum);
+       return std::count_if(mask_begin, mask_begin + N, [](typename std::iterator_traits<MaskIterator>::value_type m) {
+              return static_cast<bool>(m);
        });
-       evaluate_histograms();
-       evaluate_log_cache();
+}
+
+template <typename MovIterator, typename RefIterator, typename OutIterator>
+void CSplineParzenMI::get_gradients(MovIterator mov_begin, MovIterator mov_end,
+                                    RefIterator ref_begin, OutIterator out) const
+{
+       auto evaluate = [this, mov_begin, ref_begin, out](const C1DParallelRange & range) {
+              CSplineKernel::VWeight moving_parzen_derivatives(m_mov_kernel->size());
+              CSplineKernel::VWeight moving_parzen_weights(m_mov_kernel->size());
+              CSplineKernel::VWeight reference_parzen_values(m_ref_kernel->size());
+
+              for (auto i = range.begin(); i != range.end(); ++i) {
+                     out[i] = get_gradient_slow(mov_begin[i], ref_begin[i], moving_parzen_derivatives,
+                                                moving_parzen_weights, reference_parzen_values);
+              }
+       };
+       pfor(C1DParallelRange(0, std::distance(mov_begin, mov_end), 1024), evaluate);
+}
+
+template <typename MovIterator, typename RefIterator, typename MaskIterator, typename OutIterator>
+void CSplineParzenMI::get_gradients(MovIterator mov_begin, MovIterator mov_end,
+                                    RefIterator ref_begin, MaskIterator mask_begin,
+                                    OutIterator out) const
+{
+       auto evaluate = [this, mov_begin, ref_begin, mask_begin, out](const C1DParallelRange & range) {
+              CSplineKernel::VWeight moving_parzen_derivatives(m_mov_kernel->size());
+              CSplineKernel::VWeight moving_parzen_weights(m_mov_kernel->size());
+              CSplineKernel::VWeight reference_parzen_values(m_ref_kernel->size());
+
+              for (auto i = range.begin(); i != range.end(); ++i) {
+                     if (mask_begin[i])
+                            out[i] = get_gradient_slow(mov_begin[i], ref_begin[i], moving_parzen_derivatives,
+                                                       moving_parzen_weights, reference_parzen_values);
+              }
+       };
+       pfor(C1DParallelRange(0, std::distance(mov_begin, mov_end), 1024), evaluate);
 }
 
 template <typename Iterator>
@@ -0,0 +1,158 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <queue>
+#include <mia/internal/autotest.hh>
+#include <mia/core/bucketqueue.hh>
+
+NS_MIA_USE
+using namespace std;
+
+BOOST_AUTO_TEST_CASE( test_bucketqueue_order )
+{
+       TBucketQueue<int> q(5);
+       BOOST_CHECK(q.empty());
+       q.push(3, 30);
+       q.push(1, 10);
+       q.push(3, 31);
+       q.push(0, 0);
+       q.push(1, 11);
+       BOOST_CHECK_EQUAL(q.size(), 5u);
+       const int expect[5] = {0, 10, 11, 30, 31};
+
+       for (int i = 0; i < 5; ++i)
+              BOOST_CHECK_EQUAL(q.pop(), expect[i]);
+
+       BOOST_CHECK(q.empty());
+       BOOST_CHECK_EQUAL(q.get_current_level(), 3u);
+}
+
+BOOST_AUTO_TEST_CASE( test_bucketqueue_lower_level_first )
+{
+       TBucketQueue<int> q(5);
+       q.push(2, 21);
+       q.push(4, 40);
+       q.push(2, 20);
+       BOOST_CHECK_EQUAL(q.pop(), 20);
+       BOOST_CHECK_EQUAL(q.get_current_level(), 2u);
+       // a lower level that is pushed later is retrieved first
+       q.push(0, 1);
+       q.push(2, 19);
+       BOOST_CHECK_EQUAL(q.pop(), 1);
+       BOOST_CHECK_EQUAL(q.get_current_level(), 0u);
+       BOOST_CHECK_EQUAL(q.pop(), 19);
+       BOOST_CHECK_EQUAL(q.pop(), 21);
+       BOOST_CHECK_EQUAL(q.pop(), 40);
+       BOOST_CHECK(q.empty());
+}
+
+/*
+  Interleaved pushes and pops must give the same sequence as a priority queue
+  that orders by (level, value).
+*/
+BOOST_AUTO_TEST_CASE( test_bucketqueue_matches_priority_queue )
+{
+       typedef pair<unsigned int, int> Entry;
+       priority_queue<Entry, vector<Entry>, greater<Entry>> reference;
+       TBucketQueue<int> q(16);
+       unsigned int seed = 17;
+
+       for (int i = 0; i < 1000; ++i) {
+              seed = seed * 1103515245 + 12345;
+              const unsigned int level = (seed >> 16) % 16;
+              q.push(level, i);
+              reference.push(Entry(level, i));
+
+              if (i % 3 == 2) {
+                     BOOST_CHECK_EQUAL(q.pop(), reference.top().second);
+                     reference.pop();
+              }
+       }
+
+       while (!reference.empty()) {
+              BOOST_REQUIRE(!q.empty());
+              BOOST_CHECK_EQUAL(q.pop(), reference.top().second);
+              reference.pop();
+       }
+
+       BOOST_CHECK(q.empty());
+}
+
+BOOST_AUTO_TEST_CASE( test_fifo_bucketqueue_order )
+{
+       TFifoBucketQueue<int> q(5);
+       BOOST_CHECK(q.empty());
+       q.push(3, 31);
+       q.push(1, 11);
+       q.push(3, 30);
+       q.push(0, 0);
+       q.push(1, 10);
+       BOOST_CHECK_EQUAL(q.size(), 5u);
+       BOOST_CHECK_EQUAL(q.pop(), 0);
+       BOOST_CHECK_EQUAL(q.pop(), 11);
+       BOOST_CHECK_EQUAL(q.get_current_level(), 1u);
+       // elements pushed to the level that is being retrieved come after the older ones
+       q.push(1, 12);
+       // a lower level that is pushed later is retrieved first
+       q.push(0, 1);
+       BOOST_CHECK_EQUAL(q.pop(), 1);
+       BOOST_CHECK_EQUAL(q.pop(), 10);
+       BOOST_CHECK_EQUAL(q.pop(), 12);
+       BOOST_CHECK_EQUAL(q.pop(), 31);
+       BOOST_CHECK_EQUAL(q.pop(), 30);
+       BOOST_CHECK(q.empty());
+       BOOST_CHECK_EQUAL(q.get_current_level(), 3u);
+       // a finished level can be used again
+       q.push(1, 13);
+       BOOST_CHECK_EQUAL(q.pop(), 13);
+       BOOST_CHECK(q.empty());
+}
+
+/*
+  Interleaved pushes and pops must give the same sequence as a priority queue
+  that orders by (level, insertion count).
+*/
+BOOST_AUTO_TEST_CASE( test_fifo_bucketqueue_matches_priority_queue )
+{
+       typedef pair<unsigned int, int> Entry;
+       priority_queue<Entry, vector<Entry>, greater<Entry>> reference;
+       TFifoBucketQueue<int> q(16);
+       unsigned int seed = 17;
+
+       for (int i = 0; i < 1000; ++i) {
+              seed = seed * 1103515245 + 12345;
+              const unsigned int level = (seed >> 16) % 16;
+              q.push(level, i);
+              reference.push(Entry(level, i));
+
+              if (i % 3 == 2) {
+                     BOOST_CHECK_EQUAL(q.pop(), reference.top().second);
+                     reference.pop();
+              }
+       }
+
+       while (!reference.empty()) {
+              BOOST_REQUIRE(!q.empty());
+              BOOST_CHECK_EQUAL(q.pop(), reference.top().second);
+              reference.pop();
+       }
+
+       BOOST_CHECK(q.empty());
+}
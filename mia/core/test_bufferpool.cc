@@ -0,0 +1,88 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <mia/internal/autotest.hh>
+#include <mia/core/bufferpool.hh>
+
+NS_MIA_USE
+using namespace std;
+
+const size_t large = 100000;
+
+BOOST_AUTO_TEST_CASE( test_size_classes )
+{
+       for (size_t n : {1, 15, 16, 17, 1000, 100000, 123456789}) {
+              const size_t c = CBufferPoolControl::get_size_class(n);
+              BOOST_CHECK_GE(c, n);
+              BOOST_CHECK_LE(c, n + n / 8 + 1);
+              // a class value is its own capacity class
+              BOOST_CHECK_EQUAL(CBufferPoolControl::get_capacity_class(c), c);
+              BOOST_CHECK_LE(CBufferPoolControl::get_capacity_class(n), n);
+       }
+}
+
+BOOST_AUTO_TEST_CASE( test_no_pooling_without_scope )
+{
+       CBufferPoolScope::reset_statistics();
+       auto b = TBufferPool<float>::get(large);
+       BOOST_CHECK_EQUAL(b.size(), large);
+       TBufferPool<float>::put(b);
+       BOOST_CHECK(b.empty());
+       auto stats = CBufferPoolScope::get_statistics();
+       BOOST_CHECK_EQUAL(stats.requests, 0u);
+       BOOST_CHECK_EQUAL(stats.bytes_cached, 0u);
+}
+
+BOOST_AUTO_TEST_CASE( test_pooling_in_scope )
+{
+       CBufferPoolScope::reset_statistics();
+       {
+              CBufferPoolScope scope;
+              BOOST_CHECK(CBufferPoolScope::is_active());
+              auto b = TBufferPool<float>::get(large);
+              const float *data = &b[0];
+              b[10] = 2.0f;
+              TBufferPool<float>::put(b);
+              BOOST_CHECK_GE(CBufferPoolScope::get_statistics().bytes_cached, large * sizeof(float));
+              // a slightly smaller buffer of the same size class re-uses the storage
+              auto c = TBufferPool<float>::get(large - 10);
+              BOOST_CHECK_EQUAL(c.size(), large - 10);
+              BOOST_CHECK_EQUAL(&c[0], data);
+              BOOST_CHECK_EQUAL(c[10], 0.0f);
+              // copies also draw from the pool
+              TBufferPool<float>::put(c);
+              vector<float> org(large, 1.0f);
+              auto d = TBufferPool<float>::get_copy(org);
+              BOOST_CHECK_EQUAL(&d[0], data);
+              BOOST_CHECK(d == org);
+              // small buffers are not pooled
+              auto s = TBufferPool<float>::get(10);
+              TBufferPool<float>::put(s);
+              auto stats = CBufferPoolScope::get_statistics();
+              BOOST_CHECK_EQUAL(stats.requests, 3u);
+              BOOST_CHECK_EQUAL(stats.hits, 2u);
+              BOOST_CHECK_CLOSE(stats.get_hit_rate(), 2.0 / 3.0, 1e-8);
+              BOOST_CHECK_GE(stats.peak_bytes_in_use, large * sizeof(float));
+              TBufferPool<float>::put(d);
+       }
+       BOOST_CHECK(!CBufferPoolScope::is_active());
+       // leaving the last scope releases the cached buffers
+       BOOST_CHECK_EQUAL(CBufferPoolScope::get_statistics().bytes_cached, 0u);
+}
@@ -399,7 +399,19 @@ BOOST_FIXTURE_TEST_CASE( test_parser_help_output, CmdlineParserFixture )
                          "                        processing,This number should be lower or \n"
                          "                        equal to the number of logical processor \n"
                          "                        cores in the machine. (-1: automatic \n"
-                         "                        estimation). \n\n"
+                         "                        estimation). \n"
+#ifdef ENABLE_PROFILING
+                         "     --profile=NULL     Measure the run-time of the processing steps \n"
+                         "                        and write the results to the given file when \n"
+                         "                        the program exits\n"
+                         "     --profile-format=summary (dict) \n"
+                         "                        Output format of the run-time measurements \n"
+                         "                          summary: JSON summary of the number of \n"
+                         "                        calls and run-times per processing step\n"
+                         "                          trace: Chrome trace event format (JSON) \n"
+                         "                        that lists each call\n"
+#endif
+                         "\n"
                          "Example usage:\n  Example text\n"
                          "    \n    test-program Example command\n\n"
                          "Copyright:\n"
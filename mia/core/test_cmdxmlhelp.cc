@@ -26,6 +26,7 @@
 #include <mia/core/testplugin.hh>
 
 #include <config.h>
+#include <miaconfig.h>
 
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
@@ -207,6 +208,10 @@ string expect_xml_help_end = "</version>\n"
                              "  </group>\n"
                              "  <group name=\"Processing\">\n"
                              "    <option default=\"-1\" long=\"threads\" short=\"\" type=\"int\">Maxiumum number of threads to use for processing,This number should be lower or equal to the number of logical processor cores in the machine. (-1: automatic estimation).</option>\n"
+#ifdef ENABLE_PROFILING
+                             "    <option default=\"\" long=\"profile\" short=\"\" type=\"string\">Measure the run-time of the processing steps and write the results to the given file when the program exits<flags>output </flags></option>\n"
+                             "    <option default=\"summary\" long=\"profile-format\" short=\"\" type=\"dict\">Output format of the run-time measurements<dict><value name=\"summary\">JSON summary of the number of calls and run-times per processing step</value><value name=\"trace\">Chrome trace event format (JSON) that lists each call</value></dict></option>\n"
+#endif
                              "  </group>\n"
                              "  <freeparams name=\"none/test\" type=\"factory\"/>\n"
                              "  <stdout-is-result/>\n"
@@ -57,3 +57,26 @@ BOOST_AUTO_TEST_CASE( test_distance_from_function )
               BOOST_CHECK_CLOSE(src[i], out_1d[i], 0.1);
        }
 }
+
+BOOST_AUTO_TEST_CASE( test_distance_with_spacing )
+{
+       vector<bool> in_1d { 0, 0, 1, 0, 0, 0, 1, 0 };
+       float out_1d[8] = { 16, 4, 0, 4, 16, 4, 0, 4 };
+       vector<float> src(8);
+       distance_transform_prepare(in_1d.begin(), in_1d.end(), src.begin(), true);
+       C1DDistanceTransform dt(2.0f);
+       dt(src);
+
+       for (size_t i = 0; i < 8; ++i) {
+              BOOST_CHECK_CLOSE(src[i], out_1d[i], 0.1);
+       }
+
+       // the buffers are re-used for a second line of different length
+       vector<float> src2(4);
+       distance_transform_prepare(in_1d.begin(), in_1d.begin() + 4, src2.begin(), true);
+       dt(src2);
+
+       for (size_t i = 0; i < 4; ++i) {
+              BOOST_CHECK_CLOSE(src2[i], out_1d[i], 0.1);
+       }
+}
@@ -18,17 +18,17 @@
  *
  */
 
-#define BOOST_TEST_DYN_LINK
 #include <cassert>
 #include <iostream>
 #include <cmath>
 #include <numeric>
 #include <climits>
+#include <stdexcept>
+#include <atomic>
+#include <thread>
+#include <chrono>
 
-#include <boost/test/test_tools.hpp>
-#include <boost/test/unit_test_suite.hpp>
-#include <boost/test/tools/floating_point_comparison.hpp>
-
+#include <mia/internal/autotest.hh>
 
 #include <mia/core/cmdlineparser.hh>
 #include <mia/core/fifofilter.hh>
@@ -360,3 +360,238 @@ BOOST_AUTO_TEST_CASE( test_mean_add )
        for (int i = 0; i < 10; ++i)
               BOOST_CHECK_EQUAL(result[i], test_result[i]);
 }
+
+BOOST_AUTO_TEST_CASE( test_pipelined_chain )
+{
+       vector<int> input(200);
+
+       for (size_t i = 0; i < input.size(); ++i)
+              input[i] = (i * 37) % 101;
+
+       // run the same chain sequential and pipelined
+       vector<int> results[2];
+
+       for (int pipelined = 0; pipelined < 2; ++pipelined) {
+              CMeanIntFifoFilter filter(2);
+              CIntFifoFilter::Pointer add(new CAddSomeFifoFilter(3));
+              CIntFifoFilter::Pointer mean(new CMeanAddIntFifoFilter(1));
+              CIntFifoFilterSink::Pointer sink(new CIntFifoFilterSink());
+              filter.append_filter(add);
+
+              if (pipelined)
+                     filter.set_pipelined(2);
+
+              // appended filters inherit the execution mode
+              filter.append_filter(mean);
+              filter.append_filter(sink);
+
+              for (auto x : input)
+                     filter.push(x);
+
+              filter.finalize();
+              results[pipelined] = sink->result();
+       }
+
+       BOOST_CHECK_EQUAL(results[0].size(), input.size());
+       BOOST_CHECK_EQUAL_COLLECTIONS(results[1].begin(), results[1].end(),
+                                     results[0].begin(), results[0].end());
+}
+
+class CFailingFifoFilter : public CIntFifoFilter
+{
+public:
+       CFailingFifoFilter(int fail_value);
+private:
+       virtual int do_filter();
+       virtual void do_push(int c);
+
+       int m_fail_value;
+       int m_buf;
+};
+
+CFailingFifoFilter::CFailingFifoFilter(int fail_value):
+       CIntFifoFilter(0, 1, 0),
+       m_fail_value(fail_value),
+       m_buf(0)
+{
+}
+
+int CFailingFifoFilter::do_filter()
+{
+       return m_buf;
+}
+
+void CFailingFifoFilter::do_push(int c)
+{
+       if (c == m_fail_value)
+              throw runtime_error("CFailingFifoFilter: got the bad value");
+
+       m_buf = c;
+}
+
+BOOST_AUTO_TEST_CASE( test_pipelined_error )
+{
+       CAddSomeFifoFilter filter(0);
+       CIntFifoFilterSink::Pointer sink(new CIntFifoFilterSink());
+       filter.append_filter(CIntFifoFilter::Pointer(new CFailingFifoFilter(10)));
+       filter.append_filter(sink);
+       filter.set_pipelined(1);
+       // the error is either reported when pushing the following data or by finalize()
+       BOOST_CHECK_THROW({
+              for (int i = 0; i < 100; ++i)
+                     filter.push(i);
+
+              filter.finalize();
+       }, runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE( test_pipelined_finalize_without_data )
+{
+       CAddSomeFifoFilter filter(1);
+       CIntFifoFilterSink::Pointer sink(new CIntFifoFilterSink());
+       filter.append_filter(sink);
+       filter.set_pipelined(4);
+       filter.finalize();
+       BOOST_CHECK(sink->result().empty());
+}
+
+class CFinalCountFifoFilter : public CIntFifoFilter
+{
+public:
+       CFinalCountFifoFilter(int& finalized);
+private:
+       virtual int do_filter();
+       virtual void do_push(int c);
+       virtual void post_finalize();
+
+       int& m_finalized;
+       int m_buf;
+};
+
+CFinalCountFifoFilter::CFinalCountFifoFilter(int& finalized):
+       CIntFifoFilter(0, 1, 0),
+       m_finalized(finalized),
+       m_buf(0)
+{
+}
+
+int CFinalCountFifoFilter::do_filter()
+{
+       return m_buf;
+}
+
+void CFinalCountFifoFilter::do_push(int c)
+{
+       m_buf = c;
+}
+
+void CFinalCountFifoFilter::post_finalize()
+{
+       ++m_finalized;
+}
+
+BOOST_AUTO_TEST_CASE( test_no_final_processing_after_error )
+{
+       for (int pipelined = 0; pipelined < 2; ++pipelined) {
+              int finalized = 0;
+              CAddSomeFifoFilter filter(0);
+              CIntFifoFilterSink::Pointer sink(new CIntFifoFilterSink());
+              filter.append_filter(CIntFifoFilter::Pointer(new CFailingFifoFilter(10)));
+              filter.append_filter(CIntFifoFilter::Pointer(new CFinalCountFifoFilter(finalized)));
+              filter.append_filter(sink);
+              filter.set_pipelined(pipelined ? 2 : 0);
+              bool failed = false;
+
+              for (int i = 0; i < 100 && !failed; ++i) {
+                     try {
+                            filter.push(i);
+                     } catch (runtime_error&) {
+                            failed = true;
+                     }
+              }
+
+              BOOST_REQUIRE(failed);
+              BOOST_CHECK_THROW(filter.push(0), logic_error);
+              // the chain is only torn down
+              const size_t n_results = sink->result().size();
+              BOOST_CHECK_NO_THROW(filter.finalize());
+              BOOST_CHECK_EQUAL(finalized, 0);
+              BOOST_CHECK_EQUAL(sink->result().size(), n_results);
+              // afterwards the chain can be used again
+              filter.push(1);
+              filter.push(2);
+              filter.finalize();
+              BOOST_CHECK_EQUAL(finalized, 1);
+              BOOST_CHECK_EQUAL(sink->result().size(), n_results + 2);
+       }
+}
+
+static std::atomic<bool> g_slow_filter_alive(false);
+static std::atomic<int> g_push_to_destroyed_filter(0);
+
+class CSlowFifoFilter : public CIntFifoFilter
+{
+public:
+       CSlowFifoFilter();
+       ~CSlowFifoFilter();
+private:
+       virtual int do_filter();
+       virtual void do_push(int c);
+
+       int m_buf;
+};
+
+CSlowFifoFilter::CSlowFifoFilter():
+       CIntFifoFilter(0, 1, 0),
+       m_buf(0)
+{
+       g_slow_filter_alive = true;
+}
+
+CSlowFifoFilter::~CSlowFifoFilter()
+{
+       g_slow_filter_alive = false;
+}
+
+int CSlowFifoFilter::do_filter()
+{
+       return m_buf;
+}
+
+void CSlowFifoFilter::do_push(int c)
+{
+       std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+       if (!g_slow_filter_alive)
+              ++g_push_to_destroyed_filter;
+
+       m_buf = c;
+}
+
+/*
+  A pipelined chain that is destroyed without calling finalize() must join the
+  threads of its filters before their derived parts are destroyed.
+*/
+BOOST_AUTO_TEST_CASE( test_pipelined_destroy_without_finalize )
+{
+       g_push_to_destroyed_filter = 0;
+       {
+              CSlowFifoFilter filter;
+              filter.append_filter(CIntFifoFilter::Pointer(new CAddSomeFifoFilter(1)));
+              filter.append_filter(CIntFifoFilterSink::Pointer(new CIntFifoFilterSink()));
+              filter.set_pipelined(4);
+
+              for (int i = 0; i < 20; ++i)
+                     filter.push(i);
+       }
+       {
+              CAddSomeFifoFilter filter(1);
+              filter.append_filter(CIntFifoFilter::Pointer(new CSlowFifoFilter()));
+              filter.append_filter(CIntFifoFilterSink::Pointer(new CIntFifoFilterSink()));
+              filter.set_pipelined(4);
+
+              for (int i = 0; i < 20; ++i)
+                     filter.push(i);
+       }
+       BOOST_CHECK_EQUAL(g_push_to_destroyed_filter, 0);
+}
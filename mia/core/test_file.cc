@@ -0,0 +1,199 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+#include <mia/internal/autotest.hh>
+#include <mia/core/file.hh>
+#include <mia/core/parallel.hh>
+
+#include <unistd.h>
+#include <cstdlib>
+#include <vector>
+#include <numeric>
+
+NS_MIA_USE
+using namespace std;
+
+struct CompressedFileFixture {
+       CompressedFileFixture();
+       ~CompressedFileFixture();
+
+       void write(const string& suffix, const vector<int>& data);
+       vector<int> read(const string& suffix, size_t n);
+       void check_seek(const string& suffix);
+       bool have_program(const char *name) const;
+
+       string basename;
+       vector<int> payload;
+       vector<string> files;
+};
+
+CompressedFileFixture::CompressedFileFixture():
+       payload(1000000)
+{
+       char name[] = "/tmp/mia_test_file_XXXXXX";
+       int fd = mkstemp(name);
+       BOOST_REQUIRE(fd >= 0);
+       close(fd);
+       basename = name;
+       files.push_back(basename);
+
+       // something that compresses, but not too well
+       for (size_t i = 0; i < payload.size(); ++i)
+              payload[i] = (i * 7) % 1013 + (i / 4096);
+}
+
+CompressedFileFixture::~CompressedFileFixture()
+{
+       for (auto& f : files)
+              unlink(f.c_str());
+}
+
+void CompressedFileFixture::write(const string& suffix, const vector<int>& data)
+{
+       files.push_back(basename + suffix);
+       COutputFile f(basename + suffix);
+       BOOST_REQUIRE(f);
+
+       if (!data.empty())
+              BOOST_REQUIRE_EQUAL(fwrite(&data[0], sizeof(int), data.size(), f), data.size());
+}
+
+vector<int> CompressedFileFixture::read(const string& suffix, size_t n)
+{
+       CInputFile f(basename + suffix);
+       vector<int> result(n);
+
+       if (n > 0)
+              BOOST_CHECK_EQUAL(fread(&result[0], sizeof(int), n, f), n);
+
+       // the data must be used up
+       int dummy;
+       BOOST_CHECK_EQUAL(fread(&dummy, sizeof(int), 1, f), 0u);
+       BOOST_CHECK(feof(f));
+       return result;
+}
+
+bool CompressedFileFixture::have_program(const char *name) const
+{
+       return system((string("which ") + name + " >/dev/null 2>&1").c_str()) == 0;
+}
+
+void CompressedFileFixture::check_seek(const string& suffix)
+{
+       CInputFile f(basename + suffix);
+       const long ints[] = {600000, 100, 999999, 0, 262144, 262143};
+       int value;
+
+       for (auto i : ints) {
+              BOOST_REQUIRE_EQUAL(fseek(f, i * sizeof(int), SEEK_SET), 0);
+              BOOST_CHECK_EQUAL(ftell(f), i * sizeof(int));
+              BOOST_REQUIRE_EQUAL(fread(&value, sizeof(int), 1, f), 1u);
+              BOOST_CHECK_EQUAL(value, payload[i]);
+       }
+
+       BOOST_REQUIRE_EQUAL(fseek(f, -2 * sizeof(int), SEEK_END), 0);
+       BOOST_REQUIRE_EQUAL(fread(&value, sizeof(int), 1, f), 1u);
+       BOOST_CHECK_EQUAL(value, payload[payload.size() - 2]);
+       BOOST_REQUIRE_EQUAL(fseek(f, -1000 * sizeof(int), SEEK_CUR), 0);
+       BOOST_REQUIRE_EQUAL(fread(&value, sizeof(int), 1, f), 1u);
+       BOOST_CHECK_EQUAL(value, payload[payload.size() - 1001]);
+}
+
+#if defined(HAVE_ZLIB) && defined(__GLIBC__)
+BOOST_FIXTURE_TEST_CASE( test_gzip_write_read, CompressedFileFixture )
+{
+       write(".gz", payload);
+       BOOST_CHECK(read(".gz", payload.size()) == payload);
+       check_seek(".gz");
+}
+
+BOOST_FIXTURE_TEST_CASE( test_gzip_compatible, CompressedFileFixture )
+{
+       if (!have_program("gzip"))
+              return;
+
+       // files written in-process are standard gzip files
+       write(".gz", payload);
+       const string raw = basename + ".raw";
+       files.push_back(raw);
+       BOOST_REQUIRE_EQUAL(system(("gzip -dc " + basename + ".gz > " + raw).c_str()), 0);
+       BOOST_CHECK(read(".raw", payload.size()) == payload);
+       // files written by gzip are read and can be seeked
+       BOOST_REQUIRE_EQUAL(system(("gzip -c " + raw + " > " + basename + ".ext.gz").c_str()), 0);
+       files.push_back(basename + ".ext.gz");
+       BOOST_CHECK(read(".ext.gz", payload.size()) == payload);
+       check_seek(".ext.gz");
+}
+
+BOOST_FIXTURE_TEST_CASE( test_gzip_empty, CompressedFileFixture )
+{
+       write(".gz", vector<int>());
+       BOOST_CHECK(read(".gz", 0).empty());
+}
+
+BOOST_FIXTURE_TEST_CASE( test_gzip_corrupt, CompressedFileFixture )
+{
+       write(".gz", payload);
+       FILE *f = fopen((basename + ".gz").c_str(), "r+b");
+       BOOST_REQUIRE(f);
+       fseek(f, 100, SEEK_SET);
+       const char garbage[] = "garbage";
+       fwrite(garbage, 1, sizeof(garbage), f);
+       fclose(f);
+       CInputFile in(basename + ".gz");
+       vector<int> data(payload.size());
+       BOOST_CHECK(fread(&data[0], sizeof(int), data.size(), in) < data.size());
+       BOOST_CHECK(ferror(in));
+}
+#endif
+
+#if defined(HAVE_LZMA) && defined(__GLIBC__)
+BOOST_FIXTURE_TEST_CASE( test_xz_write_read, CompressedFileFixture )
+{
+       write(".xz", payload);
+       BOOST_CHECK(read(".xz", payload.size()) == payload);
+       check_seek(".xz");
+}
+#endif
+
+#ifndef HAVE_TBB
+BOOST_FIXTURE_TEST_CASE( test_compressed_file_parallel, CompressedFileFixture )
+{
+       const int max_tasks = CMaxTasks::get_max_tasks();
+       CMaxTasks::set_max_tasks(4);
+#if defined(HAVE_ZLIB) && defined(__GLIBC__)
+       write(".gz", payload);
+       BOOST_CHECK(read(".gz", payload.size()) == payload);
+       check_seek(".gz");
+#endif
+#if defined(HAVE_LZMA) && defined(__GLIBC__)
+       write(".xz", payload);
+       BOOST_CHECK(read(".xz", payload.size()) == payload);
+       check_seek(".xz");
+#endif
+       CMaxTasks::set_max_tasks(max_tasks);
+}
+#endif
+
+BOOST_FIXTURE_TEST_CASE( test_compressed_file_missing, CompressedFileFixture )
+{
+       BOOST_CHECK_THROW(CInputFile(basename + ".missing.gz"), runtime_error);
+}
@@ -0,0 +1,171 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <mia/internal/autotest.hh>
+#include <mia/core/linebundle.hh>
+
+using namespace mia;
+using std::vector;
+
+// a kernel with asymmetric weights and mirrored boundaries
+class CTestFoldingKernel: public C1DFoldingKernel
+{
+public:
+       CTestFoldingKernel(): C1DFoldingKernel(2)
+       {
+              (*this)[0] = 0.1;
+              (*this)[1] = -0.3;
+              (*this)[2] = 0.5;
+              (*this)[3] = 0.25;
+              (*this)[4] = 0.125;
+       }
+private:
+       vector<double> do_apply(const vector<double>& data) const
+       {
+              const int n = data.size();
+              vector<double> result(n, 0.0);
+
+              for (int i = 0; i < n; ++i)
+                     for (int k = 0; k < 5; ++k) {
+                            int idx = i + k - 2;
+
+                            if (idx < 0)
+                                   idx = -idx - 1;
+
+                            if (idx >= n)
+                                   idx = 2 * n - idx - 1;
+
+                            result[i] += (*this)[k] * data[idx];
+                     }
+
+              return result;
+       }
+};
+
+static void check_folding(size_t length)
+{
+       const size_t width = 5;
+       CTestFoldingKernel kernel;
+       C1DFoldingLineBundle bundle(kernel);
+       BOOST_CHECK_EQUAL(bundle.get_radius(), 2u);
+       vector<double> in(length * width);
+
+       for (size_t i = 0; i < in.size(); ++i)
+              in[i] = (i * 7) % 11 - 3.0;
+
+       vector<double> out(in.size());
+       bundle.apply(&in[0], &out[0], length, width);
+
+       for (size_t j = 0; j < width; ++j) {
+              vector<double> line(length);
+
+              for (size_t i = 0; i < length; ++i)
+                     line[i] = in[i * width + j];
+
+              auto test = kernel.apply(line);
+
+              for (size_t i = 0; i < length; ++i)
+                     BOOST_CHECK_CLOSE(out[i * width + j] + 10.0, test[i] + 10.0, 0.0001);
+       }
+}
+
+BOOST_AUTO_TEST_CASE( test_folding_line_bundle )
+{
+       check_folding(3);
+       check_folding(10);
+       check_folding(37);
+}
+
+BOOST_AUTO_TEST_CASE( test_box_sum_line_bundle )
+{
+       const size_t length = 9;
+       const size_t width = 3;
+       vector<double> in(length * width);
+
+       for (size_t i = 0; i < in.size(); ++i)
+              in[i] = i * i % 13;
+
+       for (size_t radius = 0; radius < 11; ++radius) {
+              vector<double> out(in.size());
+              box_sum_line_bundle(&in[0], &out[0], length, width, radius);
+
+              for (size_t i = 0; i < length; ++i) {
+                     const int b = i > radius ? i - radius : 0;
+                     const int e = std::min(i + radius + 1, length);
+                     BOOST_CHECK_EQUAL(box_count(i, length, radius), size_t(e - b));
+
+                     for (size_t j = 0; j < width; ++j) {
+                            double sum = 0.0;
+
+                            for (int k = b; k < e; ++k)
+                                   sum += in[k * width + j];
+
+                            BOOST_CHECK_EQUAL(out[i * width + j], sum);
+                     }
+              }
+       }
+}
+
+BOOST_AUTO_TEST_CASE( test_process_line_bundles )
+{
+       // a 5x4x3 volume, the lines along x need a transposition, the others not
+       const size_t nx = 5;
+       const size_t ny = 4;
+       const size_t nz = 3;
+       vector<int> data(nx * ny * nz);
+
+       for (size_t i = 0; i < data.size(); ++i)
+              data[i] = i;
+
+       auto reverse_lines = [](const double * in, double * out, size_t length, size_t width) {
+              for (size_t i = 0; i < length; ++i)
+                     for (size_t j = 0; j < width; ++j)
+                            out[i * width + j] = in[(length - i - 1) * width + j];
+       };
+       const SLineBundleLayout along_x = {nx, 1, ny * nz, nx, 1, 0};
+       const SLineBundleLayout along_y = {ny, nx, nx, 1, nz, nx * ny};
+       const SLineBundleLayout along_z = {nz, nx * ny, nx * ny, 1, 1, 0};
+       process_line_bundles<double>(data.begin(), along_x, reverse_lines);
+       process_line_bundles<double>(data.begin(), along_y, reverse_lines);
+       process_line_bundles<double>(data.begin(), along_z, reverse_lines);
+
+       for (size_t z = 0, i = 0; z < nz; ++z)
+              for (size_t y = 0; y < ny; ++y)
+                     for (size_t x = 0; x < nx; ++x, ++i)
+                            BOOST_CHECK_EQUAL(data[i], int(data.size() - i - 1));
+}
+
+BOOST_AUTO_TEST_CASE( test_process_line_bundles_bool )
+{
+       vector<bool> data {1, 1, 0, 0, 0,
+                          0, 1, 0, 1, 0
+                         };
+       auto reverse_lines = [](const float * in, float * out, size_t length, size_t width) {
+              for (size_t i = 0; i < length; ++i)
+                     for (size_t j = 0; j < width; ++j)
+                            out[i * width + j] = in[(length - i - 1) * width + j];
+       };
+       const SLineBundleLayout along_x = {5, 1, 2, 5, 1, 0};
+       process_line_bundles<float>(data.begin(), along_x, reverse_lines);
+       const vector<bool> test {0, 0, 0, 1, 1,
+                                0, 1, 0, 1, 0
+                               };
+       BOOST_CHECK(data == test);
+}
@@ -148,3 +148,75 @@ BOOST_AUTO_TEST_CASE( test_nccsum_some_corr )
        BOOST_CHECK_SMALL(vgh.second.get_gradient_scale(src_data[2], ref_data[2]), 1e-5f);
        BOOST_CHECK_SMALL(vgh.second.get_gradient_scale(src_data[3], ref_data[3]), 1e-5f);
 }
+
+/*
+  Compare the window sums of CNCCSlidingWindow with the sums obtained by visiting all
+  pixels of each window, for jumps to a slice as well as for moving slice by slice.
+  The brute force evaluation of the helper must give the same results.
+*/
+static void run_sliding_window_test(bool use_mask, bool brute_force)
+{
+       const size_t nx = 9;
+       const size_t ny = 7;
+       const size_t nz = 8;
+       const int hw = 2;
+       std::vector<double> a(nx * ny * nz);
+       std::vector<double> b(nx * ny * nz);
+       std::vector<unsigned char> mask(nx * ny * nz);
+
+       for (size_t i = 0; i < a.size(); ++i) {
+              a[i] = 100.0 + (i * 37) % 17;
+              b[i] = 50.0 + (i * 13) % 11 + 0.25 * a[i];
+              mask[i] = (i * 7) % 5 != 0;
+       }
+
+       CNCCSlidingWindow window(&a[0], &b[0], use_mask ? &mask[0] : nullptr, nx, ny, nz, hw, brute_force);
+       const size_t slices[] = {3, 0, 1, 2, 3, 4, 5, 6, 7, 5};
+
+       for (auto z : slices) {
+              window.set_slice(z);
+
+              for (size_t y = 0; y < ny; ++y)
+                     for (size_t x = 0; x < nx; ++x) {
+                            NCCSums expect;
+                            double count = 0;
+
+                            for (size_t iz = z > hw ? z - hw : 0; iz < std::min(nz, z + hw + 1); ++iz)
+                                   for (size_t iy = y > hw ? y - hw : 0; iy < std::min(ny, y + hw + 1); ++iy)
+                                          for (size_t ix = x > hw ? x - hw : 0; ix < std::min(nx, x + hw + 1); ++ix) {
+                                                 const size_t k = ix + nx * (iy + ny * iz);
+
+                                                 if (!use_mask || mask[k]) {
+                                                        expect.add(a[k], b[k]);
+                                                        count += 1;
+                                                 }
+                                          }
+
+                            const size_t i = x + nx * y;
+                            BOOST_CHECK_EQUAL(window.get_count(i), count);
+                            BOOST_CHECK_CLOSE(window[i].value(), expect.value(), 1e-6);
+                            auto vgh = window[i].get_grad_helper();
+                            auto egh = expect.get_grad_helper();
+                            const size_t k = i + nx * ny * z;
+                            BOOST_CHECK_CLOSE(vgh.second.get_gradient_scale(a[k] - window.get_offset_a(),
+                                              b[k] - window.get_offset_b()),
+                                              egh.second.get_gradient_scale(a[k], b[k]), 1e-4);
+                     }
+       }
+}
+
+BOOST_AUTO_TEST_CASE( test_ncc_sliding_window )
+{
+       run_sliding_window_test(false, false);
+}
+
+BOOST_AUTO_TEST_CASE( test_ncc_sliding_window_masked )
+{
+       run_sliding_window_test(true, false);
+}
+
+BOOST_AUTO_TEST_CASE( test_ncc_sliding_window_brute_force )
+{
+       run_sliding_window_test(false, true);
+       run_sliding_window_test(true, true);
+}
@@ -18,8 +18,9 @@
  *
  */
 
-#include <mia/core/parallelcxx11.hh>
+#include <mia/core/parallel.hh>
 #include <mia/internal/autotest.hh>
+#include <numeric>
 using namespace mia;
 using namespace std;
 
@@ -98,3 +99,110 @@ BOOST_AUTO_TEST_CASE (test_pfor)
               BOOST_CHECK_EQUAL(input[i], 2 * i);
        }
 }
+
+BOOST_AUTO_TEST_CASE (test_pfor_default_blocksize)
+{
+       // like the TBB grain size the default block size is one
+       C1DParallelRange range(0, 10);
+       BOOST_CHECK_EQUAL(range.prepare_workpackages(4), 10);
+       auto wp = range.get_next_workpackage();
+       BOOST_CHECK_EQUAL(wp.begin(), 0);
+       BOOST_CHECK_EQUAL(wp.end(), 1);
+}
+
+BOOST_AUTO_TEST_CASE (test_pfor_automatic_blocksize)
+{
+       C1DParallelRange range(0, 1000, 0);
+       vector<int> input(1000, 1);
+       auto p_func = [&input](const C1DParallelRange & range) {
+              for (auto i = range.begin(); i != range.end(); ++i) {
+                     input[i] += i;
+              }
+       };
+       pfor(range, p_func);
+
+       for (int i = 0; i < 1000; ++i) {
+              BOOST_CHECK_EQUAL(input[i], i + 1);
+       }
+}
+
+BOOST_AUTO_TEST_CASE (test_preduce_nested)
+{
+       auto p_func = [](const C1DParallelRange & range, int in_value) {
+              for (auto i = range.begin(); i != range.end(); ++i) {
+                     auto inner = [i](const C1DParallelRange & r, int v) {
+                            for (auto k = r.begin(); k != r.end(); ++k)
+                                   v += i * k;
+
+                            return v;
+                     };
+                     in_value += preduce(C1DParallelRange(0, 100, 7), 0, inner,
+                     [](int a, int b) {
+                            return a + b;
+                     });
+              }
+
+              return in_value;
+       };
+       auto r_func = [](int a, int b) {
+              return a + b;
+       };
+       int result = preduce(C1DParallelRange(0, 50, 1), 0, p_func, r_func);
+       BOOST_CHECK_EQUAL(result, 25 * 49 * 50 * 99);
+}
+
+BOOST_AUTO_TEST_CASE (test_pfor_single_task)
+{
+       int old_max_tasks = CMaxTasks::get_max_tasks();
+       CMaxTasks::set_max_tasks(1);
+       vector<int> input(100, 0);
+       auto p_func = [&input](const C1DParallelRange & range) {
+              for (auto i = range.begin(); i != range.end(); ++i) {
+                     input[i] = i;
+              }
+       };
+       pfor(C1DParallelRange(0, 100, 3), p_func);
+       CMaxTasks::set_max_tasks(old_max_tasks);
+
+       for (int i = 0; i < 100; ++i) {
+              BOOST_CHECK_EQUAL(input[i], i);
+       }
+}
+
+BOOST_AUTO_TEST_CASE (test_pfor_exception)
+{
+       int old_max_tasks = CMaxTasks::get_max_tasks();
+       CMaxTasks::set_max_tasks(4);
+       auto p_func = [](const C1DParallelRange & range) {
+              for (auto i = range.begin(); i != range.end(); ++i) {
+                     if (i == 17)
+                            throw std::runtime_error("test");
+              }
+       };
+       BOOST_CHECK_THROW(pfor(C1DParallelRange(0, 100, 1), p_func), std::runtime_error);
+       CMaxTasks::set_max_tasks(old_max_tasks);
+}
+
+BOOST_AUTO_TEST_CASE (test_preduce_ordered_thread_independent)
+{
+       vector<float> input(10000);
+
+       for (size_t i = 0; i < input.size(); ++i)
+              input[i] = 1.0f / (1 + i % 97);
+
+       auto sum_block = [&input](const C1DParallelRange & range, float sum) {
+              for (auto i = range.begin(); i != range.end(); ++i)
+                     sum += input[i];
+
+              return sum;
+       };
+       int old_max_tasks = CMaxTasks::get_max_tasks();
+       CMaxTasks::set_max_tasks(1);
+       float serial = preduce_ordered(0, 10000, 64, 0.0f, sum_block, plus<float>());
+       CMaxTasks::set_max_tasks(4);
+       float parallel = preduce_ordered(0, 10000, 64, 0.0f, sum_block, plus<float>());
+       CMaxTasks::set_max_tasks(old_max_tasks);
+       BOOST_CHECK_EQUAL(serial, parallel);
+       BOOST_CHECK_CLOSE(serial, accumulate(input.begin(), input.end(), 0.0f), 0.01);
+       BOOST_CHECK_EQUAL(preduce_ordered(5, 5, 64, 0.0f, sum_block, plus<float>()), 0.0f);
+}
@@ -0,0 +1,168 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <mia/internal/autotest.hh>
+#include <mia/core/plugincache.hh>
+#include <mia/core/testplugin.hh>
+
+#include <cstdlib>
+#include <fstream>
+#include <boost/filesystem.hpp>
+
+NS_MIA_USE
+using namespace std;
+namespace bfs = ::boost::filesystem;
+
+struct PluginCacheFixture {
+       PluginCacheFixture();
+       ~PluginCacheFixture();
+
+       void create_module(const string& name, const string& content);
+
+       bfs::path dir;
+       vector<string> modules;
+       CPluginCache::CModuleMap plugins;
+};
+
+PluginCacheFixture::PluginCacheFixture():
+       dir(bfs::temp_directory_path() / bfs::unique_path("mia-plugincache-%%%%-%%%%"))
+{
+       bfs::create_directories(dir);
+       create_module("a.mia", "module a");
+       create_module("b.mia", "module b");
+       plugins["alpha"] = modules[0];
+       plugins["beta"] = modules[1];
+       plugins["gamma"] = modules[1];
+}
+
+PluginCacheFixture::~PluginCacheFixture()
+{
+       bfs::remove_all(dir);
+}
+
+void PluginCacheFixture::create_module(const string& name, const string& content)
+{
+       auto path = (dir / name).string();
+       ofstream os(path.c_str());
+       os << content;
+       modules.push_back(path);
+}
+
+BOOST_FIXTURE_TEST_CASE( test_cache_write_read, PluginCacheFixture )
+{
+       const string cache_file = (dir / "sub" / "index.cache").string();
+       CPluginCache cache(cache_file, modules);
+       CPluginCache::CModuleMap read_plugins;
+       BOOST_CHECK(!cache.read(read_plugins));
+       BOOST_REQUIRE(cache.write(plugins));
+       BOOST_REQUIRE(cache.read(read_plugins));
+       BOOST_CHECK(read_plugins == plugins);
+       // the module order as provided by the directory scan doesn't matter
+       vector<string> reversed(modules.rbegin(), modules.rend());
+       CPluginCache cache2(cache_file, reversed);
+       BOOST_REQUIRE(cache2.read(read_plugins));
+       BOOST_CHECK(read_plugins == plugins);
+}
+
+BOOST_FIXTURE_TEST_CASE( test_cache_invalidated_by_module_change, PluginCacheFixture )
+{
+       const string cache_file = (dir / "index.cache").string();
+       CPluginCache(cache_file, modules).write(plugins);
+       {
+              ofstream os(modules[1].c_str(), ios::app);
+              os << " was rebuilt";
+       }
+       CPluginCache::CModuleMap read_plugins;
+       BOOST_CHECK(!CPluginCache(cache_file, modules).read(read_plugins));
+       BOOST_CHECK(read_plugins.empty());
+}
+
+BOOST_FIXTURE_TEST_CASE( test_cache_invalidated_by_new_module, PluginCacheFixture )
+{
+       const string cache_file = (dir / "index.cache").string();
+       CPluginCache(cache_file, modules).write(plugins);
+       create_module("c.mia", "module c");
+       CPluginCache::CModuleMap read_plugins;
+       BOOST_CHECK(!CPluginCache(cache_file, modules).read(read_plugins));
+}
+
+BOOST_FIXTURE_TEST_CASE( test_cache_disabled, PluginCacheFixture )
+{
+       setenv("MIA_PLUGIN_CACHE", "none", 1);
+       CPluginCache cache("test", "cache", modules);
+       BOOST_CHECK(cache.get_filename().empty());
+       BOOST_CHECK(!cache.write(plugins));
+       unsetenv("MIA_PLUGIN_CACHE");
+}
+
+BOOST_FIXTURE_TEST_CASE( test_cache_is_opt_in, PluginCacheFixture )
+{
+       unsetenv("MIA_PLUGIN_CACHE");
+       CPluginCache cache("test", "cache", modules);
+       BOOST_CHECK(cache.get_filename().empty());
+       const string cache_home = (dir / "xdg").string();
+       setenv("XDG_CACHE_HOME", cache_home.c_str(), 1);
+       setenv("MIA_PLUGIN_CACHE", "default", 1);
+       CPluginCache default_cache("test", "cache", modules);
+       unsetenv("MIA_PLUGIN_CACHE");
+       unsetenv("XDG_CACHE_HOME");
+       BOOST_CHECK_EQUAL(bfs::path(default_cache.get_filename()).parent_path().string(),
+                         (dir / "xdg" / "mia").string());
+       BOOST_CHECK(default_cache.write(plugins));
+       BOOST_CHECK(bfs::exists(default_cache.get_filename()));
+}
+
+class CLazyTestPluginHandler: public TPluginHandler<CTestPlugin>
+{
+public:
+       CLazyTestPluginHandler(const CPluginSearchpath& sp)
+       {
+              initialise(sp);
+       }
+       CTestPlugin *get_plugin(const char *name) const
+       {
+              return plugin(name);
+       }
+};
+
+/*
+  Runs the plug-in handler initialization once without and once with the cache,
+  the handler with the cache must provide the same plug-ins, loading their modules
+  on request. The start-up times are measured in mia-benchmarks.
+*/
+BOOST_FIXTURE_TEST_CASE( test_handler_startup_with_cache, PluginCacheFixture )
+{
+       setenv("MIA_PLUGIN_CACHE", dir.string().c_str(), 1);
+       CPluginSearchpath sp(true);
+       sp.add("testplug");
+       CLazyTestPluginHandler scan_handler(sp);
+       auto scan_names = scan_handler.get_plugin_names();
+       CLazyTestPluginHandler cached_handler(sp);
+       auto cached_names = cached_handler.get_plugin_names();
+       unsetenv("MIA_PLUGIN_CACHE");
+       BOOST_CHECK_EQUAL(scan_names, "dummy1 dummy2 dummy3 ");
+       BOOST_CHECK_EQUAL(cached_names, scan_names);
+       auto dummy3 = cached_handler.get_plugin("dummy3");
+       BOOST_REQUIRE(dummy3);
+       BOOST_CHECK(dummy3->has_property(test_property));
+       BOOST_CHECK(cached_handler.get_plugin("dummy2"));
+       BOOST_CHECK(!cached_handler.get_plugin("dummy4"));
+       BOOST_CHECK_EQUAL(cached_handler.size(), 3u);
+}
@@ -0,0 +1,107 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <sstream>
+#include <mia/internal/autotest.hh>
+#include <mia/core/profiling.hh>
+
+using namespace mia;
+using std::string;
+using std::ostringstream;
+
+struct ProfilerFixture {
+       ProfilerFixture()
+       {
+              CProfiler::instance().clear();
+       }
+
+       ~ProfilerFixture()
+       {
+              CProfiler::instance().disable();
+              CProfiler::instance().clear();
+       }
+};
+
+class CProfileTestProduct: public CProductBase
+{
+};
+
+BOOST_FIXTURE_TEST_CASE( test_profiler_disabled, ProfilerFixture )
+{
+       BOOST_CHECK(!CProfiler::is_enabled());
+       {
+              CProfileScope scope("test", "disabled");
+       }
+       BOOST_CHECK_EQUAL(CProfiler::instance().get_calls("test", "disabled"), 0u);
+}
+
+BOOST_FIXTURE_TEST_CASE( test_profiler_summary, ProfilerFixture )
+{
+       auto& profiler = CProfiler::instance();
+       profiler.enable();
+       BOOST_CHECK(CProfiler::is_enabled());
+       CProfileTestProduct product;
+       product.set_init_string("test:a=\"1\"");
+
+       for (int i = 0; i < 3; ++i) {
+              CProfileScope scope("test", product);
+       }
+
+       {
+              CProfileScope scope("test", "named");
+       }
+
+       profiler.add_count("hits", 2);
+       profiler.add_count("hits", 3);
+       BOOST_CHECK_EQUAL(profiler.get_calls("test", "test:a=\"1\""), 3u);
+       BOOST_CHECK_EQUAL(profiler.get_calls("test", "named"), 1u);
+       BOOST_CHECK_EQUAL(profiler.get_calls("other", "named"), 0u);
+       BOOST_CHECK_EQUAL(profiler.get_count("hits"), 5);
+       ostringstream os;
+       profiler.write(os, CProfiler::pf_summary);
+       const string summary = os.str();
+       BOOST_CHECK(summary.find("\"name\": \"test:a=\\\"1\\\"\", \"calls\": 3") != string::npos);
+       BOOST_CHECK(summary.find("\"category\": \"test\", \"name\": \"named\", \"calls\": 1") != string::npos);
+       BOOST_CHECK(summary.find("\"hits\": 5") != string::npos);
+}
+
+BOOST_FIXTURE_TEST_CASE( test_profiler_trace, ProfilerFixture )
+{
+       auto& profiler = CProfiler::instance();
+       profiler.enable("", CProfiler::pf_trace);
+       {
+              CProfileScope outer("test", "outer");
+              CProfileScope inner("test", "inner");
+       }
+       ostringstream os;
+       profiler.write(os, CProfiler::pf_trace);
+       const string trace = os.str();
+       BOOST_CHECK(trace.find("{\"traceEvents\": [") == 0);
+       BOOST_CHECK(trace.find("{\"name\": \"inner\", \"cat\": \"test\", \"ph\": \"X\"") != string::npos);
+       BOOST_CHECK(trace.find("{\"name\": \"outer\", \"cat\": \"test\", \"ph\": \"X\"") != string::npos);
+       // the inner scope is closed first
+       BOOST_CHECK(trace.find("\"inner\"") < trace.find("\"outer\""));
+}
+
+BOOST_AUTO_TEST_CASE( test_profile_format_dict )
+{
+       BOOST_CHECK_EQUAL(g_profile_format_dict.get_value("summary"), CProfiler::pf_summary);
+       BOOST_CHECK_EQUAL(g_profile_format_dict.get_value("trace"), CProfiler::pf_trace);
+}
@@ -28,6 +28,7 @@
 #include <mia/core/mitestimages.hh>
 #include <mia/core/splineparzenmi.hh>
 #include <boost/filesystem.hpp>
+#include <list>
 
 NS_MIA_USE;
 using namespace std;
@@ -118,6 +119,67 @@ BOOST_FIXTURE_TEST_CASE( test_different_image_gradient, SplineMutualInformationF
        BOOST_CHECK(cnt > 0);
        cvdebug() << "nozero gradient values =" << cnt << "\n";
 }
+BOOST_FIXTURE_TEST_CASE( test_parallel_fill_equals_serial_fill, SplineMutualInformationFixture )
+{
+       // std::list iterators are not random access and force the serial code path
+       list<double> lmoving(moving.begin(), moving.end());
+       list<double> lreference(reference.begin(), reference.end());
+       CSplineParzenMI smi_parallel(bins, rkernel, bins, mkernel, 0);
+       CSplineParzenMI smi_serial(bins, rkernel, bins, mkernel, 0);
+       smi_parallel.fill(moving.begin(), moving.end(), reference.begin(), reference.end());
+       smi_serial.fill(lmoving.begin(), lmoving.end(), lreference.begin(), lreference.end());
+       BOOST_CHECK_CLOSE(smi_parallel.value(), smi_serial.value(), 1e-8);
+}
+
+BOOST_FIXTURE_TEST_CASE( test_masked_fill_forward_reference_iterator, SplineMutualInformationFixture )
+{
+       // a reference range that is not random access must use the serial code path
+       list<double> lreference(reference.begin(), reference.end());
+       vector<bool> mask(moving.size());
+
+       for (size_t i = 0; i < mask.size(); ++i)
+              mask[i] = (i % 3) != 0;
+
+       CSplineParzenMI smi_parallel(bins, rkernel, bins, mkernel, 0);
+       CSplineParzenMI smi_serial(bins, rkernel, bins, mkernel, 0);
+       smi_parallel.fill(moving.begin(), moving.end(), reference.begin(), reference.end(),
+                         mask.begin(), mask.end());
+       smi_serial.fill(moving.begin(), moving.end(), lreference.begin(), lreference.end(),
+                       mask.begin(), mask.end());
+       BOOST_CHECK_CLOSE(smi_parallel.value(), smi_serial.value(), 1e-8);
+}
+
+BOOST_FIXTURE_TEST_CASE( test_get_gradients_equals_gradient_slow, SplineMutualInformationFixture )
+{
+       CSplineParzenMI smi(bins, rkernel, bins, mkernel, 0);
+       smi.fill(moving.begin(), moving.end(), reference.begin(), reference.end());
+       vector<double> gradient(moving.size());
+       smi.get_gradients(moving.begin(), moving.end(), reference.begin(), gradient.begin());
+
+       for (size_t i = 0; i < moving.size(); ++i)
+              BOOST_CHECK_EQUAL(gradient[i], smi.get_gradient_slow(moving[i], reference[i]));
+}
+
+BOOST_FIXTURE_TEST_CASE( test_get_gradients_masked, SplineMutualInformationFixture )
+{
+       CSplineParzenMI smi(bins, rkernel, bins, mkernel, 0);
+       smi.fill(moving.begin(), moving.end(), reference.begin(), reference.end());
+       vector<bool> mask(moving.size());
+
+       for (size_t i = 0; i < mask.size(); ++i)
+              mask[i] = i & 1;
+
+       vector<double> gradient(moving.size(), 1000.0);
+       smi.get_gradients(moving.begin(), moving.end(), reference.begin(), mask.begin(), gradient.begin());
+
+       for (size_t i = 0; i < moving.size(); ++i) {
+              if (mask[i])
+                     BOOST_CHECK_EQUAL(gradient[i], smi.get_gradient_slow(moving[i], reference[i]));
+              else
+                     BOOST_CHECK_EQUAL(gradient[i], 1000.0);
+       }
+}
+
 SplineMutualInformationFixture::SplineMutualInformationFixture():
        size(mi_test_size.width * mi_test_size.height),
        reference(reference_init_data, reference_init_data + size),
@@ -0,0 +1,123 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <mia/internal/autotest.hh>
+#include <mia/core/voxelsampler.hh>
+
+using namespace mia;
+using std::vector;
+
+BOOST_AUTO_TEST_CASE( test_voxelsampler_none )
+{
+       CVoxelSampler sampler(CVoxelSampler::vs_none, 0.1, 1);
+       vector<size_t> indices;
+       sampler.draw(vector<size_t> {3, 4, 5}, indices);
+       BOOST_REQUIRE_EQUAL(indices.size(), 60u);
+
+       for (size_t i = 0; i < indices.size(); ++i)
+              BOOST_CHECK_EQUAL(indices[i], i);
+}
+
+BOOST_AUTO_TEST_CASE( test_voxelsampler_random )
+{
+       const vector<size_t> size = {20, 10, 5};
+       CVoxelSampler sampler(CVoxelSampler::vs_random, 0.1, 7);
+       vector<size_t> indices;
+       sampler.draw(size, indices);
+       BOOST_REQUIRE_EQUAL(indices.size(), 100u);
+       BOOST_CHECK(std::is_sorted(indices.begin(), indices.end()));
+       BOOST_CHECK(indices.back() < 1000u);
+       // the sets are resampled with each call
+       vector<size_t> indices2;
+       sampler.draw(size, indices2);
+       BOOST_CHECK(indices != indices2);
+       // the sequence only depends on the seed
+       CVoxelSampler sampler2(CVoxelSampler::vs_random, 0.1, 7);
+       vector<size_t> indices3;
+       sampler2.draw(size, indices3);
+       BOOST_CHECK(indices == indices3);
+}
+
+BOOST_AUTO_TEST_CASE( test_voxelsampler_stratified )
+{
+       // 15 voxels are requested, the closest grid has 4x2x2 cells, whose boundaries are
+       // x = {0, 1, 2, 3, 5}, y = {0, 2, 4}, and z = {0, 3, 6}
+       const vector<size_t> size = {5, 4, 6};
+       CVoxelSampler sampler(CVoxelSampler::vs_stratified, 0.125, 3);
+       vector<size_t> indices;
+       sampler.draw(size, indices);
+       BOOST_REQUIRE_EQUAL(indices.size(), 4u * 2u * 2u);
+       BOOST_CHECK(std::is_sorted(indices.begin(), indices.end()));
+       vector<int> hits(16, 0);
+
+       for (auto i : indices) {
+              const size_t x = i % 5;
+              const size_t y = (i / 5) % 4;
+              const size_t z = i / 20;
+              BOOST_REQUIRE(z < 6);
+              const size_t cx = std::min<size_t>(x, 3);
+              ++hits[cx + 4 * (y / 2 + 2 * (z / 3))];
+       }
+
+       for (auto h : hits)
+              BOOST_CHECK_EQUAL(h, 1);
+}
+
+/*
+  The number of drawn voxels must follow the requested fraction also if it is not
+  the inverse of a cube number, and all cells must be about the same size.
+*/
+BOOST_AUTO_TEST_CASE( test_voxelsampler_stratified_fraction )
+{
+       for (double fraction : {0.1, 0.05, 0.3}) {
+              const vector<size_t> size = {64, 64, 64};
+              CVoxelSampler sampler(CVoxelSampler::vs_stratified, fraction, 5);
+              vector<size_t> indices;
+              sampler.draw(size, indices);
+              BOOST_CHECK_CLOSE(double(indices.size()), fraction * 64 * 64 * 64, 1.0);
+              // no voxel is drawn twice
+              BOOST_CHECK(std::adjacent_find(indices.begin(), indices.end()) == indices.end());
+       }
+
+       // one sample per slice of a 1D image
+       CVoxelSampler sampler(CVoxelSampler::vs_stratified, 0.1, 5);
+       vector<size_t> indices;
+       sampler.draw(vector<size_t> {95}, indices);
+       BOOST_REQUIRE_EQUAL(indices.size(), 10u);
+
+       for (size_t i = 0; i < indices.size(); ++i) {
+              BOOST_CHECK(indices[i] >= i * 95 / 10);
+              BOOST_CHECK(indices[i] < (i + 1) * 95 / 10);
+       }
+}
+
+BOOST_AUTO_TEST_CASE( test_voxelsampler_invalid_fraction )
+{
+       BOOST_CHECK_THROW(CVoxelSampler(CVoxelSampler::vs_random, 0.0, 1), std::invalid_argument);
+       BOOST_CHECK_THROW(CVoxelSampler(CVoxelSampler::vs_random, 1.5, 1), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE( test_voxelsampler_dict )
+{
+       BOOST_CHECK_EQUAL(g_voxel_sampling_dict.get_value("stratified"), CVoxelSampler::vs_stratified);
+       BOOST_CHECK_EQUAL(g_voxel_sampling_dict.get_value("random"), CVoxelSampler::vs_random);
+       BOOST_CHECK_EQUAL(g_voxel_sampling_dict.get_value("none"), CVoxelSampler::vs_none);
+}
@@ -96,7 +96,6 @@ public:
 
        /// \returns true if the transformation provides a penalty term
        bool has_energy_penalty() const;
-protected:
 
        /// \returns the interpolator factory
        const I& get_interpolator_factory() const;
@@ -0,0 +1,180 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+
+#include <mia/core/voxelsampler.hh>
+#include <mia/core/errormacro.hh>
+
+NS_MIA_BEGIN
+
+using std::vector;
+using std::invalid_argument;
+
+const TDictMap<CVoxelSampler::EStrategy>::Table voxel_sampling_table[] = {
+       {"none", CVoxelSampler::vs_none, "use all voxels"},
+       {"random", CVoxelSampler::vs_random, "draw the voxels uniformly at random"},
+       {"stratified", CVoxelSampler::vs_stratified, "draw one voxel at random from each cell of a regular grid"},
+       {NULL, CVoxelSampler::vs_unknown, ""}
+};
+
+const TDictMap<CVoxelSampler::EStrategy> g_voxel_sampling_dict(voxel_sampling_table);
+
+CVoxelSampler::CVoxelSampler(EStrategy strategy, double fraction, unsigned seed):
+       m_strategy(strategy),
+       m_fraction(fraction),
+       m_generator(seed)
+{
+       if (!(fraction > 0.0 && fraction <= 1.0))
+              throw create_exception<invalid_argument>("CVoxelSampler: the fraction of sampled voxels must be in (0,1], got ",
+                            fraction);
+
+       if (strategy == vs_unknown)
+              throw invalid_argument("CVoxelSampler: unknown sampling strategy");
+}
+
+void CVoxelSampler::draw(const vector<size_t>& size, vector<size_t>& indices)
+{
+       const size_t n_voxels = std::accumulate(size.begin(), size.end(), size_t(1),
+                                               std::multiplies<size_t>());
+
+       if (m_strategy == vs_none || m_fraction == 1.0) {
+              indices.resize(n_voxels);
+              std::iota(indices.begin(), indices.end(), 0);
+              return;
+       }
+
+       if (m_strategy == vs_random)
+              draw_random(n_voxels, indices);
+       else
+              draw_stratified(size, indices);
+
+       // visit the image data in memory order
+       std::sort(indices.begin(), indices.end());
+}
+
+void CVoxelSampler::draw_random(size_t n_voxels, vector<size_t>& indices)
+{
+       const size_t n = std::max(size_t(1), static_cast<size_t>(std::llround(m_fraction * n_voxels)));
+       std::uniform_int_distribution<size_t> voxel(0, n_voxels - 1);
+       indices.resize(n);
+
+       for (auto& i : indices)
+              i = voxel(m_generator);
+}
+
+void CVoxelSampler::draw_stratified(const vector<size_t>& size, vector<size_t>& indices)
+{
+       const size_t dim = size.size();
+       const size_t n_voxels = std::accumulate(size.begin(), size.end(), size_t(1),
+                                               std::multiplies<size_t>());
+       const double target = std::max(1.0, m_fraction * n_voxels);
+
+       // start with the same number of cells per voxel along all axes
+       const double cells_per_voxel = std::pow(m_fraction, 1.0 / dim);
+       vector<size_t> n_cells(dim);
+
+       for (size_t d = 0; d < dim; ++d)
+              n_cells[d] = std::min(size[d], std::max(size_t(1),
+                                    static_cast<size_t>(std::lround(size[d] * cells_per_voxel))));
+
+       // correct the rounding errors so that the number of cells matches the requested
+       // fraction as close as possible, either by adding or removing a cell along one axis
+       // or by moving a cell from one axis to another one
+       auto product = [](const vector<size_t>& n) {
+              return std::accumulate(n.begin(), n.end(), size_t(1), std::multiplies<size_t>());
+       };
+       size_t total_cells = product(n_cells);
+       bool improved = true;
+
+       while (improved) {
+              improved = false;
+
+              for (size_t d = 0; d < dim; ++d) {
+                     for (size_t e = 0; e < dim; ++e) {
+                            for (int delta : {-1, 1}) {
+                                   if (d != e && delta < 0)
+                                          continue;
+
+                                   vector<size_t> candidate(n_cells);
+                                   candidate[d] += delta;
+
+                                   if (d != e)
+                                          --candidate[e];
+
+                                   if (candidate[d] < 1 || candidate[d] > size[d] || candidate[e] < 1)
+                                          continue;
+
+                                   const size_t cells = product(candidate);
+
+                                   if (std::fabs(cells - target) < std::fabs(total_cells - target)) {
+                                          n_cells.swap(candidate);
+                                          total_cells = cells;
+                                          improved = true;
+                                   }
+                            }
+                     }
+              }
+       }
+
+       // the cell boundaries are spread evenly over each axis, so that the extents of
+       // the cells differ by at most one voxel and each drawn voxel stands for about
+       // the same number of voxels
+       vector<size_t> stride(dim);
+       size_t s = 1;
+
+       for (size_t d = 0; d < dim; ++d) {
+              stride[d] = s;
+              s *= size[d];
+       }
+
+       indices.resize(total_cells);
+       vector<size_t> cell(dim, 0);
+
+       for (auto& i : indices) {
+              i = 0;
+
+              for (size_t d = 0; d < dim; ++d) {
+                     const size_t start = cell[d] * size[d] / n_cells[d];
+                     const size_t end = (cell[d] + 1) * size[d] / n_cells[d];
+                     std::uniform_int_distribution<size_t> offset(start, end - 1);
+                     i += offset(m_generator) * stride[d];
+              }
+
+              // next cell
+              for (size_t d = 0; d < dim && ++cell[d] == n_cells[d]; ++d)
+                     cell[d] = 0;
+       }
+}
+
+CVoxelSampler::EStrategy CVoxelSampler::get_strategy() const
+{
+       return m_strategy;
+}
+
+double CVoxelSampler::get_fraction() const
+{
+       return m_fraction;
+}
+
+NS_MIA_END
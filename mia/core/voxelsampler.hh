@@ -0,0 +1,89 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef mia_core_voxelsampler_hh
+#define mia_core_voxelsampler_hh
+
+#include <random>
+#include <vector>
+#include <mia/core/defines.hh>
+#include <mia/core/dictmap.hh>
+
+NS_MIA_BEGIN
+
+/**
+   \ingroup registration
+
+   \brief Draws sub-sets of the voxels of an image for the stochastic cost function evaluation
+
+   Instead of evaluating a cost function over all voxels of an image, it can be estimated
+   from a sub-set of the voxels that is drawn a new for each iteration of the optimization.
+   The sampler is dimension independent, it works on the linear indices of the voxels of
+   an image of the given size.
+ */
+class EXPORT_CORE CVoxelSampler
+{
+public:
+       /// the available sampling strategies
+       enum EStrategy {
+              vs_none,       /**< use all voxels */
+              vs_random,     /**< draw the voxels uniformly at random (with replacement) */
+              vs_stratified, /**< draw one voxel at random from each cell of a grid whose cell count
+                                matches the requested fraction */
+              vs_unknown
+       };
+
+       /**
+          Create the sampler
+          \param strategy the sampling strategy
+          \param fraction the fraction of the voxels that should be drawn, in (0,1]
+          \param seed seed of the random number generator, the sequence of the drawn sets
+          only depends on this seed
+        */
+       CVoxelSampler(EStrategy strategy, double fraction, unsigned seed);
+
+       /**
+          Draw a new set of voxels
+          \param size the size of the image, i.e. the number of voxels along each axis,
+          starting with the fastest varying index
+          \param[out] indices the linear indices of the drawn voxels in ascending order
+        */
+       void draw(const std::vector<size_t>& size, std::vector<size_t>& indices);
+
+       /// \returns the sampling strategy
+       EStrategy get_strategy() const;
+
+       /// \returns the requested fraction of voxels
+       double get_fraction() const;
+private:
+       void draw_random(size_t n_voxels, std::vector<size_t>& indices);
+       void draw_stratified(const std::vector<size_t>& size, std::vector<size_t>& indices);
+
+       EStrategy m_strategy;
+       double m_fraction;
+       std::mt19937 m_generator;
+};
+
+/// dictionary for the voxel sampling strategies
+extern EXPORT_CORE const TDictMap<CVoxelSampler::EStrategy> g_voxel_sampling_dict;
+
+NS_MIA_END
+
+#endif
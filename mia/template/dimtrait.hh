@@ -64,6 +64,25 @@ struct watershed_traits {
        typedef dimension_traits_placeholder Handler;
        typedef dimension_traits_placeholder FileHandler;
 };
+
+/**
+   Translate a flat index into the position within a grid of the given size,
+   the first dimension runs fastest.
+   \tparam dim number of dimensions
+   \tparam Position the grid position type
+*/
+template <int dim, typename Position>
+Position flat_index_to_position(size_t index, const Position& size)
+{
+       Position pos;
+
+       for (int d = 0; d < dim; ++d) {
+              pos[d] = index % size[d];
+              index /= size[d];
+       }
+
+       return pos;
+}
 /// @endcond
 
 NS_MIA_END
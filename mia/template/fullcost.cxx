@@ -37,6 +37,7 @@ template <typename T>
 double TFullCost<T>::evaluate(const T& t, CDoubleVector& gradient) const
 {
 	assert(m_current_size == t.get_size()); 
+	MIA_PROFILE_SCOPE("fullcost", *this); 
 	
 	double result = m_weight * do_evaluate(t, gradient); 
 	std::transform(gradient.begin(), gradient.end(), gradient.begin(), 
@@ -47,16 +48,33 @@ double TFullCost<T>::evaluate(const T& t, CDoubleVector& gradient) const
 template <typename T> 
 double TFullCost<T>::cost_value(const T& t) const 
 {
+	MIA_PROFILE_SCOPE("fullcost", *this); 
 	return m_weight * do_value(t); 
 }
 
 template <typename T> 
 double TFullCost<T>::cost_value() const 
 {
+	MIA_PROFILE_SCOPE("fullcost", *this); 
 	return m_weight * do_value(); 
 }
 	
 
+template <typename T> 
+void TFullCost<T>::set_deformed_data_store(typename TDeformedDataStore<T>::Pointer store)
+{
+	m_deformed_store = store; 
+}
+
+template <typename T> 
+typename TDeformedDataStore<T>::PData
+TFullCost<T>::transform_data(const std::string& key, const T& t, const typename T::Data& src) const
+{
+	if (m_deformed_store && !key.empty())
+		return m_deformed_store->get(key, t, src); 
+	return t(src); 
+}
+
 template <typename T> 
 double TFullCost<T>::get_weight() const
 {
@@ -99,6 +117,34 @@ void TFullCost<T>::do_reinit()
 {
 }
 
+template <typename T> 
+typename TDeformedDataStore<T>::PData
+TDeformedDataStore<T>::get(const std::string& key, const T& t, const Data& src)
+{
+	CScopedLock lock(m_mutex); 
+	auto i = m_data.find(key); 
+	if (i != m_data.end()) 
+		return i->second; 
+	
+	auto result = t(src); 
+	m_data[key] = result; 
+	return result; 
+}
+
+template <typename T> 
+void TDeformedDataStore<T>::clear()
+{
+	CScopedLock lock(m_mutex); 
+	m_data.clear(); 
+}
+
+template <typename T> 
+size_t TDeformedDataStore<T>::size() const
+{
+	CScopedLock lock(m_mutex); 
+	return m_data.size(); 
+}
+
 template <typename T> 
 TFullCostPlugin<T>::TFullCostPlugin(const char *name):
 	TFactory<TFullCost<T> >(name), 
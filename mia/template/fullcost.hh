@@ -24,9 +24,58 @@
 #include <mia/core/product_base.hh>
 #include <mia/core/vector.hh>
 #include <mia/core/import_handler.hh>
+#include <mia/core/parallel.hh>
+
+#include <map>
+#include <string>
 
 NS_MIA_BEGIN
 
+/**
+   \ingroup registration
+
+   \tparam Transform the transformation type used to achieve registration by optimizing the cost function
+
+   \brief Store for input data that is deformed by the current transformation
+
+   When several cost functions use the same moving input, it suffices to deform this
+   input once per evaluation. The cost functions identify their input by a key, e.g. the
+   data pool key of the image, and the owner of the store (usually TFullCostList) must
+   clear it whenever the transformation changes.
+*/
+template <typename Transform>
+class EXPORT_HANDLER TDeformedDataStore
+{
+public:
+       /// the data type that is deformed by the transformation
+       typedef typename Transform::Data Data;
+
+       /// the pointer type of the deformed data
+       typedef std::shared_ptr<Data> PData;
+
+       /// the pointer type of the store
+       typedef std::shared_ptr<TDeformedDataStore<Transform>> Pointer;
+
+       /**
+          Get the deformed input, the transformation is only applied if no data is
+          stored for the given key.
+          \param key identifier of the input data
+          \param t the current transformation
+          \param src the input data
+          \returns the deformed input
+        */
+       PData get(const std::string& key, const Transform& t, const Data& src);
+
+       /// remove all stored data
+       void clear();
+
+       /// \returns number of stored deformed inputs
+       size_t size() const;
+private:
+       mutable CMutex m_mutex;
+       std::map<std::string, PData> m_data;
+};
+
 /**
    \ingroup registration
 
@@ -109,12 +158,31 @@ public:
         */
        bool get_full_size(Size& size) const;
 
+       /**
+          Set the store that is used to share the deformed input data with other
+          cost functions.
+          \param store the store, passing an empty pointer disables the sharing
+        */
+       void set_deformed_data_store(typename TDeformedDataStore<Transform>::Pointer store);
+
 protected:
        /** \returns cost function weight  */
        double get_weight() const;
 
        /** \returns the current size of the data in the cost function */
        const Size& get_current_size() const;
+
+       /**
+          Deform the input data, if a deformed data store is set, the result is shared
+          with all cost functions that use the same key.
+          \param key identifier of the input data, if empty, the result is not shared
+          \param t the transformation
+          \param src the input data
+          \returns the deformed data
+        */
+       typename TDeformedDataStore<Transform>::PData
+       transform_data(const std::string& key, const Transform& t,
+                      const typename Transform::Data& src) const;
 private:
        virtual double do_evaluate(const Transform& t, CDoubleVector& gradient) const = 0;
        virtual double do_value(const Transform& t) const = 0;
@@ -125,6 +193,7 @@ private:
 
        double m_weight;
        Size m_current_size;
+       typename TDeformedDataStore<Transform>::Pointer m_deformed_store;
 
 };
 
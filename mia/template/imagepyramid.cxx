@@ -0,0 +1,290 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <map>
+#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+
+#include <mia/core/filter.hh>
+#include <mia/core/utils.hh>
+#include <mia/core/errormacro.hh>
+#include <mia/core/msgstream.hh>
+#include <mia/template/imagepyramid.hh>
+
+NS_MIA_BEGIN
+
+/*
+  Set the pixel size of a down-scaled image according to the size change,
+  this needs to be specialized for each dimension.
+*/
+template <int dim>
+struct pyramid_pixel_size {
+	static void apply(typename dimension_traits<dim>::Image& level,
+			  const typename dimension_traits<dim>::Image& parent);
+};
+
+/*
+  Smooth with the kernel [1 3 3 1]/8 and sub-sample by two along one axis.
+  The data is seen as a block of 'outer' slices each holding 'n' rows of 'stride'
+  elements, and each output row i is the weighted sum of the input rows 2i-1 to 2i+2.
+*/
+template <typename InIterator>
+void pyramid_reduce_axis(InIterator in, std::vector<float>& out, size_t stride,
+			 size_t n, size_t m, size_t outer)
+{
+	out.resize(stride * m * outer);
+
+	if (stride == 1) {
+		auto reduce_lines = [in, &out, n, m](const C1DParallelRange& range) {
+			for (auto o = range.begin(); o != range.end(); ++o) {
+				auto line = in + o * n;
+				float *out_line = &out[o * m];
+				for (size_t i = 0; i < m; ++i) {
+					const size_t k = 2 * i;
+					const size_t km = k > 0 ? k - 1 : 0;
+					const size_t kpp = k + 2 < n ? k + 2 : n - 1;
+					out_line[i] = 0.125f * (line[km] + line[kpp] +
+								3.0f * (line[k] + line[k + 1]));
+				}
+			}
+		};
+		pfor(C1DParallelRange(0, outer, std::max<size_t>(1, 4096 / n)), reduce_lines);
+	} else {
+		auto reduce_rows = [in, &out, stride, n, m](const C1DParallelRange& range) {
+			for (auto t = range.begin(); t != range.end(); ++t) {
+				const size_t o = t / m;
+				const size_t k = 2 * (t % m);
+				auto base = in + o * n * stride;
+				auto row_m = base + (k > 0 ? k - 1 : 0) * stride;
+				auto row_0 = base + k * stride;
+				auto row_1 = base + (k + 1) * stride;
+				auto row_2 = base + (k + 2 < n ? k + 2 : n - 1) * stride;
+				float *out_row = &out[t * stride];
+				for (size_t j = 0; j < stride; ++j)
+					out_row[j] = 0.125f * (row_m[j] + row_2[j] +
+							       3.0f * (row_0[j] + row_1[j]));
+			}
+		};
+		pfor(C1DParallelRange(0, outer * m, std::max<size_t>(1, 4096 / stride)), reduce_rows);
+	}
+}
+
+template <int dim>
+class FPyramidReduce: public TFilter<typename dimension_traits<dim>::PImage> {
+public:
+	typedef typename dimension_traits<dim>::Size Size;
+	typedef typename TFilter<typename dimension_traits<dim>::PImage>::result_type result_type;
+
+	FPyramidReduce(const Size& size):
+		m_size(size)
+	{
+	}
+
+	template <typename Image>
+	result_type operator () (const Image& image) const
+	{
+		typedef typename Image::value_type T;
+		Size size = image.get_size();
+		std::vector<float> buffer;
+		std::vector<float> reduced;
+		bool from_image = true;
+
+		for (int d = 0; d < dim; ++d) {
+			if (m_size[d] == size[d])
+				continue;
+
+			size_t stride = 1;
+			for (int i = 0; i < d; ++i)
+				stride *= size[i];
+			size_t outer = 1;
+			for (int i = d + 1; i < dim; ++i)
+				outer *= size[i];
+
+			if (from_image)
+				pyramid_reduce_axis(image.begin(), reduced, stride, size[d], m_size[d], outer);
+			else
+				pyramid_reduce_axis(buffer.begin(), reduced, stride, size[d], m_size[d], outer);
+
+			buffer.swap(reduced);
+			size[d] = m_size[d];
+			from_image = false;
+		}
+
+		if (from_image)
+			return result_type(new Image(image));
+
+		Image *result = new Image(m_size, image);
+		auto out = result->begin();
+		auto convert = [&buffer, out](const C1DParallelRange& range) {
+			for (auto i = range.begin(); i != range.end(); ++i)
+				out[i] = mia_round_clamped<T>(buffer[i]);
+		};
+		pfor(C1DParallelRange(0, buffer.size(), 4096), convert);
+		pyramid_pixel_size<dim>::apply(*result, image);
+		return result_type(result);
+	}
+private:
+	Size m_size;
+};
+
+template <int dim>
+TImagePyramid<dim>::TImagePyramid(PImage image, unsigned levels)
+{
+	assert(image);
+	m_levels.push_back(image);
+	add_levels(levels);
+}
+
+template <int dim>
+unsigned TImagePyramid<dim>::get_levels() const
+{
+	CScopedLock lock(m_mutex);
+	return m_levels.size();
+}
+
+template <int dim>
+void TImagePyramid<dim>::add_levels(unsigned levels) const
+{
+	while (m_levels.size() < levels) {
+		const Image& finer = *m_levels.back();
+		cvdebug() << "TImagePyramid: create level " << m_levels.size() << " of size "
+			  << get_reduced_size(finer.get_size()) << "\n";
+		m_levels.push_back(reduce(finer));
+	}
+}
+
+template <int dim>
+typename TImagePyramid<dim>::PImage
+TImagePyramid<dim>::get_level(unsigned level) const
+{
+	CScopedLock lock(m_mutex);
+	add_levels(level + 1);
+	return m_levels[level];
+}
+
+template <int dim>
+typename TImagePyramid<dim>::PImage
+TImagePyramid<dim>::get_image(const Size& size) const
+{
+	CScopedLock lock(m_mutex);
+
+	// walk down the level sizes without creating the levels
+	unsigned level = 0;
+	unsigned source_level = 0;
+	Size level_size = m_levels[0]->get_size();
+	bool found = false;
+
+	while (true) {
+		if (level_size == size) {
+			found = true;
+			break;
+		}
+		bool covers = true;
+		for (int d = 0; d < dim; ++d)
+			covers &= level_size[d] >= size[d];
+		if (!covers)
+			break;
+		source_level = level;
+
+		const Size next_size = get_reduced_size(level_size);
+		if (next_size == level_size)
+			break;
+		level_size = next_size;
+		++level;
+	}
+
+	if (found) {
+		add_levels(level + 1);
+		return m_levels[level];
+	}
+
+	for (auto i = m_resampled.begin(); i != m_resampled.end(); ++i)
+		if ((*i)->get_size() == size)
+			return *i;
+
+	add_levels(source_level + 1);
+	std::stringstream filter_descr;
+	filter_descr << "scale:s=[" << size << "]";
+	auto scaler = dimension_traits<dim>::FilterPluginHandler::instance().produce(filter_descr.str());
+	if (!scaler)
+		throw create_exception<std::runtime_error>("TImagePyramid: unable to create filter '",
+							   filter_descr.str(), "'");
+	cvdebug() << "TImagePyramid: resample level " << source_level << " to " << size << "\n";
+	auto result = scaler->filter(*m_levels[source_level]);
+	m_resampled.push_back(result);
+	return result;
+}
+
+template <int dim>
+typename TImagePyramid<dim>::Size
+TImagePyramid<dim>::get_reduced_size(const Size& size)
+{
+	Size result = size;
+	for (int d = 0; d < dim; ++d)
+		if (result[d] > 1)
+			result[d] /= 2;
+	return result;
+}
+
+template <int dim>
+typename TImagePyramid<dim>::PImage
+TImagePyramid<dim>::reduce(const Image& image)
+{
+	FPyramidReduce<dim> reducer(get_reduced_size(image.get_size()));
+	return ::mia::filter(reducer, image);
+}
+
+template <int dim>
+typename TImagePyramid<dim>::Pointer
+TImagePyramid<dim>::get_shared(PImage image, unsigned levels)
+{
+	assert(image);
+	typedef std::map<const Image *, std::weak_ptr<TImagePyramid<dim>>> PyramidMap;
+
+	// the pyramid holds a reference to the image, hence the address can not be
+	// re-used by another image as long as the pyramid is alive
+	static CMutex map_mutex;
+	static PyramidMap pyramids;
+
+	Pointer result;
+	{
+		CScopedLock lock(map_mutex);
+		result = pyramids[image.get()].lock();
+
+		if (!result) {
+			for (auto i = pyramids.begin(); i != pyramids.end();) {
+				if (i->second.expired())
+					pyramids.erase(i++);
+				else
+					++i;
+			}
+			result.reset(new TImagePyramid<dim>(image, 1));
+			pyramids[image.get()] = result;
+		}
+	}
+
+	// build the levels outside of the map lock so that the pyramids of different
+	// images are created concurrently, the pyramid serializes its own construction
+	result->get_level(levels > 0 ? levels - 1 : 0);
+	return result;
+}
+
+NS_MIA_END
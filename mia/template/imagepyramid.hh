@@ -0,0 +1,126 @@
+/* -*- mia-c++  -*-
+ *
+ * This file is part of MIA - a toolbox for medical image analysis
+ * Copyright (c) Leipzig, Madrid 1999-2017 Gert Wollny
+ *
+ * MIA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MIA; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef mia_internal_imagepyramid_hh
+#define mia_internal_imagepyramid_hh
+
+#include <vector>
+#include <memory>
+
+#include <mia/core/defines.hh>
+#include <mia/core/parallel.hh>
+#include <mia/template/dimtrait.hh>
+#include <mia/core/import_handler.hh>
+
+NS_MIA_BEGIN
+
+/**
+   \ingroup registration
+   \brief Multi-resolution representation of an image for the registration.
+
+   The pyramid holds the input image as level 0, and each following level is
+   obtained from its predecessor by halving the size along every axis that is
+   larger than one pixel, i.e. level k has the size (size / 2^k) like it is used by
+   the multi-resolution registration.  Before sub-sampling the data is low-pass
+   filtered with the separable kernel [1 3 3 1]/8 to avoid aliasing, and each
+   reduction runs in parallel.
+
+   Pyramids are shared: get_shared() returns the same pyramid for the same
+   image object as long as somebody holds a reference to it, so that all cost
+   functions and all registration levels that work on one image use the same
+   down-scaled copies that are only created once.
+   \tparam dim dimension of the input data
+*/
+template <int dim>
+class EXPORT_HANDLER TImagePyramid
+{
+public:
+       /// the trait to handle dimension based typedefs
+       typedef dimension_traits<dim> this_dim_traits;
+
+       /// the image type
+       typedef typename this_dim_traits::Image Image;
+
+       /// the pointer type of the image data
+       typedef typename this_dim_traits::PImage PImage;
+
+       /// the size type of the images
+       typedef typename this_dim_traits::Size Size;
+
+       /// the pointer type of the pyramid
+       typedef std::shared_ptr<TImagePyramid<dim>> Pointer;
+
+       /**
+          Create the pyramid and build the requested number of levels
+          \param image the full resolution image
+          \param levels number of levels to create including the full resolution
+        */
+       TImagePyramid(PImage image, unsigned levels);
+
+       /// \returns the number of levels created so far
+       unsigned get_levels() const;
+
+       /**
+          \param level the requested level, level 0 is the full resolution image
+          \returns the image at the given level, further levels are created on request
+        */
+       PImage get_level(unsigned level) const;
+
+       /**
+          Get the image of a given size. If the size corresponds to a pyramid level,
+          this level is returned, otherwise the image is re-sampled from the smallest
+          level that is not smaller than the requested size by using the "scale" filter,
+          and the result is kept for later requests.
+          \param size the requested image size
+          \returns the image of the given size
+        */
+       PImage get_image(const Size& size) const;
+
+       /**
+          Get the pyramid of the image that is shared by all users of this image object.
+          \param image the full resolution image
+          \param levels the number of levels that should be available
+          \returns the shared pyramid
+        */
+       static Pointer get_shared(PImage image, unsigned levels = 1);
+
+       /**
+          \param size the size of a level
+          \returns the size of the next coarser level
+        */
+       static Size get_reduced_size(const Size& size);
+
+       /**
+          Reduce an image by one pyramid level
+          \param image
+          \returns the image smoothed and sub-sampled to get_reduced_size(image.get_size())
+        */
+       static PImage reduce(const Image& image);
+private:
+       void add_levels(unsigned levels) const;
+
+       mutable std::vector<PImage> m_levels;
+       mutable std::vector<PImage> m_resampled;
+       mutable CMutex m_mutex;
+};
+
+NS_MIA_END
+
+#endif
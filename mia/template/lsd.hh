@@ -22,6 +22,7 @@
 #include <mia/core/msgstream.hh>
 #include <mia/core/parameter.hh>
 #include <mia/core/property_flags.hh>
+#include <mia/core/parallel.hh>
 
 #include <numeric>
 #include <limits>
@@ -46,9 +47,12 @@ private:
        class CRefPrepare : public mia::TFilter<void>
        {
        public:
-              CRefPrepare(std::vector<double>& QtQinv, std::vector<int>& Q_mappping):
+              CRefPrepare(std::vector<double>& QtQinv, std::vector<int>& Q_mappping,
+                          std::vector<int>& Q_pixels, std::vector<int>& Q_bin_start):
                      m_QtQinv(QtQinv),
-                     m_Q_mappping(Q_mappping)
+                     m_Q_mappping(Q_mappping),
+                     m_Q_pixels(Q_pixels),
+                     m_Q_bin_start(Q_bin_start)
               {
               }
               template <typename DataTempl>
@@ -56,13 +60,16 @@ private:
 
               std::vector<double>& m_QtQinv;
               std::vector<int>& m_Q_mappping;
+              std::vector<int>& m_Q_pixels;
+              std::vector<int>& m_Q_bin_start;
        };
 
        class RunCost : mia::TFilter<double>
        {
        public:
               typedef TFilter<double>::result_type result_type;
-              RunCost( const std::vector<double>& QtQinv, const std::vector<int>& Q_mappping);
+              RunCost( const std::vector<double>& QtQinv, const std::vector<int>& Q_mappping,
+                       const std::vector<int>& Q_pixels, const std::vector<int>& Q_bin_start);
 
               template <typename DataTempl>
               double operator()(const DataTempl& ref)const;
@@ -70,8 +77,16 @@ private:
               template <typename DataTempl>
               double operator()(const DataTempl& ref, Force& force)const;
        private:
+              template <typename DataTempl>
+              double sum_of_squares(const DataTempl& a)const;
+
+              template <typename DataTempl>
+              std::vector<double> bin_sums(const DataTempl& a)const;
+
               const std::vector<double>& m_QtQinv;
               const std::vector<int>& m_Q_mappping;
+              const std::vector<int>& m_Q_pixels;
+              const std::vector<int>& m_Q_bin_start;
        };
 
 
@@ -84,6 +99,9 @@ private:
 
        std::vector<double> m_QtQinv;
        std::vector<int>    m_Q_mappping;
+       // pixel indices ordered by intensity bin of the reference, and the start of each bin
+       std::vector<int>    m_Q_pixels;
+       std::vector<int>    m_Q_bin_start;
 };
 
 
@@ -139,6 +157,17 @@ void TLSDImageCost<TCost>::CRefPrepare::operator()(const DataTempl& ref)
 
        ++idx;
        m_QtQinv.resize(idx);
+       m_Q_pixels.resize(npixels);
+       m_Q_bin_start.resize(idx + 1);
+       m_Q_bin_start[0] = 0;
+
+       for (int i = 0; i < idx; ++i)
+              m_Q_bin_start[i + 1] = m_Q_bin_start[i] + static_cast<int>(m_QtQinv[i]);
+
+       std::transform(buffer.begin(), buffer.end(), m_Q_pixels.begin(),
+       [](const valpos & vp) {
+              return vp.pos;
+       });
        std::transform(m_QtQinv.begin(), m_QtQinv.end(), m_QtQinv.begin(),
        [](double x) {
               return 1.0 / x;
@@ -148,7 +177,7 @@ void TLSDImageCost<TCost>::CRefPrepare::operator()(const DataTempl& ref)
 template <typename TCost>
 void TLSDImageCost<TCost>::post_set_reference(const Data& ref)
 {
-       CRefPrepare rp(m_QtQinv, m_Q_mappping);
+       CRefPrepare rp(m_QtQinv, m_Q_mappping, m_Q_pixels, m_Q_bin_start);
        mia::accumulate(rp, ref);
 }
 
@@ -156,72 +185,107 @@ void TLSDImageCost<TCost>::post_set_reference(const Data& ref)
 template <typename TCost>
 double TLSDImageCost<TCost>::do_value(const Data& a, const Data& /*b*/) const
 {
-       RunCost rf(m_QtQinv, m_Q_mappping);
+       RunCost rf(m_QtQinv, m_Q_mappping, m_Q_pixels, m_Q_bin_start);
        return mia::filter(rf, a);
 }
 
 template <typename TCost>
 double TLSDImageCost<TCost>::do_evaluate_force(const Data& a, const Data& /*b*/, Force& force) const
 {
-       RunCost rf(m_QtQinv, m_Q_mappping);
+       RunCost rf(m_QtQinv, m_Q_mappping, m_Q_pixels, m_Q_bin_start);
        return mia::filter_and_output(rf, a, force);
 }
 
 template <typename TCost>
-TLSDImageCost<TCost>::RunCost::RunCost(const std::vector<double>& QtQinv, const std::vector<int>& Q_mappping):
+TLSDImageCost<TCost>::RunCost::RunCost(const std::vector<double>& QtQinv, const std::vector<int>& Q_mappping,
+                                       const std::vector<int>& Q_pixels, const std::vector<int>& Q_bin_start):
        m_QtQinv(QtQinv),
-       m_Q_mappping(Q_mappping)
+       m_Q_mappping(Q_mappping),
+       m_Q_pixels(Q_pixels),
+       m_Q_bin_start(Q_bin_start)
 {
 }
 
 template <typename TCost>
 template <typename DataTempl>
-double  TLSDImageCost<TCost>::RunCost::operator()(const DataTempl& a)const
+double  TLSDImageCost<TCost>::RunCost::sum_of_squares(const DataTempl& a)const
 {
-       double val1 = 0.0;
-       double val2 = 0.0;
-       std::vector<double> sums(m_QtQinv.size(), 0.0);
-       auto idx = m_Q_mappping.begin();
+       return mia::preduce_ordered(0, a.size(), 16384, 0.0,
+       [&a](const mia::C1DParallelRange & range, double sum) {
+              auto ia = a.begin() + range.begin();
+              const int n = range.end() - range.begin();
 
-       for (auto ia = a.begin(); ia != a.end(); ++ia, ++idx) {
-              val1 += *ia * *ia;
-              sums[*idx] += *ia;
-       }
-
-       for (size_t i = 0; i < sums.size(); ++i)
-              val2 += sums[i] * sums[i] * m_QtQinv[i];
+              for (int i = 0; i < n; ++i)
+                     sum += double(ia[i]) * ia[i];
 
-       return 0.5 * (val1 - val2);
+              return sum;
+       }, std::plus<double>());
 }
 
+/*
+   The intensity sums of the pixels that belong to the same bin of the reference
+   image. Since the pixels are grouped by bin, the bins can be evaluated independently.
+*/
 template <typename TCost>
 template <typename DataTempl>
-double  TLSDImageCost<TCost>::RunCost::operator()(const DataTempl& a, Force& force)const
+std::vector<double>  TLSDImageCost<TCost>::RunCost::bin_sums(const DataTempl& a)const
 {
-       double value = 0.0;
        std::vector<double> sums(m_QtQinv.size(), 0.0);
-       auto idx = m_Q_mappping.begin();
+       auto ia = a.begin();
+       mia::pfor(mia::C1DParallelRange(0, sums.size(), 256),
+       [this, ia, &sums](const mia::C1DParallelRange & range) {
+              for (auto b = range.begin(); b != range.end(); ++b) {
+                     double s = 0.0;
 
-       for (auto ia = a.begin(); ia != a.end(); ++ia, ++idx) {
-              value += *ia * *ia;
-              sums[*idx] += *ia;
-       }
+                     for (int k = m_Q_bin_start[b]; k < m_Q_bin_start[b + 1]; ++k)
+                            s += ia[m_Q_pixels[k]];
 
-       auto s = sums.begin();
+                     sums[b] = s;
+              }
+       });
+       return sums;
+}
 
-       for (auto q = m_QtQinv.begin(); q != m_QtQinv.end(); ++q, ++s) {
-              value -= *q * *s * *s;
-              *s *= *q;
-       }
+template <typename TCost>
+template <typename DataTempl>
+double  TLSDImageCost<TCost>::RunCost::operator()(const DataTempl& a)const
+{
+       const double val1 = sum_of_squares(a);
+       const std::vector<double> sums = bin_sums(a);
+       const double val2 = mia::preduce_ordered(0, sums.size(), 16384, 0.0,
+       [this, &sums](const mia::C1DParallelRange & range, double sum) {
+              for (auto i = range.begin(); i != range.end(); ++i)
+                     sum += sums[i] * sums[i] * m_QtQinv[i];
+
+              return sum;
+       }, std::plus<double>());
+       return 0.5 * (val1 - val2);
+}
+
+template <typename TCost>
+template <typename DataTempl>
+double  TLSDImageCost<TCost>::RunCost::operator()(const DataTempl& a, Force& force)const
+{
+       std::vector<double> sums = bin_sums(a);
+       const double val2 = mia::preduce_ordered(0, sums.size(), 16384, 0.0,
+       [this, &sums](const mia::C1DParallelRange & range, double sum) {
+              for (auto i = range.begin(); i != range.end(); ++i) {
+                     sum += m_QtQinv[i] * sums[i] * sums[i];
+                     sums[i] *= m_QtQinv[i];
+              }
 
-       auto gradient = get_gradient(a);
+              return sum;
+       }, std::plus<double>());
+       const double value = sum_of_squares(a) - val2;
+       const auto gradient = get_gradient(a);
        auto iforce = force.begin();
        auto igrad = gradient.begin();
-       idx = m_Q_mappping.begin();
-
-       for (auto ia = a.begin(); ia != a.end(); ++ia, ++iforce, ++igrad, ++idx)
-              *iforce = *igrad * (*ia - sums[*idx]);
-
+       auto ia = a.begin();
+       mia::pfor(mia::C1DParallelRange(0, a.size(), 16384),
+       [this, iforce, igrad, ia, &sums](const mia::C1DParallelRange & range) {
+              for (auto i = range.begin(); i != range.end(); ++i)
+                     iforce[i] = igrad[i] * (ia[i] - sums[m_Q_mappping[i]]);
+       });
        return 0.5 * value;
 }
 
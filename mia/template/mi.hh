@@ -92,11 +92,11 @@ struct FEvalForce: public mia::TFilter<float> {
        {
               Force gradient = get_gradient(a);
               m_parzen_mi.fill(a.begin(), a.end(), b.begin(), b.end());
-              typename T::const_iterator ai = a.begin();
-              typename R::const_iterator bi = b.begin();
+              std::vector<double> mi_gradient(a.size());
+              m_parzen_mi.get_gradients(a.begin(), a.end(), b.begin(), mi_gradient.begin());
 
-              for (size_t i = 0; i < a.size(); ++i, ++ai, ++bi) {
-                     float delta = -m_parzen_mi.get_gradient_slow(*ai, *bi);
+              for (size_t i = 0; i < a.size(); ++i) {
+                     float delta = -mi_gradient[i];
                      m_force[i] = gradient[i] * delta;
               }
 
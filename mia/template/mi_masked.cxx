@@ -78,13 +78,14 @@ struct FEvalForce: public mia::TFilter<float> {
 		m_parzen_mi.fill(a.begin(), a.end(), 
 				 b.begin(), b.end(), 
 				 m_mask.begin(), m_mask.end()); 
-		auto ai = a.begin();
-		auto bi = b.begin();
+		std::vector<double> mi_gradient(a.size());
+		m_parzen_mi.get_gradients(a.begin(), a.end(), b.begin(), 
+					  m_mask.begin(), mi_gradient.begin()); 
 		auto mi = m_mask.begin();
 	
-		for (size_t i = 0; i < a.size(); ++i, ++ai, ++bi, ++mi) {
+		for (size_t i = 0; i < a.size(); ++i, ++mi) {
 			if (*mi) {
-				float delta = -m_parzen_mi.get_gradient_slow(*ai, *bi); 
+				float delta = -mi_gradient[i]; 
 				m_force[i] = gradient[i] * delta;
 			}
 		}
@@ -25,7 +25,9 @@ NS_MIA_BEGIN
 
 template <typename T> 
 TFullCostList<T>::TFullCostList():
-	TFullCost<T>(1.0)
+	TFullCost<T>(1.0), 
+	m_shared_inputs(new TDeformedDataStore<T>()), 
+	m_fused(true)
 {
 }
 
@@ -33,6 +35,17 @@ template <typename T>
 void TFullCostList<T>::push(typename TFullCost<T>::Pointer cost)
 {
 	m_costs.push_back(cost); 
+	if (m_fused) 
+		cost->set_deformed_data_store(m_shared_inputs); 
+}
+
+template <typename T> 
+void TFullCostList<T>::set_fused_evaluation(bool fused)
+{
+	m_fused = fused; 
+	for (auto i = m_costs.begin(); i != m_costs.end(); ++i) 
+		(*i)->set_deformed_data_store(fused ? m_shared_inputs : 
+					      typename TDeformedDataStore<T>::Pointer()); 
 }
 
 template <typename T> 
@@ -62,14 +75,25 @@ double TFullCostList<T>::do_evaluate(const T& t, CDoubleVector& gradient) const
 	CDoubleVector tmp(gradient.size()); 
 	std::stringstream msg; 
 	msg << "Cost: "; 
+
+	// the transformation has changed since the last evaluation 
+	m_shared_inputs->clear(); 
+	
+	auto g = gradient.begin(); 
+	auto ig = tmp.begin(); 
+	auto accumulate = [g, ig](const C1DParallelRange& range) {
+		for (auto k = range.begin(); k != range.end(); ++k)
+			g[k] += ig[k]; 
+	}; 
+	
 	for (auto i = m_costs.begin(); i != m_costs.end(); ++i) {
 		std::fill(tmp.begin(), tmp.end(), 0.0); 
 		double h = (*i)->evaluate(t, tmp); 
 		msg << h << "("<< (*i)->get_init_string() << ") "; 
 		result += h; 
-		std::transform(gradient.begin(), gradient.end(), tmp.begin(), gradient.begin(), 
-			       [](double x, double y){return x+y;}); 
+		pfor(C1DParallelRange(0, gradient.size(), 4096), accumulate); 
 	}
+	m_shared_inputs->clear(); 
 	cvinfo() << msg.str() << " = " << result << "\n"; 
 	return result; 
 }
@@ -80,11 +104,13 @@ double TFullCostList<T>::do_value(const T& t) const
 	double  result = 0; 
 	std::stringstream msg; 
 	msg << "Cost: "; 
+	m_shared_inputs->clear(); 
 	for (auto i = m_costs.begin(); i != m_costs.end(); ++i) {
 		double h = (*i)->cost_value(t); 
 		msg << h << "("<< (*i)->get_init_string() << ") "; 
 		result += h; 
 	}
+	m_shared_inputs->clear(); 
 	cvinfo() << msg.str() << " = " << result << "\n"; 
 	return result; 
 }
@@ -50,6 +50,14 @@ public:
         */
        void push(typename TFullCost<Transform>::Pointer cost);
 
+       /**
+          Enable or disable the fused evaluation. In fused mode (the default) each
+          distinct moving input is only deformed once per evaluation of the list,
+          and the result is shared among all cost functions that use this input.
+          \param fused the evaluation mode
+        */
+       void set_fused_evaluation(bool fused);
+
 
 private:
        bool do_has(const char *property) const;
@@ -61,6 +69,8 @@ private:
        void do_reinit();
        bool do_get_full_size(Size& size) const;
        std::vector<typename TFullCost<Transform>::Pointer> m_costs;
+       typename TDeformedDataStore<Transform>::Pointer m_shared_inputs;
+       bool m_fused;
 };
 
 NS_MIA_END
@@ -21,6 +21,9 @@
 #define VSTREAM_DOMAIN "NR-REG"
 
 #include <iomanip>
+#include <mia/core/bufferpool.hh>
+#include <mia/core/datapool.hh>
+#include <mia/template/imagepyramid.hh>
 
 NS_MIA_BEGIN
 
@@ -109,6 +112,8 @@ template <int dim>
 typename TNonrigidRegister<dim>::PTransformation 
 TNonrigidRegister<dim>::run(PImage src, PImage ref) const
 {
+	// the temporary images and fields of the cost evaluations are re-used
+	CBufferPoolScope pool_scope;
 	return impl->run(src, ref);
 }
 
@@ -116,6 +121,7 @@ template <int dim>
 typename TNonrigidRegister<dim>::PTransformation 
 TNonrigidRegister<dim>::run() const
 {
+	CBufferPoolScope pool_scope;
 	return impl->run();
 }
 
@@ -229,7 +235,18 @@ TNonrigidRegisterImpl<dim>::run(PImage src, PImage ref) const
 
 	save_image(src_name, src);
 	save_image(ref_name, ref);
+
+	// build the multi-resolution representation of both images once, the full cost 
+	// functions pick up these shared pyramids for all levels of the registration. 
+	// The pyramids are shared per image object, hence they must be built on the 
+	// images the cost functions will read from the pool 
+	auto src_pyramid = TImagePyramid<dim>::get_shared(load_image<PImage>(src_name), m_mg_levels); 
+	auto ref_pyramid = TImagePyramid<dim>::get_shared(load_image<PImage>(ref_name), m_mg_levels); 
 	m_costs.reinit(); 
+
+	// the cost functions hold their own references now 
+	CDatapool::instance().remove(src_name); 
+	CDatapool::instance().remove(ref_name); 
 	
 	Size global_size; 
 	if (!m_costs.get_full_size(global_size))
@@ -423,8 +440,12 @@ double  TNonrigRegGradientProblem<dim>::evaluate_fdf(const CDoubleVector& x, CDo
 		CDoubleVector help(g.size()); 
 		const double penalty = m_transf.get_energy_penalty_and_gradient(help);
 		result += penalty; 
-		std::transform(help.begin(), help.end(), g.begin(), g.begin(), 
-			  [](double x, double y){return x+y;}); 
+		auto ig = g.begin(); 
+		auto ih = help.begin(); 
+		pfor(C1DParallelRange(0, g.size(), 4096), [ig, ih](const C1DParallelRange& range) {
+				for (auto k = range.begin(); k != range.end(); ++k)
+					ig[k] += ih[k]; 
+			}); 
 		cvinfo() << "Penalty=" << std::setw(20) << std::setprecision(12) << penalty << "\n"; 
 	}
 
@@ -22,6 +22,7 @@
 #define mia_internal_seededwatershed_hh
 
 #include <queue>
+#include <mia/core/bucketqueue.hh>
 #include <mia/template/dimtrait.hh>
 
 NS_MIA_BEGIN
@@ -45,7 +46,8 @@ public:
 
 
        TSeededWS(const DataKey& mask_image, PNeighbourhood neighborhood,
-                 bool with_borders, bool input_is_gradient);
+                 bool with_borders, bool input_is_gradient, unsigned int quantize = 0,
+                 bool fifo = false);
 
        template <template <typename>  class Image, typename T>
        typename TSeededWS<dim>::result_type operator () (const Image<T>& data) const;
@@ -56,6 +58,8 @@ private:
        PNeighbourhood m_neighborhood;
        PFilter m_togradnorm;
        bool m_with_borders;
+       unsigned int m_quantize;
+       bool m_fifo;
 };
 
 template <int dim>
@@ -75,16 +79,20 @@ private:
        PNeighbourhood m_neighborhood;
        bool m_with_borders;
        bool m_input_is_gradient;
+       unsigned int m_quantize;
+       bool m_fifo;
 };
 
 template <template <typename>  class Image, typename  T, typename  S, typename N, typename R, int dim, bool supported>
 struct seeded_ws {
-       static R apply(const Image<T>& image, const Image<S>& seed, N n, bool with_borders);
+       static R apply(const Image<T>& image, const Image<S>& seed, N n, bool with_borders, unsigned int quantize,
+                      bool fifo);
 };
 
 template <template <typename>  class Image, typename  T, typename  S, typename N, typename R, int dim>
 struct seeded_ws<Image, T, S, N, R, dim, false> {
-       static R apply(const Image<T>& /*image*/, const Image<S>& /*seed*/, N /*n*/, bool /*with_borders*/)
+       static R apply(const Image<T>& /*image*/, const Image<S>& /*seed*/, N /*n*/, bool /*with_borders*/,
+                      unsigned int /*quantize*/, bool /*fifo*/)
        {
               throw create_exception<std::invalid_argument>("C2DRunSeededWS: seed data type '", __type_descr<S>::value, "' not supported");
        }
@@ -95,39 +103,95 @@ struct seeded_ws<Image, T, S, N, R, dim, false> {
 template <template <typename>  class Image, typename  T, typename N, typename R, int dim>
 struct dispatch_RunSeededWS : public TFilter<R> {
 
-       dispatch_RunSeededWS(N neighborhood, const Image<T>& image, bool with_borders):
+       dispatch_RunSeededWS(N neighborhood, const Image<T>& image, bool with_borders, unsigned int quantize,
+                            bool fifo):
               m_neighborhood(neighborhood),
               m_image(image),
-              m_with_borders(with_borders)
+              m_with_borders(with_borders),
+              m_quantize(quantize),
+              m_fifo(fifo)
        {}
 
        template <typename  S>
        R operator () (const Image<S>& seed) const
        {
               const bool supported = std::is_integral<S>::value && !std::is_same<S, bool>::value;
-              return seeded_ws<Image, T, S, N, R, dim, supported>::apply(m_image, seed, m_neighborhood, m_with_borders);
+              return seeded_ws<Image, T, S, N, R, dim, supported>::apply(m_image, seed, m_neighborhood,
+                            m_with_borders, m_quantize, m_fifo);
        }
        N m_neighborhood;
        const Image<T>& m_image;
        bool m_with_borders;
+       unsigned int m_quantize;
+       bool m_fifo;
 };
 
 
-template <typename L, typename Position>
+/*
+  Queue entry of the flooding, the position is stored as flat index into the image.
+*/
+template <typename L>
+struct SQueuedPixel {
+       uint32_t index;
+       L label;
+};
+
+/*
+  Pixels of the same level are flooded in raster order, like the priority queue does.
+*/
+template <typename L>
+struct SLowerIndex {
+       bool operator () (const SQueuedPixel<L>& lhs, const SQueuedPixel<L>& rhs) const
+       {
+              return lhs.index < rhs.index;
+       }
+};
+
+template <typename L>
 struct PixelWithLocation {
-       Position pos;
+       SQueuedPixel<L> pixel;
        float value;
-       L label;
 };
 
-template <typename L, typename Position>
-bool operator < (const PixelWithLocation<L, Position>& lhs, const PixelWithLocation<L, Position>& rhs)
+template <typename L>
+bool operator < (const PixelWithLocation<L>& lhs, const PixelWithLocation<L>& rhs)
 {
-       mia::less_then<Position> l;
        return lhs.value > rhs.value ||
-              ( lhs.value ==  rhs.value && l(rhs.pos, lhs.pos));
+              ( lhs.value ==  rhs.value && rhs.pixel.index < lhs.pixel.index);
 }
 
+/*
+  Priority queue for the flooding of inputs whose values can not be used as bucket
+  levels. It provides the same interface as TBucketQueue, and both retrieve the
+  pixels ordered by value and then by raster index.
+*/
+template <typename L>
+class TPixelPriorityQueue
+{
+public:
+       void push(float value, const SQueuedPixel<L>& pixel)
+       {
+              PixelWithLocation<L> p;
+              p.pixel = pixel;
+              p.value = value;
+              m_queue.push(p);
+       }
+
+       SQueuedPixel<L> pop()
+       {
+              auto p = m_queue.top();
+              m_queue.pop();
+              return p.pixel;
+       }
+
+       bool empty() const
+       {
+              return m_queue.empty();
+       }
+private:
+       std::priority_queue<PixelWithLocation<L>> m_queue;
+};
+
 template <template <typename>  class Image, typename T, typename S, int dim>
 class TRunSeededWatershed
 {
@@ -142,105 +206,176 @@ public:
        typedef typename CImage::dimsize_type Position;
 
 
-       TRunSeededWatershed(const Image<T>& image, const Image<S>& seed, PNeighbourhood neighborhood, bool with_borders);
+       TRunSeededWatershed(const Image<T>& image, const Image<S>& seed, PNeighbourhood neighborhood,
+                           bool with_borders, unsigned int quantize, bool fifo);
        PImage run();
 private:
-       void add_neighborhood(const PixelWithLocation<S, Position>& pixel);
-       const Image<T>& m_image;
-       const Image<S>& m_seed;
-       PNeighbourhood m_neighborhood;
-       Image<unsigned char> m_visited;
-       Image<unsigned char>  m_stored;
+       enum EPixelState {
+              ps_stored = 1,
+              ps_visited = 2
+       };
+
+       template <typename Queue, typename Level>
+       void flood(Queue& queue, Level level);
+
+       template <typename Level>
+       void flood_buckets(unsigned int n_levels, Level level);
+
+       template <typename Queue, typename Level>
+       void add_neighborhood(const SQueuedPixel<S>& pixel, Queue& queue, Level level);
+
+       typename Image<T>::const_iterator m_image;
+       typename Image<S>::const_iterator m_seed;
+       Position m_size;
+       std::vector<std::pair<MPosition, long>> m_neighborhood;
+       std::vector<unsigned char> m_state;
        Image<S>       *m_result;
        PImage m_presult;
-       std::priority_queue<PixelWithLocation<S, Position>> m_seeds;
+       typename Image<S>::iterator m_out;
        S m_watershed;
        bool m_with_borders;
+       unsigned int m_quantize;
+       bool m_fifo;
 };
 
 template <template <typename>  class Image, typename T, typename S, int dim>
 TRunSeededWatershed<Image, T, S, dim>::TRunSeededWatershed(const Image<T>& image, const Image<S>& seed,
-              PNeighbourhood neighborhood, bool with_borders):
-       m_image(image),
-       m_seed(seed),
-       m_neighborhood(neighborhood),
-       m_visited(seed.get_size()),
-       m_stored(seed.get_size()),
+              PNeighbourhood neighborhood, bool with_borders, unsigned int quantize, bool fifo):
+       m_image(image.begin()),
+       m_seed(seed.begin()),
+       m_size(seed.get_size()),
+       m_state(seed.size(), 0),
        m_watershed(std::numeric_limits<S>::max()),
-       m_with_borders(with_borders)
+       m_with_borders(with_borders),
+       m_quantize(quantize),
+       m_fifo(fifo)
 {
+       if (seed.size() > std::numeric_limits<uint32_t>::max())
+              throw create_exception<std::invalid_argument>("SeededWS: the image has too many pixels");
+
+       for (auto i = neighborhood->begin(); i != neighborhood->end(); ++i) {
+              if (*i == MPosition::_0)
+                     continue;
+
+              long delta = 0;
+
+              for (int d = dim - 1; d >= 0; --d)
+                     delta = delta * m_size[d] + (*i)[d];
+
+              m_neighborhood.push_back(std::make_pair(*i, delta));
+       }
+
        m_result = new Image<S>(seed.get_size(), image);
        m_presult.reset(m_result);
+       m_out = m_result->begin();
 }
 
 template <template <typename>  class Image, typename T, typename S, int dim>
-void TRunSeededWatershed<Image, T, S, dim>::add_neighborhood(const PixelWithLocation<S, Position>& pixel)
+template <typename Queue, typename Level>
+void TRunSeededWatershed<Image, T, S, dim>::add_neighborhood(const SQueuedPixel<S>& pixel,
+              Queue& queue, Level level)
 {
-       PixelWithLocation<S, Position> new_pixel;
+       SQueuedPixel<S> new_pixel;
        new_pixel.label = pixel.label;
        bool hit_boundary = false;
+       const Position pos = flat_index_to_position<dim>(pixel.index, m_size);
+
+       for (auto i = m_neighborhood.begin(); i != m_neighborhood.end(); ++i) {
+              Position new_pos( pos + i->first);
+
+              if (!(new_pos < m_size))
+                     continue;
 
-       for (auto i = m_neighborhood->begin(); i != m_neighborhood->end(); ++i) {
-              Position new_pos( pixel.pos + *i);
-
-              if (new_pos != pixel.pos && new_pos < m_seed.get_size()) {
-                     if (!m_visited(new_pos)) {
-                            if (!m_stored(new_pos) ) {
-                                   new_pixel.value = m_image(new_pos);
-                                   new_pixel.pos = new_pos;
-                                   m_seeds.push(new_pixel);
-                                   m_stored(new_pos) = 1;
-                            }
-                     } else {
-                            hit_boundary |= (*m_result)(new_pos) != pixel.label &&
-                                            (*m_result)(new_pos) != m_watershed;
+              const uint32_t new_index = pixel.index + i->second;
+              unsigned char& state = m_state[new_index];
+
+              if (!(state & ps_visited)) {
+                     if (!(state & ps_stored)) {
+                            new_pixel.index = new_index;
+                            queue.push(level(m_image[new_index]), new_pixel);
+                            state |= ps_stored;
                      }
+              } else {
+                     hit_boundary |= m_out[new_index] != pixel.label &&
+                                     m_out[new_index] != m_watershed;
               }
        }
 
        // set pixel to new label
-       if (!m_visited(pixel.pos)) {
-              m_visited(pixel.pos) = true;
-              (*m_result)(pixel.pos) = (m_with_borders && hit_boundary) ? m_watershed : pixel.label;
+       unsigned char& state = m_state[pixel.index];
+
+       if (!(state & ps_visited)) {
+              state |= ps_visited;
+              m_out[pixel.index] = (m_with_borders && hit_boundary) ? m_watershed : pixel.label;
        }
 }
 
 template <template <typename>  class Image, typename T, typename S, int dim>
-typename TRunSeededWatershed<Image, T, S, dim>::PImage
-TRunSeededWatershed<Image, T, S, dim>::run()
+template <typename Queue, typename Level>
+void TRunSeededWatershed<Image, T, S, dim>::flood(Queue& queue, Level level)
 {
        // copy seed and read initial pixels
-       auto iv = m_visited.begin();
-       auto is = m_seed.begin_range(Position::_0, m_seed.get_size());
-       auto es = m_seed.end_range(Position::_0, m_seed.get_size());
-       auto ir = m_result->begin();
-       auto ii = m_image.begin();
-       auto ist = m_stored.begin();
-       PixelWithLocation<S, Position> pixel;
-
-       while (is != es) {
-              *ir = *is;
-
-              if (*is) {
-                     *iv = 1;
-                     *ist;
-                     pixel.pos = is.pos();
-                     pixel.value = *ii;
-                     pixel.label = *is;
-                     m_seeds.push(pixel);
+       const uint32_t n = m_state.size();
+       SQueuedPixel<S> pixel;
+
+       for (uint32_t i = 0; i < n; ++i) {
+              m_out[i] = m_seed[i];
+
+              if (m_seed[i]) {
+                     m_state[i] = ps_visited;
+                     pixel.index = i;
+                     pixel.label = m_seed[i];
+                     queue.push(level(m_image[i]), pixel);
               }
+       }
 
-              ++iv;
-              ++is;
-              ++ir;
-              ++ist;
-              ++ii;
+       while (!queue.empty())
+              add_neighborhood(queue.pop(), queue, level);
+}
+
+template <template <typename>  class Image, typename T, typename S, int dim>
+template <typename Level>
+void TRunSeededWatershed<Image, T, S, dim>::flood_buckets(unsigned int n_levels, Level level)
+{
+       if (m_fifo) {
+              TFifoBucketQueue<SQueuedPixel<S>> queue(n_levels);
+              flood(queue, level);
+       } else {
+              TBucketQueue<SQueuedPixel<S>, SLowerIndex<S>> queue(n_levels);
+              flood(queue, level);
        }
+}
 
-       while (!m_seeds.empty()) {
-              auto p = m_seeds.top();
-              m_seeds.pop();
-              add_neighborhood(p);
+template <template <typename>  class Image, typename T, typename S, int dim>
+typename TRunSeededWatershed<Image, T, S, dim>::PImage
+TRunSeededWatershed<Image, T, S, dim>::run()
+{
+       // integer valued inputs with a moderate range are flooded by using a bucket
+       // queue with one level per value, other inputs only if quantization is requested.
+       // The exact bucket queue processes the pixels in the same order as the priority
+       // queue, hence the segmentation does not change. The FIFO buckets avoid sorting
+       // the pixels of one level, but the watersheds may be placed differently
+       const unsigned int max_exact_levels = 1 << 16;
+       auto range = std::minmax_element(m_image, m_image + m_state.size());
+       const double vmin = *range.first;
+       const double vmax = *range.second;
+
+       if (std::is_integral<T>::value && vmax - vmin < max_exact_levels) {
+              cvdebug() << "SeededWS: flood " << vmax - vmin + 1 << " exact levels\n";
+              flood_buckets(vmax - vmin + 1, [vmin](T v) -> unsigned int {
+                     return v - vmin;
+              });
+       } else if (m_quantize > 1) {
+              cvdebug() << "SeededWS: flood " << m_quantize << " quantized levels\n";
+              const double scale = vmax > vmin ? (m_quantize - 1) / (vmax - vmin) : 0.0;
+              flood_buckets(m_quantize, [vmin, scale](T v) -> unsigned int {
+                     return (v - vmin) * scale;
+              });
+       } else {
+              TPixelPriorityQueue<S> queue;
+              flood(queue, [](T v) -> float {
+                     return v;
+              });
        }
 
        return m_presult;
@@ -248,17 +383,20 @@ TRunSeededWatershed<Image, T, S, dim>::run()
 
 template <template <typename>  class Image, typename  T, typename  S, typename N, typename R, int dim, bool supported>
 R seeded_ws<Image, T, S, N, R, dim, supported>::apply(const Image<T>& image,
-              const Image<S>& seed, N neighborhood, bool with_borders)
+              const Image<S>& seed, N neighborhood, bool with_borders, unsigned int quantize, bool fifo)
 {
-       TRunSeededWatershed<Image, T, S, dim> ws(image, seed, neighborhood, with_borders);
+       TRunSeededWatershed<Image, T, S, dim> ws(image, seed, neighborhood, with_borders, quantize, fifo);
        return ws.run();
 }
 
 template <int dim>
-TSeededWS<dim>::TSeededWS(const DataKey& label_image_key, PNeighbourhood neighborhood, bool with_borders, bool input_is_gradient):
+TSeededWS<dim>::TSeededWS(const DataKey& label_image_key, PNeighbourhood neighborhood, bool with_borders,
+                          bool input_is_gradient, unsigned int quantize, bool fifo):
        m_label_image_key(label_image_key),
        m_neighborhood(neighborhood),
-       m_with_borders(with_borders)
+       m_with_borders(with_borders),
+       m_quantize(quantize),
+       m_fifo(fifo)
 
 {
        if (!input_is_gradient)
@@ -285,7 +423,8 @@ typename TSeededWS<dim>::result_type TSeededWS<dim>::operator () (const Image<T>
                             , ", input ", data.get_size());
        }
 
-       dispatch_RunSeededWS<Image, T, PNeighbourhood, PImage, dim> ws(m_neighborhood, data, m_with_borders);
+       dispatch_RunSeededWS<Image, T, PNeighbourhood, PImage, dim> ws(m_neighborhood, data, m_with_borders, m_quantize,
+                     m_fifo);
        return mia::filter(ws, *seed);
 }
 
@@ -307,20 +446,29 @@ template <int dim>
 TSeededWSFilterPlugin<dim>::TSeededWSFilterPlugin():
        Handler::Interface("sws"),
        m_with_borders(false),
-       m_input_is_gradient(false)
+       m_input_is_gradient(false),
+       m_quantize(0),
+       m_fifo(false)
 {
        this->add_parameter("seed", new CStringParameter(m_seed_image_file, CCmdOptionFlags::required_input,
                            "seed input image containing the lables for the initial regions"));
        this->add_parameter("n", make_param(m_neighborhood, "sphere:r=1", false, "Neighborhood for watershead region growing"));
        this->add_parameter("mark", new CBoolParameter(m_with_borders, false, "Mark the segmented watersheds with a special gray scale value"));
        this->add_parameter("grad", new CBoolParameter(m_input_is_gradient, false, "Interpret the input image as gradient. "));
+       this->add_parameter("q", make_param(m_quantize, false, "Number of levels used to quantize the input intensities "
+                           "for the flooding (0 = no quantization). Integer valued inputs with less than 65536 distinct "
+                           "levels are always flooded exactly by using a bucket queue, other inputs are only flooded by "
+                           "using a bucket queue if quantization is requested."));
+       this->add_parameter("fifo", new CBoolParameter(m_fifo, false, "Flood the pixels of one level of the bucket "
+                           "queue in the order they were reached instead of in raster order. This is faster, but the "
+                           "watersheds may be placed differently than without bucket queue."));
 }
 
 template <int dim>
 typename TSeededWSFilterPlugin<dim>::CFilter *TSeededWSFilterPlugin<dim>::do_create()const
 {
        auto seed = FileHandler::instance().load_to_pool(m_seed_image_file);
-       return new TSeededWS<dim>(seed, m_neighborhood, m_with_borders, m_input_is_gradient);
+       return new TSeededWS<dim>(seed, m_neighborhood, m_with_borders, m_input_is_gradient, m_quantize, m_fifo);
 }
 
 template <int dim>
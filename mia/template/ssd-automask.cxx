@@ -34,6 +34,18 @@ struct SRA {
 	double sum;
 }; 
 
+/* blocks of fixed size that are combined in order make the result 
+   independent of the number of threads */ 
+const int ssd_automask_block_size = 16384; 
+
+inline SRA sra_combine(const SRA& lhs, const SRA& rhs) 
+{
+	SRA result;
+	result.n = lhs.n + rhs.n; 
+	result.sum = lhs.sum + rhs.sum; 
+	return result; 
+}
+
 struct FEvalSSDAuto : public mia::TFilter<double> {
 	FEvalSSDAuto(double src_mask_thresh, double ref_mask_thresh):
 		m_src_mask_thresh(src_mask_thresh),
@@ -45,28 +57,23 @@ struct FEvalSSDAuto : public mia::TFilter<double> {
 		SRA result_accumulator = {0, 0.0}; 
 		
 		SRA  result = 
-			mia::preduce(mia::C1DParallelRange(0, a.size()), result_accumulator, 
+			mia::preduce_ordered(0, a.size(), ssd_automask_block_size, result_accumulator, 
 				[this, &a, &b](const mia::C1DParallelRange& range, SRA acc)->SRA {
-					for (auto ir = range.begin(); ir !=range.end(); ++ir){
-						double va = a[ir]; 
-						if (va >= m_src_mask_thresh) { 
-							double vb = b[ir];
-							if (vb >= m_ref_mask_thresh) {
-								++acc.n; 
-								double d = va - vb; 
-								acc.sum += d * d; 
-							}
+					auto ia = a.begin() + range.begin(); 
+					auto ib = b.begin() + range.begin(); 
+					const int n = range.end() - range.begin(); 
+					for (int i = 0; i < n; ++i){
+						double va = ia[i]; 
+						double vb = ib[i];
+						if (va >= m_src_mask_thresh && vb >= m_ref_mask_thresh) {
+							++acc.n; 
+							double d = va - vb; 
+							acc.sum += d * d; 
 						}
 					}
 					return acc; 
 				}, 
-				[](const SRA& lhs, const SRA& rhs) -> SRA {
-					SRA result;
-					result.n = lhs.n + rhs.n; 
-					result.sum = lhs.sum + rhs.sum; 
-					return result; 
-				}
-				); 
+				sra_combine); 
 		mia::cvdebug() << "sum=" << result.sum << ", n=" <<  result.n << "\n"; 
 		return result.n > 0 ? 0.5 * result.sum / result.n : 0.0; 
 	}
@@ -109,32 +116,47 @@ struct FEvalForceAuto: public mia::TFilter<float> {
 		}
 	template <typename T, typename R> 
 	float operator ()( const T& a, const R& b) const {
-		Force gradient = get_gradient(a); 
-		float cost = 0.0; 
-		auto ai = a.begin();
-		auto bi = b.begin();
-		auto fi = m_force.begin(); 
-		auto gi = gradient.begin(); 
-
-		size_t n = 0;
+		const Force gradient = get_gradient(a); 
+		auto iforce = m_force.begin(); 
+		const double src_thresh = m_src_mask_thresh; 
+		const double ref_thresh = m_ref_mask_thresh; 
+		SRA zero = {0, 0.0}; 
+
+		SRA result = 
+			mia::preduce_ordered(0, a.size(), ssd_automask_block_size, zero, 
+				[&a, &b, &gradient, iforce, src_thresh, ref_thresh]
+				(const mia::C1DParallelRange& range, SRA acc)->SRA {
+					auto ai = a.begin() + range.begin();
+					auto bi = b.begin() + range.begin();
+					auto gi = gradient.begin() + range.begin(); 
+					auto fi = iforce + range.begin(); 
+					const int n = range.end() - range.begin(); 
+					double cost = 0.0; 
+					for (int i = 0; i < n; ++i) {
+						if ((ai[i] >= src_thresh) && (bi[i] >= ref_thresh)) {
+							float delta = float(ai[i]) - float(bi[i]); 
+							fi[i] = gi[i] * delta ;
+							cost += delta * delta; 
+							++acc.n; 
+						}else 
+							fi[i] = force_type(); 
+					}
+					acc.sum += cost; 
+					return acc; 
+				}, 
+				sra_combine); 
 		
-		for (size_t i = 0; i < a.size(); ++i, ++ai, ++bi, ++fi, ++gi) {
-			if ((*ai >= m_src_mask_thresh) && (*bi >= m_ref_mask_thresh)) {
-				float delta = float(*ai) - float(*bi); 
-				*fi = *gi * delta ;
-				cost += delta * delta; 
-				++n; 
-			}else 
-				*fi = force_type(); 
-		}
 		double scale = 0.0; 
-		if (n > 0) 
-			scale = 1.0 / n; 
+		if (result.n > 0) 
+			scale = 1.0 / result.n; 
 		
-		transform(m_force.begin(), m_force.end(), m_force.begin(), 
-			  [scale](const force_type& v){return scale * v;});  
+		mia::pfor(mia::C1DParallelRange(0, m_force.size(), ssd_automask_block_size), 
+			  [iforce, scale](const mia::C1DParallelRange& range) {
+				  for (auto i = range.begin(); i != range.end(); ++i)
+					  iforce[i] = scale * iforce[i]; 
+			  }); 
 		
-		return 0.5 * scale * cost;
+		return 0.5 * scale * result.sum;
 	}
 private: 
 	Force& m_force; 
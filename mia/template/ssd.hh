@@ -22,6 +22,7 @@
 #include <mia/core/msgstream.hh>
 #include <mia/core/parameter.hh>
 #include <mia/core/property_flags.hh>
+#include <mia/core/parallel.hh>
 
 #include <numeric>
 #include <limits>
@@ -46,53 +47,74 @@ public:
 private:
        virtual double do_value(const Data& a, const Data& b) const;
        virtual double do_evaluate_force(const Data& a, const Data& b, Force& force) const;
+       virtual double do_evaluate_samples(const std::vector<float>& src, const std::vector<float>& ref,
+                                          size_t n_voxels, std::vector<float>& dsrc) const;
        bool m_normalize;
        float m_automask_thresh;
 };
 
 
+/*
+  The sums are evaluated in blocks of fixed size that are combined in order,
+  this way the result doesn't depend on the number of threads.
+*/
+const int ssd_block_size = 16384;
+
+struct SSSDSum {
+       double sum;
+       long n;
+
+       static SSSDSum combine(const SSSDSum& lhs, const SSSDSum& rhs)
+       {
+              SSSDSum result = {lhs.sum + rhs.sum, lhs.n + rhs.n};
+              return result;
+       }
+};
+
 struct FEvalSSD : public mia::TFilter<double> {
        FEvalSSD(bool normalize, float automask_thresh):
               m_normalize(normalize), m_automask_thresh(automask_thresh) {}
 
-       template <typename T, typename R>
-       struct SQD {
-              double operator ()(T a, R b) const
-              {
-                     double d = (double)a - (double)b;
-                     return d * d;
-              }
-       };
-
        template <typename  T, typename  R>
        FEvalSSD::result_type operator () (const T& a, const R& b) const
        {
-              double scale = m_normalize ? 0.5 / a.size() : 0.5;
-
-              if (m_automask_thresh == 0.0f)
-                     return scale * inner_product(a.begin(), a.end(), b.begin(), 0.0,  ::std::plus<double>(),
-                                                  SQD<typename T::value_type, typename R::value_type >());
-              else {
-                     auto ia = a.begin();
-                     auto ib = b.begin();
-                     auto ie = a.end();
-                     long n = 0;
+              const float thresh = m_automask_thresh;
+              auto block_ssd = [&a, &b, thresh](const mia::C1DParallelRange & range, SSSDSum acc) -> SSSDSum {
+                     auto ia = a.begin() + range.begin();
+                     auto ib = b.begin() + range.begin();
+                     const int n = range.end() - range.begin();
                      double sum = 0.0;
 
-                     while (ia != ie) {
-                            if (*ia > m_automask_thresh) {
-                                   double d = (double) * ia - (double) * ib;
+                     if (thresh == 0.0f) {
+                            for (int i = 0; i < n; ++i) {
+                                   double d = (double)ia[i] - (double)ib[i];
                                    sum += d * d;
-                                   ++n;
                             }
 
-                            ++ia;
-                            ++ib;
+                            acc.n += n;
+                     } else {
+                            for (int i = 0; i < n; ++i) {
+                                   if (ia[i] > thresh) {
+                                          double d = (double)ia[i] - (double)ib[i];
+                                          sum += d * d;
+                                          ++acc.n;
+                                   }
+                            }
                      }
 
-                     // high penalty if the mask don't overlap at all
-                     return n > 0 ?  0.5 * sum / n : std::numeric_limits<float>::max();
+                     acc.sum += sum;
+                     return acc;
+              };
+              const SSSDSum zero = {0.0, 0};
+              auto r = mia::preduce_ordered(0, a.size(), ssd_block_size, zero, block_ssd, SSSDSum::combine);
+
+              if (m_automask_thresh == 0.0f) {
+                     double scale = m_normalize ? 0.5 / a.size() : 0.5;
+                     return scale * r.sum;
               }
+
+              // high penalty if the mask don't overlap at all
+              return r.n > 0 ?  0.5 * r.sum / r.n : std::numeric_limits<float>::max();
        }
        bool m_normalize;
        float m_automask_thresh;
@@ -105,6 +127,7 @@ TSSDCost<TCost>::TSSDCost():
        m_automask_thresh(0.0)
 {
        this->add(::mia::property_gradient);
+       this->add(::mia::property_sampling);
 }
 
 template <typename TCost>
@@ -113,6 +136,7 @@ TSSDCost<TCost>::TSSDCost(bool normalize, float automask_thresh):
        m_automask_thresh(automask_thresh)
 {
        this->add(::mia::property_gradient);
+       this->add(::mia::property_sampling);
 }
 
 template <typename TCost>
@@ -133,46 +157,57 @@ struct FEvalForce: public mia::TFilter<float> {
        template <typename T, typename R>
        float operator ()( const T& a, const R& b) const
        {
-              Force gradient = get_gradient(a);
-              float cost = 0.0;
-              auto ai = a.begin();
-              auto bi = b.begin();
-              auto fi = m_force.begin();
-              auto gi = gradient.begin();
-
-              if (m_automask_thresh == 0.0f) {
-                     float scale = m_normalize ? 1.0 / a.size() : 1.0;
-
-                     for (size_t i = 0; i < a.size(); ++i, ++ai, ++bi, ++fi, ++gi) {
-                            float delta = float(*ai) - float(*bi);
-                            *fi = *gi * delta  * scale;
-                            cost += delta * delta * scale;
-                     }
-
-                     return 0.5 * cost;
-              } else {
-                     long n = 0;
-
-                     for (size_t i = 0; i < a.size(); ++i, ++ai, ++bi, ++fi, ++gi) {
-                            if (*ai > m_automask_thresh) {
-                                   float delta = float(*ai) - float(*bi);
-                                   *fi = *gi * delta;
-                                   cost += delta * delta;
-                                   ++n;
+              const Force gradient = get_gradient(a);
+              const float thresh = m_automask_thresh;
+              const float scale = (thresh == 0.0f && m_normalize) ? 1.0 / a.size() : 1.0;
+              auto iforce = m_force.begin();
+              auto block_force = [&a, &b, &gradient, iforce, thresh, scale]
+              (const mia::C1DParallelRange & range, SSSDSum acc) -> SSSDSum {
+                     auto ia = a.begin() + range.begin();
+                     auto ib = b.begin() + range.begin();
+                     auto ig = gradient.begin() + range.begin();
+                     auto fi = iforce + range.begin();
+                     const int n = range.end() - range.begin();
+                     double cost = 0.0;
+
+                     if (thresh == 0.0f) {
+                            for (int i = 0; i < n; ++i) {
+                                   float delta = float(ia[i]) - float(ib[i]);
+                                   fi[i] = ig[i] * delta * scale;
+                                   cost += delta * delta * scale;
                             }
-                     }
 
-                     if ( n > 0) {
-                            float  scale = 1.0f / n;
-                            transform(m_force.begin(), m_force.end(), m_force.begin(),
-                            [scale](const typename Force::value_type &  x) {
-                                   return scale * x;
-                            });
-                            return 0.5 * cost  * scale;
+                            acc.n += n;
                      } else {
-                            return std::numeric_limits<float>::max();
+                            for (int i = 0; i < n; ++i) {
+                                   if (ia[i] > thresh) {
+                                          float delta = float(ia[i]) - float(ib[i]);
+                                          fi[i] = ig[i] * delta;
+                                          cost += delta * delta;
+                                          ++acc.n;
+                                   }
+                            }
                      }
-              }
+
+                     acc.sum += cost;
+                     return acc;
+              };
+              const SSSDSum zero = {0.0, 0};
+              auto r = mia::preduce_ordered(0, a.size(), ssd_block_size, zero, block_force, SSSDSum::combine);
+
+              if (thresh == 0.0f)
+                     return 0.5 * r.sum;
+
+              if (r.n == 0)
+                     return std::numeric_limits<float>::max();
+
+              const float mask_scale = 1.0f / r.n;
+              mia::pfor(mia::C1DParallelRange(0, m_force.size(), ssd_block_size),
+              [iforce, mask_scale](const mia::C1DParallelRange & range) {
+                     for (auto i = range.begin(); i != range.end(); ++i)
+                            iforce[i] = mask_scale * iforce[i];
+              });
+              return 0.5 * r.sum  * mask_scale;
        }
 private:
        Force& m_force;
@@ -194,6 +229,41 @@ double TSSDCost<TCost>::do_evaluate_force(const Data& a, const Data& b, Force& f
 }
 
 
+/**
+   The sum over the samples is scaled to estimate the sum over all voxels, with normalization
+   or automatic masking the mean over the (masked) samples is used.
+*/
+template <typename TCost>
+double TSSDCost<TCost>::do_evaluate_samples(const std::vector<float>& src, const std::vector<float>& ref,
+              size_t n_voxels, std::vector<float>& dsrc) const
+{
+       const size_t n = src.size();
+       const float thresh = m_automask_thresh;
+       dsrc.resize(n);
+       double sum = 0.0;
+       long n_used = 0;
+
+       for (size_t i = 0; i < n; ++i) {
+              if (thresh == 0.0f || src[i] > thresh) {
+                     const float delta = src[i] - ref[i];
+                     dsrc[i] = delta;
+                     sum += delta * delta;
+                     ++n_used;
+              } else
+                     dsrc[i] = 0.0f;
+       }
+
+       if (n_used == 0)
+              return thresh == 0.0f ? 0.0 : std::numeric_limits<float>::max();
+
+       const double scale = (thresh == 0.0f && !m_normalize) ? double(n_voxels) / n : 1.0 / n_used;
+
+       for (auto& d : dsrc)
+              d *= scale;
+
+       return 0.5 * scale * sum;
+}
+
 /**
    This is the plug-in declaration - the actual plugin needs to define the
    cost plugin type and the data type (this could be unified)
@@ -222,6 +292,7 @@ TSSDCostPlugin<CP, C>::TSSDCostPlugin():
 {
        TRACE("TSSDCostPlugin<CP,C>::TSSDCostPlugin()");
        this->add_property(::mia::property_gradient);
+       this->add_property(::mia::property_sampling);
        this->add_parameter("norm", new mia::CBoolParameter(m_normalize, false,
                            "Set whether the metric should be normalized by the number of image pixels")
                           );
@@ -22,7 +22,10 @@
 #define mia_internal_watershed_hh
 
 #include <mia/core/filter.hh>
+#include <mia/template/dimtrait.hh>
 #include <queue>
+#include <numeric>
+#include <type_traits>
 
 NS_MIA_BEGIN
 
@@ -60,6 +63,9 @@ private:
        template <template <typename>  class Image, typename T>
        bool grow(const PixelWithLocation& p, Image<unsigned int>& labels, const Image<T>& data) const;
 
+       template <template <typename>  class Image, typename T>
+       static void sort_by_value(std::vector<uint32_t>& pixels, const Image<T>& data, double vmin, double vmax);
+
        friend bool operator < (const PixelWithLocation& lhs, const PixelWithLocation& rhs)
        {
               mia::less_then<Position> l;
@@ -216,17 +222,52 @@ bool TWatershed<dim>::grow(const PixelWithLocation& p, Image<unsigned int>& labe
        return has_backtracked;
 }
 
+/*
+  Sort the pixel indices by increasing value, pixels with the same value stay in raster
+  order. This is the order in which a priority queue would deliver the pixels, but
+  integer valued inputs are sorted in linear time by counting the values.
+*/
+template <int dim>
+template <template <typename>  class Image, typename T>
+void TWatershed<dim>::sort_by_value(std::vector<uint32_t>& pixels, const Image<T>& data, double vmin, double vmax)
+{
+       auto d = data.begin();
+       if (std::is_integral<T>::value && vmax - vmin < (1 << 16)) {
+              std::vector<size_t> start(static_cast<size_t>(vmax - vmin) + 2, 0);
+
+              for (auto i : pixels)
+                     ++start[static_cast<size_t>(d[i] - vmin) + 1];
+
+              std::partial_sum(start.begin(), start.end(), start.begin());
+              std::vector<uint32_t> sorted(pixels.size());
+
+              for (auto i : pixels)
+                     sorted[start[static_cast<size_t>(d[i] - vmin)]++] = i;
+
+              pixels.swap(sorted);
+       } else {
+              std::stable_sort(pixels.begin(), pixels.end(), [d](uint32_t a, uint32_t b) {
+                     return static_cast<float>(d[a]) < static_cast<float>(d[b]);
+              });
+       }
+}
+
 template <int dim>
 template <template <typename>  class Image, typename T>
 typename TWatershed<dim>::result_type TWatershed<dim>::operator () (const Image<T>& data) const
 {
        auto sizeND =  data.get_size();
+
+       if (data.size() > std::numeric_limits<uint32_t>::max())
+              throw create_exception<std::invalid_argument>("WS: the image has too many pixels");
+
        Image<unsigned int> labels(data.get_size());
        // evaluate the real thresh hold based on the actual gradient range
        auto gradient_range = std::minmax_element(data.begin(), data.end());
        float thresh = m_thresh * (*gradient_range.second - *gradient_range.first) + *gradient_range.first;
-       std::priority_queue<PixelWithLocation> pixels;
+       std::vector<uint32_t> pixels;
        PixelWithLocation p;
+       uint32_t index = 0;
        auto i = data.begin_range(Position::_0, data.get_size());
        auto e = data.end_range(Position::_0, data.get_size());
        auto l = labels.begin();
@@ -244,15 +285,20 @@ typename TWatershed<dim>::result_type TWatershed<dim>::operator () (const Image<
                                    ++next_label;
                      }
               } else
-                     pixels.push(p);
+                     pixels.push_back(index);
 
               ++i;
               ++l;
+              ++index;
        }
 
-       while (!pixels.empty()) {
-              auto pixel = pixels.top();
-              pixels.pop();
+       sort_by_value(pixels, data, *gradient_range.first, *gradient_range.second);
+       auto d = data.begin();
+
+       for (auto ip = pixels.begin(); ip != pixels.end(); ++ip) {
+              PixelWithLocation pixel;
+              pixel.pos = flat_index_to_position<dim>(*ip, sizeND);
+              pixel.value = d[*ip];
 
               // this label was set because we grew an initial region
               if (labels(pixel.pos)) {
@@ -7,6 +7,8 @@
 
 #cmakedefine ENABLE_DEBUG_MESSAGES 1
 
+#cmakedefine ENABLE_PROFILING 1
+
 #define SOURCE_ROOT "@SOURCE_ROOT@"
 #define PLUGIN_SEARCH_PATH  "@PLUGIN_SEARCH_PATH@"
 #define PLUGIN_INSTALL_PATH  "@PLUGIN_INSTALL_PATH@"
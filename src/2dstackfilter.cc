@@ -40,7 +40,8 @@ const SProgramDescription g_description = {
        {
               pdi_description, "This program is used to filter and convert a series of 2D "
               "gray scale images in a 3D fashion by running filters (filter/2dimage) "
-              "as given on the command line."
+              "as given on the command line. With the option --pipeline the filters "
+              "are run concurrently, each filter after the first one in its own thread."
        },
        {
               pdi_example_descr, "Run a mean-least-varaiance filter on a series of images that follow the "
@@ -119,6 +120,7 @@ int do_main(int argc, char *argv[])
        string out_filename;
        string out_type;
        vector<int> new_size;
+       unsigned int queue_length = 0;
        const C2DImageIOPluginHandler::Instance& imageio = C2DImageIOPluginHandler::instance();
        const C2DFifoFilterPluginHandler::Instance& sfh = C2DFifoFilterPluginHandler::instance();
        CCmdOptionList options(g_description);
@@ -128,6 +130,11 @@ int do_main(int argc, char *argv[])
                              , CCmdOptionFlags::required_output, &imageio));
        options.add(make_opt( out_type, imageio.get_supported_suffix_set(), "type", 't',
                              "output file type", CCmdOptionFlags::required));
+       options.add(make_opt( queue_length, "pipeline", 'p', "Run each filter of the chain after the first one "
+                             "and the saving of the output in its own thread, with at most this number of images "
+                             "waiting in front of each of them. The first filter runs in the thread that loads the "
+                             "images. This way, the images are loaded, filtered, and saved concurrently. "
+                             "(0 = process each image through the whole chain before loading the next one)"));
 
        if (options.parse(argc, argv, "filter", &sfh) != CCmdOptionList::hr_no)
               return EXIT_SUCCESS;
@@ -167,6 +174,7 @@ int do_main(int argc, char *argv[])
        endchain(new C2DStackSaver(out_filename, start_filenum, end_filenum, format_width,
                                   out_type, imageio, time(NULL)));
        filter->append_filter(endchain);
+       filter->set_pipelined(queue_length);
        //		char new_line = cverb.show_debug() ? '\n' : '\r';
        cvmsg() << "will filter " << end_filenum - start_filenum << " images\n";
 
@@ -46,6 +46,7 @@ int do_main( int argc, char *argv[] )
 {
        string in_filename;
        string out_filename;
+       unsigned slab_depth = 0;
        const auto& filter_plugins = C3DFilterPluginHandler::instance();
        const auto& imageio = C3DImageIOPluginHandler::instance();
        stringstream filter_names;
@@ -55,6 +56,12 @@ int do_main( int argc, char *argv[] )
                              CCmdOptionFlags::required_input, &imageio));
        options.add(make_opt( out_filename, "out-file", 'o', "output image(s) that have been filtered",
                              CCmdOptionFlags::required_output, &imageio));
+       options.add(make_opt( slab_depth, "slab-depth", 0, "If the filter chain only consists of "
+                             "local filters, run it in slabs of this many slices along the z-axis (0 = run on "
+                             "the whole image). If the input and the output file format support slice-wise IO "
+                             "(Analyze), the image is read and written slab by slab, and the memory use is "
+                             "bounded by the slab size. Otherwise the input and output images are held in memory "
+                             "completely, and only the intermediate images are reduced to the slab size."));
 
        if (options.parse(argc, argv, "filter", &filter_plugins) != CCmdOptionList::hr_no)
               return EXIT_SUCCESS;
@@ -74,6 +81,23 @@ int do_main( int argc, char *argv[] )
 
        //CHistory::instance().append(argv[0], "unknown", options);
        auto filters = create_filter_chain(filter_chain);
+       TDataFilterChained<C3DImage> chained;
+
+       for (auto f = filters.begin(); f != filters.end(); ++f)
+              chained.push_back(*f);
+
+       const bool run_in_slabs = slab_depth > 0 && !filters.empty() && chained.get_support_radius() >= 0;
+
+       if (run_in_slabs) {
+              if (run_filter_streaming(in_filename, out_filename, chained, slab_depth)) {
+                     cvmsg() << "Filtered the image slice-wise in slabs of " << slab_depth
+                             << " slices with a halo of " << chained.get_support_radius() << " slices\n";
+                     return EXIT_SUCCESS;
+              }
+
+              cvmsg() << "The image can't be read and written slice-wise, hold input and output in memory\n";
+       }
+
        // read image
        auto  in_image_list = imageio.load(in_filename);
 
@@ -83,13 +107,24 @@ int do_main( int argc, char *argv[] )
        if (in_image_list->empty())
               throw create_exception<runtime_error>("Got empty image list from '", in_filename, "'");
 
-       auto filter_name = filter_chain.begin();
-
-       for (auto f = filters.begin();  f != filters.end(); ++f, ++filter_name) {
-              cvmsg() << "Run filter: " << *filter_name << "\n";
+       if (run_in_slabs) {
+              cvmsg() << "Run filter chain in slabs of " << slab_depth << " slices with a halo of "
+                      << chained.get_support_radius() << " slices\n";
 
               for (auto i = in_image_list->begin(); i != in_image_list->end(); ++i)
-                     *i = (*f)->filter(**i);
+                     *i = run_filter_in_memory_slabs(**i, chained, slab_depth);
+       } else {
+              if (slab_depth > 0 && !filters.empty())
+                     cvmsg() << "Filter chain contains non-local filters, run on whole images\n";
+
+              auto filter_name = filter_chain.begin();
+
+              for (auto f = filters.begin();  f != filters.end(); ++f, ++filter_name) {
+                     cvmsg() << "Run filter: " << *filter_name << "\n";
+
+                     for (auto i = in_image_list->begin(); i != in_image_list->end(); ++i)
+                            *i = (*f)->filter(**i);
+              }
        }
 
        cvdebug() << "Save image to '" << out_filename << "\n";
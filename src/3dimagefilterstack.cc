@@ -68,6 +68,7 @@ int do_main( int argc, char *argv[] )
        string in_filename;
        string out_filename;
        string out_type;
+       unsigned slab_depth = 0;
        const auto& filter_plugins = C3DFilterPluginHandler::instance();
        const auto& imageio = C3DImageIOPluginHandler::instance();
        CCmdOptionList options(g_description);
@@ -76,6 +77,12 @@ int do_main( int argc, char *argv[] )
                              "file pattern, and the file  extension is added according to the 'type' option.",
                              CCmdOptionFlags::required_output, &imageio));
        options.add(make_opt( out_type, imageio.get_set(), "type", 't', "output file type", CCmdOptionFlags::required));
+       options.add(make_opt( slab_depth, "slab-depth", 0, "If the filter chain only consists of "
+                             "local filters, run it in slabs of this many slices along the z-axis (0 = run on "
+                             "the whole images). If the input and the output file format support slice-wise IO "
+                             "(Analyze), the images are read and written slab by slab, and the memory use is "
+                             "bounded by the slab size. Otherwise the input and output images are held in memory "
+                             "completely, and only the intermediate images are reduced to the slab size."));
 
        if (options.parse(argc, argv, "filter", &filter_plugins) != CCmdOptionList::hr_no)
               return EXIT_SUCCESS;
@@ -111,6 +118,16 @@ int do_main( int argc, char *argv[] )
               filters.push_back(filter);
        }
 
+       TDataFilterChained<C3DImage> chained;
+
+       for (auto f = filters.begin(); f != filters.end(); ++f)
+              chained.push_back(*f);
+
+       const bool run_in_slabs = slab_depth > 0 && !filters.empty() && chained.get_support_radius() >= 0;
+
+       if (slab_depth > 0 && !filters.empty() && !run_in_slabs)
+              cvmsg() << "Filter chain contains non-local filters, run on whole images\n";
+
        size_t start_filenum = 0;
        size_t end_filenum  = 0;
        size_t format_width = 0;
@@ -127,30 +144,40 @@ int do_main( int argc, char *argv[] )
        for (size_t i = start_filenum; i < end_filenum; ++i) {
               string src_name = create_filename(src_basename.c_str(), i);
               cvmsg() << new_line << "Filter: " << i << " out of " << "[" << start_filenum << "," << end_filenum << "]" ;
-              auto in_image_list = imageio.load(src_name);
-
-              if (in_image_list.get() && in_image_list->size()) {
-                     if (use_src_format)
-                            out_type = in_image_list->get_source_format();
-
-                     auto filter_name = filter_chain.begin();
-
-                     for (auto f = filters.begin(); f != filters.end(); ++f, ++filter_name) {
-                            cvdebug() << "Run filter: " << *filter_name << "\n";
-
-                            for (auto i = in_image_list->begin();
-                                 i != in_image_list->end(); ++i) {
-                                   *i = (*f)->filter(**i);
+              stringstream ss;
+              ss << out_filename << setw(format_width) << setfill('0') << i << "." << out_suffix;
+
+              if (run_in_slabs && run_filter_streaming(src_name, ss.str(), chained, slab_depth)) {
+                     cvdebug() << "Filtered " << src_name << " slice-wise to " << ss.str() << "\n";
+              } else {
+                     auto in_image_list = imageio.load(src_name);
+
+                     if (in_image_list.get() && in_image_list->size()) {
+                            if (use_src_format)
+                                   out_type = in_image_list->get_source_format();
+
+                            if (run_in_slabs) {
+                                   for (auto i = in_image_list->begin(); i != in_image_list->end(); ++i)
+                                          *i = run_filter_in_memory_slabs(**i, chained, slab_depth);
+                            } else {
+                                   auto filter_name = filter_chain.begin();
+
+                                   for (auto f = filters.begin(); f != filters.end(); ++f, ++filter_name) {
+                                          cvdebug() << "Run filter: " << *filter_name << "\n";
+
+                                          for (auto i = in_image_list->begin();
+                                               i != in_image_list->end(); ++i) {
+                                                 *i = (*f)->filter(**i);
+                                          }
+                                   }
                             }
-                     }
 
-                     stringstream ss;
-                     ss << out_filename << setw(format_width) << setfill('0') << i << "." << out_suffix;
-                     cvdebug() << "Save to " << ss.str() << ", format = " << out_type << "\n";
+                            cvdebug() << "Save to " << ss.str() << ", format = " << out_type << "\n";
 
-                     if ( !imageio.save(ss.str(), *in_image_list) ) {
-                            string not_save = ("unable to save result to ") + ss.str();
-                            throw runtime_error(not_save);
+                            if ( !imageio.save(ss.str(), *in_image_list) ) {
+                                   string not_save = ("unable to save result to ") + ss.str();
+                                   throw runtime_error(not_save);
+                            }
                      }
               }
 
@@ -25,6 +25,8 @@
 #include <iostream>
 #include <iomanip>
 #include <fstream>
+#include <numeric>
+#include <algorithm>
 
 #include <string>
 #include <stdexcept>
@@ -66,7 +68,7 @@ struct FDistAcummulator : public TFilter<void> {
        void operator ()(const T2DImage<T>& image)
        {
               C2DFImage buf(image.get_size());
-              distance_transform_prepare(image.begin(), image.end(), buf.begin());
+              distance_transform_prepare(image.begin(), image.end(), buf.begin(), __is_mask_pixel<T>::value);
               m_distance.push_slice(m_z, buf);
               ++m_z;
        }
@@ -99,31 +101,51 @@ int do_main( int argc, char *argv[] )
        if (start_filenum >= end_filenum)
               throw invalid_argument(string("no files match pattern ") + src_basename);
 
-       C3DDistance distance;
+       C3DDistance distance(true);
        FDistAcummulator acc(distance);
-
-       for (size_t i = start_filenum; i < end_filenum; ++i) {
-              cvmsg() << "Read slice " << i << " out of " << "[" << start_filenum << ", " << end_filenum << ")\r";
-              string src_name = create_filename(src_basename.c_str(), i);
+       const int n_slices = end_filenum - start_filenum;
+       int n_read = 0;
+       auto read_slice = [&]() {
+              cvinfo() << "Read slice " << n_read << " out of " << n_slices << "\n";
+              string src_name = create_filename(src_basename.c_str(), start_filenum + n_read);
               auto in_image = load_image2d(src_name);
               mia::accumulate(acc, *in_image);
-       }
-
-       cvmsg() << "\n";
+              ++n_read;
+       };
+       read_slice();
        auto in_mesh = meshio.load(src_filename);
        auto iv = in_mesh->vertices_begin();
-       auto ev = in_mesh->vertices_end();
        auto is = in_mesh->scale_begin();
        auto len = in_mesh->vertices_size();
+       // visit the vertices ordered by z, so that the streaming distance
+       // transform can release the data that is no longer needed
+       vector<unsigned int> order(len);
+       iota(order.begin(), order.end(), 0);
+       stable_sort(order.begin(), order.end(), [&iv](unsigned int a, unsigned int b) {
+              return iv[a].z < iv[b].z;
+       });
        unsigned int k = 0;
 
-       while (iv != ev) {
+       for (auto i : order) {
               ++k;
 
               if (!(k & 0xF))
                      cvmsg() << k << " of " << len << "\r";
 
-              *is++ = distance.get_distance_at(*iv++);
+              // the distance d at z is exact if all slices up to z + d were added, hence the
+              // slices are only read when they are needed and the distance is re-evaluated
+              float dist = distance.get_distance_at(iv[i]);
+
+              while (n_read < n_slices && n_read <= iv[i].z + dist) {
+                     read_slice();
+
+                     // a distance that lies within the stack bounds the slices that are
+                     // still needed, otherwise no mask pixel was found so far
+                     if (dist >= n_slices || n_read > iv[i].z + dist)
+                            dist = distance.get_distance_at(iv[i]);
+              }
+
+              is[i] = dist;
        }
 
        cvmsg() << "\n";
@@ -111,17 +111,38 @@ int do_main( int argc, char *argv[] )
        if (start_filenum >= end_filenum)
               throw invalid_argument(string("no files match pattern ") + src_basename);
 
-       C3DDistance distance;
+       C3DDistance distance(true);
        FDistAcummulator acc(distance);
-
-       for (size_t i = start_filenum; i < end_filenum; ++i) {
-              cvmsg() << "Read slice " << i << " out of " << "[" << start_filenum << ", " << end_filenum << ")\r";
-              string src_name = create_filename(src_basename.c_str(), i);
+       const int n_slices = end_filenum - start_filenum;
+       int n_read = 0;
+       auto read_slice = [&]() {
+              cvinfo() << "Read slice " << n_read << " out of " << n_slices << "\n";
+              string src_name = create_filename(src_basename.c_str(), start_filenum + n_read);
               auto in_image = load_image2d(src_name);
               mia::accumulate(acc, *in_image);
-       }
+              ++n_read;
+       };
+       read_slice();
+
+       // the distances of slice z are exact if all slices up to z plus the largest distance
+       // in the slice were added, hence the slices are only read when they are needed
+       auto get_distance_image = [&](int z) {
+              C2DFImage result = create_distance_image(distance, z);
+              float dist = *max_element(result.begin(), result.end());
+
+              while (n_read < n_slices && n_read <= z + dist) {
+                     read_slice();
+
+                     // a distance that lies within the stack bounds the slices that are
+                     // still needed, otherwise no mask pixel was found so far
+                     if (dist >= n_slices || n_read > z + dist) {
+                            result = create_distance_image(distance, z);
+                            dist = *max_element(result.begin(), result.end());
+                     }
+              }
 
-       cvmsg() << "\n";
+              return result;
+       };
        auto in_mesh = meshio.load(src_filename);
        in_mesh = mia::run_filter(*in_mesh, "vtxsort:dir=[<0,0,1>]");
        auto iv = in_mesh->vertices_begin();
@@ -130,8 +151,8 @@ int do_main( int argc, char *argv[] )
        int old_z_start = static_cast<int>(floor(iv->z));
        int old_z_end   = old_z_start + 1;
        C2DInterpolatorFactory  ipf("bspline:d=1", "zero");
-       C2DFImage z_low = create_distance_image(distance, old_z_start);
-       C2DFImage z_high =  create_distance_image(distance, old_z_end);
+       C2DFImage z_low = get_distance_image(old_z_start);
+       C2DFImage z_high =  get_distance_image(old_z_end);
        shared_ptr<T2DInterpolator<float>> ipzlow(ipf.create(z_low.data()));
        shared_ptr<T2DInterpolator<float>> ipzhigh(ipf.create(z_high.data()));
        int n = in_mesh->vertices_size();
@@ -153,15 +174,16 @@ int do_main( int argc, char *argv[] )
                      max_distance = 0.0f;
                      min_distance = numeric_limits<float>::max();
 
+                     // the streaming distance transform must be queried in increasing z order
                      if (z_start == old_z_end) {
                             ipzlow = ipzhigh;
-                            ipzhigh.reset(ipf.create(create_distance_image(distance, z_end).data()));
+                            ipzhigh.reset(ipf.create(get_distance_image(z_end).data()));
                      } else if (z_end == old_z_start) {
                             ipzhigh = ipzlow;
-                            ipzlow.reset(ipf.create(create_distance_image(distance, z_start).data()));
+                            ipzlow.reset(ipf.create(get_distance_image(z_start).data()));
                      } else {
-                            ipzhigh.reset(ipf.create(create_distance_image(distance, z_end).data()));
-                            ipzlow.reset(ipf.create(create_distance_image(distance, z_start).data()));
+                            ipzlow.reset(ipf.create(get_distance_image(z_start).data()));
+                            ipzhigh.reset(ipf.create(get_distance_image(z_end).data()));
                      }
 
                      old_z_start = z_start;